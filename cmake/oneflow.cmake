@@ -107,6 +107,10 @@ foreach(oneflow_single_file ${oneflow_all_src})
        "^${PROJECT_SOURCE_DIR}/oneflow/(core|user|maybe|thread)/.*_test\\.cpp$")
       # test file
       list(APPEND of_all_test_cc ${oneflow_single_file})
+    elseif("${oneflow_single_file}" MATCHES
+           "^${PROJECT_SOURCE_DIR}/oneflow/(core|user)/.*_benchmark\\.cpp$")
+      # benchmark file
+      list(APPEND of_all_benchmark_cc ${oneflow_single_file})
     elseif(APPLE AND "${oneflow_single_file}" MATCHES
                      "^${PROJECT_SOURCE_DIR}/oneflow/core/comm_network/(epoll|ibverbs)/.*")
       # skip if macOS
@@ -447,6 +451,7 @@ if(BUILD_CPP_API)
   file(GLOB_RECURSE of_cpp_api_files ${PROJECT_SOURCE_DIR}/oneflow/api/cpp/*.cpp
        ${PROJECT_SOURCE_DIR}/oneflow/api/cpp/*.h)
   list(FILTER of_cpp_api_files EXCLUDE REGEX "oneflow/api/cpp/tests")
+  list(FILTER of_cpp_api_files EXCLUDE REGEX "oneflow/api/cpp/benchmarks")
   oneflow_add_library(oneflow_cpp SHARED ${of_cpp_api_files})
   set_target_properties(oneflow_cpp PROPERTIES ARCHIVE_OUTPUT_DIRECTORY "${LIBONEFLOW_LIBRARY_DIR}"
                                                LIBRARY_OUTPUT_DIRECTORY "${LIBONEFLOW_LIBRARY_DIR}")
@@ -481,6 +486,20 @@ if(BUILD_TESTING)
     endif()
   endif()
 
+  # the benchmarks are not run by ctest, build each of them with `make oneflow_<file name>`, e.g.
+  # `make oneflow_permute_benchmark`
+  foreach(benchmark_cc ${of_all_benchmark_cc})
+    get_filename_component(benchmark_file_name ${benchmark_cc} NAME_WE)
+    set(benchmark_name oneflow_${benchmark_file_name})
+    oneflow_add_executable(${benchmark_name} EXCLUDE_FROM_ALL ${benchmark_cc})
+    set_target_properties(${benchmark_name} PROPERTIES RUNTIME_OUTPUT_DIRECTORY
+                                                       "${PROJECT_BINARY_DIR}/bin")
+    target_link_libraries(${benchmark_name} ${of_libs} ${oneflow_third_party_libs} glog::glog)
+    if(BUILD_CUDA)
+      target_link_libraries(${benchmark_name} CUDA::cudart_static)
+    endif()
+  endforeach()
+
   if(BUILD_CPP_API)
     file(GLOB_RECURSE cpp_api_test_files ${PROJECT_SOURCE_DIR}/oneflow/api/cpp/tests/*.cpp)
     oneflow_add_test(
@@ -494,6 +513,14 @@ if(BUILD_TESTING)
     find_package(Threads REQUIRED)
     target_link_libraries(oneflow_cpp_api_testexe oneflow_cpp ${oneflow_third_party_libs}
                           ${oneflow_test_libs} Threads::Threads)
+    # the benchmarks are not run by ctest, build them with `make oneflow_cpp_api_benchmark`
+    oneflow_add_executable(
+      oneflow_cpp_api_benchmark EXCLUDE_FROM_ALL
+      ${PROJECT_SOURCE_DIR}/oneflow/api/cpp/benchmarks/batching_graph_benchmark.cpp)
+    set_target_properties(oneflow_cpp_api_benchmark PROPERTIES RUNTIME_OUTPUT_DIRECTORY
+                                                               "${PROJECT_BINARY_DIR}/bin")
+    target_link_libraries(oneflow_cpp_api_benchmark oneflow_cpp ${oneflow_third_party_libs}
+                          Threads::Threads)
   endif()
 endif()
 
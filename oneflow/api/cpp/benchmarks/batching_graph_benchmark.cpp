@@ -0,0 +1,96 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+// A local load generator for BatchingGraph: several clients submit requests of batch size 1 in
+// closed loop, and the throughput and the latency percentiles are reported for each batching
+// setting.
+//
+// Usage: oneflow_cpp_api_benchmark [model_path] [client_num] [request_num_per_client]
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "oneflow/api/cpp/api.h"
+
+namespace oneflow_api {
+
+namespace {
+
+// The default model computes x * a + b with x of shape (batch_size, 3).
+constexpr char kDefaultModelPath[] =
+    "./oneflow/api/cpp/tests/graph_test_model/affine_with_parameter";
+
+void RunBenchmark(const std::string& model_path, int client_num, int request_num_per_client) {
+  Device device("cpu");
+  for (const std::vector<int>& batch_sizes :
+       std::vector<std::vector<int>>{{1}, {1, 4, 16}, {1, 2, 4, 8, 16}}) {
+    BatchingOptions options;
+    options.batch_sizes = batch_sizes;
+    options.max_queue_delay_us = 500;
+    BatchingGraph graph(model_path, device, options);
+
+    std::vector<std::vector<double>> client_latencies(client_num);
+    const auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> clients;
+    for (int c = 0; c < client_num; ++c) {
+      clients.emplace_back([&, c]() {
+        std::vector<float> data(3, 1);
+        for (int i = 0; i < request_num_per_client; ++i) {
+          const auto request_start = std::chrono::steady_clock::now();
+          graph.Submit(Tensor::from_buffer(data.data(), Shape({1, 3}), device, DType::kFloat))
+              .get();
+          const std::chrono::duration<double, std::milli> latency =
+              std::chrono::steady_clock::now() - request_start;
+          client_latencies[c].push_back(latency.count());
+        }
+      });
+    }
+    for (auto& client : clients) { client.join(); }
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    std::vector<double> latencies;
+    for (const auto& client_latency : client_latencies) {
+      latencies.insert(latencies.end(), client_latency.begin(), client_latency.end());
+    }
+    if (latencies.empty()) { continue; }
+    std::sort(latencies.begin(), latencies.end());
+    const auto Percentile = [&](double p) {
+      return latencies.at(static_cast<size_t>(p * (latencies.size() - 1)));
+    };
+    std::cout << "max batch size: " << batch_sizes.back()
+              << ", throughput: " << latencies.size() / elapsed.count() << " req/s"
+              << ", p50: " << Percentile(0.5) << " ms, p99: " << Percentile(0.99) << " ms"
+              << std::endl;
+  }
+}
+
+}  // namespace
+
+}  // namespace oneflow_api
+
+int main(int argc, char** argv) {
+  const std::string model_path = argc > 1 ? argv[1] : oneflow_api::kDefaultModelPath;
+  const int client_num = argc > 2 ? std::atoi(argv[2]) : 16;
+  const int request_num_per_client = argc > 3 ? std::atoi(argv[3]) : 64;
+  oneflow_api::initialize();
+  oneflow_api::RunBenchmark(model_path, client_num, request_num_per_client);
+  oneflow_api::release();
+  return 0;
+}
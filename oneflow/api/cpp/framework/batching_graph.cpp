@@ -0,0 +1,307 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include "oneflow/api/cpp/framework/batching_graph.h"
+#include "oneflow/api/cpp/framework/graph.h"
+#include "oneflow/api/cpp/framework/tensor.h"
+#include "oneflow/core/common/just.h"
+#include "oneflow/core/common/scalar.h"
+#include "oneflow/core/common/shape.h"
+#include "oneflow/core/framework/tensor.h"
+#include "oneflow/core/framework/tensor_tuple.h"
+#include "oneflow/core/functional/functional.h"
+#include "oneflow/core/job/lazy_mode.h"
+
+namespace oneflow_api {
+
+namespace of = oneflow;
+namespace functional = of::one::functional;
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct Request {
+  std::vector<Tensor> inputs;
+  int64_t batch_size = 0;
+  Clock::time_point enqueue_time;
+  std::promise<IValue> promise;
+};
+
+std::vector<Tensor> ToTensorVector(const IValue& inputs) {
+  if (inputs.IsTensor()) { return {inputs.ToTensor()}; }
+  if (inputs.IsTensorVector()) { return inputs.ToTensorVector(); }
+  throw std::invalid_argument("BatchingGraph currently only support types: Tensor/vector(Tensor)");
+}
+
+IValue ToIValue(std::vector<Tensor>&& outputs) {
+  if (outputs.empty()) {
+    return IValue{};
+  } else if (outputs.size() == 1) {
+    return IValue(std::move(outputs.at(0)));
+  } else {
+    return IValue(std::move(outputs));
+  }
+}
+
+// Concatenates the inputs of the requests along the batch dimension and pads them with zeros to
+// padded_batch_size
+of::Maybe<std::vector<Tensor>> GatherInputs(const std::vector<std::unique_ptr<Request>>& requests,
+                                            int64_t batch_size, int64_t padded_batch_size) {
+  const size_t input_num = requests.front()->inputs.size();
+  std::vector<Tensor> inputs;
+  inputs.reserve(input_num);
+  for (size_t i = 0; i < input_num; ++i) {
+    of::one::TensorTuple parts;
+    for (const auto& request : requests) {
+      CHECK_EQ_OR_RETURN(request->inputs.size(), input_num)
+          << "The number of inputs of the requests in the same batch should be the same";
+      parts.emplace_back(request->inputs.at(i).__internal_tensor());
+    }
+    if (padded_batch_size > batch_size) {
+      of::Shape padding_shape(*parts.front()->shape());
+      padding_shape.Set(0, padded_batch_size - batch_size);
+      parts.emplace_back(JUST(functional::Constant(padding_shape, of::Scalar(0),
+                                                   parts.front()->dtype(),
+                                                   JUST(parts.front()->device()))));
+    }
+    if (parts.size() == 1) {
+      inputs.emplace_back(Tensor(parts.front()));
+    } else {
+      inputs.emplace_back(Tensor(JUST(functional::Concat(parts, /*dim=*/0))));
+    }
+  }
+  return inputs;
+}
+
+// Splits the outputs along the batch dimension for each request. The outputs without the batch
+// dimension are copied to all the requests. The outputs are always copied because the output
+// buffers of the graph are overwritten by the next batch.
+of::Maybe<std::vector<std::vector<Tensor>>> ScatterOutputs(
+    const std::vector<std::unique_ptr<Request>>& requests, const std::vector<Tensor>& outputs,
+    int64_t padded_batch_size) {
+  std::vector<std::vector<Tensor>> request_outputs(requests.size());
+  for (const auto& output : outputs) {
+    const auto& tensor = output.__internal_tensor();
+    const bool has_batch_dim =
+        tensor->shape()->NumAxes() > 0 && tensor->shape()->At(0) == padded_batch_size;
+    int64_t offset = 0;
+    for (size_t i = 0; i < requests.size(); ++i) {
+      const int64_t batch_size = requests.at(i)->batch_size;
+      std::shared_ptr<of::one::Tensor> request_output = tensor;
+      if (has_batch_dim) {
+        request_output = JUST(functional::Narrow(tensor, /*dim=*/0, offset, batch_size));
+      }
+      request_outputs.at(i).emplace_back(Tensor(JUST(functional::Clone(request_output))));
+      offset += batch_size;
+    }
+  }
+  return request_outputs;
+}
+
+}  // namespace
+
+class BatchingGraph::BatchingGraphImpl final {
+ public:
+  BatchingGraphImpl(const std::string& model_path, const Device& device,
+                    const BatchingOptions& options);
+  ~BatchingGraphImpl();
+
+  std::future<IValue> Submit(const IValue& inputs);
+
+ private:
+  void Warmup(int batch_size, Graph* graph);
+  void PollBatches();
+  void RunBatch(std::vector<std::unique_ptr<Request>>&& requests);
+  int max_batch_size() const { return batch_sizes_.back(); }
+
+  Device device_;
+  std::vector<int> batch_sizes_;
+  std::vector<Graph> graphs_;
+  std::chrono::microseconds max_queue_delay_;
+
+  std::mutex mutex_;
+  std::condition_variable cond_;
+  std::deque<std::unique_ptr<Request>> queue_;
+  int64_t queued_batch_size_ = 0;
+  bool is_stopped_ = false;
+  std::thread poller_;
+};
+
+BatchingGraph::BatchingGraphImpl::BatchingGraphImpl(const std::string& model_path,
+                                                    const Device& device,
+                                                    const BatchingOptions& options)
+    : device_(device),
+      batch_sizes_(options.batch_sizes),
+      max_queue_delay_(options.max_queue_delay_us) {
+  CHECK(!batch_sizes_.empty()) << "BatchingGraph requires at least one batch size";
+  std::sort(batch_sizes_.begin(), batch_sizes_.end());
+  batch_sizes_.erase(std::unique(batch_sizes_.begin(), batch_sizes_.end()), batch_sizes_.end());
+  CHECK_GT(batch_sizes_.front(), 0) << "The batch sizes of BatchingGraph should be positive";
+  graphs_.reserve(batch_sizes_.size());
+  for (int batch_size : batch_sizes_) {
+    // All the buckets share the weights
+    if (graphs_.empty()) {
+      graphs_.emplace_back(Graph::Load(model_path, device));
+    } else {
+      graphs_.emplace_back(graphs_.front().NewInstance());
+    }
+    graphs_.back().set_batch_size(batch_size);
+    // Compile in advance to avoid the latency spike of the first batches
+    Warmup(batch_size, &graphs_.back());
+  }
+  poller_ = std::thread([this]() { PollBatches(); });
+}
+
+BatchingGraph::BatchingGraphImpl::~BatchingGraphImpl() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    is_stopped_ = true;
+  }
+  cond_.notify_all();
+  poller_.join();
+}
+
+void BatchingGraph::BatchingGraphImpl::Warmup(int batch_size, Graph* graph) {
+  const auto& input_infos = graph->GetInputInfos();
+  std::vector<Tensor> inputs(input_infos.size());
+  for (const auto& input_info : input_infos) {
+    // NOTE: Shape shares the underlying data when copied, so build a new one
+    const Shape& info_shape = input_info.second.input_output_shape_;
+    std::vector<int64_t> dim_vec(info_shape.NumAxes());
+    for (int64_t i = 0; i < info_shape.NumAxes(); ++i) { dim_vec[i] = info_shape.At(i); }
+    dim_vec.at(0) = batch_size;
+    Tensor input(Shape(dim_vec), device_, input_info.second.datatype_);
+    input.zeros_();
+    inputs.at(input_info.second.input_output_index_) = input;
+  }
+  graph->Forward(inputs);
+}
+
+std::future<IValue> BatchingGraph::BatchingGraphImpl::Submit(const IValue& inputs) {
+  auto request = std::make_unique<Request>();
+  std::future<IValue> future = request->promise.get_future();
+  try {
+    request->inputs = ToTensorVector(inputs);
+    if (request->inputs.empty()) { throw std::invalid_argument("The inputs should not be empty"); }
+    for (const auto& input : request->inputs) {
+      const Shape shape = input.shape();
+      if (shape.NumAxes() == 0) {
+        throw std::invalid_argument("The inputs should have the batch dimension");
+      }
+      if (request->batch_size == 0) { request->batch_size = shape.At(0); }
+      if (shape.At(0) != request->batch_size || shape.At(0) <= 0) {
+        throw std::invalid_argument("The batch dimensions of the inputs should be the same");
+      }
+    }
+    if (request->batch_size > max_batch_size()) {
+      throw std::invalid_argument("The batch size " + std::to_string(request->batch_size)
+                                  + " of the request exceeds the maximum batch size "
+                                  + std::to_string(max_batch_size()));
+    }
+  } catch (...) {
+    request->promise.set_exception(std::current_exception());
+    return future;
+  }
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    request->enqueue_time = Clock::now();
+    queued_batch_size_ += request->batch_size;
+    queue_.emplace_back(std::move(request));
+  }
+  cond_.notify_all();
+  return future;
+}
+
+void BatchingGraph::BatchingGraphImpl::PollBatches() {
+  while (true) {
+    std::vector<std::unique_ptr<Request>> requests;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      cond_.wait(lock, [this]() { return !queue_.empty() || is_stopped_; });
+      if (queue_.empty()) { break; }
+      // Wait for more requests until the batch is full or the oldest request is out of time
+      const Clock::time_point deadline = queue_.front()->enqueue_time + max_queue_delay_;
+      cond_.wait_until(lock, deadline,
+                       [this]() { return queued_batch_size_ >= max_batch_size() || is_stopped_; });
+      int64_t batch_size = 0;
+      while (!queue_.empty() && batch_size + queue_.front()->batch_size <= max_batch_size()) {
+        batch_size += queue_.front()->batch_size;
+        requests.emplace_back(std::move(queue_.front()));
+        queue_.pop_front();
+      }
+      queued_batch_size_ -= batch_size;
+    }
+    RunBatch(std::move(requests));
+  }
+}
+
+void BatchingGraph::BatchingGraphImpl::RunBatch(std::vector<std::unique_ptr<Request>>&& requests) {
+  // The promises are fulfilled in order, the ones before num_fulfilled already have the outputs
+  size_t num_fulfilled = 0;
+  try {
+    of::LazyMode::Guard lazy_mode_disabled_guard(/*is_enabled*/ false);
+    int64_t batch_size = 0;
+    for (const auto& request : requests) { batch_size += request->batch_size; }
+    const size_t graph_index =
+        std::lower_bound(batch_sizes_.begin(), batch_sizes_.end(), batch_size)
+        - batch_sizes_.begin();
+    const int64_t padded_batch_size = batch_sizes_.at(graph_index);
+    const auto& inputs = GatherInputs(requests, batch_size, padded_batch_size).GetOrThrow();
+    std::vector<Tensor> outputs;
+    {
+      IValue value = graphs_.at(graph_index).Forward(inputs);
+      if (value.IsTensor()) {
+        outputs.emplace_back(value.ToTensor());
+      } else if (value.IsTensorVector()) {
+        outputs = value.ToTensorVector();
+      }
+    }
+    auto request_outputs = ScatterOutputs(requests, outputs, padded_batch_size).GetOrThrow();
+    for (; num_fulfilled < requests.size(); ++num_fulfilled) {
+      requests.at(num_fulfilled)
+          ->promise.set_value(ToIValue(std::move(request_outputs.at(num_fulfilled))));
+    }
+  } catch (...) {
+    for (size_t i = num_fulfilled; i < requests.size(); ++i) {
+      requests.at(i)->promise.set_exception(std::current_exception());
+    }
+  }
+}
+
+BatchingGraph::BatchingGraph(const std::string& model_path, const Device& device,
+                             const BatchingOptions& options)
+    : graph_(std::make_unique<BatchingGraphImpl>(model_path, device, options)) {}
+
+BatchingGraph::~BatchingGraph() = default;
+
+BatchingGraph::BatchingGraph(BatchingGraph&& graph) noexcept : graph_(std::move(graph.graph_)) {}
+
+BatchingGraph& BatchingGraph::operator=(BatchingGraph&& graph) noexcept {
+  if (&graph == this) { return *this; }
+  graph_ = std::move(graph.graph_);
+  return *this;
+}
+
+std::future<IValue> BatchingGraph::Submit(const IValue& inputs) { return graph_->Submit(inputs); }
+
+}  // namespace oneflow_api
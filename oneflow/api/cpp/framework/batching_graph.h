@@ -0,0 +1,66 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#ifndef ONEFLOW_API_CPP_FRAMEWORK_BATCHING_GRAPH_H_
+#define ONEFLOW_API_CPP_FRAMEWORK_BATCHING_GRAPH_H_
+
+#include <cstdint>
+#include <future>
+#include <memory>
+#include <string>
+#include <vector>
+#include "device.h"
+#include "ivalue.h"
+
+namespace oneflow_api {
+
+struct BatchingOptions {
+  // The batch sizes to compile the graph with. A batch of requests is padded to the smallest
+  // batch size which holds it.
+  std::vector<int> batch_sizes = {1, 2, 4, 8, 16, 32};
+  // The maximum time (in microseconds) the oldest request waits for other requests to fill a batch
+  int64_t max_queue_delay_us = 1000;
+};
+
+// BatchingGraph serves concurrent requests with a group of Graphs compiled with different batch
+// sizes. The requests are queued and coalesced along the first dimension of the inputs until the
+// largest batch size or the queue delay is reached, then the batch runs on the graph of the
+// smallest batch size holding it and the outputs are scattered back to the requests.
+class BatchingGraph {
+ public:
+  explicit BatchingGraph(const std::string& model_path, const Device& device = Device("cpu"),
+                         const BatchingOptions& options = BatchingOptions());
+  ~BatchingGraph();
+
+  BatchingGraph(const BatchingGraph& graph) = delete;
+  BatchingGraph(BatchingGraph&& graph) noexcept;
+
+  BatchingGraph& operator=(const BatchingGraph& graph) = delete;
+  BatchingGraph& operator=(BatchingGraph&& graph) noexcept;
+
+  // Thread safe. The inputs are a Tensor or vector(Tensor) whose first dimensions are the batch
+  // size of the request, the outputs are the same as Graph::Forward.
+  std::future<IValue> Submit(const IValue& inputs);
+  IValue Forward(const IValue& inputs) { return Submit(inputs).get(); }
+
+ private:
+  class BatchingGraphImpl;
+  std::unique_ptr<BatchingGraphImpl> graph_;
+};
+
+}  // namespace oneflow_api
+
+#endif  // ONEFLOW_API_CPP_FRAMEWORK_BATCHING_GRAPH_H_
@@ -13,6 +13,7 @@ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
 See the License for the specific language governing permissions and
 limitations under the License.
 */
+#include <future>
 #include "nlohmann/json.hpp"
 #include "oneflow/api/common/variable_tensor_mgr.h"
 #include "oneflow/api/cpp/env_impl.h"
@@ -27,6 +28,7 @@ limitations under the License.
 #include "oneflow/api/python/job_build/job_build_and_infer.h"
 #include "oneflow/core/common/data_type.pb.h"
 #include "oneflow/core/common/singleton.h"
+#include "oneflow/core/common/container_util.h"
 #include "oneflow/core/common/hash_container.h"
 #include "oneflow/core/common/just.h"
 #include "oneflow/core/common/shape.h"
@@ -34,11 +36,14 @@ limitations under the License.
 #include "oneflow/core/common/util.h"
 #include "oneflow/core/embedding/posix_file.h"
 #include "oneflow/core/eager/eager_blob_object.h"
+#include "oneflow/core/eager/local_dep_object.h"
+#include "oneflow/core/eager/tensor_storage.h"
 #include "oneflow/core/framework/device.h"
 #include "oneflow/core/framework/dtype.h"
 #include "oneflow/core/framework/multi_client_session_context.h"
 #include "oneflow/core/framework/nn_graph.h"
 #include "oneflow/core/framework/scope_util.h"
+#include "oneflow/core/framework/stream.h"
 #include "oneflow/core/framework/tensor.h"
 #include "oneflow/core/framework/tensor_tuple.h"
 #include "oneflow/core/framework/tensor_util.h"
@@ -134,13 +139,60 @@ void LoadOneEmbedding(const std::string& model_path, const Device& device) {
   }
 }
 
+// Creates a CPU tensor aliasing a private mapping of the variable file. The pages are read on the
+// first access, and copied on write so the file is never modified.
+of::Maybe<of::one::Tensor> MakeMappedVariableTensor(const std::string& filename,
+                                                   const of::Shape& shape, of::DataType data_type,
+                                                   of::Symbol<of::Device> device) {
+  CHECK_EQ_OR_RETURN(device->enum_type(), of::DeviceType::kCPU)
+      << "Only the variables on cpu could be mapped from the files";
+  const size_t size = shape.elem_cnt() * of::GetSizeOfDataType(data_type);
+  of::embedding::PosixFile file(filename, O_RDONLY, 0644);
+  CHECK_EQ_OR_RETURN(file.Size(), size)
+      << "The size of the variable file " << filename << " mismatches the variable";
+  auto mapped_file = std::make_shared<of::embedding::PosixMappedFile>(
+      std::move(file), size, PROT_READ | PROT_WRITE, MAP_PRIVATE);
+  char* dptr = static_cast<char*>(mapped_file->ptr());
+
+  auto tensor_data = std::make_shared<of::vm::TensorStorage>(false, device);
+  tensor_data->set_blob_dptr(
+      std::unique_ptr<char, std::function<void(char*)>>(dptr, [mapped_file](char*) {}), size);
+  auto tensor_storage = std::make_shared<of::one::TensorStorage>(tensor_data);
+  auto tensor_impl = std::make_shared<of::one::EagerLocalTensorImpl>(tensor_storage,
+                                                                     /*requires_grad=*/false,
+                                                                     /*is_leaf=*/true);
+  const auto tensor_meta = of::SymbolOf(
+      of::one::LocalTensorMeta(shape, data_type, of::MemoryFormat::kContiguous, device));
+  JUST(tensor_impl->InitEagerBlobObject(tensor_meta, of::NewLocalDepObject()));
+  const auto& stream = JUST(of::GetDefaultStreamByDevice(device));
+  const auto& eager_blob_object = JUST(tensor_impl->eager_blob_object());
+  JUST(eager_blob_object->init_producer_stream(stream));
+  eager_blob_object->set_last_used_stream(stream);
+  return std::static_pointer_cast<of::one::Tensor>(
+      std::make_shared<of::one::LocalTensor>(tensor_impl));
+}
+
 #endif  // __linux__
 
+std::string ReadVariableFile(const std::string& filename) {
+  std::ifstream variable_file(filename, std::ios::binary | std::ios::ate);
+  CHECK(variable_file.is_open()) << filename;
+  std::string buffer(variable_file.tellg(), '\0');
+  variable_file.seekg(0);
+  variable_file.read(&buffer[0], buffer.size());
+  CHECK(variable_file.good()) << filename;
+  return buffer;
+}
+
+using VariableTensorMap = of::HashMap<std::string, std::shared_ptr<of::one::Tensor>>;
+
 }  // namespace
 
 class Graph::GraphImpl final {
  public:
   explicit GraphImpl(const std::string& model_path, const Device& device = Device("cpu"));
+  // Creates another instance of the graph, which shares the variable tensors with it
+  explicit GraphImpl(const GraphImpl& graph, bool share_variables);
 
   GraphImpl(const GraphImpl& graph) = delete;
   GraphImpl(GraphImpl&& graph) = default;
@@ -154,6 +206,7 @@ class Graph::GraphImpl final {
   InputOutputInfos GetOutputInfos();
   std::vector<Tensor> Forward(const std::vector<Tensor>& inputs);
   void set_batch_size(int batch_size) { batch_size_ = batch_size; }
+  std::unique_ptr<GraphImpl> NewInstance() const;
 
   of::Maybe<void> RegisterJobPass(
       const std::function<std::string(const std::string& job)>& pass_fn);
@@ -164,7 +217,7 @@ class Graph::GraphImpl final {
   of::Maybe<std::vector<Tensor>> Run(const std::vector<Tensor>& inputs) const;
   of::Maybe<void> AddOp(of::OperatorConf op_conf);
   of::Maybe<void> BuildGraph();
-  of::Maybe<void> LoadCheckpoint();
+  of::Maybe<void> LoadCheckpoint(const std::vector<of::OperatorConf>& variable_op_confs);
   of::Maybe<void> RegisterTensors(const std::vector<Tensor>& inputs);
   of::Maybe<of::Job> ApplyJobPasses(const of::Job& job);
 
@@ -174,11 +227,13 @@ class Graph::GraphImpl final {
   int batch_size_ = 0;
   Device device_;
   of::Job job_;
+  std::string job_name_;
 
   InputOutputInfos input_infos_;
   InputOutputInfos output_infos_;
   of::HashMap<std::string, std::shared_ptr<of::one::Tensor>> output_name_to_tensor_;
-  of::HashMap<std::string, std::shared_ptr<of::one::Tensor>> variable_op_name_to_tensor_;
+  // Shared by all the instances of the graph, and filled by the first compiled one
+  std::shared_ptr<VariableTensorMap> variable_op_name_to_tensor_;
   std::shared_ptr<of::one::TensorTuple> output_tensor_tuple_;
   std::shared_ptr<of::one::TensorTuple> parameter_tensor_tuple_;
   std::vector<std::function<std::string(const std::string&)>> registered_job_passes_;
@@ -229,6 +284,10 @@ IValue Graph::Forward(const IValue& inputs) {
 
 void Graph::set_batch_size(int batch_size) { graph_->set_batch_size(batch_size); }
 
+Graph Graph::NewInstance() const { return Graph(graph_->NewInstance()); }
+
+Graph::Graph(std::unique_ptr<GraphImpl>&& graph) : graph_(std::move(graph)) {}
+
 Graph Graph::Load(const std::string& model_path, const Device& device) {
 #ifdef __linux__
   LoadOneEmbedding(model_path, device);
@@ -238,12 +297,34 @@ Graph Graph::Load(const std::string& model_path, const Device& device) {
 }
 
 Graph::GraphImpl::GraphImpl(const std::string& model_path, const Device& device)
-    : model_path_(model_path), device_(device) {
+    : model_path_(model_path),
+      device_(device),
+      variable_op_name_to_tensor_(std::make_shared<VariableTensorMap>()) {
   CHECK_JUST(of::LoadJobFromIR(&job_, model_path + "/model.mlir"));
   CollectInputOutputInfos();
   if (of::ParseBooleanFromEnv("ONEFLOW_SERVING_DEBUG", false)) { LOG(ERROR) << job_.DebugString(); }
   job_.mutable_job_conf()->mutable_predict_conf();
-  job_.mutable_job_conf()->set_job_name(job_.mutable_job_conf()->job_name() + of::NewUniqueId());
+  job_name_ = job_.job_conf().job_name();
+  job_.mutable_job_conf()->set_job_name(job_name_ + of::NewUniqueId());
+}
+
+Graph::GraphImpl::GraphImpl(const GraphImpl& graph, bool share_variables)
+    : model_path_(graph.model_path_),
+      batch_size_(graph.batch_size_),
+      device_(graph.device_),
+      job_(graph.job_),
+      job_name_(graph.job_name_),
+      input_infos_(graph.input_infos_),
+      output_infos_(graph.output_infos_),
+      variable_op_name_to_tensor_(share_variables ? graph.variable_op_name_to_tensor_
+                                                  : std::make_shared<VariableTensorMap>()),
+      registered_job_passes_(graph.registered_job_passes_) {
+  // Each instance compiles its own plan, so that it has its own activation and output memory
+  job_.mutable_job_conf()->set_job_name(job_name_ + of::NewUniqueId());
+}
+
+std::unique_ptr<Graph::GraphImpl> Graph::GraphImpl::NewInstance() const {
+  return std::make_unique<GraphImpl>(*this, /*share_variables=*/true);
 }
 
 InputOutputInfos Graph::GraphImpl::GetInputInfos() { return input_infos_; }
@@ -342,23 +423,20 @@ of::Maybe<void> Graph::GraphImpl::AddOp(of::OperatorConf op_conf) {
 
 of::Maybe<void> Graph::GraphImpl::BuildGraph() {
   CompileScope build_graph_scope(job_.job_conf(), *device_.device_->shared_from_symbol());
+  std::vector<of::OperatorConf> new_variable_op_confs;
   {
     const of::OpGraph op_graph(job_);
     op_graph.TopoForEachNode([&](const of::OpNode* node) -> of::Maybe<void> {
       const of::OperatorConf& op_conf = node->op().op_conf();
       JUST(AddOp(op_conf));
-      if (op_conf.has_variable_conf()) {
-        const of::LazyMode::Guard lazy_mode_disabled_guard{false};
-        const of::VariableOpConf& variable_conf = op_conf.variable_conf();
-        variable_op_name_to_tensor_[op_conf.name()] = JUST(of::one::functional::Empty(
-            of::Shape(variable_conf.shape()),
-            JUST(of::DType::Get(static_cast<of::DataType>(variable_conf.data_type()))),
-            *device_.device_, /*requires_grad=*/false, /*pin_memory=*/false));
+      // The variables loaded by another instance are reused
+      if (op_conf.has_variable_conf() && variable_op_name_to_tensor_->count(op_conf.name()) == 0) {
+        new_variable_op_confs.emplace_back(op_conf);
       }
       return of::Maybe<void>::Ok();
     });
   }
-  JUST(LoadCheckpoint());
+  JUST(LoadCheckpoint(new_variable_op_confs));
   JUST(of::CurJobBuildAndInferCtx_Complete());
   std::shared_ptr<of::Job> complete_job = JUST(of::GetCurrentJob());
   int64_t job_id = JUST(of::JobBuildAndInferCtx_GetCurrentJobId());
@@ -392,28 +470,53 @@ of::Maybe<void> Graph::GraphImpl::BuildGraph() {
   return of::Maybe<void>::Ok();
 }
 
-of::Maybe<void> Graph::GraphImpl::LoadCheckpoint() {
-  for (const auto& variable_op_name_and_tensor : variable_op_name_to_tensor_) {
-    const auto& variable_op_name = variable_op_name_and_tensor.first;
-    const auto& variable_tensor = variable_op_name_and_tensor.second;
-    const std::string variable_filename = model_path_ + "/" + variable_op_name + "/out";
-    const std::string buffer = [&]() {
-      std::ifstream variable_file(variable_filename, std::ios::binary);
-      CHECK(variable_file.is_open());
-      std::stringstream ss;
-      ss << variable_file.rdbuf();
-      return ss.str();
-    }();
+of::Maybe<void> Graph::GraphImpl::LoadCheckpoint(
+    const std::vector<of::OperatorConf>& variable_op_confs) {
+  const of::LazyMode::Guard lazy_mode_disabled_guard{false};
+  const auto& VariableFilename = [&](size_t i) {
+    return model_path_ + "/" + variable_op_confs.at(i).name() + "/out";
+  };
+  // The cpu variables alias the mapped files directly, which saves the reading and copying before
+  // the first inference and keeps only one copy of the weights in memory.
+  const bool mmap_checkpoint = device_.type() == "cpu"
+                               && of::ParseBooleanFromEnv("ONEFLOW_SERVING_MMAP_CHECKPOINT", true);
+  // Otherwise the next variable file is read while the current one is copied to the device
+  std::future<std::string> next_buffer;
+  for (size_t i = 0; i < variable_op_confs.size(); ++i) {
+    const of::VariableOpConf& variable_conf = variable_op_confs.at(i).variable_conf();
+    const of::Shape shape(variable_conf.shape());
+    const auto data_type = static_cast<of::DataType>(variable_conf.data_type());
+    std::shared_ptr<of::one::Tensor> variable_tensor;
+#ifdef __linux__
+    if (mmap_checkpoint && shape.elem_cnt() > 0) {
+      variable_tensor =
+          JUST(MakeMappedVariableTensor(VariableFilename(i), shape, data_type, *device_.device_));
+      (*variable_op_name_to_tensor_)[variable_op_confs.at(i).name()] = variable_tensor;
+      continue;
+    }
+#endif  // __linux__
+    variable_tensor = JUST(of::one::functional::Empty(shape, JUST(of::DType::Get(data_type)),
+                                                      *device_.device_, /*requires_grad=*/false,
+                                                      /*pin_memory=*/false));
+    if (!next_buffer.valid()) {
+      next_buffer = std::async(std::launch::async, ReadVariableFile, VariableFilename(i));
+    }
+    const std::string buffer = next_buffer.get();
+    if (!mmap_checkpoint && i + 1 < variable_op_confs.size()) {
+      next_buffer = std::async(std::launch::async, ReadVariableFile, VariableFilename(i + 1));
+    }
+    const size_t size = shape.elem_cnt() * of::GetSizeOfDataType(data_type);
+    CHECK_EQ_OR_RETURN(buffer.size(), size)
+        << "The size of the variable file " << VariableFilename(i) << " mismatches the variable";
     const auto& callback = [&](of::ep::Stream* stream,
                                const std::shared_ptr<of::vm::EagerBlobObject>& eager_blob_object) {
-      of::AutoMemcpy(stream, eager_blob_object->mut_dptr(), buffer.data(),
-                     variable_tensor->shape()->elem_cnt()
-                         * of::GetSizeOfDataType(variable_tensor->dtype()->data_type()),
+      of::AutoMemcpy(stream, eager_blob_object->mut_dptr(), buffer.data(), size,
                      eager_blob_object->mem_case(), of::memory::MakeHostMemCase());
     };
     JUST(of::one::SyncAccessTensorWithTimeOut(variable_tensor, callback, "mut"));
+    (*variable_op_name_to_tensor_)[variable_op_confs.at(i).name()] = variable_tensor;
   }
-  const auto& pair = Unzip(variable_op_name_to_tensor_);
+  const auto& pair = Unzip(*variable_op_name_to_tensor_);
   JUST(of::FillVariableTensorMgr(pair.first, pair.second));
   return of::Maybe<void>::Ok();
 }
@@ -65,12 +65,19 @@ class Graph {
   IValue Forward(const IValue& inputs);
   void set_batch_size(int batch_size);
 
+  // Creates another executable instance of the model. The instances share the variable tensors,
+  // and each of them has its own plan, activation memory and outputs, so they can run
+  // concurrently at the memory cost of one copy of the weights. The batch size and the job passes
+  // registered so far are inherited.
+  Graph NewInstance() const;
+
   void RegisterJobPass(const std::function<std::string(const std::string& job)>& pass_fn);
 
   static Graph Load(const std::string& model_path, const Device& device = Device("cpu"));
 
  private:
   class GraphImpl;
+  explicit Graph(std::unique_ptr<GraphImpl>&& graph);
   std::unique_ptr<GraphImpl> graph_;
 };
 
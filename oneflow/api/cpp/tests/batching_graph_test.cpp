@@ -0,0 +1,146 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include <gtest/gtest.h>
+#include <cstdint>
+#include <future>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "oneflow/api/cpp/framework.h"
+#include "oneflow/api/cpp/tests/api_test.h"
+
+namespace oneflow_api {
+
+namespace {
+
+const char* const kModelPath = "./oneflow/api/cpp/tests/graph_test_model/affine_with_parameter";
+
+// The model computes x * a + b, a is a 3x4 matrix of ones and b is a vector of ones, so every
+// element of the output is 3 * value + 1 when every element of the input is value.
+Tensor MakeInput(const Device& device, int64_t batch_size, float value) {
+  std::vector<float> data(batch_size * 3, value);
+  return Tensor::from_buffer(data.data(), Shape({batch_size, 3}), device, DType::kFloat);
+}
+
+void CheckOutput(const IValue& value, int64_t batch_size, float value_of_input) {
+  ASSERT_TRUE(value.IsTensor());
+  Tensor output = value.ToTensor();
+  ASSERT_EQ(output.shape().At(0), batch_size);
+  ASSERT_EQ(output.shape().At(1), 4);
+  std::vector<float> buf(batch_size * 4);
+  output.copy_to(buf.data());
+  for (const float& element : buf) { ASSERT_EQ(element, 3 * value_of_input + 1); }
+}
+
+}  // namespace
+
+TEST(Api, batching_graph_cpu_test) {
+  EnvScope scope;
+  Device device("cpu");
+  BatchingOptions options;
+  options.batch_sizes = {1, 4, 8};
+  options.max_queue_delay_us = 5000;
+  BatchingGraph graph(kModelPath, device, options);
+
+  const std::vector<int64_t> request_batch_sizes{1, 2, 3, 1, 5, 8, 2, 1, 4, 7};
+  std::vector<std::future<IValue>> futures;
+  for (size_t i = 0; i < request_batch_sizes.size(); ++i) {
+    futures.emplace_back(graph.Submit(MakeInput(device, request_batch_sizes[i], i)));
+  }
+  for (size_t i = 0; i < request_batch_sizes.size(); ++i) {
+    CheckOutput(futures[i].get(), request_batch_sizes[i], i);
+  }
+  CheckOutput(graph.Forward(MakeInput(device, 3, 1)), 3, 1);
+}
+
+TEST(Api, batching_graph_invalid_request_test) {
+  EnvScope scope;
+  Device device("cpu");
+  BatchingOptions options;
+  options.batch_sizes = {1, 2};
+  BatchingGraph graph(kModelPath, device, options);
+  auto future = graph.Submit(MakeInput(device, 4, 1));
+  ASSERT_ANY_THROW(future.get());
+  CheckOutput(graph.Forward(MakeInput(device, 2, 1)), 2, 1);
+}
+
+// Several clients submit requests concurrently so that they are merged into batches, every row of
+// the batched outputs must equal the output of the row run alone.
+TEST(Api, batching_graph_cpu_concurrent_test) {
+  EnvScope scope;
+  Device device("cpu");
+  constexpr int kClientNum = 4;
+  constexpr int kRequestNumPerClient = 8;
+  BatchingOptions options;
+  options.batch_sizes = {1, 2, 4};
+  options.max_queue_delay_us = 5000;
+  BatchingGraph graph(kModelPath, device, options);
+
+  const auto GetValue = [](int client, int request, int64_t row) -> float {
+    return client * 100 + request * 10 + row;
+  };
+  const auto GetBatchSize = [](int client, int request) -> int64_t {
+    return (client + request) % 3 + 1;
+  };
+  std::vector<std::vector<float>> per_sample_outputs;
+  for (int c = 0; c < kClientNum; ++c) {
+    for (int i = 0; i < kRequestNumPerClient; ++i) {
+      for (int64_t row = 0; row < GetBatchSize(c, i); ++row) {
+        Tensor output = graph.Forward(MakeInput(device, 1, GetValue(c, i, row))).ToTensor();
+        std::vector<float> buf(4);
+        output.copy_to(buf.data());
+        per_sample_outputs.emplace_back(std::move(buf));
+      }
+    }
+  }
+
+  std::vector<std::vector<std::vector<float>>> batched_outputs(kClientNum);
+  std::vector<std::thread> clients;
+  for (int c = 0; c < kClientNum; ++c) {
+    clients.emplace_back([&, c]() {
+      for (int i = 0; i < kRequestNumPerClient; ++i) {
+        const int64_t batch_size = GetBatchSize(c, i);
+        std::vector<float> data;
+        for (int64_t row = 0; row < batch_size; ++row) {
+          data.insert(data.end(), 3, GetValue(c, i, row));
+        }
+        Tensor input = Tensor::from_buffer(data.data(), Shape({batch_size, 3}), device,
+                                           DType::kFloat);
+        Tensor output = graph.Submit(input).get().ToTensor();
+        std::vector<float> buf(output.shape().elem_cnt());
+        output.copy_to(buf.data());
+        batched_outputs[c].emplace_back(std::move(buf));
+      }
+    });
+  }
+  for (auto& client : clients) { client.join(); }
+
+  size_t sample_idx = 0;
+  for (int c = 0; c < kClientNum; ++c) {
+    ASSERT_EQ(batched_outputs[c].size(), static_cast<size_t>(kRequestNumPerClient));
+    for (int i = 0; i < kRequestNumPerClient; ++i) {
+      const std::vector<float>& output = batched_outputs[c][i];
+      ASSERT_EQ(output.size(), static_cast<size_t>(GetBatchSize(c, i) * 4));
+      for (int64_t row = 0; row < GetBatchSize(c, i); ++row) {
+        const std::vector<float>& expected = per_sample_outputs.at(sample_idx++);
+        for (int k = 0; k < 4; ++k) { ASSERT_EQ(output[row * 4 + k], expected[k]); }
+      }
+    }
+  }
+}
+
+}  // namespace oneflow_api
@@ -159,6 +159,28 @@ TEST(Api, graph_thread_test) {
   for (auto& thread : threads) { thread.join(); }
 }
 
+TEST(Api, graph_new_instance_thread_test) {
+  EnvScope scope;
+
+  Device device("cpu");
+  Graph graph = LoadGraph(device);
+  std::vector<Graph> graphs;
+  // The instances created before and after the compilation both share the weights
+  for (int i = 0; i < 5; i++) { graphs.emplace_back(graph.NewInstance()); }
+  Forward(graph, device, 1);
+  for (int i = 0; i < 5; i++) { graphs.emplace_back(graph.NewInstance()); }
+
+  std::vector<std::thread> threads;
+  for (Graph& instance : graphs) {
+    threads.emplace_back(std::thread(std::bind(Forward, std::move(instance), device, 1)));
+  }
+  for (auto& thread : threads) { thread.join(); }
+
+  Graph batching_instance = graph.NewInstance();
+  batching_instance.set_batch_size(10);
+  Forward(batching_instance, device, 10);
+}
+
 TEST(Api, graph_input_order_test) {
   EnvScope scope;
 
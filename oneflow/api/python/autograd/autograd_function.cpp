@@ -73,6 +73,9 @@ py::object PackTensorTuple(const one::TensorTuple& tp) {
 one::AutogradFunctionBase::FType PackPyFunctionToFType(const py::function& func) {
   return [func](const std::shared_ptr<one::FunctionAutoGradCaptureState>& ctx,
                 const one::TensorTuple& inputs) {
+    // The backward may run on the workers of the parallel autograd engine with the GIL released,
+    // so it is acquired here and held until all the python objects are destroyed
+    py::gil_scoped_acquire acquire;
     const py::tuple& a = py::cast(inputs);
     py::object res = func(ctx, *a);
     return UnpackTensorTuple(res).GetPtrOrThrow();
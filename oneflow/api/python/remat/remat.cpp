@@ -78,6 +78,14 @@ ONEFLOW_API_PYBIND11_MODULE("remat", m) {
         []() { return Singleton<remat::Env>::Get()->forced_eviction_num(); });
   m.def("eager_eviction_num", []() { return Singleton<remat::Env>::Get()->eager_eviction_num(); });
   m.def("recomputation_num", []() { return Singleton<remat::Env>::Get()->recomputation_num(); });
+  m.def("recomputation_time",
+        []() { return Singleton<remat::Env>::Get()->recomputation_time(); });
+  m.def("recomputation_bytes",
+        []() { return Singleton<remat::Env>::Get()->recomputation_bytes(); });
+  m.def("eviction_search_num",
+        []() { return Singleton<remat::Env>::Get()->eviction_search_num(); });
+  m.def("eviction_search_time",
+        []() { return Singleton<remat::Env>::Get()->eviction_search_time(); });
   m.def("set_budget_in_bytes", [](size_t budget_in_bytes) {
     Singleton<remat::Env>::Get()->set_budget_in_bytes(budget_in_bytes);
   });
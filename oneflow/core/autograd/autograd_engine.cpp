@@ -14,7 +14,10 @@ See the License for the specific language governing permissions and
 limitations under the License.
 */
 
+#include <condition_variable>
+#include <deque>
 #include <memory>
+#include <mutex>
 #include <stack>
 #include <queue>
 #include "fmt/core.h"
@@ -24,6 +27,7 @@ limitations under the License.
 #include "oneflow/core/autograd/autograd_mode.h"
 #include "oneflow/core/common/container_util.h"
 #include "oneflow/core/common/error.h"
+#include "oneflow/core/framework/autocast.h"
 #include "oneflow/core/framework/tensor.h"
 #include "oneflow/core/framework/tensor_arg.h"
 #include "oneflow/core/framework/tensor_methods.h"
@@ -36,7 +40,12 @@ limitations under the License.
 #include "oneflow/core/job/lazy_mode.h"
 #include "oneflow/core/profiler/profiler.h"
 #include "oneflow/core/common/env_var/debug_mode.h"
+#include "oneflow/core/common/env_var/eager.h"
+#include "oneflow/core/common/blocking_counter.h"
+#include "oneflow/core/common/foreign_lock_helper.h"
+#include "oneflow/core/common/singleton.h"
 #include "oneflow/core/persistence/tee_persistent_log_stream.h"
+#include "oneflow/core/thread/thread_pool.h"
 
 namespace oneflow {
 namespace one {
@@ -119,6 +128,86 @@ Maybe<void> CheckGlobalTensorsMeta(const TensorTuple& tensor_tuple) {
   return Maybe<void>::Ok();
 }
 
+// The worker threads are shared by all the backward passes and live until the process exits
+ThreadPool* GetBackwardThreadPool(int64_t worker_num) {
+  static std::mutex mutex;
+  static auto* worker_num2thread_pool = new HashMap<int64_t, std::unique_ptr<ThreadPool>>();
+  std::unique_lock<std::mutex> lock(mutex);
+  auto& thread_pool = (*worker_num2thread_pool)[worker_num];
+  if (!thread_pool) { thread_pool.reset(new ThreadPool(worker_num)); }
+  return thread_pool.get();
+}
+
+// Whether the current thread is running the FunctionNodes of a parallel backward. A backward
+// started from such a thread, e.g. the double backward in a custom Function, runs sequentially on
+// it instead of waiting for the workers of the pool it is occupying.
+bool* MutIsInParallelBackward() {
+  static thread_local bool is_in_parallel_backward = false;
+  return &is_in_parallel_backward;
+}
+
+class ParallelBackwardGuard final {
+ public:
+  ParallelBackwardGuard() : prev_value_(*MutIsInParallelBackward()) {
+    *MutIsInParallelBackward() = true;
+  }
+  ~ParallelBackwardGuard() { *MutIsInParallelBackward() = prev_value_; }
+
+ private:
+  bool prev_value_;
+};
+
+// The thread local states which the backward ops depend on. The workers run the FunctionNodes with
+// the states of the thread that starts the backward, and restore their own ones afterwards since
+// the workers are reused.
+class BackwardThreadLocalStates final {
+ public:
+  BackwardThreadLocalStates()
+      : grad_mode_(autograd::GradMode::is_enabled()),
+        global_grad_sync_mode_(GlobalGradSyncMode::is_enabled()),
+        autocast_enabled_(autocast::is_enabled()),
+        autocast_device_type_(autocast::get_autocast_device_type()),
+        autocast_dtype_(autocast::get_autocast_dtype()),
+        autocast_cpu_dtype_(autocast::get_autocast_cpu_dtype()),
+        autocast_gpu_dtype_(autocast::get_autocast_gpu_dtype()),
+        autocast_cache_enabled_(autocast::is_autocast_cache_enabled()) {}
+
+  void SetToCurrentThread() const {
+    autograd::GradMode::set_enabled(grad_mode_);
+    GlobalGradSyncMode::set_enabled(global_grad_sync_mode_);
+    autocast::set_enabled(autocast_enabled_);
+    autocast::set_autocast_device_type(autocast_device_type_);
+    autocast::set_autocast_dtype(autocast_dtype_);
+    autocast::set_autocast_cpu_dtype(autocast_cpu_dtype_);
+    autocast::set_autocast_gpu_dtype(autocast_gpu_dtype_);
+    autocast::set_autocast_cache_enabled(autocast_cache_enabled_);
+  }
+
+ private:
+  bool grad_mode_;
+  bool global_grad_sync_mode_;
+  bool autocast_enabled_;
+  DeviceType autocast_device_type_;
+  Symbol<DType> autocast_dtype_;
+  Symbol<DType> autocast_cpu_dtype_;
+  Symbol<DType> autocast_gpu_dtype_;
+  bool autocast_cache_enabled_;
+};
+
+class BackwardThreadLocalStatesGuard final {
+ public:
+  explicit BackwardThreadLocalStatesGuard(const BackwardThreadLocalStates& states) {
+    states.SetToCurrentThread();
+    // Only the cast cache of the calling thread is cleared when autocast exits, so the workers do
+    // not cache the casts
+    autocast::set_autocast_cache_enabled(false);
+  }
+  ~BackwardThreadLocalStatesGuard() { prev_states_.SetToCurrentThread(); }
+
+ private:
+  BackwardThreadLocalStates prev_states_;
+};
+
 std::string GetDebugGraphFileName(const std::string& mode, const std::string& suffix) {
   return fmt::format("autograd_{}_rank{}_suffix_graph.dot", mode, GlobalProcessCtx::Rank(), suffix);
 }
@@ -414,35 +503,60 @@ Maybe<void> GraphTask::ComputeDependenciesAndPruneNode(const TensorTuple& inputs
   return Maybe<void>::Ok();
 }
 
+Maybe<void> GraphTask::ApplyNode(FunctionNode* node, bool save_grad_for_leaf, bool* applied) {
+  *applied = false;
+  auto& exec_info = grad_fn2exec_info_.at(node);
+  if (!exec_info.need_execute) {
+    node->ReleaseOutTensorArgs();
+    return Maybe<void>::Ok();
+  }
+  BackwardPassScopeGuard backward_guard(node->scope());
+  if (/*bool not_ready_to_apply=*/!(JUST(node->Apply(create_graph_)))) {
+    return Maybe<void>::Ok();
+  }
+  if (exec_info.capture_indices) {
+    CHECK_NOTNULL_OR_RETURN(captured_grads_.get()) << "captured grads in GraphTask is nullptr";
+    for (const auto& out_idx_and_capture_idx : *exec_info.capture_indices) {
+      JUST(VectorAt(*captured_grads_, out_idx_and_capture_idx.second)) =
+          JUST(JUST(VectorAt(node->output_meta_data_, out_idx_and_capture_idx.first))
+                   ->current_grad_value());
+    }
+  }
+  if (save_grad_for_leaf) { JUST(node->AccGrad4LeafTensor(create_graph_)); }
+  JUST(node->AccGrad4RetainGradTensor(create_graph_));
+  node->ReleaseOutTensorArgs();
+  if (!retain_graph_) { node->ReleaseData(); }
+  *applied = true;
+  return Maybe<void>::Ok();
+}
+
+bool GraphTask::CanApplyInParallel() const {
+  if (LazyMode::is_enabled()) { return false; }
+  for (const auto& pair : grad_fn2exec_info_) {
+    for (const auto& tensor_info : pair.first->output_tensor_infos_) {
+      if (tensor_info.placement().has_value()) { return false; }
+    }
+  }
+  return true;
+}
+
 Maybe<void> GraphTask::Apply(bool save_grad_for_leaf) {
   std::queue<FunctionNode*> queue;
   for (FunctionNode* node : roots_) {
     if (grad_fn2exec_info_[node].dependencies == 0) { queue.push(node); }
   }
+  const int64_t thread_num = EnvInteger<ONEFLOW_EAGER_BACKWARD_THREAD_NUM>();
+  if (thread_num > 1 && grad_fn2exec_info_.size() > 1 && !*MutIsInParallelBackward()
+      && CanApplyInParallel()) {
+    return ParallelApply(save_grad_for_leaf, thread_num);
+  }
 
   while (!queue.empty()) {
     FunctionNode* node = queue.front();
     queue.pop();
-    auto& exec_info = grad_fn2exec_info_[node];
-
-    if (!exec_info.need_execute) {
-      node->ReleaseOutTensorArgs();
-      continue;
-    }
-    BackwardPassScopeGuard backward_guard(node->scope());
-    if (/*bool not_ready_to_apply=*/!(JUST(node->Apply(create_graph_)))) { continue; }
-    if (exec_info.capture_indices) {
-      CHECK_NOTNULL_OR_RETURN(captured_grads_.get()) << "captured grads in GraphTask is nullptr";
-      for (const auto& out_idx_and_capture_idx : *exec_info.capture_indices) {
-        JUST(VectorAt(*captured_grads_, out_idx_and_capture_idx.second)) =
-            JUST(JUST(VectorAt(node->output_meta_data_, out_idx_and_capture_idx.first))
-                     ->current_grad_value());
-      }
-    }
-    if (save_grad_for_leaf) { JUST(node->AccGrad4LeafTensor(create_graph_)); }
-    JUST(node->AccGrad4RetainGradTensor(create_graph_));
-    node->ReleaseOutTensorArgs();
-    if (!retain_graph_) { node->ReleaseData(); }
+    bool applied = false;
+    JUST(ApplyNode(node, save_grad_for_leaf, &applied));
+    if (!applied) { continue; }
 
     for (const auto& next_grad_fn : node->next_functions()) {
       FunctionNode* next_node = std::get<0>(next_grad_fn).get();
@@ -454,6 +568,84 @@ Maybe<void> GraphTask::Apply(bool save_grad_for_leaf) {
   return Maybe<void>::Ok();
 }
 
+// The FunctionNodes whose dependencies are all done are put into a ready queue, and the calling
+// thread together with thread_num - 1 workers pop and run them. The dispatch of the backward ops
+// and the accumulation of the partial grads run concurrently, while the bookkeeping of the
+// dependencies is protected by a mutex.
+Maybe<void> GraphTask::ParallelApply(bool save_grad_for_leaf, int64_t thread_num) {
+  std::mutex mutex;
+  std::condition_variable cond;
+  std::deque<FunctionNode*> ready_nodes;
+  int64_t running_num = 0;
+  std::shared_ptr<StackedError> error;
+  HashSet<FunctionNode*> ready_roots;
+  for (FunctionNode* node : roots_) {
+    // The same FunctionNode can not run on two threads even if it is the grad_fn of two outputs
+    if (grad_fn2exec_info_.at(node).dependencies == 0 && ready_roots.insert(node).second) {
+      ready_nodes.push_back(node);
+    }
+  }
+  const auto TryApplyNode = [&](FunctionNode* node, bool* applied) -> Maybe<void> {
+    try {
+      return ApplyNode(node, save_grad_for_leaf, applied);
+    } catch (const std::exception& e) {
+      return Error::RuntimeError() << e.what();
+    }
+  };
+  const auto RunReadyNodes = [&]() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+      cond.wait(lock, [&]() { return !ready_nodes.empty() || running_num == 0 || error; });
+      if (ready_nodes.empty() || error) { break; }
+      FunctionNode* node = ready_nodes.front();
+      ready_nodes.pop_front();
+      running_num += 1;
+      lock.unlock();
+      bool applied = false;
+      const auto& maybe_ok = TryApplyNode(node, &applied);
+      lock.lock();
+      running_num -= 1;
+      if (!maybe_ok.IsOk()) {
+        if (!error) { error = maybe_ok.stacked_error(); }
+      } else if (applied) {
+        for (const auto& next_grad_fn : node->next_functions()) {
+          FunctionNode* next_node = std::get<0>(next_grad_fn).get();
+          int32_t& dependencies = grad_fn2exec_info_.at(next_node).dependencies;
+          dependencies -= 1;
+          if (dependencies == 0) { ready_nodes.push_back(next_node); }
+        }
+      }
+      cond.notify_all();
+    }
+  };
+  const int64_t worker_num = thread_num - 1;
+  const BackwardThreadLocalStates thread_local_states;
+  // The GIL is released only when the workers are used, so that the python hooks and the python
+  // autograd functions could run on them.
+  JUST(Singleton<ForeignLockHelper>::Get()->WithScopedRelease([&]() -> Maybe<void> {
+    BlockingCounter blocking_counter(worker_num);
+    ThreadPool* thread_pool = GetBackwardThreadPool(worker_num);
+    for (int64_t i = 0; i < worker_num; ++i) {
+      thread_pool->AddWork([&]() {
+        {
+          BackwardThreadLocalStatesGuard states_guard(thread_local_states);
+          ParallelBackwardGuard parallel_guard;
+          RunReadyNodes();
+        }
+        blocking_counter.Decrease();
+      });
+    }
+    {
+      ParallelBackwardGuard parallel_guard;
+      RunReadyNodes();
+    }
+    blocking_counter.WaitForeverUntilCntEqualZero();
+    return Maybe<void>::Ok();
+  }));
+  if (error) { return error; }
+  return Maybe<void>::Ok();
+}
+
 Maybe<void> GraphAutogradEngine::RunBackwardAndSaveGrads4LeafTensor(const TensorTuple& outputs,
                                                                     const TensorTuple& out_grads,
                                                                     bool retain_graph,
@@ -512,6 +704,8 @@ Maybe<FunctionNode> GraphAutogradEngine::AddNode(
   return func_node;
 }
 
+bool IsInParallelBackward() { return *MutIsInParallelBackward(); }
+
 AutogradEngine* GetThreadLocalAutogradEngine() {
   thread_local static GraphAutogradEngine autograd_engine;
   return &autograd_engine;
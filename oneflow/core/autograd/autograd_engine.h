@@ -156,6 +156,14 @@ class GraphTask final {
   Maybe<void> WriteGraphToDotFile(const std::string& file_name) const;
 
  private:
+  // Runs one FunctionNode whose dependencies are all done, `applied` is false if the FunctionNode
+  // is skipped and its next functions should not be scheduled.
+  Maybe<void> ApplyNode(FunctionNode* node, bool save_grad_for_leaf, bool* applied);
+  // The independent FunctionNodes could be dispatched concurrently only in eager local mode,
+  // because the global tensors require the same dispatch order on all ranks.
+  bool CanApplyInParallel() const;
+  Maybe<void> ParallelApply(bool save_grad_for_leaf, int64_t thread_num);
+
   class ExecInfo {
    public:
     ExecInfo() = default;
@@ -198,6 +206,9 @@ class GraphAutogradEngine final : public AutogradEngine {
 
 AutogradEngine* GetThreadLocalAutogradEngine();
 
+// Whether the current thread is running the FunctionNodes of a parallel backward.
+bool IsInParallelBackward();
+
 Maybe<void> AddAccumulateFunctionNode(const std::shared_ptr<Tensor>& tensor);
 
 }  // namespace one
@@ -80,5 +80,102 @@ Maybe<void> Embedding::Apply(const EmbeddingCaptureState* ctx, const TensorTuple
 
 REGISTER_OP_EXPR_GRAD_FUNCTION("embedding", Embedding);
 
+struct EmbeddingBagCaptureState : public AutoGradCaptureState {
+  std::string mode;
+  int64_t padding_idx = -1;
+  bool has_per_sample_weights = false;
+  bool weight_requires_grad = false;
+  bool per_sample_weights_requires_grad = false;
+};
+
+class EmbeddingBag : public OpExprGradFunction<EmbeddingBagCaptureState> {
+ public:
+  Maybe<void> Init(const OpExpr& op) override;
+  Maybe<void> Capture(EmbeddingBagCaptureState* ctx, const TensorTuple& inputs,
+                      const TensorTuple& outputs, const AttrMap& attrs) const override;
+  Maybe<void> Apply(const EmbeddingBagCaptureState* ctx, const TensorTuple& out_grads,
+                    TensorTuple* in_grads) const override;
+
+ private:
+  AttrMap base_attrs_;
+};
+
+Maybe<void> EmbeddingBag::Init(const OpExpr& op) {
+  const UserOpExpr* fw_op_expr = dynamic_cast<const UserOpExpr*>(&op);
+  CHECK_NOTNULL_OR_RETURN(fw_op_expr) << "Forward op must be not null";
+  base_attrs_ = MakeAttrMapFromUserOpConf(fw_op_expr->proto());
+  return Maybe<void>::Ok();
+}
+
+Maybe<void> EmbeddingBag::Capture(EmbeddingBagCaptureState* ctx, const TensorTuple& inputs,
+                                  const TensorTuple& outputs, const AttrMap& attrs) const {
+  ctx->has_per_sample_weights = inputs.size() == 4;
+  ctx->weight_requires_grad = JUST(oneflow::VectorAt(inputs, 0))->requires_grad();
+  ctx->per_sample_weights_requires_grad =
+      ctx->has_per_sample_weights && JUST(oneflow::VectorAt(inputs, 3))->requires_grad();
+  if (!ctx->weight_requires_grad && !ctx->per_sample_weights_requires_grad) {
+    return Maybe<void>::Ok();
+  }
+
+  for (const auto& input : inputs) { ctx->SaveTensorForBackward(input); }
+
+  ComposedAttrMap composed_attrs(attrs, base_attrs_);
+  ctx->mode = JUST(composed_attrs.GetAttr<std::string>("mode"));
+  ctx->padding_idx = JUST(composed_attrs.GetAttr<int64_t>("padding_idx"));
+  return Maybe<void>::Ok();
+}
+
+Maybe<void> EmbeddingBag::Apply(const EmbeddingBagCaptureState* ctx, const TensorTuple& out_grads,
+                                TensorTuple* in_grads) const {
+  CHECK_EQ_OR_RETURN(out_grads.size(), 1);  // NOLINT(maybe-need-error-msg)
+  if (!ctx->weight_requires_grad && !ctx->per_sample_weights_requires_grad) {
+    return Maybe<void>::Ok();
+  }
+
+  in_grads->resize(ctx->SavedTensors().size());
+  const auto& dy = JUST(oneflow::VectorAt(out_grads, 0));
+  const auto& weight = JUST(oneflow::VectorAt(ctx->SavedTensors(), 0));
+  const auto& indices = JUST(oneflow::VectorAt(ctx->SavedTensors(), 1));
+  const auto& offsets = JUST(oneflow::VectorAt(ctx->SavedTensors(), 2));
+  Optional<one::Tensor> per_sample_weights;
+  if (ctx->has_per_sample_weights) {
+    per_sample_weights = JUST(oneflow::VectorAt(ctx->SavedTensors(), 3));
+  }
+
+  if (ctx->weight_requires_grad) {
+    JUST(oneflow::VectorAt(*in_grads, 0)) = JUST(functional::EmbeddingBagGrad(
+        dy, weight, indices, offsets, per_sample_weights, ctx->mode, ctx->padding_idx));
+  }
+  if (ctx->per_sample_weights_requires_grad) {
+    // per_sample_weights is only allowed in sum mode, where the gradient of a sample is the dot
+    // product of the output gradient of its bag and its embedding, or 0 for padding_idx.
+    CHECK_EQ_OR_RETURN(ctx->mode, "sum")
+        << "per_sample_weights is only supported for mode='sum', but got mode='" << ctx->mode
+        << "'";
+    const int64_t num_samples = indices->shape()->At(0);
+    const auto& positions =
+        JUST(functional::Arange(Scalar(0), Scalar(num_samples), Scalar(1), offsets->dtype(),
+                                JUST(offsets->device())));
+    // the bag of a sample is the last one starting at or before it
+    const auto& bag_ids = JUST(functional::ScalarSub(
+        JUST(functional::SearchSorted(offsets, positions, /*out_int32=*/false, /*right=*/true)),
+        Scalar(1), /*alpha=*/1, /*inplace=*/false));
+    const auto& rows = JUST(functional::Gather(weight, indices, /*axis=*/0));
+    const auto& bag_dy = JUST(functional::Gather(dy, bag_ids, /*axis=*/0));
+    auto per_sample_weights_grad = JUST(functional::ReduceSum(
+        JUST(functional::Mul(rows, bag_dy)), {1}, /*keepdim=*/false, /*dtype=*/NullOpt));
+    if (ctx->padding_idx >= 0) {
+      const auto& not_padding = JUST(functional::Cast(
+          JUST(functional::ScalarLogicalNotEqual(indices, Scalar(ctx->padding_idx))),
+          per_sample_weights_grad->dtype(), /*pin_memory=*/false));
+      per_sample_weights_grad = JUST(functional::Mul(per_sample_weights_grad, not_padding));
+    }
+    JUST(oneflow::VectorAt(*in_grads, 3)) = per_sample_weights_grad;
+  }
+  return Maybe<void>::Ok();
+}
+
+REGISTER_OP_EXPR_GRAD_FUNCTION("embedding_bag", EmbeddingBag);
+
 }  // namespace one
 }  // namespace oneflow
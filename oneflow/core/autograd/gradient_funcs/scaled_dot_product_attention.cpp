@@ -20,7 +20,6 @@ limitations under the License.
 #include "oneflow/core/framework/op_interpreter/op_interpreter_util.h"
 #include "oneflow/core/functional/functional.h"
 #include "oneflow/core/common/container_util.h"
-#if CUDA_VERSION >= 11070
 
 namespace oneflow {
 
@@ -36,6 +35,8 @@ struct ScaledDotProductFlashAttentionCaptureState : public AutoGradCaptureState
   size_t out_idx = 0;
   size_t softmax_lse_idx = 0;
   size_t rng_state_idx = 0;
+  bool has_attn_mask = false;
+  size_t attn_mask_idx = 0;
   float p_dropout = .0f;
   float softmax_scale = .0f;
   bool is_causal = false;
@@ -53,7 +54,8 @@ class ScaledDotProductFlashAttention
 
   Maybe<void> Capture(ScaledDotProductFlashAttentionCaptureState* ctx, const TensorTuple& inputs,
                       const TensorTuple& outputs, const AttrMap& attrs) const override {
-    CHECK_EQ_OR_RETURN(inputs.size(), 3) << "Input size should be equal to 3. ";
+    CHECK_OR_RETURN(inputs.size() == 3 || inputs.size() == 4)
+        << "Input size should be equal to 3 or 4. ";
     ComposedAttrMap composed_attrs(attrs, base_attrs_);
     ctx->p_dropout = JUST(composed_attrs.GetAttr<float>("p_dropout"));
     ctx->softmax_scale = JUST(composed_attrs.GetAttr<float>("softmax_scale"));
@@ -67,6 +69,11 @@ class ScaledDotProductFlashAttention
     ctx->out_idx = ctx->SaveTensorForBackward(JUST(oneflow::VectorAt(outputs, 0)));
     ctx->softmax_lse_idx = ctx->SaveTensorForBackward(JUST(oneflow::VectorAt(outputs, 1)));
     ctx->rng_state_idx = ctx->SaveTensorForBackward(JUST(oneflow::VectorAt(outputs, 2)));
+    // attn_mask is only passed on cpu and does not require grad.
+    ctx->has_attn_mask = inputs.size() == 4;
+    if (ctx->has_attn_mask) {
+      ctx->attn_mask_idx = ctx->SaveTensorForBackward(JUST(oneflow::VectorAt(inputs, 3)));
+    }
     return Maybe<void>::Ok();
   }
 
@@ -74,7 +81,11 @@ class ScaledDotProductFlashAttention
                     const TensorTuple& out_grads, TensorTuple* in_grads) const override {
     CHECK_EQ_OR_RETURN(out_grads.size(), 3) << "Out grads size should be equal to 3. ";
     std::shared_ptr<oneflow::one::TensorTuple> grads;
-    in_grads->resize(3);
+    in_grads->resize(ctx->has_attn_mask ? 4 : 3);
+    Optional<one::Tensor> attn_mask;
+    if (ctx->has_attn_mask) {
+      attn_mask = JUST(oneflow::VectorAt(ctx->SavedTensors(), ctx->attn_mask_idx));
+    }
     grads = JUST(functional::ScaledDotProductFlashAttentionGrad(
         JUST(oneflow::VectorAt(out_grads, 0)),
         JUST(oneflow::VectorAt(ctx->SavedTensors(), ctx->query_idx)),
@@ -83,7 +94,7 @@ class ScaledDotProductFlashAttention
         JUST(oneflow::VectorAt(ctx->SavedTensors(), ctx->out_idx)),
         JUST(oneflow::VectorAt(ctx->SavedTensors(), ctx->softmax_lse_idx)),
         JUST(oneflow::VectorAt(ctx->SavedTensors(), ctx->rng_state_idx)), ctx->p_dropout,
-        ctx->is_causal, ctx->softmax_scale));
+        ctx->is_causal, ctx->softmax_scale, attn_mask));
 
     if (ctx->query_requires_grad) {
       JUST(oneflow::VectorAt(*in_grads, 0)) = JUST(oneflow::VectorAt(*grads, 0));
@@ -109,4 +120,3 @@ REGISTER_OP_EXPR_GRAD_FUNCTION("scaled_dot_product_flash_attention",
 
 }  // namespace oneflow
 
-#endif  // CUDA_VERSION >= 11070
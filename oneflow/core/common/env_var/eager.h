@@ -33,6 +33,11 @@ DEFINE_THREAD_LOCAL_ENV_INTEGER(ONEFLOW_EAGER_TENSOR_INFER_CACHE_SIZE, 128 * 102
 
 DEFINE_THREAD_LOCAL_ENV_BOOL(ONEFLOW_EAGER_NCCL_USE_COMPUTE_STREAM, false);
 
+// NOTE: use env variable 'ONEFLOW_EAGER_BACKWARD_THREAD_NUM' indicate the number of threads
+// dispatching the independent FunctionNodes in the eager backward, 1 means running them one by
+// one on the calling thread.
+DEFINE_ENV_INTEGER(ONEFLOW_EAGER_BACKWARD_THREAD_NUM, 1);
+
 inline bool EagerNcclUseComputeStream() {
 #if defined(WITH_CUDA) && NCCL_VERSION_CODE > 2700
   static bool eager_nccl_use_compute_stream =
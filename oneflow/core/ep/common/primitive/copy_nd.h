@@ -34,6 +34,7 @@ struct CopyNdKernelParams {
   NdIndexOffsetHelper<IndexType, num_dims> copy_index_helper;
   IndexType dst_pos[num_dims];
   IndexType src_pos[num_dims];
+  IndexType extent[num_dims];
   IndexType count{};
   const void* src{};
   void* dst{};
@@ -108,6 +109,7 @@ void LaunchKernel(Stream* stream, void* dst, const int64_t* dst_dims, const int6
   for (size_t i = 0; i < num_dims; ++i) {
     params.dst_pos[i] = dst_pos[i];
     params.src_pos[i] = src_pos[i];
+    params.extent[i] = extent[i];
   }
   params.src = src;
   params.dst = dst;
@@ -15,6 +15,7 @@ limitations under the License.
 */
 #include "oneflow/core/ep/include/primitive/copy_nd.h"
 #include "oneflow/core/ep/common/primitive/copy_nd.h"
+#include "oneflow/core/ep/cpu/cpu_stream.h"
 
 namespace oneflow {
 
@@ -23,29 +24,53 @@ namespace primitive {
 
 namespace {
 
+// Number of elements copied by a task of the cpu copy_nd kernel.
+constexpr int64_t kCpuCopyNdGrain = 32768;
+
+// The simplified copy is a set of rows of extent[num_dims - 1] elements, each being a contiguous
+// run of both src and dst, so the rows are copied by memcpy. The rows are spread over the threads,
+// and each task walks its rows by incrementing the nd index instead of dividing the offset of each
+// row.
 template<size_t num_dims, size_t movement_size, typename IndexType>
-void CopyNdKernel(CopyNdKernelParams<num_dims, IndexType> params) {
+void CopyNdKernel(Stream* stream, CopyNdKernelParams<num_dims, IndexType> params) {
   using T = typename std::aligned_storage<movement_size, movement_size>::type;
   const T* src = reinterpret_cast<const T*>(params.src);
   T* dst = reinterpret_cast<T*>(params.dst);
-  for (IndexType i = 0; i < params.count; ++i) {
+  const IndexType row_size = params.extent[num_dims - 1];
+  if (params.count == 0) { return; }
+  const IndexType num_rows = params.count / row_size;
+  auto copy_rows = [&](int64_t begin, int64_t end) {
     IndexType copy_index[num_dims];
     IndexType src_index[num_dims];
     IndexType dst_index[num_dims];
-    params.copy_index_helper.OffsetToNdIndex(i, copy_index);
-    for (size_t j = 0; j < num_dims; ++j) {
-      src_index[j] = params.src_pos[j] + copy_index[j];
-      dst_index[j] = params.dst_pos[j] + copy_index[j];
+    params.copy_index_helper.OffsetToNdIndex(static_cast<IndexType>(begin) * row_size, copy_index);
+    for (int64_t row = begin; row < end; ++row) {
+      for (size_t j = 0; j < num_dims; ++j) {
+        src_index[j] = params.src_pos[j] + copy_index[j];
+        dst_index[j] = params.dst_pos[j] + copy_index[j];
+      }
+      const IndexType src_offset = params.src_index_helper.NdIndexToOffset(src_index);
+      const IndexType dst_offset = params.dst_index_helper.NdIndexToOffset(dst_index);
+      std::memcpy(dst + dst_offset, src + src_offset, row_size * sizeof(T));
+      for (int j = static_cast<int>(num_dims) - 2; j >= 0; --j) {
+        copy_index[j] += 1;
+        if (copy_index[j] < params.extent[j]) { break; }
+        copy_index[j] = 0;
+      }
     }
-    const IndexType src_offset = params.src_index_helper.NdIndexToOffset(src_index);
-    const IndexType dst_offset = params.dst_index_helper.NdIndexToOffset(dst_index);
-    dst[dst_offset] = src[src_offset];
+  };
+  // Small copies are done on the calling thread, the thread pool may not honor the grain size.
+  if (params.count <= kCpuCopyNdGrain) {
+    copy_rows(0, num_rows);
+  } else {
+    stream->As<CpuStream>()->ParallelFor(0, num_rows, copy_rows,
+                                         std::max<int64_t>(kCpuCopyNdGrain / row_size, 1));
   }
 }
 
 template<size_t num_dims, size_t movement_size, typename IndexType>
 void LaunchKernel(Stream* stream, CopyNdKernelParams<num_dims, IndexType> params) {
-  CopyNdKernel<num_dims, movement_size, IndexType>(params);
+  CopyNdKernel<num_dims, movement_size, IndexType>(stream, params);
 }
 
 class CopyNdImpl : public CopyNd {
@@ -30,30 +30,139 @@ namespace internal {
 
 namespace {
 
-template<size_t num_dims, size_t movement_size, typename IndexType>
-void PermuteKernel(PermuteKernelParams<num_dims, IndexType> params) {
-  using T = typename std::aligned_storage<movement_size, movement_size>::type;
-  const T* src = reinterpret_cast<const T*>(params.src);
-  T* dst = reinterpret_cast<T*>(params.dst);
-  for (IndexType i = 0; i < params.count; ++i) {
-    IndexType src_index[num_dims];
-    IndexType dst_index[num_dims];
-    params.dst_index_helper.OffsetToNdIndex(i, dst_index);
-    for (size_t dim = 0; dim < num_dims; ++dim) {
-      src_index[params.permutation[dim]] = dst_index[dim];
+// Number of elements moved by a task of the cpu permute kernel, smaller permutations are done on
+// the calling thread since the thread pool may not honor the grain size.
+constexpr int64_t kCpuPermuteGrain = 32768;
+
+// Side of the square tiles of the transposing permutations, a tile of each of src and dst fits in
+// the L1 cache.
+template<size_t movement_size>
+constexpr int64_t GetCpuPermuteTileSize() {
+  return movement_size <= 4 ? 32 : 16;
+}
+
+// Copies the dst rows of row_size elements when the permutation keeps the last dim in place, so
+// that each row is a contiguous run of both src and dst. src_strides[i] is the src stride of the
+// dim at position i of dst.
+template<size_t num_dims, typename T, typename IndexType>
+void PermuteRows(Stream* stream, const IndexType* dst_dims, const IndexType* src_strides,
+                 const T* src, T* dst, IndexType count) {
+  const IndexType row_size = dst_dims[num_dims - 1];
+  const IndexType num_rows = count / row_size;
+  auto copy_rows = [&](int64_t begin, int64_t end) {
+    IndexType index[num_dims]{};
+    IndexType src_offset = 0;
+    IndexType remaining = static_cast<IndexType>(begin);
+    for (int dim = static_cast<int>(num_dims) - 2; dim >= 0; --dim) {
+      index[dim] = remaining % dst_dims[dim];
+      remaining /= dst_dims[dim];
+      src_offset += index[dim] * src_strides[dim];
     }
-    IndexType src_offset = params.src_index_helper.NdIndexToOffset(src_index);
-    dst[i] = src[src_offset];
+    for (int64_t row = begin; row < end; ++row) {
+      std::memcpy(dst + row * row_size, src + src_offset, row_size * sizeof(T));
+      for (int dim = static_cast<int>(num_dims) - 2; dim >= 0; --dim) {
+        index[dim] += 1;
+        src_offset += src_strides[dim];
+        if (index[dim] < dst_dims[dim]) { break; }
+        src_offset -= index[dim] * src_strides[dim];
+        index[dim] = 0;
+      }
+    }
+  };
+  if (count <= kCpuPermuteGrain) {
+    copy_rows(0, num_rows);
+  } else {
+    stream->As<CpuStream>()->ParallelFor(0, num_rows, copy_rows,
+                                         std::max<int64_t>(kCpuPermuteGrain / row_size, 1));
+  }
+}
+
+// Transposes the pair of dims that are contiguous in src and in dst by square tiles, each tile is
+// read along the rows of src and written along the rows of dst while both stay in the cache. The
+// other dims are batch dims, the (batch, tile) tasks are spread over the threads.
+template<size_t num_dims, size_t movement_size, typename T, typename IndexType>
+void PermuteTiles(Stream* stream, const IndexType* dst_dims, const IndexType* dst_strides,
+                  const IndexType* src_strides, int src_last_dim_pos, const T* src, T* dst,
+                  IndexType count) {
+  constexpr int64_t kTileSize = GetCpuPermuteTileSize<movement_size>();
+  // i runs along the last dim of dst, j along the last dim of src.
+  const int64_t num_i = dst_dims[num_dims - 1];
+  const int64_t num_j = dst_dims[src_last_dim_pos];
+  const IndexType src_stride_i = src_strides[num_dims - 1];
+  const IndexType dst_stride_j = dst_strides[src_last_dim_pos];
+  const int64_t tiles_i = (num_i + kTileSize - 1) / kTileSize;
+  const int64_t tiles_j = (num_j + kTileSize - 1) / kTileSize;
+  const int64_t num_tasks = count / (num_i * num_j) * tiles_j * tiles_i;
+  auto transpose_tiles = [&](int64_t begin, int64_t end) {
+    for (int64_t task = begin; task < end; ++task) {
+      const int64_t tile_i = task % tiles_i;
+      const int64_t tile_j = task / tiles_i % tiles_j;
+      IndexType batch = static_cast<IndexType>(task / tiles_i / tiles_j);
+      IndexType src_offset = 0;
+      IndexType dst_offset = 0;
+      for (int dim = static_cast<int>(num_dims) - 2; dim >= 0; --dim) {
+        if (dim == src_last_dim_pos) { continue; }
+        const IndexType index = batch % dst_dims[dim];
+        batch /= dst_dims[dim];
+        src_offset += index * src_strides[dim];
+        dst_offset += index * dst_strides[dim];
+      }
+      const int64_t i_begin = tile_i * kTileSize;
+      const int64_t i_end = std::min(i_begin + kTileSize, num_i);
+      const int64_t j_begin = tile_j * kTileSize;
+      const int64_t j_end = std::min(j_begin + kTileSize, num_j);
+      const T* src_tile = src + src_offset;
+      T* dst_tile = dst + dst_offset;
+      for (int64_t j = j_begin; j < j_end; ++j) {
+        T* dst_row = dst_tile + j * dst_stride_j;
+        const T* src_col = src_tile + j;
+        for (int64_t i = i_begin; i < i_end; ++i) { dst_row[i] = src_col[i * src_stride_i]; }
+      }
+    }
+  };
+  if (count <= kCpuPermuteGrain) {
+    transpose_tiles(0, num_tasks);
+  } else {
+    stream->As<CpuStream>()->ParallelFor(
+        0, num_tasks, transpose_tiles,
+        std::max<int64_t>(kCpuPermuteGrain / (kTileSize * kTileSize), 1));
   }
 }
 
 template<size_t num_dims, size_t movement_size, typename IndexType>
 void LaunchKernel(Stream* stream, const int64_t* src_dims, const void* src, const int* permutation,
                   void* dst, size_t count) {
-  PermuteKernelParams<num_dims, IndexType> params =
-      MakePermuteParams<num_dims, IndexType>(src_dims, src, permutation, dst, count);
-  PermuteKernel<num_dims, movement_size, IndexType>(params);
+  using T = typename std::aligned_storage<movement_size, movement_size>::type;
+  IndexType src_dim_strides[num_dims];
+  src_dim_strides[num_dims - 1] = 1;
+  for (int dim = static_cast<int>(num_dims) - 2; dim >= 0; --dim) {
+    src_dim_strides[dim] = src_dim_strides[dim + 1] * static_cast<IndexType>(src_dims[dim + 1]);
+  }
+  IndexType dst_dims[num_dims];
+  IndexType src_strides[num_dims];
+  int src_last_dim_pos = 0;
+  for (int dim = 0; dim < static_cast<int>(num_dims); ++dim) {
+    dst_dims[dim] = static_cast<IndexType>(src_dims[permutation[dim]]);
+    src_strides[dim] = src_dim_strides[permutation[dim]];
+    if (permutation[dim] == static_cast<int>(num_dims) - 1) { src_last_dim_pos = dim; }
+  }
+  IndexType dst_strides[num_dims];
+  dst_strides[num_dims - 1] = 1;
+  for (int dim = static_cast<int>(num_dims) - 2; dim >= 0; --dim) {
+    dst_strides[dim] = dst_strides[dim + 1] * dst_dims[dim + 1];
+  }
+  if (count == 0) { return; }
+  if (src_last_dim_pos == static_cast<int>(num_dims) - 1) {
+    PermuteRows<num_dims, T, IndexType>(stream, dst_dims, src_strides,
+                                        reinterpret_cast<const T*>(src), reinterpret_cast<T*>(dst),
+                                        static_cast<IndexType>(count));
+  } else {
+    PermuteTiles<num_dims, movement_size, T, IndexType>(
+        stream, dst_dims, dst_strides, src_strides, src_last_dim_pos,
+        reinterpret_cast<const T*>(src), reinterpret_cast<T*>(dst), static_cast<IndexType>(count));
+  }
 }
+
 class PermuteImpl : public Permute {
  public:
   OF_DISALLOW_COPY_AND_MOVE(PermuteImpl);
@@ -0,0 +1,469 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/ep/include/primitive/reduce.h"
+#include "oneflow/core/ep/common/primitive/util.h"
+#include "oneflow/core/ep/cpu/primitive/type_seq.h"
+#include "oneflow/core/ep/cpu/cpu_stream.h"
+#include "oneflow/core/ep/cpu/cpu_device.h"
+
+namespace oneflow {
+
+namespace ep {
+namespace primitive {
+
+namespace {
+
+constexpr size_t kMaxNumDims = 8;
+
+// Number of src elements reduced by a task, smaller reductions are done on the calling thread
+// since the thread pool may not honor the grain size.
+constexpr int64_t kCpuReduceGrain = 32768;
+
+// Independent accumulators of a contiguous run, they let the compiler vectorize the loop without
+// reassociating the operation.
+constexpr int64_t kNumLanes = 8;
+
+// Contiguous runs and column blocks longer than this are combined pairwise, which bounds the
+// rounding error of a floating point sum by O(log n) instead of O(n).
+constexpr int64_t kPairwiseBlockSize = 128;
+
+// Columns accumulated together by the strided reduction, the accumulators stay in the L1 cache.
+constexpr int64_t kColumnBlockSize = 1024;
+
+template<BinaryOp op, typename Src, typename Dst>
+struct ReduceFunctor;
+
+template<typename Src, typename Dst>
+struct ReduceFunctor<BinaryOp::kAdd, Src, Dst> {
+  static Dst Identity() { return static_cast<Dst>(0); }
+  static Dst Convert(Src x) { return static_cast<Dst>(x); }
+  static Dst Apply(Dst a, Dst b) { return a + b; }
+};
+
+template<typename Src, typename Dst>
+struct ReduceFunctor<BinaryOp::kMul, Src, Dst> {
+  static Dst Identity() { return static_cast<Dst>(1); }
+  static Dst Convert(Src x) { return static_cast<Dst>(x); }
+  static Dst Apply(Dst a, Dst b) { return a * b; }
+};
+
+template<typename Src, typename Dst>
+struct ReduceFunctor<BinaryOp::kMax, Src, Dst> {
+  static Dst Identity() {
+    return std::numeric_limits<Dst>::has_infinity ? -std::numeric_limits<Dst>::infinity()
+                                                  : std::numeric_limits<Dst>::lowest();
+  }
+  static Dst Convert(Src x) { return static_cast<Dst>(x); }
+  static Dst Apply(Dst a, Dst b) { return a > b ? a : b; }
+};
+
+template<typename Src, typename Dst>
+struct ReduceFunctor<BinaryOp::kMin, Src, Dst> {
+  static Dst Identity() {
+    return std::numeric_limits<Dst>::has_infinity ? std::numeric_limits<Dst>::infinity()
+                                                  : std::numeric_limits<Dst>::max();
+  }
+  static Dst Convert(Src x) { return static_cast<Dst>(x); }
+  static Dst Apply(Dst a, Dst b) { return a < b ? a : b; }
+};
+
+template<typename Src, typename Dst>
+struct ReduceFunctor<BinaryOp::kLogicalAnd, Src, Dst> {
+  static Dst Identity() { return true; }
+  static Dst Convert(Src x) { return static_cast<bool>(x); }
+  static Dst Apply(Dst a, Dst b) { return a && b; }
+};
+
+template<typename Src, typename Dst>
+struct ReduceFunctor<BinaryOp::kLogicalOr, Src, Dst> {
+  static Dst Identity() { return false; }
+  static Dst Convert(Src x) { return static_cast<bool>(x); }
+  static Dst Apply(Dst a, Dst b) { return a || b; }
+};
+
+// Drops the dims of size 1 and merges the adjacent dims that are both reduced or both kept, so that
+// the reduced and the kept dims alternate.
+void SimplifyReduceDims(size_t num_dims, const int64_t* src_dims, const int64_t* dst_dims,
+                        size_t* simplified_num_dims, int64_t* simplified_dims, bool* reduced) {
+  *simplified_num_dims = 0;
+  for (size_t i = 0; i < num_dims; ++i) {
+    CHECK(dst_dims[i] == src_dims[i] || dst_dims[i] == 1);
+    if (src_dims[i] == 1) { continue; }
+    const bool is_reduced = (dst_dims[i] == 1);
+    if (*simplified_num_dims != 0 && reduced[*simplified_num_dims - 1] == is_reduced) {
+      simplified_dims[*simplified_num_dims - 1] *= src_dims[i];
+    } else {
+      simplified_dims[*simplified_num_dims] = src_dims[i];
+      reduced[*simplified_num_dims] = is_reduced;
+      *simplified_num_dims += 1;
+    }
+  }
+  if (*simplified_num_dims == 0) {
+    simplified_dims[0] = 1;
+    reduced[0] = false;
+    *simplified_num_dims = 1;
+  }
+}
+
+template<BinaryOp op, typename Src, typename Dst>
+Dst ReduceContiguous(const Src* src, int64_t n) {
+  using F = ReduceFunctor<op, Src, Dst>;
+  if (n > kPairwiseBlockSize) {
+    const int64_t half = n / 2 / kNumLanes * kNumLanes;
+    return F::Apply(ReduceContiguous<op, Src, Dst>(src, half),
+                    ReduceContiguous<op, Src, Dst>(src + half, n - half));
+  }
+  Dst lanes[kNumLanes];
+  for (int64_t k = 0; k < kNumLanes; ++k) { lanes[k] = F::Identity(); }
+  int64_t i = 0;
+  for (; i + kNumLanes <= n; i += kNumLanes) {
+    for (int64_t k = 0; k < kNumLanes; ++k) {
+      lanes[k] = F::Apply(lanes[k], F::Convert(src[i + k]));
+    }
+  }
+  Dst acc = F::Identity();
+  for (; i < n; ++i) { acc = F::Apply(acc, F::Convert(src[i])); }
+  for (int64_t k = 0; k < kNumLanes; ++k) { acc = F::Apply(acc, lanes[k]); }
+  return acc;
+}
+
+// Reduces a single contiguous run, a long run is split into a partial result per thread.
+template<BinaryOp op, typename Src, typename Dst>
+Dst ReduceContiguousParallel(CpuStream* cpu_stream, const Src* src, int64_t n) {
+  using F = ReduceFunctor<op, Src, Dst>;
+  const int64_t num_chunks =
+      std::min(static_cast<int64_t>(cpu_stream->device()->GetNumThreads()),
+               (n + kCpuReduceGrain - 1) / kCpuReduceGrain);
+  if (num_chunks <= 1) { return ReduceContiguous<op, Src, Dst>(src, n); }
+  const int64_t chunk_size = (n + num_chunks - 1) / num_chunks;
+  std::unique_ptr<Dst[]> partials(new Dst[num_chunks]);
+  std::fill(partials.get(), partials.get() + num_chunks, F::Identity());
+  cpu_stream->ParallelFor(
+      0, num_chunks,
+      [&](int64_t begin, int64_t end) {
+        for (int64_t chunk = begin; chunk < end; ++chunk) {
+          const int64_t offset = chunk * chunk_size;
+          if (offset >= n) { continue; }
+          partials[chunk] =
+              ReduceContiguous<op, Src, Dst>(src + offset, std::min(chunk_size, n - offset));
+        }
+      },
+      1);
+  Dst acc = F::Identity();
+  for (int64_t chunk = 0; chunk < num_chunks; ++chunk) { acc = F::Apply(acc, partials[chunk]); }
+  return acc;
+}
+
+// Reduces the rows of an [outer, reduce] src, each row is a contiguous run.
+template<BinaryOp op, typename Src, typename Dst>
+void ReduceRows(CpuStream* cpu_stream, int64_t outer, int64_t reduce, const Src* src, Dst* dst) {
+  if (outer < static_cast<int64_t>(cpu_stream->device()->GetNumThreads())) {
+    for (int64_t i = 0; i < outer; ++i) {
+      dst[i] = ReduceContiguousParallel<op, Src, Dst>(cpu_stream, src + i * reduce, reduce);
+    }
+    return;
+  }
+  auto reduce_rows = [&](int64_t begin, int64_t end) {
+    for (int64_t i = begin; i < end; ++i) {
+      dst[i] = ReduceContiguous<op, Src, Dst>(src + i * reduce, reduce);
+    }
+  };
+  if (outer * reduce <= kCpuReduceGrain) {
+    reduce_rows(0, outer);
+  } else {
+    cpu_stream->ParallelFor(0, outer, reduce_rows, std::max<int64_t>(kCpuReduceGrain / reduce, 1));
+  }
+}
+
+// Combines num_rows rows of num_cols elements, row_stride apart, into acc. The rows are first
+// combined by blocks so that the result is pairwise along the reduced axis too.
+template<BinaryOp op, typename Src, typename Dst>
+void ReduceColumnBlock(const Src* src, int64_t num_rows, int64_t row_stride, int64_t num_cols,
+                       Dst* acc) {
+  using F = ReduceFunctor<op, Src, Dst>;
+  Dst block[kColumnBlockSize];
+  for (int64_t row_begin = 0; row_begin < num_rows; row_begin += kPairwiseBlockSize) {
+    const int64_t row_end = std::min(row_begin + kPairwiseBlockSize, num_rows);
+    const Src* first_row = src + row_begin * row_stride;
+    for (int64_t j = 0; j < num_cols; ++j) { block[j] = F::Convert(first_row[j]); }
+    for (int64_t i = row_begin + 1; i < row_end; ++i) {
+      const Src* row = src + i * row_stride;
+      for (int64_t j = 0; j < num_cols; ++j) { block[j] = F::Apply(block[j], F::Convert(row[j])); }
+    }
+    for (int64_t j = 0; j < num_cols; ++j) { acc[j] = F::Apply(acc[j], block[j]); }
+  }
+}
+
+// Reduces the middle axis of an [outer, reduce, inner] src. The tasks are the column blocks of each
+// outer index, when there are too few of them the reduced axis is split into a partial result per
+// thread instead.
+template<BinaryOp op, typename Src, typename Dst>
+void ReduceColumns(CpuStream* cpu_stream, int64_t outer, int64_t reduce, int64_t inner,
+                   const Src* src, Dst* dst) {
+  using F = ReduceFunctor<op, Src, Dst>;
+  const int64_t num_threads = cpu_stream->device()->GetNumThreads();
+  const int64_t col_blocks = (inner + kColumnBlockSize - 1) / kColumnBlockSize;
+  const int64_t num_tasks = outer * col_blocks;
+  const int64_t count = outer * reduce * inner;
+  if (num_tasks < num_threads && count > kCpuReduceGrain) {
+    const int64_t num_chunks =
+        std::min(std::min(num_threads, (count + kCpuReduceGrain - 1) / kCpuReduceGrain), reduce);
+    const int64_t chunk_rows = (reduce + num_chunks - 1) / num_chunks;
+    std::unique_ptr<Dst[]> partials(new Dst[num_chunks * inner]);
+    for (int64_t o = 0; o < outer; ++o) {
+      const Src* outer_src = src + o * reduce * inner;
+      std::fill(partials.get(), partials.get() + num_chunks * inner, F::Identity());
+      cpu_stream->ParallelFor(
+          0, num_chunks * col_blocks,
+          [&](int64_t begin, int64_t end) {
+            for (int64_t task = begin; task < end; ++task) {
+              const int64_t chunk = task / col_blocks;
+              const int64_t col_begin = task % col_blocks * kColumnBlockSize;
+              const int64_t row_begin = chunk * chunk_rows;
+              if (row_begin >= reduce) { continue; }
+              ReduceColumnBlock<op, Src, Dst>(
+                  outer_src + row_begin * inner + col_begin,
+                  std::min(chunk_rows, reduce - row_begin), inner,
+                  std::min(kColumnBlockSize, inner - col_begin),
+                  partials.get() + chunk * inner + col_begin);
+            }
+          },
+          1);
+      Dst* outer_dst = dst + o * inner;
+      for (int64_t j = 0; j < inner; ++j) { outer_dst[j] = partials[j]; }
+      for (int64_t chunk = 1; chunk < num_chunks; ++chunk) {
+        const Dst* partial = partials.get() + chunk * inner;
+        for (int64_t j = 0; j < inner; ++j) { outer_dst[j] = F::Apply(outer_dst[j], partial[j]); }
+      }
+    }
+    return;
+  }
+  auto reduce_columns = [&](int64_t begin, int64_t end) {
+    for (int64_t task = begin; task < end; ++task) {
+      const int64_t o = task / col_blocks;
+      const int64_t col_begin = task % col_blocks * kColumnBlockSize;
+      const int64_t num_cols = std::min(kColumnBlockSize, inner - col_begin);
+      Dst* acc = dst + o * inner + col_begin;
+      for (int64_t j = 0; j < num_cols; ++j) { acc[j] = F::Identity(); }
+      ReduceColumnBlock<op, Src, Dst>(src + o * reduce * inner + col_begin, reduce, inner,
+                                      num_cols, acc);
+    }
+  };
+  if (count <= kCpuReduceGrain) {
+    reduce_columns(0, num_tasks);
+  } else {
+    const int64_t task_size = reduce * std::min(kColumnBlockSize, inner);
+    cpu_stream->ParallelFor(0, num_tasks, reduce_columns,
+                            std::max<int64_t>(kCpuReduceGrain / task_size, 1));
+  }
+}
+
+// Reduces any other pattern of alternating reduced and kept dims, each dst element is computed by
+// a single task. When the last dim is reduced its contiguous runs are still reduced by
+// ReduceContiguous, which is the case of the statistics over the N and spatial dims of NCHW.
+template<BinaryOp op, typename Src, typename Dst>
+void ReduceGeneric(CpuStream* cpu_stream, size_t num_dims, const int64_t* dims,
+                   const bool* reduced, const Src* src, Dst* dst) {
+  using F = ReduceFunctor<op, Src, Dst>;
+  int64_t strides[kMaxNumDims];
+  strides[num_dims - 1] = 1;
+  for (int dim = static_cast<int>(num_dims) - 2; dim >= 0; --dim) {
+    strides[dim] = strides[dim + 1] * dims[dim + 1];
+  }
+  const bool reduce_last_dim = reduced[num_dims - 1];
+  const int64_t run_size = reduce_last_dim ? dims[num_dims - 1] : 1;
+  const size_t num_outer_dims = reduce_last_dim ? num_dims - 1 : num_dims;
+  int64_t kept_dims[kMaxNumDims];
+  int64_t kept_strides[kMaxNumDims];
+  int64_t reduced_dims[kMaxNumDims];
+  int64_t reduced_strides[kMaxNumDims];
+  int num_kept_dims = 0;
+  int num_reduced_dims = 0;
+  int64_t dst_count = 1;
+  int64_t num_runs = 1;
+  for (size_t dim = 0; dim < num_outer_dims; ++dim) {
+    if (reduced[dim]) {
+      reduced_dims[num_reduced_dims] = dims[dim];
+      reduced_strides[num_reduced_dims] = strides[dim];
+      num_runs *= dims[dim];
+      num_reduced_dims += 1;
+    } else {
+      kept_dims[num_kept_dims] = dims[dim];
+      kept_strides[num_kept_dims] = strides[dim];
+      dst_count *= dims[dim];
+      num_kept_dims += 1;
+    }
+  }
+  auto reduce_dst = [&](int64_t begin, int64_t end) {
+    int64_t index[kMaxNumDims];
+    for (int64_t i = begin; i < end; ++i) {
+      int64_t offset = 0;
+      int64_t remaining = i;
+      for (int dim = num_kept_dims - 1; dim >= 0; --dim) {
+        offset += remaining % kept_dims[dim] * kept_strides[dim];
+        remaining /= kept_dims[dim];
+      }
+      std::fill(index, index + num_reduced_dims, 0);
+      Dst acc = F::Identity();
+      for (int64_t run = 0; run < num_runs; ++run) {
+        if (reduce_last_dim) {
+          acc = F::Apply(acc, ReduceContiguous<op, Src, Dst>(src + offset, run_size));
+        } else {
+          acc = F::Apply(acc, F::Convert(src[offset]));
+        }
+        for (int dim = num_reduced_dims - 1; dim >= 0; --dim) {
+          index[dim] += 1;
+          offset += reduced_strides[dim];
+          if (index[dim] < reduced_dims[dim]) { break; }
+          offset -= index[dim] * reduced_strides[dim];
+          index[dim] = 0;
+        }
+      }
+      dst[i] = acc;
+    }
+  };
+  const int64_t reduce_size = num_runs * run_size;
+  if (dst_count * reduce_size <= kCpuReduceGrain) {
+    reduce_dst(0, dst_count);
+  } else {
+    cpu_stream->ParallelFor(0, dst_count, reduce_dst,
+                            std::max<int64_t>(kCpuReduceGrain / reduce_size, 1));
+  }
+}
+
+template<BinaryOp op, typename Src, typename Dst>
+class ReduceImpl : public Reduce {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(ReduceImpl);
+  ReduceImpl() = default;
+  ~ReduceImpl() override = default;
+
+  void Launch(Stream* stream, size_t num_dims, const int64_t* src_dims, const void* src,
+              const int64_t* dst_dims, void* dst) override {
+    using F = ReduceFunctor<op, Src, Dst>;
+    CHECK_LE(num_dims, kMaxNumDims);
+    auto* cpu_stream = stream->As<CpuStream>();
+    const Src* typed_src = reinterpret_cast<const Src*>(src);
+    Dst* typed_dst = reinterpret_cast<Dst*>(dst);
+    const int64_t dst_count = GetElementCount(num_dims, dst_dims);
+    if (GetElementCount(num_dims, src_dims) == 0) {
+      std::fill(typed_dst, typed_dst + dst_count, F::Identity());
+      return;
+    }
+    size_t simplified_num_dims = 0;
+    int64_t simplified_dims[kMaxNumDims];
+    bool reduced[kMaxNumDims];
+    SimplifyReduceDims(num_dims, src_dims, dst_dims, &simplified_num_dims, simplified_dims,
+                       reduced);
+    if (simplified_num_dims == 1 && !reduced[0]) {
+      auto convert = [&](int64_t begin, int64_t end) {
+        for (int64_t i = begin; i < end; ++i) { typed_dst[i] = F::Convert(typed_src[i]); }
+      };
+      if (dst_count <= kCpuReduceGrain) {
+        convert(0, dst_count);
+      } else {
+        cpu_stream->ParallelFor(0, dst_count, convert, kCpuReduceGrain);
+      }
+    } else if (simplified_num_dims == 1) {
+      *typed_dst =
+          ReduceContiguousParallel<op, Src, Dst>(cpu_stream, typed_src, simplified_dims[0]);
+    } else if (simplified_num_dims == 2 && reduced[1]) {
+      ReduceRows<op, Src, Dst>(cpu_stream, simplified_dims[0], simplified_dims[1], typed_src,
+                               typed_dst);
+    } else if (simplified_num_dims == 2) {
+      ReduceColumns<op, Src, Dst>(cpu_stream, 1, simplified_dims[0], simplified_dims[1],
+                                  typed_src, typed_dst);
+    } else if (simplified_num_dims == 3 && reduced[1]) {
+      ReduceColumns<op, Src, Dst>(cpu_stream, simplified_dims[0], simplified_dims[1],
+                                  simplified_dims[2], typed_src, typed_dst);
+    } else {
+      ReduceGeneric<op, Src, Dst>(cpu_stream, simplified_num_dims, simplified_dims, reduced,
+                                  typed_src, typed_dst);
+    }
+  }
+};
+
+template<BinaryOp op, typename Src, typename Dst>
+std::unique_ptr<Reduce> NewReduce() {
+  return std::unique_ptr<Reduce>(new ReduceImpl<op, Src, Dst>());
+}
+
+#define CPU_PRIMITIVE_REDUCE_TYPE_SEQ \
+  CPU_PRIMITIVE_BOOL_TYPE_SEQ         \
+  CPU_PRIMITIVE_INT8_TYPE_SEQ         \
+  CPU_PRIMITIVE_UINT8_TYPE_SEQ        \
+  CPU_PRIMITIVE_INT32_TYPE_SEQ        \
+  CPU_PRIMITIVE_INT64_TYPE_SEQ        \
+  CPU_PRIMITIVE_FLOAT_TYPE_SEQ        \
+  CPU_PRIMITIVE_DOUBLE_TYPE_SEQ
+
+#define REDUCE_MATH_OP_SEQ             \
+  OF_PP_MAKE_TUPLE_SEQ(BinaryOp::kAdd) \
+  OF_PP_MAKE_TUPLE_SEQ(BinaryOp::kMul) \
+  OF_PP_MAKE_TUPLE_SEQ(BinaryOp::kMax) \
+  OF_PP_MAKE_TUPLE_SEQ(BinaryOp::kMin)
+
+#define REDUCE_LOGICAL_OP_SEQ                 \
+  OF_PP_MAKE_TUPLE_SEQ(BinaryOp::kLogicalAnd) \
+  OF_PP_MAKE_TUPLE_SEQ(BinaryOp::kLogicalOr)
+
+class ReduceFactoryImpl : public ReduceFactory {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(ReduceFactoryImpl);
+  ReduceFactoryImpl() = default;
+  ~ReduceFactoryImpl() override = default;
+
+  std::unique_ptr<Reduce> New(BinaryOp op, DataType src_type, DataType dst_type,
+                              size_t max_num_dims) override {
+    if (max_num_dims > kMaxNumDims) { return nullptr; }
+#define MAKE_NEW_REDUCE_MATH_ENTRY(binary_op, data_type_pair)                                 \
+  {std::make_tuple(binary_op, OF_PP_PAIR_SECOND(data_type_pair),                              \
+                   OF_PP_PAIR_SECOND(data_type_pair)),                                        \
+   NewReduce<binary_op, OF_PP_PAIR_FIRST(data_type_pair), OF_PP_PAIR_FIRST(data_type_pair)>},
+
+#define MAKE_NEW_REDUCE_LOGICAL_ENTRY(binary_op, data_type_pair)                   \
+  {std::make_tuple(binary_op, OF_PP_PAIR_SECOND(data_type_pair), DataType::kBool), \
+   NewReduce<binary_op, OF_PP_PAIR_FIRST(data_type_pair), bool>},
+
+    static const std::map<std::tuple<BinaryOp, DataType, DataType>,
+                          std::function<std::unique_ptr<Reduce>()>>
+        new_reduce_handle{
+            OF_PP_SEQ_PRODUCT_FOR_EACH_TUPLE(MAKE_NEW_REDUCE_MATH_ENTRY, REDUCE_MATH_OP_SEQ,
+                                             CPU_PRIMITIVE_REDUCE_TYPE_SEQ)
+                OF_PP_SEQ_PRODUCT_FOR_EACH_TUPLE(MAKE_NEW_REDUCE_LOGICAL_ENTRY,
+                                                 REDUCE_LOGICAL_OP_SEQ,
+                                                 CPU_PRIMITIVE_REDUCE_TYPE_SEQ)};
+
+#undef MAKE_NEW_REDUCE_LOGICAL_ENTRY
+#undef MAKE_NEW_REDUCE_MATH_ENTRY
+
+    const auto it = new_reduce_handle.find(std::make_tuple(op, src_type, dst_type));
+    if (it != new_reduce_handle.end()) {
+      return it->second();
+    } else {
+      return nullptr;
+    }
+  }
+};
+
+REGISTER_PRIMITIVE_FACTORY(DeviceType::kCPU, ReduceFactory, ReduceFactoryImpl);
+
+}  // namespace
+
+}  // namespace primitive
+}  // namespace ep
+
+}  // namespace oneflow
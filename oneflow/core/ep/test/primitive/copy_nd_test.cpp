@@ -29,23 +29,18 @@ namespace test {
 
 namespace {
 
+// Copies a contiguous src of extent into dst at dst_pos, then back into a contiguous src.
 template<DataType data_type, typename T>
 void TestCopyNd(DeviceManagerRegistry* registry, const std::set<DeviceType>& device_types,
-                int64_t num_dims) {
-  std::vector<int64_t> src_dims(num_dims, 0);
+                const std::vector<int64_t>& extent, const std::vector<int64_t>& dst_pos) {
+  const int64_t num_dims = extent.size();
+  std::vector<int64_t> src_dims(extent);
   std::vector<int64_t> src_pos(num_dims, 0);
-  std::vector<int64_t> dst_pos(num_dims, 0);
   std::vector<int64_t> dst_dims(num_dims, 0);
-  std::vector<int64_t> extent(num_dims, 0);
   int64_t src_elem = 1;
   int64_t dst_elem = 1;
   for (int i = 0; i < num_dims; ++i) {
-    int64_t rand_dim = 8 + std::rand() % 32;
-    int64_t rand_pos = std::rand() % 16;
-    src_dims.at(i) = rand_dim;
-    dst_pos.at(i) = rand_pos;
-    dst_dims.at(i) = rand_pos + rand_dim;
-    extent.at(i) = rand_dim;
+    dst_dims.at(i) = dst_pos.at(i) + extent.at(i);
     src_elem *= src_dims.at(i);
     dst_elem *= dst_dims.at(i);
   }
@@ -85,6 +80,18 @@ void TestCopyNd(DeviceManagerRegistry* registry, const std::set<DeviceType>& dev
   }
 }
 
+template<DataType data_type, typename T>
+void TestCopyNd(DeviceManagerRegistry* registry, const std::set<DeviceType>& device_types,
+                int64_t num_dims) {
+  std::vector<int64_t> extent(num_dims, 0);
+  std::vector<int64_t> dst_pos(num_dims, 0);
+  for (int i = 0; i < num_dims; ++i) {
+    extent.at(i) = 8 + std::rand() % 32;
+    dst_pos.at(i) = std::rand() % 16;
+  }
+  TestCopyNd<data_type, T>(registry, device_types, extent, dst_pos);
+}
+
 }  // namespace
 
 TEST_F(PrimitiveTest, TestCopyNd) {
@@ -97,6 +104,20 @@ TEST_F(PrimitiveTest, TestCopyNd) {
   }
 }
 
+// The copies have more elements than a task of the cpu copy_nd, so their rows are spread over the
+// threads, and the row sizes do not divide the task size.
+TEST_F(PrimitiveTest, TestLargeCopyNd) {
+  SetCpuNumThreads(4);
+  TestCopyNd<DataType::kFloat, float>(&device_manager_registry_, available_device_types_,
+                                      {300, 257}, {17, 3});
+  TestCopyNd<DataType::kDouble, double>(&device_manager_registry_, available_device_types_,
+                                        {33, 41, 37}, {5, 0, 7});
+  TestCopyNd<DataType::kInt8, int8_t>(&device_manager_registry_, available_device_types_,
+                                      {40000}, {11});
+  TestCopyNd<DataType::kInt32, int32_t>(&device_manager_registry_, available_device_types_,
+                                        {3, 70, 9, 23}, {1, 2, 0, 5});
+}
+
 }  // namespace test
 
 }  // namespace primitive
@@ -0,0 +1,182 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+// Times the cpu Permute and CopyNd primitives for a few shapes and thread numbers, and reports the
+// bandwidth of each. It is not run by ctest.
+//
+// Usage: oneflow_permute_benchmark [num_threads ...]
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "oneflow/core/ep/include/device_manager_registry.h"
+#include "oneflow/core/ep/include/primitive/copy_nd.h"
+#include "oneflow/core/ep/include/primitive/permute.h"
+#include "oneflow/core/ep/cpu/cpu_device_manager.h"
+
+namespace oneflow {
+
+namespace ep {
+
+namespace primitive {
+
+namespace {
+
+constexpr int kWarmupIters = 3;
+constexpr int kIters = 20;
+
+struct PermuteCase {
+  DataType data_type;
+  std::vector<int64_t> src_dims;
+  std::vector<int> permutation;
+};
+
+struct CopyNdCase {
+  DataType data_type;
+  std::vector<int64_t> extent;
+  std::vector<int64_t> dst_pos;
+};
+
+int64_t ElemCnt(const std::vector<int64_t>& dims) {
+  int64_t elem_cnt = 1;
+  for (int64_t dim : dims) { elem_cnt *= dim; }
+  return elem_cnt;
+}
+
+template<typename F>
+double TimeMs(Stream* stream, const F& launch) {
+  for (int i = 0; i < kWarmupIters; ++i) { launch(); }
+  CHECK_JUST(stream->Sync());
+  const auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < kIters; ++i) { launch(); }
+  CHECK_JUST(stream->Sync());
+  const std::chrono::duration<double, std::milli> elapsed =
+      std::chrono::steady_clock::now() - start;
+  return elapsed.count() / kIters;
+}
+
+void Report(const std::string& name, size_t num_threads, double ms, int64_t bytes) {
+  // each byte is read once and written once
+  std::cout << name << ", threads: " << num_threads << ", " << ms << " ms, "
+            << 2.0 * bytes / ms / 1e6 << " GB/s" << std::endl;
+}
+
+std::string DimsToString(const std::vector<int64_t>& dims) {
+  std::string str = "(";
+  for (size_t i = 0; i < dims.size(); ++i) {
+    if (i != 0) { str += ", "; }
+    str += std::to_string(dims.at(i));
+  }
+  return str + ")";
+}
+
+void RunBenchmark(const std::vector<size_t>& thread_nums) {
+  const std::vector<PermuteCase> permute_cases{
+      {DataType::kFloat, {4096, 4096}, {1, 0}},
+      {DataType::kFloat, {64, 1023, 257}, {0, 2, 1}},
+      {DataType::kFloat, {32, 128, 56, 56}, {0, 2, 3, 1}},
+      {DataType::kFloat, {32, 56, 56, 128}, {0, 3, 1, 2}},
+      {DataType::kFloat, {128, 64, 2048}, {1, 0, 2}},
+      {DataType::kInt8, {4096, 4096}, {1, 0}},
+      {DataType::kDouble, {2048, 2048}, {1, 0}},
+  };
+  const std::vector<CopyNdCase> copy_nd_cases{
+      {DataType::kFloat, {4096, 4000}, {0, 96}},
+      {DataType::kFloat, {64, 255, 255}, {1, 1, 1}},
+      {DataType::kInt8, {16, 1024, 1000}, {0, 0, 24}},
+  };
+  // disable oneDNN, the cpu permute kernel is what is measured
+  setenv("ONEFLOW_ENABLE_ONEDNN_OPTS", "0", 1);
+  DeviceManagerRegistry registry;
+  auto* cpu_device_manager =
+      dynamic_cast<CpuDeviceManager*>(registry.GetDeviceManager(DeviceType::kCPU));
+  CHECK_NOTNULL(cpu_device_manager);
+  for (size_t num_threads : thread_nums) {
+    cpu_device_manager->SetDeviceNumThreads(num_threads);
+    auto device = registry.GetDevice(DeviceType::kCPU, 0);
+    Stream* stream = device->CreateStream();
+    CHECK_JUST(stream->OnExecutionContextSetup());
+    AllocationOptions options{};
+    for (const auto& permute_case : permute_cases) {
+      const size_t num_dims = permute_case.src_dims.size();
+      const int64_t bytes =
+          ElemCnt(permute_case.src_dims) * GetSizeOfDataType(permute_case.data_type);
+      void* src = nullptr;
+      void* dst = nullptr;
+      CHECK_JUST(device->Alloc(options, &src, bytes));
+      CHECK_JUST(device->Alloc(options, &dst, bytes));
+      std::memset(src, 1, bytes);
+      std::unique_ptr<Permute> permute = NewPrimitive<PermuteFactory>(DeviceType::kCPU, num_dims);
+      CHECK(permute);
+      const double ms = TimeMs(stream, [&]() {
+        permute->Launch(stream, permute_case.data_type, num_dims, permute_case.src_dims.data(),
+                        src, permute_case.permutation.data(), dst);
+      });
+      Report("permute " + DimsToString(permute_case.src_dims) + " "
+                 + DataType_Name(permute_case.data_type),
+             num_threads, ms, bytes);
+      device->Free(options, src);
+      device->Free(options, dst);
+    }
+    for (const auto& copy_nd_case : copy_nd_cases) {
+      const size_t num_dims = copy_nd_case.extent.size();
+      std::vector<int64_t> dst_dims(num_dims);
+      for (size_t i = 0; i < num_dims; ++i) {
+        dst_dims.at(i) = copy_nd_case.dst_pos.at(i) + copy_nd_case.extent.at(i);
+      }
+      const std::vector<int64_t> src_pos(num_dims, 0);
+      const size_t elem_size = GetSizeOfDataType(copy_nd_case.data_type);
+      const int64_t bytes = ElemCnt(copy_nd_case.extent) * elem_size;
+      void* src = nullptr;
+      void* dst = nullptr;
+      CHECK_JUST(device->Alloc(options, &src, bytes));
+      CHECK_JUST(device->Alloc(options, &dst, ElemCnt(dst_dims) * elem_size));
+      std::memset(src, 1, bytes);
+      std::unique_ptr<CopyNd> copy_nd = NewPrimitive<CopyNdFactory>(DeviceType::kCPU, num_dims);
+      CHECK(copy_nd);
+      const double ms = TimeMs(stream, [&]() {
+        copy_nd->Launch(stream, copy_nd_case.data_type, num_dims, dst, dst_dims.data(),
+                        copy_nd_case.dst_pos.data(), src, copy_nd_case.extent.data(),
+                        src_pos.data(), copy_nd_case.extent.data());
+      });
+      Report("copy_nd " + DimsToString(copy_nd_case.extent) + " "
+                 + DataType_Name(copy_nd_case.data_type),
+             num_threads, ms, bytes);
+      device->Free(options, src);
+      device->Free(options, dst);
+    }
+    CHECK_JUST(stream->OnExecutionContextTeardown());
+    device->DestroyStream(stream);
+  }
+}
+
+}  // namespace
+
+}  // namespace primitive
+
+}  // namespace ep
+
+}  // namespace oneflow
+
+int main(int argc, char** argv) {
+  std::vector<size_t> thread_nums;
+  for (int i = 1; i < argc; ++i) { thread_nums.push_back(std::atoi(argv[i])); }
+  if (thread_nums.empty()) { thread_nums = {1, 2, 4, 8}; }
+  oneflow::ep::primitive::RunBenchmark(thread_nums);
+  return 0;
+}
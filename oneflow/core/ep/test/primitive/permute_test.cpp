@@ -14,6 +14,7 @@ See the License for the specific language governing permissions and
 limitations under the License.
 */
 #include <gtest/gtest.h>
+#include <cstdlib>
 #include "oneflow/core/ep/test/primitive/primitive_test.h"
 #include "oneflow/core/ep/include/primitive/memcpy.h"
 #include "oneflow/core/ep/include/primitive/permute.h"
@@ -118,6 +119,74 @@ void TestPermute3D(DeviceManagerRegistry* registry, const std::set<DeviceType>&
   }
 }
 
+class DisableOneDnnGuard final {
+ public:
+  DisableOneDnnGuard() {
+    const char* value = std::getenv("ONEFLOW_ENABLE_ONEDNN_OPTS");
+    if (value != nullptr) { old_value_.reset(new std::string(value)); }
+    setenv("ONEFLOW_ENABLE_ONEDNN_OPTS", "0", 1);
+  }
+  ~DisableOneDnnGuard() {
+    if (old_value_) {
+      setenv("ONEFLOW_ENABLE_ONEDNN_OPTS", old_value_->c_str(), 1);
+    } else {
+      unsetenv("ONEFLOW_ENABLE_ONEDNN_OPTS");
+    }
+  }
+
+ private:
+  std::unique_ptr<std::string> old_value_;
+};
+
+template<typename T, DataType dtype>
+void TestPermuteNd(DeviceManagerRegistry* registry, const std::set<DeviceType>& device_types,
+                   const std::vector<int64_t>& src_dims, const std::vector<int>& permutation) {
+  const size_t num_dims = src_dims.size();
+  int64_t elem_cnt = 1;
+  for (int64_t dim : src_dims) { elem_cnt *= dim; }
+  const size_t size = elem_cnt * sizeof(T);
+  std::vector<int64_t> src_strides(num_dims, 1);
+  for (int dim = static_cast<int>(num_dims) - 2; dim >= 0; --dim) {
+    src_strides[dim] = src_strides[dim + 1] * src_dims[dim + 1];
+  }
+  // dst[i] = src[src_offset] where the nd index of i in dst maps to src through the permutation
+  std::vector<T> src(elem_cnt);
+  std::vector<T> expected(elem_cnt);
+  for (int64_t i = 0; i < elem_cnt; ++i) { src[i] = static_cast<T>(i); }
+  for (int64_t i = 0; i < elem_cnt; ++i) {
+    int64_t remaining = i;
+    int64_t src_offset = 0;
+    for (int dim = static_cast<int>(num_dims) - 1; dim >= 0; --dim) {
+      const int64_t dst_dim = src_dims[permutation[dim]];
+      src_offset += remaining % dst_dim * src_strides[permutation[dim]];
+      remaining /= dst_dim;
+    }
+    expected[i] = src[src_offset];
+  }
+
+  for (const auto& device_type : device_types) {
+    auto device = registry->GetDevice(device_type, 0);
+    ep::test::PinnedMemoryGuard host_src(device.get(), size);
+    ep::test::PinnedMemoryGuard host_dst(device.get(), size);
+    ep::test::DeviceMemoryGuard device_src(device.get(), size);
+    ep::test::DeviceMemoryGuard device_dst(device.get(), size);
+    ep::test::StreamGuard stream(device.get());
+    std::unique_ptr<Permute> permute = NewPrimitive<PermuteFactory>(device_type, num_dims);
+    ASSERT_TRUE(permute.operator bool());
+    std::unique_ptr<Memcpy> h2d = NewPrimitive<MemcpyFactory>(device_type, MemcpyKind::kHtoD);
+    std::unique_ptr<Memcpy> d2h = NewPrimitive<MemcpyFactory>(device_type, MemcpyKind::kDtoH);
+    ASSERT_TRUE(d2h.operator bool());
+    ASSERT_TRUE(h2d.operator bool());
+    std::memcpy(host_src.ptr(), src.data(), size);
+    h2d->Launch(stream.stream(), device_src.ptr(), host_src.ptr(), size);
+    permute->Launch(stream.stream(), dtype, num_dims, src_dims.data(), device_src.ptr(),
+                    permutation.data(), device_dst.ptr());
+    d2h->Launch(stream.stream(), host_dst.ptr(), device_dst.ptr(), size);
+    CHECK_JUST(stream.stream()->Sync());
+    for (int64_t i = 0; i < elem_cnt; ++i) { ASSERT_EQ(host_dst.ptr<T>()[i], expected[i]); }
+  }
+}
+
 TEST_F(PrimitiveTest, TestBatchPermute) {
   const int permutation_list[2] = {1, 0};
   const int32_t dims0[2] = {2, 3};
@@ -162,6 +231,32 @@ TEST_F(PrimitiveTest, TestPermute) {
       &device_manager_registry_, available_device_types_, dims4, permutation_list4);
 }
 
+// The shapes have dims larger than a cpu tile and not a multiple of it, and more elements than a
+// task of the cpu permute, so the edge tiles are run and the tasks are spread over the threads.
+// oneDNN is disabled, it would take over the cpu permutations otherwise.
+TEST_F(PrimitiveTest, TestLargePermute) {
+  DisableOneDnnGuard disable_onednn;
+  SetCpuNumThreads(4);
+  // transposes by tiles
+  TestPermuteNd<float, DataType::kFloat>(&device_manager_registry_, available_device_types_,
+                                         {257, 131}, {1, 0});
+  TestPermuteNd<double, DataType::kDouble>(&device_manager_registry_, available_device_types_,
+                                           {129, 300}, {1, 0});
+  TestPermuteNd<int8_t, DataType::kInt8>(&device_manager_registry_, available_device_types_,
+                                         {33, 1025}, {1, 0});
+  TestPermuteNd<float, DataType::kFloat>(&device_manager_registry_, available_device_types_,
+                                         {3, 97, 211}, {0, 2, 1});
+  TestPermuteNd<int64_t, DataType::kInt64>(&device_manager_registry_, available_device_types_,
+                                           {65, 33, 37}, {2, 1, 0});
+  TestPermuteNd<float, DataType::kFloat>(&device_manager_registry_, available_device_types_,
+                                         {5, 34, 7, 41}, {0, 3, 2, 1});
+  // copies rows
+  TestPermuteNd<float, DataType::kFloat>(&device_manager_registry_, available_device_types_,
+                                         {67, 45, 17}, {1, 0, 2});
+  TestPermuteNd<int32_t, DataType::kInt32>(&device_manager_registry_, available_device_types_,
+                                           {35, 9, 33, 5}, {2, 0, 1, 3});
+}
+
 }  // namespace test
 
 }  // namespace primitive
@@ -17,6 +17,7 @@ limitations under the License.
 #define ONEFLOW_CORE_EP_TEST_PRIMITIVE_PRIMITIVE_TEST_
 
 #include "oneflow/core/ep/test/test_util.h"
+#include "oneflow/core/ep/cpu/cpu_device_manager.h"
 
 namespace oneflow {
 
@@ -26,7 +27,15 @@ namespace primitive {
 
 namespace test {
 
-class PrimitiveTest : public ep::test::TestCase {};
+class PrimitiveTest : public ep::test::TestCase {
+ protected:
+  // The cpu device runs the primitives on a single thread unless told otherwise.
+  void SetCpuNumThreads(size_t num_threads) {
+    auto* cpu_device_manager = dynamic_cast<CpuDeviceManager*>(
+        device_manager_registry_.GetDeviceManagerOrNull(DeviceType::kCPU));
+    if (cpu_device_manager != nullptr) { cpu_device_manager->SetDeviceNumThreads(num_threads); }
+  }
+};
 
 }  // namespace test
 
@@ -0,0 +1,148 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include <gtest/gtest.h>
+#include "oneflow/core/ep/test/primitive/primitive_test.h"
+#include "oneflow/core/ep/include/primitive/memcpy.h"
+#include "oneflow/core/ep/include/primitive/reduce.h"
+
+namespace oneflow {
+
+namespace ep {
+
+namespace primitive {
+
+namespace test {
+
+namespace {
+
+template<typename Src, typename Dst, typename F>
+void ReduceReference(const std::vector<int64_t>& src_dims, const std::vector<int64_t>& dst_dims,
+                     const Src* src, Dst init, F f, std::vector<Dst>* dst) {
+  const int num_dims = src_dims.size();
+  int64_t src_count = 1;
+  int64_t dst_count = 1;
+  for (int i = 0; i < num_dims; ++i) {
+    src_count *= src_dims[i];
+    dst_count *= dst_dims[i];
+  }
+  dst->assign(dst_count, init);
+  for (int64_t i = 0; i < src_count; ++i) {
+    int64_t remaining = i;
+    int64_t dst_offset = 0;
+    int64_t dst_stride = 1;
+    for (int dim = num_dims - 1; dim >= 0; --dim) {
+      const int64_t index = remaining % src_dims[dim];
+      remaining /= src_dims[dim];
+      if (dst_dims[dim] != 1) { dst_offset += index * dst_stride; }
+      dst_stride *= dst_dims[dim];
+    }
+    (*dst)[dst_offset] = f((*dst)[dst_offset], static_cast<Dst>(src[i]));
+  }
+}
+
+template<DataType src_data_type, typename Src, DataType dst_data_type, typename Dst, typename F>
+void TestReduce(DeviceManagerRegistry* registry, const std::set<DeviceType>& device_types,
+                BinaryOp op, const std::vector<int64_t>& src_dims,
+                const std::vector<int64_t>& dst_dims, Dst init, F f) {
+  int64_t src_count = 1;
+  int64_t dst_count = 1;
+  for (size_t i = 0; i < src_dims.size(); ++i) {
+    src_count *= src_dims[i];
+    dst_count *= dst_dims[i];
+  }
+  const size_t src_size = src_count * sizeof(Src);
+  const size_t dst_size = dst_count * sizeof(Dst);
+  std::vector<Src> src(src_count);
+  for (int64_t i = 0; i < src_count; ++i) { src[i] = static_cast<Src>(i * 7 % 5) - 2; }
+  std::vector<Dst> expected;
+  ReduceReference(src_dims, dst_dims, src.data(), init, f, &expected);
+  for (const auto& device_type : device_types) {
+    std::unique_ptr<Reduce> reduce =
+        NewPrimitive<ReduceFactory>(device_type, op, src_data_type, dst_data_type, src_dims.size());
+    if (device_type != DeviceType::kCPU && !reduce) { continue; }
+    ASSERT_TRUE(reduce.operator bool());
+    auto device = registry->GetDevice(device_type, 0);
+    ep::test::PinnedMemoryGuard input(device.get(), src_size);
+    ep::test::PinnedMemoryGuard output(device.get(), dst_size);
+    std::memcpy(input.ptr(), src.data(), src_size);
+    ep::test::DeviceMemoryGuard device_in(device.get(), src_size);
+    ep::test::DeviceMemoryGuard device_out(device.get(), dst_size);
+    ep::test::StreamGuard stream(device.get());
+    std::unique_ptr<Memcpy> h2d = NewPrimitive<MemcpyFactory>(device_type, MemcpyKind::kHtoD);
+    ASSERT_TRUE(h2d.operator bool());
+    std::unique_ptr<Memcpy> d2h = NewPrimitive<MemcpyFactory>(device_type, MemcpyKind::kDtoH);
+    ASSERT_TRUE(d2h.operator bool());
+    h2d->Launch(stream.stream(), device_in.ptr(), input.ptr(), src_size);
+    reduce->Launch(stream.stream(), src_dims.size(), src_dims.data(), device_in.ptr(),
+                   dst_dims.data(), device_out.ptr());
+    d2h->Launch(stream.stream(), output.ptr(), device_out.ptr(), dst_size);
+    CHECK_JUST(stream.stream()->Sync());
+    const Dst* result = output.ptr<Dst>();
+    for (int64_t i = 0; i < dst_count; ++i) {
+      ASSERT_NEAR(static_cast<double>(result[i]), static_cast<double>(expected[i]), 1e-3);
+    }
+  }
+}
+
+void TestReduce(DeviceManagerRegistry* registry, const std::set<DeviceType>& device_types,
+                const std::vector<int64_t>& src_dims, const std::vector<int64_t>& dst_dims) {
+  TestReduce<DataType::kFloat, float, DataType::kFloat, float>(
+      registry, device_types, BinaryOp::kAdd, src_dims, dst_dims, 0.0f,
+      [](float a, float b) { return a + b; });
+  TestReduce<DataType::kDouble, double, DataType::kDouble, double>(
+      registry, device_types, BinaryOp::kMax, src_dims, dst_dims,
+      -std::numeric_limits<double>::infinity(), [](double a, double b) { return std::max(a, b); });
+  TestReduce<DataType::kInt32, int32_t, DataType::kInt32, int32_t>(
+      registry, device_types, BinaryOp::kMin, src_dims, dst_dims,
+      std::numeric_limits<int32_t>::max(), [](int32_t a, int32_t b) { return std::min(a, b); });
+  TestReduce<DataType::kInt64, int64_t, DataType::kBool, bool>(
+      registry, device_types, BinaryOp::kLogicalAnd, src_dims, dst_dims, true,
+      [](bool a, bool b) { return a && b; });
+  TestReduce<DataType::kFloat, float, DataType::kBool, bool>(
+      registry, device_types, BinaryOp::kLogicalOr, src_dims, dst_dims, false,
+      [](bool a, bool b) { return a || b; });
+}
+
+}  // namespace
+
+TEST_F(PrimitiveTest, TestReduce) {
+  // Full, inner, outer, middle and NCHW statistics reductions, the larger shapes are split over
+  // the threads.
+  const std::vector<std::pair<std::vector<int64_t>, std::vector<int64_t>>> shapes = {
+      {{1000}, {1}},
+      {{300000}, {1}},
+      {{64, 257}, {64, 1}},
+      {{4, 200000}, {4, 1}},
+      {{257, 64}, {1, 64}},
+      {{200000, 3}, {1, 3}},
+      {{8, 129, 33}, {8, 1, 33}},
+      {{16, 4096, 8}, {16, 1, 8}},
+      {{4, 3, 17, 19}, {1, 3, 1, 1}},
+      {{32, 64, 14, 14}, {1, 64, 1, 1}},
+      {{5, 1, 6, 7}, {5, 1, 1, 7}},
+  };
+  for (const auto& shape : shapes) {
+    TestReduce(&device_manager_registry_, available_device_types_, shape.first, shape.second);
+  }
+}
+
+}  // namespace test
+
+}  // namespace primitive
+
+}  // namespace ep
+
+}  // namespace oneflow
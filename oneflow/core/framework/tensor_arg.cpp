@@ -15,35 +15,90 @@ limitations under the License.
 */
 
 #include "oneflow/core/framework/tensor_arg.h"
+#include "oneflow/core/autograd/autograd_engine.h"
+#include "oneflow/core/framework/tensor.h"
 #include "oneflow/core/framework/tensor_tuple.h"
 #include "oneflow/core/functional/functional.h"
 
 namespace oneflow {
 namespace one {
 
-bool TensorArg::Empty() const { return !acc_tensor_; }
+namespace {
 
-void TensorArg::Release() { acc_tensor_.reset(); }
+// The partial tensors could be summed up by add_n only if they are all local eager tensors with
+// the same meta, otherwise they are accumulated one by one with broadcast and boxing.
+Maybe<bool> CanAccumulateByAddN(const std::vector<std::shared_ptr<Tensor>>& tensors) {
+  const auto& first = tensors.front();
+  for (const auto& tensor : tensors) {
+    if (!tensor->is_local() || !tensor->is_eager()) { return false; }
+    if (std::dynamic_pointer_cast<StaticZerosTensor>(tensor)) { return false; }
+    if (*tensor->shape() != *first->shape() || tensor->dtype() != first->dtype()
+        || JUST(tensor->device()) != JUST(first->device())) {
+      return false;
+    }
+  }
+  return true;
+}
+
+}  // namespace
+
+bool TensorArg::Empty() const {
+  std::unique_lock<std::mutex> lock(mutex_);
+  return !acc_tensor_ && partial_tensors_.empty();
+}
+
+void TensorArg::Release() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  acc_tensor_.reset();
+  partial_tensors_.clear();
+}
 
 Maybe<void> TensorArg::PushPartialTensor(const std::shared_ptr<Tensor>& partial_tensor) {
-  if (!acc_tensor_) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  if (!acc_tensor_ && partial_tensors_.empty()) {
     acc_tensor_ = partial_tensor;
+  } else if (IsInParallelBackward()) {
+    // The partial tensors pushed concurrently are summed up together when the tensor is read
+    partial_tensors_.emplace_back(partial_tensor);
   } else {
-    // Should not inplace accumulate grad. For example,
-    // >>> z = x + y
-    // >>> p = x / z
-    // >>> p.sum().backward()
-    //
-    // As we know that dx = dz + dp / z and dy = dz, so it will lead to wrong value
-    // for dy if dx is shared with dz.
+    // Accumulate eagerly when running serially, so every partial tensor is released once it is
+    // pushed instead of being held until the end of the backward.
+    JUST(AccumulatePartialTensors());
     acc_tensor_ =
         JUST(functional::Add(partial_tensor, acc_tensor_, /*alpha=*/1, /*inplace=*/false));
   }
   return Maybe<void>::Ok();
 }
 
-Maybe<Tensor> TensorArg::GetAccTensor() const {
-  CHECK_OR_RETURN(Empty() == false) << "Can not GetAccTensor because it is empty";
+Maybe<void> TensorArg::AccumulatePartialTensors() {
+  if (partial_tensors_.empty()) { return Maybe<void>::Ok(); }
+  // Should not inplace accumulate grad. For example,
+  // >>> z = x + y
+  // >>> p = x / z
+  // >>> p.sum().backward()
+  //
+  // As we know that dx = dz + dp / z and dy = dz, so it will lead to wrong value
+  // for dy if dx is shared with dz.
+  partial_tensors_.insert(partial_tensors_.begin(), acc_tensor_);
+  if (JUST(CanAccumulateByAddN(partial_tensors_))) {
+    TensorTuple inputs(partial_tensors_.size());
+    std::copy(partial_tensors_.begin(), partial_tensors_.end(), inputs.begin());
+    acc_tensor_ = JUST(functional::Add(inputs, /*inplace=*/false));
+  } else {
+    for (size_t i = 1; i < partial_tensors_.size(); ++i) {
+      acc_tensor_ =
+          JUST(functional::Add(partial_tensors_[i], acc_tensor_, /*alpha=*/1, /*inplace=*/false));
+    }
+  }
+  partial_tensors_.clear();
+  return Maybe<void>::Ok();
+}
+
+Maybe<Tensor> TensorArg::GetAccTensor() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  CHECK_OR_RETURN(acc_tensor_ || !partial_tensors_.empty())
+      << "Can not GetAccTensor because it is empty";
+  JUST(AccumulatePartialTensors());
   return acc_tensor_;
 }
 
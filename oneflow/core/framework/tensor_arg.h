@@ -18,6 +18,7 @@ limitations under the License.
 #define ONEFLOW_CORE_FRAMEWORK_TENSOR_ARG_H_
 
 #include <memory>
+#include <mutex>
 #include <vector>
 #include "oneflow/core/common/util.h"
 #include "oneflow/core/autograd/autograd_meta.h"
@@ -37,11 +38,19 @@ class TensorArg final {
 
   bool Empty() const;
   void Release();
+  // Thread safe, the partial tensors may be pushed by FunctionNodes running in parallel. They are
+  // accumulated at once when pushed in a serial backward, or when the tensor is read otherwise.
   Maybe<void> PushPartialTensor(const std::shared_ptr<Tensor>& partial_tensor);
-  Maybe<Tensor> GetAccTensor() const;
+  Maybe<Tensor> GetAccTensor();
 
  private:
+  // Sums up the pending partial tensors with one multi-tensor add instead of one add per partial
+  // tensor if possible.
+  Maybe<void> AccumulatePartialTensors();
+
+  mutable std::mutex mutex_;
   std::shared_ptr<Tensor> acc_tensor_;
+  std::vector<std::shared_ptr<Tensor>> partial_tensors_;
 };
 
 }  // namespace one
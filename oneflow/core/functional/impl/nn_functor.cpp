@@ -16,6 +16,7 @@ limitations under the License.
 
 #include "oneflow/core/common/maybe.h"
 #include "oneflow/core/common/optional.h"
+#include "oneflow/core/autograd/autograd_mode.h"
 #include "oneflow/core/framework/mutable_attr_map.h"
 #include "oneflow/core/framework/op_builder.h"
 #include "oneflow/core/framework/tensor_util.h"
@@ -296,6 +297,52 @@ class EmbeddingFunctor {
   std::shared_ptr<OpExpr> op_;
 };
 
+class EmbeddingBagFunctor {
+ public:
+  EmbeddingBagFunctor() {
+    op_ = CHECK_JUST(one::OpBuilder("embedding_bag")
+                         .Input("weight")
+                         .Input("indices")
+                         .Input("offsets")
+                         .Output("out")
+                         .Build());
+    weighted_op_ = CHECK_JUST(one::OpBuilder("embedding_bag")
+                                  .Input("weight")
+                                  .Input("indices")
+                                  .Input("offsets")
+                                  .Input("per_sample_weights")
+                                  .Output("out")
+                                  .Build());
+  }
+  Maybe<Tensor> operator()(const std::shared_ptr<one::Tensor>& weight,
+                           const std::shared_ptr<one::Tensor>& indices,
+                           const std::shared_ptr<one::Tensor>& offsets,
+                           const Optional<one::Tensor>& per_sample_weights,
+                           const std::string& mode, const Optional<int64_t>& padding_idx) const {
+    CHECK_EQ_OR_RETURN(weight->ndim(), 2) << "The dimension of weight should be 2";
+    CHECK_EQ_OR_RETURN(indices->ndim(), 1) << "The dimension of indices should be 1";
+    CHECK_EQ_OR_RETURN(offsets->ndim(), 1) << "The dimension of offsets should be 1";
+    if (per_sample_weights) {
+      CHECK_OR_RETURN(mode == "sum")
+          << Error::InvalidValueError() << "embedding_bag: per_sample_weights was not None. "
+          << "per_sample_weights is only supported for mode='sum' (got mode='" << mode << "')";
+    }
+    int64_t new_padding_idx = -1;
+    if (padding_idx.has_value()) { new_padding_idx = JUST(padding_idx); }
+    auto& attrs = THREAD_CACHED_MUTABLE_ATTR_MAP("mode", "padding_idx");
+    attrs.SetAllAttrs(mode, new_padding_idx);
+    if (per_sample_weights) {
+      return OpInterpUtil::Dispatch<Tensor>(
+          *weighted_op_, {weight, indices, offsets, JUST(per_sample_weights)}, attrs);
+    }
+    return OpInterpUtil::Dispatch<Tensor>(*op_, {weight, indices, offsets}, attrs);
+  }
+
+ private:
+  std::shared_ptr<OpExpr> op_;
+  std::shared_ptr<OpExpr> weighted_op_;
+};
+
 class MatMulNoBroadCastFunctor {
  public:
   Maybe<Tensor> operator()(const std::shared_ptr<one::Tensor>& input,
@@ -592,10 +639,27 @@ class TensorDotFunctor {
   }
 };
 
+// The cpu kernels of the fused matmul ops are only registered for float and double.
+bool IsFusedMatmulCpuDataType(const std::shared_ptr<one::Tensor>& x) {
+  const DataType data_type = x->dtype()->data_type();
+  return data_type == DataType::kFloat || data_type == DataType::kDouble;
+}
+
+// The backward of cublas_fused_mlp and fused_matmul_bias_add_relu_dropout is only implemented on
+// cuda, so their cpu kernels are only used when no gradient is required.
+bool FusedMLPRequiresGrad(const std::shared_ptr<one::Tensor>& x, const TensorTuple& weights,
+                          const TensorTuple& biases) {
+  if (!autograd::GradMode::is_enabled()) { return false; }
+  const auto RequiresGrad = [](const std::shared_ptr<one::Tensor>& t) {
+    return t->requires_grad();
+  };
+  return RequiresGrad(x) || std::any_of(weights.begin(), weights.end(), RequiresGrad)
+         || std::any_of(biases.begin(), biases.end(), RequiresGrad);
+}
+
 class FusedMLPFunctor {
  public:
   FusedMLPFunctor() {
-#if CUDA_VERSION >= 11060
     fused_op_.resize(kMaxInputCount /*the maximum number of inputs*/);
     for (int n = 1; n < fused_op_.size(); ++n) {
       fused_op_[n] = CHECK_JUST(one::OpBuilder("cublas_fused_mlp")
@@ -607,7 +671,6 @@ class FusedMLPFunctor {
                                     .Output("hidden", n)
                                     .Build());
     }
-#endif
   }
   Maybe<Tensor> operator()(const std::shared_ptr<one::Tensor>& x, const TensorTuple& weights,
                            const TensorTuple& biases, bool skip_final_activation) const {
@@ -645,7 +708,6 @@ class FusedMLPFunctor {
       k = n;
     }
 
-#if CUDA_VERSION >= 11060
     DeviceType device_type{};
     if (x->is_global()) {
       device_type = JUST(x->parallel_desc())->device_type();
@@ -653,7 +715,12 @@ class FusedMLPFunctor {
       device_type = JUST(x->device())->enum_type();
     }
 
-    if ((device_type == DeviceType::kCUDA) && (weight_size <= kMaxInputCount)
+    bool use_fused_op = (device_type == DeviceType::kCPU) && IsFusedMatmulCpuDataType(x)
+                        && !FusedMLPRequiresGrad(x, weights, biases);
+#if CUDA_VERSION >= 11060
+    use_fused_op = use_fused_op || (device_type == DeviceType::kCUDA);
+#endif  // CUDA_VERSION >= 11060
+    if (use_fused_op && (weight_size <= kMaxInputCount)
         && (!ParseBooleanFromEnv("ONEFLOW_FUNCTOR_DISABLE_FUSED_MLP", false))) {
       TensorTuple input(2 * weight_size + 1);
       input[0] = x;
@@ -664,7 +731,6 @@ class FusedMLPFunctor {
       attrs.SetAllAttrs(skip_final_activation);
       return OpInterpUtil::Dispatch<Tensor>(*fused_op_[weight_size], input, attrs);
     }
-#endif  // CUDA_VERSION >= 11060
 
     // Fall back to Naive matmul + bias_add + relu
     std::shared_ptr<one::Tensor> out = x;
@@ -684,9 +750,7 @@ class FusedMLPFunctor {
   }
 
  private:
-#if CUDA_VERSION >= 11060
   std::vector<std::shared_ptr<OpExpr>> fused_op_;
-#endif
 };
 
 class FusedMatmulBiasFunctor {
@@ -733,7 +797,6 @@ class FusedMatmulBiasFunctor {
     CHECK_EQ_OR_RETURN(weight_shape->At(1), k)
         << Error::RuntimeError() << "weight's second dim should be equal to input's second dim. ";
 
-#if CUDA_VERSION >= 11020
     DeviceType device_type{};
     if (x->is_global()) {
       device_type = JUST(x->parallel_desc())->device_type();
@@ -741,9 +804,13 @@ class FusedMatmulBiasFunctor {
       device_type = JUST(x->device())->enum_type();
     }
 
-    auto& attrs = THREAD_CACHED_MUTABLE_ATTR_MAP("alpha", "beta");
-    attrs.SetAllAttrs(alpha, beta);
-    if (device_type == DeviceType::kCUDA) {
+    bool use_fused_op = (device_type == DeviceType::kCPU) && IsFusedMatmulCpuDataType(x);
+#if CUDA_VERSION >= 11020
+    use_fused_op = use_fused_op || (device_type == DeviceType::kCUDA);
+#endif  // CUDA_VERSION >= 11020
+    if (use_fused_op) {
+      auto& attrs = THREAD_CACHED_MUTABLE_ATTR_MAP("alpha", "beta");
+      attrs.SetAllAttrs(alpha, beta);
       if (_add_to_output) {
         return OpInterpUtil::Dispatch<Tensor>(*_with_add_to_output_op,
                                               {x, weight, bias, JUST(_add_to_output)}, attrs);
@@ -751,7 +818,6 @@ class FusedMatmulBiasFunctor {
         return OpInterpUtil::Dispatch<Tensor>(*_without_add_to_output_op, {x, weight, bias}, attrs);
       }
     }
-#endif  // CUDA_VERSION >= 11020
 
     auto matmul_bias = JUST(functional::BiasAdd(
         JUST(functional::MatMul(x, weight, false, true, alpha)), bias, x->shape()->NumAxes() - 1));
@@ -775,7 +841,6 @@ class FusedMatmulBiasFunctor {
 class FusedMatmulBiasAddReluDropoutFunctor {
  public:
   FusedMatmulBiasAddReluDropoutFunctor() {
-#if CUDA_VERSION >= 11060
     fused_op_.resize(kMaxInputCount /*the maximum number of inputs*/);
     for (int n = 1; n < fused_op_.size(); ++n) {
       fused_op_[n] = CHECK_JUST(one::OpBuilder("fused_matmul_bias_add_relu_dropout")
@@ -787,7 +852,6 @@ class FusedMatmulBiasAddReluDropoutFunctor {
                                     .Output("hidden", n)
                                     .Build());
     }
-#endif
   }
   Maybe<Tensor> operator()(const std::shared_ptr<one::Tensor>& x, const TensorTuple& weights,
                            const TensorTuple& biases, bool skip_final_activation,
@@ -830,14 +894,18 @@ class FusedMatmulBiasAddReluDropoutFunctor {
 
     auto gen = generator.value_or(JUST(one::DefaultAutoGenerator()));
 
-#if CUDA_VERSION >= 11060
     DeviceType device_type{};
     if (x->is_global()) {
       device_type = JUST(x->parallel_desc())->device_type();
     } else {
       device_type = JUST(x->device())->enum_type();
     }
-    if ((device_type == DeviceType::kCUDA) && (weight_size <= kMaxInputCount)
+    bool use_fused_op = (device_type == DeviceType::kCPU) && IsFusedMatmulCpuDataType(x)
+                        && !FusedMLPRequiresGrad(x, weights, biases);
+#if CUDA_VERSION >= 11060
+    use_fused_op = use_fused_op || (device_type == DeviceType::kCUDA);
+#endif  // CUDA_VERSION >= 11060
+    if (use_fused_op && (weight_size <= kMaxInputCount)
         && (!ParseBooleanFromEnv("ONEFLOW_FUNCTOR_DISABLE_FUSED_MLP", false))) {
       TensorTuple input(2 * weight_size + 1);
       input[0] = x;
@@ -853,7 +921,6 @@ class FusedMatmulBiasAddReluDropoutFunctor {
       return OpInterpUtil::Dispatch<Tensor>(*fused_op_[weight_size], input,
                                             OpExprInterpContext(attrs, dropout_state));
     }
-#endif  // CUDA_VERSION >= 11060
 
     // Fall back to Naive matmul + bias_add + relu + dropout
     std::shared_ptr<one::Tensor> out = x;
@@ -878,9 +945,7 @@ class FusedMatmulBiasAddReluDropoutFunctor {
   }
 
  private:
-#if CUDA_VERSION >= 11060
   std::vector<std::shared_ptr<OpExpr>> fused_op_;
-#endif
 };
 
 class LayerNormFunctor {
@@ -4819,6 +4884,25 @@ class RocAucScoreFunctor {
   std::shared_ptr<OpExpr> op_;
 };
 
+class RocAucHistogramFunctor {
+ public:
+  RocAucHistogramFunctor() {
+    op_ = CHECK_JUST(
+        one::OpBuilder("roc_auc_histogram").Input("label").Input("pred").Output("out").Build());
+  }
+
+  Maybe<Tensor> operator()(const std::shared_ptr<one::Tensor>& label,
+                           const std::shared_ptr<one::Tensor>& pred,
+                           const int64_t& num_buckets) const {
+    auto& attrs = THREAD_CACHED_MUTABLE_ATTR_MAP("num_buckets");
+    attrs.SetAllAttrs(num_buckets);
+    return OpInterpUtil::Dispatch<Tensor>(*op_, {label, pred}, attrs);
+  }
+
+ private:
+  std::shared_ptr<OpExpr> op_;
+};
+
 class MultiTensorSgdUpdateFunctor {
  public:
   MultiTensorSgdUpdateFunctor() {
@@ -5434,12 +5518,36 @@ Maybe<one::Tensor> pad_last_dim(const std::shared_ptr<one::Tensor>& input) {
   ;
 }
 
+// Converts attn_mask to an additive mask of (batch_size or 1, num_heads or 1, seqlen_q, seqlen_k)
+// with the same data type as query, the positions of a bool mask which are false are not attended.
+Maybe<one::Tensor> MakeAdditiveAttnMask(const std::shared_ptr<one::Tensor>& attn_mask,
+                                        const std::shared_ptr<one::Tensor>& query,
+                                        int64_t seqlen_q, int64_t seqlen_k) {
+  std::shared_ptr<one::Tensor> mask = attn_mask;
+  if (mask->dtype()->data_type() == DataType::kBool) {
+    mask = JUST(functional::Where(mask, Scalar(0.0),
+                                  Scalar(-std::numeric_limits<double>::infinity())));
+  }
+  if (mask->dtype() != query->dtype()) {
+    mask = JUST(functional::Cast(mask, query->dtype(), /*pin_memory=*/false));
+  }
+  const int64_t num_axes = mask->shape()->NumAxes();
+  CHECK_OR_RETURN(num_axes >= 1 && num_axes <= 4) << "attn_mask should have 1 to 4 dims.";
+  DimVector dim_vec(4 - num_axes, 1);
+  for (int64_t i = 0; i < num_axes; ++i) { dim_vec.push_back(mask->shape()->At(i)); }
+  mask = JUST(functional::Reshape(mask, Shape(dim_vec)));
+  if (dim_vec.at(2) != seqlen_q || dim_vec.at(3) != seqlen_k) {
+    mask = JUST(
+        functional::Expand(mask, Shape({dim_vec.at(0), dim_vec.at(1), seqlen_q, seqlen_k})));
+  }
+  return mask;
+}
+
 }  // namespace
 
 class ScaledDotProductFlashAttentionFunctor {
  public:
   ScaledDotProductFlashAttentionFunctor() {
-#if CUDA_VERSION >= 11070
     op_ = CHECK_JUST(one::OpBuilder("scaled_dot_product_flash_attention")
                          .Input("query")
                          .Input("key")
@@ -5448,7 +5556,15 @@ class ScaledDotProductFlashAttentionFunctor {
                          .Output("softmax_lse")
                          .Output("rng_state")
                          .Build());
-#endif  // CUDA_VERSION >= 11070
+    op_with_mask_ = CHECK_JUST(one::OpBuilder("scaled_dot_product_flash_attention")
+                                   .Input("query")
+                                   .Input("key")
+                                   .Input("value")
+                                   .Input("attn_mask")
+                                   .Output("out")
+                                   .Output("softmax_lse")
+                                   .Output("rng_state")
+                                   .Build());
   }
 
   Maybe<Tensor> operator()(const std::shared_ptr<one::Tensor>& query,
@@ -5457,11 +5573,9 @@ class ScaledDotProductFlashAttentionFunctor {
                            const Optional<one::Tensor>& attn_mask, const float& dropout_p,
                            const bool& is_causal, const Optional<float>& scale,
                            const int64_t& seed = 0) const {
-#if CUDA_VERSION >= 11070
     const auto og_size = query->shape()->At(3);
     const auto batch_size = query->shape()->At(0);
     const auto seqlen_q = query->shape()->At(2);
-    const auto num_heads = query->shape()->At(1);
     const auto num_heads_k = key->shape()->At(1);
     const auto max_seqlen_batch_k = key->shape()->At(2);
     const auto max_seqlen_batch_v = value->shape()->At(2);
@@ -5478,6 +5592,36 @@ class ScaledDotProductFlashAttentionFunctor {
     CHECK_EQ_OR_RETURN(og_size, value->shape()->At(3))
         << " value has different head dims from query.";
 
+    const auto& scale_ =
+        scale.has_value() ? scale : (1.0f / std::sqrt(static_cast<float>(query->shape()->At(3))));
+
+    const DeviceType device_type = query->is_global()
+                                       ? JUST(query->parallel_desc())->device_type()
+                                       : JUST(query->device())->enum_type();
+    if (device_type == DeviceType::kCPU) {
+      // The cpu kernel needs neither padding nor random state.
+      CHECK_EQ_OR_RETURN(dropout_p, 0.0f)
+          << "scaled_dot_product_attention does not support dropout on cpu.";
+      auto& attrs = THREAD_CACHED_MUTABLE_ATTR_MAP("p_dropout", "softmax_scale", "is_causal",
+                                                   "window_size_left", "window_size_right", "seed");
+      attrs.SetAllAttrs(dropout_p, scale_, is_causal, -1, -1, seed);
+      auto q_ = JUST(functional::Transpose(query, {0, 2, 1, 3}));
+      auto k_ = JUST(functional::Transpose(key, {0, 2, 1, 3}));
+      auto v_ = JUST(functional::Transpose(value, {0, 2, 1, 3}));
+      std::shared_ptr<one::Tensor> output_;
+      if (attn_mask) {
+        auto mask =
+            JUST(MakeAdditiveAttnMask(JUST(attn_mask), query, seqlen_q, max_seqlen_batch_k));
+        output_ =
+            JUST(OpInterpUtil::Dispatch<one::Tensor>(*op_with_mask_, {q_, k_, v_, mask}, attrs));
+      } else {
+        output_ = JUST(OpInterpUtil::Dispatch<one::Tensor>(*op_, {q_, k_, v_}, attrs));
+      }
+      return functional::Transpose(output_, {0, 2, 1, 3});
+    }
+
+#if CUDA_VERSION >= 11070
+    const auto num_heads = query->shape()->At(1);
     // Query (Batch x Num_heads x Q_seq_len  x Dim_per_head)
     // Key   (Batch x Num_heads x KV_seq_len x Dim_per_head)
     // Value (Batch x Num_heads x KV_seq_len x Dim_per_head)
@@ -5500,9 +5644,6 @@ class ScaledDotProductFlashAttentionFunctor {
     // Key   -> Key  (Batch x KV_seq_len x Num_heads x Dim_per_head)
     // Value -> Value(Batch x KV_seq_len x Num_heads x Dim_per_head)
 
-    const auto& scale_ =
-        scale.has_value() ? scale : (1.0f / std::sqrt(static_cast<float>(query->shape()->At(3))));
-
     auto& attrs = THREAD_CACHED_MUTABLE_ATTR_MAP("p_dropout", "softmax_scale", "is_causal",
                                                  "window_size_left", "window_size_right", "seed");
     attrs.SetAllAttrs(dropout_p, scale_, is_causal, -1, -1, seed);
@@ -5529,19 +5670,17 @@ class ScaledDotProductFlashAttentionFunctor {
     return output;
 #endif  // CUDA_VERSION >= 11070
 
-    UNIMPLEMENTED_THEN_RETURN() << "only support CUDA_VERSION >= 11070.";
+    UNIMPLEMENTED_THEN_RETURN() << "only support cpu or CUDA_VERSION >= 11070.";
   }
 
  private:
-#if CUDA_VERSION >= 11070
   std::shared_ptr<OpExpr> op_;
-#endif  // CUDA_VERSION >= 11070
+  std::shared_ptr<OpExpr> op_with_mask_;
 };
 
 class ScaledDotProductFlashAttentionGradFunctor {
  public:
   ScaledDotProductFlashAttentionGradFunctor() {
-#if CUDA_VERSION >= 11070
     op_ = CHECK_JUST(one::OpBuilder("scaled_dot_product_flash_attention_grad")
                          .Input("grad_out")
                          .Input("query")
@@ -5554,7 +5693,19 @@ class ScaledDotProductFlashAttentionGradFunctor {
                          .Output("grad_k")
                          .Output("grad_v")
                          .Build());
-#endif
+    op_with_mask_ = CHECK_JUST(one::OpBuilder("scaled_dot_product_flash_attention_grad")
+                                   .Input("grad_out")
+                                   .Input("query")
+                                   .Input("key")
+                                   .Input("value")
+                                   .Input("out")
+                                   .Input("softmax_lse")
+                                   .Input("rng_state")
+                                   .Input("attn_mask")
+                                   .Output("grad_q")
+                                   .Output("grad_k")
+                                   .Output("grad_v")
+                                   .Build());
   }
 
   Maybe<TensorTuple> operator()(
@@ -5562,8 +5713,7 @@ class ScaledDotProductFlashAttentionGradFunctor {
       const std::shared_ptr<one::Tensor>& key, const std::shared_ptr<one::Tensor>& value,
       const std::shared_ptr<one::Tensor>& out, const std::shared_ptr<one::Tensor>& softmax_lse,
       const std::shared_ptr<one::Tensor>& rng_state, const float& dropout_p, const bool& is_causal,
-      const float& scale) const {
-#if CUDA_VERSION >= 11070
+      const float& scale, const Optional<one::Tensor>& attn_mask) const {
     // grad_out(batch x q_sqe_len  x num_heads x head_size)
     // query   (batch x q_seq_len  x num_heads x head_size_padded)
     // key     (batch x kv_seq_len x num_heads_k x head_size_padded)
@@ -5604,17 +5754,37 @@ class ScaledDotProductFlashAttentionGradFunctor {
     CHECK_EQ_OR_RETURN(head_size_padded, out->shape()->At(3))
         << " out has different head dims from query.";
 
-    bool padded = head_size % 8;
-
-    auto grad_out_ = padded ? JUST(pad_last_dim<8>(grad_out)) : grad_out;
-
     auto& attrs = THREAD_CACHED_MUTABLE_ATTR_MAP("p_dropout", "softmax_scale", "is_causal",
                                                  "window_size_left", "window_size_right");
     attrs.SetAllAttrs(dropout_p, scale, is_causal, -1, -1);
 
+    const DeviceType device_type = query->is_global()
+                                       ? JUST(query->parallel_desc())->device_type()
+                                       : JUST(query->device())->enum_type();
+    bool padded = false;
+    std::shared_ptr<TensorTuple> output_;
+    if (device_type == DeviceType::kCPU) {
+      // attn_mask has been converted to the additive mask by the forward functor.
+      if (attn_mask) {
+        output_ = JUST(OpInterpUtil::Dispatch<TensorTuple>(
+            *op_with_mask_,
+            {grad_out, query, key, value, out, softmax_lse, rng_state, JUST(attn_mask)}, attrs));
+      } else {
+        output_ = JUST(OpInterpUtil::Dispatch<TensorTuple>(
+            *op_, {grad_out, query, key, value, out, softmax_lse, rng_state}, attrs));
+      }
+    } else {
+#if CUDA_VERSION >= 11070
+      padded = head_size % 8;
+      auto grad_out_ = padded ? JUST(pad_last_dim<8>(grad_out)) : grad_out;
+      output_ = JUST(OpInterpUtil::Dispatch<TensorTuple>(
+          *op_, {grad_out_, query, key, value, out, softmax_lse, rng_state}, attrs));
+#else
+      UNIMPLEMENTED_THEN_RETURN() << "only support cpu or CUDA_VERSION >= 11070.";
+#endif  // CUDA_VERSION >= 11070
+    }
+
     auto output = std::make_shared<TensorTuple>(3);
-    auto output_ = JUST(OpInterpUtil::Dispatch<TensorTuple>(
-        *op_, {grad_out_, query, key, value, out, softmax_lse, rng_state}, attrs));
     CHECK_EQ(output_->size(), 3);
     auto grad_q_ = (*output_)[0];
     auto grad_k_ = (*output_)[1];
@@ -5656,16 +5826,11 @@ class ScaledDotProductFlashAttentionGradFunctor {
     (*output)[1] = grad_k;
     (*output)[2] = grad_v;
     return output;
-
-#endif  // CUDA_VERSION >= 11070
-
-    UNIMPLEMENTED_THEN_RETURN() << "only support CUDA_VERSION >= 11070.";
   }
 
  private:
-#if CUDA_VERSION >= 11070
   std::shared_ptr<OpExpr> op_;
-#endif  // CUDA_VERSION >= 11070
+  std::shared_ptr<OpExpr> op_with_mask_;
 };
 }  // namespace impl
 
@@ -5679,6 +5844,7 @@ ONEFLOW_FUNCTION_LIBRARY(m) {
   m.add_functor<impl::DeConv3dFunctor>("Deconv3d");
   m.add_functor<impl::EmbeddingReNormFunctor>("EmbeddingReNorm");
   m.add_functor<impl::EmbeddingFunctor>("Embedding");
+  m.add_functor<impl::EmbeddingBagFunctor>("EmbeddingBag");
   m.add_functor<impl::MatMulFunctor>("MatMul");
   m.add_functor<impl::MatMulNoBroadCastFunctor>("MatMulNoBroadCast");
   m.add_functor<impl::BatchMatMulFunctor>("BatchMatMul");
@@ -5783,6 +5949,7 @@ ONEFLOW_FUNCTION_LIBRARY(m) {
   m.add_functor<impl::OneEmbeddingAdagradUpdateFunctor>("OneEmbeddingAdagradUpdate");
   m.add_functor<impl::OneEmbeddingFtrlUpdateFunctor>("OneEmbeddingFtrlUpdate");
   m.add_functor<impl::RocAucScoreFunctor>("RocAucScore");
+  m.add_functor<impl::RocAucHistogramFunctor>("RocAucHistogram");
   m.add_functor<impl::MultiTensorSgdUpdateFunctor>("MultiTensorSgdUpdate");
   m.add_functor<impl::MultiTensorMomentumUpdateFunctor>("MultiTensorMomentumUpdate");
   m.add_functor<impl::MultiTensorAdamUpdateFunctor>("MultiTensorAdamUpdate");
@@ -121,6 +121,45 @@ class EmbeddingGradFunctor {
   std::shared_ptr<OpExpr> op_;
 };
 
+class EmbeddingBagGradFunctor {
+ public:
+  EmbeddingBagGradFunctor() {
+    op_ = CHECK_JUST(one::OpBuilder("embedding_bag_grad")
+                         .Input("dy")
+                         .Input("weight")
+                         .Input("indices")
+                         .Input("offsets")
+                         .Output("dx")
+                         .Build());
+    weighted_op_ = CHECK_JUST(one::OpBuilder("embedding_bag_grad")
+                                  .Input("dy")
+                                  .Input("weight")
+                                  .Input("indices")
+                                  .Input("offsets")
+                                  .Input("per_sample_weights")
+                                  .Output("dx")
+                                  .Build());
+  }
+  Maybe<Tensor> operator()(const std::shared_ptr<one::Tensor>& dy,
+                           const std::shared_ptr<one::Tensor>& weight,
+                           const std::shared_ptr<one::Tensor>& indices,
+                           const std::shared_ptr<one::Tensor>& offsets,
+                           const Optional<one::Tensor>& per_sample_weights,
+                           const std::string& mode, const int64_t& padding_idx) const {
+    auto& attrs = THREAD_CACHED_MUTABLE_ATTR_MAP("mode", "padding_idx");
+    attrs.SetAllAttrs(mode, padding_idx);
+    if (per_sample_weights) {
+      return OpInterpUtil::Dispatch<Tensor>(
+          *weighted_op_, {dy, weight, indices, offsets, JUST(per_sample_weights)}, attrs);
+    }
+    return OpInterpUtil::Dispatch<Tensor>(*op_, {dy, weight, indices, offsets}, attrs);
+  }
+
+ private:
+  std::shared_ptr<OpExpr> op_;
+  std::shared_ptr<OpExpr> weighted_op_;
+};
+
 class MaxPoolNdGradFunctor {
  public:
   MaxPoolNdGradFunctor() {
@@ -1676,6 +1715,7 @@ ONEFLOW_FUNCTION_LIBRARY(m) {
   m.add_functor<impl::ConvFilterGradFunctor>("ConvFilterGrad");
   m.add_functor<impl::ConvDataGradFunctor>("ConvDataGrad");
   m.add_functor<impl::EmbeddingGradFunctor>("EmbeddingGrad");
+  m.add_functor<impl::EmbeddingBagGradFunctor>("EmbeddingBagGrad");
   m.add_functor<impl::TFPoolNdGradFunctor>("TFPoolNdGrad");
   m.add_functor<impl::AdaptivePoolNdGradFunctor>("AdaptivePoolNdGrad");
   m.add_functor<impl::KLDivLossGradFunctor>("KLDivLossGrad");
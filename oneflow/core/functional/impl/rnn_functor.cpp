@@ -131,6 +131,20 @@ Maybe<Tensor> linear(const std::shared_ptr<one::Tensor>& input,
   }
 }
 
+// The fused rnn cell kernels are available on cuda, and on cpu for float and double.
+Maybe<bool> use_fused_rnn_cell(const std::shared_ptr<one::Tensor>& input) {
+  DeviceType input_device{};
+  if (input->is_global()) {
+    input_device = JUST(input->parallel_desc())->device_type();
+  } else {
+    input_device = JUST(input->device())->enum_type();
+  }
+  if (input_device == DeviceType::kCUDA) { return true; }
+  const DataType input_dtype = input->dtype()->data_type();
+  return input_device == DeviceType::kCPU
+         && (input_dtype == DataType::kFloat || input_dtype == DataType::kDouble);
+}
+
 struct CellParams {
   CellParams(const std::shared_ptr<one::Tensor> _w_ih,  // NOLINT
              const std::shared_ptr<one::Tensor> _w_hh,  // NOLINT
@@ -204,6 +218,11 @@ static Maybe<std::vector<CellParams>> gather_params(const TensorTuple& params, b
 
 template<typename nonlinearity, typename cell_params>
 struct SimpleCell {
+  static Maybe<Tensor> precompute_input(const std::shared_ptr<one::Tensor>& input,
+                                        const cell_params& params) {
+    return params.linear_ih(input);
+  }
+
   Maybe<Tensor> operator()(const std::shared_ptr<one::Tensor>& input,
                            const std::shared_ptr<one::Tensor>& hidden, const cell_params& params,
                            bool pre_compute_input = false) const {
@@ -221,20 +240,20 @@ struct SimpleCell {
 
 template<typename cell_params>
 struct GRUCell {
+  // The fused kernel adds b_ih itself, so the precomputed input of the fused path is the matmul
+  // without bias.
+  static Maybe<Tensor> precompute_input(const std::shared_ptr<one::Tensor>& input,
+                                        const cell_params& params) {
+    if (JUST(use_fused_rnn_cell(input))) { return params.matmul_ih(input); }
+    return params.linear_ih(input);
+  }
+
   Maybe<Tensor> operator()(const std::shared_ptr<one::Tensor>& input,
                            const std::shared_ptr<one::Tensor>& hidden, const cell_params& params,
                            bool pre_compute_input = false) const {
-    DeviceType input_device{};
-    if (input->is_global()) {
-      input_device = JUST(input->parallel_desc())->device_type();
-    } else {
-      input_device = JUST(input->device())->enum_type();
-    }
-
-    if (input_device == DeviceType::kCUDA) {
-      CHECK_OR_RETURN(!pre_compute_input);
-
-      std::shared_ptr<one::Tensor> igates = JUST(params.matmul_ih(input));
+    if (JUST(use_fused_rnn_cell(input))) {
+      std::shared_ptr<one::Tensor> igates =
+          pre_compute_input ? input : JUST(params.matmul_ih(input));
       std::shared_ptr<one::Tensor> hgates = JUST(params.matmul_hh(hidden));
 
       std::shared_ptr<TensorTuple> result =
@@ -271,23 +290,22 @@ struct GRUCell {
 
 template<typename cell_params>
 struct LSTMCell {
+  // See GRUCell::precompute_input.
+  static Maybe<Tensor> precompute_input(const std::shared_ptr<one::Tensor>& input,
+                                        const cell_params& params) {
+    if (JUST(use_fused_rnn_cell(input))) { return params.matmul_ih(input); }
+    return params.linear_ih(input);
+  }
+
   Maybe<TensorTuple> operator()(const std::shared_ptr<one::Tensor>& input,
                                 const one::TensorTuple& hidden, const cell_params& params,
                                 bool pre_compute_input = false) const {
     const std::shared_ptr<Tensor>& hx = hidden[0];
     const std::shared_ptr<Tensor>& cx = hidden[1];
 
-    DeviceType input_device{};
-    if (input->is_global()) {
-      input_device = JUST(input->parallel_desc())->device_type();
-    } else {
-      input_device = JUST(input->device())->enum_type();
-    }
-
-    if (input_device == DeviceType::kCUDA) {
-      CHECK_OR_RETURN(!pre_compute_input);
-
-      std::shared_ptr<one::Tensor> igates = JUST(params.matmul_ih(input));
+    if (JUST(use_fused_rnn_cell(input))) {
+      std::shared_ptr<one::Tensor> igates =
+          pre_compute_input ? input : JUST(params.matmul_ih(input));
       std::shared_ptr<one::Tensor> hgates = JUST(params.matmul_hh(hx));
 
       std::shared_ptr<TensorTuple> result =
@@ -643,6 +661,21 @@ class FusedLstmCellGradFunctor {
   std::shared_ptr<OpExpr> op_without_bias_no_grad_cx_;
 };
 
+// Projects the inputs of all the timesteps with a single matmul instead of one small matmul per
+// timestep, the cells are then called with pre_compute_input = true.
+template<typename cell_type>
+Maybe<TensorTuple> precompute_rnn_inputs(const TensorTuple& inputs, const CellParams& params) {
+  std::shared_ptr<one::Tensor> stacked = JUST(functional::Stack(inputs, 0));
+  const int64_t seq_len = stacked->shape()->At(0);
+  const int64_t batch_size = stacked->shape()->At(1);
+  const int64_t input_size = stacked->shape()->At(2);
+  stacked = JUST(functional::Reshape(stacked, Shape({seq_len * batch_size, input_size})));
+  std::shared_ptr<one::Tensor> projected = JUST(cell_type::precompute_input(stacked, params));
+  const int64_t gate_size = projected->shape()->At(1);
+  projected = JUST(functional::Reshape(projected, Shape({seq_len, batch_size, gate_size})));
+  return functional::Unbind(projected, 0);
+}
+
 template<typename cell_type>
 Maybe<TensorTuple> _rnn_impl(const std::shared_ptr<one::Tensor>& input,
                              const std::shared_ptr<one::Tensor>& hx, const one::TensorTuple& params,
@@ -672,8 +705,9 @@ Maybe<TensorTuple> _rnn_impl(const std::shared_ptr<one::Tensor>& input,
       // forward direction
       std::shared_ptr<one::Tensor> fw_hidden = (*rnn_hiddens)[l * 2];
       auto& fw_cell_param = (*rnn_params)[l * 2];
+      auto fw_inputs = JUST(precompute_rnn_inputs<cell_type>(*rnn_inputs, fw_cell_param));
       for (int32_t i = 0; i < rnn_inputs->size(); ++i) {
-        fw_hidden = JUST(cell_type{}((*rnn_inputs)[i], fw_hidden, fw_cell_param));
+        fw_hidden = JUST(cell_type{}((*fw_inputs)[i], fw_hidden, fw_cell_param, true));
         (*fw_outputs)[i] = fw_hidden;
       }
       final_hiddens.emplace_back(fw_hidden);
@@ -681,8 +715,9 @@ Maybe<TensorTuple> _rnn_impl(const std::shared_ptr<one::Tensor>& input,
       // reverse direction
       std::shared_ptr<one::Tensor> bw_hidden = (*rnn_hiddens)[l * 2 + 1];
       auto& bw_cell_param = (*rnn_params)[l * 2 + 1];
+      auto bw_inputs = JUST(precompute_rnn_inputs<cell_type>(*rnn_inputs, bw_cell_param));
       for (int32_t i = rnn_inputs->size() - 1; i >= 0; i--) {
-        bw_hidden = JUST(cell_type{}((*rnn_inputs)[i], bw_hidden, bw_cell_param));
+        bw_hidden = JUST(cell_type{}((*bw_inputs)[i], bw_hidden, bw_cell_param, true));
         (*bw_outputs)[i] = bw_hidden;
       }
       final_hiddens.emplace_back(bw_hidden);
@@ -704,8 +739,9 @@ Maybe<TensorTuple> _rnn_impl(const std::shared_ptr<one::Tensor>& input,
     for (int32_t l = 0; l < num_layers; ++l) {
       std::shared_ptr<one::Tensor> hidden = (*rnn_hiddens)[l];
       auto& cell_param = (*rnn_params)[l];
+      auto layer_inputs = JUST(precompute_rnn_inputs<cell_type>(*rnn_inputs, cell_param));
       for (int32_t i = 0; i < rnn_inputs->size(); ++i) {
-        hidden = JUST(cell_type{}((*rnn_inputs)[i], hidden, cell_param));
+        hidden = JUST(cell_type{}((*layer_inputs)[i], hidden, cell_param, true));
         (*rnn_inputs)[i] = hidden;
       }
       final_hiddens.emplace_back(hidden);
@@ -973,9 +1009,11 @@ Maybe<TensorTuple> _lstm_impl(const std::shared_ptr<one::Tensor>& input, const o
       (*lstm_cell_out)[0] = (*layer_hxs)[l * 2];
       (*lstm_cell_out)[1] = (*layer_cxs)[l * 2];
       auto& fw_cell_param = (*rnn_params)[l * 2];
+      auto fw_inputs =
+          JUST(precompute_rnn_inputs<LSTMCell<CellParams>>(*rnn_inputs, fw_cell_param));
       for (int32_t i = 0; i < rnn_inputs->size(); ++i) {
         lstm_cell_out =
-            JUST(LSTMCell<CellParams>{}((*rnn_inputs)[i], *lstm_cell_out, fw_cell_param));
+            JUST(LSTMCell<CellParams>{}((*fw_inputs)[i], *lstm_cell_out, fw_cell_param, true));
         (*fw_outputs)[i] = (*lstm_cell_out)[0];
       }
       final_hy.emplace_back((*lstm_cell_out)[0]);
@@ -985,9 +1023,11 @@ Maybe<TensorTuple> _lstm_impl(const std::shared_ptr<one::Tensor>& input, const o
       (*lstm_cell_out)[0] = (*layer_hxs)[l * 2 + 1];
       (*lstm_cell_out)[1] = (*layer_cxs)[l * 2 + 1];
       auto& bw_cell_param = (*rnn_params)[l * 2 + 1];
+      auto bw_inputs =
+          JUST(precompute_rnn_inputs<LSTMCell<CellParams>>(*rnn_inputs, bw_cell_param));
       for (int32_t i = rnn_inputs->size() - 1; i >= 0; i--) {
         lstm_cell_out =
-            JUST(LSTMCell<CellParams>{}((*rnn_inputs)[i], *lstm_cell_out, bw_cell_param));
+            JUST(LSTMCell<CellParams>{}((*bw_inputs)[i], *lstm_cell_out, bw_cell_param, true));
         (*bw_outputs)[i] = (*lstm_cell_out)[0];
       }
       final_hy.emplace_back((*lstm_cell_out)[0]);
@@ -1014,8 +1054,11 @@ Maybe<TensorTuple> _lstm_impl(const std::shared_ptr<one::Tensor>& input, const o
       auto& cell_param = (*rnn_params)[l];
       (*lstm_cell_out)[0] = (*layer_hxs)[l];
       (*lstm_cell_out)[1] = (*layer_cxs)[l];
+      auto layer_inputs =
+          JUST(precompute_rnn_inputs<LSTMCell<CellParams>>(*rnn_inputs, cell_param));
       for (int32_t i = 0; i < rnn_inputs->size(); ++i) {
-        lstm_cell_out = JUST(LSTMCell<CellParams>{}((*rnn_inputs)[i], *lstm_cell_out, cell_param));
+        lstm_cell_out =
+            JUST(LSTMCell<CellParams>{}((*layer_inputs)[i], *lstm_cell_out, cell_param, true));
         (*rnn_inputs)[i] = (*lstm_cell_out)[0];
       }
       final_hy.emplace_back((*lstm_cell_out)[0]);
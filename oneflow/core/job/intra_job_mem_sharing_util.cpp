@@ -39,6 +39,12 @@ enum MemAllocAlgoType {
   kMemVolumeFirstAlgo = 3,
 };
 
+enum MemInsertType {
+  kNonCompactInsert = 0,
+  kCompactInsert = 1,
+  kIntervalTreeInsert = 2,
+};
+
 }  // namespace oneflow
 
 namespace std {
@@ -50,6 +56,13 @@ struct hash<::oneflow::MemAllocAlgoType> {
   }
 };
 
+template<>
+struct hash<::oneflow::MemInsertType> {
+  std::size_t operator()(const ::oneflow::MemInsertType& type) const {
+    return std::hash<int>()(static_cast<size_t>(type));
+  }
+};
+
 }  // namespace std
 
 namespace oneflow {
@@ -335,8 +348,51 @@ void GenRegstAllocFreeTimeLineAndRegstLifetimes(
   CHECK(remain_regsts.empty());
 }
 
+std::string MemAllocAlgoName(MemAllocAlgoType algo_id) {
+  switch (algo_id) {
+    case kMemSizeFirstAlgo: return "mem_size_first";
+    case kLifetimeFirstAlgo: return "lifetime_first";
+    case kTimeLineAlgo: return "time_line";
+    case kMemVolumeFirstAlgo: return "mem_volume_first";
+    default: UNIMPLEMENTED();
+  }
+  return "";
+}
+
+std::string MemInsertName(MemInsertType insert_type) {
+  switch (insert_type) {
+    case kNonCompactInsert: return "non_compact_insert";
+    case kCompactInsert: return "compact_insert";
+    case kIntervalTreeInsert: return "interval_tree_insert";
+    default: UNIMPLEMENTED();
+  }
+  return "";
+}
+
+void MemReusedAllocateByOrder(
+    MemInsertType insert_type, const std::vector<RegstDescProto*>& order,
+    const HashMap<RegstDescProto*, size_t>& mem_reused_regst2size,
+    const HashMap<RegstDescProto*, std::pair<int32_t, int32_t>>& regst2lifetime,
+    MemBlockResultInfo<RegstDescProto*>* result) {
+  if (insert_type == kIntervalTreeInsert) {
+    MemReusedAlgorithmBestFitByOrder(order, mem_reused_regst2size, regst2lifetime, result);
+  } else {
+    MemReusedAlgorithmAllocateByOrder(insert_type == kCompactInsert, order, mem_reused_regst2size,
+                                      regst2lifetime, result);
+  }
+}
+
+void MemReusedMemSizeFirstAlgo(
+    MemInsertType insert_type,
+    const HashMap<RegstDescProto*, std::pair<int32_t, int32_t>>& regst2lifetime,
+    const HashMap<RegstDescProto*, size_t>& mem_reused_regst2size,
+    MemBlockResultInfo<RegstDescProto*>* result) {
+  MemReusedAllocateByOrder(insert_type, GenMemSizeFirstOrder(regst2lifetime, mem_reused_regst2size),
+                           mem_reused_regst2size, regst2lifetime, result);
+}
+
 void MemReusedLifetimeFirstAlgo(
-    const bool compact_insert,
+    MemInsertType insert_type,
     const HashMap<RegstDescProto*, std::pair<int32_t, int32_t>>& regst2lifetime,
     const HashMap<RegstDescProto*, size_t>& mem_reused_regst2size,
     MemBlockResultInfo<RegstDescProto*>* result) {
@@ -349,12 +405,11 @@ void MemReusedLifetimeFirstAlgo(
     if (l_value == r_value) { return regst2lifetime.at(lhs).first < regst2lifetime.at(rhs).first; }
     return l_value > r_value;
   });
-  MemReusedAlgorithmAllocateByOrder(compact_insert, order, mem_reused_regst2size, regst2lifetime,
-                                    result);
+  MemReusedAllocateByOrder(insert_type, order, mem_reused_regst2size, regst2lifetime, result);
 }
 
 void MemReusedTimeLineAlgo(
-    const bool compact_insert,
+    MemInsertType insert_type,
     const HashMap<RegstDescProto*, std::pair<int32_t, int32_t>>& regst2lifetime,
     const HashMap<RegstDescProto*, size_t>& mem_reused_regst2size,
     MemBlockResultInfo<RegstDescProto*>* result) {
@@ -369,12 +424,11 @@ void MemReusedTimeLineAlgo(
     }
     return l_value > r_value;
   });
-  MemReusedAlgorithmAllocateByOrder(compact_insert, order, mem_reused_regst2size, regst2lifetime,
-                                    result);
+  MemReusedAllocateByOrder(insert_type, order, mem_reused_regst2size, regst2lifetime, result);
 }
 
 void MemReusedMemVolumeFirstAlgo(
-    const bool compact_insert,
+    MemInsertType insert_type,
     const HashMap<RegstDescProto*, std::pair<int32_t, int32_t>>& regst2lifetime,
     const HashMap<RegstDescProto*, size_t>& mem_reused_regst2size,
     MemBlockResultInfo<RegstDescProto*>* result) {
@@ -393,84 +447,74 @@ void MemReusedMemVolumeFirstAlgo(
     }
     return l_value > r_value;
   });
-  MemReusedAlgorithmAllocateByOrder(compact_insert, order, mem_reused_regst2size, regst2lifetime,
-                                    result);
+  MemReusedAllocateByOrder(insert_type, order, mem_reused_regst2size, regst2lifetime, result);
 }
 
 void SelectAlgorithmGenMemBlockOffset4Regsts(
-    MemAllocAlgoType algo_id, const bool compact_insert,
+    MemAllocAlgoType algo_id, MemInsertType insert_type,
     const HashMap<RegstDescProto*, std::pair<int32_t, int32_t>>& regst2lifetime,
     const HashMap<RegstDescProto*, size_t>& mem_reused_regst2size,
     MemBlockResultInfo<RegstDescProto*>* result) {
   CHECK_EQ(result->mem_block_size, 0);
   CHECK(result->regst_desc2offset.empty());
 
+  double start_time = GetCurTime();
   switch (algo_id) {
     case kMemSizeFirstAlgo:
-      MemReusedMemSizeFirstAlgo(compact_insert, regst2lifetime, mem_reused_regst2size, result);
+      MemReusedMemSizeFirstAlgo(insert_type, regst2lifetime, mem_reused_regst2size, result);
       break;
     case kLifetimeFirstAlgo:
-      MemReusedLifetimeFirstAlgo(compact_insert, regst2lifetime, mem_reused_regst2size, result);
+      MemReusedLifetimeFirstAlgo(insert_type, regst2lifetime, mem_reused_regst2size, result);
       break;
     case kTimeLineAlgo:
-      MemReusedTimeLineAlgo(compact_insert, regst2lifetime, mem_reused_regst2size, result);
+      MemReusedTimeLineAlgo(insert_type, regst2lifetime, mem_reused_regst2size, result);
       break;
     case kMemVolumeFirstAlgo:
-      MemReusedMemVolumeFirstAlgo(compact_insert, regst2lifetime, mem_reused_regst2size, result);
+      MemReusedMemVolumeFirstAlgo(insert_type, regst2lifetime, mem_reused_regst2size, result);
       break;
     default: UNIMPLEMENTED();
   }
+  // GetCurTime() is in nanoseconds
+  result->elapsed_time_ms = (GetCurTime() - start_time) / 1e6;
   CHECK_GT(result->mem_block_size, 0);
   CHECK(!result->regst_desc2offset.empty());
 }
 
-int64_t CountMemAllocAlgoNum() {
-  const MemoryAllocationAlgorithmConf& mem_alloc_algo_conf =
-      GlobalJobDesc().job_conf().memory_allocation_algorithm_conf();
-  int64_t alloc_algo_num = 0;
-  if (mem_alloc_algo_conf.use_mem_size_first_algo()) { ++alloc_algo_num; }
-  if (mem_alloc_algo_conf.use_lifetime_first_algo()) { ++alloc_algo_num; }
-  if (mem_alloc_algo_conf.use_time_line_algo()) { ++alloc_algo_num; }
-  if (mem_alloc_algo_conf.use_mem_volume_first_algo()) { ++alloc_algo_num; }
-  CHECK_GE(alloc_algo_num, 0) << "At least choose one type of memory allocation algorithm. We "
-                                 "recommend use_mem_size_first_algo()";
-  const MemoryCompactInsertConf& mem_compact_insert_conf =
-      GlobalJobDesc().job_conf().memory_compact_insert_conf();
-  int64_t compact_insert_num = 0;
-  if (mem_compact_insert_conf.use_compact_insert()) { ++compact_insert_num; }
-  if (mem_compact_insert_conf.use_non_compact_insert()) { ++compact_insert_num; }
-  CHECK_GE(compact_insert_num, 0) << "At least choose one type of memory arrangement algorithm "
-                                     "during memory allocation. We recommend use_compact_insert()";
-
-  return alloc_algo_num * compact_insert_num;
-}
-
 void InitAlgo2Result(
-    HashMap<std::pair<MemAllocAlgoType, bool>, MemBlockResultInfo<RegstDescProto*>>* algo2result) {
+    size_t mem_reused_regst_num,
+    HashMap<std::pair<MemAllocAlgoType, MemInsertType>, MemBlockResultInfo<RegstDescProto*>>*
+        algo2result) {
   CHECK(algo2result->empty());
-  std::vector<bool> compact_insert_algorithms;
+  std::vector<MemInsertType> insert_types;
   const MemoryCompactInsertConf& mem_compact_insert_conf =
       GlobalJobDesc().job_conf().memory_compact_insert_conf();
-  if (mem_compact_insert_conf.use_compact_insert()) { compact_insert_algorithms.push_back(true); }
-  if (mem_compact_insert_conf.use_non_compact_insert()) {
-    compact_insert_algorithms.push_back(false);
+  // NOTE: Compact insertion and non-compact insertion scan all the placed registers for each
+  // inserting one, which takes O(n^2) time. For a memory chain with too many registers, we use the
+  // interval tree insertion instead.
+  if (mem_reused_regst_num
+      <= static_cast<size_t>(mem_compact_insert_conf.interval_tree_insert_threshold())) {
+    if (mem_compact_insert_conf.use_compact_insert()) { insert_types.push_back(kCompactInsert); }
+    if (mem_compact_insert_conf.use_non_compact_insert()) {
+      insert_types.push_back(kNonCompactInsert);
+    }
+  }
+  if (mem_compact_insert_conf.use_interval_tree_insert() || insert_types.empty()) {
+    insert_types.push_back(kIntervalTreeInsert);
   }
 
   const MemoryAllocationAlgorithmConf& mem_alloc_algo_conf =
       GlobalJobDesc().job_conf().memory_allocation_algorithm_conf();
+  std::vector<MemAllocAlgoType> algo_ids;
   // NOTE: Experiments show that memory first might be good enough for some cases.
-  for (auto compact_insert : compact_insert_algorithms) {
-    if (mem_alloc_algo_conf.use_mem_size_first_algo()) {
-      (*algo2result)[{kMemSizeFirstAlgo, compact_insert}] = MemBlockResultInfo<RegstDescProto*>();
-    }
-    if (mem_alloc_algo_conf.use_lifetime_first_algo()) {
-      (*algo2result)[{kLifetimeFirstAlgo, compact_insert}] = MemBlockResultInfo<RegstDescProto*>();
-    }
-    if (mem_alloc_algo_conf.use_time_line_algo()) {
-      (*algo2result)[{kTimeLineAlgo, compact_insert}] = MemBlockResultInfo<RegstDescProto*>();
-    }
-    if (mem_alloc_algo_conf.use_mem_volume_first_algo()) {
-      (*algo2result)[{kMemVolumeFirstAlgo, compact_insert}] = MemBlockResultInfo<RegstDescProto*>();
+  if (mem_alloc_algo_conf.use_mem_size_first_algo()) { algo_ids.push_back(kMemSizeFirstAlgo); }
+  if (mem_alloc_algo_conf.use_lifetime_first_algo()) { algo_ids.push_back(kLifetimeFirstAlgo); }
+  if (mem_alloc_algo_conf.use_time_line_algo()) { algo_ids.push_back(kTimeLineAlgo); }
+  if (mem_alloc_algo_conf.use_mem_volume_first_algo()) { algo_ids.push_back(kMemVolumeFirstAlgo); }
+  CHECK(!algo_ids.empty()) << "At least choose one type of memory allocation algorithm. We "
+                              "recommend use_mem_size_first_algo()";
+  for (auto insert_type : insert_types) {
+    for (auto algo_id : algo_ids) {
+      (*algo2result)[{algo_id, insert_type}] = MemBlockResultInfo<RegstDescProto*>();
     }
   }
 }
@@ -507,22 +551,27 @@ void IntraJobMemSharingUtil::InferMemBlockId4MemReusedRegst(Plan* plan) {
   }
 
   // step 2: multi-thread run several algorithm for each mem chain
-  HashMap<int64_t, HashMap<std::pair<MemAllocAlgoType, bool>, MemBlockResultInfo<RegstDescProto*>>>
+  HashMap<int64_t, HashMap<std::pair<MemAllocAlgoType, MemInsertType>,
+                           MemBlockResultInfo<RegstDescProto*>>>
       mem_chain2algo2result;
   {
-    int64_t work_size = mem_chain2mem_reused_regsts.size() * CountMemAllocAlgoNum();
+    int64_t work_size = 0;
+    for (int64_t mem_chain_id : mem_chains) {
+      auto& algo2result = mem_chain2algo2result[mem_chain_id];
+      InitAlgo2Result(mem_chain2regst2lifetime.at(mem_chain_id).size(), &algo2result);
+      work_size += algo2result.size();
+    }
     int64_t thread_pool_size = std::min<int64_t>(work_size, std::thread::hardware_concurrency());
     BlockingCounter counter(work_size);
     ThreadPool thread_pool(thread_pool_size);
     for (int64_t mem_chain_id : mem_chains) {
-      InitAlgo2Result(&mem_chain2algo2result[mem_chain_id]);
       for (auto& pair : mem_chain2algo2result.at(mem_chain_id)) {
         MemAllocAlgoType algo_id = pair.first.first;
-        bool compact_insert = pair.first.second;
+        MemInsertType insert_type = pair.first.second;
         MemBlockResultInfo<RegstDescProto*>* result = &pair.second;
-        thread_pool.AddWork([algo_id, compact_insert, mem_chain_id, &mem_chain2regst2lifetime,
+        thread_pool.AddWork([algo_id, insert_type, mem_chain_id, &mem_chain2regst2lifetime,
                              &mem_reused_regst2size, result, &counter]() {
-          SelectAlgorithmGenMemBlockOffset4Regsts(algo_id, compact_insert,
+          SelectAlgorithmGenMemBlockOffset4Regsts(algo_id, insert_type,
                                                   mem_chain2regst2lifetime.at(mem_chain_id),
                                                   mem_reused_regst2size, result);
           counter.Decrease();
@@ -539,6 +588,14 @@ void IntraJobMemSharingUtil::InferMemBlockId4MemReusedRegst(Plan* plan) {
       if (!best_result || algo_result_pair.second.mem_block_size < best_result->mem_block_size) {
         best_result = &algo_result_pair.second;
       }
+      // Report the peak memory versus the compile time of each algorithm
+      VLOG(2) << "Memory chain " << pair.first << " with "
+              << mem_chain2regst2lifetime.at(pair.first).size() << " registers, "
+              << MemAllocAlgoName(algo_result_pair.first.first) << " + "
+              << MemInsertName(algo_result_pair.first.second)
+              << ": memory size = " << algo_result_pair.second.mem_block_size
+              << " (lower bound = " << mem_chain2peak_memory.at(pair.first)
+              << "), time = " << algo_result_pair.second.elapsed_time_ms << " ms";
     }
     CHECK(best_result != nullptr);
 
@@ -18,6 +18,7 @@ limitations under the License.
 
 #include "oneflow/core/common/data_type.h"
 #include "oneflow/core/common/hash_container.h"
+#include "oneflow/core/job/lifetime_interval_tree.h"
 #include "oneflow/core/job/memory_share_strategy.h"
 #include "oneflow/core/job/plan.pb.h"
 #include <functional>
@@ -33,6 +34,8 @@ template<class T>
 struct MemBlockResultInfo {
   size_t mem_block_size;
   HashMap<T, int64_t> regst_desc2offset;
+  // Time used to generate this result, in milliseconds
+  double elapsed_time_ms = 0.0;
 };
 
 // Judge whether a is suitable than b for a gap
@@ -162,11 +165,78 @@ void MemReusedAlgorithmAllocateByOrder(
   }
 }
 
+// Allocate the registers following the given order.
+// Each register is placed into the most suitable gap between the placed registers which are
+// excluded with it. Those registers are found by an interval tree of lifetimes, and no placed
+// register would be moved afterward. Therefore, the time complexity is O(n * (log(n) + k*log(k)))
+// instead of O(n^2), where k is the number of registers alive at the same time.
 template<class T>
-void MemReusedMemSizeFirstAlgo(const bool compact_insert,
-                               const HashMap<T, std::pair<int32_t, int32_t>>& regst2lifetime,
-                               const HashMap<T, size_t>& mem_reused_regst2size,
-                               MemBlockResultInfo<T>* result) {
+void MemReusedAlgorithmBestFitByOrder(const std::vector<T>& order,
+                                      const HashMap<T, size_t>& regst_desc2size,
+                                      const HashMap<T, std::pair<int32_t, int32_t>>& regst2lifetime,
+                                      MemBlockResultInfo<T>* result) {
+  HashMap<T, int64_t>* regst_desc2offset = &(result->regst_desc2offset);
+  int32_t total_register_num = order.size();
+  std::vector<int64_t> order2size(total_register_num);
+  std::vector<std::pair<int32_t, int32_t>> order2lifetime(total_register_num);
+  // A negative offset means that the register has not been placed yet
+  std::vector<int64_t> order2offset(total_register_num, -1);
+  for (int32_t i = 0; i < total_register_num; i++) {
+    order2size[i] = regst_desc2size.at(order[i]);
+    order2lifetime[i] = regst2lifetime.at(order[i]);
+  }
+  LifetimeIntervalTree lifetime_tree(order2lifetime);
+  size_t buffer_size = 1;
+  // [offset, offset + size) of the placed registers which are excluded with the inserting one
+  std::vector<std::pair<int64_t, int64_t>> occupied_intervals;
+  for (int32_t inserting_id = 0; inserting_id < total_register_num; inserting_id++) {
+    occupied_intervals.clear();
+    lifetime_tree.ForEachOverlapped(order2lifetime[inserting_id], [&](int32_t curr_register) {
+      if (order2offset[curr_register] >= 0) {
+        occupied_intervals.emplace_back(order2offset[curr_register],
+                                        order2offset[curr_register] + order2size[curr_register]);
+      }
+    });
+    std::sort(occupied_intervals.begin(), occupied_intervals.end());
+    int64_t inserting_size = order2size[inserting_id];
+    // Find the most suitable gap for the register
+    int64_t gap_head = 0;
+    int64_t inserting_offset = 0;
+    // difference = length of gap - length of the inserting register
+    int64_t suitable_diff_gap = -1 - inserting_size;
+    for (const auto& occupied_interval : occupied_intervals) {
+      if (gap_head < occupied_interval.first) {
+        int64_t diff_gap = (occupied_interval.first - gap_head) - inserting_size;
+        if (SuitableThan(diff_gap, suitable_diff_gap)) {
+          suitable_diff_gap = diff_gap;
+          inserting_offset = gap_head;
+        }
+      }
+      gap_head = std::max(gap_head, occupied_interval.second);
+    }
+    // Deal with the buffer_size, which may be the final gap
+    int64_t diff_gap = (static_cast<int64_t>(buffer_size) - gap_head) - inserting_size;
+    if (SuitableThan(diff_gap, suitable_diff_gap)) {
+      suitable_diff_gap = diff_gap;
+      inserting_offset = gap_head;
+    }
+    // If no gap large enough to contain the current register, place it behind all the excluded
+    // registers and prolong the memory pool.
+    if (suitable_diff_gap < 0) { inserting_offset = gap_head; }
+    order2offset[inserting_id] = inserting_offset;
+    buffer_size = std::max<size_t>(buffer_size, inserting_offset + inserting_size);
+  }
+
+  result->mem_block_size = buffer_size;
+  // Switch vector to HashMap
+  for (int32_t i = 0; i < total_register_num; i++) {
+    (*regst_desc2offset)[order[i]] = order2offset[i];
+  }
+}
+
+template<class T>
+std::vector<T> GenMemSizeFirstOrder(const HashMap<T, std::pair<int32_t, int32_t>>& regst2lifetime,
+                                    const HashMap<T, size_t>& mem_reused_regst2size) {
   std::vector<T> order;
   order.reserve(regst2lifetime.size());
   for (const auto& pair : regst2lifetime) { order.emplace_back(pair.first); }
@@ -176,8 +246,17 @@ void MemReusedMemSizeFirstAlgo(const bool compact_insert,
     if (l_value == r_value) { return regst2lifetime.at(lhs).first < regst2lifetime.at(rhs).first; }
     return l_value > r_value;
   });
-  MemReusedAlgorithmAllocateByOrder(compact_insert, order, mem_reused_regst2size, regst2lifetime,
-                                    result);
+  return order;
+}
+
+template<class T>
+void MemReusedMemSizeFirstAlgo(const bool compact_insert,
+                               const HashMap<T, std::pair<int32_t, int32_t>>& regst2lifetime,
+                               const HashMap<T, size_t>& mem_reused_regst2size,
+                               MemBlockResultInfo<T>* result) {
+  MemReusedAlgorithmAllocateByOrder(compact_insert,
+                                    GenMemSizeFirstOrder(regst2lifetime, mem_reused_regst2size),
+                                    mem_reused_regst2size, regst2lifetime, result);
 }
 
 }  // namespace oneflow
@@ -0,0 +1,116 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include <random>
+#include "gtest/gtest.h"
+#include "oneflow/core/job/intra_job_mem_sharing_util.h"
+#include "oneflow/core/job/lifetime_interval_tree.h"
+
+namespace oneflow {
+
+namespace {
+
+void GenRandomRegsts(int32_t regst_num, int32_t max_time, HashMap<int32_t, size_t>* regst2size,
+                     HashMap<int32_t, std::pair<int32_t, int32_t>>* regst2lifetime) {
+  std::mt19937 gen(regst_num);
+  std::uniform_int_distribution<int32_t> time_dist(0, max_time - 1);
+  std::uniform_int_distribution<int32_t> duration_dist(1, max_time / 8 + 1);
+  std::uniform_int_distribution<size_t> size_dist(1, 4096);
+  for (int32_t i = 0; i < regst_num; i++) {
+    int32_t start = time_dist(gen);
+    (*regst2lifetime)[i] = {start, start + duration_dist(gen)};
+    (*regst2size)[i] = size_dist(gen);
+  }
+}
+
+size_t ComputeLowerBound(int32_t max_time, const HashMap<int32_t, size_t>& regst2size,
+                         const HashMap<int32_t, std::pair<int32_t, int32_t>>& regst2lifetime) {
+  std::vector<size_t> time2memory(max_time * 2, 0);
+  for (const auto& pair : regst2lifetime) {
+    for (int32_t t = pair.second.first; t < pair.second.second; t++) {
+      time2memory[t] += regst2size.at(pair.first);
+    }
+  }
+  return *std::max_element(time2memory.begin(), time2memory.end());
+}
+
+void CheckNoConflict(const HashMap<int32_t, size_t>& regst2size,
+                     const HashMap<int32_t, std::pair<int32_t, int32_t>>& regst2lifetime,
+                     const MemBlockResultInfo<int32_t>& result) {
+  ASSERT_EQ(result.regst_desc2offset.size(), regst2size.size());
+  for (const auto& i : result.regst_desc2offset) {
+    ASSERT_GE(i.second, 0);
+    ASSERT_LE(i.second + regst2size.at(i.first), result.mem_block_size);
+    for (const auto& j : result.regst_desc2offset) {
+      if (i.first == j.first
+          || !IsLifetimeExcluded(regst2lifetime.at(i.first), regst2lifetime.at(j.first))) {
+        continue;
+      }
+      ASSERT_TRUE(i.second + regst2size.at(i.first) <= j.second
+                  || j.second + regst2size.at(j.first) <= i.second);
+    }
+  }
+}
+
+}  // namespace
+
+TEST(LifetimeIntervalTree, for_each_overlapped) {
+  HashMap<int32_t, size_t> regst2size;
+  HashMap<int32_t, std::pair<int32_t, int32_t>> regst2lifetime;
+  GenRandomRegsts(500, 200, &regst2size, &regst2lifetime);
+  std::vector<std::pair<int32_t, int32_t>> id2lifetime(regst2lifetime.size());
+  for (const auto& pair : regst2lifetime) { id2lifetime[pair.first] = pair.second; }
+  LifetimeIntervalTree lifetime_tree(id2lifetime);
+  ASSERT_EQ(lifetime_tree.size(), id2lifetime.size());
+  for (int32_t i = 0; i < static_cast<int32_t>(id2lifetime.size()); i++) {
+    std::vector<int32_t> overlapped;
+    lifetime_tree.ForEachOverlapped(id2lifetime[i], [&](int32_t j) { overlapped.push_back(j); });
+    std::sort(overlapped.begin(), overlapped.end());
+    std::vector<int32_t> expected;
+    for (int32_t j = 0; j < static_cast<int32_t>(id2lifetime.size()); j++) {
+      if (IsLifetimeExcluded(id2lifetime[i], id2lifetime[j])) { expected.push_back(j); }
+    }
+    ASSERT_EQ(overlapped, expected);
+  }
+}
+
+TEST(IntraJobMemSharingUtil, best_fit_by_order) {
+  for (int32_t regst_num : {1, 10, 100, 1000}) {
+    HashMap<int32_t, size_t> regst2size;
+    HashMap<int32_t, std::pair<int32_t, int32_t>> regst2lifetime;
+    GenRandomRegsts(regst_num, regst_num, &regst2size, &regst2lifetime);
+    MemBlockResultInfo<int32_t> result;
+    MemReusedAlgorithmBestFitByOrder(GenMemSizeFirstOrder(regst2lifetime, regst2size), regst2size,
+                                     regst2lifetime, &result);
+    CheckNoConflict(regst2size, regst2lifetime, result);
+    ASSERT_GE(result.mem_block_size, ComputeLowerBound(regst_num, regst2size, regst2lifetime));
+  }
+}
+
+TEST(IntraJobMemSharingUtil, best_fit_reuse_gap) {
+  // Register 0 and 1 live together, register 2 lives after register 0 and together with 1.
+  // Register 2 should reuse the memory of register 0.
+  HashMap<int32_t, size_t> regst2size{{0, 100}, {1, 50}, {2, 80}};
+  HashMap<int32_t, std::pair<int32_t, int32_t>> regst2lifetime{
+      {0, {0, 2}}, {1, {0, 4}}, {2, {2, 4}}};
+  MemBlockResultInfo<int32_t> result;
+  MemReusedAlgorithmBestFitByOrder(GenMemSizeFirstOrder(regst2lifetime, regst2size), regst2size,
+                                   regst2lifetime, &result);
+  CheckNoConflict(regst2size, regst2lifetime, result);
+  ASSERT_EQ(result.mem_block_size, 150);
+  ASSERT_EQ(result.regst_desc2offset.at(2), result.regst_desc2offset.at(0));
+}
+
+}  // namespace oneflow
@@ -0,0 +1,99 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_CORE_JOB_LIFETIME_INTERVAL_TREE_H_
+#define ONEFLOW_CORE_JOB_LIFETIME_INTERVAL_TREE_H_
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <numeric>
+#include <utility>
+#include <vector>
+
+namespace oneflow {
+
+// A static interval tree over the lifetimes [first, second) of registers.
+// The intervals are sorted by their start time and stored in an implicit balanced binary search
+// tree, the node of the range [lo, hi) is mid = (lo + hi) / 2. Each node records the maximum end
+// time of its subtree so that the query of all the lifetimes overlapping with a given one costs
+// O(log(n) + k) instead of O(n), where k is the number of overlapped lifetimes.
+class LifetimeIntervalTree final {
+ public:
+  explicit LifetimeIntervalTree(const std::vector<std::pair<int32_t, int32_t>>& id2lifetime)
+      : sorted_ids_(id2lifetime.size()),
+        sorted_start_(id2lifetime.size()),
+        sorted_end_(id2lifetime.size()),
+        subtree_max_end_(id2lifetime.size()) {
+    std::iota(sorted_ids_.begin(), sorted_ids_.end(), 0);
+    std::sort(sorted_ids_.begin(), sorted_ids_.end(), [&](int32_t lhs, int32_t rhs) {
+      if (id2lifetime[lhs].first != id2lifetime[rhs].first) {
+        return id2lifetime[lhs].first < id2lifetime[rhs].first;
+      }
+      return lhs < rhs;
+    });
+    for (int32_t i = 0; i < static_cast<int32_t>(sorted_ids_.size()); i++) {
+      sorted_start_[i] = id2lifetime[sorted_ids_[i]].first;
+      sorted_end_[i] = id2lifetime[sorted_ids_[i]].second;
+    }
+    InitSubtreeMaxEnd(0, sorted_ids_.size());
+  }
+  ~LifetimeIntervalTree() = default;
+
+  // Call Handler(id) for each stored lifetime which overlaps with the given one.
+  // The ids are visited in the ascending order of their start time.
+  template<typename HandlerT>
+  void ForEachOverlapped(const std::pair<int32_t, int32_t>& lifetime,
+                         const HandlerT& Handler) const {
+    ForEachOverlapped(0, sorted_ids_.size(), lifetime.first, lifetime.second, Handler);
+  }
+
+  size_t size() const { return sorted_ids_.size(); }
+
+ private:
+  int32_t InitSubtreeMaxEnd(int32_t lo, int32_t hi) {
+    if (lo >= hi) { return GetMinEnd(); }
+    int32_t mid = lo + (hi - lo) / 2;
+    subtree_max_end_[mid] =
+        std::max({sorted_end_[mid], InitSubtreeMaxEnd(lo, mid), InitSubtreeMaxEnd(mid + 1, hi)});
+    return subtree_max_end_[mid];
+  }
+
+  template<typename HandlerT>
+  void ForEachOverlapped(int32_t lo, int32_t hi, int32_t start, int32_t end,
+                         const HandlerT& Handler) const {
+    if (lo >= hi) { return; }
+    int32_t mid = lo + (hi - lo) / 2;
+    // No lifetime in this subtree ends after the start
+    if (subtree_max_end_[mid] <= start) { return; }
+    ForEachOverlapped(lo, mid, start, end, Handler);
+    // The lifetimes in the right subtree start even later
+    if (sorted_start_[mid] >= end) { return; }
+    // NOTE: Same as IsLifetimeExcluded()
+    if (start < sorted_end_[mid]) { Handler(sorted_ids_[mid]); }
+    ForEachOverlapped(mid + 1, hi, start, end, Handler);
+  }
+
+  static int32_t GetMinEnd() { return std::numeric_limits<int32_t>::min(); }
+
+  std::vector<int32_t> sorted_ids_;
+  std::vector<int32_t> sorted_start_;
+  std::vector<int32_t> sorted_end_;
+  std::vector<int32_t> subtree_max_end_;
+};
+
+}  // namespace oneflow
+
+#endif  // ONEFLOW_CORE_JOB_LIFETIME_INTERVAL_TREE_H_
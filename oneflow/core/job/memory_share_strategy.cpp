@@ -20,6 +20,7 @@ limitations under the License.
 #include "oneflow/core/common/hash_container.h"
 #include "oneflow/core/common/just.h"
 #include "oneflow/core/common/maybe.h"
+#include "oneflow/core/job/lifetime_interval_tree.h"
 #include "oneflow/core/register/runtime_register_desc.h"
 
 namespace oneflow {
@@ -85,24 +86,37 @@ void MemoryShareStrategy::StealCompactPosition(
   // should_visit_[i] = 2: should visit i, i is not excluded with j
   should_visit_.clear();
   should_visit_.resize(total_register_num_, 0);
+  eliminated_stamp_.clear();
+  eliminated_stamp_.resize(total_register_num_, 0);
+  current_stamp_ = 0;
   register_offset_.resize(total_register_num_);
-  // Generate a compact relationship of position
-  // For example we have 3 relationship: x1 < x2, x2 < x3, x1 < x3
-  // We would delete the redundant relationship (x1 < x3)
+  std::vector<std::pair<int32_t, int32_t>> index2lifetime(total_register_num_);
   for (int32_t j = 0; j < total_register_num_; j++) {
     const auto& register_j = index2register_[j];
     register_offset_[j] = regst_desc2offset.at(register_j);
-    auto& excluded_register_j = excluded_registers_[j];
-    const auto& lifetime_j = register2lifetime.at(register_j);
-    // Init should visit with all orders of the excluded register
-    for (int32_t i = j + 1; i < total_register_num_; i++) {
-      if (IsLifetimeExcluded(lifetime_j, register2lifetime.at(index2register_[i]))) {
-        // Copy the data to excluded registers
-        excluded_register_j.insert(i);
-        excluded_registers_[i].insert(j);
-      }
+    index2lifetime[j] = register2lifetime.at(register_j);
+  }
+  // Find all the registers which exist simultaneously.
+  // Querying an interval tree takes O(n * log(n) + k) time instead of O(n^2) for comparing all the
+  // pairs, where k is the number of the excluded pairs.
+  // The pairs are inserted in the ascending order of (j, i) for i > j, same as comparing all the
+  // pairs, since the iteration order of the hash sets decides the result of the later search.
+  LifetimeIntervalTree lifetime_tree(index2lifetime);
+  std::vector<int32_t> overlapped_registers;
+  for (int32_t j = 0; j < total_register_num_; j++) {
+    overlapped_registers.clear();
+    lifetime_tree.ForEachOverlapped(index2lifetime[j], [&](int32_t i) {
+      if (i > j) { overlapped_registers.push_back(i); }
+    });
+    std::sort(overlapped_registers.begin(), overlapped_registers.end());
+    for (int32_t i : overlapped_registers) {
+      excluded_registers_[j].insert(i);
+      excluded_registers_[i].insert(j);
     }
   }
+  // Generate a compact relationship of position
+  // For example we have 3 relationship: x1 < x2, x2 < x3, x1 < x3
+  // We would delete the redundant relationship (x1 < x3)
 
   for (int32_t j = 0; j < total_register_num_; j++) { ResetCompactPosition(j); }
 }
@@ -355,52 +369,48 @@ void MemoryShareStrategy::UpdateOffset(size_t* mem_block_size,
 
 // Find all the k < i, eliminates k < j,
 // since k < i and i < j have already implied that.
-void MemoryShareStrategy::EliminateRedundantRelationship(int32_t i) {
-  // If i is already eliminate, skip it.
-  if (should_visit_[i]) {
-    for (int32_t k : left_registers_[i]) {
-      // Eliminate all the k < i
-      EliminateRedundantRelationship(k);
-      // Eliminate left[i]
-      should_visit_[k] = 0;
+void MemoryShareStrategy::EliminateRedundantRelationship(int32_t i, int64_t offset_j) {
+  for (int32_t k : left_registers_[i]) {
+    // If k is already eliminated, all the registers on the left of k are eliminated too.
+    // The registers which are not on the left of j are not visited.
+    if (register_offset_[k] < offset_j && eliminated_stamp_[k] != current_stamp_) {
+      // Eliminate all the k' < k
+      EliminateRedundantRelationship(k, offset_j);
     }
+    // Eliminate left[i]
+    eliminated_stamp_[k] = current_stamp_;
   }
 }
 
 // Reset the compact position for the registers
 void MemoryShareStrategy::ResetCompactPosition(int32_t j) {
   left_registers_[j].clear();
-  // Mark all the registers on the left
-  for (int32_t i = 0; i < total_register_num_; i++) {
-    if (register_offset_[i] < register_offset_[j]) {
-      if (Exclude(i, j)) {
-        should_visit_[i] = 1;
-      } else {
-        should_visit_[i] = 2;
-      }
-    } else {
-      // Might be unnecessary since we clear up should_visit_ before.
-      should_visit_[i] = 0;
-    }
+  // Only the excluded registers on the left could be the first registers on the left of j.
+  // All the registers on the left of them have smaller offsets, thus we just need to visit them
+  // instead of marking all the registers with smaller offsets, which takes O(n) time.
+  // They are visited in the ascending order of their indices, which keeps the iteration order of
+  // left_registers_[j].
+  const int64_t offset_j = register_offset_[j];
+  left_candidates_.clear();
+  for (int32_t i : excluded_registers_[j]) {
+    if (register_offset_[i] < offset_j) { left_candidates_.push_back(i); }
   }
-
-  for (int32_t i = 0; i < total_register_num_; i++) {
-    if (should_visit_[i] == 1) {
+  std::sort(left_candidates_.begin(), left_candidates_.end());
+  // A new stamp is equivalent to un-eliminating all the registers.
+  current_stamp_++;
+  for (int32_t i : left_candidates_) {
+    if (eliminated_stamp_[i] != current_stamp_) {
       // Find all the k < i, eliminates k < j,
       // since k < i and i < j have already implied that.
-      // Also reset should_visit_[i] to false,
-      // since we have already visited i.
-      EliminateRedundantRelationship(i);
+      EliminateRedundantRelationship(i, offset_j);
     }
   }
 
-  for (int32_t i = 0; i < total_register_num_; i++) {
-    if (should_visit_[i] == 1) {
+  for (int32_t i : left_candidates_) {
+    if (eliminated_stamp_[i] != current_stamp_) {
       // i < j
       left_registers_[j].insert(i);
     }
-    // Might be unnecessary since we clear up should_visit_ before.
-    should_visit_[i] = 0;
   }
 }
 
@@ -71,6 +71,11 @@ class MemoryShareStrategy {
   HashSet<int32_t> backup_register_behind_i_;
   // A buffer which implies whether we should visit a register
   std::vector<int32_t> should_visit_;
+  // A register is eliminated during ResetCompactPosition() if its stamp equals current_stamp_.
+  std::vector<int64_t> eliminated_stamp_;
+  int64_t current_stamp_;
+  // A buffer of the excluded registers on the left of a register
+  std::vector<int32_t> left_candidates_;
   int32_t total_register_num_;
   std::vector<int32_t> order_;
 
@@ -122,7 +127,8 @@ class MemoryShareStrategy {
   void ResetCompactPosition(int32_t j);
   // Find all the k < i, eliminates k < j,
   // since k < i and i < j have already implied that.
-  void EliminateRedundantRelationship(int32_t i);
+  // Only the registers with smaller offsets than offset_j are visited.
+  void EliminateRedundantRelationship(int32_t i, int64_t offset_j);
 };
 }  // namespace oneflow
 
@@ -0,0 +1,112 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include <algorithm>
+#include "gtest/gtest.h"
+#include "oneflow/core/job/memory_share_strategy.h"
+
+namespace oneflow {
+
+namespace {
+
+struct RegstInfo {
+  std::pair<int32_t, int32_t> lifetime;
+  size_t size;
+};
+
+// Run the planner with the registers placed one after another as the initial strategy. The initial
+// offsets are distinct, so the order of the registers does not depend on their addresses.
+void AdaptivelyUpdateOffset(const std::vector<RegstInfo>& regst_infos,
+                            std::vector<int64_t>* offsets, size_t* mem_block_size) {
+  std::vector<RegstDescProto> regsts(regst_infos.size());
+  HashMap<RegstDescProto*, size_t> regst2size;
+  HashMap<RegstDescProto*, std::pair<int32_t, int32_t>> regst2lifetime;
+  HashMap<RegstDescProto*, int64_t> regst2offset;
+  std::vector<size_t> time2memory;
+  int64_t offset = 0;
+  for (size_t i = 0; i < regst_infos.size(); i++) {
+    RegstDescProto* regst = &regsts[i];
+    const auto& info = regst_infos[i];
+    regst2size[regst] = info.size;
+    regst2lifetime[regst] = info.lifetime;
+    regst2offset[regst] = offset;
+    offset += info.size;
+    time2memory.resize(std::max<size_t>(time2memory.size(), info.lifetime.second), 0);
+    for (int32_t t = info.lifetime.first; t < info.lifetime.second; t++) {
+      time2memory[t] += info.size;
+    }
+  }
+  size_t lower_bound = *std::max_element(time2memory.begin(), time2memory.end());
+  *mem_block_size = offset;
+  MemoryShareStrategy mem_share_strategy;
+  mem_share_strategy.AdaptivelyUpdateOffset(regst2size, regst2lifetime, lower_bound,
+                                            mem_block_size, &regst2offset);
+  offsets->clear();
+  for (auto& regst : regsts) { offsets->push_back(regst2offset.at(&regst)); }
+}
+
+void CheckNoConflict(const std::vector<RegstInfo>& regst_infos, const std::vector<int64_t>& offsets,
+                     size_t mem_block_size) {
+  for (size_t i = 0; i < regst_infos.size(); i++) {
+    ASSERT_GE(offsets[i], 0);
+    ASSERT_LE(offsets[i] + static_cast<int64_t>(regst_infos[i].size),
+              static_cast<int64_t>(mem_block_size));
+    for (size_t j = i + 1; j < regst_infos.size(); j++) {
+      if (!IsLifetimeExcluded(regst_infos[i].lifetime, regst_infos[j].lifetime)) { continue; }
+      ASSERT_TRUE(offsets[i] + static_cast<int64_t>(regst_infos[i].size) <= offsets[j]
+                  || offsets[j] + static_cast<int64_t>(regst_infos[j].size) <= offsets[i]);
+    }
+  }
+}
+
+}  // namespace
+
+// The expected offsets are the ones from the planner before the excluded registers were found by
+// an interval tree, any change of them should be intended.
+TEST(MemoryShareStrategy, adaptively_update_offset) {
+  std::vector<RegstInfo> regst_infos{
+      {{0, 3}, 32},   {{1, 4}, 16},   {{2, 6}, 48},   {{3, 5}, 8},    {{4, 9}, 24},
+      {{5, 7}, 40},   {{6, 8}, 16},   {{7, 12}, 8},   {{8, 10}, 56},  {{9, 13}, 32},
+      {{0, 13}, 4},   {{10, 12}, 24}, {{11, 14}, 40}, {{12, 15}, 16}, {{2, 11}, 12},
+  };
+  std::vector<int64_t> offsets;
+  size_t mem_block_size = 0;
+  AdaptivelyUpdateOffset(regst_infos, &offsets, &mem_block_size);
+  CheckNoConflict(regst_infos, offsets, mem_block_size);
+  ASSERT_EQ(mem_block_size, 164u);
+  const std::vector<int64_t> expected_offsets{128, 0, 40, 16,  92, 0,   40, 132,
+                                              0,   56, 88, 140, 92, 132, 116};
+  ASSERT_EQ(offsets, expected_offsets);
+}
+
+TEST(MemoryShareStrategy, adaptively_update_offset_with_long_lifetimes) {
+  // A few registers live through most of the time, the others come and go.
+  std::vector<RegstInfo> regst_infos{
+      {{0, 20}, 64},  {{0, 4}, 8},    {{2, 6}, 100},  {{4, 8}, 36},   {{5, 18}, 20},
+      {{6, 10}, 72},  {{8, 12}, 12},  {{9, 11}, 44},  {{10, 14}, 90}, {{12, 16}, 28},
+      {{13, 15}, 60}, {{14, 19}, 16}, {{16, 20}, 80}, {{1, 9}, 24},   {{11, 17}, 52},
+      {{3, 5}, 6},    {{15, 20}, 10}, {{7, 13}, 30},
+  };
+  std::vector<int64_t> offsets;
+  size_t mem_block_size = 0;
+  AdaptivelyUpdateOffset(regst_infos, &offsets, &mem_block_size);
+  CheckNoConflict(regst_infos, offsets, mem_block_size);
+  ASSERT_EQ(mem_block_size, 314u);
+  const std::vector<int64_t> expected_offsets{0,   64, 168, 126, 64,  162, 84, 234, 144,
+                                              234, 84, 144, 160, 268, 262, 162, 84, 96};
+  ASSERT_EQ(offsets, expected_offsets);
+}
+
+}  // namespace oneflow
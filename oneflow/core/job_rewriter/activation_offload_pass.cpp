@@ -0,0 +1,250 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/job_rewriter/job_pass.h"
+#include "oneflow/core/job/job.pb.h"
+#include "oneflow/core/job/scope.h"
+#include "oneflow/core/job_rewriter/calculation_pass.h"
+#include "oneflow/core/job_rewriter/pass_util.h"
+#include "oneflow/core/vm/symbol_storage.h"
+#include "oneflow/core/framework/framework.h"
+#include "oneflow/core/operator/operator.h"
+
+namespace oneflow {
+
+namespace {
+
+// ActivationOffloadPass stages long-lived forward activations out to the host memory and
+// prefetches them back before the backward pass consumes them. It trades the bandwidth between
+// host and device for the device memory, as an alternative to the recomputation of
+// CheckpointingPass.
+//
+// For each activation:
+//   producer -> fw consumers
+//            -> copy-out (identity on host) -> copy-in (identity on device) -> bw consumers
+// The copy-out and copy-in are the copy tasks generated by the boxing between different device
+// types. The copy-out is anchored by a control edge from the last forward consumer, so the device
+// register of the activation dies right after its last forward use and the memory planner would
+// reuse it during the middle of the forward and backward pass. The copy-in is delayed by a control
+// edge from the backward op, which runs prefetch_distance ops before the first backward consumer
+// in the topological order.
+class ActivationOffloadPass final : public JobPass {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(ActivationOffloadPass);
+  ActivationOffloadPass() = default;
+  ~ActivationOffloadPass() = default;
+
+  Maybe<void> Apply(Job* job, JobPassCtx* ctx) const override {
+    if (!IsEnabled(*ctx)) { return Maybe<void>::Ok(); }
+    const OpGraph op_graph(*job);
+    JobBuilder job_builder(job);
+    return Apply(ctx->job_desc().job_conf().activation_offload_conf(), op_graph, &job_builder);
+  }
+
+  bool IsEnabled(const JobPassCtx& ctx) const {
+    return ctx.job_desc().IsTrain() && ctx.job_desc().job_conf().activation_offload_conf().enable();
+  }
+
+  Maybe<void> Apply(const ActivationOffloadConf& conf, const OpGraph& op_graph,
+                    JobBuilder* job_builder) const;
+};
+
+const std::string kActivationOffloadCopyOutOpNamePrefix = "Sys-ActivationOffload-CopyOut-";
+const std::string kActivationOffloadCopyInOpNamePrefix = "Sys-ActivationOffload-CopyIn-";
+
+const Scope& Scope4OpNode(const OpNode* op_node) {
+  int64_t scope_symbol_id = op_node->op().op_conf().scope_symbol_id();
+  CHECK(Singleton<symbol::Storage<Scope>>::Get()->Has(scope_symbol_id))
+      << "scope_symbol_id: " << scope_symbol_id;
+  return Singleton<symbol::Storage<Scope>>::Get()->Get(scope_symbol_id);
+}
+
+bool IsForwardPassScope(const Scope& scope) {
+  return scope.scope_proto().calculation_pass_name() == kForwardPass;
+}
+
+// An activation which could be offloaded
+struct OffloadCandidate {
+  LogicalBlobId lbi;
+  const OpNode* producer = nullptr;
+  std::vector<const OpEdge*> bw_edges;
+  const OpNode* first_bw_consumer = nullptr;
+  int64_t first_bw_order = -1;
+  // nullptr if the activation is only used by the backward pass
+  const OpNode* last_fw_consumer = nullptr;
+  int64_t size = 0;
+};
+
+void CollectOffloadCandidates(const ActivationOffloadConf& conf, const OpGraph& op_graph,
+                              const HashMap<const OpNode*, int64_t>& op_node2order,
+                              std::vector<OffloadCandidate>* candidates) {
+  op_graph.TopoForEachNode([&](const OpNode* op_node) {
+    const OperatorConf& op_conf = op_node->op().op_conf();
+    if (!op_conf.has_user_conf()) { return; }
+    if (op_node->parallel_desc().device_type() == DeviceType::kCPU) { return; }
+    if (!IsForwardPassScope(Scope4OpNode(op_node))) { return; }
+    int64_t producer_order = op_node2order.at(op_node);
+    HashMap<LogicalBlobId, OffloadCandidate> lbi2candidate;
+    HashMap<LogicalBlobId, const OpNode*> lbi2last_fw_consumer;
+    for (const OpEdge* out_edge : op_node->out_edges()) {
+      const OpNode* consumer = out_edge->dst_node();
+      int64_t consumer_order = op_node2order.at(consumer);
+      bool is_bw_consumer = !IsForwardPassScope(Scope4OpNode(consumer));
+      for (const LogicalBlobId& lbi : out_edge->lbis()) {
+        if (is_bw_consumer) {
+          auto& candidate = lbi2candidate[lbi];
+          candidate.bw_edges.push_back(out_edge);
+          if (candidate.first_bw_consumer == nullptr || consumer_order < candidate.first_bw_order) {
+            candidate.first_bw_consumer = consumer;
+            candidate.first_bw_order = consumer_order;
+          }
+        } else {
+          auto it = lbi2last_fw_consumer.emplace(lbi, consumer).first;
+          if (op_node2order.at(it->second) < consumer_order) { it->second = consumer; }
+        }
+      }
+    }
+    for (auto& pair : lbi2candidate) {
+      const LogicalBlobId& lbi = pair.first;
+      OffloadCandidate& candidate = pair.second;
+      const BlobDesc& blob_desc = op_node->LogicalBlobDesc4Lbi(lbi);
+      if (blob_desc.is_dynamic()) { continue; }
+      // The size of the activation on each device, a broadcast one is full-size on every device
+      candidate.size = PhysicalByteSize4Lbi(op_node, lbi);
+      if (candidate.size < conf.min_size()) { continue; }
+      // The time between the last forward use and the first backward use
+      int64_t last_fw_order = producer_order;
+      const auto& last_fw_consumer_it = lbi2last_fw_consumer.find(lbi);
+      if (last_fw_consumer_it != lbi2last_fw_consumer.end()) {
+        candidate.last_fw_consumer = last_fw_consumer_it->second;
+        last_fw_order = op_node2order.at(candidate.last_fw_consumer);
+      }
+      if (candidate.first_bw_order - last_fw_order < conf.min_lifetime()) { continue; }
+      candidate.lbi = lbi;
+      candidate.producer = op_node;
+      candidates->emplace_back(std::move(candidate));
+    }
+  });
+}
+
+// Find the backward op which runs prefetch_distance ops before the first backward consumer, and
+// has the same placement with the producer. Return nullptr if not found.
+const OpNode* FindPrefetchCtrlOpNode(const ActivationOffloadConf& conf,
+                                     const std::vector<const OpNode*>& order2op_node,
+                                     const HashMap<const OpNode*, int64_t>& op_node2order,
+                                     const OffloadCandidate& candidate) {
+  int64_t producer_order = op_node2order.at(candidate.producer);
+  int64_t start_order =
+      std::max(producer_order + 1, candidate.first_bw_order - conf.prefetch_distance());
+  for (int64_t order = start_order; order < candidate.first_bw_order; ++order) {
+    const OpNode* op_node = order2op_node.at(order);
+    if (!op_node->op().op_conf().has_user_conf()) { continue; }
+    if (IsForwardPassScope(Scope4OpNode(op_node))) { continue; }
+    // NOTE: A control edge can not connect two ops with different placements
+    if (!op_node->parallel_desc().EqualsIgnoringHierarchy(candidate.producer->parallel_desc())) {
+      continue;
+    }
+    return op_node;
+  }
+  return nullptr;
+}
+
+Maybe<void> ActivationOffloadPass::Apply(const ActivationOffloadConf& conf,
+                                         const OpGraph& op_graph, JobBuilder* job_builder) const {
+  // step 1. sort all the ops in topological order as an estimate of the execution order.
+  HashMap<const OpNode*, int64_t> op_node2order;
+  std::vector<const OpNode*> order2op_node;
+  op_graph.TopoForEachNode([&](const OpNode* op_node) {
+    CHECK(op_node2order.emplace(op_node, order2op_node.size()).second);
+    order2op_node.push_back(op_node);
+  });
+
+  // step 2. collect all the long-lived forward activations consumed by the backward pass.
+  std::vector<OffloadCandidate> candidates;
+  CollectOffloadCandidates(conf, op_graph, op_node2order, &candidates);
+  if (candidates.empty()) { return Maybe<void>::Ok(); }
+
+  // step 3. insert copy-out and copy-in ops for each activation.
+  int64_t total_offload_size = 0;
+  for (const OffloadCandidate& candidate : candidates) {
+    const std::string lbn = GenLogicalBlobName(candidate.lbi);
+    const std::string suffix = candidate.lbi.op_name() + "-" + candidate.lbi.blob_name();
+    ParallelConf host_parallel_conf = candidate.producer->parallel_desc().parallel_conf();
+    host_parallel_conf.set_device_tag("cpu");
+    auto copy_out_op =
+        user_op::UserOpConfWrapperBuilder(kActivationOffloadCopyOutOpNamePrefix + suffix)
+            .Op("identity")
+            .Input("in", lbn)
+            .Output("out")
+            .ScopeSymbolId(candidate.producer->op().op_conf().scope_symbol_id())
+            .Build();
+    OperatorConf copy_out_op_conf = copy_out_op.op_conf();
+    // The copy-out runs after the last forward use, so the device register of the activation is
+    // released right after that instead of whenever the copy-out is scheduled.
+    const OpNode* last_fw_consumer = candidate.last_fw_consumer;
+    if (last_fw_consumer != nullptr
+        && last_fw_consumer->parallel_desc().parallel_num()
+               == candidate.producer->parallel_desc().parallel_num()) {
+      copy_out_op_conf.add_ctrl_in_op_name(last_fw_consumer->op().op_name());
+    }
+    JUST(job_builder->AddOp(host_parallel_conf, copy_out_op_conf));
+
+    auto copy_in_op =
+        user_op::UserOpConfWrapperBuilder(kActivationOffloadCopyInOpNamePrefix + suffix)
+            .Op("identity")
+            .Input("in", copy_out_op.output("out", 0))
+            .Output("out")
+            .ScopeSymbolId(candidate.first_bw_consumer->op().op_conf().scope_symbol_id())
+            .Build();
+    OperatorConf copy_in_op_conf = copy_in_op.op_conf();
+    const OpNode* prefetch_ctrl_op_node =
+        FindPrefetchCtrlOpNode(conf, order2op_node, op_node2order, candidate);
+    if (prefetch_ctrl_op_node != nullptr) {
+      copy_in_op_conf.add_ctrl_in_op_name(prefetch_ctrl_op_node->op().op_name());
+    }
+    JUST(job_builder->AddOp(candidate.producer->parallel_desc().parallel_conf(), copy_in_op_conf));
+
+    // Change the inputs of backward consumers to the prefetched activation
+    for (const OpEdge* bw_edge : candidate.bw_edges) {
+      const OpNode* consumer = bw_edge->dst_node();
+      const std::string& consumer_op_name = consumer->op().op_name();
+      if (!JUST(job_builder->IsInMutOpTransaction(consumer_op_name))) {
+        JUST(job_builder->MutOpTransactionMut(consumer->op().op_conf()));
+      }
+      OperatorConf& mut_consumer_op_conf = JUST(job_builder->MutOpTransactionGet(consumer_op_name));
+      for (const std::string& ibn : bw_edge->lbi2ibns().at(candidate.lbi)) {
+        const std::string old_lbn = ReplaceInputLbnInOpCustomizedConf(
+            &mut_consumer_op_conf, ibn, copy_in_op.output("out", 0));
+        CHECK_EQ_OR_RETURN(old_lbn, lbn);
+      }
+    }
+    total_offload_size += candidate.size;
+    VLOG(2) << "Offload activation: " << lbn << " ,size: " << candidate.size
+            << " ,copy out after: "
+            << (candidate.last_fw_consumer ? candidate.last_fw_consumer->op().op_name() : "none")
+            << " ,prefetch after: "
+            << (prefetch_ctrl_op_node ? prefetch_ctrl_op_node->op().op_name() : "none");
+  }
+  VLOG(1) << "Offload " << candidates.size() << " activations with " << total_offload_size
+          << " bytes per device to host memory.";
+  JUST(job_builder->MutOpTransactionCommit());
+  return Maybe<void>::Ok();
+}
+
+}  // namespace
+
+REGISTER_JOB_PASS("ActivationOffloadPass", ActivationOffloadPass);
+
+}  // namespace oneflow
@@ -17,6 +17,7 @@ limitations under the License.
 #include "oneflow/core/job/job.pb.h"
 #include "oneflow/core/job/scope.h"
 #include "oneflow/core/job_rewriter/calculation_pass.h"
+#include "oneflow/core/job_rewriter/pass_util.h"
 #include "oneflow/core/vm/symbol_storage.h"
 #include "oneflow/core/framework/framework.h"
 #include "oneflow/core/framework/nd_sbp.h"
@@ -39,12 +40,13 @@ class CheckpointingPass final : public JobPass {
     if (!IsEnabled(*ctx)) { return Maybe<void>::Ok(); }
     const OpGraph op_graph(*job);
     JobBuilder job_builder(job);
-    return Apply(op_graph, &job_builder);
+    return Apply(ctx->job_desc().job_conf().auto_checkpointing_conf(), op_graph, &job_builder);
   }
 
   bool IsEnabled(const JobPassCtx& ctx) const { return ctx.job_desc().IsTrain(); }
 
-  Maybe<void> Apply(const OpGraph& op_graph, JobBuilder* job_builder) const;
+  Maybe<void> Apply(const AutoCheckpointingConf& auto_conf, const OpGraph& op_graph,
+                    JobBuilder* job_builder) const;
 };
 
 const std::string kCheckpointingFakeOpNamePrefix = "Sys-Checkpointing-Fake-Fw-Op_";
@@ -67,28 +69,150 @@ bool IsForwardPass7CheckpointingScope(const Scope& scope) {
   return IsForwardPassScope(scope) && scope.Bool("checkpointing");
 }
 
-void CollectAllCheckpointingOpsInForwardPass(
-    const OpGraph& op_graph, HashMap<std::string, const OpNode*>* checkpointing_op_name2op_node) {
+bool IsIgnoredOpType(const OperatorConf& op_conf) {
   // NOTE(chengcheng):
   //   ignore batch_norm ops because of recompute bn will repeat the calculation of 'm' and 'v'.
   //   in the future, we need to support the recomputation version of batch_norm which do NOT
   //   update forward variables.
-  HashSet<std::string> ignore_op_type_names = {"normalization", "normalization_add_relu",
-                                               "cudnn_fused_normalization_add_relu", "repeat",
-                                               "unpack"};
+  static const HashSet<std::string> ignore_op_type_names = {
+      "normalization", "normalization_add_relu", "cudnn_fused_normalization_add_relu", "repeat",
+      "unpack"};
+  return ignore_op_type_names.find(op_conf.user_conf().op_type_name())
+         != ignore_op_type_names.end();
+}
+
+void CollectAllCheckpointingOpsInForwardPass(
+    const OpGraph& op_graph, HashMap<std::string, const OpNode*>* checkpointing_op_name2op_node) {
   op_graph.ForEachNode([&](const OpNode* op_node) {
     const OperatorConf& op_conf = op_node->op().op_conf();
     if (!op_conf.has_user_conf()) { return; }
-    if (ignore_op_type_names.find(op_conf.user_conf().op_type_name())
-        != ignore_op_type_names.end()) {
-      return;
-    }
+    if (IsIgnoredOpType(op_conf)) { return; }
     if (IsForwardPass7CheckpointingScope(Scope4OpNode(op_node))) {
       CHECK(checkpointing_op_name2op_node->emplace(op_conf.name(), op_node).second);
     }
   });
 }
 
+// Whether the op could be recomputed automatically.
+// Random ops would generate different results, and source ops have nothing to be recomputed from.
+bool IsAutoCheckpointingCandidate(const OpNode* op_node) {
+  const OperatorConf& op_conf = op_node->op().op_conf();
+  if (!op_conf.has_user_conf()) { return false; }
+  if (IsIgnoredOpType(op_conf)) { return false; }
+  if (!IsForwardPassScope(Scope4OpNode(op_node))) { return false; }
+  if (op_node->in_edges().empty()) { return false; }
+  const auto& attrs = op_conf.user_conf().attr();
+  if (attrs.find("seed") != attrs.end() || attrs.find("random_seed") != attrs.end()) {
+    return false;
+  }
+  return true;
+}
+
+// The variables are kept for the backward pass anyway, recomputation can not free them.
+bool IsVariableOpNode(const OpNode* op_node) {
+  return op_node->op().op_conf().has_variable_conf();
+}
+
+// Select the ops to recompute by the compute cost per byte saved, until the forward activations
+// kept for the backward pass fit into the memory budget. It is similar to the score of tensors in
+// the DTR of eager remat: the cheaper to recompute and the larger the memory, the better.
+Maybe<void> CollectAutoCheckpointingOpsInForwardPass(
+    const AutoCheckpointingConf& auto_conf, const OpGraph& op_graph,
+    HashMap<std::string, const OpNode*>* checkpointing_op_name2op_node) {
+  // step 1. find all the forward activations kept for the backward pass, and their sizes on each
+  // device.
+  HashMap<LogicalBlobId, const OpNode*> retained_lbi2producer;
+  op_graph.ForEachNode([&](const OpNode* op_node) {
+    if (!IsForwardPassScope(Scope4OpNode(op_node))) { return; }
+    if (IsVariableOpNode(op_node)) { return; }
+    for (const OpEdge* out_edge : op_node->out_edges()) {
+      if (IsForwardPassScope(Scope4OpNode(out_edge->dst_node()))) { continue; }
+      for (const LogicalBlobId& lbi : out_edge->lbis()) {
+        retained_lbi2producer.emplace(lbi, op_node);
+      }
+    }
+  });
+  int64_t retained_size = 0;
+  for (const auto& pair : retained_lbi2producer) {
+    retained_size += PhysicalByteSize4Lbi(pair.second, pair.first);
+  }
+  VLOG(2) << "Auto checkpointing: activations kept for backward = " << retained_size
+          << " bytes, memory budget = " << auto_conf.memory_budget() << " bytes";
+  if (retained_size <= auto_conf.memory_budget()) { return Maybe<void>::Ok(); }
+
+  // step 2. score the candidates by the compute cost per byte saved.
+  struct Candidate {
+    const OpNode* op_node;
+    double score;
+  };
+  std::vector<Candidate> candidates;
+  JUST(op_graph.TopoForEachNodeWithErrorCaptured([&](OpNode* op_node) -> Maybe<void> {
+    if (checkpointing_op_name2op_node->find(op_node->op().op_name())
+        != checkpointing_op_name2op_node->end()) {
+      return Maybe<void>::Ok();
+    }
+    if (!IsAutoCheckpointingCandidate(op_node)) { return Maybe<void>::Ok(); }
+    int64_t saved_size = 0;
+    for (const std::string& obn : op_node->op().output_bns()) {
+      const LogicalBlobId& lbi = op_node->op().BnInOp2Lbi(obn);
+      if (retained_lbi2producer.find(lbi) != retained_lbi2producer.end()) {
+        saved_size += PhysicalByteSize4Lbi(op_node, lbi);
+      }
+    }
+    if (saved_size <= 0) { return Maybe<void>::Ok(); }
+    auto LogicalBlobDesc4Bn = [&](const std::string& bn) -> const BlobDesc& {
+      return op_node->LogicalBlobDesc4Lbi(op_node->op().BnInOp2Lbi(bn));
+    };
+    NdSbpSignature nd_sbp_signature = op_node->nd_sbp_signature();
+    double compute_cost = JUST(op_node->op().GetComputeComplexity(
+        &nd_sbp_signature, LogicalBlobDesc4Bn, op_node->parallel_desc()));
+    candidates.push_back({op_node, compute_cost / saved_size});
+    return Maybe<void>::Ok();
+  }));
+  std::stable_sort(
+      candidates.begin(), candidates.end(),
+      [](const Candidate& lhs, const Candidate& rhs) { return lhs.score < rhs.score; });
+
+  // step 3. greedily recompute the cheapest ones.
+  // Recomputing an op drops its outputs from the retained activations, but its inputs from the
+  // ops which are not recomputed have to be retained for the recomputation.
+  HashSet<const OpNode*> selected_op_nodes;
+  for (const Candidate& candidate : candidates) {
+    if (retained_size <= auto_conf.memory_budget()) { break; }
+    const OpNode* op_node = candidate.op_node;
+    int64_t reduced_size = 0;
+    for (const std::string& obn : op_node->op().output_bns()) {
+      const LogicalBlobId& lbi = op_node->op().BnInOp2Lbi(obn);
+      if (retained_lbi2producer.find(lbi) != retained_lbi2producer.end()) {
+        reduced_size += PhysicalByteSize4Lbi(op_node, lbi);
+      }
+    }
+    HashMap<LogicalBlobId, const OpNode*> extra_lbi2producer;
+    for (const OpEdge* in_edge : op_node->in_edges()) {
+      const OpNode* producer = in_edge->src_node();
+      if (selected_op_nodes.find(producer) != selected_op_nodes.end()) { continue; }
+      if (IsVariableOpNode(producer)) { continue; }
+      for (const LogicalBlobId& lbi : in_edge->lbis()) {
+        if (retained_lbi2producer.find(lbi) != retained_lbi2producer.end()) { continue; }
+        if (extra_lbi2producer.emplace(lbi, producer).second) {
+          reduced_size -= PhysicalByteSize4Lbi(producer, lbi);
+        }
+      }
+    }
+    if (reduced_size <= 0) { continue; }
+    CHECK_OR_RETURN(selected_op_nodes.insert(op_node).second);
+    for (const std::string& obn : op_node->op().output_bns()) {
+      retained_lbi2producer.erase(op_node->op().BnInOp2Lbi(obn));
+    }
+    retained_lbi2producer.insert(extra_lbi2producer.begin(), extra_lbi2producer.end());
+    retained_size -= reduced_size;
+    checkpointing_op_name2op_node->emplace(op_node->op().op_name(), op_node);
+  }
+  VLOG(2) << "Auto checkpointing: recompute " << selected_op_nodes.size()
+          << " ops, activations kept for backward = " << retained_size << " bytes";
+  return Maybe<void>::Ok();
+}
+
 void GenConnectedCheckpointingSubgraphs(
     const HashMap<std::string, const OpNode*>& checkpointing_op_name2op_node,
     std::vector<HashSet<const OpNode*>>* checkpointing_subgraphs) {
@@ -127,10 +251,15 @@ void GenConnectedCheckpointingSubgraphs(
   }
 }
 
-Maybe<void> CheckpointingPass::Apply(const OpGraph& op_graph, JobBuilder* job_builder) const {
+Maybe<void> CheckpointingPass::Apply(const AutoCheckpointingConf& auto_conf,
+                                     const OpGraph& op_graph, JobBuilder* job_builder) const {
   // step 1. collect all checkpointing ops in forwardpass.
   HashMap<std::string, const OpNode*> checkpointing_op_name2op_node;
   CollectAllCheckpointingOpsInForwardPass(op_graph, &checkpointing_op_name2op_node);
+  if (auto_conf.enable()) {
+    JUST(CollectAutoCheckpointingOpsInForwardPass(auto_conf, op_graph,
+                                                  &checkpointing_op_name2op_node));
+  }
   if (checkpointing_op_name2op_node.empty()) { return Maybe<void>::Ok(); }
 
   // step 2. get all connected subgraphs in checkpointing ops.
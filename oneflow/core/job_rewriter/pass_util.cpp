@@ -14,6 +14,7 @@ See the License for the specific language governing permissions and
 limitations under the License.
 */
 #include "oneflow/core/job_rewriter/pass_util.h"
+#include "oneflow/core/operator/operator.h"
 
 namespace oneflow {
 
@@ -81,4 +82,13 @@ std::string GenParallelConfKey(const ParallelConf& conf) {
   return ret;
 }
 
+int64_t PhysicalByteSize4Lbi(const OpNode* op_node, const LogicalBlobId& lbi) {
+  const BlobDesc& logical_blob_desc = op_node->LogicalBlobDesc4Lbi(lbi);
+  // The balanced splitter gives the first rank the largest part
+  const std::shared_ptr<Shape> physical_shape =
+      CHECK_JUST(GetPhysicalShape(logical_blob_desc.shape(), op_node->NdSbp4Lbi(lbi),
+                                  op_node->parallel_desc(), /*parallel_id=*/0));
+  return physical_shape->elem_cnt() * GetSizeOfDataType(logical_blob_desc.data_type());
+}
+
 }  // namespace oneflow
@@ -80,6 +80,10 @@ bool IsUserOpWithTypeName(const OperatorConf& op_conf, const std::string& op_typ
 
 std::string GenParallelConfKey(const ParallelConf& conf);
 
+// The byte size of the blob body on one rank according to its sbp. It is the largest one among the
+// ranks if the blob is not split evenly.
+int64_t PhysicalByteSize4Lbi(const OpNode* op_node, const LogicalBlobId& lbi);
+
 }  // namespace oneflow
 
 #endif  // ONEFLOW_CORE_JOB_REWRITER_PASS_UTIL_H_
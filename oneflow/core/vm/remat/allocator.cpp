@@ -14,6 +14,7 @@ See the License for the specific language governing permissions and
 limitations under the License.
 */
 
+#include <algorithm>
 #include <iterator>
 #include <vector>
 #include "nlohmann/json.hpp"
@@ -87,11 +88,18 @@ RematEpAllocator::offset_t RematEpAllocator::get_offset(const char* mem_ptr) con
 }
 
 void RematEpAllocator::LinkStorageAndPtr(RematableTensorStorage* storage, const char* mem_ptr) {
+  ReentrantThreadSafeLock::RAIIGuard guard(thread_lock_);
   Piece* piece = ptr2piece_.at(mem_ptr);
   piece->tensor = storage;
   CHECK_NOTNULL(piece->tensor);
+  piece->version++;
   VLOG(1) << "tensor " << piece->tensor->id() << " is allocated at " << get_offset(mem_ptr)
           << ", left: " << piece->is_left;
+  // The tensor may be not evictable yet (e.g. its compute op is set after the allocation), so it
+  // is scored lazily when it is popped from the index for the first time.
+  if (IsEvictionIndexEnabled() && !CHECK_JUST(InSmallMemoryArea(piece->ptr))) {
+    PushEvictionCandidate(piece, 0);
+  }
 }
 
 Maybe<bool> RematEpAllocator::InSmallMemoryArea(void* ptr) {
@@ -117,6 +125,7 @@ void RematEpAllocator::DeallocatePiece(Piece* piece) {
   piece->ptr = nullptr;
   piece->size = 0;
   CHECK(piece->is_free);
+  piece->version++;
   piece->prev = nullptr;
   piece->next = recycle_piece_list_;
   piece->is_left = true;
@@ -485,42 +494,66 @@ void RematEpAllocator::MergeNeighbourFreePiece(Piece* lhs, Piece* rhs) {
   DeallocatePiece(rhs);
 }
 
+bool RematEpAllocator::IsEvictionIndexEnabled() const {
+  return EnvBool<ONEFLOW_REMAT_HEURISTIC_DTE>() || EnvBool<ONEFLOW_REMAT_HEURISTIC_DTR>();
+}
+
+void RematEpAllocator::PushEvictionCandidate(Piece* piece, double cost) {
+  eviction_index_.Push(piece, piece->version, cost, Singleton<remat::Env>::Get()->time_now());
+  if (eviction_index_.size() > 2 * ptr2piece_.size() + 1024) {
+    eviction_index_.Compact([](const Piece* piece) { return piece->version; });
+  }
+}
+
+void RematEpAllocator::PushNeighborEvictionCandidates(const Piece* free_piece) {
+  if (!IsEvictionIndexEnabled()) { return; }
+  // The free memory next to the nearest tensors grew, so their cost including the neighborhood
+  // went down. They are pushed with a cost of 0 to be re-scored before any tensor is evicted.
+  const auto PushIfTensor = [&](Piece* piece) {
+    if (piece == nullptr || piece->tensor == nullptr) { return; }
+    if (!CHECK_JUST(InSmallMemoryArea(piece->ptr))) { PushEvictionCandidate(piece, 0); }
+  };
+  Piece* prev = free_piece->prev;
+  while (prev != nullptr && prev->tensor == nullptr) { prev = prev->prev; }
+  PushIfTensor(prev);
+  Piece* next = free_piece->next;
+  while (next != nullptr && next->tensor == nullptr) { next = next->next; }
+  PushIfTensor(next);
+}
+
+size_t RematEpAllocator::GetSizeIncludingNeighborhood(const Piece* piece) {
+  size_t size = piece->size;
+  for (const Piece* t = piece->prev; t != nullptr && t->tensor == nullptr; t = t->prev) {
+    size += t->size;
+  }
+  for (const Piece* t = piece->next; t != nullptr && t->tensor == nullptr; t = t->next) {
+    size += t->size;
+  }
+  return size;
+}
+
+RematableTensorStorage* RematEpAllocator::PopEvictionCandidate(bool consider_neighbor) {
+  // The entries of the tensors evicted or released after they were pushed are stale
+  const auto GetVersion = [](const Piece* piece) { return piece->version; };
+  const auto IsSkipped = [](const Piece* piece) {
+    RematableTensorStorage* tensor = CHECK_NOTNULL(piece->tensor);
+    return tensor->is_pinned() || !tensor->is_evictable();
+  };
+  // The cost depends on the last access time of the tensor and the free neighbours of the piece
+  const auto GetCost = [&](const Piece* piece) {
+    return consider_neighbor ? get_cost(piece->tensor, GetSizeIncludingNeighborhood(piece))
+                             : get_cost(piece->tensor);
+  };
+  Piece* piece = eviction_index_.Pop(Singleton<remat::Env>::Get()->time_now(), GetVersion,
+                                     IsSkipped, GetCost);
+  return piece == nullptr ? nullptr : piece->tensor;
+}
+
 Maybe<RematEpAllocator::Piece*> RematEpAllocator::EvictAndFindPieceLoop(size_t required_size,
                                                                         bool consider_neighbor) {
   VLOG(2) << "required size: " << required_size;
-  auto GetSizeIncludingNeighborhood = [](auto it, auto begin, auto end) -> size_t {
-    size_t size = it->second->size;
-    if (it != begin) {
-      for (auto t = std::prev(it); t->second->tensor == nullptr; t--) {
-        size += t->second->size;
-        if (t == begin) { break; }
-      }
-    }
-    if (it != end) {
-      for (auto t = std::next(it); t != end && t->second->tensor == nullptr; t++) {
-        size += t->second->size;
-      }
-    }
-    return size;
-  };
-
   while (true) {
-    double min_cost = std::numeric_limits<double>::max();
-    vm::RematableTensorStorage* min_tensor = nullptr;
-    for (auto it = ptr2piece_.begin();
-         it != ptr2piece_.end() && !JUST(InSmallMemoryArea(it->second->ptr)); it++) {
-      auto* tensor = it->second->tensor;
-      if (tensor != nullptr && !tensor->is_pinned() && tensor->is_evictable()) {
-        auto cur_op_cost =
-            consider_neighbor ? get_cost(
-                tensor, GetSizeIncludingNeighborhood(it, ptr2piece_.begin(), ptr2piece_.end()))
-                              : get_cost(tensor);
-        if (cur_op_cost < min_cost) {
-          min_cost = cur_op_cost;
-          min_tensor = tensor;
-        }
-      }
-    }
+    vm::RematableTensorStorage* min_tensor = PopEvictionCandidate(consider_neighbor);
     if (min_tensor) {
       min_tensor->Evict(false);
       Piece* piece = JUST(FindPiece(required_size, true));
@@ -655,6 +688,7 @@ Maybe<void> RematEpAllocator::Allocate(char** mem_ptr, std::size_t size) {
     const size_t evict_num2 = Singleton<remat::Env>::Get()->forced_eviction_num();
     const auto duration = profiler::GetTimeNow() - started_at;
     search_free_mem_cost_.emplace_back(size, evict_num2 - evict_num1, duration);
+    Singleton<remat::Env>::Get()->add_eviction_search_time(duration);
     if (EnvBool<ONEFLOW_REMAT_RECORD_MEM_FRAG_RATE>()) {
       size_t free_mem = 0;
       for (const auto& pair : ptr2piece_) {
@@ -701,6 +735,7 @@ void RematEpAllocator::Deallocate(char* mem_ptr, std::size_t size) {
   piece->is_free = true;
   piece->tensor = nullptr;
   piece->is_left = true;
+  piece->version++;
 
   Piece* last_piece_insert_to_free_list = piece;
   Piece* next_p = piece->next;
@@ -724,6 +759,7 @@ void RematEpAllocator::Deallocate(char* mem_ptr, std::size_t size) {
     last_piece_insert_to_free_list = prev_p;
   }
   InsertToFreeList(last_piece_insert_to_free_list);
+  PushNeighborEvictionCandidates(last_piece_insert_to_free_list);
   total_deallocate_bytes_ += size;
   CheckPieces();
 }
@@ -739,7 +775,9 @@ void RematEpAllocator::DeviceReset() {
 }
 
 nlohmann::json RematEpAllocator::DumpSearchFreeMemCost() {
-  return {{"overhead", search_free_mem_cost_}};
+  return {{"overhead", search_free_mem_cost_},
+          {"eviction index size", eviction_index_.size()},
+          {"eviction index rescore num", eviction_index_.rescore_num()}};
 }
 
 }  // namespace vm
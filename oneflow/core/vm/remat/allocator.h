@@ -17,12 +17,14 @@ limitations under the License.
 #define ONEFLOW_CORE_VM_DTR_EP_ALLOCATOR_H_
 
 #include <cstdint>
+#include <vector>
 #include "oneflow/core/common/env_var/remat.h"
 #include "oneflow/core/ep/include/device.h"
 #include "oneflow/core/vm/allocator.h"
 #include "oneflow/core/common/util.h"
 #include "nlohmann/json.hpp"
 #include "oneflow/core/vm/thread_safe_guard.h"
+#include "oneflow/core/vm/remat/eviction_index.h"
 
 namespace oneflow {
 
@@ -73,6 +75,9 @@ class RematEpAllocator final : public Allocator {
     Piece* next = nullptr;
     vm::RematableTensorStorage* tensor = nullptr;
     bool is_left = true;
+    // Increased whenever the tensor held by this piece changes, to invalidate the stale entries
+    // of eviction_index_
+    int64_t version = 0;
   };
 
   Maybe<bool> InSmallMemoryArea(void* ptr);
@@ -108,6 +113,17 @@ class RematEpAllocator final : public Allocator {
   Maybe<Piece*> EvictAndFindPieceOnce(size_t required_size);
   Maybe<Piece*> EvictAndFindPieceLoop(size_t required_size, bool consider_neighbor);
 
+  bool IsEvictionIndexEnabled() const;
+  // Push the piece to the eviction index, the stale entries are dropped when the index grows much
+  // larger than the number of pieces
+  void PushEvictionCandidate(Piece* piece, double cost);
+  // Re-push the nearest tensors around a free piece whose cost went down
+  void PushNeighborEvictionCandidates(const Piece* free_piece);
+  // Pop the tensor with the minimum cost from the eviction index, return nullptr if there is no
+  // evictable tensor
+  RematableTensorStorage* PopEvictionCandidate(bool consider_neighbor);
+  static size_t GetSizeIncludingNeighborhood(const Piece* piece);
+
   char* memory_ = nullptr;
   size_t memory_size_;
   void* small_piece_area_ptr_ = nullptr;
@@ -125,6 +141,9 @@ class RematEpAllocator final : public Allocator {
   // std::map is sorted by key, so we can find contiguous memory by it
   std::map<const char*, Piece*> ptr2piece_;
   std::vector<std::tuple<size_t, int, int64_t>> search_free_mem_cost_;
+  // The evictable tensors keyed by their cost, which is maintained incrementally instead of
+  // scanning all the pieces on each eviction.
+  remat::EvictionIndex<Piece> eviction_index_;
   Piece* recycle_piece_list_;
   size_t total_allocate_bytes_ = 0;
   size_t total_deallocate_bytes_ = 0;
@@ -127,6 +127,10 @@ Env::~Env() {
   LOG(INFO) << "forced eviction num: " << forced_eviction_num_;
   LOG(INFO) << "eager eviction num: " << eager_eviction_num_;
   LOG(INFO) << "recomputation num: " << recomputation_num_;
+  LOG(INFO) << "recomputation time: " << recomputation_time_;
+  LOG(INFO) << "recomputation bytes: " << recomputation_bytes_;
+  LOG(INFO) << "eviction search num: " << eviction_search_num_;
+  LOG(INFO) << "eviction search time: " << eviction_search_time_;
   LOG(INFO) << "duration: " << time_now_;
 
   const char* prefix = std::getenv("ONEFLOW_REMAT_SUMMARY_FILE_PREFIX");
@@ -135,6 +139,10 @@ Env::~Env() {
     json cpp_summary{{"forced eviction", forced_eviction_num_},
                      {"eager eviction", eager_eviction_num_},
                      {"recomputation", recomputation_num_},
+                     {"recomputation time", recomputation_time_},
+                     {"recomputation bytes", recomputation_bytes_},
+                     {"eviction search num", eviction_search_num_},
+                     {"eviction search time", eviction_search_time_},
                      {"dataset time", time_now_}};
 
     json full_json;
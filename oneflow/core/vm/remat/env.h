@@ -54,11 +54,31 @@ class Env {
   void add_recomputation_num() { recomputation_num_++; }
   int recomputation_num() const { return recomputation_num_; }
 
+  // The volume of the recomputation, i.e. the compute time and the bytes of the recomputed outputs
+  void add_recomputation_volume(double compute_time, size_t bytes) {
+    recomputation_time_ += compute_time;
+    recomputation_bytes_ += bytes;
+  }
+  double recomputation_time() const { return recomputation_time_; }
+  size_t recomputation_bytes() const { return recomputation_bytes_; }
+
+  // The latency (in ns) of searching the pieces to evict when the allocation fails
+  void add_eviction_search_time(int64_t time) {
+    eviction_search_time_ += time;
+    eviction_search_num_++;
+  }
+  int64_t eviction_search_time() const { return eviction_search_time_; }
+  int eviction_search_num() const { return eviction_search_num_; }
+
   void clear_stats() {
     time_now_ = 0;
     eager_eviction_num_ = 0;
     forced_eviction_num_ = 0;
     recomputation_num_ = 0;
+    recomputation_time_ = 0;
+    recomputation_bytes_ = 0;
+    eviction_search_time_ = 0;
+    eviction_search_num_ = 0;
   }
 
   std::set<vm::RematableTensorStorage*> need_eager_eviction_storages;
@@ -77,6 +97,10 @@ class Env {
   int eager_eviction_num_ = 0;
   int forced_eviction_num_ = 0;
   int recomputation_num_ = 0;
+  double recomputation_time_ = 0;
+  size_t recomputation_bytes_ = 0;
+  int64_t eviction_search_time_ = 0;
+  int eviction_search_num_ = 0;
 
   size_t budget_in_bytes_ = 0;
   bool small_pieces_optimization_ = true;
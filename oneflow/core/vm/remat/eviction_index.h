@@ -0,0 +1,130 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+namespace oneflow {
+
+namespace remat {
+
+// A min heap of eviction candidates keyed by a snapshot of their cost, so that an eviction does
+// not score every tensor. An item is pushed with its current version, the entries of an older
+// version are stale and dropped lazily.
+//
+// A snapshot is only re-validated when its entry reaches the top of the heap:
+// - if the cost went up, the entry is pushed back with the new cost;
+// - if the cost went down because of a known event (e.g. the free memory next to a tensor grew),
+//   the caller re-pushes the item with a cost of 0, so it is re-scored before any entry is
+//   accepted;
+// - the cost of a tensor also goes down as the time since its last access grows. Those decreases
+//   are not tracked: such an entry keeps its older, higher snapshot, and a tensor whose snapshot
+//   is the lowest is accepted as long as its re-scored cost did not go up. So the popped tensor is
+//   the cheapest of a full scan only up to this aging, which is what keeps the search cheap.
+template<typename T>
+class EvictionIndex final {
+ public:
+  EvictionIndex() = default;
+  ~EvictionIndex() = default;
+
+  void Push(T* item, int64_t version, double cost, double time_now) {
+    entries_.push_back(Entry{cost, time_now, item, version});
+    std::push_heap(entries_.begin(), entries_.end(), EntryCmp());
+  }
+
+  // Pops the cheapest item that is current and not skipped, returns nullptr if there is none. The
+  // skipped items (e.g. pinned tensors) are put back after the search.
+  template<typename GetVersion, typename IsSkipped, typename GetCost>
+  T* Pop(double time_now, const GetVersion& get_version, const IsSkipped& is_skipped,
+         const GetCost& get_cost) {
+    std::vector<Entry> skipped_entries;
+    T* min_item = nullptr;
+    while (!entries_.empty()) {
+      std::pop_heap(entries_.begin(), entries_.end(), EntryCmp());
+      Entry entry = entries_.back();
+      entries_.pop_back();
+      if (get_version(entry.item) != entry.version) { continue; }
+      if (is_skipped(entry.item)) {
+        skipped_entries.push_back(entry);
+        continue;
+      }
+      // An entry re-scored at the current time is accepted unless its cost increases, which
+      // ensures the termination of the loop.
+      const double cost = get_cost(entry.item);
+      if (cost > entry.cost || (cost != entry.cost && entry.time_now != time_now)) {
+        rescore_num_++;
+        entry.cost = cost;
+        entry.time_now = time_now;
+        entries_.push_back(entry);
+        std::push_heap(entries_.begin(), entries_.end(), EntryCmp());
+        continue;
+      }
+      min_item = entry.item;
+      break;
+    }
+    for (const auto& entry : skipped_entries) {
+      entries_.push_back(entry);
+      std::push_heap(entries_.begin(), entries_.end(), EntryCmp());
+    }
+    return min_item;
+  }
+
+  // Drops the stale entries, and the duplicated entries of an item but the cheapest one.
+  template<typename GetVersion>
+  void Compact(const GetVersion& get_version) {
+    entries_.erase(std::remove_if(entries_.begin(), entries_.end(),
+                                  [&](const Entry& entry) {
+                                    return get_version(entry.item) != entry.version;
+                                  }),
+                   entries_.end());
+    std::sort(entries_.begin(), entries_.end(), [](const Entry& lhs, const Entry& rhs) {
+      if (lhs.item != rhs.item) { return std::less<>{}(lhs.item, rhs.item); }
+      return lhs.cost < rhs.cost;
+    });
+    entries_.erase(std::unique(entries_.begin(), entries_.end(),
+                               [](const Entry& lhs, const Entry& rhs) {
+                                 return lhs.item == rhs.item;
+                               }),
+                   entries_.end());
+    std::make_heap(entries_.begin(), entries_.end(), EntryCmp());
+  }
+
+  size_t size() const { return entries_.size(); }
+  size_t rescore_num() const { return rescore_num_; }
+
+ private:
+  // The cost is a snapshot at time_now
+  struct Entry {
+    double cost;
+    double time_now;
+    T* item;
+    int64_t version;
+  };
+  struct EntryCmp {
+    // std::push_heap and std::pop_heap build a max heap, so reverse it to get the cheapest one
+    bool operator()(const Entry& lhs, const Entry& rhs) const { return lhs.cost > rhs.cost; }
+  };
+
+  std::vector<Entry> entries_;
+  size_t rescore_num_ = 0;
+};
+
+}  // namespace remat
+
+}  // namespace oneflow
@@ -0,0 +1,131 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "gtest/gtest.h"
+#include "oneflow/core/vm/remat/eviction_index.h"
+
+namespace oneflow {
+namespace remat {
+namespace test {
+
+namespace {
+
+struct FakeTensor {
+  double cost;
+  int64_t version = 0;
+  bool pinned = false;
+};
+
+class EvictionIndexTest : public ::testing::Test {
+ protected:
+  void Push(FakeTensor* tensor, double cost) {
+    index_.Push(tensor, tensor->version, cost, time_now_);
+  }
+  void Push(FakeTensor* tensor) { Push(tensor, tensor->cost); }
+
+  FakeTensor* Pop() {
+    return index_.Pop(
+        time_now_, [](const FakeTensor* t) { return t->version; },
+        [](const FakeTensor* t) { return t->pinned; }, [](const FakeTensor* t) { return t->cost; });
+  }
+
+  EvictionIndex<FakeTensor> index_;
+  double time_now_ = 0;
+};
+
+}  // namespace
+
+TEST_F(EvictionIndexTest, pop_in_cost_order) {
+  FakeTensor a{3}, b{1}, c{2};
+  Push(&a);
+  Push(&b);
+  Push(&c);
+  ASSERT_EQ(Pop(), &b);
+  ASSERT_EQ(Pop(), &c);
+  ASSERT_EQ(Pop(), &a);
+  ASSERT_EQ(Pop(), nullptr);
+}
+
+TEST_F(EvictionIndexTest, skip_stale_and_pinned) {
+  FakeTensor a{1}, b{2}, c{3};
+  Push(&a);
+  Push(&b);
+  Push(&c);
+  // a is evicted and reused by another tensor
+  a.version++;
+  b.pinned = true;
+  ASSERT_EQ(Pop(), &c);
+  // the pinned tensor is put back
+  b.pinned = false;
+  ASSERT_EQ(Pop(), &b);
+  ASSERT_EQ(Pop(), nullptr);
+}
+
+TEST_F(EvictionIndexTest, push_back_increased_cost) {
+  FakeTensor a{1}, b{2};
+  Push(&a);
+  Push(&b);
+  // a is accessed, so its cost goes up
+  a.cost = 5;
+  ASSERT_EQ(Pop(), &b);
+  ASSERT_EQ(Pop(), &a);
+  ASSERT_EQ(index_.rescore_num(), 1u);
+}
+
+TEST_F(EvictionIndexTest, repush_decreased_cost) {
+  FakeTensor a{4}, b{2};
+  Push(&a);
+  Push(&b);
+  // the memory next to a is freed, so its cost goes down and it is re-pushed to be re-scored
+  a.cost = 1;
+  Push(&a, 0);
+  ASSERT_EQ(Pop(), &a);
+  ASSERT_EQ(Pop(), &b);
+  // the outdated entry of a is dropped once a is evicted
+  a.version++;
+  ASSERT_EQ(Pop(), nullptr);
+}
+
+TEST_F(EvictionIndexTest, aging_is_approximated) {
+  FakeTensor a{4}, b{2};
+  Push(&a);
+  Push(&b);
+  // as time passes, the costs of a and b go down with different rates, a becomes the cheapest
+  // but keeps its older snapshot, so b is popped first
+  time_now_ = 1;
+  a.cost = 1;
+  b.cost = 1.5;
+  ASSERT_EQ(Pop(), &b);
+  ASSERT_EQ(Pop(), &a);
+}
+
+TEST_F(EvictionIndexTest, compact) {
+  FakeTensor a{1}, b{2};
+  Push(&a);
+  Push(&a, 0);
+  Push(&b);
+  b.version++;
+  Push(&b);
+  ASSERT_EQ(index_.size(), 4u);
+  index_.Compact([](const FakeTensor* t) { return t->version; });
+  ASSERT_EQ(index_.size(), 2u);
+  ASSERT_EQ(Pop(), &a);
+  ASSERT_EQ(Pop(), &b);
+  ASSERT_EQ(Pop(), nullptr);
+}
+
+}  // namespace test
+}  // namespace remat
+}  // namespace oneflow
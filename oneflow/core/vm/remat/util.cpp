@@ -390,8 +390,14 @@ Maybe<void> RematHelper::UpdateRematInfo(bool first, bool recompute, bool includ
     for (auto& storage : input_storages_) { storage->Access(); }
   }
 
-  if (recompute) { Singleton<remat::Env>::Get()->add_recomputation_num(); }
-  Singleton<remat::Env>::Get()->add_time(JUST(remat::GetComputeTime(op_call_instruction_policy_)));
+  const double compute_time = JUST(remat::GetComputeTime(op_call_instruction_policy_));
+  if (recompute) {
+    size_t recomputed_bytes = 0;
+    for (const auto& storage : output_storages_) { recomputed_bytes += storage->blob_bytes(); }
+    Singleton<remat::Env>::Get()->add_recomputation_num();
+    Singleton<remat::Env>::Get()->add_recomputation_volume(compute_time, recomputed_bytes);
+  }
+  Singleton<remat::Env>::Get()->add_time(compute_time);
   VLOG_REMAT(1) << "end compute " << op_call_instruction_policy_.opkernel().op_type_name()
                 << std::endl;
   return Maybe<void>::Ok();
@@ -15,6 +15,7 @@ limitations under the License.
 */
 #include "oneflow/core/framework/framework.h"
 #include "oneflow/core/kernel/new_kernel_util.h"
+#include "oneflow/user/kernels/sort_cpu_util.h"
 
 namespace oneflow {
 
@@ -29,44 +30,54 @@ class CpuArgSortKernel final : public user_op::OpKernel {
     const user_op::Tensor* in = ctx->Tensor4ArgNameAndIndex("in", 0);
     user_op::Tensor* out = ctx->Tensor4ArgNameAndIndex("out", 0);
 
-    const int32_t instance_size = in->shape_view().At(in->shape_view().NumAxes() - 1);
-    const int32_t instance_num = in->shape_view().elem_cnt() / instance_size;
+    user_op::Tensor* tmp_buffer = ctx->Tensor4ArgNameAndIndex("tmp_buffer", 0);
+
+    const int64_t instance_size = in->shape_view().At(in->shape_view().NumAxes() - 1);
+    const int64_t instance_num = in->shape_view().elem_cnt() / instance_size;
     const std::string& direction = ctx->Attr<std::string>("direction");
     const bool is_ascending = direction == "ASCENDING";
     const bool is_descending = direction == "DESCENDING";
-    FOR_RANGE(int32_t, i, 0, instance_num) {
-      const T* in_ptr_i = in->dptr<T>() + i * instance_size;
-      int32_t* out_ptr_i = out->mut_dptr<int32_t>() + i * instance_size;
-      std::iota(out_ptr_i, out_ptr_i + instance_size, 0);
-      auto comp = [&](const int32_t lhs, const int32_t rhs) {
+    CHECK(is_ascending || is_descending)
+        << "expected the input direction parameter value is \"ASCENDING\" or \"DESCENDING\", "
+        << "but found the value is \"" << direction << "\"";
+    const T* in_ptr = in->dptr<T>();
+    int32_t* out_ptr = out->mut_dptr<int32_t>();
+    ctx->stream()->As<ep::CpuStream>()->ParallelFor(
+        0, instance_num,
+        [&](int64_t begin, int64_t end) {
+          for (int64_t i = begin; i < end; ++i) {
+            int32_t* out_ptr_i = out_ptr + i * instance_size;
+            std::iota(out_ptr_i, out_ptr_i + instance_size, 0);
+          }
+        },
+        std::max<int64_t>(kCpuSortGrain / std::max<int64_t>(instance_size, 1), 1));
+    auto get_comp = [&](int64_t i) {
+      const T* in_ptr_i = in_ptr + i * instance_size;
+      return [in_ptr_i, is_ascending](const int32_t lhs, const int32_t rhs) {
         const T l = in_ptr_i[lhs];
         const T r = in_ptr_i[rhs];
         if (l == r) {
           return lhs < rhs;
         } else {
-          if (is_ascending) {
-            return l < r;
-          } else if (is_descending) {
-            return l > r;
-          } else {
-            LOG(FATAL) << "expected the input direction parameter value is \"ASCENDING\" or "
-                          "\"DESCENDING\", "
-                       << "but found the value is "
-                       << "\"" << direction << "\"";
-          }
+          return is_ascending ? l < r : l > r;
         }
       };
-      std::sort(out_ptr_i, out_ptr_i + instance_size, comp);
-    }
+    };
+    CpuSortInstances(ctx->stream(), out_ptr, tmp_buffer->mut_dptr<int32_t>(), instance_num,
+                     instance_size, get_comp);
   }
   bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
 };
 
-#define REGISTER_CPU_ARG_SORT_KERNEL(dtype)                           \
-  REGISTER_USER_KERNEL("arg_sort")                                    \
-      .SetCreateFn<CpuArgSortKernel<dtype>>()                         \
-      .SetIsMatchedHob((user_op::HobDeviceType() == DeviceType::kCPU) \
-                       && (user_op::HobDataType("in", 0) == GetDataType<dtype>::value));
+#define REGISTER_CPU_ARG_SORT_KERNEL(dtype)                                             \
+  REGISTER_USER_KERNEL("arg_sort")                                                      \
+      .SetCreateFn<CpuArgSortKernel<dtype>>()                                           \
+      .SetIsMatchedHob((user_op::HobDeviceType() == DeviceType::kCPU)                   \
+                       && (user_op::HobDataType("in", 0) == GetDataType<dtype>::value)) \
+      .SetInferTmpSizeFn([](user_op::InferContext* ctx) -> size_t {                     \
+        const Shape& in_shape = ctx->InputShape("in", 0);                               \
+        return in_shape.At(in_shape.NumAxes() - 1) * sizeof(int32_t);                   \
+      });
 
 REGISTER_CPU_ARG_SORT_KERNEL(float)
 REGISTER_CPU_ARG_SORT_KERNEL(double)
@@ -0,0 +1,488 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_USER_KERNELS_CONV_CPU_UTIL_H_
+#define ONEFLOW_USER_KERNELS_CONV_CPU_UTIL_H_
+
+#include <algorithm>
+#include "oneflow/core/ep/cpu/cpu_stream.h"
+#include "oneflow/core/ep/include/primitive/matmul.h"
+#include "oneflow/core/framework/framework.h"
+
+namespace oneflow {
+
+namespace conv {
+
+// Number of multiply-adds done by a task of the cpu conv kernels.
+constexpr int64_t kCpuGrain = 32768;
+
+// The direct kernels are used when an output element is the sum of at most this many products
+// (in_channels / groups * kernel volume): the matmul of the im2col path is then too small to
+// make up for writing and reading the col buffer.
+constexpr int64_t kCpuDirectMaxReduceSize = 64;
+
+// Winograd is used for 3x3 stride 1 convs with at least this many input and output channels,
+// below that the transforms cost more than the multiplications they save.
+constexpr int64_t kCpuWinogradMinChannels = 16;
+
+// Upper bound of the bytes of the transformed tiles of a chunk of the winograd kernel.
+constexpr int64_t kCpuWinogradChunkBytes = 4 * 1024 * 1024;
+constexpr int64_t kCpuWinogradMinChunkTiles = 16;
+
+enum class CpuConvAlgo {
+  kIm2ColGemm,  // im2col into the col buffer, then a matmul per image
+  kGemm1x1,     // 1x1 stride 1 conv without padding, the image is used as the col buffer
+  kDirect,      // direct conv, each output plane is computed by a task
+  kWinograd,    // winograd F(2x2, 3x3)
+};
+
+// The sizes of a conv or deconv in the channels first layout, with the spatial dims padded
+// to 3 by leading 1s as the 5d shapes of the conv kernels.
+struct CpuConvParams {
+  int64_t batch = 0;
+  int64_t in_channels = 0;
+  int64_t out_channels = 0;
+  int64_t groups = 1;
+  int64_t in_dims[3] = {1, 1, 1};
+  int64_t out_dims[3] = {1, 1, 1};
+  int64_t kernel[3] = {1, 1, 1};
+  int64_t strides[3] = {1, 1, 1};
+  int64_t dilation_rate[3] = {1, 1, 1};
+  int64_t padding_before[3] = {0, 0, 0};
+  bool channels_first = true;
+
+  int64_t InVolume() const { return in_dims[0] * in_dims[1] * in_dims[2]; }
+  int64_t OutVolume() const { return out_dims[0] * out_dims[1] * out_dims[2]; }
+  int64_t KernelVolume() const { return kernel[0] * kernel[1] * kernel[2]; }
+};
+
+// Fills the params from the attrs of ctx and the shapes of the input and output of the conv, or
+// of the input and output of the deconv. Only the batch and channels are filled for the channels
+// last layout, the cpu conv kernels always take the im2col path for it.
+template<typename Context>
+CpuConvParams MakeCpuConvParams(Context* ctx, const Shape& in_shape, const Shape& out_shape) {
+  CpuConvParams params;
+  params.channels_first = ctx->template Attr<std::string>("data_format") == "channels_first";
+  params.groups = ctx->template Attr<int32_t>("groups");
+  const int64_t ndims = in_shape.NumAxes() - 2;
+  const int64_t channel_axis = params.channels_first ? 1 : ndims + 1;
+  params.batch = in_shape.At(0);
+  params.in_channels = in_shape.At(channel_axis);
+  params.out_channels = out_shape.At(channel_axis);
+  if (!params.channels_first) { return params; }
+  const auto& kernel_size = ctx->template Attr<std::vector<int32_t>>("kernel_size");
+  const auto& strides = ctx->template Attr<std::vector<int32_t>>("strides");
+  const auto& dilation_rate = ctx->template Attr<std::vector<int32_t>>("dilation_rate");
+  const auto& padding_before = ctx->template Attr<std::vector<int32_t>>("padding_before");
+  for (int64_t i = 0; i < ndims; ++i) {
+    const int64_t dim = 3 - ndims + i;
+    params.in_dims[dim] = in_shape.At(2 + i);
+    params.out_dims[dim] = out_shape.At(2 + i);
+    params.kernel[dim] = kernel_size.at(i);
+    params.strides[dim] = strides.at(i);
+    params.dilation_rate[dim] = dilation_rate.at(i);
+    params.padding_before[dim] = padding_before.at(i);
+  }
+  return params;
+}
+
+inline bool IsCpuConvWinogradApplicable(const CpuConvParams& params) {
+  if (params.groups != 1 || params.in_dims[0] != 1 || params.kernel[0] != 1
+      || params.padding_before[0] != 0) {
+    return false;
+  }
+  for (int dim = 1; dim < 3; ++dim) {
+    if (params.kernel[dim] != 3 || params.strides[dim] != 1 || params.dilation_rate[dim] != 1) {
+      return false;
+    }
+  }
+  return params.in_channels >= kCpuWinogradMinChannels
+         && params.out_channels >= kCpuWinogradMinChannels;
+}
+
+// Picks the algorithm of the cpu conv forward kernels. The choice only depends on the channels
+// and the attrs, so that the tmp buffer inferred from the static shapes fits a dynamic shape.
+inline CpuConvAlgo GetCpuConvAlgo(const CpuConvParams& params) {
+  if (!params.channels_first) { return CpuConvAlgo::kIm2ColGemm; }
+  const int64_t in_channels_per_group = params.in_channels / params.groups;
+  if (in_channels_per_group * params.KernelVolume() <= kCpuDirectMaxReduceSize) {
+    return CpuConvAlgo::kDirect;
+  }
+  if (IsCpuConvWinogradApplicable(params)) { return CpuConvAlgo::kWinograd; }
+  bool is_1x1 = true;
+  for (int dim = 0; dim < 3; ++dim) {
+    is_1x1 = is_1x1 && params.kernel[dim] == 1 && params.strides[dim] == 1
+             && params.padding_before[dim] == 0;
+  }
+  return is_1x1 ? CpuConvAlgo::kGemm1x1 : CpuConvAlgo::kIm2ColGemm;
+}
+
+// The deconv kernels only have the direct and the col2im paths.
+inline bool UseCpuDirectDeconv(const CpuConvParams& params) {
+  if (!params.channels_first) { return false; }
+  return params.in_channels / params.groups * params.KernelVolume() <= kCpuDirectMaxReduceSize;
+}
+
+// Returns the range [*begin, *end) of the output positions o in [0, out_size) whose input
+// position o * stride + offset is in [0, in_size).
+inline void GetCpuConvValidRange(int64_t out_size, int64_t in_size, int64_t stride,
+                                 int64_t offset, int64_t* begin, int64_t* end) {
+  *begin = offset >= 0 ? 0 : (-offset + stride - 1) / stride;
+  *end = in_size - 1 - offset >= 0 ? std::min(out_size, (in_size - 1 - offset) / stride + 1) : 0;
+  *end = std::max(*begin, *end);
+}
+
+// out += weight * in[begin * stride + offset, ...) for the positions in [begin, end).
+template<typename T>
+void CpuConvAxpyRow(int64_t begin, int64_t end, int64_t stride, int64_t offset, T weight,
+                    const T* in, T* out) {
+  if (stride == 1) {
+    const T* in_row = in + offset;
+    for (int64_t i = begin; i < end; ++i) { out[i] += weight * in_row[i]; }
+  } else {
+    for (int64_t i = begin; i < end; ++i) { out[i] += weight * in[i * stride + offset]; }
+  }
+}
+
+// Calls f(begin, end) for the planes [0, num_planes) on the threads of the cpu stream, a plane
+// costing work_per_plane multiply-adds.
+template<typename F>
+void CpuConvParallelForPlanes(ep::Stream* stream, int64_t num_planes, int64_t work_per_plane,
+                              const F& f) {
+  stream->As<ep::CpuStream>()->ParallelFor(
+      0, num_planes, f, std::max<int64_t>(kCpuGrain / std::max<int64_t>(work_per_plane, 1), 1));
+}
+
+// out = beta * out + bias + conv(in, weight) in the channels first layout, where bias may be
+// null. Each (image, output channel) plane is computed by a task, so the planes are written by a
+// single thread and no col buffer is needed.
+template<typename T>
+void CpuDirectConv(ep::Stream* stream, const CpuConvParams& params, const T* in, const T* weight,
+                   const T* bias, T beta, T* out) {
+  const int64_t in_channels_per_group = params.in_channels / params.groups;
+  const int64_t out_channels_per_group = params.out_channels / params.groups;
+  const int64_t in_volume = params.InVolume();
+  const int64_t out_volume = params.OutVolume();
+  const int64_t kernel_volume = params.KernelVolume();
+  const int64_t* in_dims = params.in_dims;
+  const int64_t* out_dims = params.out_dims;
+  const int64_t* kernel = params.kernel;
+  const int64_t* strides = params.strides;
+  const int64_t* dilation_rate = params.dilation_rate;
+  const int64_t* padding_before = params.padding_before;
+  CpuConvParallelForPlanes(
+      stream, params.batch * params.out_channels,
+      out_volume * in_channels_per_group * kernel_volume, [&](int64_t begin, int64_t end) {
+        for (int64_t plane = begin; plane < end; ++plane) {
+          const int64_t n = plane / params.out_channels;
+          const int64_t oc = plane % params.out_channels;
+          const int64_t group = oc / out_channels_per_group;
+          T* out_plane = out + plane * out_volume;
+          const T bias_value = bias == nullptr ? static_cast<T>(0) : bias[oc];
+          if (beta == static_cast<T>(0)) {
+            std::fill(out_plane, out_plane + out_volume, bias_value);
+          } else {
+            for (int64_t i = 0; i < out_volume; ++i) {
+              out_plane[i] = beta * out_plane[i] + bias_value;
+            }
+          }
+          for (int64_t c = 0; c < in_channels_per_group; ++c) {
+            const int64_t ic = group * in_channels_per_group + c;
+            const T* in_plane = in + (n * params.in_channels + ic) * in_volume;
+            const T* weight_c = weight + (oc * in_channels_per_group + c) * kernel_volume;
+            for (int64_t kd = 0; kd < kernel[0]; ++kd) {
+              int64_t od_begin = 0;
+              int64_t od_end = 0;
+              const int64_t d_offset = kd * dilation_rate[0] - padding_before[0];
+              GetCpuConvValidRange(out_dims[0], in_dims[0], strides[0], d_offset, &od_begin,
+                                   &od_end);
+              for (int64_t kh = 0; kh < kernel[1]; ++kh) {
+                int64_t oh_begin = 0;
+                int64_t oh_end = 0;
+                const int64_t h_offset = kh * dilation_rate[1] - padding_before[1];
+                GetCpuConvValidRange(out_dims[1], in_dims[1], strides[1], h_offset, &oh_begin,
+                                     &oh_end);
+                for (int64_t kw = 0; kw < kernel[2]; ++kw) {
+                  int64_t ow_begin = 0;
+                  int64_t ow_end = 0;
+                  const int64_t w_offset = kw * dilation_rate[2] - padding_before[2];
+                  GetCpuConvValidRange(out_dims[2], in_dims[2], strides[2], w_offset, &ow_begin,
+                                       &ow_end);
+                  const T w = weight_c[(kd * kernel[1] + kh) * kernel[2] + kw];
+                  for (int64_t od = od_begin; od < od_end; ++od) {
+                    const int64_t id = od * strides[0] + d_offset;
+                    for (int64_t oh = oh_begin; oh < oh_end; ++oh) {
+                      const int64_t ih = oh * strides[1] + h_offset;
+                      CpuConvAxpyRow(ow_begin, ow_end, strides[2], w_offset, w,
+                                     in_plane + (id * in_dims[1] + ih) * in_dims[2],
+                                     out_plane + (od * out_dims[1] + oh) * out_dims[2]);
+                    }
+                  }
+                }
+              }
+            }
+          }
+        }
+      });
+}
+
+// out = deconv(in, weight) in the channels first layout, weight being of shape (in_channels,
+// out_channels / groups, kernel...). Each (image, output channel) plane is computed by a task
+// which scatters the input planes of its group into it.
+template<typename T>
+void CpuDirectDeconv(ep::Stream* stream, const CpuConvParams& params, const T* in, const T* weight,
+                     T* out) {
+  const int64_t in_channels_per_group = params.in_channels / params.groups;
+  const int64_t out_channels_per_group = params.out_channels / params.groups;
+  const int64_t in_volume = params.InVolume();
+  const int64_t out_volume = params.OutVolume();
+  const int64_t kernel_volume = params.KernelVolume();
+  const int64_t* in_dims = params.in_dims;
+  const int64_t* out_dims = params.out_dims;
+  const int64_t* kernel = params.kernel;
+  const int64_t* strides = params.strides;
+  const int64_t* dilation_rate = params.dilation_rate;
+  const int64_t* padding_before = params.padding_before;
+  CpuConvParallelForPlanes(
+      stream, params.batch * params.out_channels,
+      in_volume * in_channels_per_group * kernel_volume, [&](int64_t begin, int64_t end) {
+        for (int64_t plane = begin; plane < end; ++plane) {
+          const int64_t n = plane / params.out_channels;
+          const int64_t oc = plane % params.out_channels;
+          const int64_t group = oc / out_channels_per_group;
+          const int64_t oc_in_group = oc % out_channels_per_group;
+          T* out_plane = out + plane * out_volume;
+          std::fill(out_plane, out_plane + out_volume, static_cast<T>(0));
+          for (int64_t c = 0; c < in_channels_per_group; ++c) {
+            const int64_t ic = group * in_channels_per_group + c;
+            const T* in_plane = in + (n * params.in_channels + ic) * in_volume;
+            const T* weight_c =
+                weight + (ic * out_channels_per_group + oc_in_group) * kernel_volume;
+            for (int64_t kd = 0; kd < kernel[0]; ++kd) {
+              int64_t id_begin = 0;
+              int64_t id_end = 0;
+              const int64_t d_offset = kd * dilation_rate[0] - padding_before[0];
+              GetCpuConvValidRange(in_dims[0], out_dims[0], strides[0], d_offset, &id_begin,
+                                   &id_end);
+              for (int64_t kh = 0; kh < kernel[1]; ++kh) {
+                int64_t ih_begin = 0;
+                int64_t ih_end = 0;
+                const int64_t h_offset = kh * dilation_rate[1] - padding_before[1];
+                GetCpuConvValidRange(in_dims[1], out_dims[1], strides[1], h_offset, &ih_begin,
+                                     &ih_end);
+                for (int64_t kw = 0; kw < kernel[2]; ++kw) {
+                  int64_t iw_begin = 0;
+                  int64_t iw_end = 0;
+                  const int64_t w_offset = kw * dilation_rate[2] - padding_before[2];
+                  GetCpuConvValidRange(in_dims[2], out_dims[2], strides[2], w_offset, &iw_begin,
+                                       &iw_end);
+                  const T w = weight_c[(kd * kernel[1] + kh) * kernel[2] + kw];
+                  for (int64_t id = id_begin; id < id_end; ++id) {
+                    const int64_t od = id * strides[0] + d_offset;
+                    for (int64_t ih = ih_begin; ih < ih_end; ++ih) {
+                      const int64_t oh = ih * strides[1] + h_offset;
+                      const T* in_row = in_plane + (id * in_dims[1] + ih) * in_dims[2];
+                      T* out_row = out_plane + (od * out_dims[1] + oh) * out_dims[2] + w_offset;
+                      if (strides[2] == 1) {
+                        for (int64_t iw = iw_begin; iw < iw_end; ++iw) {
+                          out_row[iw] += w * in_row[iw];
+                        }
+                      } else {
+                        for (int64_t iw = iw_begin; iw < iw_end; ++iw) {
+                          out_row[iw * strides[2]] += w * in_row[iw];
+                        }
+                      }
+                    }
+                  }
+                }
+              }
+            }
+          }
+        }
+      });
+}
+
+// Number of 2x2 output tiles of the winograd kernel.
+inline int64_t GetCpuWinogradNumTiles(const CpuConvParams& params) {
+  return params.batch * ((params.out_dims[1] + 1) / 2) * ((params.out_dims[2] + 1) / 2);
+}
+
+inline int64_t GetCpuWinogradChunkTiles(const CpuConvParams& params, size_t size_of_data_type) {
+  const int64_t tile_bytes =
+      16 * (params.in_channels + params.out_channels) * static_cast<int64_t>(size_of_data_type);
+  const int64_t chunk_tiles = std::max(kCpuWinogradChunkBytes / tile_bytes,
+                                       kCpuWinogradMinChunkTiles);
+  return std::max<int64_t>(std::min(chunk_tiles, GetCpuWinogradNumTiles(params)), 1);
+}
+
+// Returns the number of elements of the tmp buffer of CpuWinogradConv: the transformed weight
+// followed by the transformed input and output tiles of a chunk.
+inline int64_t GetCpuWinogradTmpSize(const CpuConvParams& params, size_t size_of_data_type) {
+  const int64_t chunk_tiles = GetCpuWinogradChunkTiles(params, size_of_data_type);
+  return 16 * (params.out_channels * params.in_channels
+               + (params.in_channels + params.out_channels) * chunk_tiles);
+}
+
+// out = beta * out + bias + conv(in, weight) for a 3x3 stride 1 conv with winograd F(2x2, 3x3):
+// the weight and the 4x4 input tiles are transformed, the 16 elementwise products over the
+// channels become 16 matmuls of (out_channels, in_channels) x (in_channels, tiles), then each
+// 4x4 product is transformed back into a 2x2 output tile. The tiles are processed in chunks so
+// that the transformed tiles stay in the tmp buffer of GetCpuWinogradTmpSize elements.
+template<typename T>
+void CpuWinogradConv(ep::Stream* stream, const CpuConvParams& params, const T* in,
+                     const T* weight, const T* bias, T beta, T* out, T* tmp) {
+  auto* cpu_stream = stream->As<ep::CpuStream>();
+  auto matmul = ep::primitive::NewPrimitive<ep::primitive::MatmulFactory>(
+      DeviceType::kCPU, GetDataType<T>::value, ep::primitive::BlasTransposeType::N,
+      ep::primitive::BlasTransposeType::N);
+  CHECK(matmul);
+  const int64_t ic_num = params.in_channels;
+  const int64_t oc_num = params.out_channels;
+  const int64_t in_h = params.in_dims[1];
+  const int64_t in_w = params.in_dims[2];
+  const int64_t out_h = params.out_dims[1];
+  const int64_t out_w = params.out_dims[2];
+  const int64_t pad_h = params.padding_before[1];
+  const int64_t pad_w = params.padding_before[2];
+  const int64_t tiles_h = (out_h + 1) / 2;
+  const int64_t tiles_w = (out_w + 1) / 2;
+  const int64_t num_tiles = GetCpuWinogradNumTiles(params);
+  const int64_t chunk_tiles = GetCpuWinogradChunkTiles(params, sizeof(T));
+  T* u = tmp;
+  T* v = u + 16 * oc_num * ic_num;
+  T* m = v + 16 * ic_num * chunk_tiles;
+
+  // u = G g G^T, G = [[1, 0, 0], [1/2, 1/2, 1/2], [1/2, -1/2, 1/2], [0, 0, 1]]
+  cpu_stream->ParallelFor(
+      0, oc_num * ic_num,
+      [&](int64_t begin, int64_t end) {
+        for (int64_t i = begin; i < end; ++i) {
+          const T* g = weight + i * 9;
+          T gg[4][3];
+          for (int col = 0; col < 3; ++col) {
+            gg[0][col] = g[col];
+            gg[1][col] = (g[col] + g[3 + col] + g[6 + col]) / 2;
+            gg[2][col] = (g[col] - g[3 + col] + g[6 + col]) / 2;
+            gg[3][col] = g[6 + col];
+          }
+          for (int row = 0; row < 4; ++row) {
+            const T r[4] = {gg[row][0], (gg[row][0] + gg[row][1] + gg[row][2]) / 2,
+                            (gg[row][0] - gg[row][1] + gg[row][2]) / 2, gg[row][2]};
+            for (int col = 0; col < 4; ++col) { u[(row * 4 + col) * oc_num * ic_num + i] = r[col]; }
+          }
+        }
+      },
+      std::max<int64_t>(kCpuGrain / 64, 1));
+
+  for (int64_t chunk_begin = 0; chunk_begin < num_tiles; chunk_begin += chunk_tiles) {
+    const int64_t chunk_size = std::min(chunk_tiles, num_tiles - chunk_begin);
+    // v = B^T d B, B^T = [[1, 0, -1, 0], [0, 1, 1, 0], [0, -1, 1, 0], [0, 1, 0, -1]]
+    cpu_stream->ParallelFor(
+        0, ic_num * chunk_size,
+        [&](int64_t begin, int64_t end) {
+          for (int64_t i = begin; i < end; ++i) {
+            const int64_t ic = i / chunk_size;
+            const int64_t t = i % chunk_size;
+            const int64_t tile = chunk_begin + t;
+            const int64_t n = tile / (tiles_h * tiles_w);
+            const int64_t h0 = (tile / tiles_w) % tiles_h * 2 - pad_h;
+            const int64_t w0 = tile % tiles_w * 2 - pad_w;
+            const T* in_plane = in + (n * ic_num + ic) * in_h * in_w;
+            T d[4][4];
+            for (int row = 0; row < 4; ++row) {
+              const int64_t h = h0 + row;
+              for (int col = 0; col < 4; ++col) {
+                const int64_t w = w0 + col;
+                d[row][col] = (h >= 0 && h < in_h && w >= 0 && w < in_w) ? in_plane[h * in_w + w]
+                                                                         : static_cast<T>(0);
+              }
+            }
+            T bd[4][4];
+            for (int col = 0; col < 4; ++col) {
+              bd[0][col] = d[0][col] - d[2][col];
+              bd[1][col] = d[1][col] + d[2][col];
+              bd[2][col] = d[2][col] - d[1][col];
+              bd[3][col] = d[1][col] - d[3][col];
+            }
+            for (int row = 0; row < 4; ++row) {
+              const T r[4] = {bd[row][0] - bd[row][2], bd[row][1] + bd[row][2],
+                              bd[row][2] - bd[row][1], bd[row][1] - bd[row][3]};
+              for (int col = 0; col < 4; ++col) {
+                v[((row * 4 + col) * ic_num + ic) * chunk_size + t] = r[col];
+              }
+            }
+          }
+        },
+        std::max<int64_t>(kCpuGrain / 64, 1));
+    for (int64_t xi = 0; xi < 16; ++xi) {
+      matmul->Launch(stream, oc_num, chunk_size, ic_num, static_cast<T>(1),
+                     u + xi * oc_num * ic_num, v + xi * ic_num * chunk_size, static_cast<T>(0),
+                     m + xi * oc_num * chunk_size);
+    }
+    // y = A^T m A, A^T = [[1, 1, 1, 0], [0, 1, -1, -1]]
+    cpu_stream->ParallelFor(
+        0, oc_num * chunk_size,
+        [&](int64_t begin, int64_t end) {
+          for (int64_t i = begin; i < end; ++i) {
+            const int64_t oc = i / chunk_size;
+            const int64_t t = i % chunk_size;
+            const int64_t tile = chunk_begin + t;
+            const int64_t n = tile / (tiles_h * tiles_w);
+            const int64_t h0 = (tile / tiles_w) % tiles_h * 2;
+            const int64_t w0 = tile % tiles_w * 2;
+            T mm[4][4];
+            for (int xi = 0; xi < 16; ++xi) {
+              mm[xi / 4][xi % 4] = m[(xi * oc_num + oc) * chunk_size + t];
+            }
+            T am[2][4];
+            for (int col = 0; col < 4; ++col) {
+              am[0][col] = mm[0][col] + mm[1][col] + mm[2][col];
+              am[1][col] = mm[1][col] - mm[2][col] - mm[3][col];
+            }
+            const T bias_value = bias == nullptr ? static_cast<T>(0) : bias[oc];
+            T* out_plane = out + (n * oc_num + oc) * out_h * out_w;
+            for (int row = 0; row < 2 && h0 + row < out_h; ++row) {
+              const T y[2] = {am[row][0] + am[row][1] + am[row][2],
+                              am[row][1] - am[row][2] - am[row][3]};
+              for (int col = 0; col < 2 && w0 + col < out_w; ++col) {
+                T* dst = out_plane + (h0 + row) * out_w + w0 + col;
+                *dst = (beta == static_cast<T>(0) ? static_cast<T>(0) : beta * *dst) + y[col]
+                       + bias_value;
+              }
+            }
+          }
+        },
+        std::max<int64_t>(kCpuGrain / 64, 1));
+  }
+}
+
+// out += bias for the channels first output of shape (batch, channels, volume).
+template<typename T>
+void CpuConvAddBias(ep::Stream* stream, int64_t batch, int64_t channels, int64_t volume,
+                    const T* bias, T* out) {
+  CpuConvParallelForPlanes(stream, batch * channels, volume, [&](int64_t begin, int64_t end) {
+    for (int64_t plane = begin; plane < end; ++plane) {
+      const T bias_value = bias[plane % channels];
+      T* out_plane = out + plane * volume;
+      for (int64_t i = 0; i < volume; ++i) { out_plane[i] += bias_value; }
+    }
+  });
+}
+
+}  // namespace conv
+
+}  // namespace oneflow
+
+#endif  // ONEFLOW_USER_KERNELS_CONV_CPU_UTIL_H_
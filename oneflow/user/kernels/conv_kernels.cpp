@@ -18,6 +18,7 @@ limitations under the License.
 #include "oneflow/core/kernel/kernel_util.h"
 #include "oneflow/core/ep/include/primitive/add.h"
 #include "oneflow/core/ep/include/primitive/matmul.h"
+#include "oneflow/user/kernels/conv_cpu_util.h"
 
 namespace oneflow {
 
@@ -418,6 +419,9 @@ struct ConvOpKernelCache final : public user_op::OpKernelCache {
 
   int32_t idx_offset_{};
   bool is_dynamic_{};
+
+  conv::CpuConvParams params_;
+  conv::CpuConvAlgo algo_ = conv::CpuConvAlgo::kIm2ColGemm;
 };
 
 template<typename T>
@@ -490,7 +494,11 @@ class ConvCpuKernel final : public user_op::OpKernel {
 
   std::shared_ptr<user_op::OpKernelCache> InitOpKernelCache(
       user_op::KernelCacheContext* ctx) const override {
-    return CreateConvOpKernelCache<T>(ctx, "in", "out", "weight");
+    auto cache = CreateConvOpKernelCache<T>(ctx, "in", "out", "weight");
+    cache->params_ = conv::MakeCpuConvParams(ctx, ctx->TensorDesc4ArgNameAndIndex("in", 0)->shape(),
+                                             ctx->TensorDesc4ArgNameAndIndex("out", 0)->shape());
+    cache->algo_ = conv::GetCpuConvAlgo(cache->params_);
+    return cache;
   }
 
  private:
@@ -503,8 +511,8 @@ class ConvCpuKernel final : public user_op::OpKernel {
     const user_op::Tensor* weight = ctx->Tensor4ArgNameAndIndex("weight", 0);
     user_op::Tensor* tmp_buffer = ctx->Tensor4ArgNameAndIndex("tmp_buffer", 0);
     user_op::Tensor* out = ctx->Tensor4ArgNameAndIndex("out", 0);
-
-    T* col_buf_dptr = tmp_buffer->mut_dptr<T>();
+    const user_op::Tensor* bias = ctx->Tensor4ArgNameAndIndex("bias", 0);
+    const T* bias_dptr = bias == nullptr ? nullptr : bias->dptr<T>();
 
     bool is_bias_mul_inited = false;
 
@@ -528,6 +536,33 @@ class ConvCpuKernel final : public user_op::OpKernel {
       beta = 1;
     }
 
+    conv::CpuConvParams params = conv_cache->params_;
+    params.batch = in->shape_view().At(0);
+    if (conv_cache->algo_ == conv::CpuConvAlgo::kDirect) {
+      conv::CpuDirectConv<T>(ctx->stream(), params, in->dptr<T>(), weight->dptr<T>(), bias_dptr,
+                             static_cast<T>(beta), out->mut_dptr<T>());
+      return;
+    }
+    if (conv_cache->algo_ == conv::CpuConvAlgo::kWinograd) {
+      conv::CpuWinogradConv<T>(ctx->stream(), params, in->dptr<T>(), weight->dptr<T>(), bias_dptr,
+                               static_cast<T>(beta), out->mut_dptr<T>(), tmp_buffer->mut_dptr<T>());
+      return;
+    }
+    if (conv_cache->algo_ == conv::CpuConvAlgo::kGemm1x1) {
+      // out = weight * in, the col buffer of a 1x1 conv being the image itself
+      for (int64_t i = 0; i < in->shape_view().At(0); ++i) {
+        matmul->Launch(ctx->stream(), params.out_channels, params.OutVolume(), params.in_channels,
+                       static_cast<T>(1), weight->dptr<T>(), GetImgDptr<T>(in, i), beta,
+                       GetImgMutDptr<T>(out, i));
+      }
+      if (bias_dptr != nullptr) {
+        conv::CpuConvAddBias<T>(ctx->stream(), params.batch, params.out_channels,
+                                params.OutVolume(), bias_dptr, out->mut_dptr<T>());
+      }
+      return;
+    }
+
+    T* col_buf_dptr = tmp_buffer->mut_dptr<T>();
     for (int64_t i = 0; i < in->shape_view().At(0); ++i) {
       conv_cache->im2col_func_(GetImgDptr<T>(in, i), ShapeView(conv_cache->in_5d_shape_),
                                ShapeView(conv_cache->weight_5d_shape_),
@@ -545,7 +580,6 @@ class ConvCpuKernel final : public user_op::OpKernel {
                      static_cast<T>(1), weight->dptr<T>(), col_buf_dptr, beta,
                      GetImgMutDptr<T>(out, i));
 
-      const user_op::Tensor* bias = ctx->Tensor4ArgNameAndIndex("bias", 0);
       if (bias != nullptr) {
         int64_t num_of_col_buf =
             CalcElemNumOfColBuf(out->shape_view(), weight->shape_view(), idx_offset);
@@ -583,6 +617,13 @@ class ConvCpuKernel final : public user_op::OpKernel {
         size_t tmp_buffer_size = 0;                                                         \
         const auto& out_shape = ctx->OutputTensorDesc("out", 0).shape();                    \
         const auto& weight_shape = ctx->InputTensorDesc("weight", 0).shape();               \
+        const auto params =                                                                 \
+            conv::MakeCpuConvParams(ctx, ctx->InputTensorDesc("in", 0).shape(), out_shape); \
+        const auto algo = conv::GetCpuConvAlgo(params);                                     \
+        if (algo == conv::CpuConvAlgo::kWinograd) {                                         \
+          return conv::GetCpuWinogradTmpSize(params, sizeof(dtype)) * sizeof(dtype);        \
+        }                                                                                   \
+        if (algo != conv::CpuConvAlgo::kIm2ColGemm) { return 0; }                           \
                                                                                             \
         int64_t idx_offset = IdxOffset(ctx->Attr<std::string>("data_format"));              \
         tmp_buffer_size +=                                                                  \
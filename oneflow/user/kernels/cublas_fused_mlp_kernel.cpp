@@ -0,0 +1,78 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include <cstring>
+#include "oneflow/core/framework/framework.h"
+#include "oneflow/user/kernels/fused_mlp_cpu_util.h"
+
+namespace oneflow {
+
+namespace {
+
+template<typename T>
+class CublasFusedMLPCpuKernel final : public user_op::OpKernel {
+ public:
+  CublasFusedMLPCpuKernel() = default;
+  ~CublasFusedMLPCpuKernel() override = default;
+
+ private:
+  void Compute(user_op::KernelComputeContext* ctx) const override {
+    const int32_t weight_size = ctx->input_size("weights");
+    CHECK_EQ(weight_size, ctx->input_size("biases"))
+        << "The number of weight and bias is not equal!. ";
+    const bool skip_final_activation = ctx->Attr<bool>("skip_final_activation");
+    LaunchFusedMLP<T>(ctx, [&](int32_t idx, int64_t row_begin, int64_t row_end, int64_t n, T* y) {
+      const T* bias = ctx->Tensor4ArgNameAndIndex("biases", idx)->dptr<T>();
+      const bool relu = idx != weight_size - 1 || !skip_final_activation;
+      // The relu mask is saved as the bit mask of cublas_aux like the cuda kernel.
+      user_op::Tensor* cublas_aux = ctx->Tensor4ArgNameAndIndex("cublas_aux", idx);
+      const int64_t aux_ld = cublas_aux->shape_view().At(1);
+      int32_t* aux = cublas_aux->mut_dptr<int32_t>();
+      ParallelForEachRow(ctx->stream(), row_begin, row_end, n, [&](int64_t row) {
+        T* y_row = y + row * n;
+        if (!relu) {
+          for (int64_t col = 0; col < n; ++col) { y_row[col] += bias[col]; }
+          return;
+        }
+        int32_t* aux_row = aux + row * aux_ld;
+        std::memset(aux_row, 0, aux_ld * sizeof(int32_t));
+        for (int64_t col = 0; col < n; ++col) {
+          const T value = y_row[col] + bias[col];
+          if (value > static_cast<T>(0)) {
+            y_row[col] = value;
+            aux_row[col / 32] |= (1U << (col % 32));
+          } else {
+            y_row[col] = static_cast<T>(0);
+          }
+        }
+      });
+    });
+  }
+
+  bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
+};
+
+#define REGISTER_CUBLAS_FUSED_MLP_KERNEL_CPU(cpp_type, data_type)     \
+  REGISTER_USER_KERNEL("cublas_fused_mlp")                            \
+      .SetCreateFn<CublasFusedMLPCpuKernel<cpp_type>>()               \
+      .SetIsMatchedHob((user_op::HobDeviceType() == DeviceType::kCPU) \
+                       && (user_op::HobDataType("out", 0) == data_type));
+
+REGISTER_CUBLAS_FUSED_MLP_KERNEL_CPU(float, DataType::kFloat);
+REGISTER_CUBLAS_FUSED_MLP_KERNEL_CPU(double, DataType::kDouble);
+
+}  // namespace
+
+}  // namespace oneflow
@@ -0,0 +1,340 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/framework/framework.h"
+#include "oneflow/core/ep/cpu/cpu_stream.h"
+
+namespace oneflow {
+
+// The cpu id_shuffle, embedding_shuffle and embedding_gradient_shuffle kernels run on a single
+// rank, where the all-to-all exchanges of the cuda kernels are identities: the partitioned unique
+// ids of the rank are the ids it receives, so they are already unique and the cur rank inverse
+// indices map each of them to itself.
+
+namespace {
+
+// Number of elements processed by a task of the cpu data shuffle kernels.
+constexpr int64_t kCpuGrain = 32768;
+
+// Inverse index of the ids equal to padding_idx, the gathers zero their rows and the segment sums
+// skip them, as they do for any out of range index.
+constexpr uint32_t kPaddingRevIndex = 0xffffffff;
+
+template<typename IDX>
+int64_t GetCurRankNumIds(const user_op::Tensor* num_unique_matrix, int64_t parallel_num) {
+  CHECK_EQ(parallel_num, 1) << "The cpu one_embedding data shuffle kernels only support a single "
+                               "rank, use the cuda kernels for multiple ranks. ";
+  return static_cast<int64_t>(*num_unique_matrix->dptr<IDX>());
+}
+
+// Copies the rows in[indices[i]] to out[i] for i in [0, num_indices), zeroing the rows of the
+// indices not in [0, num_rows).
+template<typename T, typename IDX>
+void CpuGatherRows(ep::Stream* stream, int64_t num_indices, const IDX* indices, int64_t num_rows,
+                   int64_t row_size, const T* in, T* out) {
+  stream->As<ep::CpuStream>()->ParallelFor(
+      0, num_indices,
+      [&](int64_t begin, int64_t end) {
+        for (int64_t i = begin; i < end; ++i) {
+          const int64_t index = static_cast<int64_t>(indices[i]);
+          T* out_row = out + i * row_size;
+          if (index >= 0 && index < num_rows) {
+            std::copy(in + index * row_size, in + (index + 1) * row_size, out_row);
+          } else {
+            std::fill(out_row, out_row + row_size, static_cast<T>(0));
+          }
+        }
+      },
+      std::max<int64_t>(kCpuGrain / std::max<int64_t>(row_size, 1), 1));
+}
+
+}  // namespace
+
+template<typename K, typename U, typename IDX>
+class CpuIdShuffleKernel final : public user_op::OpKernel {
+ public:
+  CpuIdShuffleKernel() = default;
+  ~CpuIdShuffleKernel() override = default;
+
+ private:
+  using user_op::OpKernel::Compute;
+  void Compute(user_op::KernelComputeContext* ctx) const override {
+    const user_op::Tensor* ids = ctx->Tensor4ArgNameAndIndex("ids", 0);
+    user_op::Tensor* num_unique_matrix = ctx->Tensor4ArgNameAndIndex("num_unique_matrix", 0);
+    user_op::Tensor* inverse_unique_partition_indices =
+        ctx->Tensor4ArgNameAndIndex("inverse_unique_partition_indices", 0);
+    user_op::Tensor* cur_rank_num_unique = ctx->Tensor4ArgNameAndIndex("cur_rank_num_unique", 0);
+    user_op::Tensor* cur_rank_unique_ids = ctx->Tensor4ArgNameAndIndex("cur_rank_unique_ids", 0);
+    user_op::Tensor* cur_rank_unique_table_ids =
+        ctx->Tensor4ArgNameAndIndex("cur_rank_unique_table_ids", 0);
+    user_op::Tensor* cur_rank_inverse_indices =
+        ctx->Tensor4ArgNameAndIndex("cur_rank_inverse_indices", 0);
+    CHECK_EQ(ctx->parallel_ctx().parallel_num(), 1)
+        << "The cpu id_shuffle kernel only supports a single rank. ";
+    const int32_t num_tables = ctx->Attr<int32_t>("num_tables");
+    const int64_t padding_idx = ctx->Attr<int64_t>("padding_idx");
+    const bool has_padding_idx = ctx->Attr<bool>("has_padding_idx");
+    const U* table_ids_ptr = nullptr;
+    if (ctx->has_input("table_ids", 0)) {
+      table_ids_ptr = ctx->Tensor4ArgNameAndIndex("table_ids", 0)->dptr<U>();
+    }
+    const int64_t num_ids = ids->shape_view().elem_cnt();
+    const K* ids_ptr = ids->dptr<K>();
+    IDX* inverse_ptr = inverse_unique_partition_indices->mut_dptr<IDX>();
+    K* unique_ids_ptr = cur_rank_unique_ids->mut_dptr<K>();
+    U* unique_table_ids_ptr = cur_rank_unique_table_ids->mut_dptr<U>();
+    // Same as the cuda kernel, the ids are unique by id and each unique id keeps the table id of
+    // one of its occurrences, the table ids are generated from the column when there are several
+    // tables and no table_ids input.
+    HashMap<K, IDX> unique_index;
+    unique_index.reserve(num_ids);
+    IDX num_unique = 0;
+    for (int64_t i = 0; i < num_ids; ++i) {
+      const K id = ids_ptr[i];
+      if (has_padding_idx && static_cast<int64_t>(id) == padding_idx) {
+        inverse_ptr[i] = static_cast<IDX>(kPaddingRevIndex);
+        continue;
+      }
+      auto it = unique_index.emplace(id, num_unique);
+      if (it.second) {
+        unique_ids_ptr[num_unique] = id;
+        if (table_ids_ptr != nullptr) {
+          unique_table_ids_ptr[num_unique] = table_ids_ptr[i];
+        } else {
+          unique_table_ids_ptr[num_unique] = static_cast<U>(num_tables > 1 ? i % num_tables : 0);
+        }
+        num_unique += 1;
+      }
+      inverse_ptr[i] = it.first->second;
+    }
+    *num_unique_matrix->mut_dptr<IDX>() = num_unique;
+    *cur_rank_num_unique->mut_dptr<IDX>() = num_unique;
+    IDX* cur_rank_inverse_ptr = cur_rank_inverse_indices->mut_dptr<IDX>();
+    ctx->stream()->As<ep::CpuStream>()->ParallelFor(
+        0, static_cast<int64_t>(num_unique),
+        [&](int64_t begin, int64_t end) {
+          for (int64_t i = begin; i < end; ++i) { cur_rank_inverse_ptr[i] = static_cast<IDX>(i); }
+        },
+        kCpuGrain);
+  }
+  bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
+};
+
+#define ID_DATA_TYPE_SEQ                            \
+  OF_PP_MAKE_TUPLE_SEQ(uint32_t, DataType::kUInt32) \
+  OF_PP_MAKE_TUPLE_SEQ(uint64_t, DataType::kUInt64) \
+  OF_PP_MAKE_TUPLE_SEQ(int32_t, DataType::kInt32)   \
+  OF_PP_MAKE_TUPLE_SEQ(int64_t, DataType::kInt64)
+
+#define TABLE_ID_DATA_TYPE_SEQ                      \
+  OF_PP_MAKE_TUPLE_SEQ(uint8_t, DataType::kUInt8)   \
+  OF_PP_MAKE_TUPLE_SEQ(uint32_t, DataType::kUInt32) \
+  OF_PP_MAKE_TUPLE_SEQ(uint64_t, DataType::kUInt64) \
+  OF_PP_MAKE_TUPLE_SEQ(int8_t, DataType::kInt8)     \
+  OF_PP_MAKE_TUPLE_SEQ(int32_t, DataType::kInt32)   \
+  OF_PP_MAKE_TUPLE_SEQ(int64_t, DataType::kInt64)
+
+#define IDX_DATA_TYPE_SEQ                           \
+  OF_PP_MAKE_TUPLE_SEQ(uint32_t, DataType::kUInt32) \
+  OF_PP_MAKE_TUPLE_SEQ(int32_t, DataType::kInt32)
+
+#define REGISTER_CPU_ID_SHUFFLE_KERNEL(k_dtype_pair, table_id_dtype_pair, idx_dtype_pair)     \
+  REGISTER_USER_KERNEL("id_shuffle")                                                          \
+      .SetCreateFn<CpuIdShuffleKernel<OF_PP_PAIR_FIRST(k_dtype_pair),                         \
+                                      OF_PP_PAIR_FIRST(table_id_dtype_pair),                  \
+                                      OF_PP_PAIR_FIRST(idx_dtype_pair)>>()                    \
+      .SetIsMatchedHob((user_op::HobDeviceType() == DeviceType::kCPU)                         \
+                       && (user_op::HobDataType("ids", 0) == OF_PP_PAIR_SECOND(k_dtype_pair)) \
+                       && (user_op::HobDataType("cur_rank_unique_table_ids", 0)               \
+                           == OF_PP_PAIR_SECOND(table_id_dtype_pair))                         \
+                       && (user_op::HobDataType("num_unique_matrix", 0)                       \
+                           == OF_PP_PAIR_SECOND(idx_dtype_pair)));
+
+OF_PP_SEQ_PRODUCT_FOR_EACH_TUPLE(REGISTER_CPU_ID_SHUFFLE_KERNEL, ID_DATA_TYPE_SEQ,
+                                 TABLE_ID_DATA_TYPE_SEQ, IDX_DATA_TYPE_SEQ)
+
+template<typename T, typename IDX>
+class CpuEmbeddingShuffleKernel final : public user_op::OpKernel {
+ public:
+  CpuEmbeddingShuffleKernel() = default;
+  ~CpuEmbeddingShuffleKernel() override = default;
+
+ private:
+  using user_op::OpKernel::Compute;
+  void Compute(user_op::KernelComputeContext* ctx) const override {
+    const user_op::Tensor* cur_rank_embeddings =
+        ctx->Tensor4ArgNameAndIndex("cur_rank_embeddings", 0);
+    const user_op::Tensor* num_unique_matrix = ctx->Tensor4ArgNameAndIndex("num_unique_matrix", 0);
+    const user_op::Tensor* cur_rank_inverse_indices =
+        ctx->Tensor4ArgNameAndIndex("cur_rank_inverse_indices", 0);
+    const user_op::Tensor* inverse_unique_partition_indices =
+        ctx->Tensor4ArgNameAndIndex("inverse_unique_partition_indices", 0);
+    user_op::Tensor* embeddings = ctx->Tensor4ArgNameAndIndex("embeddings", 0);
+    const int64_t embedding_size = ctx->Attr<int64_t>("embedding_size");
+    const bool skip_last_gather = ctx->Attr<bool>("skip_last_gather");
+    const int64_t num_ids = inverse_unique_partition_indices->shape_view().elem_cnt();
+    const int64_t cur_rank_num_ids =
+        GetCurRankNumIds<IDX>(num_unique_matrix, ctx->parallel_ctx().parallel_num());
+    const int64_t num_cur_rank_embeddings =
+        cur_rank_embeddings->shape_view().elem_cnt() / embedding_size;
+    const IDX* cur_rank_inverse_ptr = cur_rank_inverse_indices->dptr<IDX>();
+    if (skip_last_gather) {
+      // The embeddings are left in the order of the unique partitioned ids.
+      CpuGatherRows(ctx->stream(), cur_rank_num_ids, cur_rank_inverse_ptr,
+                    num_cur_rank_embeddings, embedding_size, cur_rank_embeddings->dptr<T>(),
+                    embeddings->mut_dptr<T>());
+      return;
+    }
+    // Composes the two gathers of the cuda kernel, the embeddings of the unique partitioned ids
+    // are never materialized.
+    const IDX* inverse_ptr = inverse_unique_partition_indices->dptr<IDX>();
+    const T* cur_rank_embeddings_ptr = cur_rank_embeddings->dptr<T>();
+    T* embeddings_ptr = embeddings->mut_dptr<T>();
+    ctx->stream()->As<ep::CpuStream>()->ParallelFor(
+        0, num_ids,
+        [&](int64_t begin, int64_t end) {
+          for (int64_t i = begin; i < end; ++i) {
+            const int64_t unique_index = static_cast<int64_t>(inverse_ptr[i]);
+            int64_t index = -1;
+            if (unique_index >= 0 && unique_index < cur_rank_num_ids) {
+              index = static_cast<int64_t>(cur_rank_inverse_ptr[unique_index]);
+            }
+            T* out_row = embeddings_ptr + i * embedding_size;
+            if (index >= 0 && index < num_cur_rank_embeddings) {
+              const T* in_row = cur_rank_embeddings_ptr + index * embedding_size;
+              std::copy(in_row, in_row + embedding_size, out_row);
+            } else {
+              std::fill(out_row, out_row + embedding_size, static_cast<T>(0));
+            }
+          }
+        },
+        std::max<int64_t>(kCpuGrain / std::max<int64_t>(embedding_size, 1), 1));
+  }
+  bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
+};
+
+#define REGISTER_CPU_EMBEDDING_SHUFFLE_KERNEL(t_dtype_pair, idx_dtype_pair)                        \
+  REGISTER_USER_KERNEL("embedding_shuffle")                                                        \
+      .SetCreateFn<CpuEmbeddingShuffleKernel<OF_PP_PAIR_FIRST(t_dtype_pair),                       \
+                                             OF_PP_PAIR_FIRST(idx_dtype_pair)>>()                  \
+      .SetIsMatchedHob(                                                                            \
+          (user_op::HobDeviceType() == DeviceType::kCPU)                                           \
+          && (user_op::HobDataType("cur_rank_embeddings", 0) == OF_PP_PAIR_SECOND(t_dtype_pair))   \
+          && (user_op::HobDataType("num_unique_matrix", 0) == OF_PP_PAIR_SECOND(idx_dtype_pair)));
+
+OF_PP_SEQ_PRODUCT_FOR_EACH_TUPLE(REGISTER_CPU_EMBEDDING_SHUFFLE_KERNEL, FLOATING_DATA_TYPE_SEQ,
+                                 IDX_DATA_TYPE_SEQ)
+
+template<typename T, typename IDX>
+class CpuEmbeddingGradientShuffleKernel final : public user_op::OpKernel {
+ public:
+  CpuEmbeddingGradientShuffleKernel() = default;
+  ~CpuEmbeddingGradientShuffleKernel() override = default;
+
+ private:
+  using user_op::OpKernel::Compute;
+  void Compute(user_op::KernelComputeContext* ctx) const override {
+    const user_op::Tensor* embedding_grad = ctx->Tensor4ArgNameAndIndex("embedding_grad", 0);
+    const user_op::Tensor* num_unique_matrix = ctx->Tensor4ArgNameAndIndex("num_unique_matrix", 0);
+    const user_op::Tensor* cur_rank_inverse_indices =
+        ctx->Tensor4ArgNameAndIndex("cur_rank_inverse_indices", 0);
+    const user_op::Tensor* inverse_unique_partition_indices =
+        ctx->Tensor4ArgNameAndIndex("inverse_unique_partition_indices", 0);
+    user_op::Tensor* cur_rank_unique_embedding_grad =
+        ctx->Tensor4ArgNameAndIndex("cur_rank_unique_embedding_grad", 0);
+    user_op::Tensor* tmp_buffer = ctx->Tensor4ArgNameAndIndex("tmp_buffer", 0);
+    const int64_t embedding_size = ctx->Attr<int64_t>("embedding_size");
+    const bool only_zero_valid_grad = ctx->Attr<bool>("only_zero_valid_grad");
+    const bool skip_first_scatter = ctx->Attr<bool>("skip_first_scatter");
+    const int64_t num_ids = inverse_unique_partition_indices->shape_view().elem_cnt();
+    const int64_t cur_rank_num_ids =
+        GetCurRankNumIds<IDX>(num_unique_matrix, ctx->parallel_ctx().parallel_num());
+    const int64_t num_out_rows =
+        cur_rank_unique_embedding_grad->shape_view().elem_cnt() / embedding_size;
+    const IDX* cur_rank_inverse_ptr = cur_rank_inverse_indices->dptr<IDX>();
+    const IDX* inverse_ptr = inverse_unique_partition_indices->dptr<IDX>();
+    // Each grad row i is summed into the row segment(i) of the output, the rows are bucketed by
+    // segment with a counting sort so that each output row is summed by a single task, in the
+    // order of the ids, without atomics.
+    const int64_t num_grad_rows = skip_first_scatter ? cur_rank_num_ids : num_ids;
+    auto segment = [&](int64_t i) -> int64_t {
+      int64_t unique_index = i;
+      if (!skip_first_scatter) {
+        unique_index = static_cast<int64_t>(inverse_ptr[i]);
+        if (unique_index < 0 || unique_index >= cur_rank_num_ids) { return -1; }
+      }
+      const int64_t index = static_cast<int64_t>(cur_rank_inverse_ptr[unique_index]);
+      return (index >= 0 && index < num_out_rows) ? index : -1;
+    };
+    int64_t num_unique = 0;
+    for (int64_t i = 0; i < cur_rank_num_ids; ++i) {
+      num_unique = std::max(num_unique, static_cast<int64_t>(cur_rank_inverse_ptr[i]) + 1);
+    }
+    num_unique = std::min(num_unique, num_out_rows);
+    int64_t* offsets = tmp_buffer->mut_dptr<int64_t>();
+    int64_t* sorted_rows = offsets + num_unique + 1;
+    std::fill(offsets, offsets + num_unique + 1, 0);
+    for (int64_t i = 0; i < num_grad_rows; ++i) {
+      const int64_t index = segment(i);
+      if (index >= 0) { offsets[index + 1] += 1; }
+    }
+    for (int64_t row = 0; row < num_unique; ++row) { offsets[row + 1] += offsets[row]; }
+    for (int64_t i = 0; i < num_grad_rows; ++i) {
+      const int64_t index = segment(i);
+      if (index >= 0) { sorted_rows[offsets[index]++] = i; }
+    }
+    // offsets[row] is now the end of the bucket of row, which is the begin of the next bucket.
+    const T* grad_ptr = embedding_grad->dptr<T>();
+    T* out_ptr = cur_rank_unique_embedding_grad->mut_dptr<T>();
+    const int64_t num_zero_rows = only_zero_valid_grad ? num_unique : num_out_rows;
+    ctx->stream()->As<ep::CpuStream>()->ParallelFor(
+        0, num_zero_rows,
+        [&](int64_t begin, int64_t end) {
+          for (int64_t row = begin; row < end; ++row) {
+            T* out_row = out_ptr + row * embedding_size;
+            std::fill(out_row, out_row + embedding_size, static_cast<T>(0));
+            if (row >= num_unique) { continue; }
+            const int64_t bucket_begin = row == 0 ? 0 : offsets[row - 1];
+            for (int64_t k = bucket_begin; k < offsets[row]; ++k) {
+              const T* grad_row = grad_ptr + sorted_rows[k] * embedding_size;
+              for (int64_t col = 0; col < embedding_size; ++col) { out_row[col] += grad_row[col]; }
+            }
+          }
+        },
+        std::max<int64_t>(kCpuGrain / std::max<int64_t>(embedding_size, 1), 1));
+  }
+  bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
+};
+
+#define REGISTER_CPU_EMBEDDING_GRADIENT_SHUFFLE_KERNEL(t_dtype_pair, idx_dtype_pair)              \
+  REGISTER_USER_KERNEL("embedding_gradient_shuffle")                                              \
+      .SetCreateFn<CpuEmbeddingGradientShuffleKernel<OF_PP_PAIR_FIRST(t_dtype_pair),              \
+                                                     OF_PP_PAIR_FIRST(idx_dtype_pair)>>()         \
+      .SetIsMatchedHob(                                                                           \
+          (user_op::HobDeviceType() == DeviceType::kCPU)                                          \
+          && (user_op::HobDataType("embedding_grad", 0) == OF_PP_PAIR_SECOND(t_dtype_pair))       \
+          && (user_op::HobDataType("num_unique_matrix", 0) == OF_PP_PAIR_SECOND(idx_dtype_pair))) \
+      .SetInferTmpSizeFn([](user_op::InferContext* ctx) {                                         \
+        const int64_t num_ids =                                                                   \
+            ctx->InputTensorDesc("inverse_unique_partition_indices", 0).shape().elem_cnt();       \
+        const int64_t num_out_rows =                                                              \
+            ctx->InputTensorDesc("cur_rank_inverse_indices", 0).shape().elem_cnt();               \
+        return (num_out_rows + 1 + std::max(num_ids, num_out_rows)) * sizeof(int64_t);            \
+      });
+
+OF_PP_SEQ_PRODUCT_FOR_EACH_TUPLE(REGISTER_CPU_EMBEDDING_GRADIENT_SHUFFLE_KERNEL,
+                                 FLOATING_DATA_TYPE_SEQ, IDX_DATA_TYPE_SEQ)
+
+}  // namespace oneflow
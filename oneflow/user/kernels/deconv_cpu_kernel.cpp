@@ -18,6 +18,7 @@ limitations under the License.
 #include "oneflow/user/ops/nn_util.h"
 #include "oneflow/core/kernel/kernel_util.h"
 #include "oneflow/core/ep/include/primitive/matmul.h"
+#include "oneflow/user/kernels/conv_cpu_util.h"
 
 namespace oneflow {
 
@@ -273,6 +274,9 @@ struct DeconvOpKernelCache final : public user_op::OpKernelCache {
   int32_t idx_offset_ = 0;
   bool is_dynamic_ = false;
 
+  conv::CpuConvParams params_;
+  bool use_direct_ = false;
+
   void Update(const ShapeView& x_shape, const ShapeView& out_shape) {
     auto Gen5DShape = [](const ShapeView& shape, int32_t idx_offset) -> Shape {
       DimVector ret_vec;
@@ -353,13 +357,19 @@ class DeconvCpuKernel final : public user_op::OpKernel {
   void InitOpKernelCacheWithFlags(
       user_op::KernelCacheContext* ctx, int8_t flag,
       std::shared_ptr<user_op::OpKernelCache>* cache_ptr) const override {
+    std::shared_ptr<DeconvOpKernelCache<T>> deconv_cache;
     if (*cache_ptr != nullptr && (flag & user_op::OpKernelCache::kAttrNotChanged)) {
-      auto deconv_cache = std::dynamic_pointer_cast<DeconvOpKernelCache<T>>(*cache_ptr);
+      deconv_cache = std::dynamic_pointer_cast<DeconvOpKernelCache<T>>(*cache_ptr);
       deconv_cache->Update(ctx->TensorDesc4ArgNameAndIndex("in", 0)->shape(),
                            ctx->TensorDesc4ArgNameAndIndex("out", 0)->shape());
-      return;
+    } else {
+      deconv_cache = CreateDeconvOpKernelCache<T>(ctx, "out", "in", "weight");
+      *cache_ptr = deconv_cache;
     }
-    *cache_ptr = CreateDeconvOpKernelCache<T>(ctx, "out", "in", "weight");
+    deconv_cache->params_ =
+        conv::MakeCpuConvParams(ctx, ctx->TensorDesc4ArgNameAndIndex("in", 0)->shape(),
+                                ctx->TensorDesc4ArgNameAndIndex("out", 0)->shape());
+    deconv_cache->use_direct_ = conv::UseCpuDirectDeconv(deconv_cache->params_);
   }
 
  private:
@@ -372,6 +382,14 @@ class DeconvCpuKernel final : public user_op::OpKernel {
     user_op::Tensor* out = ctx->Tensor4ArgNameAndIndex("out", 0);
     user_op::Tensor* col_buf = ctx->Tensor4ArgNameAndIndex("tmp_buffer", 0);
 
+    if (deconv_cache->use_direct_) {
+      conv::CpuConvParams params = deconv_cache->params_;
+      params.batch = in->shape_view().At(0);
+      conv::CpuDirectDeconv<T>(ctx->stream(), params, in->dptr<T>(), weight->dptr<T>(),
+                               out->mut_dptr<T>());
+      return;
+    }
+
     Memset<DeviceType::kCPU>(ctx->stream(), out->mut_dptr<T>(), 0,
                              out->shape_view().elem_cnt() * sizeof(T));
 
@@ -416,6 +434,9 @@ class DeconvCpuKernel final : public user_op::OpKernel {
         size_t tmp_buffer_size = 0;                                                     \
         const auto& in_shape = ctx->InputTensorDesc("in", 0).shape();                   \
         const auto& weight_shape = ctx->InputTensorDesc("weight", 0).shape();           \
+        const auto& out_shape = ctx->OutputTensorDesc("out", 0).shape();                \
+        const auto params = conv::MakeCpuConvParams(ctx, in_shape, out_shape);          \
+        if (conv::UseCpuDirectDeconv(params)) { return 0; }                             \
                                                                                         \
         int64_t idx_offset = IdxOffset(ctx->Attr<std::string>("data_format"));          \
         tmp_buffer_size +=                                                              \
@@ -16,10 +16,19 @@ limitations under the License.
 
 #include "oneflow/core/framework/framework.h"
 #include "oneflow/user/kernels/dim_scatter_kernel_util.h"
+#include "oneflow/core/ep/cpu/cpu_stream.h"
 
 namespace oneflow {
 namespace user_op {
 
+namespace {
+
+// Number of index elements handled by a task, smaller problems are done on the calling thread
+// since the thread pool may not honor the grain size.
+constexpr int64_t kCpuDimScatterGrain = 32768;
+
+}  // namespace
+
 template<typename IN_T, typename IDX_T, template<typename T> class Opt>
 struct DimScatterFunctor<DeviceType::kCPU, IN_T, IDX_T, Opt> final {
   void operator()(ep::Stream* stream, const DimOpIndexNdHelper<IDX_T>& src_nd_helper,
@@ -27,8 +36,47 @@ struct DimScatterFunctor<DeviceType::kCPU, IN_T, IDX_T, Opt> final {
                   const DimOpIndexNdHelper<IDX_T>& output_nd_helper, const int ndim,
                   const int64_t elem_cnt, const int32_t dim, const int64_t upper_bound,
                   const IDX_T* index, const IN_T* src, IN_T* output) {
-    DoDimScatter<IN_T, IDX_T, Opt>(src_nd_helper, idx_nd_helper, output_nd_helper, ndim, elem_cnt,
-                                   dim, upper_bound, index, src, output);
+    if (elem_cnt == 0) { return; }
+    // The elements of index whose coordinates only differ at dim form a line, and a line only
+    // writes to the line of output with the same coordinates. Lines are scattered in parallel
+    // without conflicts, each one in order along dim, which keeps the result of the serial loop
+    // for every Opt including update.
+    IDX_T coordinate[kDimGatherMaxDimCount] = {0};
+    idx_nd_helper.OffsetToNdIndex(elem_cnt - 1, coordinate, ndim);
+    const int64_t dim_size = coordinate[dim] + 1;
+    std::fill(coordinate, coordinate + kDimGatherMaxDimCount, 0);
+    coordinate[dim] = 1;
+    const int64_t idx_dim_stride = idx_nd_helper.NdIndexToOffset(coordinate, ndim);
+    const int64_t src_dim_stride = src_nd_helper.NdIndexToOffset(coordinate, ndim);
+    const int64_t output_dim_stride = output_nd_helper.NdIndexToOffset(coordinate, ndim);
+    const int64_t num_lines = elem_cnt / dim_size;
+    auto scatter_lines = [&](int64_t begin, int64_t end) {
+      for (int64_t line = begin; line < end; ++line) {
+        const int64_t outer_idx = line / idx_dim_stride;
+        const int64_t idx_offset =
+            outer_idx * dim_size * idx_dim_stride + (line - outer_idx * idx_dim_stride);
+        IDX_T line_coordinate[kDimGatherMaxDimCount] = {0};
+        idx_nd_helper.OffsetToNdIndex(idx_offset, line_coordinate, ndim);
+        const int64_t src_offset = src_nd_helper.NdIndexToOffset(line_coordinate, ndim);
+        const int64_t output_offset = output_nd_helper.NdIndexToOffset(line_coordinate, ndim);
+        for (int64_t i = 0; i < dim_size; ++i) {
+          const IDX_T idx_elem = index[idx_offset + i * idx_dim_stride];
+          if (upper_bound != 0 && idx_elem >= upper_bound) {
+            UNIMPLEMENTED() << "The index element " << idx_elem
+                            << " is out of bounds for dimension " << dim << " with size "
+                            << upper_bound << ".";
+          }
+          Opt<IN_T>::apply(src + src_offset + i * src_dim_stride,
+                           output + output_offset + idx_elem * output_dim_stride);
+        }
+      }
+    };
+    if (elem_cnt <= kCpuDimScatterGrain) {
+      scatter_lines(0, num_lines);
+    } else {
+      stream->As<ep::CpuStream>()->ParallelFor(
+          0, num_lines, scatter_lines, std::max<int64_t>(kCpuDimScatterGrain / dim_size, 1));
+    }
   }
 };
 
@@ -139,4 +139,112 @@ OF_PP_SEQ_PRODUCT_FOR_EACH_TUPLE(REGISTER_CPU_EMBEDDING_KERNEL, EMBEDDING_DATA_T
                                  INDEX_DATA_TYPE_SEQ)
 #undef REGISTER_CPU_EMBEDDING_KERNEL
 
+namespace {
+
+EmbeddingBagMode GetEmbeddingBagMode(const std::string& mode) {
+  if (mode == "sum") {
+    return EmbeddingBagMode::kSum;
+  } else if (mode == "mean") {
+    return EmbeddingBagMode::kMean;
+  } else if (mode == "max") {
+    return EmbeddingBagMode::kMax;
+  } else {
+    UNIMPLEMENTED() << "unsupported embedding bag mode " << mode;
+    return EmbeddingBagMode::kSum;
+  }
+}
+
+}  // namespace
+
+template<typename T, typename IndexType>
+class CpuEmbeddingBagKernel final : public user_op::OpKernel {
+ public:
+  CpuEmbeddingBagKernel() = default;
+  ~CpuEmbeddingBagKernel() = default;
+
+ private:
+  void Compute(user_op::KernelComputeContext* ctx) const override {
+    const user_op::Tensor* weight = ctx->Tensor4ArgNameAndIndex("weight", 0);
+    const user_op::Tensor* indices = ctx->Tensor4ArgNameAndIndex("indices", 0);
+    const user_op::Tensor* offsets = ctx->Tensor4ArgNameAndIndex("offsets", 0);
+    const user_op::Tensor* per_sample_weights = nullptr;
+    if (ctx->has_input("per_sample_weights", 0)) {
+      per_sample_weights = ctx->Tensor4ArgNameAndIndex("per_sample_weights", 0);
+    }
+    user_op::Tensor* out = ctx->Tensor4ArgNameAndIndex("out", 0);
+    const EmbeddingBagMode mode = GetEmbeddingBagMode(ctx->Attr<std::string>("mode"));
+    const int64_t padding_idx = ctx->Attr<int64_t>("padding_idx");
+
+    const int64_t num_indices = indices->shape_view().elem_cnt();
+    const int64_t num_bags = offsets->shape_view().elem_cnt();
+    const int64_t emb_size = weight->shape_view().At(0);
+    const int64_t emb_dim = weight->shape_view().At(1);
+
+    EmbeddingBagFunctor<DeviceType::kCPU, T, IndexType>()(
+        ctx->stream(), weight->dptr<T>(), indices->dptr<IndexType>(), offsets->dptr<IndexType>(),
+        per_sample_weights == nullptr ? nullptr : per_sample_weights->dptr<T>(),
+        out->mut_dptr<T>(), mode, padding_idx, num_indices, num_bags, emb_size, emb_dim);
+  }
+  bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
+};
+
+template<typename T, typename IndexType>
+class CpuEmbeddingBagGradKernel final : public user_op::OpKernel {
+ public:
+  CpuEmbeddingBagGradKernel() = default;
+  ~CpuEmbeddingBagGradKernel() = default;
+
+ private:
+  void Compute(user_op::KernelComputeContext* ctx) const override {
+    const user_op::Tensor* dy = ctx->Tensor4ArgNameAndIndex("dy", 0);
+    const user_op::Tensor* weight = ctx->Tensor4ArgNameAndIndex("weight", 0);
+    const user_op::Tensor* indices = ctx->Tensor4ArgNameAndIndex("indices", 0);
+    const user_op::Tensor* offsets = ctx->Tensor4ArgNameAndIndex("offsets", 0);
+    const user_op::Tensor* per_sample_weights = nullptr;
+    if (ctx->has_input("per_sample_weights", 0)) {
+      per_sample_weights = ctx->Tensor4ArgNameAndIndex("per_sample_weights", 0);
+    }
+    user_op::Tensor* dx = ctx->Tensor4ArgNameAndIndex("dx", 0);
+    const EmbeddingBagMode mode = GetEmbeddingBagMode(ctx->Attr<std::string>("mode"));
+    const int64_t padding_idx = ctx->Attr<int64_t>("padding_idx");
+
+    const int64_t num_indices = indices->shape_view().elem_cnt();
+    const int64_t num_bags = offsets->shape_view().elem_cnt();
+    const int64_t emb_size = weight->shape_view().At(0);
+    const int64_t emb_dim = weight->shape_view().At(1);
+    T* dx_buf = dx->mut_dptr<T>();
+
+    std::unique_ptr<ep::primitive::Memset> memset_primitive =
+        ep::primitive::NewPrimitive<ep::primitive::MemsetFactory>(ctx->device_type());
+    CHECK(memset_primitive);
+    memset_primitive->Launch(ctx->stream(), dx_buf, 0, dx->shape_view().Count(0) * sizeof(T));
+    EmbeddingBagGradFunctor<DeviceType::kCPU, T, IndexType>()(
+        ctx->stream(), dy->dptr<T>(), weight->dptr<T>(), indices->dptr<IndexType>(),
+        offsets->dptr<IndexType>(),
+        per_sample_weights == nullptr ? nullptr : per_sample_weights->dptr<T>(), dx_buf, mode,
+        padding_idx, num_indices, num_bags, emb_size, emb_dim);
+  }
+  bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
+};
+
+#define REGISTER_CPU_EMBEDDING_BAG_KERNEL(in_type, indices_type)                                  \
+  REGISTER_USER_KERNEL("embedding_bag")                                                           \
+      .SetCreateFn<                                                                               \
+          CpuEmbeddingBagKernel<OF_PP_PAIR_FIRST(in_type), OF_PP_PAIR_FIRST(indices_type)>>()     \
+      .SetIsMatchedHob(                                                                           \
+          (user_op::HobDeviceType() == DeviceType::kCPU)                                          \
+          && (user_op::HobDataType("weight", 0) == OF_PP_PAIR_SECOND(in_type))                    \
+          && (user_op::HobDataType("indices", 0) == OF_PP_PAIR_SECOND(indices_type)));            \
+  REGISTER_USER_KERNEL("embedding_bag_grad")                                                      \
+      .SetCreateFn<                                                                               \
+          CpuEmbeddingBagGradKernel<OF_PP_PAIR_FIRST(in_type), OF_PP_PAIR_FIRST(indices_type)>>() \
+      .SetIsMatchedHob(                                                                           \
+          (user_op::HobDeviceType() == DeviceType::kCPU)                                          \
+          && (user_op::HobDataType("weight", 0) == OF_PP_PAIR_SECOND(in_type))                    \
+          && (user_op::HobDataType("indices", 0) == OF_PP_PAIR_SECOND(indices_type)));
+
+OF_PP_SEQ_PRODUCT_FOR_EACH_TUPLE(REGISTER_CPU_EMBEDDING_BAG_KERNEL, EMBEDDING_BAG_DATA_TYPE_SEQ_CPU,
+                                 INDEX_DATA_TYPE_SEQ)
+#undef REGISTER_CPU_EMBEDDING_BAG_KERNEL
+
 }  // namespace oneflow
@@ -13,11 +13,57 @@ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
 See the License for the specific language governing permissions and
 limitations under the License.
 */
-
 #include "oneflow/user/kernels/embedding_kernel_util.h"
+#include "oneflow/core/ep/cpu/cpu_stream.h"
 
 namespace oneflow {
 
+namespace {
+
+// Number of embedding elements handled by a task, smaller problems are done on the calling thread
+// since the thread pool may not honor the grain size.
+constexpr int64_t kCpuEmbeddingGrain = 32768;
+
+int64_t GetParallelGrain(int64_t num_items, int64_t num_elements) {
+  return std::max<int64_t>(kCpuEmbeddingGrain * num_items / std::max<int64_t>(num_elements, 1), 1);
+}
+
+// Stably sorts the positions whose index is not padding_idx by index. segment_offsets receives the
+// start of every run of equal indices followed by the number of sorted positions, different runs
+// update different rows so they can be accumulated in parallel without atomics.
+template<typename IndexType>
+void SortPositionsByIndex(const IndexType* indices_buf, int64_t num_indices, int64_t padding_idx,
+                          std::vector<int64_t>* positions, std::vector<int64_t>* segment_offsets) {
+  positions->clear();
+  positions->reserve(num_indices);
+  for (int64_t i = 0; i < num_indices; ++i) {
+    if (indices_buf[i] != padding_idx) { positions->push_back(i); }
+  }
+  std::stable_sort(positions->begin(), positions->end(), [&](int64_t a, int64_t b) {
+    return indices_buf[a] < indices_buf[b];
+  });
+  segment_offsets->clear();
+  for (int64_t i = 0; i < positions->size(); ++i) {
+    if (i == 0 || indices_buf[positions->at(i)] != indices_buf[positions->at(i - 1)]) {
+      segment_offsets->push_back(i);
+    }
+  }
+  segment_offsets->push_back(positions->size());
+}
+
+template<typename Func>
+void ParallelForEmbedding(ep::Stream* stream, int64_t num_items, int64_t num_elements,
+                          const Func& func) {
+  if (num_elements <= kCpuEmbeddingGrain) {
+    func(0, num_items);
+  } else {
+    stream->As<ep::CpuStream>()->ParallelFor(0, num_items, func,
+                                             GetParallelGrain(num_items, num_elements));
+  }
+}
+
+}  // namespace
+
 template<typename T, typename IndexType>
 struct EmbeddingReNormFunctor<DeviceType::kCPU, T, IndexType> final {
   void operator()(ep::Stream* stream, const T* in_buf, const IndexType* indices_buf, T* out_buf,
@@ -49,13 +95,16 @@ struct EmbeddingFunctor<DeviceType::kCPU, T, IndexType> final {
   void operator()(ep::Stream* stream, const T* weight_buf, const IndexType* indices_buf, T* out_buf,
                   const int64_t padding_idx, const bool scale_grad_by_freq,
                   const int64_t num_indices, const int64_t emb_size, const int64_t emb_dim) {
-    for (int64_t i = 0; i < num_indices; i++) {
-      IndexType indice = indices_buf[i];
-      CHECK(indice >= 0 && indice < emb_size);
-      const T* from = weight_buf + indice * emb_dim;
-      T* to = out_buf + i * emb_dim;
-      std::copy(from, from + emb_dim, to);
-    }
+    auto gather = [&](int64_t begin, int64_t end) {
+      for (int64_t i = begin; i < end; i++) {
+        IndexType indice = indices_buf[i];
+        CHECK(indice >= 0 && indice < emb_size);
+        const T* from = weight_buf + indice * emb_dim;
+        T* to = out_buf + i * emb_dim;
+        std::copy(from, from + emb_dim, to);
+      }
+    };
+    ParallelForEmbedding(stream, num_indices, num_indices * emb_dim, gather);
   }
 };
 
@@ -65,26 +114,167 @@ struct EmbeddingGradFunctor<DeviceType::kCPU, T, IndexType> final {
                   const int64_t padding_idx, const bool scale_grad_by_freq,
                   const int64_t num_indices, const int64_t emb_size, const int64_t emb_dim,
                   int32_t* tmp_buf) {
-    for (int64_t i = 0; i < num_indices; i++) {
-      IndexType indice = indices_buf[i];
-      if (indice != padding_idx) {
-        const T* from = dy_buf + i * emb_dim;
-        T* to = dx_buf + indice * emb_dim;
-        std::transform(from, from + emb_dim, to, to, std::plus<T>());
+    std::vector<int64_t> positions;
+    std::vector<int64_t> segment_offsets;
+    SortPositionsByIndex(indices_buf, num_indices, padding_idx, &positions, &segment_offsets);
+    const int64_t num_segments = segment_offsets.size() - 1;
+    ParallelForEmbedding(
+        stream, num_segments, positions.size() * emb_dim, [&](int64_t begin, int64_t end) {
+          for (int64_t s = begin; s < end; ++s) {
+            const IndexType indice = indices_buf[positions[segment_offsets[s]]];
+            CHECK(indice >= 0 && indice < emb_size);
+            T* to = dx_buf + indice * emb_dim;
+            for (int64_t i = segment_offsets[s]; i < segment_offsets[s + 1]; ++i) {
+              const T* from = dy_buf + positions[i] * emb_dim;
+              std::transform(from, from + emb_dim, to, to, std::plus<T>());
+            }
+            const int64_t freq = segment_offsets[s + 1] - segment_offsets[s];
+            if (scale_grad_by_freq && freq > 1) {
+              for (int64_t j = 0; j < emb_dim; j++) { to[j] /= freq; }
+            }
+          }
+        });
+  }
+};
+
+template<typename T, typename IndexType>
+struct EmbeddingBagFunctor<DeviceType::kCPU, T, IndexType> final {
+  void operator()(ep::Stream* stream, const T* weight_buf, const IndexType* indices_buf,
+                  const IndexType* offsets_buf, const T* per_sample_weights_buf, T* out_buf,
+                  const EmbeddingBagMode mode, const int64_t padding_idx,
+                  const int64_t num_indices, const int64_t num_bags, const int64_t emb_size,
+                  const int64_t emb_dim) {
+    // Every bag is reduced in its output row, the [num_indices, emb_dim] gathered rows are never
+    // materialized.
+    ParallelForEmbedding(
+        stream, num_bags, num_indices * emb_dim, [&](int64_t begin, int64_t end) {
+          for (int64_t bag = begin; bag < end; ++bag) {
+            const int64_t start = offsets_buf[bag];
+            const int64_t stop = bag + 1 < num_bags ? offsets_buf[bag + 1] : num_indices;
+            CHECK(start >= 0 && start <= stop && stop <= num_indices);
+            T* to = out_buf + bag * emb_dim;
+            std::fill(to, to + emb_dim, static_cast<T>(0));
+            int64_t count = 0;
+            for (int64_t i = start; i < stop; ++i) {
+              const IndexType indice = indices_buf[i];
+              if (indice == padding_idx) { continue; }
+              CHECK(indice >= 0 && indice < emb_size);
+              const T* from = weight_buf + indice * emb_dim;
+              if (mode == EmbeddingBagMode::kMax) {
+                if (count == 0) {
+                  std::copy(from, from + emb_dim, to);
+                } else {
+                  for (int64_t j = 0; j < emb_dim; ++j) {
+                    if (from[j] > to[j]) { to[j] = from[j]; }
+                  }
+                }
+              } else {
+                const T scale = per_sample_weights_buf == nullptr ? static_cast<T>(1)
+                                                                  : per_sample_weights_buf[i];
+                for (int64_t j = 0; j < emb_dim; ++j) { to[j] += scale * from[j]; }
+              }
+              count += 1;
+            }
+            if (mode == EmbeddingBagMode::kMean && count > 1) {
+              const T scale = static_cast<T>(1) / static_cast<T>(count);
+              for (int64_t j = 0; j < emb_dim; ++j) { to[j] *= scale; }
+            }
+          }
+        });
+  }
+};
+
+template<typename T, typename IndexType>
+struct EmbeddingBagGradFunctor<DeviceType::kCPU, T, IndexType> final {
+  void operator()(ep::Stream* stream, const T* dy_buf, const T* weight_buf,
+                  const IndexType* indices_buf, const IndexType* offsets_buf,
+                  const T* per_sample_weights_buf, T* dx_buf, const EmbeddingBagMode mode,
+                  const int64_t padding_idx, const int64_t num_indices, const int64_t num_bags,
+                  const int64_t emb_size, const int64_t emb_dim) {
+    if (mode == EmbeddingBagMode::kMax) {
+      MaxGrad(stream, dy_buf, weight_buf, indices_buf, offsets_buf, dx_buf, padding_idx,
+              num_indices, num_bags, emb_size, emb_dim);
+      return;
+    }
+    // Positions before offsets[0] belong to no bag.
+    std::vector<int64_t> bag_ids(num_indices, -1);
+    std::vector<T> bag_scales(num_bags, static_cast<T>(1));
+    for (int64_t bag = 0; bag < num_bags; ++bag) {
+      const int64_t start = offsets_buf[bag];
+      const int64_t stop = bag + 1 < num_bags ? offsets_buf[bag + 1] : num_indices;
+      CHECK(start >= 0 && start <= stop && stop <= num_indices);
+      int64_t count = 0;
+      for (int64_t i = start; i < stop; ++i) {
+        bag_ids[i] = bag;
+        if (indices_buf[i] != padding_idx) { count += 1; }
+      }
+      if (mode == EmbeddingBagMode::kMean && count > 1) {
+        bag_scales[bag] = static_cast<T>(1) / static_cast<T>(count);
       }
     }
+    std::vector<int64_t> positions;
+    std::vector<int64_t> segment_offsets;
+    SortPositionsByIndex(indices_buf, num_indices, padding_idx, &positions, &segment_offsets);
+    const int64_t num_segments = segment_offsets.size() - 1;
+    ParallelForEmbedding(
+        stream, num_segments, positions.size() * emb_dim, [&](int64_t begin, int64_t end) {
+          for (int64_t s = begin; s < end; ++s) {
+            const IndexType indice = indices_buf[positions[segment_offsets[s]]];
+            CHECK(indice >= 0 && indice < emb_size);
+            T* to = dx_buf + indice * emb_dim;
+            for (int64_t i = segment_offsets[s]; i < segment_offsets[s + 1]; ++i) {
+              const int64_t position = positions[i];
+              const int64_t bag = bag_ids[position];
+              if (bag < 0) { continue; }
+              const T scale = per_sample_weights_buf == nullptr
+                                  ? bag_scales[bag]
+                                  : per_sample_weights_buf[position] * bag_scales[bag];
+              const T* from = dy_buf + bag * emb_dim;
+              for (int64_t j = 0; j < emb_dim; ++j) { to[j] += scale * from[j]; }
+            }
+          }
+        });
+  }
 
-    if (scale_grad_by_freq) {
-      std::vector<IndexType> indice_freq(emb_size, 0);
-      for (int64_t i = 0; i < num_indices; i++) { indice_freq[indices_buf[i]]++; }
-
-      for (int64_t i = 0; i < emb_size; i++) {
-        if (indice_freq[i] > 1) {
-          T* from = dx_buf + i * emb_dim;
-          for (int64_t j = 0; j < emb_dim; j++) { from[j] /= indice_freq[i]; }
+ private:
+  // The gradient of a max bag goes to the first row holding the maximum of every column. The
+  // argmax is recomputed in parallel over bags, then scattered in parallel over columns so that
+  // every task owns whole columns of dx.
+  void MaxGrad(ep::Stream* stream, const T* dy_buf, const T* weight_buf,
+               const IndexType* indices_buf, const IndexType* offsets_buf, T* dx_buf,
+               const int64_t padding_idx, const int64_t num_indices, const int64_t num_bags,
+               const int64_t emb_size, const int64_t emb_dim) {
+    std::vector<int64_t> argmax(num_bags * emb_dim);
+    ParallelForEmbedding(
+        stream, num_bags, num_indices * emb_dim, [&](int64_t begin, int64_t end) {
+          for (int64_t bag = begin; bag < end; ++bag) {
+            const int64_t start = offsets_buf[bag];
+            const int64_t stop = bag + 1 < num_bags ? offsets_buf[bag + 1] : num_indices;
+            CHECK(start >= 0 && start <= stop && stop <= num_indices);
+            int64_t* bag_argmax = argmax.data() + bag * emb_dim;
+            std::fill(bag_argmax, bag_argmax + emb_dim, -1);
+            for (int64_t i = start; i < stop; ++i) {
+              const IndexType indice = indices_buf[i];
+              if (indice == padding_idx) { continue; }
+              CHECK(indice >= 0 && indice < emb_size);
+              const T* from = weight_buf + indice * emb_dim;
+              for (int64_t j = 0; j < emb_dim; ++j) {
+                if (bag_argmax[j] < 0 || from[j] > weight_buf[bag_argmax[j] * emb_dim + j]) {
+                  bag_argmax[j] = indice;
+                }
+              }
+            }
+          }
+        });
+    ParallelForEmbedding(stream, emb_dim, num_bags * emb_dim, [&](int64_t begin, int64_t end) {
+      for (int64_t bag = 0; bag < num_bags; ++bag) {
+        const int64_t* bag_argmax = argmax.data() + bag * emb_dim;
+        const T* from = dy_buf + bag * emb_dim;
+        for (int64_t j = begin; j < end; ++j) {
+          if (bag_argmax[j] >= 0) { dx_buf[bag_argmax[j] * emb_dim + j] += from[j]; }
         }
       }
-    }
+    });
   }
 };
 
@@ -99,4 +289,13 @@ OF_PP_SEQ_PRODUCT_FOR_EACH_TUPLE(INITIATE_EMBEDDING_KERNEL_UTIL_CPU_IMPL,
                                  EMBEDDING_DATA_TYPE_SEQ_CPU, INDEX_DATA_TYPE_SEQ);
 #undef INITIATE_EMBEDDING_KERNEL_UTIL_CPU_IMPL
 
+#define INITIATE_EMBEDDING_BAG_KERNEL_UTIL_CPU_IMPL(in_type_pair, index_type_pair)          \
+  template struct EmbeddingBagFunctor<DeviceType::kCPU, OF_PP_PAIR_FIRST(in_type_pair),     \
+                                      OF_PP_PAIR_FIRST(index_type_pair)>;                   \
+  template struct EmbeddingBagGradFunctor<DeviceType::kCPU, OF_PP_PAIR_FIRST(in_type_pair), \
+                                          OF_PP_PAIR_FIRST(index_type_pair)>;
+OF_PP_SEQ_PRODUCT_FOR_EACH_TUPLE(INITIATE_EMBEDDING_BAG_KERNEL_UTIL_CPU_IMPL,
+                                 EMBEDDING_BAG_DATA_TYPE_SEQ_CPU, INDEX_DATA_TYPE_SEQ);
+#undef INITIATE_EMBEDDING_BAG_KERNEL_UTIL_CPU_IMPL
+
 }  // namespace oneflow
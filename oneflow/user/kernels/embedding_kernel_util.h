@@ -43,8 +43,31 @@ struct EmbeddingGradFunctor final {
                   int32_t* tmp_buf);
 };
 
+enum class EmbeddingBagMode { kSum, kMean, kMax };
+
+// Bag i pools indices[offsets[i], offsets[i + 1]), the last bag ends at num_indices. Entries equal
+// to padding_idx are skipped and not counted by the mean, empty bags are filled with zeros.
+template<DeviceType device_type, typename T, typename IndexType>
+struct EmbeddingBagFunctor final {
+  void operator()(ep::Stream* stream, const T* weight_buf, const IndexType* indices_buf,
+                  const IndexType* offsets_buf, const T* per_sample_weights_buf, T* out_buf,
+                  const EmbeddingBagMode mode, const int64_t padding_idx,
+                  const int64_t num_indices, const int64_t num_bags, const int64_t emb_size,
+                  const int64_t emb_dim);
+};
+
+template<DeviceType device_type, typename T, typename IndexType>
+struct EmbeddingBagGradFunctor final {
+  void operator()(ep::Stream* stream, const T* dy_buf, const T* weight_buf,
+                  const IndexType* indices_buf, const IndexType* offsets_buf,
+                  const T* per_sample_weights_buf, T* dx_buf, const EmbeddingBagMode mode,
+                  const int64_t padding_idx, const int64_t num_indices, const int64_t num_bags,
+                  const int64_t emb_size, const int64_t emb_dim);
+};
+
 #define EMBEDDING_DATA_TYPE_SEQ_CPU FLOATING_DATA_TYPE_SEQ FLOAT16_DATA_TYPE_SEQ
 #define EMBEDDING_DATA_TYPE_SEQ_CUDA FLOATING_DATA_TYPE_SEQ HALF_DATA_TYPE_SEQ
+#define EMBEDDING_BAG_DATA_TYPE_SEQ_CPU FLOATING_DATA_TYPE_SEQ
 
 }  // namespace oneflow
 
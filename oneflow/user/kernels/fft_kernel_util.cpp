@@ -19,12 +19,31 @@ limitations under the License.
 #include "oneflow/core/common/device_type.pb.h"
 #include "oneflow/core/common/preprocessor.h"
 #include "oneflow/core/framework/user_op_tensor.h"
+#include "oneflow/core/ep/cpu/cpu_stream.h"
 
 namespace oneflow {
 
+namespace {
+
+constexpr int64_t kCpuFftGrain = 32768;
+
+template<typename F>
+void ParallelForFft(ep::Stream* stream, int64_t n, const F& fn) {
+  // smaller problems are done on the calling thread since the thread pool may not honor the
+  // grain size
+  if (n < kCpuFftGrain) {
+    fn(0, n);
+  } else {
+    stream->As<ep::CpuStream>()->ParallelFor(0, n, fn, kCpuFftGrain);
+  }
+}
+
+}  // namespace
+
 template<typename T>
-static void _conj_symmetry_cpu(T* data_out, const Shape& shape, const std::vector<int64_t>& strides,
-                               const int64_t last_dim, int64_t elem_count) {
+static void _conj_symmetry_cpu(ep::Stream* stream, T* data_out, const Shape& shape,
+                               const std::vector<int64_t>& strides, const int64_t last_dim,
+                               int64_t elem_count) {
   const oneflow::NdIndexStrideOffsetHelper<int64_t, SHAPE_MAX_AXIS_SIZE> helper(strides.data(),
                                                                                 shape.size());
   // NOTE: dims must be sorted
@@ -32,19 +51,22 @@ static void _conj_symmetry_cpu(T* data_out, const Shape& shape, const std::vecto
   int64_t last_dim_half = last_dim_size / 2;
 
   int64_t ndim = shape.size();
-  std::vector<int64_t> indices(ndim);
-  for (int offset = 0; offset < elem_count; offset++) {
-    helper.OffsetToNdIndex(offset, indices.data(), ndim);
-    if (indices[last_dim] <= last_dim_half) { continue; }
-
-    int64_t cur_last_dim_index = indices[last_dim];
-    // get symmetric
-    indices[last_dim] = last_dim_size - cur_last_dim_index;
-    int64_t symmetric_offset = helper.NdIndexToOffset(indices.data(), ndim);
-
-    // conj
-    data_out[offset] = std::conj(data_out[symmetric_offset]);
-  }
+  // only the upper half is written and only the lower half is read, so offsets are independent
+  ParallelForFft(stream, elem_count, [&](int64_t begin, int64_t end) {
+    std::vector<int64_t> indices(ndim);
+    for (int64_t offset = begin; offset < end; offset++) {
+      helper.OffsetToNdIndex(offset, indices.data(), ndim);
+      if (indices[last_dim] <= last_dim_half) { continue; }
+
+      int64_t cur_last_dim_index = indices[last_dim];
+      // get symmetric
+      indices[last_dim] = last_dim_size - cur_last_dim_index;
+      int64_t symmetric_offset = helper.NdIndexToOffset(indices.data(), ndim);
+
+      // conj
+      data_out[offset] = std::conj(data_out[symmetric_offset]);
+    }
+  });
 }
 
 template<typename T>
@@ -53,8 +75,8 @@ struct FillConjSymmetryUtil<DeviceType::kCPU, T> {
                                       const Stride& strides, const int64_t last_dim,
                                       int64_t elem_count) {
     std::vector<int64_t> strides_vec(strides.begin(), strides.end());
-    _conj_symmetry_cpu(/*data_out*/ data_out, /*shape*/ shape, /*strides*/ strides_vec,
-                       /*last_dim*/ last_dim, /*elem_count*/ elem_count);
+    _conj_symmetry_cpu(/*stream*/ stream, /*data_out*/ data_out, /*shape*/ shape,
+                       /*strides*/ strides_vec, /*last_dim*/ last_dim, /*elem_count*/ elem_count);
   }
 };
 
@@ -63,30 +85,34 @@ struct ComplexConvertUtil<DeviceType::kCPU, real_type, complex_type> {
   static void ConvertToDoubleSized(ep::Stream* stream, const complex_type* in, complex_type* dst,
                                    size_t len, size_t n) {
     size_t fact_len = 2 * len - 2;  // input_shape.back()
-    for (int i = 0; i < n; i++) {
-      int index_x = i / fact_len;
-      int index_y = i % fact_len;
-      if (index_y == 0) {
-        dst[i] = in[index_x * len];
-      } else if (index_y == len - 1) {
-        dst[i] = in[(index_x + 1) * len - 1];
-      } else if (index_y < len - 1 && index_y > 0) {
-        dst[i] = in[index_x * len + index_y];
-      } else {
-        auto index = (index_x + 2) * len - index_y - 2;
-        auto realvalue = in[index].real();
-        dst[i].real(realvalue);
-        auto imagvalue = -in[index].imag();
-        dst[i].imag(imagvalue);
+    ParallelForFft(stream, n, [&](int64_t begin, int64_t end) {
+      for (int64_t i = begin; i < end; i++) {
+        int64_t index_x = i / fact_len;
+        int64_t index_y = i % fact_len;
+        if (index_y == 0) {
+          dst[i] = in[index_x * len];
+        } else if (index_y == len - 1) {
+          dst[i] = in[(index_x + 1) * len - 1];
+        } else if (index_y < len - 1 && index_y > 0) {
+          dst[i] = in[index_x * len + index_y];
+        } else {
+          auto index = (index_x + 2) * len - index_y - 2;
+          auto realvalue = in[index].real();
+          dst[i].real(realvalue);
+          auto imagvalue = -in[index].imag();
+          dst[i].imag(imagvalue);
+        }
       }
-    }
+    });
   }
   static void ConvertComplexToReal(ep::Stream* stream, const complex_type* in, real_type* out,
                                    size_t n) {
-    for (int i = 0; i < n; i++) {
-      out[2 * i] = in[i].real();
-      out[2 * i + 1] = in[i].imag();
-    }
+    ParallelForFft(stream, n, [&](int64_t begin, int64_t end) {
+      for (int64_t i = begin; i < end; i++) {
+        out[2 * i] = in[i].real();
+        out[2 * i + 1] = in[i].imag();
+      }
+    });
   }
 };
 
@@ -100,7 +126,7 @@ struct FftC2CKernelUtil<DeviceType::kCPU, T, FCT_TYPE> {
     PocketFFtParams<FCT_TYPE> params(input_shape, output_shape, input_stride, output_stride, dims,
                                      forward, norm_fct /*1.f*/, FFT_EXCUTETYPE::C2C);
     PocketFFtConfig<FCT_TYPE> config(params);
-    config.excute(data_in, data_out);
+    config.excute(stream, data_in, data_out);
   }
 };
 
@@ -113,7 +139,7 @@ struct FftR2CKernelUtil<DeviceType::kCPU, IN, OUT> {
     PocketFFtParams<IN> params(input_shape, output_shape, input_stride, output_stride, dims,
                                forward, norm_fct /*1.f*/, FFT_EXCUTETYPE::R2C);
     PocketFFtConfig<IN> config(params);
-    config.excute(data_in, data_out);
+    config.excute(stream, data_in, data_out);
   }
 };
 
@@ -127,7 +153,7 @@ struct FftC2RKernelUtil<DeviceType::kCPU, IN, OUT> {
     PocketFFtParams<OUT> params(input_shape, output_shape, input_stride, output_stride, dims,
                                 /*is_forward=*/false, norm_fct /*1.f*/, FFT_EXCUTETYPE::C2R);
     PocketFFtConfig<OUT> config(params);
-    config.excute(data_in, data_out);
+    config.excute(stream, data_in, data_out);
   }
 };
 
@@ -138,18 +164,23 @@ struct FftStftKernelUtil<DeviceType::kCPU, IN, OUT> {
                              const Stride& input_stride, const Stride& output_stride, bool forward,
                              const std::vector<int64_t>& axes, IN norm_fct, int64_t len,
                              int64_t dims, int64_t batch) {
-    PocketFFtParams<IN> params(input_shape, output_shape, input_stride, output_stride, axes,
-                               forward, norm_fct /*1.f*/, FFT_EXCUTETYPE::R2C);
+    // input_shape and output_shape describe one frame, the dims * batch frames follow each other
+    // in memory, so they are transformed as one batched 1-D r2c instead of one call per frame
+    CHECK_EQ(input_shape.size(), 1);
+    CHECK_EQ(output_shape.size(), 1);
+    CHECK_EQ(input_shape.At(0), len);
+    CHECK_EQ(output_shape.At(0), len / 2 + 1);
+    const int64_t in_elem_stride = input_stride.at(0);
+    const int64_t out_elem_stride = output_stride.at(0);
+    Shape batched_in_shape({dims * batch, len});
+    Shape batched_out_shape({dims * batch, len / 2 + 1});
+    Stride batched_in_stride({len * in_elem_stride, in_elem_stride});
+    Stride batched_out_stride({(len / 2 + 1) * out_elem_stride, out_elem_stride});
+    PocketFFtParams<IN> params(batched_in_shape, batched_out_shape, batched_in_stride,
+                               batched_out_stride, /*dims=*/{1}, forward, norm_fct /*1.f*/,
+                               FFT_EXCUTETYPE::R2C);
     PocketFFtConfig<IN> config(params);
-    int64_t in_offset = len;
-    int64_t out_offset = len / 2 + 1;
-    for (int j = 0; j < dims; j++) {
-      for (int i = 0; i < batch; i++) {
-        const IN* in = data_in + j * batch * in_offset + i * in_offset;
-        OUT* out = data_out + j * batch * out_offset + i * out_offset;
-        config.excute(in, out);
-      }
-    }
+    config.excute(stream, data_in, data_out);
   }
 };
 template struct FillConjSymmetryUtil<DeviceType::kCPU, std::complex<float>>;
@@ -154,14 +154,17 @@ class StftCpuKernel final : public user_op::OpKernel {
     dtype_in* data_out = output->mut_dptr<dtype_in>();
 
     dtype_out* out_tmp_buffer = reinterpret_cast<dtype_out*>(tmp_buffer->mut_dptr<char>());
-    Shape out_tmp_shape = Shape{len};
-    Stride out_tmp_stride = Stride(out_tmp_shape);
-    std::vector<int64_t> axes(out_tmp_shape.size());
+    // the shapes and strides of a single frame
+    Shape in_frame_shape = Shape{len};
+    Shape out_frame_shape = Shape{len / 2 + 1};
+    Stride in_frame_stride = Stride(in_frame_shape);
+    Stride out_frame_stride = Stride(out_frame_shape);
+    std::vector<int64_t> axes(in_frame_shape.size());
     std::iota(axes.begin(), axes.end(), 0);
     auto norm_fct = _fft_normalization_scale<dtype_in>(len, normalized);
     FftStftKernelUtil<device_type, dtype_in, dtype_out>::FftStftForward(
-        ctx->stream(), data_in, out_tmp_buffer, out_tmp_shape, out_tmp_shape, out_tmp_stride,
-        out_tmp_stride, true, /*axes=*/axes, /*norm_fct=*/norm_fct,
+        ctx->stream(), data_in, out_tmp_buffer, in_frame_shape, out_frame_shape, in_frame_stride,
+        out_frame_stride, true, /*axes=*/axes, /*norm_fct=*/norm_fct,
         /*len=*/len, /*dims=*/dims, /*batch=*/batch);
 
     if (!onesided) {
@@ -0,0 +1,113 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/framework/framework.h"
+#include "oneflow/core/ep/cpu/cpu_stream.h"
+#include "oneflow/core/ep/include/primitive/binary_op.h"
+#include "oneflow/core/ep/include/primitive/unary_op.h"
+#include "oneflow/core/ep/cpu/primitive/binary_functor.h"
+#include "oneflow/core/ep/cpu/primitive/unary_functor.h"
+
+namespace oneflow {
+
+namespace {
+
+template<typename T>
+using FastGeluFunctor =
+    ep::primitive::UnaryFunctor<DeviceType::kCPU, ep::primitive::UnaryOp::kFastGelu, T, T>;
+
+template<typename T>
+using FastGeluGradFunctor = ep::primitive::broadcast_elementwise_binary::BinaryFunctor<
+    DeviceType::kCPU, ep::primitive::BinaryOp::kFastGeluBackwardWithDyX, T, T>;
+
+template<typename T>
+class CpuFusedFastGeluMulKernel final : public user_op::OpKernel {
+ public:
+  CpuFusedFastGeluMulKernel() = default;
+  ~CpuFusedFastGeluMulKernel() override = default;
+
+ private:
+  bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
+
+  void Compute(user_op::KernelComputeContext* ctx) const override {
+    const auto* in = ctx->Tensor4ArgNameAndIndex("in", 0);
+    const auto* multiplier = ctx->Tensor4ArgNameAndIndex("multiplier", 0);
+    auto* out = ctx->Tensor4ArgNameAndIndex("out", 0);
+    const T* in_ptr = in->dptr<T>();
+    const T* multiplier_ptr = multiplier->dptr<T>();
+    T* out_ptr = out->mut_dptr<T>();
+    FastGeluFunctor<T> fast_gelu(0, 0);
+    ctx->stream()->As<ep::CpuStream>()->ParallelFor(
+        0, in->shape_view().elem_cnt(), [&](int64_t begin, int64_t end) {
+          for (int64_t i = begin; i < end; ++i) {
+            out_ptr[i] = fast_gelu(in_ptr[i]) * multiplier_ptr[i];
+          }
+        });
+  }
+};
+
+template<typename T>
+class CpuFusedFastGeluMulGradKernel final : public user_op::OpKernel {
+ public:
+  CpuFusedFastGeluMulGradKernel() = default;
+  ~CpuFusedFastGeluMulGradKernel() override = default;
+
+ private:
+  bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
+
+  void Compute(user_op::KernelComputeContext* ctx) const override {
+    const auto* out_diff = ctx->Tensor4ArgNameAndIndex("out_diff", 0);
+    const auto* in = ctx->Tensor4ArgNameAndIndex("in", 0);
+    const auto* multiplier = ctx->Tensor4ArgNameAndIndex("multiplier", 0);
+    auto* in_diff = ctx->Tensor4ArgNameAndIndex("in_diff", 0);
+    auto* multiplier_diff = ctx->Tensor4ArgNameAndIndex("multiplier_diff", 0);
+    const T* out_diff_ptr = out_diff->dptr<T>();
+    const T* in_ptr = in->dptr<T>();
+    const T* multiplier_ptr = multiplier->dptr<T>();
+    T* in_diff_ptr = in_diff->mut_dptr<T>();
+    T* multiplier_diff_ptr = multiplier_diff->mut_dptr<T>();
+    FastGeluFunctor<T> fast_gelu(0, 0);
+    FastGeluGradFunctor<T> fast_gelu_grad(0, 0);
+    ctx->stream()->As<ep::CpuStream>()->ParallelFor(
+        0, in->shape_view().elem_cnt(), [&](int64_t begin, int64_t end) {
+          for (int64_t i = begin; i < end; ++i) {
+            in_diff_ptr[i] = fast_gelu_grad(out_diff_ptr[i] * multiplier_ptr[i], in_ptr[i]);
+            multiplier_diff_ptr[i] = out_diff_ptr[i] * fast_gelu(in_ptr[i]);
+          }
+        });
+  }
+};
+
+}  // namespace
+
+#define REGISTER_FUSED_FAST_GELU_MUL_CPU_KERNEL(dtype)                \
+  REGISTER_USER_KERNEL("fused_fast_gelu_mul")                         \
+      .SetCreateFn<CpuFusedFastGeluMulKernel<dtype>>()                \
+      .SetIsMatchedHob((user_op::HobDeviceType() == DeviceType::kCPU) \
+                       && (user_op::HobDataType("in", 0) == GetDataType<dtype>::value));
+
+REGISTER_FUSED_FAST_GELU_MUL_CPU_KERNEL(float)
+REGISTER_FUSED_FAST_GELU_MUL_CPU_KERNEL(double)
+
+#define REGISTER_FUSED_FAST_GELU_MUL_GRAD_CPU_KERNEL(dtype)           \
+  REGISTER_USER_KERNEL("fused_fast_gelu_mul_grad")                    \
+      .SetCreateFn<CpuFusedFastGeluMulGradKernel<dtype>>()            \
+      .SetIsMatchedHob((user_op::HobDeviceType() == DeviceType::kCPU) \
+                       && (user_op::HobDataType("out_diff", 0) == GetDataType<dtype>::value));
+
+REGISTER_FUSED_FAST_GELU_MUL_GRAD_CPU_KERNEL(float)
+REGISTER_FUSED_FAST_GELU_MUL_GRAD_CPU_KERNEL(double)
+
+}  // namespace oneflow
@@ -0,0 +1,597 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include <cmath>
+#include "oneflow/core/framework/framework.h"
+#include "oneflow/core/ep/cpu/cpu_stream.h"
+
+namespace oneflow {
+
+namespace {
+
+// CPU counterparts of the fused_get_*_kernel.cu and fused_center_kernel.cu box ops used by the YOLO
+// style IoU losses. Each op is elementwise over structure-of-arrays inputs, so the loops below are
+// branch free where the CUDA kernels are and vectorize; larger inputs are additionally split over
+// the thread pool.
+constexpr int64_t kBoxOpsGrain = 32768;
+
+template<typename F>
+void ForEachBox(ep::Stream* stream, int64_t n, const F& f) {
+  // smaller problems are done on the calling thread since the thread pool may not honor the grain
+  // size
+  auto* cpu_stream = stream->As<ep::CpuStream>();
+  if (n <= kBoxOpsGrain || cpu_stream->device()->GetNumThreads() <= 1) {
+    f(0, n);
+  } else {
+    cpu_stream->ParallelFor(0, n, f, kBoxOpsGrain);
+  }
+}
+
+template<typename T>
+class FusedGetBounddingBoxesCoordCpuKernel final : public user_op::OpKernel {
+ public:
+  FusedGetBounddingBoxesCoordCpuKernel() = default;
+  ~FusedGetBounddingBoxesCoordCpuKernel() = default;
+
+ private:
+  using user_op::OpKernel::Compute;
+  void Compute(user_op::KernelComputeContext* ctx) const override {
+    const T* x1 = ctx->Tensor4ArgNameAndIndex("x1", 0)->dptr<T>();
+    const T* y1 = ctx->Tensor4ArgNameAndIndex("y1", 0)->dptr<T>();
+    const T* w1 = ctx->Tensor4ArgNameAndIndex("w1", 0)->dptr<T>();
+    const T* h1 = ctx->Tensor4ArgNameAndIndex("h1", 0)->dptr<T>();
+    const T* x2 = ctx->Tensor4ArgNameAndIndex("x2", 0)->dptr<T>();
+    const T* y2 = ctx->Tensor4ArgNameAndIndex("y2", 0)->dptr<T>();
+    const T* w2 = ctx->Tensor4ArgNameAndIndex("w2", 0)->dptr<T>();
+    const T* h2 = ctx->Tensor4ArgNameAndIndex("h2", 0)->dptr<T>();
+    T* b1_x1 = ctx->Tensor4ArgNameAndIndex("b1_x1", 0)->mut_dptr<T>();
+    T* b1_x2 = ctx->Tensor4ArgNameAndIndex("b1_x2", 0)->mut_dptr<T>();
+    T* b1_y1 = ctx->Tensor4ArgNameAndIndex("b1_y1", 0)->mut_dptr<T>();
+    T* b1_y2 = ctx->Tensor4ArgNameAndIndex("b1_y2", 0)->mut_dptr<T>();
+    T* b2_x1 = ctx->Tensor4ArgNameAndIndex("b2_x1", 0)->mut_dptr<T>();
+    T* b2_x2 = ctx->Tensor4ArgNameAndIndex("b2_x2", 0)->mut_dptr<T>();
+    T* b2_y1 = ctx->Tensor4ArgNameAndIndex("b2_y1", 0)->mut_dptr<T>();
+    T* b2_y2 = ctx->Tensor4ArgNameAndIndex("b2_y2", 0)->mut_dptr<T>();
+    const int64_t elem_cnt = ctx->Tensor4ArgNameAndIndex("x1", 0)->shape_view().elem_cnt();
+    ForEachBox(ctx->stream(), elem_cnt, [&](int64_t begin, int64_t end) {
+      for (int64_t i = begin; i < end; ++i) {
+        const T w1_ = w1[i] / static_cast<T>(2.0);
+        const T h1_ = h1[i] / static_cast<T>(2.0);
+        const T w2_ = w2[i] / static_cast<T>(2.0);
+        const T h2_ = h2[i] / static_cast<T>(2.0);
+        b1_x1[i] = x1[i] - w1_;
+        b1_x2[i] = x1[i] + w1_;
+        b1_y1[i] = y1[i] - h1_;
+        b1_y2[i] = y1[i] + h1_;
+        b2_x1[i] = x2[i] - w2_;
+        b2_x2[i] = x2[i] + w2_;
+        b2_y1[i] = y2[i] - h2_;
+        b2_y2[i] = y2[i] + h2_;
+      }
+    });
+  }
+  bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
+};
+
+template<typename T>
+class FusedGetBounddingBoxesCoordGradCpuKernel final : public user_op::OpKernel {
+ public:
+  FusedGetBounddingBoxesCoordGradCpuKernel() = default;
+  ~FusedGetBounddingBoxesCoordGradCpuKernel() = default;
+
+ private:
+  using user_op::OpKernel::Compute;
+  void Compute(user_op::KernelComputeContext* ctx) const override {
+    const T* b1_x1_diff = ctx->Tensor4ArgNameAndIndex("b1_x1_diff", 0)->dptr<T>();
+    const T* b1_x2_diff = ctx->Tensor4ArgNameAndIndex("b1_x2_diff", 0)->dptr<T>();
+    const T* b1_y1_diff = ctx->Tensor4ArgNameAndIndex("b1_y1_diff", 0)->dptr<T>();
+    const T* b1_y2_diff = ctx->Tensor4ArgNameAndIndex("b1_y2_diff", 0)->dptr<T>();
+    const T* b2_x1_diff = ctx->Tensor4ArgNameAndIndex("b2_x1_diff", 0)->dptr<T>();
+    const T* b2_x2_diff = ctx->Tensor4ArgNameAndIndex("b2_x2_diff", 0)->dptr<T>();
+    const T* b2_y1_diff = ctx->Tensor4ArgNameAndIndex("b2_y1_diff", 0)->dptr<T>();
+    const T* b2_y2_diff = ctx->Tensor4ArgNameAndIndex("b2_y2_diff", 0)->dptr<T>();
+    T* x1_diff = ctx->Tensor4ArgNameAndIndex("x1_diff", 0)->mut_dptr<T>();
+    T* y1_diff = ctx->Tensor4ArgNameAndIndex("y1_diff", 0)->mut_dptr<T>();
+    T* w1_diff = ctx->Tensor4ArgNameAndIndex("w1_diff", 0)->mut_dptr<T>();
+    T* h1_diff = ctx->Tensor4ArgNameAndIndex("h1_diff", 0)->mut_dptr<T>();
+    T* x2_diff = ctx->Tensor4ArgNameAndIndex("x2_diff", 0)->mut_dptr<T>();
+    T* y2_diff = ctx->Tensor4ArgNameAndIndex("y2_diff", 0)->mut_dptr<T>();
+    T* w2_diff = ctx->Tensor4ArgNameAndIndex("w2_diff", 0)->mut_dptr<T>();
+    T* h2_diff = ctx->Tensor4ArgNameAndIndex("h2_diff", 0)->mut_dptr<T>();
+    const int64_t elem_cnt = ctx->Tensor4ArgNameAndIndex("b1_x1_diff", 0)->shape_view().elem_cnt();
+    ForEachBox(ctx->stream(), elem_cnt, [&](int64_t begin, int64_t end) {
+      for (int64_t i = begin; i < end; ++i) {
+        x1_diff[i] = b1_x1_diff[i] + b1_x2_diff[i];
+        y1_diff[i] = b1_y1_diff[i] + b1_y2_diff[i];
+        w1_diff[i] = (b1_x2_diff[i] - b1_x1_diff[i]) / static_cast<T>(2.0);
+        h1_diff[i] = (b1_y2_diff[i] - b1_y1_diff[i]) / static_cast<T>(2.0);
+        x2_diff[i] = b2_x1_diff[i] + b2_x2_diff[i];
+        y2_diff[i] = b2_y1_diff[i] + b2_y2_diff[i];
+        w2_diff[i] = (b2_x2_diff[i] - b2_x1_diff[i]) / static_cast<T>(2.0);
+        h2_diff[i] = (b2_y2_diff[i] - b2_y1_diff[i]) / static_cast<T>(2.0);
+      }
+    });
+  }
+  bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
+};
+
+template<typename T>
+class FusedGetCiouDiagonalAngleCpuKernel final : public user_op::OpKernel {
+ public:
+  FusedGetCiouDiagonalAngleCpuKernel() = default;
+  ~FusedGetCiouDiagonalAngleCpuKernel() = default;
+
+ private:
+  using user_op::OpKernel::Compute;
+  void Compute(user_op::KernelComputeContext* ctx) const override {
+    const T* w1 = ctx->Tensor4ArgNameAndIndex("w1", 0)->dptr<T>();
+    const T* h1 = ctx->Tensor4ArgNameAndIndex("h1", 0)->dptr<T>();
+    const T* w2 = ctx->Tensor4ArgNameAndIndex("w2", 0)->dptr<T>();
+    const T* h2 = ctx->Tensor4ArgNameAndIndex("h2", 0)->dptr<T>();
+    T* v = ctx->Tensor4ArgNameAndIndex("v", 0)->mut_dptr<T>();
+    const float eps = ctx->Attr<float>("eps");
+    const int64_t elem_cnt = ctx->Tensor4ArgNameAndIndex("w1", 0)->shape_view().elem_cnt();
+    ForEachBox(ctx->stream(), elem_cnt, [&](int64_t begin, int64_t end) {
+      for (int64_t i = begin; i < end; ++i) {
+        const T delta = std::atan(w2[i] / (h2[i] + eps)) - std::atan(w1[i] / (h1[i] + eps));
+        v[i] = static_cast<T>(4.0 / (M_PI * M_PI)) * delta * delta;
+      }
+    });
+  }
+  bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
+};
+
+template<typename T>
+class FusedGetCiouDiagonalAngleGradCpuKernel final : public user_op::OpKernel {
+ public:
+  FusedGetCiouDiagonalAngleGradCpuKernel() = default;
+  ~FusedGetCiouDiagonalAngleGradCpuKernel() = default;
+
+ private:
+  using user_op::OpKernel::Compute;
+  void Compute(user_op::KernelComputeContext* ctx) const override {
+    const T* w1 = ctx->Tensor4ArgNameAndIndex("w1", 0)->dptr<T>();
+    const T* h1 = ctx->Tensor4ArgNameAndIndex("h1", 0)->dptr<T>();
+    const T* w2 = ctx->Tensor4ArgNameAndIndex("w2", 0)->dptr<T>();
+    const T* h2 = ctx->Tensor4ArgNameAndIndex("h2", 0)->dptr<T>();
+    const T* v_diff = ctx->Tensor4ArgNameAndIndex("v_diff", 0)->dptr<T>();
+    T* w1_diff = ctx->Tensor4ArgNameAndIndex("w1_diff", 0)->mut_dptr<T>();
+    T* h1_diff = ctx->Tensor4ArgNameAndIndex("h1_diff", 0)->mut_dptr<T>();
+    T* w2_diff = ctx->Tensor4ArgNameAndIndex("w2_diff", 0)->mut_dptr<T>();
+    T* h2_diff = ctx->Tensor4ArgNameAndIndex("h2_diff", 0)->mut_dptr<T>();
+    const float eps = ctx->Attr<float>("eps");
+    const int64_t elem_cnt = ctx->Tensor4ArgNameAndIndex("w1", 0)->shape_view().elem_cnt();
+    ForEachBox(ctx->stream(), elem_cnt, [&](int64_t begin, int64_t end) {
+      for (int64_t i = begin; i < end; ++i) {
+        const T h1_eps = h1[i] + eps;
+        const T h2_eps = h2[i] + eps;
+        const T angle_delta = static_cast<T>(8.0)
+                              * (std::atan(w2[i] / h2_eps) - std::atan(w1[i] / h1_eps))
+                              / static_cast<T>(M_PI * M_PI);
+        const T angle1 = static_cast<T>(1.0) + w1[i] * w1[i] / (h1_eps * h1_eps);
+        const T angle2 = static_cast<T>(1.0) + w2[i] * w2[i] / (h2_eps * h2_eps);
+        w1_diff[i] = static_cast<T>(-1.0) * angle_delta / (h1_eps * angle1) * v_diff[i];
+        w2_diff[i] = angle_delta / (h2_eps * angle2) * v_diff[i];
+        h1_diff[i] = w1[i] * angle_delta / (h1_eps * h1_eps * angle1) * v_diff[i];
+        h2_diff[i] =
+            static_cast<T>(-1.0) * w2[i] * angle_delta / (h2_eps * h2_eps * angle2) * v_diff[i];
+      }
+    });
+  }
+  bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
+};
+
+template<typename T>
+class FusedGetCiouResultCpuKernel final : public user_op::OpKernel {
+ public:
+  FusedGetCiouResultCpuKernel() = default;
+  ~FusedGetCiouResultCpuKernel() = default;
+
+ private:
+  using user_op::OpKernel::Compute;
+  void Compute(user_op::KernelComputeContext* ctx) const override {
+    const T* v = ctx->Tensor4ArgNameAndIndex("v", 0)->dptr<T>();
+    const T* iou = ctx->Tensor4ArgNameAndIndex("iou", 0)->dptr<T>();
+    const T* rho2 = ctx->Tensor4ArgNameAndIndex("rho2", 0)->dptr<T>();
+    const T* c2 = ctx->Tensor4ArgNameAndIndex("c2", 0)->dptr<T>();
+    T* y = ctx->Tensor4ArgNameAndIndex("y", 0)->mut_dptr<T>();
+    T* alpha = ctx->Tensor4ArgNameAndIndex("alpha", 0)->mut_dptr<T>();
+    const float eps = ctx->Attr<float>("eps");
+    const int64_t elem_cnt = ctx->Tensor4ArgNameAndIndex("v", 0)->shape_view().elem_cnt();
+    ForEachBox(ctx->stream(), elem_cnt, [&](int64_t begin, int64_t end) {
+      for (int64_t i = begin; i < end; ++i) {
+        const T alpha_i = v[i] / (v[i] - iou[i] + static_cast<T>(1.0 + eps));
+        y[i] = iou[i] - (rho2[i] / c2[i] + v[i] * alpha_i);
+        alpha[i] = alpha_i;
+      }
+    });
+  }
+  bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
+};
+
+template<typename T>
+class FusedGetCiouResultGradCpuKernel final : public user_op::OpKernel {
+ public:
+  FusedGetCiouResultGradCpuKernel() = default;
+  ~FusedGetCiouResultGradCpuKernel() = default;
+
+ private:
+  using user_op::OpKernel::Compute;
+  void Compute(user_op::KernelComputeContext* ctx) const override {
+    const T* dy = ctx->Tensor4ArgNameAndIndex("dy", 0)->dptr<T>();
+    const T* alpha = ctx->Tensor4ArgNameAndIndex("alpha", 0)->dptr<T>();
+    const T* rho2 = ctx->Tensor4ArgNameAndIndex("rho2", 0)->dptr<T>();
+    const T* c2 = ctx->Tensor4ArgNameAndIndex("c2", 0)->dptr<T>();
+    T* dv = ctx->Tensor4ArgNameAndIndex("dv", 0)->mut_dptr<T>();
+    T* diou = ctx->Tensor4ArgNameAndIndex("diou", 0)->mut_dptr<T>();
+    T* drho2 = ctx->Tensor4ArgNameAndIndex("drho2", 0)->mut_dptr<T>();
+    T* dc2 = ctx->Tensor4ArgNameAndIndex("dc2", 0)->mut_dptr<T>();
+    const int64_t elem_cnt = ctx->Tensor4ArgNameAndIndex("dy", 0)->shape_view().elem_cnt();
+    ForEachBox(ctx->stream(), elem_cnt, [&](int64_t begin, int64_t end) {
+      for (int64_t i = begin; i < end; ++i) {
+        const T c2_i = c2[i];
+        const T dy_i = dy[i];
+        dv[i] = -alpha[i] * dy_i;
+        diou[i] = dy_i;
+        drho2[i] = -dy_i / c2_i;
+        dc2[i] = rho2[i] / (c2_i * c2_i) * dy_i;
+      }
+    });
+  }
+  bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
+};
+
+template<typename T>
+class FusedGetCenterDistCpuKernel final : public user_op::OpKernel {
+ public:
+  FusedGetCenterDistCpuKernel() = default;
+  ~FusedGetCenterDistCpuKernel() = default;
+
+ private:
+  using user_op::OpKernel::Compute;
+  void Compute(user_op::KernelComputeContext* ctx) const override {
+    const T* b1_x1 = ctx->Tensor4ArgNameAndIndex("b1_x1", 0)->dptr<T>();
+    const T* b1_x2 = ctx->Tensor4ArgNameAndIndex("b1_x2", 0)->dptr<T>();
+    const T* b2_x1 = ctx->Tensor4ArgNameAndIndex("b2_x1", 0)->dptr<T>();
+    const T* b2_x2 = ctx->Tensor4ArgNameAndIndex("b2_x2", 0)->dptr<T>();
+    const T* b1_y1 = ctx->Tensor4ArgNameAndIndex("b1_y1", 0)->dptr<T>();
+    const T* b1_y2 = ctx->Tensor4ArgNameAndIndex("b1_y2", 0)->dptr<T>();
+    const T* b2_y1 = ctx->Tensor4ArgNameAndIndex("b2_y1", 0)->dptr<T>();
+    const T* b2_y2 = ctx->Tensor4ArgNameAndIndex("b2_y2", 0)->dptr<T>();
+    T* rho2 = ctx->Tensor4ArgNameAndIndex("rho2", 0)->mut_dptr<T>();
+    const int64_t elem_cnt = ctx->Tensor4ArgNameAndIndex("b1_x1", 0)->shape_view().elem_cnt();
+    ForEachBox(ctx->stream(), elem_cnt, [&](int64_t begin, int64_t end) {
+      for (int64_t i = begin; i < end; ++i) {
+        const T b_x_delta = b2_x1[i] + b2_x2[i] - b1_x1[i] - b1_x2[i];
+        const T b_y_delta = b2_y1[i] + b2_y2[i] - b1_y1[i] - b1_y2[i];
+        rho2[i] = (b_x_delta * b_x_delta + b_y_delta * b_y_delta) / static_cast<T>(4.0);
+      }
+    });
+  }
+  bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
+};
+
+template<typename T>
+class FusedGetCenterDistGradCpuKernel final : public user_op::OpKernel {
+ public:
+  FusedGetCenterDistGradCpuKernel() = default;
+  ~FusedGetCenterDistGradCpuKernel() = default;
+
+ private:
+  using user_op::OpKernel::Compute;
+  void Compute(user_op::KernelComputeContext* ctx) const override {
+    const T* b1_x1 = ctx->Tensor4ArgNameAndIndex("b1_x1", 0)->dptr<T>();
+    const T* b1_x2 = ctx->Tensor4ArgNameAndIndex("b1_x2", 0)->dptr<T>();
+    const T* b2_x1 = ctx->Tensor4ArgNameAndIndex("b2_x1", 0)->dptr<T>();
+    const T* b2_x2 = ctx->Tensor4ArgNameAndIndex("b2_x2", 0)->dptr<T>();
+    const T* b1_y1 = ctx->Tensor4ArgNameAndIndex("b1_y1", 0)->dptr<T>();
+    const T* b1_y2 = ctx->Tensor4ArgNameAndIndex("b1_y2", 0)->dptr<T>();
+    const T* b2_y1 = ctx->Tensor4ArgNameAndIndex("b2_y1", 0)->dptr<T>();
+    const T* b2_y2 = ctx->Tensor4ArgNameAndIndex("b2_y2", 0)->dptr<T>();
+    const T* rho2_diff = ctx->Tensor4ArgNameAndIndex("rho2_diff", 0)->dptr<T>();
+    T* b1_x1_diff = ctx->Tensor4ArgNameAndIndex("b1_x1_diff", 0)->mut_dptr<T>();
+    T* b1_x2_diff = ctx->Tensor4ArgNameAndIndex("b1_x2_diff", 0)->mut_dptr<T>();
+    T* b2_x1_diff = ctx->Tensor4ArgNameAndIndex("b2_x1_diff", 0)->mut_dptr<T>();
+    T* b2_x2_diff = ctx->Tensor4ArgNameAndIndex("b2_x2_diff", 0)->mut_dptr<T>();
+    T* b1_y1_diff = ctx->Tensor4ArgNameAndIndex("b1_y1_diff", 0)->mut_dptr<T>();
+    T* b1_y2_diff = ctx->Tensor4ArgNameAndIndex("b1_y2_diff", 0)->mut_dptr<T>();
+    T* b2_y1_diff = ctx->Tensor4ArgNameAndIndex("b2_y1_diff", 0)->mut_dptr<T>();
+    T* b2_y2_diff = ctx->Tensor4ArgNameAndIndex("b2_y2_diff", 0)->mut_dptr<T>();
+    const int64_t elem_cnt = ctx->Tensor4ArgNameAndIndex("b1_x1_diff", 0)->shape_view().elem_cnt();
+    ForEachBox(ctx->stream(), elem_cnt, [&](int64_t begin, int64_t end) {
+      for (int64_t i = begin; i < end; ++i) {
+        const T rho2_diff_i_2 = rho2_diff[i] / static_cast<T>(2.0);
+        const T b_x_diff = rho2_diff_i_2 * (b1_x1[i] + b1_x2[i] - b2_x1[i] - b2_x2[i]);
+        const T b_y_diff = rho2_diff_i_2 * (b1_y1[i] + b1_y2[i] - b2_y1[i] - b2_y2[i]);
+        b1_x1_diff[i] = b_x_diff;
+        b1_x2_diff[i] = b_x_diff;
+        b2_x1_diff[i] = -b_x_diff;
+        b2_x2_diff[i] = -b_x_diff;
+        b1_y1_diff[i] = b_y_diff;
+        b1_y2_diff[i] = b_y_diff;
+        b2_y1_diff[i] = -b_y_diff;
+        b2_y2_diff[i] = -b_y_diff;
+      }
+    });
+  }
+  bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
+};
+
+template<typename T>
+class FusedGetConvexDiagonalSquaredCpuKernel final : public user_op::OpKernel {
+ public:
+  FusedGetConvexDiagonalSquaredCpuKernel() = default;
+  ~FusedGetConvexDiagonalSquaredCpuKernel() = default;
+
+ private:
+  using user_op::OpKernel::Compute;
+  void Compute(user_op::KernelComputeContext* ctx) const override {
+    const T* b1_x1 = ctx->Tensor4ArgNameAndIndex("b1_x1", 0)->dptr<T>();
+    const T* b1_x2 = ctx->Tensor4ArgNameAndIndex("b1_x2", 0)->dptr<T>();
+    const T* b2_x1 = ctx->Tensor4ArgNameAndIndex("b2_x1", 0)->dptr<T>();
+    const T* b2_x2 = ctx->Tensor4ArgNameAndIndex("b2_x2", 0)->dptr<T>();
+    const T* b1_y1 = ctx->Tensor4ArgNameAndIndex("b1_y1", 0)->dptr<T>();
+    const T* b1_y2 = ctx->Tensor4ArgNameAndIndex("b1_y2", 0)->dptr<T>();
+    const T* b2_y1 = ctx->Tensor4ArgNameAndIndex("b2_y1", 0)->dptr<T>();
+    const T* b2_y2 = ctx->Tensor4ArgNameAndIndex("b2_y2", 0)->dptr<T>();
+    T* c2 = ctx->Tensor4ArgNameAndIndex("c2", 0)->mut_dptr<T>();
+    const float eps = ctx->Attr<float>("eps");
+    const int64_t elem_cnt = ctx->Tensor4ArgNameAndIndex("b1_x1", 0)->shape_view().elem_cnt();
+    ForEachBox(ctx->stream(), elem_cnt, [&](int64_t begin, int64_t end) {
+      for (int64_t i = begin; i < end; ++i) {
+        const T cw = std::max(b1_x2[i], b2_x2[i]) - std::min(b1_x1[i], b2_x1[i]);
+        const T ch = std::max(b1_y2[i], b2_y2[i]) - std::min(b1_y1[i], b2_y1[i]);
+        c2[i] = cw * cw + ch * ch + static_cast<T>(eps);
+      }
+    });
+  }
+  bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
+};
+
+template<typename T>
+class FusedGetConvexDiagonalSquaredGradCpuKernel final : public user_op::OpKernel {
+ public:
+  FusedGetConvexDiagonalSquaredGradCpuKernel() = default;
+  ~FusedGetConvexDiagonalSquaredGradCpuKernel() = default;
+
+ private:
+  using user_op::OpKernel::Compute;
+  void Compute(user_op::KernelComputeContext* ctx) const override {
+    const T* c2_diff = ctx->Tensor4ArgNameAndIndex("c2_diff", 0)->dptr<T>();
+    const T* b1_x1 = ctx->Tensor4ArgNameAndIndex("b1_x1", 0)->dptr<T>();
+    const T* b1_x2 = ctx->Tensor4ArgNameAndIndex("b1_x2", 0)->dptr<T>();
+    const T* b2_x1 = ctx->Tensor4ArgNameAndIndex("b2_x1", 0)->dptr<T>();
+    const T* b2_x2 = ctx->Tensor4ArgNameAndIndex("b2_x2", 0)->dptr<T>();
+    const T* b1_y1 = ctx->Tensor4ArgNameAndIndex("b1_y1", 0)->dptr<T>();
+    const T* b1_y2 = ctx->Tensor4ArgNameAndIndex("b1_y2", 0)->dptr<T>();
+    const T* b2_y1 = ctx->Tensor4ArgNameAndIndex("b2_y1", 0)->dptr<T>();
+    const T* b2_y2 = ctx->Tensor4ArgNameAndIndex("b2_y2", 0)->dptr<T>();
+    T* b1_x1_diff = ctx->Tensor4ArgNameAndIndex("b1_x1_diff", 0)->mut_dptr<T>();
+    T* b1_x2_diff = ctx->Tensor4ArgNameAndIndex("b1_x2_diff", 0)->mut_dptr<T>();
+    T* b2_x1_diff = ctx->Tensor4ArgNameAndIndex("b2_x1_diff", 0)->mut_dptr<T>();
+    T* b2_x2_diff = ctx->Tensor4ArgNameAndIndex("b2_x2_diff", 0)->mut_dptr<T>();
+    T* b1_y1_diff = ctx->Tensor4ArgNameAndIndex("b1_y1_diff", 0)->mut_dptr<T>();
+    T* b1_y2_diff = ctx->Tensor4ArgNameAndIndex("b1_y2_diff", 0)->mut_dptr<T>();
+    T* b2_y1_diff = ctx->Tensor4ArgNameAndIndex("b2_y1_diff", 0)->mut_dptr<T>();
+    T* b2_y2_diff = ctx->Tensor4ArgNameAndIndex("b2_y2_diff", 0)->mut_dptr<T>();
+    const int64_t elem_cnt = ctx->Tensor4ArgNameAndIndex("b1_x1", 0)->shape_view().elem_cnt();
+    ForEachBox(ctx->stream(), elem_cnt, [&](int64_t begin, int64_t end) {
+      const T zero = static_cast<T>(0), one = static_cast<T>(1);
+      for (int64_t i = begin; i < end; ++i) {
+        const T cw = std::max(b1_x2[i], b2_x2[i]) - std::min(b1_x1[i], b2_x1[i]);
+        const T ch = std::max(b1_y2[i], b2_y2[i]) - std::min(b1_y1[i], b2_y1[i]);
+        const T c2_diff_cw = static_cast<T>(2) * cw * c2_diff[i];
+        const T c2_diff_ch = static_cast<T>(2) * ch * c2_diff[i];
+        b1_x2_diff[i] = c2_diff_cw * (b1_x2[i] > b2_x2[i] ? one : zero);
+        b2_x2_diff[i] = c2_diff_cw * (b1_x2[i] > b2_x2[i] ? zero : one);
+        b1_x1_diff[i] = -c2_diff_cw * (b1_x1[i] < b2_x1[i] ? one : zero);
+        b2_x1_diff[i] = -c2_diff_cw * (b1_x1[i] < b2_x1[i] ? zero : one);
+        b1_y2_diff[i] = c2_diff_ch * (b1_y2[i] > b2_y2[i] ? one : zero);
+        b2_y2_diff[i] = c2_diff_ch * (b1_y2[i] > b2_y2[i] ? zero : one);
+        b1_y1_diff[i] = -c2_diff_ch * (b1_y1[i] < b2_y1[i] ? one : zero);
+        b2_y1_diff[i] = -c2_diff_ch * (b1_y1[i] < b2_y1[i] ? zero : one);
+      }
+    });
+  }
+  bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
+};
+
+template<typename T>
+class FusedGetIntersectionAreaCpuKernel final : public user_op::OpKernel {
+ public:
+  FusedGetIntersectionAreaCpuKernel() = default;
+  ~FusedGetIntersectionAreaCpuKernel() = default;
+
+ private:
+  using user_op::OpKernel::Compute;
+  void Compute(user_op::KernelComputeContext* ctx) const override {
+    const T* b1_x1 = ctx->Tensor4ArgNameAndIndex("b1_x1", 0)->dptr<T>();
+    const T* b1_x2 = ctx->Tensor4ArgNameAndIndex("b1_x2", 0)->dptr<T>();
+    const T* b2_x1 = ctx->Tensor4ArgNameAndIndex("b2_x1", 0)->dptr<T>();
+    const T* b2_x2 = ctx->Tensor4ArgNameAndIndex("b2_x2", 0)->dptr<T>();
+    const T* b1_y1 = ctx->Tensor4ArgNameAndIndex("b1_y1", 0)->dptr<T>();
+    const T* b1_y2 = ctx->Tensor4ArgNameAndIndex("b1_y2", 0)->dptr<T>();
+    const T* b2_y1 = ctx->Tensor4ArgNameAndIndex("b2_y1", 0)->dptr<T>();
+    const T* b2_y2 = ctx->Tensor4ArgNameAndIndex("b2_y2", 0)->dptr<T>();
+    T* inter = ctx->Tensor4ArgNameAndIndex("inter", 0)->mut_dptr<T>();
+    const int64_t elem_cnt = ctx->Tensor4ArgNameAndIndex("b1_x2", 0)->shape_view().elem_cnt();
+    ForEachBox(ctx->stream(), elem_cnt, [&](int64_t begin, int64_t end) {
+      const T zero = static_cast<T>(0.0);
+      for (int64_t i = begin; i < end; ++i) {
+        const T b_x_min_max = std::min(b1_x2[i], b2_x2[i]) - std::max(b1_x1[i], b2_x1[i]);
+        const T b_y_min_max = std::min(b1_y2[i], b2_y2[i]) - std::max(b1_y1[i], b2_y1[i]);
+        inter[i] =
+            (b_x_min_max > zero && b_y_min_max > zero) ? b_x_min_max * b_y_min_max : zero;
+      }
+    });
+  }
+  bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
+};
+
+template<typename T>
+class FusedGetIntersectionAreaGradCpuKernel final : public user_op::OpKernel {
+ public:
+  FusedGetIntersectionAreaGradCpuKernel() = default;
+  ~FusedGetIntersectionAreaGradCpuKernel() = default;
+
+ private:
+  using user_op::OpKernel::Compute;
+  void Compute(user_op::KernelComputeContext* ctx) const override {
+    const T* b1_x1 = ctx->Tensor4ArgNameAndIndex("b1_x1", 0)->dptr<T>();
+    const T* b1_x2 = ctx->Tensor4ArgNameAndIndex("b1_x2", 0)->dptr<T>();
+    const T* b2_x1 = ctx->Tensor4ArgNameAndIndex("b2_x1", 0)->dptr<T>();
+    const T* b2_x2 = ctx->Tensor4ArgNameAndIndex("b2_x2", 0)->dptr<T>();
+    const T* b1_y1 = ctx->Tensor4ArgNameAndIndex("b1_y1", 0)->dptr<T>();
+    const T* b1_y2 = ctx->Tensor4ArgNameAndIndex("b1_y2", 0)->dptr<T>();
+    const T* b2_y1 = ctx->Tensor4ArgNameAndIndex("b2_y1", 0)->dptr<T>();
+    const T* b2_y2 = ctx->Tensor4ArgNameAndIndex("b2_y2", 0)->dptr<T>();
+    const T* inter_diff = ctx->Tensor4ArgNameAndIndex("inter_diff", 0)->dptr<T>();
+    T* b1_x1_diff = ctx->Tensor4ArgNameAndIndex("b1_x1_diff", 0)->mut_dptr<T>();
+    T* b1_x2_diff = ctx->Tensor4ArgNameAndIndex("b1_x2_diff", 0)->mut_dptr<T>();
+    T* b2_x1_diff = ctx->Tensor4ArgNameAndIndex("b2_x1_diff", 0)->mut_dptr<T>();
+    T* b2_x2_diff = ctx->Tensor4ArgNameAndIndex("b2_x2_diff", 0)->mut_dptr<T>();
+    T* b1_y1_diff = ctx->Tensor4ArgNameAndIndex("b1_y1_diff", 0)->mut_dptr<T>();
+    T* b1_y2_diff = ctx->Tensor4ArgNameAndIndex("b1_y2_diff", 0)->mut_dptr<T>();
+    T* b2_y1_diff = ctx->Tensor4ArgNameAndIndex("b2_y1_diff", 0)->mut_dptr<T>();
+    T* b2_y2_diff = ctx->Tensor4ArgNameAndIndex("b2_y2_diff", 0)->mut_dptr<T>();
+    const int64_t elem_cnt = ctx->Tensor4ArgNameAndIndex("b1_x1", 0)->shape_view().elem_cnt();
+    ForEachBox(ctx->stream(), elem_cnt, [&](int64_t begin, int64_t end) {
+      const T zero = static_cast<T>(0.0);
+      for (int64_t i = begin; i < end; ++i) {
+        const T b_x_min_max = std::min(b1_x2[i], b2_x2[i]) - std::max(b1_x1[i], b2_x1[i]);
+        const T b_y_min_max = std::min(b1_y2[i], b2_y2[i]) - std::max(b1_y1[i], b2_y1[i]);
+        // the gradient only flows where the boxes overlap, ties feed both boxes like on CUDA
+        const bool overlap = b_x_min_max > zero && b_y_min_max > zero;
+        const T dx = overlap ? b_x_min_max * inter_diff[i] : zero;
+        const T dy = overlap ? b_y_min_max * inter_diff[i] : zero;
+        b1_x1_diff[i] = b1_x1[i] >= b2_x1[i] ? -dy : zero;
+        b2_x1_diff[i] = b1_x1[i] <= b2_x1[i] ? -dy : zero;
+        b1_x2_diff[i] = b1_x2[i] <= b2_x2[i] ? dy : zero;
+        b2_x2_diff[i] = b1_x2[i] >= b2_x2[i] ? dy : zero;
+        b1_y1_diff[i] = b1_y1[i] >= b2_y1[i] ? -dx : zero;
+        b2_y1_diff[i] = b1_y1[i] <= b2_y1[i] ? -dx : zero;
+        b1_y2_diff[i] = b1_y2[i] <= b2_y2[i] ? dx : zero;
+        b2_y2_diff[i] = b1_y2[i] >= b2_y2[i] ? dx : zero;
+      }
+    });
+  }
+  bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
+};
+
+template<typename T>
+class FusedGetIouCpuKernel final : public user_op::OpKernel {
+ public:
+  FusedGetIouCpuKernel() = default;
+  ~FusedGetIouCpuKernel() = default;
+
+ private:
+  using user_op::OpKernel::Compute;
+  void Compute(user_op::KernelComputeContext* ctx) const override {
+    const T* w1 = ctx->Tensor4ArgNameAndIndex("w1", 0)->dptr<T>();
+    const T* h1 = ctx->Tensor4ArgNameAndIndex("h1", 0)->dptr<T>();
+    const T* w2 = ctx->Tensor4ArgNameAndIndex("w2", 0)->dptr<T>();
+    const T* h2 = ctx->Tensor4ArgNameAndIndex("h2", 0)->dptr<T>();
+    const T* inter = ctx->Tensor4ArgNameAndIndex("inter", 0)->dptr<T>();
+    T* iou = ctx->Tensor4ArgNameAndIndex("iou", 0)->mut_dptr<T>();
+    const float eps = ctx->Attr<float>("eps");
+    const int64_t elem_cnt = ctx->Tensor4ArgNameAndIndex("w1", 0)->shape_view().elem_cnt();
+    ForEachBox(ctx->stream(), elem_cnt, [&](int64_t begin, int64_t end) {
+      for (int64_t i = begin; i < end; ++i) {
+        iou[i] = inter[i] / (w1[i] * h1[i] + w2[i] * h2[i] - inter[i] + static_cast<T>(eps));
+      }
+    });
+  }
+  bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
+};
+
+template<typename T>
+class FusedGetIouGradCpuKernel final : public user_op::OpKernel {
+ public:
+  FusedGetIouGradCpuKernel() = default;
+  ~FusedGetIouGradCpuKernel() = default;
+
+ private:
+  using user_op::OpKernel::Compute;
+  void Compute(user_op::KernelComputeContext* ctx) const override {
+    const T* diou = ctx->Tensor4ArgNameAndIndex("diou", 0)->dptr<T>();
+    const T* w1 = ctx->Tensor4ArgNameAndIndex("w1", 0)->dptr<T>();
+    const T* h1 = ctx->Tensor4ArgNameAndIndex("h1", 0)->dptr<T>();
+    const T* w2 = ctx->Tensor4ArgNameAndIndex("w2", 0)->dptr<T>();
+    const T* h2 = ctx->Tensor4ArgNameAndIndex("h2", 0)->dptr<T>();
+    const T* inter = ctx->Tensor4ArgNameAndIndex("inter", 0)->dptr<T>();
+    T* dw1 = ctx->Tensor4ArgNameAndIndex("dw1", 0)->mut_dptr<T>();
+    T* dh1 = ctx->Tensor4ArgNameAndIndex("dh1", 0)->mut_dptr<T>();
+    T* dinter = ctx->Tensor4ArgNameAndIndex("dinter", 0)->mut_dptr<T>();
+    const float eps = ctx->Attr<float>("eps");
+    const int64_t elem_cnt = ctx->Tensor4ArgNameAndIndex("diou", 0)->shape_view().elem_cnt();
+    ForEachBox(ctx->stream(), elem_cnt, [&](int64_t begin, int64_t end) {
+      for (int64_t i = begin; i < end; ++i) {
+        const T w_h_eps = w1[i] * h1[i] + w2[i] * h2[i] + static_cast<T>(eps);
+        const T w_h_eps_inter_diff = w_h_eps - inter[i];
+        const T w_h_eps_inter_diff_square = w_h_eps_inter_diff * w_h_eps_inter_diff;
+        const T common_for_dwh = -inter[i] * diou[i] / w_h_eps_inter_diff_square;
+        dinter[i] = w_h_eps * diou[i] / w_h_eps_inter_diff_square;
+        dw1[i] = h1[i] * common_for_dwh;
+        dh1[i] = w1[i] * common_for_dwh;
+      }
+    });
+  }
+  bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
+};
+
+}  // namespace
+
+#define REGISTER_FUSED_GET_BOX_OP_CPU_KERNEL(op_type_name, kernel, match_name, dtype)          \
+  REGISTER_USER_KERNEL(op_type_name)                                                           \
+      .SetCreateFn<kernel<dtype>>()                                                            \
+      .SetIsMatchedHob((user_op::HobDeviceType() == DeviceType::kCPU)                          \
+                       && (user_op::HobDataType(match_name, 0) == GetDataType<dtype>::value));
+
+#define REGISTER_FUSED_GET_BOX_OPS_CPU_KERNELS(dtype)                                            \
+  REGISTER_FUSED_GET_BOX_OP_CPU_KERNEL("fused_get_boundding_boxes_coord",                        \
+                                       FusedGetBounddingBoxesCoordCpuKernel, "b1_x1", dtype)     \
+  REGISTER_FUSED_GET_BOX_OP_CPU_KERNEL("fused_get_boundding_boxes_coord_grad",                   \
+                                       FusedGetBounddingBoxesCoordGradCpuKernel, "b1_x1_diff",   \
+                                       dtype)                                                    \
+  REGISTER_FUSED_GET_BOX_OP_CPU_KERNEL("fused_get_center_dist", FusedGetCenterDistCpuKernel,     \
+                                       "rho2", dtype)                                            \
+  REGISTER_FUSED_GET_BOX_OP_CPU_KERNEL("fused_get_center_dist_grad",                             \
+                                       FusedGetCenterDistGradCpuKernel, "b1_x1", dtype)          \
+  REGISTER_FUSED_GET_BOX_OP_CPU_KERNEL("fused_get_ciou_diagonal_angle",                          \
+                                       FusedGetCiouDiagonalAngleCpuKernel, "v", dtype)           \
+  REGISTER_FUSED_GET_BOX_OP_CPU_KERNEL("fused_get_ciou_diagonal_angle_grad",                     \
+                                       FusedGetCiouDiagonalAngleGradCpuKernel, "w1_diff", dtype) \
+  REGISTER_FUSED_GET_BOX_OP_CPU_KERNEL("fused_get_ciou_result", FusedGetCiouResultCpuKernel,     \
+                                       "v", dtype)                                               \
+  REGISTER_FUSED_GET_BOX_OP_CPU_KERNEL("fused_get_ciou_result_grad",                             \
+                                       FusedGetCiouResultGradCpuKernel, "dy", dtype)             \
+  REGISTER_FUSED_GET_BOX_OP_CPU_KERNEL("fused_get_convex_diagonal_squared",                      \
+                                       FusedGetConvexDiagonalSquaredCpuKernel, "b1_x1", dtype)   \
+  REGISTER_FUSED_GET_BOX_OP_CPU_KERNEL("fused_get_convex_diagonal_squared_grad",                 \
+                                       FusedGetConvexDiagonalSquaredGradCpuKernel, "b1_x1",      \
+                                       dtype)                                                    \
+  REGISTER_FUSED_GET_BOX_OP_CPU_KERNEL("fused_get_intersection_area",                            \
+                                       FusedGetIntersectionAreaCpuKernel, "inter", dtype)        \
+  REGISTER_FUSED_GET_BOX_OP_CPU_KERNEL("fused_get_intersection_area_grad",                       \
+                                       FusedGetIntersectionAreaGradCpuKernel, "b1_x1_diff",      \
+                                       dtype)                                                    \
+  REGISTER_FUSED_GET_BOX_OP_CPU_KERNEL("fused_get_iou", FusedGetIouCpuKernel, "iou", dtype)      \
+  REGISTER_FUSED_GET_BOX_OP_CPU_KERNEL("fused_get_iou_grad", FusedGetIouGradCpuKernel, "diou",   \
+                                       dtype)
+
+REGISTER_FUSED_GET_BOX_OPS_CPU_KERNELS(float)
+REGISTER_FUSED_GET_BOX_OPS_CPU_KERNELS(double)
+
+}  // namespace oneflow
@@ -0,0 +1,158 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/framework/framework.h"
+#include "oneflow/core/ep/include/primitive/unary_op.h"
+#include "oneflow/core/ep/cpu/primitive/unary_functor.h"
+#include "oneflow/user/kernels/fused_mlp_cpu_util.h"
+
+namespace oneflow {
+
+namespace {
+
+struct FusedGluCpuParams {
+  int64_t m;
+  int64_t n;
+  int64_t k;
+  // row stride of matmul_wx and matmul_vx
+  int64_t stride;
+  const void* x;
+  const void* w;
+  const void* v;
+  const void* b;
+  const void* c;
+  void* matmul_wx;
+  void* matmul_vx;
+  void* y;
+};
+
+template<typename T, ep::primitive::UnaryOp act_type>
+void LaunchFusedGluCpu(ep::Stream* stream, const FusedGluCpuParams& params) {
+  ep::primitive::UnaryFunctor<DeviceType::kCPU, act_type, T, T> act(0, 0);
+  const bool is_split_mode = params.v != nullptr;
+  const int64_t m = params.m;
+  const int64_t n = params.n;
+  const int64_t k = params.k;
+  const int64_t stride = params.stride;
+  const T* x = static_cast<const T*>(params.x);
+  const T* b = static_cast<const T*>(params.b);
+  const T* c = static_cast<const T*>(params.c);
+  T* matmul_wx = static_cast<T*>(params.matmul_wx);
+  T* matmul_vx = static_cast<T*>(params.matmul_vx);
+  T* y = static_cast<T*>(params.y);
+  auto matmul = NewFusedMatmulPrimitive(GetDataType<T>::value);
+  CHECK(matmul);
+  // Both the hidden state and the gate of a block have to stay in the cache for the epilogue.
+  const int64_t block_rows = GetFusedMatmulBlockRows(m, 2 * n, sizeof(T));
+  for (int64_t row_begin = 0; row_begin < m; row_begin += block_rows) {
+    const int64_t row_end = std::min(row_begin + block_rows, m);
+    const int64_t rows = row_end - row_begin;
+    matmul->Launch(stream, rows, stride, k, 1.0, x + row_begin * k, params.w, 0.0,
+                   matmul_wx + row_begin * stride);
+    if (is_split_mode) {
+      matmul->Launch(stream, rows, n, k, 1.0, x + row_begin * k, params.v, 0.0,
+                     matmul_vx + row_begin * n);
+    }
+    ParallelForEachRow(stream, row_begin, row_end, 2 * n, [&](int64_t row) {
+      T* wx_row = matmul_wx + row * stride;
+      if (b != nullptr) {
+        for (int64_t col = 0; col < stride; ++col) { wx_row[col] += b[col]; }
+      }
+      T* vx_row = is_split_mode ? matmul_vx + row * n : wx_row + n;
+      if (is_split_mode && c != nullptr) {
+        for (int64_t col = 0; col < n; ++col) { vx_row[col] += c[col]; }
+      }
+      T* y_row = y + row * n;
+      for (int64_t col = 0; col < n; ++col) { y_row[col] = wx_row[col] * act(vx_row[col]); }
+    });
+  }
+}
+
+template<typename T>
+void DispatchActivationType(ep::Stream* stream, const FusedGluCpuParams& params,
+                            const std::string& activation) {
+  if (activation == "none") {
+    LaunchFusedGluCpu<T, ep::primitive::UnaryOp::kIdentity>(stream, params);
+  } else if (activation == "sigmoid") {
+    LaunchFusedGluCpu<T, ep::primitive::UnaryOp::kSigmoid>(stream, params);
+  } else if (activation == "relu") {
+    LaunchFusedGluCpu<T, ep::primitive::UnaryOp::kRelu>(stream, params);
+  } else if (activation == "gelu") {
+    LaunchFusedGluCpu<T, ep::primitive::UnaryOp::kGelu>(stream, params);
+  } else if (activation == "fast_gelu") {
+    LaunchFusedGluCpu<T, ep::primitive::UnaryOp::kFastGelu>(stream, params);
+  } else if (activation == "silu") {
+    LaunchFusedGluCpu<T, ep::primitive::UnaryOp::kSilu>(stream, params);
+  } else {
+    UNIMPLEMENTED();
+  }
+}
+
+template<typename T>
+class CpuFusedGluKernel final : public user_op::OpKernel {
+ public:
+  CpuFusedGluKernel() = default;
+  ~CpuFusedGluKernel() override = default;
+
+ private:
+  void Compute(user_op::KernelComputeContext* ctx) const override {
+    const user_op::Tensor* x = ctx->Tensor4ArgNameAndIndex("x", 0);
+    const user_op::Tensor* w = ctx->Tensor4ArgNameAndIndex("w", 0);
+    user_op::Tensor* y = ctx->Tensor4ArgNameAndIndex("y", 0);
+    user_op::Tensor* matmul_wx = ctx->Tensor4ArgNameAndIndex("matmul_wx", 0);
+    const bool is_split_mode = ctx->has_input("v", 0);
+    const bool has_b = ctx->has_input("b", 0);
+    CHECK(!(has_b && is_split_mode && !ctx->has_input("c", 0)))
+        << "expected existance of c, when provide tensors w, v and b";
+
+    const ShapeView& x_shape = x->shape_view();
+    const int64_t k = x_shape.At(x_shape.NumAxes() - 1);
+    CHECK_EQ(w->shape_view().At(1), k)
+        << "dimension 1 of \'w\'(" << w->shape_view().At(1)
+        << ") is not consistant with the last dimension of \'x\'(" << k << ")";
+
+    FusedGluCpuParams params{};
+    params.m = x_shape.elem_cnt() / k;
+    params.n = y->shape_view().At(y->shape_view().NumAxes() - 1);
+    params.k = k;
+    params.stride = is_split_mode ? params.n : 2 * params.n;
+    params.x = x->dptr();
+    params.w = w->dptr();
+    params.matmul_wx = matmul_wx->mut_dptr();
+    params.y = y->mut_dptr();
+    if (has_b) { params.b = ctx->Tensor4ArgNameAndIndex("b", 0)->dptr(); }
+    if (is_split_mode) {
+      params.v = ctx->Tensor4ArgNameAndIndex("v", 0)->dptr();
+      params.matmul_vx = ctx->Tensor4ArgNameAndIndex("matmul_vx", 0)->mut_dptr();
+      if (has_b) { params.c = ctx->Tensor4ArgNameAndIndex("c", 0)->dptr(); }
+    }
+    DispatchActivationType<T>(ctx->stream(), params, ctx->Attr<std::string>("activation"));
+  }
+
+  bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
+};
+
+}  // namespace
+
+#define REGISTER_CPU_FUSED_GLU_KERNEL(dtype)                          \
+  REGISTER_USER_KERNEL("fused_glu")                                   \
+      .SetCreateFn<CpuFusedGluKernel<dtype>>()                        \
+      .SetIsMatchedHob((user_op::HobDeviceType() == DeviceType::kCPU) \
+                       && (user_op::HobDataType("y", 0) == GetDataType<dtype>::value));
+
+REGISTER_CPU_FUSED_GLU_KERNEL(double)
+REGISTER_CPU_FUSED_GLU_KERNEL(float)
+
+}  // namespace oneflow
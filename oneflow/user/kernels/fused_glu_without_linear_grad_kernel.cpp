@@ -0,0 +1,128 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/framework/framework.h"
+#include "oneflow/core/ep/include/primitive/binary_op.h"
+#include "oneflow/core/ep/include/primitive/unary_op.h"
+#include "oneflow/core/ep/cpu/primitive/binary_functor.h"
+#include "oneflow/core/ep/cpu/primitive/unary_functor.h"
+#include "oneflow/user/kernels/fused_mlp_cpu_util.h"
+
+namespace oneflow {
+
+namespace {
+
+template<typename T, ep::primitive::UnaryOp act_type, ep::primitive::BinaryOp d_act_type>
+void LaunchFusedGluWithoutLinearGradCpu(ep::Stream* stream, const int64_t m, const int64_t n,
+                                        const int64_t stride, const T* dy, const T* matmul_wx,
+                                        const T* matmul_vx, T* d_matmul_wx, T* d_matmul_vx) {
+  ep::primitive::UnaryFunctor<DeviceType::kCPU, act_type, T, T> act(0, 0);
+  ep::primitive::broadcast_elementwise_binary::BinaryFunctor<DeviceType::kCPU, d_act_type, T, T>
+      dact(0, 0);
+  ParallelForEachRow(stream, 0, m, n, [&](int64_t row) {
+    const T* dy_row = dy + row * n;
+    const T* wx_row = matmul_wx + row * stride;
+    const T* vx_row = matmul_vx + row * stride;
+    T* d_wx_row = d_matmul_wx + row * stride;
+    T* d_vx_row = d_matmul_vx + row * stride;
+    for (int64_t col = 0; col < n; ++col) {
+      const T gate = vx_row[col];
+      d_wx_row[col] = act(gate) * dy_row[col];               // d_hidden_state
+      d_vx_row[col] = dact(wx_row[col] * dy_row[col], gate);  // d_gate
+    }
+  });
+}
+
+template<typename T>
+void DispatchActivationType(ep::Stream* stream, const int64_t m, const int64_t n,
+                            const std::string& activation, const int64_t stride, const T* dy,
+                            const T* matmul_wx, const T* matmul_vx, T* d_matmul_wx,
+                            T* d_matmul_vx) {
+  if (activation == "none") {
+    LaunchFusedGluWithoutLinearGradCpu<T, ep::primitive::UnaryOp::kIdentity,
+                                       ep::primitive::BinaryOp::kIdentityBackwardWithDyX>(
+        stream, m, n, stride, dy, matmul_wx, matmul_vx, d_matmul_wx, d_matmul_vx);
+  } else if (activation == "sigmoid") {
+    LaunchFusedGluWithoutLinearGradCpu<T, ep::primitive::UnaryOp::kSigmoid,
+                                       ep::primitive::BinaryOp::kSigmoidBackwardWithDyX>(
+        stream, m, n, stride, dy, matmul_wx, matmul_vx, d_matmul_wx, d_matmul_vx);
+  } else if (activation == "relu") {
+    LaunchFusedGluWithoutLinearGradCpu<T, ep::primitive::UnaryOp::kRelu,
+                                       ep::primitive::BinaryOp::kReluBackwardWithDyX>(
+        stream, m, n, stride, dy, matmul_wx, matmul_vx, d_matmul_wx, d_matmul_vx);
+  } else if (activation == "gelu") {
+    LaunchFusedGluWithoutLinearGradCpu<T, ep::primitive::UnaryOp::kGelu,
+                                       ep::primitive::BinaryOp::kGeluBackwardWithDyX>(
+        stream, m, n, stride, dy, matmul_wx, matmul_vx, d_matmul_wx, d_matmul_vx);
+  } else if (activation == "fast_gelu") {
+    LaunchFusedGluWithoutLinearGradCpu<T, ep::primitive::UnaryOp::kFastGelu,
+                                       ep::primitive::BinaryOp::kFastGeluBackwardWithDyX>(
+        stream, m, n, stride, dy, matmul_wx, matmul_vx, d_matmul_wx, d_matmul_vx);
+  } else if (activation == "silu") {
+    LaunchFusedGluWithoutLinearGradCpu<T, ep::primitive::UnaryOp::kSilu,
+                                       ep::primitive::BinaryOp::kSiluBackwardWithDyX>(
+        stream, m, n, stride, dy, matmul_wx, matmul_vx, d_matmul_wx, d_matmul_vx);
+  } else {
+    UNIMPLEMENTED();
+  }
+}
+
+template<typename T>
+class CpuFusedGluWithoutLinearGradKernel final : public user_op::OpKernel {
+ public:
+  CpuFusedGluWithoutLinearGradKernel() = default;
+  ~CpuFusedGluWithoutLinearGradKernel() override = default;
+
+ private:
+  void Compute(user_op::KernelComputeContext* ctx) const override {
+    const user_op::Tensor* dy = ctx->Tensor4ArgNameAndIndex("dy", 0);
+    const user_op::Tensor* matmul_wx = ctx->Tensor4ArgNameAndIndex("matmul_wx", 0);
+    user_op::Tensor* d_matmul_wx = ctx->Tensor4ArgNameAndIndex("d_matmul_wx", 0);
+    const bool is_split_mode = ctx->has_input("matmul_vx", 0);
+
+    const ShapeView& dy_shape = dy->shape_view();
+    const size_t dy_num_axes = dy_shape.NumAxes();
+    const int64_t m = dy_shape.Count(0, dy_num_axes - 1);
+    const int64_t n = dy_shape.At(dy_num_axes - 1);
+    const T* matmul_vx = nullptr;
+    T* d_matmul_vx = nullptr;
+    if (is_split_mode) {
+      matmul_vx = ctx->Tensor4ArgNameAndIndex("matmul_vx", 0)->dptr<T>();
+      d_matmul_vx = ctx->Tensor4ArgNameAndIndex("d_matmul_vx", 0)->mut_dptr<T>();
+    } else {
+      matmul_vx = matmul_wx->dptr<T>() + n;
+      d_matmul_vx = d_matmul_wx->mut_dptr<T>() + n;
+    }
+    DispatchActivationType<T>(ctx->stream(), m, n, ctx->Attr<std::string>("activation"),
+                              /*stride=*/is_split_mode ? n : 2 * n, dy->dptr<T>(),
+                              matmul_wx->dptr<T>(), matmul_vx, d_matmul_wx->mut_dptr<T>(),
+                              d_matmul_vx);
+  }
+
+  bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
+};
+
+}  // namespace
+
+#define REGISTER_CPU_FUSED_GLU_WITHOUT_LINEAR_GRAD_KERNEL(dtype)      \
+  REGISTER_USER_KERNEL("fused_glu_without_linear_grad")               \
+      .SetCreateFn<CpuFusedGluWithoutLinearGradKernel<dtype>>()       \
+      .SetIsMatchedHob((user_op::HobDeviceType() == DeviceType::kCPU) \
+                       && (user_op::HobDataType("d_matmul_wx", 0) == GetDataType<dtype>::value));
+
+REGISTER_CPU_FUSED_GLU_WITHOUT_LINEAR_GRAD_KERNEL(double)
+REGISTER_CPU_FUSED_GLU_WITHOUT_LINEAR_GRAD_KERNEL(float)
+
+}  // namespace oneflow
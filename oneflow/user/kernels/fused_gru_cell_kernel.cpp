@@ -0,0 +1,242 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include <algorithm>
+#include <cmath>
+#include "oneflow/core/framework/framework.h"
+#include "oneflow/core/ep/cpu/cpu_stream.h"
+
+namespace oneflow {
+
+namespace {
+
+// The number of elements processed by a thread at least.
+constexpr int64_t kFusedGruCellGrain = 32768;
+
+template<typename T>
+inline T Sigmoid(T in) {
+  const T one = static_cast<T>(1.0);
+  return one / (one + std::exp(-in));
+}
+
+// The gates of a row are stored as [r, i, n] blocks of hidden_size and the workspace of a row as
+// [rg, ig, ng, hx, hn + b_hn] blocks, every block is computed in its own unit-stride loop over the
+// hidden units so that the compiler can vectorize them.
+template<typename T>
+void GruCellForward(ep::Stream* stream, const int64_t batch_size, const int64_t hidden_size,
+                    const T* input_gates_ptr, const T* hidden_gates_ptr, const T* hx_ptr,
+                    const T* input_bias_ptr, const T* hidden_bias_ptr, T* hy_ptr,
+                    T* workspace_ptr) {
+  const int64_t gates_size = 3 * hidden_size;
+  const size_t grain = std::max<int64_t>(kFusedGruCellGrain / (5 * hidden_size), 1);
+  stream->As<ep::CpuStream>()->ParallelFor(
+      0, batch_size,
+      [&](int64_t begin, int64_t end) {
+        for (int64_t row = begin; row < end; ++row) {
+          const T* ir = input_gates_ptr + row * gates_size;
+          const T* ii = ir + hidden_size;
+          const T* in = ir + 2 * hidden_size;
+          const T* hr = hidden_gates_ptr + row * gates_size;
+          const T* hi = hr + hidden_size;
+          const T* hn = hr + 2 * hidden_size;
+          const T* hx = hx_ptr + row * hidden_size;
+          T* hy = hy_ptr + row * hidden_size;
+          T* rg = workspace_ptr + row * 5 * hidden_size;
+          T* ig = rg + hidden_size;
+          T* ng = rg + 2 * hidden_size;
+          T* saved_hx = rg + 3 * hidden_size;
+          T* saved_hn = rg + 4 * hidden_size;
+          if (input_bias_ptr != nullptr) {
+            const T* b1r = input_bias_ptr;
+            const T* b1i = b1r + hidden_size;
+            const T* b1n = b1r + 2 * hidden_size;
+            const T* b2r = hidden_bias_ptr;
+            const T* b2i = b2r + hidden_size;
+            const T* b2n = b2r + 2 * hidden_size;
+            for (int64_t j = 0; j < hidden_size; ++j) { rg[j] = ir[j] + hr[j] + b1r[j] + b2r[j]; }
+            for (int64_t j = 0; j < hidden_size; ++j) { ig[j] = ii[j] + hi[j] + b1i[j] + b2i[j]; }
+            for (int64_t j = 0; j < hidden_size; ++j) { ng[j] = in[j] + b1n[j]; }
+            for (int64_t j = 0; j < hidden_size; ++j) { saved_hn[j] = hn[j] + b2n[j]; }
+          } else {
+            for (int64_t j = 0; j < hidden_size; ++j) { rg[j] = ir[j] + hr[j]; }
+            for (int64_t j = 0; j < hidden_size; ++j) { ig[j] = ii[j] + hi[j]; }
+            for (int64_t j = 0; j < hidden_size; ++j) { ng[j] = in[j]; }
+            for (int64_t j = 0; j < hidden_size; ++j) { saved_hn[j] = hn[j]; }
+          }
+          for (int64_t j = 0; j < hidden_size; ++j) { rg[j] = Sigmoid(rg[j]); }
+          for (int64_t j = 0; j < hidden_size; ++j) { ig[j] = Sigmoid(ig[j]); }
+          for (int64_t j = 0; j < hidden_size; ++j) {
+            ng[j] = std::tanh(ng[j] + rg[j] * saved_hn[j]);
+          }
+          for (int64_t j = 0; j < hidden_size; ++j) {
+            saved_hx[j] = hx[j];
+            hy[j] = ng[j] + ig[j] * (hx[j] - ng[j]);
+          }
+        }
+      },
+      grain);
+}
+
+template<typename T>
+void GruCellBackward(ep::Stream* stream, const int64_t batch_size, const int64_t hidden_size,
+                     const T* grad_hy_ptr, const T* workspace_ptr, T* grad_input_gates_ptr,
+                     T* grad_hidden_gates_ptr, T* grad_hx_ptr) {
+  const int64_t gates_size = 3 * hidden_size;
+  const size_t grain = std::max<int64_t>(kFusedGruCellGrain / (5 * hidden_size), 1);
+  const T one = static_cast<T>(1.0);
+  stream->As<ep::CpuStream>()->ParallelFor(
+      0, batch_size,
+      [&](int64_t begin, int64_t end) {
+        for (int64_t row = begin; row < end; ++row) {
+          const T* rg = workspace_ptr + row * 5 * hidden_size;
+          const T* ig = rg + hidden_size;
+          const T* ng = rg + 2 * hidden_size;
+          const T* hx = rg + 3 * hidden_size;
+          const T* hn = rg + 4 * hidden_size;
+          const T* grad_hy = grad_hy_ptr + row * hidden_size;
+          T* grad_ir = grad_input_gates_ptr + row * gates_size;
+          T* grad_ii = grad_ir + hidden_size;
+          T* grad_in = grad_ir + 2 * hidden_size;
+          T* grad_hr = grad_hidden_gates_ptr + row * gates_size;
+          T* grad_hi = grad_hr + hidden_size;
+          T* grad_hn = grad_hr + 2 * hidden_size;
+          for (int64_t j = 0; j < hidden_size; ++j) {
+            const T gig = grad_hy[j] * (hx[j] - ng[j]) * (one - ig[j]) * ig[j];
+            const T gin = grad_hy[j] * (one - ig[j]) * (one - ng[j] * ng[j]);
+            const T grg = gin * hn[j] * (one - rg[j]) * rg[j];
+            grad_ir[j] = grg;
+            grad_ii[j] = gig;
+            grad_in[j] = gin;
+            grad_hr[j] = grg;
+            grad_hi[j] = gig;
+            grad_hn[j] = gin * rg[j];
+          }
+          if (grad_hx_ptr != nullptr) {
+            T* grad_hx = grad_hx_ptr + row * hidden_size;
+            for (int64_t j = 0; j < hidden_size; ++j) { grad_hx[j] = grad_hy[j] * ig[j]; }
+          }
+        }
+      },
+      grain);
+}
+
+// Sums the gradient of the gates over the batch, every thread owns a range of the columns.
+template<typename T>
+void ReduceGradBias(ep::Stream* stream, const int64_t batch_size, const int64_t gates_size,
+                    const T* grad_gates_ptr, T* grad_bias_ptr) {
+  const size_t grain = std::max<int64_t>(kFusedGruCellGrain / std::max<int64_t>(batch_size, 1), 1);
+  stream->As<ep::CpuStream>()->ParallelFor(
+      0, gates_size,
+      [&](int64_t begin, int64_t end) {
+        std::fill(grad_bias_ptr + begin, grad_bias_ptr + end, static_cast<T>(0));
+        for (int64_t row = 0; row < batch_size; ++row) {
+          const T* grad_gates = grad_gates_ptr + row * gates_size;
+          for (int64_t j = begin; j < end; ++j) { grad_bias_ptr[j] += grad_gates[j]; }
+        }
+      },
+      grain);
+}
+
+template<typename T>
+class CpuFusedGruCellKernel final : public user_op::OpKernel {
+ public:
+  CpuFusedGruCellKernel() = default;
+  ~CpuFusedGruCellKernel() = default;
+
+ private:
+  using user_op::OpKernel::Compute;
+  void Compute(user_op::KernelComputeContext* ctx) const override {
+    const user_op::Tensor* input_gates = ctx->Tensor4ArgNameAndIndex("input_gates", 0);
+    const user_op::Tensor* hidden_gates = ctx->Tensor4ArgNameAndIndex("hidden_gates", 0);
+    const user_op::Tensor* hx = ctx->Tensor4ArgNameAndIndex("hx", 0);
+    user_op::Tensor* hy = ctx->Tensor4ArgNameAndIndex("hy", 0);
+    user_op::Tensor* workspace = ctx->Tensor4ArgNameAndIndex("workspace", 0);
+
+    const T* input_bias_ptr = nullptr;
+    const T* hidden_bias_ptr = nullptr;
+    if (ctx->has_input("input_bias", 0)) {
+      CHECK(ctx->has_input("hidden_bias", 0));
+      input_bias_ptr = ctx->Tensor4ArgNameAndIndex("input_bias", 0)->dptr<T>();
+      hidden_bias_ptr = ctx->Tensor4ArgNameAndIndex("hidden_bias", 0)->dptr<T>();
+    }
+    const int64_t hidden_size = hx->shape_view().At(hx->shape_view().NumAxes() - 1);
+    const int64_t batch_size = hx->shape_view().elem_cnt() / hidden_size;
+    GruCellForward<T>(ctx->stream(), batch_size, hidden_size, input_gates->dptr<T>(),
+                      hidden_gates->dptr<T>(), hx->dptr<T>(), input_bias_ptr, hidden_bias_ptr,
+                      hy->mut_dptr<T>(), workspace->mut_dptr<T>());
+  }
+
+  bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
+};
+
+#define REGISTER_CPU_FUSED_GRU_CELL_KERNEL(dtype)                                               \
+  REGISTER_USER_KERNEL("fused_gru_cell")                                                        \
+      .SetCreateFn<CpuFusedGruCellKernel<dtype>>()                                              \
+      .SetIsMatchedHob((user_op::HobDeviceType() == DeviceType::kCPU)                           \
+                       && (user_op::HobDataType("hx", 0) == GetDataType<dtype>::value)          \
+                       && (user_op::HobDataType("input_gates", 0) == GetDataType<dtype>::value) \
+                       && (user_op::HobDataType("hidden_gates", 0) == GetDataType<dtype>::value))
+
+REGISTER_CPU_FUSED_GRU_CELL_KERNEL(float);
+REGISTER_CPU_FUSED_GRU_CELL_KERNEL(double);
+
+template<typename T>
+class CpuFusedGruCellGradKernel final : public user_op::OpKernel {
+ public:
+  CpuFusedGruCellGradKernel() = default;
+  ~CpuFusedGruCellGradKernel() = default;
+
+ private:
+  using user_op::OpKernel::Compute;
+  void Compute(user_op::KernelComputeContext* ctx) const override {
+    const user_op::Tensor* grad_hy = ctx->Tensor4ArgNameAndIndex("grad_hy", 0);
+    const user_op::Tensor* workspace = ctx->Tensor4ArgNameAndIndex("workspace", 0);
+    user_op::Tensor* grad_input_gates = ctx->Tensor4ArgNameAndIndex("grad_input_gates", 0);
+    user_op::Tensor* grad_hidden_gates = ctx->Tensor4ArgNameAndIndex("grad_hidden_gates", 0);
+
+    T* grad_hx_ptr = nullptr;
+    if (ctx->has_output("grad_hx", 0)) {
+      grad_hx_ptr = ctx->Tensor4ArgNameAndIndex("grad_hx", 0)->mut_dptr<T>();
+    }
+    const int64_t hidden_size = grad_hy->shape_view().At(grad_hy->shape_view().NumAxes() - 1);
+    const int64_t batch_size = grad_hy->shape_view().elem_cnt() / hidden_size;
+    GruCellBackward<T>(ctx->stream(), batch_size, hidden_size, grad_hy->dptr<T>(),
+                       workspace->dptr<T>(), grad_input_gates->mut_dptr<T>(),
+                       grad_hidden_gates->mut_dptr<T>(), grad_hx_ptr);
+
+    if (ctx->has_output("grad_input_bias", 0) && ctx->has_output("grad_hidden_bias", 0)) {
+      ReduceGradBias<T>(ctx->stream(), batch_size, 3 * hidden_size, grad_input_gates->dptr<T>(),
+                        ctx->Tensor4ArgNameAndIndex("grad_input_bias", 0)->mut_dptr<T>());
+      ReduceGradBias<T>(ctx->stream(), batch_size, 3 * hidden_size, grad_hidden_gates->dptr<T>(),
+                        ctx->Tensor4ArgNameAndIndex("grad_hidden_bias", 0)->mut_dptr<T>());
+    }
+  }
+
+  bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
+};
+
+#define REGISTER_CPU_FUSED_GRU_CELL_GRAD_KERNEL(dtype)                                      \
+  REGISTER_USER_KERNEL("fused_gru_cell_grad")                                               \
+      .SetCreateFn<CpuFusedGruCellGradKernel<dtype>>()                                      \
+      .SetIsMatchedHob((user_op::HobDeviceType() == DeviceType::kCPU)                       \
+                       && (user_op::HobDataType("grad_hy", 0) == GetDataType<dtype>::value) \
+                       && (user_op::HobDataType("workspace", 0) == GetDataType<dtype>::value))
+
+REGISTER_CPU_FUSED_GRU_CELL_GRAD_KERNEL(float);
+REGISTER_CPU_FUSED_GRU_CELL_GRAD_KERNEL(double);
+
+}  // namespace
+
+}  // namespace oneflow
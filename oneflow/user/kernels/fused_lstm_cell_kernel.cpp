@@ -0,0 +1,228 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include <algorithm>
+#include <cmath>
+#include "oneflow/core/framework/framework.h"
+#include "oneflow/core/ep/cpu/cpu_stream.h"
+
+namespace oneflow {
+
+namespace {
+
+// The number of elements processed by a thread at least.
+constexpr int64_t kFusedLstmCellGrain = 32768;
+
+template<typename T>
+inline T Sigmoid(T in) {
+  const T one = static_cast<T>(1.0);
+  return one / (one + std::exp(-in));
+}
+
+// The gates of a row are stored as [i, f, c, o] blocks of hidden_size, every gate is computed in
+// its own unit-stride loop over the hidden units so that the compiler can vectorize them.
+template<typename T>
+void LstmCellForward(ep::Stream* stream, const int64_t batch_size, const int64_t hidden_size,
+                     const T* input_gates_ptr, const T* hidden_gates_ptr, const T* cx_ptr,
+                     const T* input_bias_ptr, const T* hidden_bias_ptr, T* hy_ptr, T* cy_ptr,
+                     T* workspace_ptr) {
+  const int64_t gates_size = 4 * hidden_size;
+  const size_t grain = std::max<int64_t>(kFusedLstmCellGrain / gates_size, 1);
+  stream->As<ep::CpuStream>()->ParallelFor(
+      0, batch_size,
+      [&](int64_t begin, int64_t end) {
+        for (int64_t row = begin; row < end; ++row) {
+          const T* input_gates = input_gates_ptr + row * gates_size;
+          const T* hidden_gates = hidden_gates_ptr + row * gates_size;
+          T* gates = workspace_ptr + row * gates_size;
+          if (input_bias_ptr != nullptr) {
+            for (int64_t j = 0; j < gates_size; ++j) {
+              gates[j] = input_gates[j] + hidden_gates[j] + input_bias_ptr[j] + hidden_bias_ptr[j];
+            }
+          } else {
+            for (int64_t j = 0; j < gates_size; ++j) {
+              gates[j] = input_gates[j] + hidden_gates[j];
+            }
+          }
+          T* ig = gates;
+          T* fg = gates + hidden_size;
+          T* cg = gates + 2 * hidden_size;
+          T* og = gates + 3 * hidden_size;
+          for (int64_t j = 0; j < hidden_size; ++j) { ig[j] = Sigmoid(ig[j]); }
+          for (int64_t j = 0; j < hidden_size; ++j) { fg[j] = Sigmoid(fg[j]); }
+          for (int64_t j = 0; j < hidden_size; ++j) { cg[j] = std::tanh(cg[j]); }
+          for (int64_t j = 0; j < hidden_size; ++j) { og[j] = Sigmoid(og[j]); }
+          const T* cx = cx_ptr + row * hidden_size;
+          T* cy = cy_ptr + row * hidden_size;
+          T* hy = hy_ptr + row * hidden_size;
+          for (int64_t j = 0; j < hidden_size; ++j) {
+            cy[j] = fg[j] * cx[j] + ig[j] * cg[j];
+            hy[j] = og[j] * std::tanh(cy[j]);
+          }
+        }
+      },
+      grain);
+}
+
+template<typename T>
+void LstmCellBackward(ep::Stream* stream, const int64_t batch_size, const int64_t hidden_size,
+                      const T* grad_hy_ptr, const T* grad_cy_ptr, const T* cx_ptr, const T* cy_ptr,
+                      const T* workspace_ptr, T* grad_gates_ptr, T* grad_cx_ptr) {
+  const int64_t gates_size = 4 * hidden_size;
+  const size_t grain = std::max<int64_t>(kFusedLstmCellGrain / gates_size, 1);
+  const T one = static_cast<T>(1.0);
+  stream->As<ep::CpuStream>()->ParallelFor(
+      0, batch_size,
+      [&](int64_t begin, int64_t end) {
+        for (int64_t row = begin; row < end; ++row) {
+          const T* ig = workspace_ptr + row * gates_size;
+          const T* fg = ig + hidden_size;
+          const T* cg = ig + 2 * hidden_size;
+          const T* og = ig + 3 * hidden_size;
+          T* gig = grad_gates_ptr + row * gates_size;
+          T* gfg = gig + hidden_size;
+          T* gcg = gig + 2 * hidden_size;
+          T* gog = gig + 3 * hidden_size;
+          const T* grad_hy = grad_hy_ptr + row * hidden_size;
+          const T* grad_cy = grad_cy_ptr + row * hidden_size;
+          const T* cx = cx_ptr + row * hidden_size;
+          const T* cy = cy_ptr + row * hidden_size;
+          T* grad_cx = grad_cx_ptr == nullptr ? nullptr : grad_cx_ptr + row * hidden_size;
+          for (int64_t j = 0; j < hidden_size; ++j) {
+            const T tanh_cy = std::tanh(cy[j]);
+            const T gcx = grad_hy[j] * og[j] * (one - tanh_cy * tanh_cy) + grad_cy[j];
+            gig[j] = gcx * cg[j] * (one - ig[j]) * ig[j];
+            gfg[j] = gcx * cx[j] * (one - fg[j]) * fg[j];
+            gcg[j] = gcx * ig[j] * (one - cg[j] * cg[j]);
+            gog[j] = grad_hy[j] * tanh_cy * (one - og[j]) * og[j];
+            if (grad_cx != nullptr) { grad_cx[j] = gcx * fg[j]; }
+          }
+        }
+      },
+      grain);
+}
+
+// Sums the gradient of the gates over the batch, every thread owns a range of the columns.
+template<typename T>
+void ReduceGradBias(ep::Stream* stream, const int64_t batch_size, const int64_t gates_size,
+                    const T* grad_gates_ptr, T* grad_bias_ptr) {
+  const size_t grain = std::max<int64_t>(kFusedLstmCellGrain / std::max<int64_t>(batch_size, 1), 1);
+  stream->As<ep::CpuStream>()->ParallelFor(
+      0, gates_size,
+      [&](int64_t begin, int64_t end) {
+        std::fill(grad_bias_ptr + begin, grad_bias_ptr + end, static_cast<T>(0));
+        for (int64_t row = 0; row < batch_size; ++row) {
+          const T* grad_gates = grad_gates_ptr + row * gates_size;
+          for (int64_t j = begin; j < end; ++j) { grad_bias_ptr[j] += grad_gates[j]; }
+        }
+      },
+      grain);
+}
+
+template<typename T>
+class CpuFusedLstmCellKernel final : public user_op::OpKernel {
+ public:
+  CpuFusedLstmCellKernel() = default;
+  ~CpuFusedLstmCellKernel() = default;
+
+ private:
+  using user_op::OpKernel::Compute;
+  void Compute(user_op::KernelComputeContext* ctx) const override {
+    const user_op::Tensor* input_gates = ctx->Tensor4ArgNameAndIndex("input_gates", 0);
+    const user_op::Tensor* hidden_gates = ctx->Tensor4ArgNameAndIndex("hidden_gates", 0);
+    const user_op::Tensor* cx = ctx->Tensor4ArgNameAndIndex("cx", 0);
+    user_op::Tensor* hy = ctx->Tensor4ArgNameAndIndex("hy", 0);
+    user_op::Tensor* cy = ctx->Tensor4ArgNameAndIndex("cy", 0);
+    user_op::Tensor* workspace = ctx->Tensor4ArgNameAndIndex("workspace", 0);
+
+    const T* input_bias_ptr = nullptr;
+    const T* hidden_bias_ptr = nullptr;
+    if (ctx->has_input("input_bias", 0)) {
+      CHECK(ctx->has_input("hidden_bias", 0));
+      input_bias_ptr = ctx->Tensor4ArgNameAndIndex("input_bias", 0)->dptr<T>();
+      hidden_bias_ptr = ctx->Tensor4ArgNameAndIndex("hidden_bias", 0)->dptr<T>();
+    }
+    const int64_t hidden_size = cx->shape_view().At(cx->shape_view().NumAxes() - 1);
+    const int64_t batch_size = cx->shape_view().elem_cnt() / hidden_size;
+    LstmCellForward<T>(ctx->stream(), batch_size, hidden_size, input_gates->dptr<T>(),
+                       hidden_gates->dptr<T>(), cx->dptr<T>(), input_bias_ptr, hidden_bias_ptr,
+                       hy->mut_dptr<T>(), cy->mut_dptr<T>(), workspace->mut_dptr<T>());
+  }
+
+  bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
+};
+
+#define REGISTER_CPU_FUSED_LSTM_CELL_KERNEL(dtype)                                              \
+  REGISTER_USER_KERNEL("fused_lstm_cell")                                                       \
+      .SetCreateFn<CpuFusedLstmCellKernel<dtype>>()                                             \
+      .SetIsMatchedHob((user_op::HobDeviceType() == DeviceType::kCPU)                           \
+                       && (user_op::HobDataType("cx", 0) == GetDataType<dtype>::value)          \
+                       && (user_op::HobDataType("input_gates", 0) == GetDataType<dtype>::value) \
+                       && (user_op::HobDataType("hidden_gates", 0) == GetDataType<dtype>::value))
+
+REGISTER_CPU_FUSED_LSTM_CELL_KERNEL(float);
+REGISTER_CPU_FUSED_LSTM_CELL_KERNEL(double);
+
+template<typename T>
+class CpuFusedLstmCellGradKernel final : public user_op::OpKernel {
+ public:
+  CpuFusedLstmCellGradKernel() = default;
+  ~CpuFusedLstmCellGradKernel() = default;
+
+ private:
+  using user_op::OpKernel::Compute;
+  void Compute(user_op::KernelComputeContext* ctx) const override {
+    const user_op::Tensor* grad_hy = ctx->Tensor4ArgNameAndIndex("grad_hy", 0);
+    const user_op::Tensor* grad_cy = ctx->Tensor4ArgNameAndIndex("grad_cy", 0);
+    const user_op::Tensor* cx = ctx->Tensor4ArgNameAndIndex("cx", 0);
+    const user_op::Tensor* cy = ctx->Tensor4ArgNameAndIndex("cy", 0);
+    const user_op::Tensor* workspace = ctx->Tensor4ArgNameAndIndex("workspace", 0);
+    user_op::Tensor* grad_gates = ctx->Tensor4ArgNameAndIndex("grad_gates", 0);
+
+    T* grad_cx_ptr = nullptr;
+    if (ctx->has_output("grad_cx", 0)) {
+      grad_cx_ptr = ctx->Tensor4ArgNameAndIndex("grad_cx", 0)->mut_dptr<T>();
+    }
+    const int64_t hidden_size = cx->shape_view().At(cx->shape_view().NumAxes() - 1);
+    const int64_t batch_size = cx->shape_view().elem_cnt() / hidden_size;
+    LstmCellBackward<T>(ctx->stream(), batch_size, hidden_size, grad_hy->dptr<T>(),
+                        grad_cy->dptr<T>(), cx->dptr<T>(), cy->dptr<T>(), workspace->dptr<T>(),
+                        grad_gates->mut_dptr<T>(), grad_cx_ptr);
+
+    if (ctx->has_output("grad_bias", 0)) {
+      ReduceGradBias<T>(ctx->stream(), batch_size, 4 * hidden_size, grad_gates->dptr<T>(),
+                        ctx->Tensor4ArgNameAndIndex("grad_bias", 0)->mut_dptr<T>());
+    }
+  }
+
+  bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
+};
+
+#define REGISTER_CPU_FUSED_LSTM_CELL_GRAD_KERNEL(dtype)                                      \
+  REGISTER_USER_KERNEL("fused_lstm_cell_grad")                                               \
+      .SetCreateFn<CpuFusedLstmCellGradKernel<dtype>>()                                      \
+      .SetIsMatchedHob((user_op::HobDeviceType() == DeviceType::kCPU)                        \
+                       && (user_op::HobDataType("grad_hy", 0) == GetDataType<dtype>::value)  \
+                       && (user_op::HobDataType("grad_cy", 0) == GetDataType<dtype>::value)  \
+                       && (user_op::HobDataType("cx", 0) == GetDataType<dtype>::value)       \
+                       && (user_op::HobDataType("cy", 0) == GetDataType<dtype>::value)       \
+                       && (user_op::HobDataType("workspace", 0) == GetDataType<dtype>::value))
+
+REGISTER_CPU_FUSED_LSTM_CELL_GRAD_KERNEL(float);
+REGISTER_CPU_FUSED_LSTM_CELL_GRAD_KERNEL(double);
+
+}  // namespace
+
+}  // namespace oneflow
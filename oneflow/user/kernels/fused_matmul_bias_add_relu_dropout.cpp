@@ -0,0 +1,111 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include <cstring>
+#include "oneflow/core/framework/framework.h"
+#include "oneflow/core/kernel/kernel_util.h"
+#include "oneflow/user/kernels/dropout_kernel.h"
+#include "oneflow/user/kernels/fused_mlp_cpu_util.h"
+#include "oneflow/user/kernels/random_seed_util.h"
+
+namespace oneflow {
+
+namespace {
+
+template<typename T>
+class FusedMatmulBiasAddReluDropoutCpuKernel final : public user_op::OpKernel {
+ public:
+  FusedMatmulBiasAddReluDropoutCpuKernel() = default;
+  ~FusedMatmulBiasAddReluDropoutCpuKernel() override = default;
+
+  std::shared_ptr<user_op::OpKernelState> CreateOpKernelState(
+      user_op::KernelInitContext* ctx) const override {
+    const auto& generator = CHECK_JUST(one::MakeGenerator(kCPU));
+    generator->set_current_seed(
+        CHECK_JUST(GetOpKernelRandomSeedInCurrentRank(ctx, ctx->Attr<int64_t>("seed"))));
+    return std::make_shared<FusedDropoutKernelState>(generator);
+  }
+
+ private:
+  using user_op::OpKernel::Compute;
+  void Compute(user_op::KernelComputeContext* ctx, user_op::OpKernelState* state,
+               const user_op::OpKernelCache*) const override {
+    const int32_t weight_size = ctx->input_size("weights");
+    CHECK_EQ(weight_size, ctx->input_size("biases"))
+        << "The number of weight and bias is not equal!. ";
+    const bool skip_final_activation = ctx->Attr<bool>("skip_final_activation");
+    const std::vector<float> dropout_rate_list = ctx->Attr<std::vector<float>>("dropout_rate_list");
+
+    auto* fused_dropout_kernel_state = dynamic_cast<FusedDropoutKernelState*>(state);
+    CHECK_NOTNULL(fused_dropout_kernel_state);
+    const auto& generator = fused_dropout_kernel_state->generator();
+    CHECK_NOTNULL(generator);
+    std::shared_ptr<ep::CPUGenerator> cpu_generator =
+        CHECK_JUST(generator->Get<ep::CPUGenerator>());
+    /*
+    `uniform_real_distribution` interval is [a, b).
+    And `curand_uniform4` interval is (0, 1.0], so we use > in CUDA and use >= in CPU.
+    */
+    std::uniform_real_distribution<float> random_distribution(GetZeroVal<float>(),
+                                                              GetOneVal<float>());
+
+    LaunchFusedMLP<T>(ctx, [&](int32_t idx, int64_t row_begin, int64_t row_end, int64_t n, T* y) {
+      const T* bias = ctx->Tensor4ArgNameAndIndex("biases", idx)->dptr<T>();
+      const bool relu = idx != weight_size - 1 || !skip_final_activation;
+      const float rate = dropout_rate_list.at(idx);
+      float scale = 0.0f;
+      if (rate < 1.0f) { scale = 1.0f / (1.0f - rate); }
+      // The mask of relu and dropout is saved as the bit mask of cublas_aux like the cuda kernel.
+      user_op::Tensor* cublas_aux = ctx->Tensor4ArgNameAndIndex("cublas_aux", idx);
+      const int64_t aux_ld = cublas_aux->shape_view().At(1);
+      int32_t* aux = cublas_aux->mut_dptr<int32_t>();
+      const auto ApplyRow = [&](int64_t row, const auto& keep) {
+        T* y_row = y + row * n;
+        int32_t* aux_row = aux + row * aux_ld;
+        std::memset(aux_row, 0, aux_ld * sizeof(int32_t));
+        for (int64_t col = 0; col < n; ++col) {
+          T value = y_row[col] + bias[col];
+          bool mask = keep();
+          if (relu) { mask = mask && value > static_cast<T>(0); }
+          y_row[col] = mask ? value * static_cast<T>(scale) : static_cast<T>(0);
+          if (mask) { aux_row[col / 32] |= (1U << (col % 32)); }
+        }
+      };
+      if (rate == 0.0f) {
+        ParallelForEachRow(ctx->stream(), row_begin, row_end, n,
+                           [&](int64_t row) { ApplyRow(row, [] { return true; }); });
+      } else {
+        // The random engine is not thread safe, the rows with dropout are processed serially.
+        const auto Keep = [&] { return random_distribution(cpu_generator->engine()) >= rate; };
+        for (int64_t row = row_begin; row < row_end; ++row) { ApplyRow(row, Keep); }
+      }
+    });
+  }
+
+  bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
+};
+
+#define REGISTER_FUSED_MATMUL_BIAS_ADD_RELU_DROPOUT_KERNEL_CPU(cpp_type, data_type) \
+  REGISTER_USER_KERNEL("fused_matmul_bias_add_relu_dropout")                        \
+      .SetCreateFn<FusedMatmulBiasAddReluDropoutCpuKernel<cpp_type>>()              \
+      .SetIsMatchedHob((user_op::HobDeviceType() == DeviceType::kCPU)               \
+                       && (user_op::HobDataType("out", 0) == data_type));
+
+REGISTER_FUSED_MATMUL_BIAS_ADD_RELU_DROPOUT_KERNEL_CPU(float, DataType::kFloat);
+REGISTER_FUSED_MATMUL_BIAS_ADD_RELU_DROPOUT_KERNEL_CPU(double, DataType::kDouble);
+
+}  // namespace
+
+}  // namespace oneflow
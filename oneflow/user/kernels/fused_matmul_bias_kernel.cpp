@@ -0,0 +1,83 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/framework/framework.h"
+#include "oneflow/user/kernels/fused_mlp_cpu_util.h"
+
+namespace oneflow {
+
+namespace {
+
+template<typename T>
+class FusedMatmulBiasCpuKernel final : public user_op::OpKernel {
+ public:
+  FusedMatmulBiasCpuKernel() = default;
+  ~FusedMatmulBiasCpuKernel() override = default;
+
+ private:
+  void Compute(user_op::KernelComputeContext* ctx) const override {
+    const user_op::Tensor* x = ctx->Tensor4ArgNameAndIndex("x", 0);
+    const user_op::Tensor* weight = ctx->Tensor4ArgNameAndIndex("weight", 0);
+    const user_op::Tensor* bias = ctx->Tensor4ArgNameAndIndex("bias", 0);
+    user_op::Tensor* out = ctx->Tensor4ArgNameAndIndex("out", 0);
+    const T* add_to_output = ctx->has_input("_add_to_output", 0)
+                                 ? ctx->Tensor4ArgNameAndIndex("_add_to_output", 0)->dptr<T>()
+                                 : nullptr;
+    const double alpha = ctx->Attr<double>("alpha");
+    const T beta = static_cast<T>(add_to_output == nullptr ? 0.0 : ctx->Attr<double>("beta"));
+
+    const int64_t k = x->shape_view().At(x->shape_view().NumAxes() - 1);
+    const int64_t m = x->shape_view().elem_cnt() / k;
+    const int64_t n = weight->shape_view().At(0);
+    auto matmul = NewFusedMatmulPrimitive(out->data_type());
+    CHECK(matmul);
+
+    const T* x_ptr = x->dptr<T>();
+    const T* bias_ptr = bias->dptr<T>();
+    T* out_ptr = out->mut_dptr<T>();
+    const int64_t block_rows = GetFusedMatmulBlockRows(m, n, sizeof(T));
+    for (int64_t row_begin = 0; row_begin < m; row_begin += block_rows) {
+      const int64_t row_end = std::min(row_begin + block_rows, m);
+      matmul->Launch(ctx->stream(), row_end - row_begin, n, k, alpha, x_ptr + row_begin * k,
+                     weight->dptr(), 0.0, out_ptr + row_begin * n);
+      ParallelForEachRow(ctx->stream(), row_begin, row_end, n, [&](int64_t row) {
+        T* out_row = out_ptr + row * n;
+        if (add_to_output == nullptr) {
+          for (int64_t col = 0; col < n; ++col) { out_row[col] += bias_ptr[col]; }
+        } else {
+          const T* add_to_output_row = add_to_output + row * n;
+          for (int64_t col = 0; col < n; ++col) {
+            out_row[col] += bias_ptr[col] + beta * add_to_output_row[col];
+          }
+        }
+      });
+    }
+  }
+
+  bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
+};
+
+#define REGISTER_FUSED_MATMUL_BIAS_KERNEL_CPU(cpp_type, data_type)    \
+  REGISTER_USER_KERNEL("fused_matmul_bias")                           \
+      .SetCreateFn<FusedMatmulBiasCpuKernel<cpp_type>>()              \
+      .SetIsMatchedHob((user_op::HobDeviceType() == DeviceType::kCPU) \
+                       && (user_op::HobDataType("out", 0) == data_type));
+
+REGISTER_FUSED_MATMUL_BIAS_KERNEL_CPU(float, DataType::kFloat);
+REGISTER_FUSED_MATMUL_BIAS_KERNEL_CPU(double, DataType::kDouble);
+
+}  // namespace
+
+}  // namespace oneflow
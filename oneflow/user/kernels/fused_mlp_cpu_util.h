@@ -0,0 +1,97 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_USER_KERNELS_FUSED_MLP_CPU_UTIL_H_
+#define ONEFLOW_USER_KERNELS_FUSED_MLP_CPU_UTIL_H_
+
+#include <algorithm>
+#include "oneflow/core/ep/cpu/cpu_stream.h"
+#include "oneflow/core/ep/include/primitive/matmul.h"
+#include "oneflow/core/framework/framework.h"
+
+namespace oneflow {
+
+// The fused matmul kernels on cpu compute the matmul in blocks of rows and apply the epilogue
+// (bias, activation, gating, ...) to each block right after it is computed, while the block is
+// still in the cache, instead of making another pass over the whole output.
+constexpr int64_t kFusedMatmulBlockBytes = 512 * 1024;
+constexpr int64_t kFusedMatmulMinBlockRows = 32;
+constexpr int64_t kFusedMatmulEpilogueGrain = 4096;
+
+// Returns the number of rows of a block whose output of (rows, n) fits in kFusedMatmulBlockBytes.
+inline int64_t GetFusedMatmulBlockRows(int64_t m, int64_t n, size_t size_of_data_type) {
+  const int64_t rows = kFusedMatmulBlockBytes / std::max<int64_t>(n * size_of_data_type, 1);
+  return std::max<int64_t>(std::min(m, std::max(rows, kFusedMatmulMinBlockRows)), 1);
+}
+
+// Creates the matmul primitive of x (m, k) and the transposed weight (n, k).
+inline std::unique_ptr<ep::primitive::Matmul> NewFusedMatmulPrimitive(DataType data_type) {
+  return ep::primitive::NewPrimitive<ep::primitive::MatmulFactory>(
+      DeviceType::kCPU, data_type, ep::primitive::BlasTransposeType::N,
+      ep::primitive::BlasTransposeType::T);
+}
+
+// Calls f(row) for the rows in [row_begin, row_end) on the threads of the cpu stream.
+template<typename F>
+void ParallelForEachRow(ep::Stream* stream, int64_t row_begin, int64_t row_end, int64_t cols,
+                        const F& f) {
+  const size_t grain =
+      std::max<int64_t>(kFusedMatmulEpilogueGrain / std::max<int64_t>(cols, 1), 1);
+  stream->As<ep::CpuStream>()->ParallelFor(
+      row_begin, row_end,
+      [&](int64_t begin, int64_t end) {
+        for (int64_t row = begin; row < end; ++row) { f(row); }
+      },
+      grain);
+}
+
+// Runs the layers of cublas_fused_mlp or fused_matmul_bias_add_relu_dropout for a block of rows
+// before moving on to the next block, so that the hidden states of a block are still in the cache
+// when the next layer reads them. epilogue(layer_idx, row_begin, row_end, n, y) is called after
+// the matmul of each layer, where y is the output of the layer.
+template<typename T, typename Epilogue>
+void LaunchFusedMLP(user_op::KernelComputeContext* ctx, const Epilogue& epilogue) {
+  const user_op::Tensor* x = ctx->Tensor4ArgNameAndIndex("x", 0);
+  user_op::Tensor* out = ctx->Tensor4ArgNameAndIndex("out", 0);
+  const int32_t weight_size = ctx->input_size("weights");
+  const int64_t m = x->shape_view().At(0);
+  int64_t max_n = 0;
+  for (int32_t idx = 0; idx < weight_size; ++idx) {
+    max_n = std::max(max_n, ctx->Tensor4ArgNameAndIndex("weights", idx)->shape_view().At(0));
+  }
+  auto matmul = NewFusedMatmulPrimitive(out->data_type());
+  CHECK(matmul);
+  const int64_t block_rows = GetFusedMatmulBlockRows(m, max_n, sizeof(T));
+  for (int64_t row_begin = 0; row_begin < m; row_begin += block_rows) {
+    const int64_t row_end = std::min(row_begin + block_rows, m);
+    const T* in = x->dptr<T>();
+    int64_t k = x->shape_view().At(1);
+    for (int32_t idx = 0; idx < weight_size; ++idx) {
+      const user_op::Tensor* weight = ctx->Tensor4ArgNameAndIndex("weights", idx);
+      const int64_t n = weight->shape_view().At(0);
+      T* y = (idx == weight_size - 1) ? out->mut_dptr<T>()
+                                      : ctx->Tensor4ArgNameAndIndex("hidden", idx)->mut_dptr<T>();
+      matmul->Launch(ctx->stream(), row_end - row_begin, n, k, 1.0, in + row_begin * k,
+                     weight->dptr(), 0.0, y + row_begin * n);
+      epilogue(idx, row_begin, row_end, n, y);
+      in = y;
+      k = n;
+    }
+  }
+}
+
+}  // namespace oneflow
+
+#endif  // ONEFLOW_USER_KERNELS_FUSED_MLP_CPU_UTIL_H_
@@ -18,6 +18,7 @@ limitations under the License.
 #include "oneflow/core/kernel/kernel_util.h"
 #include "oneflow/core/ep/include/primitive/add.h"
 #include "oneflow/core/ep/include/primitive/matmul.h"
+#include "oneflow/user/kernels/conv_cpu_util.h"
 
 namespace oneflow {
 
@@ -400,6 +401,9 @@ struct ConvOpKernelCache final : public user_op::OpKernelCache {
   int32_t idx_offset_ = 0;
   bool is_dynamic_ = false;
   int32_t groups = 1;
+
+  conv::CpuConvParams params_;
+  conv::CpuConvAlgo algo_ = conv::CpuConvAlgo::kIm2ColGemm;
 };
 
 template<typename T>
@@ -471,7 +475,11 @@ class ConvCpuKernel final : public user_op::OpKernel {
 
   std::shared_ptr<user_op::OpKernelCache> InitOpKernelCache(
       user_op::KernelCacheContext* ctx) const override {
-    return CreateConvOpKernelCache<T>(ctx, "in", "out", "weight");
+    auto cache = CreateConvOpKernelCache<T>(ctx, "in", "out", "weight");
+    cache->params_ = conv::MakeCpuConvParams(ctx, ctx->TensorDesc4ArgNameAndIndex("in", 0)->shape(),
+                                             ctx->TensorDesc4ArgNameAndIndex("out", 0)->shape());
+    cache->algo_ = conv::GetCpuConvAlgo(cache->params_);
+    return cache;
   }
 
  private:
@@ -484,8 +492,17 @@ class ConvCpuKernel final : public user_op::OpKernel {
     const user_op::Tensor* weight = ctx->Tensor4ArgNameAndIndex("weight", 0);
     user_op::Tensor* tmp_buffer = ctx->Tensor4ArgNameAndIndex("tmp_buffer", 0);
     user_op::Tensor* out = ctx->Tensor4ArgNameAndIndex("out", 0);
+    const user_op::Tensor* bias = ctx->Tensor4ArgNameAndIndex("bias", 0);
+
+    conv::CpuConvParams params = conv_cache->params_;
+    params.batch = in->shape_view().At(0);
+    if (conv_cache->algo_ == conv::CpuConvAlgo::kDirect) {
+      conv::CpuDirectConv<T>(ctx->stream(), params, in->dptr<T>(), weight->dptr<T>(),
+                             bias == nullptr ? nullptr : bias->dptr<T>(), static_cast<T>(0),
+                             out->mut_dptr<T>());
+      return;
+    }
 
-    T* col_buf_dptr = tmp_buffer->mut_dptr<T>();
     int32_t idx_offset = conv_cache->idx_offset_;
     const int32_t input_group_interval = in->shape_view().At(1) / conv_cache->groups;
     const int32_t weight_group_interval = weight->shape_view().At(0) / conv_cache->groups;
@@ -507,6 +524,23 @@ class ConvCpuKernel final : public user_op::OpKernel {
     }
     CHECK(matmul);
 
+    if (conv_cache->algo_ == conv::CpuConvAlgo::kGemm1x1) {
+      // out[g] = weight[g] * in[g], the col buffer of a 1x1 conv being the image itself
+      for (int64_t i = 0; i < in->shape_view().At(0); ++i) {
+        for (int64_t g = 0; g < conv_cache->groups; g++) {
+          matmul->Launch(ctx->stream(), m, n, k, static_cast<T>(1),
+                         weight->dptr<T>() + g * weight_step, GetImgDptr<T>(in, i) + g * input_step,
+                         static_cast<T>(0), GetImgMutDptr<T>(out, i) + g * output_step);
+        }
+      }
+      if (bias != nullptr) {
+        conv::CpuConvAddBias<T>(ctx->stream(), params.batch, params.out_channels,
+                                params.OutVolume(), bias->dptr<T>(), out->mut_dptr<T>());
+      }
+      return;
+    }
+
+    T* col_buf_dptr = tmp_buffer->mut_dptr<T>();
     for (int64_t i = 0; i < in->shape_view().At(0); ++i) {
       const T* input_ptr = GetImgDptr<T>(in, i);
       const T* weight_ptr = weight->dptr<T>();
@@ -530,7 +564,6 @@ class ConvCpuKernel final : public user_op::OpKernel {
         output_ptr += output_step;
       }
 
-      const user_op::Tensor* bias = ctx->Tensor4ArgNameAndIndex("bias", 0);
       if (bias != nullptr) {
         int64_t num_of_col_buf =
             CalcElemNumOfColBuf(out->shape_view(), weight->shape_view(), idx_offset);
@@ -568,6 +601,9 @@ class ConvCpuKernel final : public user_op::OpKernel {
         size_t tmp_buffer_size = 0;                                                         \
         const auto& out_shape = ctx->OutputTensorDesc("out", 0).shape();                    \
         const auto& weight_shape = ctx->InputTensorDesc("weight", 0).shape();               \
+        const auto params =                                                                 \
+            conv::MakeCpuConvParams(ctx, ctx->InputTensorDesc("in", 0).shape(), out_shape); \
+        if (conv::GetCpuConvAlgo(params) != conv::CpuConvAlgo::kIm2ColGemm) { return 0; }   \
                                                                                             \
         int64_t idx_offset = IdxOffset(ctx->Attr<std::string>("data_format"));              \
         tmp_buffer_size +=                                                                  \
@@ -0,0 +1,383 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/framework/framework.h"
+#include "oneflow/core/ep/cpu/cpu_stream.h"
+
+namespace oneflow {
+
+namespace {
+
+// Number of elements handled by a task, smaller problems are done on the calling thread since the
+// thread pool may not honor the grain size.
+constexpr int64_t kCpuGroupwiseQuantizationGrain = 32768;
+
+// A task of the quantized linear computes kQuantizedLinearBlockN columns of out for all the rows of
+// x. The weight rows are dequantized kQuantizedLinearTileK columns at a time into a tile that stays
+// in the L1 cache, so the quantized weight is read once and never expanded in memory.
+constexpr int64_t kQuantizedLinearBlockN = 16;
+constexpr int64_t kQuantizedLinearTileK = 256;
+
+// Returns the i-th quantized value of a row, 4 bit values are packed by pairs in a byte with the
+// first one in the high bits.
+template<typename U, int num_bits>
+int32_t LoadQuantized(const U* q, int64_t i) {
+  if (num_bits == 8) { return q[i]; }
+  const U packed = q[i / 2];
+  if (i % 2 == 0) { return packed >> 4; }
+  return static_cast<U>(packed << 4) >> 4;
+}
+
+template<typename T, typename U, int num_bits, bool symmetric>
+T GetGroupZero(T group_scale, const T* zero, int64_t offset) {
+  if (!symmetric) { return zero[offset]; }
+  if (std::is_same<U, uint8_t>::value) {
+    return -static_cast<T>((1 << (num_bits - 1)) - 1) * group_scale;
+  }
+  return 0;
+}
+
+template<typename T>
+T Dot(const T* a, const T* b, int64_t n) {
+  constexpr int64_t kNumLanes = 8;
+  T lanes[kNumLanes] = {};
+  int64_t i = 0;
+  for (; i + kNumLanes <= n; i += kNumLanes) {
+    for (int64_t j = 0; j < kNumLanes; ++j) { lanes[j] += a[i + j] * b[i + j]; }
+  }
+  T sum = 0;
+  for (; i < n; ++i) { sum += a[i] * b[i]; }
+  for (int64_t j = 0; j < kNumLanes; ++j) { sum += lanes[j]; }
+  return sum;
+}
+
+// The out is viewed as [outer_size, group_size, inner_size] where outer_size includes the number
+// of groups, the scale and zero as [outer_size, inner_size].
+template<typename T, typename U, int num_bits, bool symmetric>
+void Dequantize(ep::CpuStream* cpu_stream, int64_t outer_size, int64_t group_size,
+                int64_t inner_size, const U* in, const T* scale, const T* zero, T* out) {
+  const int64_t num_rows = outer_size * group_size;
+  auto dequantize_rows = [&](int64_t begin, int64_t end) {
+    for (int64_t row = begin; row < end; ++row) {
+      const int64_t scale_offset = row / group_size * inner_size;
+      const int64_t offset = row * inner_size;
+      for (int64_t i = 0; i < inner_size; ++i) {
+        const T group_scale = scale[scale_offset + i];
+        out[offset + i] =
+            static_cast<T>(LoadQuantized<U, num_bits>(in, offset + i)) * group_scale
+            + GetGroupZero<T, U, num_bits, symmetric>(group_scale, zero, scale_offset + i);
+      }
+    }
+  };
+  if (num_rows * inner_size <= kCpuGroupwiseQuantizationGrain) {
+    dequantize_rows(0, num_rows);
+  } else {
+    cpu_stream->ParallelFor(
+        0, num_rows, dequantize_rows,
+        std::max<int64_t>(kCpuGroupwiseQuantizationGrain / inner_size, 1));
+  }
+}
+
+template<typename T, typename U>
+void DispatchDequantize(ep::CpuStream* cpu_stream, int32_t num_bits, bool symmetric,
+                        int64_t outer_size, int64_t group_size, int64_t inner_size, const U* in,
+                        const T* scale, const T* zero, T* out) {
+  if (num_bits == 4) {
+    if (symmetric) {
+      Dequantize<T, U, 4, true>(cpu_stream, outer_size, group_size, inner_size, in, scale, zero,
+                                out);
+    } else {
+      Dequantize<T, U, 4, false>(cpu_stream, outer_size, group_size, inner_size, in, scale, zero,
+                                 out);
+    }
+  } else if (num_bits == 8) {
+    if (symmetric) {
+      Dequantize<T, U, 8, true>(cpu_stream, outer_size, group_size, inner_size, in, scale, zero,
+                                out);
+    } else {
+      Dequantize<T, U, 8, false>(cpu_stream, outer_size, group_size, inner_size, in, scale, zero,
+                                 out);
+    }
+  } else {
+    UNIMPLEMENTED();
+  }
+}
+
+template<typename T>
+class GroupwiseDequantizeKernel final : public user_op::OpKernel {
+ public:
+  GroupwiseDequantizeKernel() = default;
+  ~GroupwiseDequantizeKernel() override = default;
+
+ private:
+  using user_op::OpKernel::Compute;
+  void Compute(user_op::KernelComputeContext* ctx) const override {
+    const user_op::Tensor* in = ctx->Tensor4ArgNameAndIndex("in", 0);
+    const user_op::Tensor* scale = ctx->Tensor4ArgNameAndIndex("scale", 0);
+    const user_op::Tensor* zero = nullptr;
+    if (ctx->has_input("zero", 0)) { zero = ctx->Tensor4ArgNameAndIndex("zero", 0); }
+    user_op::Tensor* out = ctx->Tensor4ArgNameAndIndex("out", 0);
+    const int64_t group_size = ctx->Attr<int64_t>("group_size");
+    const int64_t group_dim = ctx->Attr<int64_t>("group_dim");
+    const int32_t num_bits = ctx->Attr<int32_t>("num_bits");
+    const bool symmetric = ctx->Attr<bool>("symmetric");
+    const int64_t num_in_axes = in->shape_view().NumAxes();
+    CHECK_GE(num_in_axes, 1);
+    CHECK_EQ(scale->shape_view().NumAxes(), num_in_axes);
+    if (zero != nullptr) { CHECK_EQ(zero->shape_view().NumAxes(), num_in_axes); }
+    CHECK_EQ(out->shape_view().NumAxes(), num_in_axes);
+    CHECK_GE(group_dim, 0);
+    CHECK_LT(group_dim, num_in_axes);
+    for (int i = 0; i < num_in_axes; ++i) {
+      if (i == num_in_axes - 1) {
+        CHECK_EQ(out->shape_view().At(i), in->shape_view().At(i) * (8 / num_bits));
+      } else {
+        CHECK_EQ(out->shape_view().At(i), in->shape_view().At(i));
+      }
+    }
+    const int64_t group_dim_size = out->shape_view().At(group_dim);
+    CHECK_GT(group_size, 0);
+    CHECK_LE(group_size, group_dim_size);
+    CHECK_EQ(group_dim_size % group_size, 0);
+    const int64_t num_groups = group_dim_size / group_size;
+    for (int i = 0; i < num_in_axes; ++i) {
+      const int64_t expected_dim_size = i == group_dim ? num_groups : out->shape_view().At(i);
+      CHECK_EQ(scale->shape_view().At(i), expected_dim_size);
+      if (zero != nullptr) { CHECK_EQ(zero->shape_view().At(i), expected_dim_size); }
+    }
+    const int64_t outer_size = out->shape_view().Count(0, group_dim) * num_groups;
+    const int64_t inner_size = out->shape_view().Count(group_dim + 1);
+    auto* cpu_stream = ctx->stream()->As<ep::CpuStream>();
+    if (in->data_type() == DataType::kUInt8) {
+      DispatchDequantize<T, uint8_t>(cpu_stream, num_bits, symmetric, outer_size, group_size,
+                                     inner_size, in->dptr<uint8_t>(), scale->dptr<T>(),
+                                     zero == nullptr ? nullptr : zero->dptr<T>(),
+                                     out->mut_dptr<T>());
+    } else if (in->data_type() == DataType::kInt8) {
+      DispatchDequantize<T, int8_t>(cpu_stream, num_bits, symmetric, outer_size, group_size,
+                                    inner_size, in->dptr<int8_t>(), scale->dptr<T>(),
+                                    zero == nullptr ? nullptr : zero->dptr<T>(),
+                                    out->mut_dptr<T>());
+    } else {
+      UNIMPLEMENTED();
+    }
+  }
+
+  bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
+};
+
+#define REGISTER_GROUPWISE_DEQUANTIZE_CPU_KERNEL(dtype)                                    \
+  REGISTER_USER_KERNEL("groupwise_dequantize")                                             \
+      .SetCreateFn<GroupwiseDequantizeKernel<dtype>>()                                     \
+      .SetIsMatchedHob((user_op::HobDeviceType() == DeviceType::kCPU)                      \
+                       && (user_op::HobDataType("scale", 0) == GetDataType<dtype>::value))
+
+REGISTER_GROUPWISE_DEQUANTIZE_CPU_KERNEL(float);
+
+// out[m, n] = sum_k x[m, k] * dequantized w[n, k] + b[n], the groups of w are along n when
+// group_dim is 0 and along k when group_dim is 1.
+template<typename T, typename U, int num_bits, bool symmetric>
+void QuantizedLinear(ep::CpuStream* cpu_stream, int64_t m, int64_t n, int64_t k, int64_t group_dim,
+                     int64_t group_size, const T* x, const U* w, const T* scale, const T* zero,
+                     const T* bias, T* out) {
+  const int64_t packed_k = k * num_bits / 8;
+  const int64_t num_groups_per_n = k / group_size;
+  const int64_t num_blocks = (n + kQuantizedLinearBlockN - 1) / kQuantizedLinearBlockN;
+  auto compute_blocks = [&](int64_t begin, int64_t end) {
+    std::vector<T> w_tile(kQuantizedLinearBlockN * kQuantizedLinearTileK);
+    std::vector<T> acc(m * kQuantizedLinearBlockN);
+    for (int64_t block = begin; block < end; ++block) {
+      const int64_t n_begin = block * kQuantizedLinearBlockN;
+      const int64_t block_n = std::min(kQuantizedLinearBlockN, n - n_begin);
+      std::fill(acc.begin(), acc.end(), static_cast<T>(0));
+      for (int64_t k_begin = 0; k_begin < k; k_begin += kQuantizedLinearTileK) {
+        const int64_t k_end = std::min(k_begin + kQuantizedLinearTileK, k);
+        for (int64_t j = 0; j < block_n; ++j) {
+          const int64_t row = n_begin + j;
+          const U* w_row = w + row * packed_k;
+          T* tile_row = w_tile.data() + j * kQuantizedLinearTileK - k_begin;
+          if (group_dim == 0) {
+            const int64_t scale_offset = row / group_size * k;
+            for (int64_t col = k_begin; col < k_end; ++col) {
+              const T group_scale = scale[scale_offset + col];
+              tile_row[col] =
+                  static_cast<T>(LoadQuantized<U, num_bits>(w_row, col)) * group_scale
+                  + GetGroupZero<T, U, num_bits, symmetric>(group_scale, zero, scale_offset + col);
+            }
+          } else {
+            for (int64_t col = k_begin; col < k_end;) {
+              const int64_t group_id = col / group_size;
+              const int64_t group_end = std::min(k_end, (group_id + 1) * group_size);
+              const int64_t scale_offset = row * num_groups_per_n + group_id;
+              const T group_scale = scale[scale_offset];
+              const T group_zero =
+                  GetGroupZero<T, U, num_bits, symmetric>(group_scale, zero, scale_offset);
+              for (; col < group_end; ++col) {
+                tile_row[col] =
+                    static_cast<T>(LoadQuantized<U, num_bits>(w_row, col)) * group_scale
+                    + group_zero;
+              }
+            }
+          }
+        }
+        for (int64_t i = 0; i < m; ++i) {
+          const T* x_tile = x + i * k + k_begin;
+          T* acc_row = acc.data() + i * kQuantizedLinearBlockN;
+          for (int64_t j = 0; j < block_n; ++j) {
+            acc_row[j] +=
+                Dot(x_tile, w_tile.data() + j * kQuantizedLinearTileK, k_end - k_begin);
+          }
+        }
+      }
+      for (int64_t i = 0; i < m; ++i) {
+        for (int64_t j = 0; j < block_n; ++j) {
+          const T b = bias == nullptr ? static_cast<T>(0) : bias[n_begin + j];
+          out[i * n + n_begin + j] = acc[i * kQuantizedLinearBlockN + j] + b;
+        }
+      }
+    }
+  };
+  if ((m + 1) * n * k <= kCpuGroupwiseQuantizationGrain) {
+    compute_blocks(0, num_blocks);
+  } else {
+    cpu_stream->ParallelFor(0, num_blocks, compute_blocks, 1);
+  }
+}
+
+template<typename T, typename U>
+void DispatchQuantizedLinear(ep::CpuStream* cpu_stream, int32_t num_bits, bool symmetric,
+                             int64_t m, int64_t n, int64_t k, int64_t group_dim,
+                             int64_t group_size, const T* x, const U* w, const T* scale,
+                             const T* zero, const T* bias, T* out) {
+  if (num_bits == 4) {
+    if (symmetric) {
+      QuantizedLinear<T, U, 4, true>(cpu_stream, m, n, k, group_dim, group_size, x, w, scale, zero,
+                                     bias, out);
+    } else {
+      QuantizedLinear<T, U, 4, false>(cpu_stream, m, n, k, group_dim, group_size, x, w, scale,
+                                      zero, bias, out);
+    }
+  } else if (num_bits == 8) {
+    if (symmetric) {
+      QuantizedLinear<T, U, 8, true>(cpu_stream, m, n, k, group_dim, group_size, x, w, scale, zero,
+                                     bias, out);
+    } else {
+      QuantizedLinear<T, U, 8, false>(cpu_stream, m, n, k, group_dim, group_size, x, w, scale,
+                                      zero, bias, out);
+    }
+  } else {
+    UNIMPLEMENTED();
+  }
+}
+
+template<typename T>
+class FusedLinearWithGroupwiseQuantizedWeightKernel final : public user_op::OpKernel {
+ public:
+  FusedLinearWithGroupwiseQuantizedWeightKernel() = default;
+  ~FusedLinearWithGroupwiseQuantizedWeightKernel() override = default;
+
+ private:
+  using user_op::OpKernel::Compute;
+  void Compute(user_op::KernelComputeContext* ctx) const override {
+    const user_op::Tensor* x = ctx->Tensor4ArgNameAndIndex("x", 0);
+    const user_op::Tensor* w = ctx->Tensor4ArgNameAndIndex("w", 0);
+    const user_op::Tensor* w_scale = ctx->Tensor4ArgNameAndIndex("w_scale", 0);
+    const user_op::Tensor* b =
+        (ctx->has_input("b", 0)) ? ctx->Tensor4ArgNameAndIndex("b", 0) : nullptr;
+    const user_op::Tensor* w_zero =
+        (ctx->has_input("w_zero", 0)) ? ctx->Tensor4ArgNameAndIndex("w_zero", 0) : nullptr;
+    user_op::Tensor* out = ctx->Tensor4ArgNameAndIndex("out", 0);
+    const DataType data_type = x->data_type();
+    CHECK_EQ(w_scale->data_type(), data_type);
+    CHECK_EQ(out->data_type(), data_type);
+    const int64_t group_size = ctx->Attr<int64_t>("group_size");
+    const int64_t group_dim = ctx->Attr<int64_t>("group_dim");
+    CHECK(group_dim == 0 || group_dim == 1);
+    const int32_t num_bits = ctx->Attr<int32_t>("num_bits");
+    const bool symmetric = ctx->Attr<bool>("symmetric");
+    CHECK_GE(x->shape_view().NumAxes(), 2);
+    const int64_t k = x->shape_view().At(x->shape_view().NumAxes() - 1);
+    const int64_t m = x->shape_view().elem_cnt() / k;
+    CHECK_EQ(w->shape_view().NumAxes(), 2);
+    if (num_bits == 4) {
+      CHECK_EQ(w->shape_view().At(1) * 2, k);
+    } else if (num_bits == 8) {
+      CHECK_EQ(w->shape_view().At(1), k);
+    } else {
+      UNIMPLEMENTED();
+    }
+    const int64_t n = w->shape_view().At(0);
+    const int64_t group_dim_size = group_dim == 0 ? n : k;
+    CHECK_GT(group_size, 0);
+    CHECK_LE(group_size, group_dim_size);
+    CHECK_EQ(group_dim_size % group_size, 0);
+    const int64_t num_groups = group_dim_size / group_size;
+    if (group_dim == 0) {
+      CHECK_EQ(w_scale->shape_view().At(0), num_groups);
+      CHECK_EQ(w_scale->shape_view().At(1), k);
+    } else {
+      CHECK_EQ(w_scale->shape_view().At(0), n);
+      CHECK_EQ(w_scale->shape_view().At(1), num_groups);
+    }
+    if (w_zero != nullptr) {
+      CHECK_EQ(w_zero->data_type(), data_type);
+      CHECK(w_zero->shape_view() == w_scale->shape_view());
+    }
+    if (b != nullptr) {
+      CHECK_EQ(b->data_type(), data_type);
+      CHECK_EQ(b->shape_view().NumAxes(), 1);
+      CHECK_EQ(b->shape_view().At(0), n);
+    }
+    CHECK_EQ(x->shape_view().NumAxes(), out->shape_view().NumAxes());
+    for (int i = 0; i < x->shape_view().NumAxes() - 1; ++i) {
+      CHECK_EQ(out->shape_view().At(i), x->shape_view().At(i));
+    }
+    CHECK_EQ(out->shape_view().At(out->shape_view().NumAxes() - 1), n);
+    if (symmetric) {
+      CHECK(w_zero == nullptr);
+    } else {
+      CHECK(w_zero != nullptr);
+    }
+    auto* cpu_stream = ctx->stream()->As<ep::CpuStream>();
+    const DataType quant_type = w->data_type();
+    if (quant_type == DataType::kUInt8) {
+      DispatchQuantizedLinear<T, uint8_t>(
+          cpu_stream, num_bits, symmetric, m, n, k, group_dim, group_size, x->dptr<T>(),
+          w->dptr<uint8_t>(), w_scale->dptr<T>(), w_zero == nullptr ? nullptr : w_zero->dptr<T>(),
+          b == nullptr ? nullptr : b->dptr<T>(), out->mut_dptr<T>());
+    } else if (quant_type == DataType::kInt8) {
+      DispatchQuantizedLinear<T, int8_t>(
+          cpu_stream, num_bits, symmetric, m, n, k, group_dim, group_size, x->dptr<T>(),
+          w->dptr<int8_t>(), w_scale->dptr<T>(), w_zero == nullptr ? nullptr : w_zero->dptr<T>(),
+          b == nullptr ? nullptr : b->dptr<T>(), out->mut_dptr<T>());
+    } else {
+      UNIMPLEMENTED();
+    }
+  }
+
+  bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
+};
+
+#define REGISTER_FUSED_LINEAR_WITH_GROUPWISE_QUANTIZED_WEIGHT_CPU_KERNEL(data_type, cpp_type) \
+  REGISTER_USER_KERNEL("fused_linear_with_groupwise_quantized_weight")                        \
+      .SetCreateFn<FusedLinearWithGroupwiseQuantizedWeightKernel<cpp_type>>()                 \
+      .SetIsMatchedHob((user_op::HobDeviceType() == DeviceType::kCPU)                         \
+                       && (user_op::HobDataType("out", 0) == data_type));
+
+REGISTER_FUSED_LINEAR_WITH_GROUPWISE_QUANTIZED_WEIGHT_CPU_KERNEL(DataType::kFloat, float);
+
+}  // namespace
+
+}  // namespace oneflow
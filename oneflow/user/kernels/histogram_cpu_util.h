@@ -0,0 +1,87 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_USER_KERNELS_HISTOGRAM_CPU_UTIL_H_
+#define ONEFLOW_USER_KERNELS_HISTOGRAM_CPU_UTIL_H_
+
+#include <algorithm>
+#include <vector>
+#include "oneflow/core/ep/cpu/cpu_stream.h"
+
+namespace oneflow {
+
+namespace histogram {
+
+// Number of elements handled by a task, smaller problems are done on the calling thread since the
+// thread pool may not honor the grain size.
+constexpr int64_t kCpuGrain = 32768;
+
+// Bins are computed a block at a time so that the loop of the caller over a block has no
+// dependency on the counts and can be vectorized.
+constexpr int64_t kCpuBlockSize = 256;
+
+// Adds to counts[b] the number of the n elements whose bin is b. get_bins(begin, end, bins)
+// writes the bins of the elements [begin, end) to bins[0, end - begin), every bin must be in
+// [0, num_bins). It is called on blocks of at most kCpuBlockSize elements, from several threads
+// at a time. Every task counts into a private array and the arrays are summed at the end; the
+// number of tasks is bounded so that summing them costs no more than counting, which keeps the
+// histogram serial when the bins outnumber the elements.
+template<typename C, typename GetBins>
+void CpuHistogram(ep::Stream* stream, const int64_t n, const int64_t num_bins,
+                  const GetBins& get_bins, C* counts) {
+  auto CountRange = [&](int64_t begin, int64_t end, auto* partial) {
+    int32_t bins[kCpuBlockSize];
+    for (int64_t i = begin; i < end; i += kCpuBlockSize) {
+      const int64_t block_size = std::min(kCpuBlockSize, end - i);
+      get_bins(i, i + block_size, bins);
+      for (int64_t j = 0; j < block_size; ++j) { partial[bins[j]] += 1; }
+    }
+  };
+  auto* cpu_stream = stream->As<ep::CpuStream>();
+  const int64_t num_threads = static_cast<int64_t>(cpu_stream->device()->GetNumThreads());
+  const int64_t num_tasks = std::min(num_threads, n / std::max(kCpuGrain, num_bins));
+  if (num_tasks <= 1) {
+    CountRange(0, n, counts);
+    return;
+  }
+  std::vector<int64_t> partials(num_tasks * num_bins, 0);
+  cpu_stream->ParallelFor(
+      0, num_tasks,
+      [&](int64_t begin, int64_t end) {
+        for (int64_t task = begin; task < end; ++task) {
+          CountRange(n * task / num_tasks, n * (task + 1) / num_tasks,
+                     partials.data() + task * num_bins);
+        }
+      },
+      1);
+  auto SumPartials = [&](int64_t begin, int64_t end) {
+    for (int64_t task = 0; task < num_tasks; ++task) {
+      const int64_t* partial = partials.data() + task * num_bins;
+      for (int64_t b = begin; b < end; ++b) { counts[b] += partial[b]; }
+    }
+  };
+  if (num_tasks * num_bins < kCpuGrain) {
+    SumPartials(0, num_bins);
+  } else {
+    cpu_stream->ParallelFor(0, num_bins, SumPartials,
+                            std::max<int64_t>(kCpuGrain / num_tasks, 1));
+  }
+}
+
+}  // namespace histogram
+
+}  // namespace oneflow
+
+#endif  // ONEFLOW_USER_KERNELS_HISTOGRAM_CPU_UTIL_H_
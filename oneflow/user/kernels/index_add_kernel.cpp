@@ -15,24 +15,32 @@ limitations under the License.
 */
 #include "oneflow/core/framework/framework.h"
 #include "oneflow/core/kernel/new_kernel_util.h"
+#include "oneflow/user/kernels/scatter_add_cpu_util.h"
 
 namespace oneflow {
 
 namespace {
+
+// The source is viewed as [outer_size, source_dim, stride] and the output as
+// [outer_size, output_dim, stride], row (i, j) of the source is added to row (i, index[j]).
 template<typename T, typename IndexT>
-void index_add_cpu_kernel(const int64_t n, const T* input, const IndexT* index, const T* source,
-                          T* output, const int64_t stride, const int64_t source_dim,
-                          const int64_t delta, const float alpha) {
-  const int64_t stride_source_dim = stride * source_dim;
-  for (int i = 0; i < n; i++) {
-    int64_t pre_index = i / stride_source_dim;
-    int64_t dim_index = (i - pre_index * stride_source_dim) / stride;
-    IndexT source_dim_idx = index[dim_index];
-    int64_t output_index = i + (delta * pre_index + source_dim_idx - dim_index) * stride;
-    output[output_index] += static_cast<T>(alpha) * source[i];
-  }
+void index_add_cpu_kernel(ep::Stream* stream, const int64_t n, const IndexT* index,
+                          const T* source, T* output, const int64_t stride,
+                          const int64_t source_dim, const int64_t output_dim, const float alpha) {
+  if (n == 0) { return; }
+  const int64_t outer_size = n / (stride * source_dim);
+  auto GetDstRow = [&](int64_t row) -> int64_t {
+    const int64_t outer_idx = row / source_dim;
+    const IndexT idx = index[row - outer_idx * source_dim];
+    CHECK(idx >= 0 && idx < output_dim)
+        << "index " << idx << " is out of bounds for dimension with size " << output_dim;
+    return outer_idx * output_dim + idx;
+  };
+  scatter_add::CpuScatterAddRows(stream, outer_size * source_dim, stride, outer_size * output_dim,
+                                 GetDstRow, source, static_cast<T>(alpha), output);
 }
-};  // namespace
+
+}  // namespace
 
 template<typename T>
 class IndexAddCpuKernel final : public user_op::OpKernel {
@@ -54,18 +62,18 @@ class IndexAddCpuKernel final : public user_op::OpKernel {
     std::vector<int64_t> input_stride(input->stride().begin(), input->stride().end());
     const int64_t stride = input_stride[dim];
     const int64_t source_dim = source_shape.At(dim);
-    const int64_t delta = input_shape.At(dim) - source_dim;
+    const int64_t output_dim = input_shape.At(dim);
     DataType index_dtype = index->data_type();
-    const int32_t n = source->shape_view().elem_cnt();
+    const int64_t n = source->shape_view().elem_cnt();
     Memcpy<DeviceType::kCPU>(
         ctx->stream(), output->mut_dptr<void>(), input->dptr<void>(),
         input->shape_view().elem_cnt() * GetSizeOfDataType(input->data_type()));
     if (GetSizeOfDataType(index_dtype) == 4) {
-      index_add_cpu_kernel(n, input->dptr<T>(), index->dptr<int32_t>(), source->dptr<T>(),
-                           output->mut_dptr<T>(), stride, source_dim, delta, alpha);
+      index_add_cpu_kernel(ctx->stream(), n, index->dptr<int32_t>(), source->dptr<T>(),
+                           output->mut_dptr<T>(), stride, source_dim, output_dim, alpha);
     } else {
-      index_add_cpu_kernel(n, input->dptr<T>(), index->dptr<int64_t>(), source->dptr<T>(),
-                           output->mut_dptr<T>(), stride, source_dim, delta, alpha);
+      index_add_cpu_kernel(ctx->stream(), n, index->dptr<int64_t>(), source->dptr<T>(),
+                           output->mut_dptr<T>(), stride, source_dim, output_dim, alpha);
     }
   }
   bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
@@ -13,7 +13,9 @@ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
 See the License for the specific language governing permissions and
 limitations under the License.
 */
+#include <cmath>
 #include "oneflow/core/framework/framework.h"
+#include "oneflow/user/kernels/layer_norm_cpu_util.h"
 
 namespace oneflow {
 
@@ -25,13 +27,50 @@ class LayerNormCpuKernel final : public user_op::OpKernel {
 
  private:
   bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
-  void Compute(user_op::KernelComputeContext* ctx) const override { TODO(); };
+  void Compute(user_op::KernelComputeContext* ctx) const override {
+    const user_op::Tensor* x = ctx->Tensor4ArgNameAndIndex("x", 0);
+    user_op::Tensor* y = ctx->Tensor4ArgNameAndIndex("y", 0);
+    user_op::Tensor* mean = ctx->Tensor4ArgNameAndIndex("mean", 0);
+    user_op::Tensor* inv_variance = ctx->Tensor4ArgNameAndIndex("inv_variance", 0);
+    const T epsilon = static_cast<T>(ctx->Attr<double>("epsilon"));
+    const int64_t num_instances = mean->shape_view().elem_cnt();
+    const int64_t norm_size = x->shape_view().elem_cnt() / num_instances;
+    const T* gamma_ptr = nullptr;
+    const T* beta_ptr = nullptr;
+    if (ctx->has_input("gamma", 0)) {
+      const user_op::Tensor* gamma = ctx->Tensor4ArgNameAndIndex("gamma", 0);
+      gamma_ptr = gamma->dptr<T>();
+      CHECK_EQ(gamma->shape_view().elem_cnt(), norm_size);
+    }
+    if (ctx->has_input("beta", 0)) { beta_ptr = ctx->Tensor4ArgNameAndIndex("beta", 0)->dptr<T>(); }
+    const T* x_ptr = x->dptr<T>();
+    T* y_ptr = y->mut_dptr<T>();
+    T* mean_ptr = mean->mut_dptr<T>();
+    T* inv_variance_ptr = inv_variance->mut_dptr<T>();
+    layer_norm::CpuParallelForEachRow(ctx->stream(), num_instances, norm_size, [&](int64_t row) {
+      const T* x_row = x_ptr + row * norm_size;
+      T* y_row = y_ptr + row * norm_size;
+      T row_mean = 0;
+      T row_variance = 0;
+      layer_norm::CpuWelford(x_row, norm_size, &row_mean, &row_variance);
+      const T row_inv_variance = static_cast<T>(1) / std::sqrt(row_variance + epsilon);
+      mean_ptr[row] = row_mean;
+      inv_variance_ptr[row] = row_inv_variance;
+      // The affine transform is applied in the same pass as the normalization.
+      for (int64_t col = 0; col < norm_size; ++col) {
+        T normalized = (x_row[col] - row_mean) * row_inv_variance;
+        if (gamma_ptr != nullptr) { normalized *= gamma_ptr[col]; }
+        if (beta_ptr != nullptr) { normalized += beta_ptr[col]; }
+        y_row[col] = normalized;
+      }
+    });
+  }
 };
 
-#define REGISTER_LAYER_NORM_CPU_KERNEL(dtype)                         \
-  REGISTER_USER_KERNEL("layer_norm")                                  \
-      .SetCreateFn<LayerNormCpuKernel<dtype>>()                       \
-      .SetIsMatchedHob((user_op::HobDeviceType() == DeviceType::kCPU) \
+#define REGISTER_LAYER_NORM_CPU_KERNEL(dtype)                                           \
+  REGISTER_USER_KERNEL("layer_norm")                                                    \
+      .SetCreateFn<LayerNormCpuKernel<dtype>>()                                         \
+      .SetIsMatchedHob((user_op::HobDeviceType() == DeviceType::kCPU)                   \
                        && (user_op::HobDataType("x", 0) == GetDataType<dtype>::value));
 
 REGISTER_LAYER_NORM_CPU_KERNEL(float)
@@ -45,14 +84,81 @@ class LayerNormGradCpuKernel final : public user_op::OpKernel {
 
  private:
   bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
-  void Compute(user_op::KernelComputeContext* ctx) const override { TODO(); };
+  void Compute(user_op::KernelComputeContext* ctx) const override {
+    const user_op::Tensor* dy = ctx->Tensor4ArgNameAndIndex("dy", 0);
+    const user_op::Tensor* x = ctx->Tensor4ArgNameAndIndex("x", 0);
+    const user_op::Tensor* mean = ctx->Tensor4ArgNameAndIndex("mean", 0);
+    const user_op::Tensor* inv_variance = ctx->Tensor4ArgNameAndIndex("inv_variance", 0);
+    user_op::Tensor* dx = ctx->Tensor4ArgNameAndIndex("dx", 0);
+    const int64_t num_instances = mean->shape_view().elem_cnt();
+    const int64_t norm_size = x->shape_view().elem_cnt() / num_instances;
+    const T* gamma_ptr = nullptr;
+    if (ctx->has_input("gamma", 0)) {
+      gamma_ptr = ctx->Tensor4ArgNameAndIndex("gamma", 0)->dptr<T>();
+    }
+    const T* add_to_output_ptr = nullptr;
+    if (ctx->has_input("_add_to_output", 0)) {
+      const user_op::Tensor* add_to_output = ctx->Tensor4ArgNameAndIndex("_add_to_output", 0);
+      CHECK_EQ(add_to_output->data_type(), dx->data_type());
+      CHECK_EQ(add_to_output->shape_view(), dx->shape_view());
+      add_to_output_ptr = add_to_output->dptr<T>();
+    }
+    const T* dy_ptr = dy->dptr<T>();
+    const T* x_ptr = x->dptr<T>();
+    const T* mean_ptr = mean->dptr<T>();
+    const T* inv_variance_ptr = inv_variance->dptr<T>();
+    T* dx_ptr = dx->mut_dptr<T>();
+    layer_norm::CpuParallelForEachRow(ctx->stream(), num_instances, norm_size, [&](int64_t row) {
+      const int64_t offset = row * norm_size;
+      const T row_mean = mean_ptr[row];
+      const T row_inv_variance = inv_variance_ptr[row];
+      T lane_sum_dy[layer_norm::kCpuLanes] = {};
+      T lane_sum_dy_x_hat[layer_norm::kCpuLanes] = {};
+      for (int64_t col_begin = 0; col_begin < norm_size; col_begin += layer_norm::kCpuLanes) {
+        const int64_t num_lanes = std::min(layer_norm::kCpuLanes, norm_size - col_begin);
+        for (int64_t lane = 0; lane < num_lanes; ++lane) {
+          const int64_t col = col_begin + lane;
+          const T scaled_dy = gamma_ptr == nullptr ? dy_ptr[offset + col]
+                                                   : dy_ptr[offset + col] * gamma_ptr[col];
+          const T x_hat = (x_ptr[offset + col] - row_mean) * row_inv_variance;
+          lane_sum_dy[lane] += scaled_dy;
+          lane_sum_dy_x_hat[lane] += scaled_dy * x_hat;
+        }
+      }
+      T sum_dy = 0;
+      T sum_dy_x_hat = 0;
+      for (int64_t lane = 0; lane < layer_norm::kCpuLanes; ++lane) {
+        sum_dy += lane_sum_dy[lane];
+        sum_dy_x_hat += lane_sum_dy_x_hat[lane];
+      }
+      const T inv_norm_size = static_cast<T>(1) / static_cast<T>(norm_size);
+      const T mean_dy = sum_dy * inv_norm_size;
+      const T mean_dy_x_hat = sum_dy_x_hat * inv_norm_size;
+      for (int64_t col = 0; col < norm_size; ++col) {
+        const T scaled_dy = gamma_ptr == nullptr ? dy_ptr[offset + col]
+                                                 : dy_ptr[offset + col] * gamma_ptr[col];
+        const T x_hat = (x_ptr[offset + col] - row_mean) * row_inv_variance;
+        T dx_value = (scaled_dy - mean_dy - x_hat * mean_dy_x_hat) * row_inv_variance;
+        if (add_to_output_ptr != nullptr) { dx_value += add_to_output_ptr[offset + col]; }
+        dx_ptr[offset + col] = dx_value;
+      }
+    });
+  }
 };
 
-#define REGISTER_LAYER_NORM_GRAD_CPU_KERNEL(dtype)                    \
-  REGISTER_USER_KERNEL("layer_norm_grad")                             \
-      .SetCreateFn<LayerNormGradCpuKernel<dtype>>()                   \
-      .SetIsMatchedHob((user_op::HobDeviceType() == DeviceType::kCPU) \
-                       && (user_op::HobDataType("dy", 0) == GetDataType<dtype>::value));
+#define REGISTER_LAYER_NORM_GRAD_CPU_KERNEL(dtype)                                         \
+  REGISTER_USER_KERNEL("layer_norm_grad")                                                  \
+      .SetCreateFn<LayerNormGradCpuKernel<dtype>>()                                        \
+      .SetIsMatchedHob((user_op::HobDeviceType() == DeviceType::kCPU)                      \
+                       && (user_op::HobDataType("dy", 0) == GetDataType<dtype>::value))    \
+      .SetInplaceProposalFn(                                                               \
+          [](const user_op::InferContext& ctx,                                             \
+             const user_op::AddInplaceArgPair& AddInplaceArgPairFn) -> Maybe<void> {       \
+            if (ctx.has_input("_add_to_output", 0)) {                                      \
+              OF_RETURN_IF_ERROR(AddInplaceArgPairFn("dx", 0, "_add_to_output", 0, true)); \
+            }                                                                              \
+            return Maybe<void>::Ok();                                                      \
+          });
 
 REGISTER_LAYER_NORM_GRAD_CPU_KERNEL(float)
 REGISTER_LAYER_NORM_GRAD_CPU_KERNEL(double)
@@ -65,14 +171,56 @@ class LayerNormParamGradCpuKernel final : public user_op::OpKernel {
 
  private:
   bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
-  void Compute(user_op::KernelComputeContext* ctx) const override { TODO(); };
+  void Compute(user_op::KernelComputeContext* ctx) const override {
+    const user_op::Tensor* dy = ctx->Tensor4ArgNameAndIndex("dy", 0);
+    const user_op::Tensor* x = ctx->Tensor4ArgNameAndIndex("x", 0);
+    const user_op::Tensor* mean = ctx->Tensor4ArgNameAndIndex("mean", 0);
+    const user_op::Tensor* inv_variance = ctx->Tensor4ArgNameAndIndex("inv_variance", 0);
+    user_op::Tensor* tmp_buffer = ctx->Tensor4ArgNameAndIndex("tmp_buffer", 0);
+    const int64_t num_instances = mean->shape_view().elem_cnt();
+    const int64_t norm_size = x->shape_view().elem_cnt() / num_instances;
+    T* grads[2] = {nullptr, nullptr};
+    if (ctx->has_output("gamma_diff", 0)) {
+      grads[0] = ctx->Tensor4ArgNameAndIndex("gamma_diff", 0)->mut_dptr<T>();
+    }
+    if (ctx->has_output("beta_diff", 0)) {
+      grads[1] = ctx->Tensor4ArgNameAndIndex("beta_diff", 0)->mut_dptr<T>();
+    }
+    const T* dy_ptr = dy->dptr<T>();
+    const T* x_ptr = x->dptr<T>();
+    const T* mean_ptr = mean->dptr<T>();
+    const T* inv_variance_ptr = inv_variance->dptr<T>();
+    layer_norm::CpuParamGradReduce(
+        ctx->stream(), num_instances, norm_size, 2, tmp_buffer->mut_dptr<T>(),
+        [&](int64_t row, T* sums) {
+          const int64_t offset = row * norm_size;
+          const T row_mean = mean_ptr[row];
+          const T row_inv_variance = inv_variance_ptr[row];
+          T* gamma_sums = sums;
+          T* beta_sums = sums + norm_size;
+          for (int64_t col = 0; col < norm_size; ++col) {
+            const T dy_value = dy_ptr[offset + col];
+            gamma_sums[col] += dy_value * (x_ptr[offset + col] - row_mean) * row_inv_variance;
+            beta_sums[col] += dy_value;
+          }
+        },
+        grads);
+  }
 };
 
-#define REGISTER_LAYER_NORM_PARAM_GRAD_CPU_KERNEL(dtype)              \
-  REGISTER_USER_KERNEL("layer_norm_param_grad")                       \
-      .SetCreateFn<LayerNormParamGradCpuKernel<dtype>>()              \
-      .SetIsMatchedHob((user_op::HobDeviceType() == DeviceType::kCPU) \
-                       && (user_op::HobDataType("dy", 0) == GetDataType<dtype>::value));
+#define REGISTER_LAYER_NORM_PARAM_GRAD_CPU_KERNEL(dtype)                                \
+  REGISTER_USER_KERNEL("layer_norm_param_grad")                                         \
+      .SetCreateFn<LayerNormParamGradCpuKernel<dtype>>()                                \
+      .SetIsMatchedHob((user_op::HobDeviceType() == DeviceType::kCPU)                   \
+                       && (user_op::HobDataType("dy", 0) == GetDataType<dtype>::value)) \
+      .SetInferTmpSizeFn([](user_op::InferContext* ctx) {                               \
+        const int64_t begin_params_axis = ctx->Attr<int64_t>("begin_params_axis");      \
+        const auto& dy = ctx->InputTensorDesc("dy", 0);                                 \
+        const int64_t num_instances = dy.shape().Count(0, begin_params_axis);           \
+        const int64_t norm_size = dy.shape().Count(begin_params_axis);                  \
+        return layer_norm::GetCpuParamGradPartialsSize(num_instances, norm_size, 2)     \
+               * sizeof(dtype);                                                         \
+      });
 
 REGISTER_LAYER_NORM_PARAM_GRAD_CPU_KERNEL(float)
 REGISTER_LAYER_NORM_PARAM_GRAD_CPU_KERNEL(double)
@@ -0,0 +1,152 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_USER_KERNELS_LAYER_NORM_CPU_UTIL_H_
+#define ONEFLOW_USER_KERNELS_LAYER_NORM_CPU_UTIL_H_
+
+#include <algorithm>
+#include "oneflow/core/ep/cpu/cpu_stream.h"
+
+namespace oneflow {
+
+namespace layer_norm {
+
+// Number of elements processed by a task of the cpu layer_norm and rms_norm kernels.
+constexpr int64_t kCpuGrain = 32768;
+
+// Number of interleaved accumulators of the per-row reductions. The accumulators are
+// independent, so the compiler can keep them in the lanes of a vector register.
+constexpr int64_t kCpuLanes = 8;
+
+// The param grad kernels sum the rows in at most kCpuMaxParamGradPartials partial sums before
+// reducing the partial sums, so the result doesn't depend on the number of threads.
+constexpr int64_t kCpuMaxParamGradPartials = 64;
+
+// Calls f(row) for the num_rows rows of norm_size elements on the threads of the cpu stream.
+template<typename F>
+void CpuParallelForEachRow(ep::Stream* stream, int64_t num_rows, int64_t norm_size, const F& f) {
+  stream->As<ep::CpuStream>()->ParallelFor(
+      0, num_rows,
+      [&](int64_t begin, int64_t end) {
+        for (int64_t row = begin; row < end; ++row) { f(row); }
+      },
+      std::max<int64_t>(kCpuGrain / std::max<int64_t>(norm_size, 1), 1));
+}
+
+// Computes the mean and the biased variance of x[0, n) in a single pass with Welford's
+// algorithm, each lane accumulating every kCpuLanes-th element before the lanes are merged.
+template<typename T>
+void CpuWelford(const T* x, int64_t n, T* mean, T* variance) {
+  T lane_mean[kCpuLanes] = {};
+  T lane_m2[kCpuLanes] = {};
+  int64_t lane_count = 0;
+  const int64_t lanes_end = n / kCpuLanes * kCpuLanes;
+  for (int64_t i = 0; i < lanes_end; i += kCpuLanes) {
+    lane_count += 1;
+    const T inv_count = static_cast<T>(1) / static_cast<T>(lane_count);
+    for (int64_t lane = 0; lane < kCpuLanes; ++lane) {
+      const T delta = x[i + lane] - lane_mean[lane];
+      lane_mean[lane] += delta * inv_count;
+      lane_m2[lane] += delta * (x[i + lane] - lane_mean[lane]);
+    }
+  }
+  T m = 0;
+  T m2 = 0;
+  int64_t count = 0;
+  auto merge = [&](T b_mean, T b_m2, int64_t b_count) {
+    if (b_count == 0) { return; }
+    const int64_t new_count = count + b_count;
+    const T b_weight = static_cast<T>(b_count) / static_cast<T>(new_count);
+    const T delta = b_mean - m;
+    m += delta * b_weight;
+    m2 += b_m2 + delta * delta * static_cast<T>(count) * b_weight;
+    count = new_count;
+  };
+  for (int64_t lane = 0; lane < kCpuLanes; ++lane) {
+    merge(lane_mean[lane], lane_m2[lane], lane_count);
+  }
+  for (int64_t i = lanes_end; i < n; ++i) { merge(x[i], 0, 1); }
+  *mean = m;
+  *variance = m2 / static_cast<T>(n);
+}
+
+inline int64_t GetCpuParamGradPartialRows(int64_t num_rows, int64_t norm_size) {
+  const int64_t rows = std::max<int64_t>(kCpuGrain / std::max<int64_t>(norm_size, 1), 1);
+  return std::max(rows, (num_rows + kCpuMaxParamGradPartials - 1) / kCpuMaxParamGradPartials);
+}
+
+// Returns the number of elements of the partial sums of CpuParamGradReduce.
+inline int64_t GetCpuParamGradPartialsSize(int64_t num_rows, int64_t norm_size,
+                                           int64_t num_grads) {
+  const int64_t partial_rows = GetCpuParamGradPartialRows(num_rows, norm_size);
+  return (num_rows + partial_rows - 1) / partial_rows * num_grads * norm_size;
+}
+
+// Sums num_grads per-column param grads over the rows. accumulate_row(row, sums) adds the
+// contribution of a row to sums, which holds num_grads rows of norm_size elements. Each block of
+// rows is accumulated into its own partial sums in parallel, then the partial sums are reduced
+// column-wise into grads[i], skipping the null ones.
+template<typename T, typename F>
+void CpuParamGradReduce(ep::Stream* stream, int64_t num_rows, int64_t norm_size, int64_t num_grads,
+                        T* partials, const F& accumulate_row, T* const* grads) {
+  auto* cpu_stream = stream->As<ep::CpuStream>();
+  const int64_t partial_rows = GetCpuParamGradPartialRows(num_rows, norm_size);
+  const int64_t num_partials = (num_rows + partial_rows - 1) / partial_rows;
+  const int64_t partial_size = num_grads * norm_size;
+  if (num_partials == 0) {
+    for (int64_t grad = 0; grad < num_grads; ++grad) {
+      T* out = grads[grad];
+      if (out != nullptr) { std::fill(out, out + norm_size, static_cast<T>(0)); }
+    }
+    return;
+  }
+  cpu_stream->ParallelFor(
+      0, num_partials,
+      [&](int64_t begin, int64_t end) {
+        for (int64_t partial = begin; partial < end; ++partial) {
+          T* sums = partials + partial * partial_size;
+          std::fill(sums, sums + partial_size, static_cast<T>(0));
+          const int64_t row_end = std::min((partial + 1) * partial_rows, num_rows);
+          for (int64_t row = partial * partial_rows; row < row_end; ++row) {
+            accumulate_row(row, sums);
+          }
+        }
+      },
+      1);
+  cpu_stream->ParallelFor(
+      0, partial_size,
+      [&](int64_t begin, int64_t end) {
+        for (int64_t grad = 0; grad < num_grads; ++grad) {
+          T* out = grads[grad];
+          if (out == nullptr) { continue; }
+          const int64_t col_begin = std::max(begin, grad * norm_size) - grad * norm_size;
+          const int64_t col_end = std::min(end, (grad + 1) * norm_size) - grad * norm_size;
+          if (col_begin >= col_end) { continue; }
+          std::copy(partials + grad * norm_size + col_begin,
+                    partials + grad * norm_size + col_end, out + col_begin);
+          for (int64_t partial = 1; partial < num_partials; ++partial) {
+            const T* sums = partials + partial * partial_size + grad * norm_size;
+            for (int64_t col = col_begin; col < col_end; ++col) { out[col] += sums[col]; }
+          }
+        }
+      },
+      std::max<int64_t>(kCpuGrain / std::max<int64_t>(num_partials, 1), 1));
+}
+
+}  // namespace layer_norm
+
+}  // namespace oneflow
+
+#endif  // ONEFLOW_USER_KERNELS_LAYER_NORM_CPU_UTIL_H_
@@ -15,19 +15,101 @@ limitations under the License.
 */
 #include "oneflow/core/framework/framework.h"
 #include "oneflow/core/kernel/new_kernel_util.h"
-#include "oneflow/core/ep/cuda/cuda_stream.h"
+#include "oneflow/core/ep/cpu/cpu_stream.h"
 
 namespace oneflow {
 
 namespace {
 
+constexpr int64_t kBlockSize = sizeof(uint64_t) * 8;
+
+// Number of IoU evaluations handled by a task, smaller problems are done on the calling thread
+// since the thread pool may not honor the grain size.
+constexpr int64_t kCpuNmsGrain = 32768;
+
+int64_t GetNumBlocks(int64_t num_boxes) { return (num_boxes + kBlockSize - 1) / kBlockSize; }
+
+// Boxes of an instance stored as separate coordinate arrays, padded to a whole number of blocks,
+// so that the IoUs of a box with a block of boxes are computed by a vectorized loop.
+template<typename T>
+struct BoxesSoA {
+  T* x1;
+  T* y1;
+  T* x2;
+  T* y2;
+  T* area;
+};
+
 template<typename T>
-__inline__ T IoU(T const* const a, T const* const b) {
-  T interS = std::max(std::min(a[2], b[2]) - std::max(a[0], b[0]), static_cast<T>(0.f))
-             * std::max(std::min(a[3], b[3]) - std::max(a[1], b[1]), static_cast<T>(0.f));
-  T Sa = (a[2] - a[0]) * (a[3] - a[1]);
-  T Sb = (b[2] - b[0]) * (b[3] - b[1]);
-  return interS / (Sa + Sb - interS);
+BoxesSoA<T> LoadBoxes(const T* boxes, int64_t num_boxes, T* buffer) {
+  const int64_t padded_size = GetNumBlocks(num_boxes) * kBlockSize;
+  BoxesSoA<T> soa{buffer, buffer + padded_size, buffer + 2 * padded_size, buffer + 3 * padded_size,
+                  buffer + 4 * padded_size};
+  for (int64_t i = 0; i < padded_size; ++i) {
+    if (i < num_boxes) {
+      soa.x1[i] = boxes[i * 4 + 0];
+      soa.y1[i] = boxes[i * 4 + 1];
+      soa.x2[i] = boxes[i * 4 + 2];
+      soa.y2[i] = boxes[i * 4 + 3];
+      soa.area[i] = (soa.x2[i] - soa.x1[i]) * (soa.y2[i] - soa.y1[i]);
+    } else {
+      soa.x1[i] = soa.y1[i] = soa.x2[i] = soa.y2[i] = soa.area[i] = static_cast<T>(0);
+    }
+  }
+  return soa;
+}
+
+// Returns the bit mask of the boxes [block * kBlockSize, (block + 1) * kBlockSize) whose IoU with
+// box i is above iou_threshold.
+template<typename T>
+uint64_t SuppressionMask(const BoxesSoA<T>& soa, int64_t i, int64_t block, T iou_threshold) {
+  const T ax1 = soa.x1[i], ay1 = soa.y1[i], ax2 = soa.x2[i], ay2 = soa.y2[i], a_area = soa.area[i];
+  const int64_t offset = block * kBlockSize;
+  const T* bx1 = soa.x1 + offset;
+  const T* by1 = soa.y1 + offset;
+  const T* bx2 = soa.x2 + offset;
+  const T* by2 = soa.y2 + offset;
+  const T* b_area = soa.area + offset;
+  uint8_t over[kBlockSize];
+  for (int64_t j = 0; j < kBlockSize; ++j) {
+    const T inter = std::max(std::min(ax2, bx2[j]) - std::max(ax1, bx1[j]), static_cast<T>(0))
+                    * std::max(std::min(ay2, by2[j]) - std::max(ay1, by1[j]), static_cast<T>(0));
+    over[j] = inter / (a_area + b_area[j] - inter) > iou_threshold;
+  }
+  // pack 8 flags at a time, the multiplication moves the lowest bit of each byte to the top byte
+  uint64_t mask = 0;
+  for (int64_t k = 0; k < kBlockSize / 8; ++k) {
+    uint64_t bytes = 0;
+    for (int64_t b = 0; b < 8; ++b) { bytes |= static_cast<uint64_t>(over[k * 8 + b]) << (8 * b); }
+    mask |= ((bytes * 0x0102040810204080ULL) >> 56) << (8 * k);
+  }
+  return mask;
+}
+
+// Greedy NMS of an instance whose boxes are sorted by decreasing score: a box is kept unless a
+// kept box before it overlaps it by more than iou_threshold, and only the first num_keep of the
+// kept boxes are marked. Suppressed boxes are tracked in a bit mask, so only the kept boxes are
+// compared with the boxes after them.
+template<typename T>
+void NmsInstance(const BoxesSoA<T>& soa, int64_t num_boxes, int64_t num_keep, T iou_threshold,
+                 uint64_t* removed, int8_t* keep) {
+  const int64_t num_blocks = GetNumBlocks(num_boxes);
+  std::fill(removed, removed + num_blocks, 0);
+  std::fill(keep, keep + num_boxes, 0);
+  int64_t num_kept = 0;
+  for (int64_t i = 0; i < num_boxes && num_kept < num_keep; ++i) {
+    const int64_t block_i = i / kBlockSize;
+    if (removed[block_i] & (uint64_t(1) << (i % kBlockSize))) { continue; }
+    keep[i] = 1;
+    num_kept += 1;
+    // only the boxes after i in its own block
+    removed[block_i] |= SuppressionMask(soa, i, block_i, iou_threshold)
+                        & ((~uint64_t(0) << (i % kBlockSize)) << 1);
+    for (int64_t block = block_i + 1; block < num_blocks; ++block) {
+      if (removed[block] == ~uint64_t(0)) { continue; }
+      removed[block] |= SuppressionMask(soa, i, block, iou_threshold);
+    }
+  }
 }
 
 }  // namespace
@@ -43,30 +125,57 @@ class NmsCpuKernel final : public user_op::OpKernel {
   void Compute(user_op::KernelComputeContext* ctx) const override {
     const user_op::Tensor* boxes_blob = ctx->Tensor4ArgNameAndIndex("in", 0);
     user_op::Tensor* keep_blob = ctx->Tensor4ArgNameAndIndex("out", 0);
+    user_op::Tensor* tmp_blob = ctx->Tensor4ArgNameAndIndex("tmp_buffer", 0);
     const T* boxes = boxes_blob->dptr<T>();
     int8_t* keep = keep_blob->mut_dptr<int8_t>();
 
-    const int num_boxes = boxes_blob->shape_view().At(0);
-    int num_keep = ctx->Attr<int>("keep_n");
+    const ShapeView& in_shape = boxes_blob->shape_view();
+    const int64_t num_boxes = in_shape.At(in_shape.NumAxes() - 2);
+    const int64_t num_instances = keep_blob->shape_view().elem_cnt() / num_boxes;
+    int64_t num_keep = ctx->Attr<int>("keep_n");
     if (num_keep <= 0 || num_keep > num_boxes) { num_keep = num_boxes; }
-    const float iou_threshold = ctx->Attr<float>("iou_threshold");
-    for (int i = 0; i < num_boxes; i++) { keep[i] = -1; }
-    for (int i = 0; i < num_boxes; i++) {
-      if (keep[i] == 0) continue;
-      keep[i] = 1;
-      for (int j = i + 1; j < num_boxes; j++) {
-        if (IoU(boxes + i * 4, boxes + j * 4) > iou_threshold) { keep[j] = 0; }
+    const T iou_threshold = static_cast<T>(ctx->Attr<float>("iou_threshold"));
+
+    // instances (images or classes) are independent, each one has its own part of the buffer
+    const int64_t num_blocks = GetNumBlocks(num_boxes);
+    T* soa_buffer = tmp_blob->mut_dptr<T>();
+    uint64_t* removed_buffer =
+        reinterpret_cast<uint64_t*>(soa_buffer + num_instances * 5 * num_blocks * kBlockSize);
+    auto NmsInstances = [&](int64_t begin, int64_t end) {
+      for (int64_t n = begin; n < end; ++n) {
+        const BoxesSoA<T> soa = LoadBoxes(boxes + n * num_boxes * 4, num_boxes,
+                                          soa_buffer + n * 5 * num_blocks * kBlockSize);
+        NmsInstance(soa, num_boxes, num_keep, iou_threshold, removed_buffer + n * num_blocks,
+                    keep + n * num_boxes);
       }
+    };
+    // a kept box is compared with about half of the boxes on average
+    const int64_t instance_cost = std::max<int64_t>(num_boxes * num_boxes / 2, 1);
+    if (num_instances * instance_cost < kCpuNmsGrain) {
+      NmsInstances(0, num_instances);
+    } else {
+      ctx->stream()->As<ep::CpuStream>()->ParallelFor(
+          0, num_instances, NmsInstances,
+          std::max<int64_t>(kCpuNmsGrain / instance_cost, 1));
     }
   }
   bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
 };
 
-#define REGISTER_NMS_CPU_KERNEL(dtype)                                            \
-  REGISTER_USER_KERNEL("nms").SetCreateFn<NmsCpuKernel<dtype>>().SetIsMatchedHob( \
-      (user_op::HobDeviceType() == DeviceType::kCPU)                              \
-      && (user_op::HobDataType("out", 0) == DataType::kInt8)                      \
-      && (user_op::HobDataType("in", 0) == GetDataType<dtype>::value));
+#define REGISTER_NMS_CPU_KERNEL(dtype)                                                          \
+  REGISTER_USER_KERNEL("nms")                                                                   \
+      .SetCreateFn<NmsCpuKernel<dtype>>()                                                       \
+      .SetIsMatchedHob((user_op::HobDeviceType() == DeviceType::kCPU)                           \
+                       && (user_op::HobDataType("out", 0) == DataType::kInt8)                   \
+                       && (user_op::HobDataType("in", 0) == GetDataType<dtype>::value))         \
+      .SetInferTmpSizeFn([](user_op::InferContext* ctx) {                                       \
+        const Shape& in_shape = ctx->InputShape("in", 0);                                       \
+        const int64_t num_boxes = in_shape.At(in_shape.NumAxes() - 2);                          \
+        const int64_t num_instances = num_boxes == 0 ? 0 : in_shape.elem_cnt() / 4 / num_boxes; \
+        const int64_t num_blocks = GetNumBlocks(num_boxes);                                     \
+        return num_instances * num_blocks                                                       \
+               * (5 * kBlockSize * sizeof(dtype) + sizeof(uint64_t));                           \
+      });
 
 REGISTER_NMS_CPU_KERNEL(float)
 REGISTER_NMS_CPU_KERNEL(double)
@@ -105,22 +105,29 @@ class NmsGpuKernel final : public user_op::OpKernel {
     int8_t* keep = keep_blob->mut_dptr<int8_t>();
     int64_t* suppression_mask = tmp_blob->mut_dptr<int64_t>();
 
-    const int num_boxes = boxes_blob->shape_view().At(0);
+    const ShapeView& in_shape = boxes_blob->shape_view();
+    const int num_boxes = in_shape.At(in_shape.NumAxes() - 2);
+    const int64_t num_instances = keep_blob->shape_view().elem_cnt() / num_boxes;
     int num_keep = ctx->Attr<int>("keep_n");
     if (num_keep <= 0 || num_keep > num_boxes) { num_keep = num_boxes; }
     const int num_blocks = CeilDiv<int>(num_boxes, kBlockSize);
-    Memset<DeviceType::kCUDA>(ctx->stream(), suppression_mask, 0,
-                              num_boxes * num_blocks * sizeof(int64_t));
-    Memset<DeviceType::kCUDA>(ctx->stream(), keep, 0, num_boxes * sizeof(int8_t));
+    Memset<DeviceType::kCUDA>(ctx->stream(), keep, 0,
+                              num_instances * num_boxes * sizeof(int8_t));
 
+    // the instances run one after the other on the stream and share the suppression mask
     dim3 blocks(num_blocks, num_blocks);
     dim3 threads(kBlockSize);
-    CalcSuppressionBitmaskMatrix<<<blocks, threads, 0,
-                                   ctx->stream()->As<ep::CudaStream>()->cuda_stream()>>>(
-        num_boxes, ctx->Attr<float>("iou_threshold"), boxes, suppression_mask);
-    ScanSuppression<<<1, num_blocks, num_blocks * sizeof(int64_t),
-                      ctx->stream()->As<ep::CudaStream>()->cuda_stream()>>>(
-        num_boxes, num_blocks, num_keep, suppression_mask, keep);
+    for (int64_t n = 0; n < num_instances; ++n) {
+      Memset<DeviceType::kCUDA>(ctx->stream(), suppression_mask, 0,
+                                num_boxes * num_blocks * sizeof(int64_t));
+      CalcSuppressionBitmaskMatrix<<<blocks, threads, 0,
+                                     ctx->stream()->As<ep::CudaStream>()->cuda_stream()>>>(
+          num_boxes, ctx->Attr<float>("iou_threshold"), boxes + n * num_boxes * 4,
+          suppression_mask);
+      ScanSuppression<<<1, num_blocks, num_blocks * sizeof(int64_t),
+                        ctx->stream()->As<ep::CudaStream>()->cuda_stream()>>>(
+          num_boxes, num_blocks, num_keep, suppression_mask, keep + n * num_boxes);
+    }
   }
   bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
 };
@@ -133,7 +140,7 @@ class NmsGpuKernel final : public user_op::OpKernel {
                        && (user_op::HobDataType("in", 0) == GetDataType<dtype>::value)) \
       .SetInferTmpSizeFn([](user_op::InferContext* ctx) {                               \
         const Shape& in_shape = ctx->Shape4ArgNameAndIndex("in", 0);                    \
-        int64_t num_boxes = in_shape.At(0);                                             \
+        int64_t num_boxes = in_shape.At(in_shape.NumAxes() - 2);                        \
         int64_t blocks = CeilDiv<int64_t>(num_boxes, kBlockSize);                       \
         return num_boxes * blocks * sizeof(int64_t);                                    \
       });
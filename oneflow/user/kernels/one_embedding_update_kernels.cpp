@@ -0,0 +1,296 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include "oneflow/core/framework/framework.h"
+#include "oneflow/core/ep/cpu/cpu_stream.h"
+#include "oneflow/user/kernels/model_update_kernel_util.h"
+
+namespace oneflow {
+
+namespace {
+
+// Number of elements updated by a task of the cpu one_embedding update kernels.
+constexpr int64_t kCpuGrain = 32768;
+
+// The options shared by all the one_embedding update kernels. The cpu kernels read the unique
+// embeddings from their input tensors and the number of unique ids from the host num_unique_ids
+// tensor, so unlike the cuda kernels they don't need an EmbeddingState.
+template<typename T>
+struct CpuEmbeddingUpdateArgs {
+  int64_t num_unique;
+  int64_t line_size;
+  int64_t embedding_size;
+  bool skip;
+  T scale;
+  float l1;
+  float l2;
+  float weight_decay;
+  float learning_rate;
+  const T* unique_embeddings;
+  T* updated_unique_embeddings;
+};
+
+template<typename T, typename IDX>
+CpuEmbeddingUpdateArgs<T> GetCpuEmbeddingUpdateArgs(user_op::KernelComputeContext* ctx) {
+  const user_op::Tensor* num_unique_ids = ctx->Tensor4ArgNameAndIndex("num_unique_ids", 0);
+  const user_op::Tensor* unique_embeddings = ctx->Tensor4ArgNameAndIndex("unique_embeddings", 0);
+  const user_op::Tensor* embedding_grad = ctx->Tensor4ArgNameAndIndex("embedding_grad", 0);
+  user_op::Tensor* updated_unique_embeddings =
+      ctx->Tensor4ArgNameAndIndex("updated_unique_embeddings", 0);
+  CHECK_EQ(embedding_grad->shape_view().NumAxes(), 2);
+  CpuEmbeddingUpdateArgs<T> args;
+  args.num_unique = static_cast<int64_t>(*num_unique_ids->dptr<IDX>());
+  args.line_size = ctx->Attr<int64_t>("line_size");
+  args.embedding_size = ctx->Attr<int64_t>("embedding_size");
+  CHECK_LE(args.num_unique, embedding_grad->shape_view().At(0));
+  CHECK_GE(unique_embeddings->shape_view().elem_cnt(), args.num_unique * args.line_size)
+      << "The cpu one_embedding update kernels don't support dynamic memory allocation. ";
+  args.skip = false;
+  if (ctx->has_input("skip_if", 0)) {
+    const user_op::Tensor* skip_if = ctx->Tensor4ArgNameAndIndex("skip_if", 0);
+    CHECK_EQ(skip_if->shape_view().elem_cnt(), 1);
+    args.skip = *skip_if->dptr<int64_t>() != 0;
+  }
+  args.scale = static_cast<T>(ctx->Attr<double>("scale"));
+  if (ctx->has_input("scale_by_tensor", 0)) {
+    const user_op::Tensor* scale_by_tensor = ctx->Tensor4ArgNameAndIndex("scale_by_tensor", 0);
+    CHECK_EQ(scale_by_tensor->shape_view().elem_cnt(), 1);
+    args.scale *= *scale_by_tensor->dptr<T>();
+  }
+  if (ctx->has_input("down_scale_by_tensor", 0)) {
+    const user_op::Tensor* down_scale_by_tensor =
+        ctx->Tensor4ArgNameAndIndex("down_scale_by_tensor", 0);
+    CHECK_EQ(down_scale_by_tensor->shape_view().elem_cnt(), 1);
+    args.scale /= *down_scale_by_tensor->dptr<T>();
+  }
+  args.l1 = ctx->Attr<float>("l1");
+  args.l2 = ctx->Attr<float>("l2");
+  args.weight_decay = ctx->Attr<float>("weight_decay");
+  args.learning_rate = ctx->Attr<float>("learning_rate_val");
+  if (ctx->has_input("learning_rate", 0)) {
+    args.learning_rate = *ctx->Tensor4ArgNameAndIndex("learning_rate", 0)->dptr<float>();
+  }
+  args.unique_embeddings = unique_embeddings->dptr<T>();
+  args.updated_unique_embeddings = updated_unique_embeddings->mut_dptr<T>();
+  return args;
+}
+
+// Copies the num_unique lines of the unique embeddings to the updated unique embeddings, then
+// unless the update is skipped, calls update_row(grad_row, line) on the copied line of each
+// unique id, so that the model and its optimizer states are updated in place with a single pass
+// over the line.
+template<typename T, typename G, typename F>
+void CpuEmbeddingUpdate(user_op::KernelComputeContext* ctx, const CpuEmbeddingUpdateArgs<T>& args,
+                        const F& update_row) {
+  const G* embedding_grad = ctx->Tensor4ArgNameAndIndex("embedding_grad", 0)->dptr<G>();
+  const int64_t line_size = args.line_size;
+  const int64_t embedding_size = args.embedding_size;
+  const bool skip = args.skip;
+  ctx->stream()->As<ep::CpuStream>()->ParallelFor(
+      0, args.num_unique,
+      [&](int64_t begin, int64_t end) {
+        std::copy(args.unique_embeddings + begin * line_size,
+                  args.unique_embeddings + end * line_size,
+                  args.updated_unique_embeddings + begin * line_size);
+        if (skip) { return; }
+        for (int64_t row = begin; row < end; ++row) {
+          update_row(embedding_grad + row * embedding_size,
+                     args.updated_unique_embeddings + row * line_size);
+        }
+      },
+      std::max<int64_t>(kCpuGrain / std::max<int64_t>(line_size, 1), 1));
+}
+
+}  // namespace
+
+template<typename T, typename G, typename IDX>
+class CpuSgdEmbeddingUpdateKernel final : public user_op::OpKernel {
+ public:
+  CpuSgdEmbeddingUpdateKernel() = default;
+  ~CpuSgdEmbeddingUpdateKernel() override = default;
+
+ private:
+  using user_op::OpKernel::Compute;
+  void Compute(user_op::KernelComputeContext* ctx) const override {
+    const CpuEmbeddingUpdateArgs<T> args = GetCpuEmbeddingUpdateArgs<T, IDX>(ctx);
+    CHECK_EQ(args.line_size, args.embedding_size);
+    CpuEmbeddingUpdate<T, G>(ctx, args, [&](const G* grad, T* line) {
+      for (int64_t col = 0; col < args.embedding_size; ++col) {
+        SGDUpdateFunctor<T, G>()(grad + col, line + col, args.scale, args.l1, args.l2,
+                                 args.weight_decay, args.learning_rate);
+      }
+    });
+  }
+  bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
+};
+
+template<typename T, typename G, typename IDX>
+class CpuMomentumEmbeddingUpdateKernel final : public user_op::OpKernel {
+ public:
+  CpuMomentumEmbeddingUpdateKernel() = default;
+  ~CpuMomentumEmbeddingUpdateKernel() override = default;
+
+ private:
+  using user_op::OpKernel::Compute;
+  void Compute(user_op::KernelComputeContext* ctx) const override {
+    const CpuEmbeddingUpdateArgs<T> args = GetCpuEmbeddingUpdateArgs<T, IDX>(ctx);
+    CHECK_EQ(args.line_size, args.embedding_size * 2);
+    const float beta = ctx->Attr<float>("beta");
+    // Same as the cuda kernel, dampening, nesterov and maximize are not supported yet.
+    CpuEmbeddingUpdate<T, G>(ctx, args, [&](const G* grad, T* line) {
+      T* momentum = line + args.embedding_size;
+      for (int64_t col = 0; col < args.embedding_size; ++col) {
+        MomentumUpdateFunctor<T, G>()(grad + col, line + col, momentum + col, args.scale, args.l1,
+                                      args.l2, beta, 0.0, false, false, args.weight_decay,
+                                      args.learning_rate);
+      }
+    });
+  }
+  bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
+};
+
+template<typename T, typename G, typename IDX>
+class CpuAdamEmbeddingUpdateKernel final : public user_op::OpKernel {
+ public:
+  CpuAdamEmbeddingUpdateKernel() = default;
+  ~CpuAdamEmbeddingUpdateKernel() override = default;
+
+ private:
+  using user_op::OpKernel::Compute;
+  void Compute(user_op::KernelComputeContext* ctx) const override {
+    const CpuEmbeddingUpdateArgs<T> args = GetCpuEmbeddingUpdateArgs<T, IDX>(ctx);
+    CHECK_EQ(args.line_size, args.embedding_size * 3);
+    const float beta1 = ctx->Attr<float>("beta1");
+    const float beta2 = ctx->Attr<float>("beta2");
+    const float epsilon = ctx->Attr<float>("epsilon");
+    float bias_correction1 = ctx->Attr<float>("bias_correction1_val");
+    if (ctx->has_input("bias_correction1", 0)) {
+      bias_correction1 = *ctx->Tensor4ArgNameAndIndex("bias_correction1", 0)->dptr<float>();
+    }
+    float bias_correction2 = ctx->Attr<float>("bias_correction2_val");
+    if (ctx->has_input("bias_correction2", 0)) {
+      bias_correction2 = *ctx->Tensor4ArgNameAndIndex("bias_correction2", 0)->dptr<float>();
+    }
+    CpuEmbeddingUpdate<T, G>(ctx, args, [&](const G* grad, T* line) {
+      T* m = line + args.embedding_size;
+      T* v = line + 2 * args.embedding_size;
+      for (int64_t col = 0; col < args.embedding_size; ++col) {
+        AdamUpdateFunctor<T, G>()(grad + col, line + col, m + col, v + col, nullptr, args.scale,
+                                  args.l1, args.l2, beta1, beta2, epsilon, args.weight_decay,
+                                  false, bias_correction1, bias_correction2, args.learning_rate);
+      }
+    });
+  }
+  bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
+};
+
+template<typename T, typename G, typename IDX>
+class CpuAdagradEmbeddingUpdateKernel final : public user_op::OpKernel {
+ public:
+  CpuAdagradEmbeddingUpdateKernel() = default;
+  ~CpuAdagradEmbeddingUpdateKernel() override = default;
+
+ private:
+  using user_op::OpKernel::Compute;
+  void Compute(user_op::KernelComputeContext* ctx) const override {
+    CpuEmbeddingUpdateArgs<T> args = GetCpuEmbeddingUpdateArgs<T, IDX>(ctx);
+    CHECK_EQ(args.line_size, args.embedding_size * 2);
+    const float lr_decay = ctx->Attr<float>("lr_decay");
+    const float epsilon = ctx->Attr<float>("epsilon");
+    int64_t train_step = ctx->Attr<int64_t>("train_step_val");
+    if (ctx->has_input("train_step", 0)) {
+      train_step = *ctx->Tensor4ArgNameAndIndex("train_step", 0)->dptr<int64_t>() + 1;
+    }
+    args.learning_rate = args.learning_rate / (1 + (train_step - 1) * lr_decay);
+    CpuEmbeddingUpdate<T, G>(ctx, args, [&](const G* grad, T* line) {
+      T* sum = line + args.embedding_size;
+      for (int64_t col = 0; col < args.embedding_size; ++col) {
+        AdagradUpdateFunctor<T, G>()(grad + col, line + col, sum + col, args.scale, args.l1,
+                                     args.l2, epsilon, args.weight_decay, args.learning_rate);
+      }
+    });
+  }
+  bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
+};
+
+template<typename T, typename G, typename IDX>
+class CpuFtrlEmbeddingUpdateKernel final : public user_op::OpKernel {
+ public:
+  CpuFtrlEmbeddingUpdateKernel() = default;
+  ~CpuFtrlEmbeddingUpdateKernel() override = default;
+
+ private:
+  using user_op::OpKernel::Compute;
+  void Compute(user_op::KernelComputeContext* ctx) const override {
+    CpuEmbeddingUpdateArgs<T> args = GetCpuEmbeddingUpdateArgs<T, IDX>(ctx);
+    CHECK_EQ(args.line_size, args.embedding_size * 3)
+        << "The line_size should be equal to 3 x embedding_size. ";
+    CHECK_EQ(args.weight_decay, static_cast<float>(0.0))
+        << "Currently not support for setting weight decay. ";
+    args.l1 = 0.0;
+    args.l2 = 0.0;
+    const float lr_power = ctx->Attr<float>("lr_power");
+    const float lambda1 = ctx->Attr<float>("lambda1");
+    const float lambda2 = ctx->Attr<float>("lambda2");
+    const float beta = ctx->Attr<float>("beta");
+    CpuEmbeddingUpdate<T, G>(ctx, args, [&](const G* grad, T* line) {
+      T* accumulate = line + args.embedding_size;
+      T* z = line + 2 * args.embedding_size;
+      for (int64_t col = 0; col < args.embedding_size; ++col) {
+        FtrlUpdateFunctor<T, G>()(grad + col, line + col, accumulate + col, z + col, args.scale,
+                                  args.l1, args.l2, lr_power, lambda1, lambda2, beta,
+                                  args.weight_decay, args.learning_rate);
+      }
+    });
+  }
+  bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
+};
+
+#define IDX_DATA_TYPE_SEQ                           \
+  OF_PP_MAKE_TUPLE_SEQ(uint32_t, DataType::kUInt32) \
+  OF_PP_MAKE_TUPLE_SEQ(int32_t, DataType::kInt32)
+
+#define REGISTER_CPU_ONE_EMBEDDING_UPDATE_KERNEL(op_type_name, kernel, t_dtype_pair, g_type_pair, \
+                                                 idx_dtype_pair)                                  \
+  REGISTER_USER_KERNEL(op_type_name)                                                              \
+      .SetCreateFn<kernel<OF_PP_PAIR_FIRST(t_dtype_pair), OF_PP_PAIR_FIRST(g_type_pair),          \
+                          OF_PP_PAIR_FIRST(idx_dtype_pair)>>()                                    \
+      .SetIsMatchedHob(                                                                           \
+          (user_op::HobDeviceType() == DeviceType::kCPU)                                          \
+          && (user_op::HobDataType("num_unique_ids", 0) == OF_PP_PAIR_SECOND(idx_dtype_pair))     \
+          && (user_op::HobDataType("embedding_grad", 0) == OF_PP_PAIR_SECOND(g_type_pair))        \
+          && (user_op::HobDataType("unique_embeddings", 0) == OF_PP_PAIR_SECOND(t_dtype_pair)));
+
+#define REGISTER_CPU_ONE_EMBEDDING_UPDATE_KERNELS(t_dtype_pair, g_type_pair, idx_dtype_pair) \
+  REGISTER_CPU_ONE_EMBEDDING_UPDATE_KERNEL("one_embedding_sgd_update",                       \
+                                           CpuSgdEmbeddingUpdateKernel, t_dtype_pair,        \
+                                           g_type_pair, idx_dtype_pair)                      \
+  REGISTER_CPU_ONE_EMBEDDING_UPDATE_KERNEL("one_embedding_momentum_update",                  \
+                                           CpuMomentumEmbeddingUpdateKernel, t_dtype_pair,   \
+                                           g_type_pair, idx_dtype_pair)                      \
+  REGISTER_CPU_ONE_EMBEDDING_UPDATE_KERNEL("one_embedding_adam_update",                      \
+                                           CpuAdamEmbeddingUpdateKernel, t_dtype_pair,       \
+                                           g_type_pair, idx_dtype_pair)                      \
+  REGISTER_CPU_ONE_EMBEDDING_UPDATE_KERNEL("one_embedding_adagrad_update",                   \
+                                           CpuAdagradEmbeddingUpdateKernel, t_dtype_pair,    \
+                                           g_type_pair, idx_dtype_pair)                      \
+  REGISTER_CPU_ONE_EMBEDDING_UPDATE_KERNEL("one_embedding_ftrl_update",                      \
+                                           CpuFtrlEmbeddingUpdateKernel, t_dtype_pair,       \
+                                           g_type_pair, idx_dtype_pair)
+
+OF_PP_SEQ_PRODUCT_FOR_EACH_TUPLE(REGISTER_CPU_ONE_EMBEDDING_UPDATE_KERNELS, FLOATING_DATA_TYPE_SEQ,
+                                 FLOATING_DATA_TYPE_SEQ, IDX_DATA_TYPE_SEQ)
+
+}  // namespace oneflow
@@ -14,10 +14,24 @@ See the License for the specific language governing permissions and
 limitations under the License.
 */
 
+// Keep the twiddle factors of recently used lengths alive between calls. Without the cache
+// pocketfft rebuilds the 1-D plans of every axis on each call, which dominates the cost of small
+// transforms. Must be defined before the first inclusion of pocketfft_hdronly.h.
+#ifndef POCKETFFT_CACHE_SIZE
+#define POCKETFFT_CACHE_SIZE 16
+#endif  // POCKETFFT_CACHE_SIZE
+// The transforms are parallelized by the thread pool of CpuStream, so pocketfft never starts its
+// own thread pool, which neither respects the thread budget nor survives a fork.
+#ifndef POCKETFFT_NO_MULTITHREADING
+#define POCKETFFT_NO_MULTITHREADING
+#endif  // POCKETFFT_NO_MULTITHREADING
+#include <functional>
+#include <numeric>
 #include "pocketfft_hdronly.h"
 #include "oneflow/core/framework/framework.h"
 #include "oneflow/core/kernel/new_kernel_util.h"
 #include "oneflow/core/kernel/kernel.h"
+#include "oneflow/core/ep/cpu/cpu_stream.h"
 #include "oneflow/core/ep/cuda/cuda_stream.h"
 
 namespace oneflow {
@@ -25,6 +39,8 @@ namespace {
 
 enum class FFT_EXCUTETYPE { R2C, C2C, C2R };
 
+constexpr int64_t kPocketFFtGrain = 32768;
+
 template<typename dtype>
 struct PocketFFtParams {
   bool IsForward;
@@ -61,6 +77,11 @@ struct PocketFFtParams {
     for (auto& s : in_stridef) { s *= in_elemsize; }
     for (auto& s : out_stridef) { s *= out_elemsize; }
   }
+
+  // The logical shape of the transform, i.e. the real side for R2C and C2R
+  const pocketfft::shape_t& fft_shape() const {
+    return excute_type == FFT_EXCUTETYPE::C2R ? output_shape : input_shape;
+  }
 };
 
 template<typename dtype>
@@ -69,25 +90,81 @@ class PocketFFtConfig {
   PocketFFtConfig(const PocketFFtConfig&) = delete;
   PocketFFtConfig& operator=(PocketFFtConfig const&) = delete;
 
-  explicit PocketFFtConfig(const PocketFFtParams<dtype>& params) : fftparams(params) {}
+  explicit PocketFFtConfig(const PocketFFtParams<dtype>& params) : fftparams(params) {
+    const pocketfft::shape_t& shape = fftparams.fft_shape();
+    std::vector<bool> is_fft_axis(shape.size(), false);
+    for (auto axis : fftparams.axes) {
+      is_fft_axis[axis] = true;
+      fft_size *= shape[axis];
+    }
+    // Batches are split along the largest axis that is not transformed
+    for (size_t i = 0; i < shape.size(); ++i) {
+      if (is_fft_axis[i]) { continue; }
+      if (batch_axis < 0 || shape[i] > shape[batch_axis]) { batch_axis = i; }
+    }
+  }
 
-  void excute(const std::complex<dtype>* in, std::complex<dtype>* out) {
-    pocketfft::c2c(fftparams.input_shape, fftparams.in_stridef, fftparams.out_stridef,
-                   fftparams.axes, fftparams.IsForward, in, out, fftparams.fct);
+  void excute(ep::Stream* stream, const std::complex<dtype>* in, std::complex<dtype>* out) {
+    ParallelExcute(stream, in, out,
+                   [&](const pocketfft::shape_t& shape, const std::complex<dtype>* in,
+                       std::complex<dtype>* out) {
+                     pocketfft::c2c(shape, fftparams.in_stridef, fftparams.out_stridef,
+                                    fftparams.axes, fftparams.IsForward, in, out, fftparams.fct,
+                                    /*nthreads=*/1);
+                   });
   }
 
-  void excute(const dtype* in, std::complex<dtype>* out) {
-    pocketfft::r2c(fftparams.input_shape, fftparams.in_stridef, fftparams.out_stridef,
-                   fftparams.axes, fftparams.IsForward, in, out, fftparams.fct);
+  void excute(ep::Stream* stream, const dtype* in, std::complex<dtype>* out) {
+    ParallelExcute(stream, in, out,
+                   [&](const pocketfft::shape_t& shape, const dtype* in, std::complex<dtype>* out) {
+                     pocketfft::r2c(shape, fftparams.in_stridef, fftparams.out_stridef,
+                                    fftparams.axes, fftparams.IsForward, in, out, fftparams.fct,
+                                    /*nthreads=*/1);
+                   });
   }
 
-  void excute(const std::complex<dtype>* in, dtype* out) {
-    pocketfft::c2r(fftparams.output_shape, fftparams.in_stridef, fftparams.out_stridef,
-                   fftparams.axes, fftparams.IsForward, in, out, fftparams.fct);
+  void excute(ep::Stream* stream, const std::complex<dtype>* in, dtype* out) {
+    ParallelExcute(stream, in, out,
+                   [&](const pocketfft::shape_t& shape, const std::complex<dtype>* in, dtype* out) {
+                     pocketfft::c2r(shape, fftparams.in_stridef, fftparams.out_stridef,
+                                    fftparams.axes, fftparams.IsForward, in, out, fftparams.fct,
+                                    /*nthreads=*/1);
+                   });
   }
 
  private:
+  // Runs `fft` on slices of the batch axis on the device thread pool, each slice on one thread.
+  template<typename IN, typename OUT, typename F>
+  void ParallelExcute(ep::Stream* stream, const IN* in, OUT* out, const F& fft) {
+    const pocketfft::shape_t& shape = fftparams.fft_shape();
+    const int64_t elem_cnt =
+        std::accumulate(shape.begin(), shape.end(), int64_t(1), std::multiplies<int64_t>());
+    const int64_t batch_size = batch_axis < 0 ? 1 : shape[batch_axis];
+    if (elem_cnt < kPocketFFtGrain || batch_size <= 1) {
+      fft(shape, in, out);
+      return;
+    }
+    const ptrdiff_t in_batch_stride = fftparams.in_stridef[batch_axis];
+    const ptrdiff_t out_batch_stride = fftparams.out_stridef[batch_axis];
+    const int64_t grain = std::max<int64_t>(kPocketFFtGrain / fft_size, 1);
+    stream->As<ep::CpuStream>()->ParallelFor(
+        0, batch_size,
+        [&](int64_t begin, int64_t end) {
+          pocketfft::shape_t slice_shape(shape);
+          slice_shape[batch_axis] = end - begin;
+          // strides are in bytes
+          const IN* slice_in = reinterpret_cast<const IN*>(reinterpret_cast<const char*>(in)
+                                                           + begin * in_batch_stride);
+          OUT* slice_out =
+              reinterpret_cast<OUT*>(reinterpret_cast<char*>(out) + begin * out_batch_stride);
+          fft(slice_shape, slice_in, slice_out);
+        },
+        grain);
+  }
+
   PocketFFtParams<dtype> fftparams;
+  int64_t fft_size = 1;
+  int64_t batch_axis = -1;
 };
 
 }  // namespace
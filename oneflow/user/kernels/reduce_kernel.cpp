@@ -21,6 +21,7 @@ limitations under the License.
 #include "oneflow/core/kernel/cuda_graph_support.h"
 #include "oneflow/core/ep/include/primitive/cast.h"
 #include "oneflow/core/ep/include/primitive/fill.h"
+#include "oneflow/core/ep/include/primitive/reduce.h"
 
 #ifdef WITH_CUDA
 #include "oneflow/core/ep/cuda/cuda_device.h"
@@ -64,6 +65,40 @@ std::unique_ptr<ep::primitive::Fill> NewFillPrimitive(Context* ctx) {
   return ep::primitive::NewPrimitive<ep::primitive::FillFactory>(ctx->device_type(), data_type);
 }
 
+// The binary op of the reductions that have a Reduce primitive, the others are done by
+// NdarrayReduce.
+template<template<typename> class BinaryFunc>
+struct ReducePrimitiveBinaryOp {
+  static constexpr bool kSupported = false;
+  static constexpr ep::primitive::BinaryOp kOp = ep::primitive::BinaryOp::kAdd;
+};
+
+#define SPECIALIZE_REDUCE_PRIMITIVE_BINARY_OP(binary_func, binary_op) \
+  template<>                                                          \
+  struct ReducePrimitiveBinaryOp<binary_func> {                       \
+    static constexpr bool kSupported = true;                          \
+    static constexpr ep::primitive::BinaryOp kOp = binary_op;         \
+  };
+
+SPECIALIZE_REDUCE_PRIMITIVE_BINARY_OP(BinaryFuncSum, ep::primitive::BinaryOp::kAdd)
+SPECIALIZE_REDUCE_PRIMITIVE_BINARY_OP(BinaryFuncProd, ep::primitive::BinaryOp::kMul)
+SPECIALIZE_REDUCE_PRIMITIVE_BINARY_OP(BinaryFuncMax, ep::primitive::BinaryOp::kMax)
+SPECIALIZE_REDUCE_PRIMITIVE_BINARY_OP(BinaryFuncMin, ep::primitive::BinaryOp::kMin)
+SPECIALIZE_REDUCE_PRIMITIVE_BINARY_OP(BinaryFuncAll, ep::primitive::BinaryOp::kLogicalAnd)
+SPECIALIZE_REDUCE_PRIMITIVE_BINARY_OP(BinaryFuncAny, ep::primitive::BinaryOp::kLogicalOr)
+
+#undef SPECIALIZE_REDUCE_PRIMITIVE_BINARY_OP
+
+template<template<typename> class BinaryFunc>
+std::unique_ptr<ep::primitive::Reduce> NewReducePrimitive(user_op::KernelComputeContext* ctx) {
+  if (!ReducePrimitiveBinaryOp<BinaryFunc>::kSupported) { return nullptr; }
+  const user_op::TensorDesc* in_desc = ctx->TensorDesc4ArgNameAndIndex("input_tensor", 0);
+  const DataType out_data_type = ctx->TensorDesc4ArgNameAndIndex("output_tensor", 0)->data_type();
+  return ep::primitive::NewPrimitive<ep::primitive::ReduceFactory>(
+      ctx->device_type(), ReducePrimitiveBinaryOp<BinaryFunc>::kOp, in_desc->data_type(),
+      out_data_type, in_desc->shape().NumAxes());
+}
+
 auto ReduceMatmulTransAPrimitiveExists() {
   return hob::make_custom("ReduceMatmulTransAPrimitiveExists",
                           [](const user_op::KernelRegContext& ctx) {
@@ -115,6 +150,13 @@ class ReduceKernel final : public user_op::OpKernel, public user_op::CudaGraphSu
     }
     const Shape& reduced_shape =
         CreateReducedShape(input_tensor->shape_view(), {axis.begin(), axis.end()});
+    std::unique_ptr<ep::primitive::Reduce> reduce = NewReducePrimitive<BinaryFunc>(ctx);
+    if (reduce) {
+      reduce->Launch(ctx->stream(), input_tensor->shape_view().NumAxes(),
+                     input_tensor->shape_view().ptr(), input_tensor->dptr(),
+                     reduced_shape.dim_vec().data(), output_tensor->mut_dptr());
+      return;
+    }
     NdarrayReduce<device_type, T, BinaryFunc>::Reduce(
         ctx->stream(), XpuVarNdarray<K>(reduced_shape, output_tensor->mut_dptr<K>()),
         XpuVarNdarray<const T>(input_tensor->shape_view(), input_tensor->dptr<T>()),
@@ -0,0 +1,192 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include <cmath>
+#include "oneflow/core/framework/framework.h"
+#include "oneflow/user/kernels/layer_norm_cpu_util.h"
+
+namespace oneflow {
+
+namespace {
+
+// Returns the sum of f(col) over [0, n) accumulated in layer_norm::kCpuLanes lanes.
+template<typename T, typename F>
+T LaneSum(int64_t n, const F& f) {
+  T lane_sum[layer_norm::kCpuLanes] = {};
+  for (int64_t col_begin = 0; col_begin < n; col_begin += layer_norm::kCpuLanes) {
+    const int64_t num_lanes = std::min(layer_norm::kCpuLanes, n - col_begin);
+    for (int64_t lane = 0; lane < num_lanes; ++lane) { lane_sum[lane] += f(col_begin + lane); }
+  }
+  T sum = 0;
+  for (int64_t lane = 0; lane < layer_norm::kCpuLanes; ++lane) { sum += lane_sum[lane]; }
+  return sum;
+}
+
+}  // namespace
+
+template<typename T>
+class RmsNormCpuKernel final : public user_op::OpKernel {
+ public:
+  RmsNormCpuKernel() = default;
+  ~RmsNormCpuKernel() = default;
+
+ private:
+  bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
+  void Compute(user_op::KernelComputeContext* ctx) const override {
+    const user_op::Tensor* x = ctx->Tensor4ArgNameAndIndex("x", 0);
+    user_op::Tensor* y = ctx->Tensor4ArgNameAndIndex("y", 0);
+    user_op::Tensor* inv_rms = ctx->Tensor4ArgNameAndIndex("inv_rms", 0);
+    const T eps = static_cast<T>(ctx->Attr<float>("epsilon"));
+    const Shape& normalized_shape = ctx->Attr<Shape>("normalized_shape");
+    const int64_t ncol = normalized_shape.elem_cnt();
+    const int64_t nrow = inv_rms->shape_view().elem_cnt();
+    const T* weight_ptr = nullptr;
+    if (ctx->has_input("weight", 0)) {
+      const auto* weight = ctx->Tensor4ArgNameAndIndex("weight", 0);
+      CHECK_EQ(weight->shape_view().elem_cnt(), ncol);
+      weight_ptr = weight->dptr<T>();
+    }
+    CHECK_EQ(x->shape_view().elem_cnt(), ncol * nrow);
+    const T* x_ptr = x->dptr<T>();
+    T* y_ptr = y->mut_dptr<T>();
+    T* inv_rms_ptr = inv_rms->mut_dptr<T>();
+    layer_norm::CpuParallelForEachRow(ctx->stream(), nrow, ncol, [&](int64_t row) {
+      const T* x_row = x_ptr + row * ncol;
+      T* y_row = y_ptr + row * ncol;
+      const T sum_square = LaneSum<T>(ncol, [&](int64_t col) { return x_row[col] * x_row[col]; });
+      const T row_inv_rms = static_cast<T>(1) / std::sqrt(sum_square / static_cast<T>(ncol) + eps);
+      inv_rms_ptr[row] = row_inv_rms;
+      if (weight_ptr != nullptr) {
+        for (int64_t col = 0; col < ncol; ++col) {
+          y_row[col] = x_row[col] * row_inv_rms * weight_ptr[col];
+        }
+      } else {
+        for (int64_t col = 0; col < ncol; ++col) { y_row[col] = x_row[col] * row_inv_rms; }
+      }
+    });
+  };
+};
+
+#define REGISTER_RMS_NORM_CPU_KERNEL(dtype)                           \
+  REGISTER_USER_KERNEL("rms_norm")                                    \
+      .SetCreateFn<RmsNormCpuKernel<dtype>>()                         \
+      .SetIsMatchedHob((user_op::HobDeviceType() == DeviceType::kCPU) \
+                       && (user_op::HobDataType("x", 0) == GetDataType<dtype>::value));
+
+REGISTER_RMS_NORM_CPU_KERNEL(float)
+REGISTER_RMS_NORM_CPU_KERNEL(double)
+
+template<typename T>
+class RmsNormGradCpuKernel final : public user_op::OpKernel {
+ public:
+  RmsNormGradCpuKernel() = default;
+  ~RmsNormGradCpuKernel() = default;
+
+ private:
+  bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
+  void Compute(user_op::KernelComputeContext* ctx) const override {
+    const user_op::Tensor* dy = ctx->Tensor4ArgNameAndIndex("dy", 0);
+    const user_op::Tensor* x = ctx->Tensor4ArgNameAndIndex("x", 0);
+    const user_op::Tensor* inv_rms = ctx->Tensor4ArgNameAndIndex("inv_rms", 0);
+    user_op::Tensor* dx = ctx->Tensor4ArgNameAndIndex("dx", 0);
+    const int64_t nrow = inv_rms->shape_view().elem_cnt();
+    const int64_t ncol = x->shape_view().elem_cnt() / nrow;
+    const T* weight_ptr = nullptr;
+    if (ctx->has_input("weight", 0)) {
+      const user_op::Tensor* weight = ctx->Tensor4ArgNameAndIndex("weight", 0);
+      CHECK_EQ(ncol, weight->shape_view().elem_cnt());
+      weight_ptr = weight->dptr<T>();
+    }
+    const T* dy_ptr = dy->dptr<T>();
+    const T* x_ptr = x->dptr<T>();
+    const T* inv_rms_ptr = inv_rms->dptr<T>();
+    T* dx_ptr = dx->mut_dptr<T>();
+    layer_norm::CpuParallelForEachRow(ctx->stream(), nrow, ncol, [&](int64_t row) {
+      const T* dy_row = dy_ptr + row * ncol;
+      const T* x_row = x_ptr + row * ncol;
+      T* dx_row = dx_ptr + row * ncol;
+      auto scaled_dy = [&](int64_t col) {
+        return weight_ptr == nullptr ? dy_row[col] : dy_row[col] * weight_ptr[col];
+      };
+      const T row_inv_rms = inv_rms_ptr[row];
+      // dx = inv_rms * (dy * w - x * inv_rms^2 * mean(dy * w * x))
+      const T sum_dy_x = LaneSum<T>(ncol, [&](int64_t col) { return scaled_dy(col) * x_row[col]; });
+      const T coef = sum_dy_x / static_cast<T>(ncol) * row_inv_rms * row_inv_rms;
+      for (int64_t col = 0; col < ncol; ++col) {
+        dx_row[col] = (scaled_dy(col) - x_row[col] * coef) * row_inv_rms;
+      }
+    });
+  };
+};
+
+#define REGISTER_RMS_NORM_GRAD_CPU_KERNEL(dtype)                      \
+  REGISTER_USER_KERNEL("rms_norm_grad")                               \
+      .SetCreateFn<RmsNormGradCpuKernel<dtype>>()                     \
+      .SetIsMatchedHob((user_op::HobDeviceType() == DeviceType::kCPU) \
+                       && (user_op::HobDataType("dy", 0) == GetDataType<dtype>::value));
+
+REGISTER_RMS_NORM_GRAD_CPU_KERNEL(float)
+REGISTER_RMS_NORM_GRAD_CPU_KERNEL(double)
+
+template<typename T>
+class RmsNormParamGradCpuKernel final : public user_op::OpKernel {
+ public:
+  RmsNormParamGradCpuKernel() = default;
+  ~RmsNormParamGradCpuKernel() = default;
+
+ private:
+  bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
+  void Compute(user_op::KernelComputeContext* ctx) const override {
+    const user_op::Tensor* dy = ctx->Tensor4ArgNameAndIndex("dy", 0);
+    const user_op::Tensor* x = ctx->Tensor4ArgNameAndIndex("x", 0);
+    const user_op::Tensor* inv_rms = ctx->Tensor4ArgNameAndIndex("inv_rms", 0);
+    user_op::Tensor* tmp_buffer = ctx->Tensor4ArgNameAndIndex("tmp_buffer", 0);
+    user_op::Tensor* weight_grad = ctx->Tensor4ArgNameAndIndex("weight_grad", 0);
+    const int64_t nrow = inv_rms->shape_view().elem_cnt();
+    const int64_t ncol = weight_grad->shape_view().elem_cnt();
+    const T* dy_ptr = dy->dptr<T>();
+    const T* x_ptr = x->dptr<T>();
+    const T* inv_rms_ptr = inv_rms->dptr<T>();
+    T* grads[1] = {weight_grad->mut_dptr<T>()};
+    layer_norm::CpuParamGradReduce(
+        ctx->stream(), nrow, ncol, 1, tmp_buffer->mut_dptr<T>(),
+        [&](int64_t row, T* sums) {
+          const T* dy_row = dy_ptr + row * ncol;
+          const T* x_row = x_ptr + row * ncol;
+          const T row_inv_rms = inv_rms_ptr[row];
+          for (int64_t col = 0; col < ncol; ++col) {
+            sums[col] += dy_row[col] * x_row[col] * row_inv_rms;
+          }
+        },
+        grads);
+  };
+};
+
+#define REGISTER_RMS_NORM_PARAM_GRAD_CPU_KERNEL(dtype)                                  \
+  REGISTER_USER_KERNEL("rms_norm_param_grad")                                           \
+      .SetCreateFn<RmsNormParamGradCpuKernel<dtype>>()                                  \
+      .SetIsMatchedHob((user_op::HobDeviceType() == DeviceType::kCPU)                   \
+                       && (user_op::HobDataType("dy", 0) == GetDataType<dtype>::value)) \
+      .SetInferTmpSizeFn([](user_op::InferContext* ctx) {                               \
+        const int64_t nrow = ctx->InputTensorDesc("inv_rms", 0).shape().elem_cnt();     \
+        if (nrow == 0) { return static_cast<size_t>(0); }                               \
+        const int64_t ncol = ctx->InputTensorDesc("dy", 0).shape().elem_cnt() / nrow;   \
+        return layer_norm::GetCpuParamGradPartialsSize(nrow, ncol, 1) * sizeof(dtype);  \
+      });
+
+REGISTER_RMS_NORM_PARAM_GRAD_CPU_KERNEL(float)
+REGISTER_RMS_NORM_PARAM_GRAD_CPU_KERNEL(double)
+
+}  // namespace oneflow
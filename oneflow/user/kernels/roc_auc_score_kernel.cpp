@@ -14,43 +14,46 @@ See the License for the specific language governing permissions and
 limitations under the License.
 */
 #include "oneflow/core/framework/framework.h"
+#include "oneflow/core/ep/cpu/cpu_stream.h"
+#include "oneflow/user/kernels/histogram_cpu_util.h"
+#include "oneflow/user/kernels/sort_cpu_util.h"
 
 namespace oneflow {
 
 namespace {
 
 template<typename L, typename P>
-double RocAucScore(size_t n, const L* label, const P* pred, float* buffer) {
-  size_t p_samples_count = 0;
-  for (size_t i = 0; i < n; ++i) {
-    if (label[i] == 0) {
-      buffer[i] = -pred[i];
-    } else {
-      p_samples_count += 1;
-      buffer[i] = pred[i];
+double RocAucScore(ep::Stream* stream, size_t n, const L* label, const P* pred, float* buffer,
+                   float* sort_buffer) {
+  auto* cpu_stream = stream->As<ep::CpuStream>();
+  const int64_t num_tasks = std::max<int64_t>(
+      std::min<int64_t>(cpu_stream->device()->GetNumThreads(), n / kCpuSortGrain), 1);
+  std::vector<size_t> task_p_samples_count(num_tasks, 0);
+  auto SignByLabel = [&](int64_t begin, int64_t end) {
+    for (int64_t task = begin; task < end; ++task) {
+      size_t count = 0;
+      for (size_t i = n * task / num_tasks; i < n * (task + 1) / num_tasks; ++i) {
+        if (label[i] == 0) {
+          buffer[i] = -pred[i];
+        } else {
+          count += 1;
+          buffer[i] = pred[i];
+        }
+      }
+      task_p_samples_count[task] = count;
     }
+  };
+  if (num_tasks == 1) {
+    SignByLabel(0, 1);
+  } else {
+    cpu_stream->ParallelFor(0, num_tasks, SignByLabel, 1);
   }
+  const size_t p_samples_count =
+      std::accumulate(task_p_samples_count.begin(), task_p_samples_count.end(), size_t(0));
   const size_t n_samples_count = n - p_samples_count;
-  constexpr size_t kParallelSortThreshold = 1024;
   auto comp = [](float a, float b) { return fabs(a) < fabs(b); };
-  if (n < kParallelSortThreshold) {
-    std::sort(buffer, buffer + n, comp);
-  } else {
-    const size_t m2 = n / 2;
-    const size_t m1 = m2 / 2;
-    const size_t m3 = (m2 + n) / 2;
-    std::thread t0([&] { std::sort(buffer, buffer + m1, comp); });
-    std::thread t1([&] { std::sort(buffer + m1, buffer + m2, comp); });
-    std::thread t2([&] { std::sort(buffer + m2, buffer + m3, comp); });
-    std::thread t3([&] { std::sort(buffer + m3, buffer + n, comp); });
-    t0.join();
-    t1.join();
-    t2.join();
-    t3.join();
-    std::inplace_merge(buffer, buffer + m1, buffer + m2, comp);
-    std::inplace_merge(buffer + m2, buffer + m3, buffer + n, comp);
-    std::inplace_merge(buffer, buffer + m2, buffer + n, comp);
-  }
+  CpuSortInstances(stream, buffer, sort_buffer, /*instance_num=*/1, /*instance_size=*/n,
+                   [&](int64_t) { return comp; });
   size_t tmp_n = 0;
   double tmp_rank_sum = 0;
   double rank_sum = 0;
@@ -87,8 +90,10 @@ class RocAucScoreKernel final : public user_op::OpKernel {
     P* out_ptr = out->mut_dptr<P>();
     CHECK_EQ(label->shape_view().elem_cnt(), pred->shape_view().elem_cnt());
     CHECK_EQ(out->shape_view().elem_cnt(), 1);
-    out_ptr[0] = RocAucScore(label->shape_view().elem_cnt(), label->dptr<L>(), pred->dptr<P>(),
-                             tmp_buffer->mut_dptr<float>());
+    const int64_t n = label->shape_view().elem_cnt();
+    float* buffer = tmp_buffer->mut_dptr<float>();
+    out_ptr[0] =
+        RocAucScore(ctx->stream(), n, label->dptr<L>(), pred->dptr<P>(), buffer, buffer + n);
   }
   bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
 };
@@ -101,7 +106,7 @@ class RocAucScoreKernel final : public user_op::OpKernel {
                        && (user_op::HobDataType("pred", 0) == pred_type))                   \
       .SetInferTmpSizeFn([](user_op::InferContext* ctx) -> size_t {                         \
         const Shape& pred_shape = ctx->InputShape("pred", 0);                               \
-        size_t tmp_buffer_size = pred_shape.elem_cnt() * sizeof(float);                     \
+        size_t tmp_buffer_size = 2 * pred_shape.elem_cnt() * sizeof(float);                 \
         return tmp_buffer_size;                                                             \
       })
 REGISTER_ROC_AUC_SCORE_KERNEL(DataType::kDouble, double, DataType::kFloat, float);
@@ -111,6 +116,56 @@ REGISTER_ROC_AUC_SCORE_KERNEL(DataType::kInt64, int64_t, DataType::kFloat, float
 REGISTER_ROC_AUC_SCORE_KERNEL(DataType::kInt8, int8_t, DataType::kFloat, float);
 REGISTER_ROC_AUC_SCORE_KERNEL(DataType::kUInt8, uint8_t, DataType::kFloat, float);
 
+template<typename L, typename P>
+class RocAucHistogramKernel final : public user_op::OpKernel {
+ public:
+  OF_DISALLOW_COPY_AND_MOVE(RocAucHistogramKernel);
+  RocAucHistogramKernel() = default;
+  ~RocAucHistogramKernel() override = default;
+
+ private:
+  void Compute(user_op::KernelComputeContext* ctx) const override {
+    const user_op::Tensor* label = ctx->Tensor4ArgNameAndIndex("label", 0);
+    const user_op::Tensor* pred = ctx->Tensor4ArgNameAndIndex("pred", 0);
+    user_op::Tensor* out = ctx->Tensor4ArgNameAndIndex("out", 0);
+    const int64_t n = label->shape_view().elem_cnt();
+    CHECK_EQ(pred->shape_view().elem_cnt(), n);
+    const int32_t num_buckets = static_cast<int32_t>(ctx->Attr<int64_t>("num_buckets"));
+    CHECK_EQ(out->shape_view().elem_cnt(), 2 * num_buckets);
+    const L* label_ptr = label->dptr<L>();
+    const P* pred_ptr = pred->dptr<P>();
+    int64_t* out_ptr = out->mut_dptr<int64_t>();
+    std::fill(out_ptr, out_ptr + 2 * num_buckets, 0);
+    const P scale = static_cast<P>(num_buckets);
+    // Row 0 counts the negative samples and row 1 the positive ones
+    histogram::CpuHistogram(
+        ctx->stream(), n, 2 * num_buckets,
+        [&](int64_t begin, int64_t end, int32_t* bins) {
+          for (int64_t i = begin; i < end; ++i) {
+            // nan and negative predictions go to the first bucket, predictions from 1 to the last
+            const P p = std::min(pred_ptr[i] > 0 ? pred_ptr[i] : P(0), P(1));
+            const int32_t bucket = std::min(static_cast<int32_t>(p * scale), num_buckets - 1);
+            bins[i - begin] = bucket + (label_ptr[i] != 0 ? num_buckets : 0);
+          }
+        },
+        out_ptr);
+  }
+  bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
+};
+
+#define REGISTER_ROC_AUC_HISTOGRAM_KERNEL(label_type, label_cpp_type, pred_type, pred_cpp_type) \
+  REGISTER_USER_KERNEL("roc_auc_histogram")                                                     \
+      .SetCreateFn<RocAucHistogramKernel<label_cpp_type, pred_cpp_type>>()                      \
+      .SetIsMatchedHob((user_op::HobDeviceType() == DeviceType::kCPU)                           \
+                       && (user_op::HobDataType("label", 0) == label_type)                      \
+                       && (user_op::HobDataType("pred", 0) == pred_type))
+REGISTER_ROC_AUC_HISTOGRAM_KERNEL(DataType::kDouble, double, DataType::kFloat, float);
+REGISTER_ROC_AUC_HISTOGRAM_KERNEL(DataType::kFloat, float, DataType::kFloat, float);
+REGISTER_ROC_AUC_HISTOGRAM_KERNEL(DataType::kInt32, int, DataType::kFloat, float);
+REGISTER_ROC_AUC_HISTOGRAM_KERNEL(DataType::kInt64, int64_t, DataType::kFloat, float);
+REGISTER_ROC_AUC_HISTOGRAM_KERNEL(DataType::kInt8, int8_t, DataType::kFloat, float);
+REGISTER_ROC_AUC_HISTOGRAM_KERNEL(DataType::kUInt8, uint8_t, DataType::kFloat, float);
+
 }  // namespace
 
 }  // namespace oneflow
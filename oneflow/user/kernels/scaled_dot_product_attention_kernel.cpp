@@ -0,0 +1,363 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <vector>
+#include "oneflow/core/framework/framework.h"
+#include "oneflow/core/ep/cpu/cpu_stream.h"
+
+namespace oneflow {
+
+namespace {
+
+// The attention matrix is processed in blocks of kBlockSizeQ queries and kBlockSizeK keys, so that
+// only a block of scores lives in the cache at a time instead of the whole seqlen_q x seqlen_k
+// matrix.
+constexpr int64_t kBlockSizeQ = 64;
+constexpr int64_t kBlockSizeK = 128;
+
+// query (batch_size x seqlen_q x num_heads x head_size)
+// key   (batch_size x seqlen_k x num_heads_k x head_size)
+// value (batch_size x seqlen_k x num_heads_k x head_size)
+// attn_mask (batch_size or 1, num_heads or 1, seqlen_q, seqlen_k), added to the scaled scores
+struct AttentionParams {
+  int64_t batch_size;
+  int64_t seqlen_q;
+  int64_t seqlen_k;
+  int64_t num_heads;
+  int64_t num_heads_k;
+  int64_t head_size;
+  float scale;
+  bool is_causal;
+  int64_t mask_batch_stride;
+  int64_t mask_head_stride;
+};
+
+AttentionParams MakeAttentionParams(user_op::KernelComputeContext* ctx) {
+  const ShapeView& q_shape = ctx->Tensor4ArgNameAndIndex("query", 0)->shape_view();
+  const ShapeView& k_shape = ctx->Tensor4ArgNameAndIndex("key", 0)->shape_view();
+  AttentionParams params{};
+  params.batch_size = q_shape.At(0);
+  params.seqlen_q = q_shape.At(1);
+  params.num_heads = q_shape.At(2);
+  params.head_size = q_shape.At(3);
+  params.seqlen_k = k_shape.At(1);
+  params.num_heads_k = k_shape.At(2);
+  params.scale = ctx->Attr<float>("softmax_scale");
+  params.is_causal = ctx->Attr<bool>("is_causal");
+  if (ctx->has_input("attn_mask", 0)) {
+    const ShapeView& mask_shape = ctx->Tensor4ArgNameAndIndex("attn_mask", 0)->shape_view();
+    const int64_t matrix_size = params.seqlen_q * params.seqlen_k;
+    params.mask_head_stride = mask_shape.At(1) == 1 ? 0 : matrix_size;
+    params.mask_batch_stride = mask_shape.At(0) == 1 ? 0 : mask_shape.At(1) * matrix_size;
+  }
+  return params;
+}
+
+// The causal mask is aligned to the bottom right corner of the attention matrix as the cuda
+// kernel does, the query at row attends to the keys up to the returned position.
+int64_t CausalLastKey(const AttentionParams& params, int64_t row) {
+  return row + params.seqlen_k - params.seqlen_q;
+}
+
+template<typename T>
+struct HeadPtrs {
+  const T* query;
+  const T* key;
+  const T* value;
+  const T* mask;
+  int64_t q_row_stride;
+  int64_t kv_row_stride;
+};
+
+template<typename T>
+HeadPtrs<T> MakeHeadPtrs(const AttentionParams& params, const T* query, const T* key,
+                         const T* value, const T* mask, int64_t batch, int64_t head) {
+  const int64_t head_k = head / (params.num_heads / params.num_heads_k);
+  HeadPtrs<T> ptrs{};
+  ptrs.q_row_stride = params.num_heads * params.head_size;
+  ptrs.kv_row_stride = params.num_heads_k * params.head_size;
+  ptrs.query = query + batch * params.seqlen_q * ptrs.q_row_stride + head * params.head_size;
+  const int64_t kv_offset =
+      batch * params.seqlen_k * ptrs.kv_row_stride + head_k * params.head_size;
+  ptrs.key = key + kv_offset;
+  ptrs.value = value + kv_offset;
+  ptrs.mask = mask == nullptr
+                  ? nullptr
+                  : mask + batch * params.mask_batch_stride + head * params.mask_head_stride;
+  return ptrs;
+}
+
+template<typename T>
+T Dot(const T* x, const T* y, int64_t n) {
+  T sum = 0;
+  for (int64_t i = 0; i < n; ++i) { sum += x[i] * y[i]; }
+  return sum;
+}
+
+template<typename T>
+void Axpy(T alpha, const T* x, T* y, int64_t n) {
+  for (int64_t i = 0; i < n; ++i) { y[i] += alpha * x[i]; }
+}
+
+// scores[i][j] = scale * query[i] . key[j] + mask[i][j], -inf for the keys masked by causality
+template<typename T>
+void ComputeScores(const AttentionParams& params, const HeadPtrs<T>& ptrs, int64_t q_begin,
+                   int64_t q_end, int64_t k_begin, int64_t k_end, T* scores) {
+  const T scale = static_cast<T>(params.scale);
+  for (int64_t i = q_begin; i < q_end; ++i) {
+    const T* q_row = ptrs.query + i * ptrs.q_row_stride;
+    T* score_row = scores + (i - q_begin) * kBlockSizeK;
+    const int64_t last_key =
+        params.is_causal ? std::min(k_end - 1, CausalLastKey(params, i)) : k_end - 1;
+    for (int64_t j = k_begin; j <= last_key; ++j) {
+      score_row[j - k_begin] =
+          scale * Dot(q_row, ptrs.key + j * ptrs.kv_row_stride, params.head_size);
+    }
+    if (ptrs.mask != nullptr) {
+      const T* mask_row = ptrs.mask + i * params.seqlen_k;
+      for (int64_t j = k_begin; j <= last_key; ++j) { score_row[j - k_begin] += mask_row[j]; }
+    }
+    for (int64_t j = std::max(k_begin, last_key + 1); j < k_end; ++j) {
+      score_row[j - k_begin] = -std::numeric_limits<T>::infinity();
+    }
+  }
+}
+
+// The keys after the returned position are masked for all the queries before q_end
+int64_t KeyEnd(const AttentionParams& params, int64_t q_end) {
+  if (!params.is_causal) { return params.seqlen_k; }
+  return std::max<int64_t>(std::min(params.seqlen_k, CausalLastKey(params, q_end - 1) + 1), 0);
+}
+
+template<typename T>
+class CpuScaledDotProductFlashAttentionKernel final : public user_op::OpKernel {
+ public:
+  CpuScaledDotProductFlashAttentionKernel() = default;
+  ~CpuScaledDotProductFlashAttentionKernel() override = default;
+
+ private:
+  using user_op::OpKernel::Compute;
+  void Compute(user_op::KernelComputeContext* ctx) const override {
+    CHECK_EQ(ctx->Attr<float>("p_dropout"), 0.0f)
+        << "scaled_dot_product_flash_attention does not support dropout on cpu";
+    const AttentionParams params = MakeAttentionParams(ctx);
+    const T* query = ctx->Tensor4ArgNameAndIndex("query", 0)->dptr<T>();
+    const T* key = ctx->Tensor4ArgNameAndIndex("key", 0)->dptr<T>();
+    const T* value = ctx->Tensor4ArgNameAndIndex("value", 0)->dptr<T>();
+    const T* mask = ctx->has_input("attn_mask", 0)
+                        ? ctx->Tensor4ArgNameAndIndex("attn_mask", 0)->dptr<T>()
+                        : nullptr;
+    T* out = ctx->Tensor4ArgNameAndIndex("out", 0)->mut_dptr<T>();
+    float* softmax_lse = ctx->Tensor4ArgNameAndIndex("softmax_lse", 0)->mut_dptr<float>();
+    user_op::Tensor* rng_state = ctx->Tensor4ArgNameAndIndex("rng_state", 0);
+    std::fill_n(rng_state->mut_dptr<uint64_t>(), rng_state->shape_view().elem_cnt(), 0);
+
+    const int64_t head_size = params.head_size;
+    const int64_t num_q_blocks = (params.seqlen_q + kBlockSizeQ - 1) / kBlockSizeQ;
+    auto* cpu_stream = ctx->stream()->As<ep::CpuStream>();
+    cpu_stream->ParallelFor(
+        0, params.batch_size * params.num_heads * num_q_blocks,
+        [&](int64_t begin, int64_t end) {
+          std::vector<T> scores(kBlockSizeQ * kBlockSizeK);
+          std::vector<T> acc(kBlockSizeQ * head_size);
+          std::vector<T> row_max(kBlockSizeQ);
+          std::vector<T> row_sum(kBlockSizeQ);
+          for (int64_t task = begin; task < end; ++task) {
+            const int64_t q_block = task % num_q_blocks;
+            const int64_t head = task / num_q_blocks % params.num_heads;
+            const int64_t batch = task / num_q_blocks / params.num_heads;
+            const HeadPtrs<T> ptrs = MakeHeadPtrs(params, query, key, value, mask, batch, head);
+            const int64_t q_begin = q_block * kBlockSizeQ;
+            const int64_t q_end = std::min(q_begin + kBlockSizeQ, params.seqlen_q);
+            const int64_t rows = q_end - q_begin;
+            std::fill_n(acc.begin(), rows * head_size, static_cast<T>(0));
+            std::fill_n(row_max.begin(), rows, -std::numeric_limits<T>::infinity());
+            std::fill_n(row_sum.begin(), rows, static_cast<T>(0));
+            const int64_t key_end = KeyEnd(params, q_end);
+            for (int64_t k_begin = 0; k_begin < key_end; k_begin += kBlockSizeK) {
+              const int64_t k_end = std::min(k_begin + kBlockSizeK, key_end);
+              ComputeScores(params, ptrs, q_begin, q_end, k_begin, k_end, scores.data());
+              // online softmax: rescale the partial results with the new running max
+              for (int64_t i = 0; i < rows; ++i) {
+                T* score_row = scores.data() + i * kBlockSizeK;
+                T new_max = row_max[i];
+                for (int64_t j = 0; j < k_end - k_begin; ++j) {
+                  new_max = std::max(new_max, score_row[j]);
+                }
+                if (new_max == -std::numeric_limits<T>::infinity()) { continue; }
+                const T correction = std::exp(row_max[i] - new_max);
+                T* acc_row = acc.data() + i * head_size;
+                for (int64_t d = 0; d < head_size; ++d) { acc_row[d] *= correction; }
+                T block_sum = 0;
+                for (int64_t j = 0; j < k_end - k_begin; ++j) {
+                  const T p = std::exp(score_row[j] - new_max);
+                  block_sum += p;
+                  if (p != 0) {
+                    Axpy(p, ptrs.value + (k_begin + j) * ptrs.kv_row_stride, acc_row, head_size);
+                  }
+                }
+                row_sum[i] = row_sum[i] * correction + block_sum;
+                row_max[i] = new_max;
+              }
+            }
+            for (int64_t i = 0; i < rows; ++i) {
+              const int64_t row = q_begin + i;
+              T* out_row = out + (batch * params.seqlen_q + row) * ptrs.q_row_stride
+                           + head * head_size;
+              const T* acc_row = acc.data() + i * head_size;
+              float* lse =
+                  softmax_lse + (batch * params.num_heads + head) * params.seqlen_q + row;
+              if (row_sum[i] > 0) {
+                const T inv_sum = static_cast<T>(1) / row_sum[i];
+                for (int64_t d = 0; d < head_size; ++d) { out_row[d] = acc_row[d] * inv_sum; }
+                *lse = static_cast<float>(row_max[i] + std::log(row_sum[i]));
+              } else {
+                // all the keys are masked
+                std::fill_n(out_row, head_size, static_cast<T>(0));
+                *lse = std::numeric_limits<float>::infinity();
+              }
+            }
+          }
+        },
+        1);
+  }
+
+  bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
+};
+
+template<typename T>
+class CpuScaledDotProductFlashAttentionGradKernel final : public user_op::OpKernel {
+ public:
+  CpuScaledDotProductFlashAttentionGradKernel() = default;
+  ~CpuScaledDotProductFlashAttentionGradKernel() override = default;
+
+ private:
+  using user_op::OpKernel::Compute;
+  void Compute(user_op::KernelComputeContext* ctx) const override {
+    CHECK_EQ(ctx->Attr<float>("p_dropout"), 0.0f)
+        << "scaled_dot_product_flash_attention_grad does not support dropout on cpu";
+    const AttentionParams params = MakeAttentionParams(ctx);
+    const T* grad_out = ctx->Tensor4ArgNameAndIndex("grad_out", 0)->dptr<T>();
+    const T* query = ctx->Tensor4ArgNameAndIndex("query", 0)->dptr<T>();
+    const T* key = ctx->Tensor4ArgNameAndIndex("key", 0)->dptr<T>();
+    const T* value = ctx->Tensor4ArgNameAndIndex("value", 0)->dptr<T>();
+    const T* out = ctx->Tensor4ArgNameAndIndex("out", 0)->dptr<T>();
+    const float* softmax_lse = ctx->Tensor4ArgNameAndIndex("softmax_lse", 0)->dptr<float>();
+    const T* mask = ctx->has_input("attn_mask", 0)
+                        ? ctx->Tensor4ArgNameAndIndex("attn_mask", 0)->dptr<T>()
+                        : nullptr;
+    // grad_k and grad_v are expanded to num_heads, and reduced by the functional
+    T* grad_q = ctx->Tensor4ArgNameAndIndex("grad_q", 0)->mut_dptr<T>();
+    T* grad_k = ctx->Tensor4ArgNameAndIndex("grad_k", 0)->mut_dptr<T>();
+    T* grad_v = ctx->Tensor4ArgNameAndIndex("grad_v", 0)->mut_dptr<T>();
+
+    const int64_t head_size = params.head_size;
+    const T scale = static_cast<T>(params.scale);
+    auto* cpu_stream = ctx->stream()->As<ep::CpuStream>();
+    // Each task owns the gradients of a head, the gradient of the query is accumulated over the
+    // key blocks in a buffer of seqlen_q x head_size.
+    cpu_stream->ParallelFor(
+        0, params.batch_size * params.num_heads,
+        [&](int64_t begin, int64_t end) {
+          std::vector<T> scores(kBlockSizeQ * kBlockSizeK);
+          std::vector<T> dq(params.seqlen_q * head_size);
+          std::vector<T> dk(kBlockSizeK * head_size);
+          std::vector<T> dv(kBlockSizeK * head_size);
+          std::vector<T> delta(params.seqlen_q);
+          for (int64_t task = begin; task < end; ++task) {
+            const int64_t head = task % params.num_heads;
+            const int64_t batch = task / params.num_heads;
+            const HeadPtrs<T> ptrs = MakeHeadPtrs(params, query, key, value, mask, batch, head);
+            const int64_t out_offset =
+                batch * params.seqlen_q * ptrs.q_row_stride + head * head_size;
+            const T* grad_out_head = grad_out + out_offset;
+            const T* out_head = out + out_offset;
+            const float* lse = softmax_lse + (batch * params.num_heads + head) * params.seqlen_q;
+            // delta[i] = grad_out[i] . out[i], which is the sum of p[i][j] * dp[i][j]
+            for (int64_t i = 0; i < params.seqlen_q; ++i) {
+              delta[i] = Dot(grad_out_head + i * ptrs.q_row_stride,
+                             out_head + i * ptrs.q_row_stride, head_size);
+            }
+            std::fill(dq.begin(), dq.end(), static_cast<T>(0));
+            for (int64_t k_begin = 0; k_begin < params.seqlen_k; k_begin += kBlockSizeK) {
+              const int64_t k_end = std::min(k_begin + kBlockSizeK, params.seqlen_k);
+              std::fill(dk.begin(), dk.end(), static_cast<T>(0));
+              std::fill(dv.begin(), dv.end(), static_cast<T>(0));
+              // skip the queries which attend none of the keys in the block
+              int64_t q_start = 0;
+              if (params.is_causal) {
+                q_start = std::max<int64_t>(k_begin - (params.seqlen_k - params.seqlen_q), 0);
+              }
+              for (int64_t q_begin = q_start; q_begin < params.seqlen_q; q_begin += kBlockSizeQ) {
+                const int64_t q_end = std::min(q_begin + kBlockSizeQ, params.seqlen_q);
+                ComputeScores(params, ptrs, q_begin, q_end, k_begin, k_end, scores.data());
+                for (int64_t i = q_begin; i < q_end; ++i) {
+                  if (std::isinf(lse[i])) { continue; }
+                  const T* score_row = scores.data() + (i - q_begin) * kBlockSizeK;
+                  const T* q_row = ptrs.query + i * ptrs.q_row_stride;
+                  const T* grad_out_row = grad_out_head + i * ptrs.q_row_stride;
+                  T* dq_row = dq.data() + i * head_size;
+                  for (int64_t j = k_begin; j < k_end; ++j) {
+                    const T p = std::exp(score_row[j - k_begin] - static_cast<T>(lse[i]));
+                    if (p == 0) { continue; }
+                    const T* k_row = ptrs.key + j * ptrs.kv_row_stride;
+                    const T* v_row = ptrs.value + j * ptrs.kv_row_stride;
+                    // dv[j] += p[i][j] * grad_out[i]
+                    Axpy(p, grad_out_row, dv.data() + (j - k_begin) * head_size, head_size);
+                    // ds[i][j] = p[i][j] * (grad_out[i] . v[j] - delta[i])
+                    const T ds = p * (Dot(grad_out_row, v_row, head_size) - delta[i]) * scale;
+                    Axpy(ds, k_row, dq_row, head_size);
+                    Axpy(ds, q_row, dk.data() + (j - k_begin) * head_size, head_size);
+                  }
+                }
+              }
+              for (int64_t j = k_begin; j < k_end; ++j) {
+                const int64_t offset = (batch * params.seqlen_k + j) * ptrs.q_row_stride
+                                       + head * head_size;
+                std::copy_n(dk.data() + (j - k_begin) * head_size, head_size, grad_k + offset);
+                std::copy_n(dv.data() + (j - k_begin) * head_size, head_size, grad_v + offset);
+              }
+            }
+            for (int64_t i = 0; i < params.seqlen_q; ++i) {
+              std::copy_n(dq.data() + i * head_size, head_size,
+                          grad_q + out_offset + i * ptrs.q_row_stride);
+            }
+          }
+        },
+        1);
+  }
+
+  bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
+};
+
+}  // namespace
+
+#define REGISTER_CPU_SCALED_DOT_PRODUCT_FLASH_ATTENTION_KERNEL(dtype, cpp_type) \
+  REGISTER_USER_KERNEL("scaled_dot_product_flash_attention")                  \
+      .SetCreateFn<CpuScaledDotProductFlashAttentionKernel<cpp_type>>()       \
+      .SetIsMatchedHob((user_op::HobDeviceType() == DeviceType::kCPU)         \
+                       && (user_op::HobDataType("out", 0) == dtype));         \
+  REGISTER_USER_KERNEL("scaled_dot_product_flash_attention_grad")             \
+      .SetCreateFn<CpuScaledDotProductFlashAttentionGradKernel<cpp_type>>()   \
+      .SetIsMatchedHob((user_op::HobDeviceType() == DeviceType::kCPU)         \
+                       && (user_op::HobDataType("grad_q", 0) == dtype));
+
+REGISTER_CPU_SCALED_DOT_PRODUCT_FLASH_ATTENTION_KERNEL(DataType::kFloat, float)
+REGISTER_CPU_SCALED_DOT_PRODUCT_FLASH_ATTENTION_KERNEL(DataType::kDouble, double)
+
+}  // namespace oneflow
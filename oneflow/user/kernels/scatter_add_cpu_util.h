@@ -0,0 +1,181 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_USER_KERNELS_SCATTER_ADD_CPU_UTIL_H_
+#define ONEFLOW_USER_KERNELS_SCATTER_ADD_CPU_UTIL_H_
+
+#include <algorithm>
+#include <vector>
+#include "oneflow/core/ep/cpu/cpu_stream.h"
+
+namespace oneflow {
+
+namespace scatter_add {
+
+// Number of elements handled by a task, smaller problems are done on the calling thread since the
+// thread pool may not honor the grain size.
+constexpr int64_t kCpuGrain = 32768;
+
+// Rows of at least 2 * kCpuMinColumns elements are split by columns among the tasks.
+constexpr int64_t kCpuMinColumns = 256;
+
+// When there are at least kCpuMaxPartials source rows per destination row, every task adds its
+// rows to a private copy of the destination and the copies are summed at the end. The number of
+// copies doesn't depend on the number of threads, so neither does the result.
+constexpr int64_t kCpuMaxPartials = 64;
+
+// Bucketing reads the destination of every row three times and moves the row ids around, which
+// is about three times the work of the serial loop, so it needs at least kCpuMinBucketThreads
+// threads to pay off.
+constexpr int64_t kCpuMinBucketThreads = 4;
+
+template<typename T>
+void AddRow(const T* src, const T alpha, const int64_t n, T* dst) {
+  for (int64_t i = 0; i < n; ++i) { dst[i] += alpha * src[i]; }
+}
+
+// Adds alpha times the i-th of the num_rows source rows of row_size elements to the row
+// GetDstRow(i) of dst, rows mapped to a negative destination are dropped. The destination rows
+// are written by a single task at a time and always receive their source rows in order, so the
+// result is the one of the serial loop except in the privatized case, where the sum is
+// reassociated in a fixed order:
+// - wide rows split the columns among the tasks,
+// - dense scatters (many source rows per destination row) accumulate in private copies,
+// - other scatters bucket the source rows by owner of their destination rows with a stable
+//   counting sort, each task owning a contiguous range of destination rows.
+template<typename T, typename F>
+void CpuScatterAddRows(ep::Stream* stream, const int64_t num_rows, const int64_t row_size,
+                       const int64_t num_dst_rows, const F& GetDstRow, const T* src,
+                       const T alpha, T* dst) {
+  auto* cpu_stream = stream->As<ep::CpuStream>();
+  const int64_t num_threads = cpu_stream->device()->GetNumThreads();
+  auto ScatterSerially = [&]() {
+    for (int64_t i = 0; i < num_rows; ++i) {
+      const int64_t dst_row = GetDstRow(i);
+      if (dst_row >= 0) { AddRow(src + i * row_size, alpha, row_size, dst + dst_row * row_size); }
+    }
+  };
+  if (num_rows * row_size <= kCpuGrain || num_threads <= 1 || num_dst_rows == 0) {
+    ScatterSerially();
+    return;
+  }
+  if (row_size >= 2 * kCpuMinColumns) {
+    const int64_t num_column_blocks = (row_size + kCpuMinColumns - 1) / kCpuMinColumns;
+    auto add_columns = [&](int64_t begin, int64_t end) {
+      const int64_t col_begin = begin * kCpuMinColumns;
+      const int64_t num_cols = std::min(end * kCpuMinColumns, row_size) - col_begin;
+      for (int64_t i = 0; i < num_rows; ++i) {
+        const int64_t dst_row = GetDstRow(i);
+        if (dst_row < 0) { continue; }
+        AddRow(src + i * row_size + col_begin, alpha, num_cols,
+               dst + dst_row * row_size + col_begin);
+      }
+    };
+    cpu_stream->ParallelFor(0, num_column_blocks, add_columns, 1);
+    return;
+  }
+
+  if (num_dst_rows * kCpuMaxPartials <= num_rows) {
+    const int64_t dst_elem_cnt = num_dst_rows * row_size;
+    const int64_t rows_per_partial = (num_rows + kCpuMaxPartials - 1) / kCpuMaxPartials;
+    std::vector<T> partials(kCpuMaxPartials * dst_elem_cnt, static_cast<T>(0));
+    cpu_stream->ParallelFor(
+        0, kCpuMaxPartials,
+        [&](int64_t begin, int64_t end) {
+          for (int64_t p = begin; p < end; ++p) {
+            T* partial = partials.data() + p * dst_elem_cnt;
+            const int64_t row_end = std::min((p + 1) * rows_per_partial, num_rows);
+            for (int64_t i = p * rows_per_partial; i < row_end; ++i) {
+              const int64_t dst_row = GetDstRow(i);
+              if (dst_row < 0) { continue; }
+              AddRow(src + i * row_size, alpha, row_size, partial + dst_row * row_size);
+            }
+          }
+        },
+        1);
+    cpu_stream->ParallelFor(
+        0, dst_elem_cnt,
+        [&](int64_t begin, int64_t end) {
+          for (int64_t p = 0; p < kCpuMaxPartials; ++p) {
+            const T* partial = partials.data() + p * dst_elem_cnt;
+            for (int64_t i = begin; i < end; ++i) { dst[i] += partial[i]; }
+          }
+        },
+        kCpuGrain);
+    return;
+  }
+
+  if (num_threads < kCpuMinBucketThreads) {
+    ScatterSerially();
+    return;
+  }
+  const int64_t num_buckets = std::min(num_dst_rows, 4 * num_threads);
+  const int64_t num_chunks = num_threads;
+  const int64_t chunk_size = (num_rows + num_chunks - 1) / num_chunks;
+  auto GetBucket = [&](int64_t dst_row) { return dst_row * num_buckets / num_dst_rows; };
+  // Slot c * num_buckets + b counts, then places, the rows of chunk c going to bucket b.
+  std::vector<int64_t> slots(num_chunks * num_buckets, 0);
+  cpu_stream->ParallelFor(
+      0, num_chunks,
+      [&](int64_t begin, int64_t end) {
+        for (int64_t c = begin; c < end; ++c) {
+          const int64_t row_end = std::min((c + 1) * chunk_size, num_rows);
+          for (int64_t i = c * chunk_size; i < row_end; ++i) {
+            const int64_t dst_row = GetDstRow(i);
+            if (dst_row >= 0) { slots[c * num_buckets + GetBucket(dst_row)] += 1; }
+          }
+        }
+      },
+      1);
+  std::vector<int64_t> bucket_offsets(num_buckets + 1);
+  int64_t offset = 0;
+  for (int64_t b = 0; b < num_buckets; ++b) {
+    bucket_offsets[b] = offset;
+    for (int64_t c = 0; c < num_chunks; ++c) {
+      const int64_t count = slots[c * num_buckets + b];
+      slots[c * num_buckets + b] = offset;
+      offset += count;
+    }
+  }
+  bucket_offsets[num_buckets] = offset;
+  std::vector<int64_t> sorted_rows(offset);
+  cpu_stream->ParallelFor(
+      0, num_chunks,
+      [&](int64_t begin, int64_t end) {
+        for (int64_t c = begin; c < end; ++c) {
+          const int64_t row_end = std::min((c + 1) * chunk_size, num_rows);
+          for (int64_t i = c * chunk_size; i < row_end; ++i) {
+            const int64_t dst_row = GetDstRow(i);
+            if (dst_row >= 0) { sorted_rows[slots[c * num_buckets + GetBucket(dst_row)]++] = i; }
+          }
+        }
+      },
+      1);
+  cpu_stream->ParallelFor(
+      0, num_buckets,
+      [&](int64_t begin, int64_t end) {
+        for (int64_t k = bucket_offsets[begin]; k < bucket_offsets[end]; ++k) {
+          const int64_t i = sorted_rows[k];
+          AddRow(src + i * row_size, alpha, row_size, dst + GetDstRow(i) * row_size);
+        }
+      },
+      1);
+}
+
+}  // namespace scatter_add
+
+}  // namespace oneflow
+
+#endif  // ONEFLOW_USER_KERNELS_SCATTER_ADD_CPU_UTIL_H_
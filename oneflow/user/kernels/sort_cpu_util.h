@@ -0,0 +1,133 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#ifndef ONEFLOW_USER_KERNELS_SORT_CPU_UTIL_H_
+#define ONEFLOW_USER_KERNELS_SORT_CPU_UTIL_H_
+
+#include <algorithm>
+#include "oneflow/core/ep/cpu/cpu_stream.h"
+
+namespace oneflow {
+
+// Number of elements sorted by a task of the cpu sort kernels.
+constexpr int64_t kCpuSortGrain = 32768;
+
+// Instances of at least this size are sorted by a parallel merge sort when there are fewer
+// instances than threads, instead of sorting each instance on a single thread.
+constexpr int64_t kCpuParallelMergeSortMinSize = 4 * kCpuSortGrain;
+
+inline int64_t GetCpuSortNumThreads(ep::Stream* stream) {
+  return static_cast<int64_t>(stream->As<ep::CpuStream>()->device()->GetNumThreads());
+}
+
+// Returns the number of elements of a that come before the k-th element of merge(a, b, comp),
+// std::merge takes from a on ties.
+template<typename T, typename Comp>
+int64_t MergeCoRank(const T* a, int64_t a_size, const T* b, int64_t b_size, int64_t k,
+                    const Comp& comp) {
+  int64_t lo = std::max<int64_t>(k - b_size, 0);
+  int64_t hi = std::min(k, a_size);
+  while (lo < hi) {
+    const int64_t i = (lo + hi) / 2;
+    if (comp(b[k - i - 1], a[i])) {
+      hi = i;
+    } else {
+      lo = i + 1;
+    }
+  }
+  return lo;
+}
+
+// Sorts a single instance of size elements with a parallel merge sort: the chunks of the instance
+// are sorted in parallel, then runs are merged pairwise, each merge being split by co-ranking so
+// that the last rounds with few runs still use all the threads. buffer holds size elements.
+template<typename T, typename Comp>
+void ParallelMergeSort(ep::Stream* stream, T* data, T* buffer, int64_t size, const Comp& comp) {
+  auto* cpu_stream = stream->As<ep::CpuStream>();
+  const int64_t num_threads = GetCpuSortNumThreads(stream);
+  const int64_t num_chunks = std::max<int64_t>(
+      std::min(num_threads, (size + kCpuSortGrain - 1) / kCpuSortGrain), 1);
+  const int64_t chunk_size = (size + num_chunks - 1) / num_chunks;
+  cpu_stream->ParallelFor(
+      0, num_chunks,
+      [&](int64_t begin, int64_t end) {
+        for (int64_t chunk = begin; chunk < end; ++chunk) {
+          const int64_t lo = std::min(chunk * chunk_size, size);
+          const int64_t hi = std::min(lo + chunk_size, size);
+          std::sort(data + lo, data + hi, comp);
+        }
+      },
+      1);
+  T* src = data;
+  T* dst = buffer;
+  for (int64_t width = chunk_size; width < size; width *= 2) {
+    const int64_t num_pairs = (size + 2 * width - 1) / (2 * width);
+    const int64_t parts_per_pair = std::max<int64_t>(num_threads / num_pairs, 1);
+    cpu_stream->ParallelFor(
+        0, num_pairs * parts_per_pair,
+        [&](int64_t begin, int64_t end) {
+          for (int64_t task = begin; task < end; ++task) {
+            const int64_t lo = (task / parts_per_pair) * 2 * width;
+            const int64_t mid = std::min(lo + width, size);
+            const int64_t hi = std::min(lo + 2 * width, size);
+            const int64_t part = task % parts_per_pair;
+            const int64_t k_begin = (hi - lo) * part / parts_per_pair;
+            const int64_t k_end = (hi - lo) * (part + 1) / parts_per_pair;
+            const T* a = src + lo;
+            const T* b = src + mid;
+            const int64_t a_begin = MergeCoRank(a, mid - lo, b, hi - mid, k_begin, comp);
+            const int64_t a_end = MergeCoRank(a, mid - lo, b, hi - mid, k_end, comp);
+            std::merge(a + a_begin, a + a_end, b + (k_begin - a_begin), b + (k_end - a_end),
+                       dst + lo + k_begin, comp);
+          }
+        },
+        1);
+    std::swap(src, dst);
+  }
+  if (src != data) {
+    cpu_stream->ParallelFor(
+        0, size,
+        [&](int64_t begin, int64_t end) { std::copy(src + begin, src + end, data + begin); },
+        kCpuSortGrain);
+  }
+}
+
+// Sorts each of the instance_num instances of data in place with get_comp(instance_idx). The
+// instances are spread over the threads of the cpu stream, or each sorted by ParallelMergeSort
+// when there are too few of them to keep the threads busy. buffer holds instance_size elements.
+template<typename T, typename GetComp>
+void CpuSortInstances(ep::Stream* stream, T* data, T* buffer, int64_t instance_num,
+                      int64_t instance_size, const GetComp& get_comp) {
+  if (instance_num < GetCpuSortNumThreads(stream)
+      && instance_size >= kCpuParallelMergeSortMinSize) {
+    for (int64_t i = 0; i < instance_num; ++i) {
+      ParallelMergeSort(stream, data + i * instance_size, buffer, instance_size, get_comp(i));
+    }
+    return;
+  }
+  stream->As<ep::CpuStream>()->ParallelFor(
+      0, instance_num,
+      [&](int64_t begin, int64_t end) {
+        for (int64_t i = begin; i < end; ++i) {
+          T* data_i = data + i * instance_size;
+          std::sort(data_i, data_i + instance_size, get_comp(i));
+        }
+      },
+      std::max<int64_t>(kCpuSortGrain / std::max<int64_t>(instance_size, 1), 1));
+}
+
+}  // namespace oneflow
+
+#endif  // ONEFLOW_USER_KERNELS_SORT_CPU_UTIL_H_
@@ -15,6 +15,7 @@ limitations under the License.
 */
 #include "oneflow/core/framework/framework.h"
 #include "oneflow/core/kernel/new_kernel_util.h"
+#include "oneflow/user/kernels/sort_cpu_util.h"
 
 namespace oneflow {
 
@@ -28,32 +29,37 @@ class CpuSortKernel final : public user_op::OpKernel {
   void Compute(user_op::KernelComputeContext* ctx) const override {
     const user_op::Tensor* in = ctx->Tensor4ArgNameAndIndex("in", 0);
     user_op::Tensor* out = ctx->Tensor4ArgNameAndIndex("out", 0);
+    user_op::Tensor* tmp_buffer = ctx->Tensor4ArgNameAndIndex("tmp_buffer", 0);
 
     Memcpy<DeviceType::kCPU>(ctx->stream(), out->mut_dptr<T>(), in->dptr<T>(),
                              in->shape_view().elem_cnt() * sizeof(T));
-    const int32_t instance_size = in->shape_view().At(in->shape_view().NumAxes() - 1);
-    const int32_t instance_num = in->shape_view().elem_cnt() / instance_size;
+    const int64_t instance_size = in->shape_view().At(in->shape_view().NumAxes() - 1);
+    const int64_t instance_num = in->shape_view().elem_cnt() / instance_size;
     const std::string& direction = ctx->Attr<std::string>("direction");
     const bool is_ascending = direction == "ASCENDING";
     const bool is_descending = direction == "DESCENDING";
-    FOR_RANGE(int32_t, i, 0, instance_num) {
-      T* out_ptr_i = out->mut_dptr<T>() + i * instance_size;
-      if (is_ascending) {
-        std::sort(out_ptr_i, out_ptr_i + instance_size, std::less<T>());
-      } else if (is_descending) {
-        std::sort(out_ptr_i, out_ptr_i + instance_size, std::greater<T>());
-      } else {
-        UNIMPLEMENTED();
-      }
+    if (is_ascending) {
+      CpuSortInstances(ctx->stream(), out->mut_dptr<T>(), tmp_buffer->mut_dptr<T>(), instance_num,
+                       instance_size, [](int64_t) { return std::less<T>(); });
+    } else if (is_descending) {
+      CpuSortInstances(ctx->stream(), out->mut_dptr<T>(), tmp_buffer->mut_dptr<T>(), instance_num,
+                       instance_size, [](int64_t) { return std::greater<T>(); });
+    } else {
+      UNIMPLEMENTED();
     }
   }
   bool AlwaysComputeWhenAllOutputsEmpty() const override { return false; }
 };
 
-#define REGISTER_CPU_SORT_KERNEL(dtype)                                             \
-  REGISTER_USER_KERNEL("sort").SetCreateFn<CpuSortKernel<dtype>>().SetIsMatchedHob( \
-      (user_op::HobDeviceType() == DeviceType::kCPU)                                \
-      && (user_op::HobDataType("out", 0) == GetDataType<dtype>::value));
+#define REGISTER_CPU_SORT_KERNEL(dtype)                                                  \
+  REGISTER_USER_KERNEL("sort")                                                           \
+      .SetCreateFn<CpuSortKernel<dtype>>()                                               \
+      .SetIsMatchedHob((user_op::HobDeviceType() == DeviceType::kCPU)                    \
+                       && (user_op::HobDataType("out", 0) == GetDataType<dtype>::value)) \
+      .SetInferTmpSizeFn([](user_op::InferContext* ctx) -> size_t {                      \
+        const Shape& in_shape = ctx->InputShape("in", 0);                                \
+        return in_shape.At(in_shape.NumAxes() - 1) * sizeof(dtype);                      \
+      });
 
 REGISTER_CPU_SORT_KERNEL(float)
 REGISTER_CPU_SORT_KERNEL(double)
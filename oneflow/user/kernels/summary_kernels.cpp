@@ -111,8 +111,8 @@ class SummaryWriteHistogram final : public user_op::OpKernel {
     int8_t* ctag = const_cast<int8_t*>(tag->dptr<int8_t>());
     CHECK_NOTNULL(ctag);
     std::string tag_str(reinterpret_cast<char*>(ctag), tag->shape_view().elem_cnt());
-    EventWriterHelper<DeviceType::kCPU, T>::WriteHistogramToFile(static_cast<float>(istep[0]),
-                                                                 *value, tag_str);
+    EventWriterHelper<DeviceType::kCPU, T>::WriteHistogramToFile(
+        ctx->stream(), static_cast<float>(istep[0]), *value, tag_str);
   }
   bool AlwaysComputeWhenAllOutputsEmpty() const override { return true; }
 };
@@ -14,63 +14,156 @@ See the License for the specific language governing permissions and
 limitations under the License.
 */
 #include "oneflow/core/framework/framework.h"
-#include "oneflow/core/thread/thread_manager.h"
-#include "oneflow/core/common/balanced_splitter.h"
+#include "oneflow/core/ep/cpu/cpu_stream.h"
 
 namespace oneflow {
 
 namespace {
 
+// Number of elements scanned by a task of the cpu top_k kernel.
+constexpr int64_t kCpuTopKGrain = 32768;
+
+// The top k of an instance is selected with a bounded heap instead of nth_element over the
+// indices of the whole instance when k is at most 1 / kCpuTopKHeapRatio of the instance size.
+constexpr int64_t kCpuTopKHeapRatio = 16;
+
+// Instances of at least this size are split across the threads when there are fewer instances
+// than threads, each thread selects the top k of its chunk and the candidates are merged.
+constexpr int64_t kCpuTopKParallelMinSize = 4 * kCpuTopKGrain;
+
+// Returns true when the element at lhs comes before the element at rhs in the top k.
+template<typename T>
+struct TopKComp {
+  const T* in_ptr;
+  bool operator()(const int64_t lhs, const int64_t rhs) const {
+    const T l = in_ptr[lhs];
+    const T r = in_ptr[rhs];
+    if (l == r) {
+      return lhs < rhs;
+    } else {
+      return l > r;
+    }
+  }
+};
+
+// Keeps the top k of the indices in [begin, end) in a heap at heap_ptr whose front is the last of
+// them, and returns the size of the heap.
 template<typename T>
-void ComputeTopOne(const T* in_ptr, const Range& range, int64_t instance_size, int64_t* out_ptr) {
-  FOR_RANGE(int64_t, i, range.begin(), range.end()) {
-    const T* in_ptr_i = in_ptr + i * instance_size;
-    out_ptr[i] = std::distance(in_ptr_i, std::max_element(in_ptr_i, in_ptr_i + instance_size));
+int64_t HeapSelectTopK(const TopKComp<T>& comp, int64_t begin, int64_t end, int64_t k,
+                       int64_t* heap_ptr) {
+  int64_t heap_size = 0;
+  for (int64_t idx = begin; idx < end; ++idx) {
+    if (heap_size < k) {
+      heap_ptr[heap_size++] = idx;
+      std::push_heap(heap_ptr, heap_ptr + heap_size, comp);
+    } else if (comp(idx, heap_ptr[0])) {
+      std::pop_heap(heap_ptr, heap_ptr + heap_size, comp);
+      heap_ptr[heap_size - 1] = idx;
+      std::push_heap(heap_ptr, heap_ptr + heap_size, comp);
+    }
   }
+  return heap_size;
+}
+
+template<typename T>
+int64_t ArgMax(const T* in_ptr, int64_t begin, int64_t end) {
+  return std::distance(in_ptr, std::max_element(in_ptr + begin, in_ptr + end));
 }
 
 template<typename T>
-void ComputeTopK(const T* in_ptr, int64_t* indices_ptr, const Range& range, int64_t instance_size,
-                 int64_t k, bool sorted, int64_t* out_ptr) {
-  FOR_RANGE(int64_t, i, range.begin(), range.end()) {
-    const int64_t offset = i * instance_size;
-    const T* in_ptr_i = in_ptr + offset;
-    int64_t* indices_ptr_i = indices_ptr + offset;
+void ComputeTopK(const T* in_ptr_i, int64_t* indices_ptr_i, int64_t instance_size, int64_t k,
+                 bool sorted, int64_t* out_ptr_i) {
+  if (k == 1) {
+    out_ptr_i[0] = ArgMax(in_ptr_i, 0, instance_size);
+    return;
+  }
+  const TopKComp<T> comp{in_ptr_i};
+  if (k * kCpuTopKHeapRatio <= instance_size) {
+    HeapSelectTopK(comp, 0, instance_size, k, indices_ptr_i);
+    if (sorted) { std::sort_heap(indices_ptr_i, indices_ptr_i + k, comp); }
+  } else {
     std::iota(indices_ptr_i, indices_ptr_i + instance_size, 0);
-    auto comp = [&](const int64_t lhs, const int64_t rhs) {
-      const T l = in_ptr_i[lhs];
-      const T r = in_ptr_i[rhs];
-      if (l == r) {
-        return lhs < rhs;
-      } else {
-        return l > r;
-      }
-    };
     std::nth_element(indices_ptr_i, indices_ptr_i + k, indices_ptr_i + instance_size, comp);
     if (sorted) { std::sort(indices_ptr_i, indices_ptr_i + k, comp); }
-    std::copy(indices_ptr_i, indices_ptr_i + k, out_ptr + i * k);
   }
+  std::copy(indices_ptr_i, indices_ptr_i + k, out_ptr_i);
+}
+
+// Computes the top k of a single large instance with all the threads of the cpu stream.
+template<typename T>
+void ParallelComputeTopK(ep::CpuStream* cpu_stream, const T* in_ptr_i, int64_t* indices_ptr_i,
+                         int64_t instance_size, int64_t k, bool sorted, int64_t* out_ptr_i) {
+  const int64_t num_chunks = std::min(static_cast<int64_t>(cpu_stream->device()->GetNumThreads()),
+                                      instance_size / kCpuTopKGrain);
+  const int64_t chunk_size = (instance_size + num_chunks - 1) / num_chunks;
+  if (k == 1) {
+    std::vector<int64_t> chunk_argmax(num_chunks);
+    cpu_stream->ParallelFor(
+        0, num_chunks,
+        [&](int64_t chunk_begin, int64_t chunk_end) {
+          for (int64_t chunk = chunk_begin; chunk < chunk_end; ++chunk) {
+            const int64_t begin = chunk * chunk_size;
+            const int64_t end = std::min(begin + chunk_size, instance_size);
+            chunk_argmax[chunk] = ArgMax(in_ptr_i, begin, end);
+          }
+        },
+        1);
+    int64_t argmax = chunk_argmax[0];
+    for (const int64_t idx : chunk_argmax) {
+      if (in_ptr_i[idx] > in_ptr_i[argmax]) { argmax = idx; }
+    }
+    out_ptr_i[0] = argmax;
+    return;
+  }
+  // The candidates of a chunk are no more than its elements, so they are kept in the part of
+  // indices_ptr_i that belongs to the chunk.
+  std::vector<int64_t> num_candidates(num_chunks);
+  cpu_stream->ParallelFor(
+      0, num_chunks,
+      [&](int64_t chunk_begin, int64_t chunk_end) {
+        for (int64_t chunk = chunk_begin; chunk < chunk_end; ++chunk) {
+          const int64_t begin = chunk * chunk_size;
+          const int64_t end = std::min(begin + chunk_size, instance_size);
+          num_candidates[chunk] =
+              HeapSelectTopK(TopKComp<T>{in_ptr_i}, begin, end, k, indices_ptr_i + begin);
+        }
+      },
+      1);
+  const TopKComp<T> comp{in_ptr_i};
+  int64_t total_candidates = 0;
+  FOR_RANGE(int64_t, chunk, 0, num_chunks) {
+    const int64_t* candidates = indices_ptr_i + chunk * chunk_size;
+    std::copy(candidates, candidates + num_candidates[chunk], indices_ptr_i + total_candidates);
+    total_candidates += num_candidates[chunk];
+  }
+  std::nth_element(indices_ptr_i, indices_ptr_i + k, indices_ptr_i + total_candidates, comp);
+  if (sorted) { std::sort(indices_ptr_i, indices_ptr_i + k, comp); }
+  std::copy(indices_ptr_i, indices_ptr_i + k, out_ptr_i);
 }
 
 template<typename T>
-void CpuTopK(ep::Stream* /*stream*/, const T* in_ptr, int64_t* indices_ptr, int64_t instance_num,
+void CpuTopK(ep::Stream* stream, const T* in_ptr, int64_t* indices_ptr, int64_t instance_num,
              int64_t instance_size, int64_t k, bool sorted, int64_t* out_ptr) {
-  const int64_t num_thread =
-      std::min(instance_num, static_cast<int64_t>(Singleton<ThreadPool>::Get()->thread_num()));
-  const BalancedSplitter bs(instance_num, num_thread);
-  BlockingCounter bc(num_thread);
-  FOR_RANGE(int64_t, thread_id, 0, num_thread) {
-    const Range range = bs.At(thread_id);
-    Singleton<ThreadPool>::Get()->AddWork([=, &bc]() {
-      if (k == 1) {
-        ComputeTopOne(in_ptr, range, instance_size, out_ptr);
-      } else {
-        ComputeTopK(in_ptr, indices_ptr, range, instance_size, k, sorted, out_ptr);
-      }
-      bc.Decrease();
-    });
+  auto* cpu_stream = stream->As<ep::CpuStream>();
+  if (instance_num < static_cast<int64_t>(cpu_stream->device()->GetNumThreads())
+      && instance_size >= kCpuTopKParallelMinSize && k * kCpuTopKHeapRatio <= instance_size) {
+    FOR_RANGE(int64_t, i, 0, instance_num) {
+      ParallelComputeTopK(cpu_stream, in_ptr + i * instance_size,
+                          indices_ptr + i * instance_size, instance_size, k, sorted,
+                          out_ptr + i * k);
+    }
+    return;
   }
-  bc.WaitForeverUntilCntEqualZero();
+  cpu_stream->ParallelFor(
+      0, instance_num,
+      [&](int64_t begin, int64_t end) {
+        for (int64_t i = begin; i < end; ++i) {
+          ComputeTopK(in_ptr + i * instance_size,
+                      indices_ptr == nullptr ? nullptr : indices_ptr + i * instance_size,
+                      instance_size, k, sorted, out_ptr + i * k);
+        }
+      },
+      std::max<int64_t>(kCpuTopKGrain / instance_size, 1));
 }
 
 }  // namespace
@@ -14,9 +14,211 @@ See the License for the specific language governing permissions and
 limitations under the License.
 */
 #include "oneflow/user/kernels/unique_kernel_util.h"
+#include "oneflow/core/ep/cpu/cpu_stream.h"
 
 namespace oneflow {
 
+namespace {
+
+// Number of keys handled by a task of the cpu unique, smaller inputs are done on the calling
+// thread since the thread pool may not honor the grain size.
+constexpr int64_t kCpuUniqueGrain = 32768;
+
+// The keys are hashed once more on top of std::hash, which is the identity for integers, so that
+// both the high bits choosing the partition and the low bits choosing the slot are well mixed.
+template<typename KEY>
+uint64_t HashUniqueKey(KEY key) {
+  uint64_t h = std::hash<KEY>()(key);
+  h ^= h >> 33;
+  h *= 0xff51afd7ed558ccdULL;
+  h ^= h >> 33;
+  h *= 0xc4ceb9fe1a85ec53ULL;
+  h ^= h >> 33;
+  return h;
+}
+
+int64_t RoundUpToPowerOfTwo(int64_t n) {
+  int64_t p = 1;
+  while (p < n) { p <<= 1; }
+  return p;
+}
+
+// The workspace holds the keys' positions grouped by partition, the first position of each key
+// and the open addressing tables of the partitions, whose capacity is at most 4 slots per key. The
+// table region is reused to sort the unique keys when sorted is set.
+template<typename KEY, typename IDX>
+int64_t GetUniqueTableSize(int64_t n) {
+  return std::max<int64_t>(4 * n * sizeof(IDX),
+                           GetCudaAlignedSize(n * sizeof(KEY)) + n * sizeof(IDX));
+}
+
+template<typename KEY, typename IDX>
+int64_t GetCpuUniqueWorkspaceSize(int64_t n) {
+  return std::max<int64_t>(2 * GetCudaAlignedSize(n * sizeof(IDX))
+                               + GetCudaAlignedSize(GetUniqueTableSize<KEY, IDX>(n)),
+                           1);
+}
+
+template<typename F>
+void ParallelForChunks(ep::CpuStream* cpu_stream, int64_t num_chunks, const F& f) {
+  if (num_chunks == 1) {
+    f(0);
+  } else {
+    cpu_stream->ParallelFor(
+        0, num_chunks,
+        [&](int64_t begin, int64_t end) {
+          for (int64_t chunk = begin; chunk < end; ++chunk) { f(chunk); }
+        },
+        1);
+  }
+}
+
+// Unique in first occurrence order. The positions are grouped by the partition of their key's hash
+// in a stable way, then each partition is deduplicated by its own open addressing table into the
+// first position of each key. The unique keys are numbered by a prefix sum over the first
+// positions, which keeps the order of the sequential algorithm.
+template<typename KEY, typename IDX>
+void CpuUnique(ep::CpuStream* cpu_stream, int64_t n, const KEY* in, IDX* num_unique,
+               KEY* unique_out, IDX* idx_out, IDX* count, void* workspace) {
+  IDX* positions = reinterpret_cast<IDX*>(workspace);
+  IDX* first = reinterpret_cast<IDX*>(reinterpret_cast<char*>(positions)
+                                      + GetCudaAlignedSize(n * sizeof(IDX)));
+  IDX* table = reinterpret_cast<IDX*>(reinterpret_cast<char*>(first)
+                                      + GetCudaAlignedSize(n * sizeof(IDX)));
+  const int64_t num_chunks =
+      std::min(static_cast<int64_t>(cpu_stream->device()->GetNumThreads()),
+               (n + kCpuUniqueGrain - 1) / kCpuUniqueGrain);
+  int num_partition_bits = 0;
+  while ((int64_t{1} << num_partition_bits) < num_chunks) { num_partition_bits += 1; }
+  const int64_t num_partitions = int64_t{1} << num_partition_bits;
+  const int64_t chunk_size = (n + num_chunks - 1) / num_chunks;
+  auto GetPartition = [&](KEY key) -> int64_t {
+    return num_partition_bits == 0 ? 0 : HashUniqueKey(key) >> (64 - num_partition_bits);
+  };
+  // partition_offsets[chunk * num_partitions + p] is where the chunk writes its positions of
+  // partition p, partition p spans [partition_begin[p], partition_begin[p + 1]).
+  std::vector<int64_t> partition_offsets(num_chunks * num_partitions, 0);
+  std::vector<int64_t> partition_begin(num_partitions + 1, 0);
+  if (num_partitions == 1) {
+    std::iota(positions, positions + n, 0);
+    partition_begin[1] = n;
+  } else {
+    ParallelForChunks(cpu_stream, num_chunks, [&](int64_t chunk) {
+      int64_t* offsets = partition_offsets.data() + chunk * num_partitions;
+      const int64_t end = std::min(n, (chunk + 1) * chunk_size);
+      for (int64_t i = chunk * chunk_size; i < end; ++i) { offsets[GetPartition(in[i])] += 1; }
+    });
+    int64_t offset = 0;
+    for (int64_t p = 0; p < num_partitions; ++p) {
+      partition_begin[p] = offset;
+      for (int64_t chunk = 0; chunk < num_chunks; ++chunk) {
+        const int64_t size = partition_offsets[chunk * num_partitions + p];
+        partition_offsets[chunk * num_partitions + p] = offset;
+        offset += size;
+      }
+    }
+    partition_begin[num_partitions] = offset;
+    ParallelForChunks(cpu_stream, num_chunks, [&](int64_t chunk) {
+      int64_t* offsets = partition_offsets.data() + chunk * num_partitions;
+      const int64_t end = std::min(n, (chunk + 1) * chunk_size);
+      for (int64_t i = chunk * chunk_size; i < end; ++i) {
+        positions[offsets[GetPartition(in[i])]++] = static_cast<IDX>(i);
+      }
+    });
+  }
+  // Each partition owns a power of two table of 2 to 4 slots per position.
+  std::vector<int64_t> table_begin(num_partitions + 1, 0);
+  for (int64_t p = 0; p < num_partitions; ++p) {
+    const int64_t size = partition_begin[p + 1] - partition_begin[p];
+    table_begin[p + 1] = table_begin[p] + (size == 0 ? 0 : RoundUpToPowerOfTwo(2 * size));
+  }
+  ParallelForChunks(cpu_stream, num_partitions, [&](int64_t p) {
+    const int64_t capacity = table_begin[p + 1] - table_begin[p];
+    if (capacity == 0) { return; }
+    IDX* slots = table + table_begin[p];
+    std::fill(slots, slots + capacity, static_cast<IDX>(-1));
+    for (int64_t j = partition_begin[p]; j < partition_begin[p + 1]; ++j) {
+      const IDX i = positions[j];
+      const KEY key = in[i];
+      int64_t slot = HashUniqueKey(key) & (capacity - 1);
+      while (slots[slot] != -1 && !(in[slots[slot]] == key)) {
+        slot = (slot + 1) & (capacity - 1);
+      }
+      if (slots[slot] == -1) { slots[slot] = i; }
+      first[i] = slots[slot];
+    }
+  });
+  std::vector<int64_t> chunk_unique_begin(num_chunks + 1, 0);
+  ParallelForChunks(cpu_stream, num_chunks, [&](int64_t chunk) {
+    const int64_t end = std::min(n, (chunk + 1) * chunk_size);
+    int64_t num_chunk_unique = 0;
+    for (int64_t i = chunk * chunk_size; i < end; ++i) { num_chunk_unique += (first[i] == i); }
+    chunk_unique_begin[chunk + 1] = num_chunk_unique;
+  });
+  for (int64_t chunk = 0; chunk < num_chunks; ++chunk) {
+    chunk_unique_begin[chunk + 1] += chunk_unique_begin[chunk];
+  }
+  ParallelForChunks(cpu_stream, num_chunks, [&](int64_t chunk) {
+    const int64_t end = std::min(n, (chunk + 1) * chunk_size);
+    int64_t rank = chunk_unique_begin[chunk];
+    for (int64_t i = chunk * chunk_size; i < end; ++i) {
+      if (first[i] != i) { continue; }
+      idx_out[i] = static_cast<IDX>(rank);
+      unique_out[rank] = in[i];
+      if (count != nullptr) { count[rank] = 0; }
+      rank += 1;
+    }
+  });
+  ParallelForChunks(cpu_stream, num_chunks, [&](int64_t chunk) {
+    const int64_t end = std::min(n, (chunk + 1) * chunk_size);
+    for (int64_t i = chunk * chunk_size; i < end; ++i) {
+      if (first[i] != i) { idx_out[i] = idx_out[first[i]]; }
+    }
+  });
+  if (count != nullptr) {
+    // All the positions of a key are in the same partition, so the partitions count concurrently.
+    ParallelForChunks(cpu_stream, num_partitions, [&](int64_t p) {
+      for (int64_t j = partition_begin[p]; j < partition_begin[p + 1]; ++j) {
+        count[idx_out[positions[j]]] += 1;
+      }
+    });
+  }
+  *num_unique = static_cast<IDX>(chunk_unique_begin[num_chunks]);
+}
+
+// Renumbers the result of CpuUnique so that the unique keys are sorted, reusing the workspace.
+template<typename KEY, typename IDX>
+void SortUnique(ep::CpuStream* cpu_stream, int64_t n, IDX num_unique, KEY* unique_out,
+                IDX* idx_out, IDX* count, void* workspace) {
+  IDX* order = reinterpret_cast<IDX*>(workspace);
+  IDX* new_idx = reinterpret_cast<IDX*>(reinterpret_cast<char*>(order)
+                                        + GetCudaAlignedSize(n * sizeof(IDX)));
+  KEY* keys = reinterpret_cast<KEY*>(reinterpret_cast<char*>(new_idx)
+                                     + GetCudaAlignedSize(n * sizeof(IDX)));
+  IDX* counts = reinterpret_cast<IDX*>(reinterpret_cast<char*>(keys)
+                                       + GetCudaAlignedSize(n * sizeof(KEY)));
+  std::iota(order, order + num_unique, 0);
+  std::sort(order, order + num_unique,
+            [&](IDX a, IDX b) { return unique_out[a] < unique_out[b]; });
+  std::copy(unique_out, unique_out + num_unique, keys);
+  if (count != nullptr) { std::copy(count, count + num_unique, counts); }
+  for (IDX i = 0; i < num_unique; ++i) {
+    new_idx[order[i]] = i;
+    unique_out[i] = keys[order[i]];
+    if (count != nullptr) { count[i] = counts[order[i]]; }
+  }
+  auto renumber = [&](int64_t begin, int64_t end) {
+    for (int64_t i = begin; i < end; ++i) { idx_out[i] = new_idx[idx_out[i]]; }
+  };
+  if (n <= kCpuUniqueGrain) {
+    renumber(0, n);
+  } else {
+    cpu_stream->ParallelFor(0, n, renumber, kCpuUniqueGrain);
+  }
+}
+
+}  // namespace
+
 template<typename KEY, typename IDX>
 struct UniqueKernelUtil<DeviceType::kCPU, KEY, IDX> {
   static void Unique(ep::Stream* stream, int64_t n, const KEY* in, IDX* num_unique, KEY* unique_out,
@@ -28,39 +230,25 @@ struct UniqueKernelUtil<DeviceType::kCPU, KEY, IDX> {
   static void UniqueWithCounts(ep::Stream* stream, int64_t n, const KEY* in, IDX* num_unique,
                                KEY* unique_out, IDX* idx_out, IDX* count, void* workspace,
                                int64_t workspace_size_in_bytes, bool sorted) {
-    std::vector<int64_t> sorted_idx(n);
-    std::iota(sorted_idx.begin(), sorted_idx.end(), 0);
-    if (sorted) {
-      std::sort(sorted_idx.begin(), sorted_idx.end(),
-                [&in](size_t a, size_t b) { return in[a] < in[b]; });
+    if (n == 0) {
+      *num_unique = 0;
+      return;
     }
-
-    HashMap<KEY, IDX> map;
-    for (int64_t i : sorted_idx) {
-      KEY in_i = in[i];
-      auto it = map.find(in_i);
-      if (it == map.end()) {
-        IDX idx = map.size();
-        if (count != nullptr) { count[idx] = 1; }
-        idx_out[i] = idx;
-        unique_out[idx] = in_i;
-        map[in_i] = idx;
-      } else {
-        IDX idx = it->second;
-        if (count != nullptr) { count[idx] += 1; }
-        idx_out[i] = idx;
-      }
+    CHECK_GE(workspace_size_in_bytes, (GetCpuUniqueWorkspaceSize<KEY, IDX>(n)));
+    auto* cpu_stream = stream->As<ep::CpuStream>();
+    CpuUnique<KEY, IDX>(cpu_stream, n, in, num_unique, unique_out, idx_out, count, workspace);
+    if (sorted) {
+      SortUnique<KEY, IDX>(cpu_stream, n, *num_unique, unique_out, idx_out, count, workspace);
     }
-    *num_unique = map.size();
   }
 
   static void GetUniqueWorkspaceSizeInBytes(ep::Stream* stream, int64_t n,
                                             int64_t* workspace_size_in_bytes) {
-    *workspace_size_in_bytes = 1;
+    *workspace_size_in_bytes = GetCpuUniqueWorkspaceSize<KEY, IDX>(n);
   }
   static void GetUniqueWithCountsWorkspaceSizeInBytes(ep::Stream* stream, int64_t n,
                                                       int64_t* workspace_size_in_bytes) {
-    *workspace_size_in_bytes = 1;
+    *workspace_size_in_bytes = GetCpuUniqueWorkspaceSize<KEY, IDX>(n);
   }
 };
 
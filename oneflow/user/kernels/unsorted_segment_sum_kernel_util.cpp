@@ -14,6 +14,7 @@ See the License for the specific language governing permissions and
 limitations under the License.
 */
 #include "oneflow/user/kernels/unsorted_segment_sum_kernel_util.h"
+#include "oneflow/user/kernels/scatter_add_cpu_util.h"
 
 namespace oneflow {
 
@@ -30,18 +31,21 @@ void UnsortedSegmentSumKernelUtil<DeviceType::kCPU, T, K, T>::UnsortedSegmentSum
     ep::Stream* stream, const K* segment_ids, const T* data, int64_t num_segment_ids,
     int64_t num_segments, int64_t outer_dim_size, int64_t inner_dim_size, int64_t segment_id_offset,
     T* out) {
-  FOR_RANGE(int64_t, outer_idx, 0, outer_dim_size) {
-    FOR_RANGE(int64_t, i, 0, num_segment_ids) {
-      CHECK_GE(segment_ids[i], 0);
-      const int64_t idx = segment_ids[i] - segment_id_offset;
-      T* to = out + outer_idx * num_segments * inner_dim_size + idx * inner_dim_size;
-      if (idx >= 0 && idx < num_segments) {
-        const T* from = data + outer_idx * num_segment_ids * inner_dim_size + i * inner_dim_size;
-        std::transform(from, from + inner_dim_size, to, to, std::plus<T>());
-      }
-    }
-  }
+  // Row (outer_idx, i) of data goes to row (outer_idx, segment_ids[i] - segment_id_offset) of out,
+  // segments outside of [0, num_segments) belong to other ranks and are skipped.
+  auto GetDstRow = [&](int64_t row) -> int64_t {
+    const int64_t outer_idx = row / num_segment_ids;
+    const int64_t i = row - outer_idx * num_segment_ids;
+    CHECK_GE(segment_ids[i], 0);
+    const int64_t idx = segment_ids[i] - segment_id_offset;
+    if (idx < 0 || idx >= num_segments) { return -1; }
+    return outer_idx * num_segments + idx;
+  };
+  scatter_add::CpuScatterAddRows(stream, outer_dim_size * num_segment_ids, inner_dim_size,
+                                 outer_dim_size * num_segments, GetDstRow, data,
+                                 static_cast<T>(1), out);
 }
+
 #define INITIATE_UNSORTED_SEGMENT_SUM_KERNEL_UTIL_CPU(in_type_pair, index_type_pair)             \
   template struct UnsortedSegmentSumKernelUtil<DeviceType::kCPU, OF_PP_PAIR_FIRST(in_type_pair), \
                                                OF_PP_PAIR_FIRST(index_type_pair),                \
@@ -131,4 +131,128 @@ namespace oneflow {
   return Maybe<void>::Ok();
 }
 
+namespace {
+
+Maybe<void> CheckEmbeddingBagInputs(user_op::InferContext* ctx) {
+  const Shape& weight_shape = ctx->InputShape("weight", 0);
+  const Shape& indices_shape = ctx->InputShape("indices", 0);
+  const Shape& offsets_shape = ctx->InputShape("offsets", 0);
+  CHECK_EQ_OR_RETURN(weight_shape.NumAxes(), 2) << "The dimension of weight should be 2";
+  CHECK_EQ_OR_RETURN(indices_shape.NumAxes(), 1) << "The dimension of indices should be 1";
+  CHECK_EQ_OR_RETURN(offsets_shape.NumAxes(), 1) << "The dimension of offsets should be 1";
+  const std::string& mode = ctx->Attr<std::string>("mode");
+  CHECK_OR_RETURN(mode == "sum" || mode == "mean" || mode == "max")
+      << "mode should be one of sum, mean and max, but got " << mode;
+  if (ctx->has_input("per_sample_weights", 0)) {
+    CHECK_EQ_OR_RETURN(mode, "sum") << "per_sample_weights is only supported for mode sum";
+    CHECK_EQ_OR_RETURN(ctx->InputShape("per_sample_weights", 0), indices_shape)
+        << "The shape of per_sample_weights should be the same as indices";
+  }
+  return Maybe<void>::Ok();
+}
+
+Maybe<void> CheckEmbeddingBagDataType(user_op::InferContext* ctx, const std::string& weight_name) {
+  CHECK_EQ_OR_RETURN(ctx->InputDType("offsets", 0), ctx->InputDType("indices", 0))
+      << "InferDataType Failed. Expected " << DataType_Name(ctx->InputDType("indices", 0))
+      << ", but got " << DataType_Name(ctx->InputDType("offsets", 0));
+  if (ctx->has_input("per_sample_weights", 0)) {
+    CHECK_EQ_OR_RETURN(ctx->InputDType("per_sample_weights", 0), ctx->InputDType(weight_name, 0))
+        << "InferDataType Failed. Expected " << DataType_Name(ctx->InputDType(weight_name, 0))
+        << ", but got " << DataType_Name(ctx->InputDType("per_sample_weights", 0));
+  }
+  return Maybe<void>::Ok();
+}
+
+Maybe<void> SetEmbeddingBagInputArgModifier(
+    const user_op::GetInputArgModifier& GetInputArgModifierFn,
+    const user_op::UserOpConfWrapper& conf) {
+  for (const std::string& arg_name : {"indices", "offsets"}) {
+    user_op::InputArgModifier* modifier = GetInputArgModifierFn(arg_name, 0);
+    CHECK_OR_RETURN(modifier != nullptr);  // NOLINT(maybe-need-error-msg)
+    modifier->set_requires_grad(false);
+  }
+  return Maybe<void>::Ok();
+}
+
+}  // namespace
+
+/* static */ Maybe<void> EmbeddingBagOp::InferLogicalTensorDesc(user_op::InferContext* ctx) {
+  JUST(CheckEmbeddingBagInputs(ctx));
+  const Shape& weight_shape = ctx->InputShape("weight", 0);
+  const Shape& offsets_shape = ctx->InputShape("offsets", 0);
+  ctx->SetOutputShape("out", 0, Shape({offsets_shape.At(0), weight_shape.At(1)}));
+  return Maybe<void>::Ok();
+}
+
+/*static*/ Maybe<void> EmbeddingBagOp::InferPhysicalTensorDesc(user_op::InferContext* ctx) {
+  return InferLogicalTensorDesc(ctx);
+}
+
+/*static*/ Maybe<void> EmbeddingBagOp::GetSbp(user_op::SbpContext* ctx) {
+  // Bags are pooled column by column, so splitting the embedding dim needs no communication.
+  auto builder = ctx->NewBuilder()
+                     .Split(user_op::OpArg("weight", 0), 1)
+                     .Broadcast(user_op::OpArg("indices", 0))
+                     .Broadcast(user_op::OpArg("offsets", 0))
+                     .Split(user_op::OpArg("out", 0), 1);
+  if (ctx->user_op_conf().has_input("per_sample_weights", 0)) {
+    builder.Broadcast(user_op::OpArg("per_sample_weights", 0));
+  }
+  builder.Build();
+  return Maybe<void>::Ok();
+}
+
+/*static*/ Maybe<void> EmbeddingBagOp::InferDataType(user_op::InferContext* ctx) {
+  JUST(CheckEmbeddingBagDataType(ctx, "weight"));
+  ctx->SetOutputDType("out", 0, ctx->InputDType("weight", 0));
+  return Maybe<void>::Ok();
+}
+
+/* static */ Maybe<void> EmbeddingBagOp::ModifyInputArg(
+    const GetInputArgModifier& GetInputArgModifierFn, const user_op::UserOpConfWrapper& conf) {
+  return SetEmbeddingBagInputArgModifier(GetInputArgModifierFn, conf);
+}
+
+/* static */ Maybe<void> EmbeddingBagGradOp::InferLogicalTensorDesc(user_op::InferContext* ctx) {
+  JUST(CheckEmbeddingBagInputs(ctx));
+  const Shape& weight_shape = ctx->InputShape("weight", 0);
+  const Shape& dy_shape = ctx->InputShape("dy", 0);
+  CHECK_EQ_OR_RETURN(dy_shape, Shape({ctx->InputShape("offsets", 0).At(0), weight_shape.At(1)}))
+      << "The shape of dy should be (num_bags, embedding_dim)";
+  ctx->SetOutputShape("dx", 0, weight_shape);
+  return Maybe<void>::Ok();
+}
+
+/*static*/ Maybe<void> EmbeddingBagGradOp::InferPhysicalTensorDesc(user_op::InferContext* ctx) {
+  return EmbeddingBagGradOp::InferLogicalTensorDesc(ctx);
+}
+
+/*static*/ Maybe<void> EmbeddingBagGradOp::GetSbp(user_op::SbpContext* ctx) {
+  auto builder = ctx->NewBuilder()
+                     .Split(user_op::OpArg("dy", 0), 1)
+                     .Split(user_op::OpArg("weight", 0), 1)
+                     .Broadcast(user_op::OpArg("indices", 0))
+                     .Broadcast(user_op::OpArg("offsets", 0))
+                     .Split(user_op::OpArg("dx", 0), 1);
+  if (ctx->user_op_conf().has_input("per_sample_weights", 0)) {
+    builder.Broadcast(user_op::OpArg("per_sample_weights", 0));
+  }
+  builder.Build();
+  return Maybe<void>::Ok();
+}
+
+/*static*/ Maybe<void> EmbeddingBagGradOp::InferDataType(user_op::InferContext* ctx) {
+  CHECK_EQ_OR_RETURN(ctx->InputDType("weight", 0), ctx->InputDType("dy", 0))
+      << "InferDataType Failed. Expected " << DataType_Name(ctx->InputDType("dy", 0))
+      << ", but got " << DataType_Name(ctx->InputDType("weight", 0));
+  JUST(CheckEmbeddingBagDataType(ctx, "dy"));
+  ctx->SetOutputDType("dx", 0, ctx->InputDType("dy", 0));
+  return Maybe<void>::Ok();
+}
+
+/* static */ Maybe<void> EmbeddingBagGradOp::ModifyInputArg(
+    const GetInputArgModifier& GetInputArgModifierFn, const user_op::UserOpConfWrapper& conf) {
+  return SetEmbeddingBagInputArgModifier(GetInputArgModifierFn, conf);
+}
+
 }  // namespace oneflow
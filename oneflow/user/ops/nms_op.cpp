@@ -20,8 +20,17 @@ namespace oneflow {
 
 namespace {
 
+// in is (..., num_boxes, 4), the leading dimensions index independent instances, e.g. images or
+// classes, and out is (..., num_boxes)
 Maybe<void> InferNmsTensorDesc(user_op::InferContext* ctx) {
-  ctx->SetOutputShape("out", 0, Shape({ctx->InputShape("in", 0).At(0)}));
+  const Shape& in_shape = ctx->InputShape("in", 0);
+  CHECK_GE_OR_RETURN(in_shape.NumAxes(), 2)
+      << "The boxes of nms should have at least 2 dimensions, but got " << in_shape.NumAxes();
+  CHECK_EQ_OR_RETURN(in_shape.At(in_shape.NumAxes() - 1), 4)
+      << "The last dimension of the boxes of nms should be 4, but got "
+      << in_shape.At(in_shape.NumAxes() - 1);
+  DimVector out_dim_vec(in_shape.dim_vec().begin(), in_shape.dim_vec().end() - 1);
+  ctx->SetOutputShape("out", 0, Shape(out_dim_vec));
   return Maybe<void>::Ok();
 }
 
@@ -48,4 +48,49 @@ namespace oneflow {
   return Maybe<void>::Ok();
 }
 
+/* static */ Maybe<void> RocAucHistogramOp::InferLogicalTensorDesc(user_op::InferContext* ctx) {
+  const Shape& pred_shape = ctx->InputTensorDesc("pred", 0).shape();
+  const Shape& label_shape = ctx->InputTensorDesc("label", 0).shape();
+  CHECK_EQ_OR_RETURN(pred_shape.elem_cnt(), label_shape.elem_cnt())
+      << "pred and label MUST have same element count.";
+  const int64_t num_buckets = ctx->Attr<int64_t>("num_buckets");
+  CHECK_GT_OR_RETURN(num_buckets, 0) << "num_buckets should be positive, but got " << num_buckets;
+  CHECK_LE_OR_RETURN(num_buckets, GetMaxVal<int32_t>() / 2)
+      << "num_buckets should not exceed " << GetMaxVal<int32_t>() / 2 << ", but got "
+      << num_buckets;
+  user_op::TensorDesc* out_desc = ctx->MutOutputTensorDesc("out", 0);
+  out_desc->set_is_dynamic(false);
+  out_desc->set_shape(Shape({2, num_buckets}));
+  return Maybe<void>::Ok();
+}
+
+/*static*/ Maybe<void> RocAucHistogramOp::InferPhysicalTensorDesc(user_op::InferContext* ctx) {
+  return InferLogicalTensorDesc(ctx);
+}
+
+/* static */ Maybe<void> RocAucHistogramOp::GetSbp(user_op::SbpContext* ctx) {
+  // The histograms of the shards add up to the histogram of the whole batch
+  const Shape& pred_shape = ctx->LogicalTensorDesc4InputArgNameAndIndex("pred", 0).shape();
+  const Shape& label_shape = ctx->LogicalTensorDesc4InputArgNameAndIndex("label", 0).shape();
+  if (pred_shape == label_shape && pred_shape.NumAxes() > 0) {
+    ctx->NewBuilder()
+        .Split(user_op::OpArg("label", 0), 0)
+        .Split(user_op::OpArg("pred", 0), 0)
+        .PartialSum(user_op::OpArg("out", 0))
+        .Build();
+  }
+  return Maybe<void>::Ok();
+}
+
+/* static */ Maybe<void> RocAucHistogramOp::InferDataType(user_op::InferContext* ctx) {
+  ctx->SetOutputDType("out", 0, DataType::kInt64);
+  const user_op::TensorDesc& label = ctx->InputTensorDesc("label", 0);
+  CHECK_OR_RETURN(IsFloatingDataType(label.data_type()) || IsIntegralDataType(label.data_type()))
+      << "Input `label` data type " << DataType_Name(label.data_type()) << " is not supported.";
+  const user_op::TensorDesc& pred = ctx->InputTensorDesc("pred", 0);
+  CHECK_OR_RETURN(pred.data_type() == DataType::kFloat)
+      << "Input `pred` data type " << DataType_Name(pred.data_type()) << " is not supported.";
+  return Maybe<void>::Ok();
+}
+
 }  // namespace oneflow
@@ -23,6 +23,38 @@ limitations under the License.
 
 namespace oneflow {
 
+namespace {
+
+// attn_mask is (batch_size or 1, num_heads or 1, seqlen_q, seqlen_k) and is broadcast along the
+// axes of size 1.
+Maybe<void> CheckAttnMaskShape(user_op::InferContext* ctx, int64_t batch_size, int64_t num_heads,
+                               int64_t seqlen_q, int64_t seqlen_k) {
+  if (!ctx->has_input("attn_mask", 0)) { return Maybe<void>::Ok(); }
+  const Shape& mask_shape = ctx->InputShape("attn_mask", 0);
+  CHECK_EQ_OR_RETURN(mask_shape.NumAxes(), 4) << "attn_mask should be a 4-D tensor.";
+  CHECK_OR_RETURN(mask_shape.At(0) == 1 || mask_shape.At(0) == batch_size)
+      << "attn_mask has different batch size from query.";
+  CHECK_OR_RETURN(mask_shape.At(1) == 1 || mask_shape.At(1) == num_heads)
+      << "attn_mask has different num_heads from query.";
+  CHECK_EQ_OR_RETURN(mask_shape.At(2), seqlen_q) << "attn_mask has different seqlen from query.";
+  CHECK_EQ_OR_RETURN(mask_shape.At(3), seqlen_k) << "attn_mask has different seqlen from key.";
+  return Maybe<void>::Ok();
+}
+
+// The broadcast axes of attn_mask can not be split.
+void SetAttnMaskSbp(user_op::SbpContext* ctx, int64_t axis, int64_t size,
+                    user_op::UserOpSbpSignatureBuilder* builder) {
+  if (!ctx->user_op_conf().has_input("attn_mask", 0)) { return; }
+  const Shape& mask_shape = ctx->LogicalTensorDesc4InputArgNameAndIndex("attn_mask", 0).shape();
+  if (mask_shape.At(axis) == size) {
+    builder->Split(user_op::OpArg("attn_mask", 0), axis);
+  } else {
+    builder->Broadcast(user_op::OpArg("attn_mask", 0));
+  }
+}
+
+}  // namespace
+
 Maybe<void> ScaledDotProductFlashAttentionOp::InferLogicalTensorDesc(user_op::InferContext* ctx) {
   const Shape& q_shape = ctx->InputShape("query", 0);
   const Shape& k_shape = ctx->InputShape("key", 0);
@@ -55,6 +87,8 @@ Maybe<void> ScaledDotProductFlashAttentionOp::InferLogicalTensorDesc(user_op::In
   CHECK_EQ_OR_RETURN(num_heads % num_heads_k, 0)
       << "number of heads in key/value must devide number of heads in query.";
 
+  JUST(CheckAttnMaskShape(ctx, batch_size, num_heads, seqlen_q, seqlen_k));
+
   ctx->SetOutputShape("out", 0, Shape({batch_size, seqlen_q, num_heads, head_size_og}));
   // save for backward
   ctx->SetOutputShape("softmax_lse", 0, Shape({batch_size, num_heads, seqlen_q}));
@@ -78,24 +112,26 @@ Maybe<void> ScaledDotProductFlashAttentionOp::GetSbp(user_op::SbpContext* ctx) {
       num_heads == num_heads_k || (!(num_heads % parallel_num) && !(num_heads_k % parallel_num));
   if (can_spilt_num_heads) {
     // prior to split on num_heads.
-    ctx->NewBuilder()
-        .Split(user_op::OpArg("query", 0), 2)
-        .Split(user_op::OpArg("key", 0), 2)
-        .Split(user_op::OpArg("value", 0), 2)
-        .Split(user_op::OpArg("out", 0), 2)
-        .Split(user_op::OpArg("softmax", 0), 1)
-        .Broadcast(user_op::OpArg("rng_state", 0))
-        .Build();
+    auto builder = ctx->NewBuilder()
+                       .Split(user_op::OpArg("query", 0), 2)
+                       .Split(user_op::OpArg("key", 0), 2)
+                       .Split(user_op::OpArg("value", 0), 2)
+                       .Split(user_op::OpArg("out", 0), 2)
+                       .Split(user_op::OpArg("softmax", 0), 1)
+                       .Broadcast(user_op::OpArg("rng_state", 0));
+    SetAttnMaskSbp(ctx, 1, num_heads, &builder);
+    builder.Build();
   } else {
     // otherwise split on batch_size.
-    ctx->NewBuilder()
-        .Split(user_op::OpArg("query", 0), 0)
-        .Split(user_op::OpArg("key", 0), 0)
-        .Split(user_op::OpArg("value", 0), 0)
-        .Split(user_op::OpArg("out", 0), 0)
-        .Split(user_op::OpArg("softmax", 0), 0)
-        .Broadcast(user_op::OpArg("rng_state", 0))
-        .Build();
+    auto builder = ctx->NewBuilder()
+                       .Split(user_op::OpArg("query", 0), 0)
+                       .Split(user_op::OpArg("key", 0), 0)
+                       .Split(user_op::OpArg("value", 0), 0)
+                       .Split(user_op::OpArg("out", 0), 0)
+                       .Split(user_op::OpArg("softmax", 0), 0)
+                       .Broadcast(user_op::OpArg("rng_state", 0));
+    SetAttnMaskSbp(ctx, 0, q_shape.At(0), &builder);
+    builder.Build();
   }
   return Maybe<void>::Ok();
 }
@@ -107,6 +143,10 @@ Maybe<void> ScaledDotProductFlashAttentionOp::InferDataType(user_op::InferContex
 
   CHECK_EQ_OR_RETURN(q_datatype, k_datatype) << "query has different data type from key.";
   CHECK_EQ_OR_RETURN(q_datatype, v_datatype) << "query has different data type from value.";
+  if (ctx->has_input("attn_mask", 0)) {
+    CHECK_EQ_OR_RETURN(q_datatype, ctx->InputDType("attn_mask", 0))
+        << "query has different data type from attn_mask.";
+  }
 
   ctx->SetOutputDType("out", 0, q_datatype);
   ctx->SetOutputDType("softmax_lse", 0, DataType::kFloat);
@@ -158,6 +198,8 @@ Maybe<void> ScaledDotProductFlashAttentionGradOp::InferLogicalTensorDesc(
   CHECK_EQ_OR_RETURN(num_heads % num_heads_k, 0)
       << "number of heads in key/value must devide number of heads in query.";
 
+  JUST(CheckAttnMaskShape(ctx, batch_size, num_heads, seqlen_q, seqlen_k));
+
   // grad_k/v should be expanded if needed(when num_heads != num_heads_k && num_heads % num_heads_k
   // == 0).
   ctx->SetOutputShape("grad_q", 0, Shape({batch_size, seqlen_q, num_heads, head_size}));
@@ -182,32 +224,34 @@ Maybe<void> ScaledDotProductFlashAttentionGradOp::GetSbp(user_op::SbpContext* ct
       num_heads == num_heads_k || (!(num_heads % parallel_num) && !(num_heads_k % parallel_num));
   if (can_spilt_num_heads) {
     // prior to split on num_heads.
-    ctx->NewBuilder()
-        .Split(user_op::OpArg("grad_out", 0), 2)
-        .Split(user_op::OpArg("query", 0), 2)
-        .Split(user_op::OpArg("key", 0), 2)
-        .Split(user_op::OpArg("value", 0), 2)
-        .Split(user_op::OpArg("out", 0), 2)
-        .Split(user_op::OpArg("softmax", 0), 1)
-        .Broadcast(user_op::OpArg("rng_state", 0))
-        .Split(user_op::OpArg("grad_q", 0), 2)
-        .Split(user_op::OpArg("grad_k", 0), 2)
-        .Split(user_op::OpArg("grad_v", 0), 2)
-        .Build();
+    auto builder = ctx->NewBuilder()
+                       .Split(user_op::OpArg("grad_out", 0), 2)
+                       .Split(user_op::OpArg("query", 0), 2)
+                       .Split(user_op::OpArg("key", 0), 2)
+                       .Split(user_op::OpArg("value", 0), 2)
+                       .Split(user_op::OpArg("out", 0), 2)
+                       .Split(user_op::OpArg("softmax", 0), 1)
+                       .Broadcast(user_op::OpArg("rng_state", 0))
+                       .Split(user_op::OpArg("grad_q", 0), 2)
+                       .Split(user_op::OpArg("grad_k", 0), 2)
+                       .Split(user_op::OpArg("grad_v", 0), 2);
+    SetAttnMaskSbp(ctx, 1, num_heads, &builder);
+    builder.Build();
   } else {
     // otherwise split on batch_size.
-    ctx->NewBuilder()
-        .Split(user_op::OpArg("grad_out", 0), 0)
-        .Split(user_op::OpArg("query", 0), 0)
-        .Split(user_op::OpArg("key", 0), 0)
-        .Split(user_op::OpArg("value", 0), 0)
-        .Split(user_op::OpArg("out", 0), 0)
-        .Split(user_op::OpArg("softmax", 0), 0)
-        .Broadcast(user_op::OpArg("rng_state", 0))
-        .Split(user_op::OpArg("grad_q", 0), 0)
-        .Split(user_op::OpArg("grad_k", 0), 0)
-        .Split(user_op::OpArg("grad_v", 0), 0)
-        .Build();
+    auto builder = ctx->NewBuilder()
+                       .Split(user_op::OpArg("grad_out", 0), 0)
+                       .Split(user_op::OpArg("query", 0), 0)
+                       .Split(user_op::OpArg("key", 0), 0)
+                       .Split(user_op::OpArg("value", 0), 0)
+                       .Split(user_op::OpArg("out", 0), 0)
+                       .Split(user_op::OpArg("softmax", 0), 0)
+                       .Broadcast(user_op::OpArg("rng_state", 0))
+                       .Split(user_op::OpArg("grad_q", 0), 0)
+                       .Split(user_op::OpArg("grad_k", 0), 0)
+                       .Split(user_op::OpArg("grad_v", 0), 0);
+    SetAttnMaskSbp(ctx, 0, q_shape.At(0), &builder);
+    builder.Build();
   }
   return Maybe<void>::Ok();
 }
@@ -223,6 +267,10 @@ Maybe<void> ScaledDotProductFlashAttentionGradOp::InferDataType(user_op::InferCo
   CHECK_EQ_OR_RETURN(q_datatype, v_datatype) << "query has different data type from value.";
   CHECK_EQ_OR_RETURN(q_datatype, dout_datatype) << "query has different data type from grad_out.";
   CHECK_EQ_OR_RETURN(q_datatype, out_datatype) << "query has different data type from out.";
+  if (ctx->has_input("attn_mask", 0)) {
+    CHECK_EQ_OR_RETURN(q_datatype, ctx->InputDType("attn_mask", 0))
+        << "query has different data type from attn_mask.";
+  }
 
   ctx->SetOutputDType("grad_q", 0, q_datatype);
   ctx->SetOutputDType("grad_k", 0, q_datatype);
@@ -52,18 +52,15 @@ Maybe<void> FillScalarInSummary(const float& value, const std::string& tag, Summ
 }
 
 template<typename T>
-Maybe<void> FillHistogramInSummary(const user_op::Tensor& value, const std::string& tag,
-                                   Summary* s) {
+Maybe<void> FillHistogramInSummary(ep::Stream* stream, const user_op::Tensor& value,
+                                   const std::string& tag, Summary* s) {
   SummaryMetadata metadata;
   SetPluginData(&metadata, kHistogramPluginName);
   Summary::Value* v = s->add_value();
   v->set_tag(tag);
   *v->mutable_metadata() = metadata;
   summary::Histogram histo;
-  for (int64_t i = 0; i < value.shape_view().elem_cnt(); i++) {
-    double double_val = value.dptr<T>()[i];
-    histo.AppendValue(double_val);
-  }
+  histo.AppendValues(stream, value.dptr<T>(), value.shape_view().elem_cnt());
   histo.AppendToProto(v->mutable_histo());
   return Maybe<void>::Ok();
 }
@@ -179,12 +176,12 @@ struct EventWriterHelper<DeviceType::kCPU, T> {
     Singleton<EventsWriter>::Get()->AppendQueue(std::move(e));
   }
 
-  static void WriteHistogramToFile(int64_t step, const user_op::Tensor& value,
+  static void WriteHistogramToFile(ep::Stream* stream, int64_t step, const user_op::Tensor& value,
                                    const std::string& tag) {
     std::unique_ptr<Event> e{new Event};
     e->set_step(step);
     e->set_wall_time(GetWallTime());
-    CHECK_JUST(FillHistogramInSummary<T>(value, tag, e->mutable_summary()));
+    CHECK_JUST(FillHistogramInSummary<T>(stream, value, tag, e->mutable_summary()));
     Singleton<EventsWriter>::Get()->AppendQueue(std::move(e));
   }
 
@@ -28,7 +28,7 @@ template<DeviceType device_type, typename T>
 struct EventWriterHelper {
   static void WritePbToFile(int64_t step, const std::string& value);
   static void WriteScalarToFile(int64_t step, float value, const std::string& tag);
-  static void WriteHistogramToFile(int64_t step, const user_op::Tensor& value,
+  static void WriteHistogramToFile(ep::Stream* stream, int64_t step, const user_op::Tensor& value,
                                    const std::string& tag);
   static void WriteImageToFile(int64_t step, const user_op::Tensor& tensor, const std::string& tag);
 };
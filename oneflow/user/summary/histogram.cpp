@@ -15,7 +15,10 @@ limitations under the License.
 */
 #include "oneflow/user/summary/histogram.h"
 #include "oneflow/core/common/maybe.h"
+#include "oneflow/core/ep/cpu/cpu_stream.h"
+#include "oneflow/user/kernels/histogram_cpu_util.h"
 #include <cfloat>
+#include <cmath>
 #include <algorithm>
 
 namespace oneflow {
@@ -698,6 +701,39 @@ static std::vector<double> defalut_container = {-DBL_MAX,
                                                 451872326.521804,
                                                 DBL_MAX};
 
+namespace {
+
+// Apart from 0 and +-DBL_MAX the limits are +-first_limit * ratio^k, so the bucket of a value is
+// guessed from its logarithm and then moved to the one std::upper_bound would give.
+struct BucketLayout {
+  int64_t zero_index;
+  double first_limit;
+  double inv_log_ratio;
+};
+
+const BucketLayout& GetBucketLayout() {
+  static const BucketLayout layout = [] {
+    BucketLayout layout{};
+    layout.zero_index =
+        std::find(defalut_container.begin(), defalut_container.end(), 0.0)
+        - defalut_container.begin();
+    layout.first_limit = defalut_container.at(layout.zero_index + 1);
+    layout.inv_log_ratio =
+        1.0 / std::log(defalut_container.at(layout.zero_index + 2) / layout.first_limit);
+    return layout;
+  }();
+  return layout;
+}
+
+struct Moments {
+  double sum = 0;
+  double sum_squares = 0;
+  double min = DBL_MAX;
+  double max = -DBL_MAX;
+};
+
+}  // namespace
+
 Histogram::Histogram() {
   max_constainers_ = defalut_container;
   containers_.resize(max_constainers_.size());
@@ -715,10 +751,67 @@ void Histogram::AppendValue(double value) {
   sum_value_squares_ += value * value;
   if (max_value_ < value) { max_value_ = value; }
   if (min_value_ > value) { min_value_ = value; }
-  int idx = std::upper_bound(max_constainers_.begin(), max_constainers_.end(), value)
-            - max_constainers_.begin();
-  CHECK_GT(containers_.size(), idx);
-  containers_.at(idx) += 1.0;
+  containers_.at(BucketIndex(value)) += 1.0;
+}
+
+template<typename T>
+void Histogram::AppendValues(ep::Stream* stream, const T* values, int64_t n) {
+  auto* cpu_stream = stream->As<ep::CpuStream>();
+  const int64_t num_tasks = std::max<int64_t>(
+      std::min<int64_t>(cpu_stream->device()->GetNumThreads(), n / histogram::kCpuGrain), 1);
+  std::vector<Moments> moments(num_tasks);
+  auto AccumulateMoments = [&](int64_t begin, int64_t end) {
+    for (int64_t task = begin; task < end; ++task) {
+      Moments& m = moments[task];
+      for (int64_t i = n * task / num_tasks; i < n * (task + 1) / num_tasks; ++i) {
+        const double value = static_cast<double>(values[i]);
+        m.sum += value;
+        m.sum_squares += value * value;
+        if (m.max < value) { m.max = value; }
+        if (m.min > value) { m.min = value; }
+      }
+    }
+  };
+  if (num_tasks == 1) {
+    AccumulateMoments(0, 1);
+  } else {
+    cpu_stream->ParallelFor(0, num_tasks, AccumulateMoments, 1);
+  }
+  for (const Moments& m : moments) {
+    value_sum_ += m.sum;
+    sum_value_squares_ += m.sum_squares;
+    if (max_value_ < m.max) { max_value_ = m.max; }
+    if (min_value_ > m.min) { min_value_ = m.min; }
+  }
+  value_count_ += n;
+  histogram::CpuHistogram(
+      stream, n, static_cast<int64_t>(containers_.size()),
+      [&](int64_t begin, int64_t end, int32_t* bins) {
+        for (int64_t i = begin; i < end; ++i) {
+          bins[i - begin] = BucketIndex(static_cast<double>(values[i]));
+        }
+      },
+      containers_.data());
+}
+
+// Same as std::upper_bound(max_constainers_, value), except that values above the last limit,
+// i.e. inf and nan, go to the last bucket instead of past the end.
+int64_t Histogram::BucketIndex(double value) const {
+  const int64_t size = static_cast<int64_t>(max_constainers_.size());
+  if (std::isnan(value)) { return size - 1; }
+  const BucketLayout& layout = GetBucketLayout();
+  const double magnitude = std::abs(value);
+  int64_t idx = layout.zero_index + (value >= 0 ? 1 : 0);
+  if (magnitude > layout.first_limit) {
+    const double steps = std::min(std::log(magnitude / layout.first_limit) * layout.inv_log_ratio,
+                                  static_cast<double>(size));
+    idx = value > 0 ? idx + 1 + static_cast<int64_t>(steps) : idx - static_cast<int64_t>(steps);
+    idx = std::max<int64_t>(std::min(idx, size), 0);
+  }
+  const double* limits = max_constainers_.data();
+  while (idx > 0 && limits[idx - 1] > value) { --idx; }
+  while (idx < size && limits[idx] <= value) { ++idx; }
+  return std::min(idx, size - 1);
 }
 
 void Histogram::AppendToProto(HistogramProto* hist_proto) {
@@ -744,6 +837,18 @@ void Histogram::AppendToProto(HistogramProto* hist_proto) {
   }
 }
 
+#define INSTANTIATE_HISTOGRAM_APPEND_VALUES(T) \
+  template void Histogram::AppendValues<T>(ep::Stream* stream, const T* values, int64_t n);
+
+INSTANTIATE_HISTOGRAM_APPEND_VALUES(double)
+INSTANTIATE_HISTOGRAM_APPEND_VALUES(float)
+INSTANTIATE_HISTOGRAM_APPEND_VALUES(int64_t)
+INSTANTIATE_HISTOGRAM_APPEND_VALUES(int32_t)
+INSTANTIATE_HISTOGRAM_APPEND_VALUES(int8_t)
+INSTANTIATE_HISTOGRAM_APPEND_VALUES(uint8_t)
+
+#undef INSTANTIATE_HISTOGRAM_APPEND_VALUES
+
 }  // namespace summary
 
 }  // namespace oneflow
@@ -16,11 +16,18 @@ limitations under the License.
 #ifndef ONEFLOW_USER_SUMMARY_HISTOGRAM_H_
 #define ONEFLOW_USER_SUMMARY_HISTOGRAM_H_
 
+#include <cstdint>
 #include <vector>
 #include "oneflow/core/summary/summary.pb.h"
 
 namespace oneflow {
 
+namespace ep {
+
+class Stream;
+
+}  // namespace ep
+
 namespace summary {
 
 class Histogram {
@@ -29,8 +36,15 @@ class Histogram {
   ~Histogram() {}
 
   void AppendValue(double value);
+  // Appends the n values on the threads of the cpu stream
+  template<typename T>
+  void AppendValues(ep::Stream* stream, const T* values, int64_t n);
   void AppendToProto(HistogramProto* proto);
 
+  // public for the tests
+  int64_t BucketIndex(double value) const;
+  const std::vector<double>& bucket_limits() const { return max_constainers_; }
+
  private:
   double value_count_;
   double value_sum_;
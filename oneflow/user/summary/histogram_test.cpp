@@ -0,0 +1,145 @@
+/*
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <limits>
+#include <random>
+#include <gtest/gtest.h>
+#include "oneflow/core/ep/include/device_manager_registry.h"
+#include "oneflow/core/ep/cpu/cpu_device_manager.h"
+#include "oneflow/user/summary/histogram.h"
+
+namespace oneflow {
+
+namespace summary {
+
+namespace {
+
+int64_t UpperBoundBucketIndex(const std::vector<double>& limits, double value) {
+  const int64_t idx = std::upper_bound(limits.begin(), limits.end(), value) - limits.begin();
+  return std::min<int64_t>(idx, limits.size() - 1);
+}
+
+// The limits, their neighbours and the special values, which are the bucket boundary cases.
+std::vector<double> BoundaryValues(const std::vector<double>& limits) {
+  std::vector<double> values{0.0,
+                             -0.0,
+                             1.0,
+                             -1.0,
+                             1e-13,
+                             -1e-13,
+                             5e8,
+                             -5e8,
+                             1e300,
+                             -1e300,
+                             DBL_MIN,
+                             -DBL_MIN,
+                             std::numeric_limits<double>::infinity(),
+                             -std::numeric_limits<double>::infinity()};
+  for (double limit : limits) {
+    values.push_back(limit);
+    values.push_back(std::nextafter(limit, -std::numeric_limits<double>::infinity()));
+    values.push_back(std::nextafter(limit, std::numeric_limits<double>::infinity()));
+  }
+  return values;
+}
+
+void ExpectSameProto(const HistogramProto& lhs, const HistogramProto& rhs) {
+  EXPECT_EQ(lhs.num(), rhs.num());
+  EXPECT_EQ(lhs.min(), rhs.min());
+  EXPECT_EQ(lhs.max(), rhs.max());
+  // the partial sums are added in another order
+  EXPECT_NEAR(lhs.sum(), rhs.sum(), 1e-9 * std::abs(rhs.sum()) + 1e-9);
+  EXPECT_NEAR(lhs.sum_squares(), rhs.sum_squares(), 1e-9 * rhs.sum_squares() + 1e-9);
+  ASSERT_EQ(lhs.bucket_size(), rhs.bucket_size());
+  for (int i = 0; i < lhs.bucket_size(); ++i) {
+    EXPECT_EQ(lhs.bucket(i), rhs.bucket(i));
+    EXPECT_EQ(lhs.bucket_limit(i), rhs.bucket_limit(i));
+  }
+}
+
+// Appends the values by AppendValues on a cpu stream of num_threads threads, and one by one by
+// AppendValue, and expects the same histogram.
+template<typename T>
+void TestAppendValues(const std::vector<T>& values, size_t num_threads) {
+  ep::DeviceManagerRegistry registry;
+  dynamic_cast<ep::CpuDeviceManager*>(registry.GetDeviceManager(DeviceType::kCPU))
+      ->SetDeviceNumThreads(num_threads);
+  auto device = registry.GetDevice(DeviceType::kCPU, 0);
+  ep::Stream* stream = device->CreateStream();
+  CHECK_JUST(stream->OnExecutionContextSetup());
+  Histogram histogram;
+  histogram.AppendValues(stream, values.data(), values.size());
+  CHECK_JUST(stream->OnExecutionContextTeardown());
+  device->DestroyStream(stream);
+  Histogram expected_histogram;
+  for (T value : values) { expected_histogram.AppendValue(static_cast<double>(value)); }
+  HistogramProto proto;
+  HistogramProto expected_proto;
+  histogram.AppendToProto(&proto);
+  expected_histogram.AppendToProto(&expected_proto);
+  ExpectSameProto(proto, expected_proto);
+}
+
+}  // namespace
+
+TEST(Histogram, bucket_index) {
+  Histogram histogram;
+  const std::vector<double>& limits = histogram.bucket_limits();
+  const int64_t size = limits.size();
+  for (double value : BoundaryValues(limits)) {
+    EXPECT_EQ(histogram.BucketIndex(value), UpperBoundBucketIndex(limits, value)) << value;
+  }
+  // a limit belongs to the bucket above it
+  const int64_t zero_index = std::find(limits.begin(), limits.end(), 0.0) - limits.begin();
+  EXPECT_EQ(histogram.BucketIndex(0.0), zero_index + 1);
+  EXPECT_EQ(histogram.BucketIndex(-0.0), zero_index + 1);
+  EXPECT_EQ(histogram.BucketIndex(-1e-300), zero_index);
+  EXPECT_EQ(histogram.BucketIndex(-DBL_MAX), 1);
+  EXPECT_EQ(histogram.BucketIndex(-std::numeric_limits<double>::infinity()), 0);
+  // the largest bucket takes the values from the last finite limit on, inf and nan
+  EXPECT_EQ(histogram.BucketIndex(limits.at(size - 2)), size - 1);
+  EXPECT_EQ(histogram.BucketIndex(DBL_MAX), size - 1);
+  EXPECT_EQ(histogram.BucketIndex(std::numeric_limits<double>::infinity()), size - 1);
+  EXPECT_EQ(histogram.BucketIndex(std::numeric_limits<double>::quiet_NaN()), size - 1);
+}
+
+TEST(Histogram, append_values) {
+  std::mt19937 gen(0);
+  std::vector<double> values = BoundaryValues(Histogram().bucket_limits());
+  // enough values to be split over the threads
+  std::lognormal_distribution<double> magnitude(0.0, 8.0);
+  while (values.size() < 200000) {
+    values.push_back(gen() % 2 == 0 ? magnitude(gen) : -magnitude(gen));
+  }
+  std::shuffle(values.begin(), values.end(), gen);
+  // infinities would make the sums differ by nan
+  values.erase(std::remove_if(values.begin(), values.end(),
+                              [](double value) { return std::isinf(value); }),
+               values.end());
+  for (size_t num_threads : {1, 4}) {
+    TestAppendValues(values, num_threads);
+    TestAppendValues(std::vector<double>(values.begin(), values.begin() + 1000), num_threads);
+  }
+  std::vector<int8_t> int8_values(100000);
+  for (auto& value : int8_values) { value = static_cast<int8_t>(gen() % 256 - 128); }
+  TestAppendValues(int8_values, 4);
+}
+
+}  // namespace summary
+
+}  // namespace oneflow
@@ -212,6 +212,7 @@ from oneflow._C import pad
 from oneflow._C import transpose
 from oneflow._C import relu
 from oneflow._C import roc_auc_score
+from oneflow._C import roc_auc_histogram
 from oneflow._C import softmax
 from oneflow._C import log_softmax
 from oneflow._C import argmax
@@ -405,6 +406,9 @@ from oneflow.nn.modules.linspace import linspace_op as linspace
 from oneflow.nn.modules.logspace import logspace_op as logspace
 from oneflow.nn.modules.argsort import argsort_op as argsort
 from oneflow.nn.modules.argwhere import argwhere_op as argwhere
+from oneflow.nn.modules.roc_auc import (
+    roc_auc_score_from_histogram_op as roc_auc_score_from_histogram,
+)
 from oneflow.nn.modules.constant import ones_op as ones
 from oneflow.nn.modules.constant import zeros_op as zeros
 from oneflow.nn.modules.constant import zeros_like_op as zeros_like
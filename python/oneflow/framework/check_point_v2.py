@@ -14,8 +14,14 @@ See the License for the specific language governing permissions and
 limitations under the License.
 """
 import contextlib
+import glob
 import os
+import shutil
+import threading
+import time
+import uuid
 import warnings
+from concurrent.futures import ThreadPoolExecutor
 from typing import (
     Any,
     Callable,
@@ -193,22 +199,232 @@ class FileBackendVariableBlob:
             dtype=dtype_util.convert_oneflow_dtype_to_numpy_dtype(self.dtype),
         ).reshape(self.shape)
 
+    def memmap(self) -> np.ndarray:
+        if not self.has_meta_info_:
+            raise RuntimeError("This variable does not have meta info")
+        # copy-on-write, the writes to the array never reach the file
+        return np.memmap(
+            self.file_path,
+            dtype=dtype_util.convert_oneflow_dtype_to_numpy_dtype(self.dtype),
+            mode="c",
+            shape=self.shape,
+        )
 
-def _save_tensor_to_disk(tensor: "oneflow.Tensor", dir_name: Union[str, Path]) -> None:
-    os.makedirs(dir_name, exist_ok=True)
+
+def _get_meta_info(tensor: "oneflow.Tensor") -> variable_meta_info_pb.VariableMetaInfo:
     meta_info = variable_meta_info_pb.VariableMetaInfo()
     meta_info.shape.dim[:] = tensor.shape
     meta_info.data_type = oneflow._oneflow_internal.deprecated.GetProtoDtype4OfDtype(
         tensor.dtype
     )
+    return meta_info
+
+
+def _write_tensor_to_disk(
+    data: np.ndarray,
+    meta_info: variable_meta_info_pb.VariableMetaInfo,
+    dir_name: Union[str, Path],
+    fsync: bool = False,
+) -> None:
+    os.makedirs(dir_name, exist_ok=True)
     data_path = os.path.join(dir_name, DATA_FILENAME)
     with open(data_path, "wb") as f:
-        f.write(tensor.numpy().tobytes())
+        # write the buffer of the array directly, without a copy to bytes
+        f.write(np.ascontiguousarray(data).reshape(-1).view(np.uint8))
+        if fsync:
+            f.flush()
+            os.fsync(f.fileno())
 
     with open(os.path.join(dir_name, META_INFO_FILENAME), "w") as f:
         f.write(text_format.MessageToString(meta_info))
 
 
+def _save_tensor_to_disk(tensor: "oneflow.Tensor", dir_name: Union[str, Path]) -> None:
+    _write_tensor_to_disk(tensor.numpy(), _get_meta_info(tensor), dir_name)
+
+
+def _fsync_dir(dir_name: Union[str, Path]) -> None:
+    fd = os.open(dir_name, os.O_RDONLY)
+    try:
+        os.fsync(fd)
+    finally:
+        os.close(fd)
+
+
+def _old_checkpoint_paths(path: Path) -> List[Path]:
+    mtime_and_paths = []
+    for old_path in path.parent.glob(glob.escape(f".{path.name}") + ".old-*"):
+        try:
+            mtime_and_paths.append((old_path.stat().st_mtime, old_path))
+        except FileNotFoundError:
+            # moved back by another process
+            continue
+    return [old_path for _, old_path in sorted(mtime_and_paths)]
+
+
+def _recover_interrupted_commit(path: Path) -> None:
+    # An async save of a directory renames the old checkpoint away before renaming
+    # the new one into place. If the process died between the two renames, move
+    # the old checkpoint back so that `path` is loadable again.
+    # Every rank may call it on the same path, so losing the race is not an error.
+    if path.exists() or not path.parent.is_dir():
+        return
+    old_paths = _old_checkpoint_paths(path)
+    if len(old_paths) > 0:
+        try:
+            os.rename(old_paths[-1], path)
+        except OSError:
+            if not path.exists():
+                raise
+
+
+class AsyncSaveHandle(object):
+    r"""The handle returned by ``oneflow.save(..., async_save=True)``.
+
+    The tensors are copied to host memory before ``oneflow.save`` returns, so they
+    can be modified by the following training steps. The files are written by a
+    pool of ``ONEFLOW_CHECKPOINT_SAVE_THREAD_NUM`` (default 8) threads into a
+    temporary path next to the destination, which is renamed to the destination
+    after all the files are written. So the destination either holds the previous
+    checkpoint or the complete new one. Set ``ONEFLOW_CHECKPOINT_SAVE_FSYNC=1`` to
+    fsync every file and the directory before the rename.
+
+    A directory (``save_as_external_data=True``) can not be replaced atomically, so
+    the old checkpoint is renamed to a hidden ``.<name>.old-<uuid>`` sibling first.
+    If the process dies between the two renames, the destination is missing until
+    the next ``oneflow.load`` or async ``oneflow.save`` of it moves the old
+    checkpoint back.
+
+    Only one process writes: the one whose rank is ``global_dst_rank``, or rank 0
+    if ``global_dst_rank`` is None. The process does not exit before the checkpoint
+    is committed.
+    """
+
+    def __init__(self, path: Path, is_writer: bool):
+        self.path = Path(path)
+        self.tmp_path = self.path.parent / f".{self.path.name}.tmp-{uuid.uuid4().hex}"
+        self._is_writer = is_writer
+        if is_writer:
+            _recover_interrupted_commit(self.path)
+        self._fsync = os.getenv("ONEFLOW_CHECKPOINT_SAVE_FSYNC", "0").lower() in (
+            "1",
+            "true",
+            "yes",
+        )
+        self._executor = ThreadPoolExecutor(
+            max_workers=int(os.getenv("ONEFLOW_CHECKPOINT_SAVE_THREAD_NUM", "8"))
+        )
+        self._futures = []
+        self._lock = threading.Lock()
+        self._start_time = time.perf_counter()
+        self._snapshot_seconds = None
+        self._total_seconds = None
+        self._total_files = 0
+        self._total_bytes = 0
+        self._written_files = 0
+        self._written_bytes = 0
+        self._commit_thread = None
+        self._error = None
+
+    def _add_tensor(self, tensor: "oneflow.Tensor", dir_name: Path) -> None:
+        if not self._is_writer:
+            return
+        data = tensor.numpy()
+        if tensor.device.type == "cpu":
+            # numpy() of a cpu tensor shares the memory with it
+            data = data.copy()
+        self._total_files += 1
+        self._total_bytes += data.nbytes
+        self._futures.append(
+            self._executor.submit(
+                self._write_tensor, data, _get_meta_info(tensor), dir_name
+            )
+        )
+
+    def _write_tensor(self, data, meta_info, dir_name) -> None:
+        _write_tensor_to_disk(data, meta_info, dir_name, self._fsync)
+        with self._lock:
+            self._written_files += 1
+            self._written_bytes += data.nbytes
+
+    def _commit(self, pickled_bytes: bytes, save_as_external_data: bool) -> None:
+        self._snapshot_seconds = time.perf_counter() - self._start_time
+        if not self._is_writer:
+            self._executor.shutdown()
+            self._total_seconds = self._snapshot_seconds
+            return
+        # not a daemon thread, so the interpreter waits for the commit at exit
+        self._commit_thread = threading.Thread(
+            target=self._commit_in_background,
+            args=(pickled_bytes, save_as_external_data),
+        )
+        self._commit_thread.start()
+
+    def _commit_in_background(self, pickled_bytes, save_as_external_data) -> None:
+        try:
+            for future in self._futures:
+                future.result()
+            if save_as_external_data:
+                self.tmp_path.mkdir(exist_ok=True)
+                pickle_path = self.tmp_path / PICKLE_FILENAME
+            else:
+                pickle_path = self.tmp_path
+            with open(pickle_path, "wb") as f:
+                f.write(pickled_bytes)
+                if self._fsync:
+                    f.flush()
+                    os.fsync(f.fileno())
+            if self._fsync and save_as_external_data:
+                _fsync_dir(self.tmp_path)
+            if save_as_external_data and self.path.exists():
+                # a directory can not be replaced atomically, move the old one first
+                old_name = f".{self.path.name}.old-{uuid.uuid4().hex}"
+                old_path = self.path.parent / old_name
+                os.rename(self.path, old_path)
+                os.rename(self.tmp_path, self.path)
+                shutil.rmtree(old_path, ignore_errors=True)
+            else:
+                os.replace(self.tmp_path, self.path)
+            if self._fsync:
+                _fsync_dir(self.path.parent)
+        except BaseException as e:
+            self._error = e
+            if self.tmp_path.is_dir():
+                shutil.rmtree(self.tmp_path, ignore_errors=True)
+            elif self.tmp_path.exists():
+                os.remove(self.tmp_path)
+        finally:
+            self._executor.shutdown()
+            self._total_seconds = time.perf_counter() - self._start_time
+
+    def done(self) -> bool:
+        return self._commit_thread is None or not self._commit_thread.is_alive()
+
+    def wait(self) -> None:
+        r"""Blocks until the checkpoint is committed, raises the error if any."""
+        if self._commit_thread is not None:
+            self._commit_thread.join()
+        if self._error is not None:
+            raise self._error
+
+    def stats(self) -> Dict[str, Any]:
+        r"""The progress and latency of the saving.
+
+        ``snapshot_seconds`` is the time ``oneflow.save`` blocks the caller and
+        ``total_seconds`` is the time until the checkpoint is committed, which is
+        None before that.
+        """
+        with self._lock:
+            return {
+                "total_files": self._total_files,
+                "total_bytes": self._total_bytes,
+                "written_files": self._written_files,
+                "written_bytes": self._written_bytes,
+                "snapshot_seconds": self._snapshot_seconds,
+                "total_seconds": self._total_seconds if self.done() else None,
+            }
+
+
 ValueContainer = Union[FileBackendVariableBlob, np.ndarray, "oneflow.Tensor"]
 
 
@@ -281,10 +497,20 @@ def _LoadSingleVariable(
             flow.placement("cpu", [global_src_rank]), flow.sbp.broadcast
         )
     else:
-        loaded = flow.tensor(FileBackendVariableBlob(path).numpy())
+        file_backed_blob = FileBackendVariableBlob(path)
+        shape = file_backed_blob.shape
+        if _load_with_mmap() and len(shape) > 0 and np.prod(shape) > 0:
+            # the tensor aliases the mapped file instead of reading and copying it
+            loaded = flow.from_numpy(file_backed_blob.memmap())
+        else:
+            loaded = flow.tensor(file_backed_blob.numpy())
     return smart_to(loaded, map_location)
 
 
+def _load_with_mmap() -> bool:
+    return os.getenv("ONEFLOW_LOAD_WITH_MMAP", "0").lower() in ("1", "true", "yes")
+
+
 def _broadcast_py_object(obj, src: int = 0):
     rank = flow.env.get_rank()
     if src == rank:
@@ -330,7 +556,10 @@ def tensor_getstate(self):
                 context_data.global_rank is None
                 or context_data.global_rank == flow.env.get_rank()
             ):
-                _save_tensor_to_disk(tensor, abs_dir_name)
+                if context_data.async_save_handle is not None:
+                    context_data.async_save_handle._add_tensor(tensor, abs_dir_name)
+                else:
+                    _save_tensor_to_disk(tensor, abs_dir_name)
 
             return {"path": rel_dir_name}
         else:
@@ -464,9 +693,12 @@ def tensor_pickling_context(
     global_rank: Optional[int],
     mp: MAP_LOCATION,
     save_as_external_data: bool,
+    async_save_handle: Optional[AsyncSaveHandle] = None,
 ):
     global context_data
-    context_data = ContextData(path, global_rank, mp, save_as_external_data)
+    context_data = ContextData(
+        path, global_rank, mp, save_as_external_data, async_save_handle
+    )
     try:
         yield
     finally:
@@ -623,6 +855,8 @@ def load(
         path = Path(path)
     rank = flow.env.get_rank()
     if global_src_rank is None or global_src_rank == rank:
+        if _is_path(path):
+            _recover_interrupted_commit(Path(path))
         for i, (condition, load) in enumerate(load_methods):
             is_ok, extra_data = condition(path, support_pytorch_format)
             if is_ok:
@@ -685,7 +919,8 @@ def save(
     path_or_buffer: FILE_LIKE,
     global_dst_rank: Optional[int] = None,
     save_as_external_data: bool = False,
-) -> None:
+    async_save: bool = False,
+) -> Optional[AsyncSaveHandle]:
     r"""Save an object to a directory.
 
     Args:
@@ -699,6 +934,10 @@ def save(
             disk I/O.
         save_as_external_data (bool): useful only if path_or_buffer is a string or
            os.PathLike object containing a file name
+        async_save (bool): write the files in background threads and return an
+           :class:`AsyncSaveHandle` once the tensors are copied to host memory.
+           Only supported when path_or_buffer is a string or os.PathLike object.
+           Only rank global_dst_rank (rank 0 if it is None) writes the files
     """
     if isinstance(path_or_buffer, str):
         path_or_buffer = Path(path_or_buffer)
@@ -711,9 +950,37 @@ def save(
         _save_graph(obj, path_or_buffer)
         return
 
+    if global_dst_rank is not None:
+        assert isinstance(
+            global_dst_rank, int
+        ), f"global_dst_rank expected type int, but got {type(global_dst_rank)}."
+        assert (
+            global_dst_rank >= 0 and global_dst_rank < flow.env.get_world_size()
+        ), f"out of range (expected to be in range of [0, {flow.env.get_world_size()}), but got {global_dst_rank})."
+
+    obj = {"protocol_version": PROTOCOL_VERSION, ONEFLOW_MAGIC_KEY: None, "data": obj}
+
+    if async_save:
+        if not _is_path(path_or_buffer):
+            raise ValueError(
+                "path_or_buffer must be the type of {`str`, `pathlib.Path`} while async_save is True"
+            )
+        # every rank renaming the same destination races, so exactly one rank
+        # commits, rank 0 for local tensors
+        handle = AsyncSaveHandle(
+            path_or_buffer,
+            flow.env.get_rank()
+            == (global_dst_rank if global_dst_rank is not None else 0),
+        )
+        with tensor_pickling_context(
+            handle.tmp_path, global_dst_rank, None, save_as_external_data, handle
+        ):
+            pickled_bytes = pickle.dumps(obj)
+        handle._commit(pickled_bytes, save_as_external_data)
+        return handle
+
     # this `path` is only used for `ContextData` and is set to empty when `path_or_buffer` is IO[bytes] or BinaryIO
     path: Path = Path(path_or_buffer if _is_path(path_or_buffer) else "")
-    obj = {"protocol_version": PROTOCOL_VERSION, ONEFLOW_MAGIC_KEY: None, "data": obj}
 
     with tensor_pickling_context(path, global_dst_rank, None, save_as_external_data):
         pickled_bytes = pickle.dumps(obj)
@@ -727,12 +994,6 @@ def save(
             f.write(pickled_bytes)
 
     if global_dst_rank is not None:
-        assert isinstance(
-            global_dst_rank, int
-        ), f"global_dst_rank expected type int, but got {type(global_dst_rank)}."
-        assert (
-            global_dst_rank >= 0 and global_dst_rank < flow.env.get_world_size()
-        ), f"out of range (expected to be in range of [0, {flow.env.get_world_size()}), but got {global_dst_rank})."
         if flow.env.get_rank() == global_dst_rank:
             write_file()
     else:
@@ -786,11 +1047,13 @@ class ContextData:
         global_rank: Optional[int],
         map_location: Optional[Union[str, flow.device, flow.placement]],
         save_as_external_data: bool,
+        async_save_handle: Optional[AsyncSaveHandle] = None,
     ):
         self.path = path
         self.global_rank = global_rank
         self.map_location = map_location
         self.save_as_external_data = save_as_external_data
+        self.async_save_handle = async_save_handle
 
 
 context_data = None
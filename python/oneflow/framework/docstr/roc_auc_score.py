@@ -50,3 +50,42 @@ add_docstr(
 
     """,
 )
+
+add_docstr(
+    oneflow.roc_auc_histogram,
+    """
+    oneflow.roc_auc_histogram(label, pred, num_buckets=10000) -> Tensor
+
+    Count the negative and positive samples in each of ``num_buckets`` equal buckets of
+    the predicted probability. The counts are a streaming form of the ROC AUC: they can be
+    added over steps and across ranks, and :func:`oneflow.roc_auc_score_from_histogram`
+    turns them into the score.
+
+    Predictions are expected in [0, 1]: smaller ones (and nan) are counted in the first
+    bucket and larger ones in the last bucket.
+
+    Note: Currently this implementation can only be used on CPU.
+
+    Args:
+        label (Tensor[N, 1]): True lable of the samples
+        pred (Tensor[N, 1]): Predicted probability value to be true
+        num_buckets (int): Number of buckets of the predictions. Default: 10000
+
+    Returns:
+        Tensor[2, num_buckets]: int64 tensor of the counts of the negative samples (row 0)
+        and of the positive samples (row 1)
+
+    For example:
+
+    .. code-block:: python
+
+        >>> import oneflow as flow
+
+        >>> label = flow.tensor([0, 0, 1, 1])
+        >>> pred = flow.tensor([0.1, 0.4, 0.35, 0.8])
+        >>> flow.roc_auc_histogram(label, pred, num_buckets=4)
+        tensor([[1, 1, 0, 0],
+                [0, 1, 0, 1]], dtype=oneflow.int64)
+
+    """,
+)
@@ -351,13 +351,59 @@ class GraphConfig(object):
         """
         self.proto.enable_compress_memory = mode
 
+    def enable_activation_offload(
+        self,
+        mode: bool = True,
+        *,
+        min_size: int = 4 * 1024 * 1024,
+        min_lifetime: int = 64,
+        prefetch_distance: int = 16,
+    ):
+        """If true, the graph will stage the long-lived forward activations out to the host memory
+        and prefetch them back to the device before the backward pass uses them. It saves device
+        memory with the transfers overlapped with computation, instead of recomputation like
+        activation checkpointing.
+
+        Args:
+            mode (bool, optional): Whether to enable activation offload. Default is True.
+            min_size (int, optional): Only offload the activations whose size on each device is
+                at least ``min_size`` bytes. Default is 4MB.
+            min_lifetime (int, optional): Only offload the activations which are not used by
+                ``min_lifetime`` ops between the forward and backward pass. Default is 64.
+            prefetch_distance (int, optional): Start to copy the activation back to the device
+                ``prefetch_distance`` ops before its first use in the backward pass. Default is 16.
+        """
+        self.proto.activation_offload_conf.enable = mode
+        self.proto.activation_offload_conf.min_size = min_size
+        self.proto.activation_offload_conf.min_lifetime = min_lifetime
+        self.proto.activation_offload_conf.prefetch_distance = prefetch_distance
+
+    def enable_auto_activation_checkpointing(
+        self, mode: bool = True, *, memory_budget: int = 0
+    ):
+        """If true, the graph will choose the forward ops to recompute in the backward pass
+        automatically, besides those with ``activation_checkpointing`` set on their GraphModule.
+
+        The ops are chosen greedily by the estimated compute cost per byte of activation saved,
+        until the forward activations kept for the backward pass fit into ``memory_budget``.
+        Random ops and batch normalization are never recomputed.
+
+        Args:
+            mode (bool, optional): Whether to enable auto activation checkpointing. Default is True.
+            memory_budget (int, optional): The maximum size in bytes of the forward activations
+                kept for the backward pass on each device. Default is 0, which recomputes as
+                much as possible.
+        """
+        self.proto.auto_checkpointing_conf.enable = mode
+        self.proto.auto_checkpointing_conf.memory_budget = memory_budget
+
     def enable_choose_best_memory_allocation(self, mode: bool = True):
         """If true, then the graph will go through all the memory allocation algorithms. Including
         large memory first algorithm,
         long lifetime first algorithm,
         first in first allocates algorithm,
         large memory volume first algorithm
-        with the compact insertion on and off.
+        with the compact insertion on and off, and the interval tree insertion.
         The the graph will choose the one with the least memory.
 
         If false, the graph will directly choose
@@ -372,6 +418,19 @@ class GraphConfig(object):
             self.proto.memory_allocation_algorithm_conf.use_mem_volume_first_algo = True
             self.proto.memory_compact_insert_conf.use_compact_insert = True
             self.proto.memory_compact_insert_conf.use_non_compact_insert = True
+            self.proto.memory_compact_insert_conf.use_interval_tree_insert = True
+
+    def set_interval_tree_memory_allocation_threshold(self, threshold: int = 65536):
+        """Memory chains with more registers than the threshold will only use the interval tree
+        insertion to decide the memory offsets. The interval tree insertion only compares a
+        register with those alive at the same time, which avoids the quadratic time of the
+        compact and non-compact insertion on very large graphs.
+
+        Args:
+            threshold (int, optional): the maximum number of registers for the compact and
+                non-compact insertion. Default is 65536.
+        """
+        self.proto.memory_compact_insert_conf.interval_tree_insert_threshold = threshold
 
     def enable_auto_parallel(self, mode: bool = True):
         """If true, then graph will use the auto parallel algorithm to select a parallelism strategy.
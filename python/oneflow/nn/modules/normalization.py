@@ -179,7 +179,7 @@ def layer_norm(input, normalized_shape, weight=None, bias=None, eps=1e-05):
                 f"Given normalized_shape={normalized_shape}, expected input with shape [*, {str(normalized_shape)[1:-1]}], but got input of size {input.shape}"
             )
 
-    if input.is_cpu:
+    if input.is_cpu and input.dtype not in (flow.float32, flow.float64):
         reduce_axis = []
         for dim in range(len(input.shape)):
             if dim >= begin_norm_axis:
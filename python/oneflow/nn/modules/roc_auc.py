@@ -0,0 +1,63 @@
+"""
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+"""
+import oneflow as flow
+
+
+def roc_auc_score_from_histogram_op(histogram):
+    r"""
+    oneflow.roc_auc_score_from_histogram(histogram) -> Tensor
+
+    Compute the ROC AUC from the bucketed prediction counts returned by
+    :func:`oneflow.roc_auc_histogram`. Since histograms add up, they can be
+    accumulated over steps and reduced across ranks before calling this
+    function. Samples that fall in the same bucket count as ties, so the result
+    equals :func:`oneflow.roc_auc_score` of the predictions rounded down to their
+    bucket.
+
+    Args:
+        histogram (Tensor[2, num_buckets]): counts of the negative samples (row 0)
+            and of the positive samples (row 1) in each prediction bucket
+
+    Returns:
+        Tensor[1, ]: float32 tensor of auc score
+
+    For example:
+
+    .. code-block:: python
+
+        >>> import oneflow as flow
+
+        >>> label = flow.tensor([0, 0, 1, 1])
+        >>> pred = flow.tensor([0.1, 0.4, 0.35, 0.8])
+        >>> histogram = flow.roc_auc_histogram(label, pred, num_buckets=100)
+        >>> flow.roc_auc_score_from_histogram(histogram)
+        tensor([0.7500], dtype=oneflow.float32)
+
+    """
+    histogram = histogram.to(flow.float64)
+    negatives, positives = histogram[0], histogram[1]
+    num_positives = positives.sum()
+    # positives in strictly higher buckets, ties count for one half
+    positives_above = num_positives - flow.cumsum(positives, dim=0)
+    rank_sum = (negatives * (positives_above + 0.5 * positives)).sum()
+    score = rank_sum / (num_positives * negatives.sum())
+    return score.reshape(1).to(flow.float32)
+
+
+if __name__ == "__main__":
+    import doctest
+
+    doctest.testmod(raise_on_error=True)
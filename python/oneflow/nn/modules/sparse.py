@@ -263,6 +263,144 @@ def embedding(
         return flow._C.embedding(weight, input, padding_idx, scale_grad_by_freq)
 
 
+def embedding_bag(
+    input,
+    weight,
+    offsets=None,
+    max_norm=None,
+    norm_type=2.0,
+    scale_grad_by_freq=False,
+    mode="mean",
+    sparse=False,
+    per_sample_weights=None,
+    include_last_offset=False,
+    padding_idx=None,
+):
+    r"""Computes sums, means or maxes of `bags` of embeddings, without instantiating the
+    intermediate embeddings.
+
+    The interface is consistent with PyTorch.
+    The documentation is referenced from: https://pytorch.org/docs/stable/generated/torch.nn.functional.embedding_bag.html
+
+    The bags are reduced by a fused kernel on CPU. On other devices the embeddings are gathered
+    and then reduced by ``unsorted_segment_sum``, which supports ``"sum"`` and ``"mean"`` only.
+
+    The embeddings of :attr:`input` can come from :attr:`weight` directly, or from the unique
+    embeddings returned by a OneEmbedding lookup by passing them as :attr:`weight` and the inverse
+    indices as :attr:`input`.
+
+    Args:
+        input (oneflow.LongTensor): Tensor containing bags of indices into the embedding matrix
+        weight (Tensor): The embedding matrix with number of rows equal to the maximum possible index + 1,
+            and number of columns equal to the embedding size
+        offsets (oneflow.LongTensor, optional): Only used when :attr:`input` is 1D. :attr:`offsets` determines
+            the starting index position of each bag (sequence) in :attr:`input`.
+        max_norm (float, optional): If given, each embedding vector with norm larger than max_norm is renormalized to have
+                                    norm max_norm
+        norm_type (float, optional): The p of the p-norm to compute for the max_norm option. Default 2.
+        scale_grad_by_freq (boolean, optional): Not supported yet, must be False.
+        mode (string, optional): ``"sum"``, ``"mean"`` or ``"max"``. Specifies the way to reduce the bag.
+            Default: ``"mean"``
+        sparse (bool, optional): Not supported yet, must be False.
+        per_sample_weights (Tensor, optional): a tensor of float / double weights, or None to indicate all weights
+            should be taken to be 1. If specified, :attr:`per_sample_weights` must have exactly the same shape as
+            input and is treated as having the same :attr:`offsets`, if those are not None. Only supported for
+            ``mode="sum"``, other modes raise an error.
+        include_last_offset (bool, optional): if ``True``, the size of offsets is equal to the number of bags + 1.
+            The last element is the size of the input, or the ending index position of the last bag (sequence).
+        padding_idx (int, optional): If specified, the entries at :attr:`padding_idx` do not contribute to the
+            gradient and are excluded from the reduction.
+
+    For example:
+
+    .. code-block:: python
+
+        >>> import oneflow as flow
+        >>> import oneflow.nn.functional as F
+
+        >>> embedding_matrix = flow.rand(10, 3)
+        >>> input = flow.tensor([1, 2, 4, 5, 4, 3, 2, 9])
+        >>> offsets = flow.tensor([0, 4])
+        >>> output = F.embedding_bag(input, embedding_matrix, offsets, mode="sum")
+        >>> output.shape
+        oneflow.Size([2, 3])
+    """
+
+    assert sparse is False, "Not support sparse=True yet!"
+    assert scale_grad_by_freq is False, "Not support scale_grad_by_freq=True yet!"
+    if mode not in ("sum", "mean", "max"):
+        raise ValueError(f"mode has to be one of sum, mean or max, but got {mode}")
+    if per_sample_weights is not None and mode != "sum":
+        raise ValueError(
+            "embedding_bag: per_sample_weights was not None. "
+            f"per_sample_weights is only supported for mode='sum' (got mode='{mode}')."
+        )
+    if input.ndim == 2:
+        assert offsets is None, "offsets has to be None if input is 2D"
+        num_bags, bag_size = input.shape
+        offsets = flow.arange(
+            0, num_bags * bag_size, bag_size, dtype=input.dtype, device=input.device
+        )
+        input = input.flatten()
+        if per_sample_weights is not None:
+            per_sample_weights = per_sample_weights.flatten()
+    else:
+        assert input.ndim == 1, "input has to be 1D or 2D Tensor"
+        assert offsets is not None, "offsets has to be a 1D Tensor but got None"
+        if include_last_offset:
+            offsets = offsets[:-1]
+    if padding_idx is not None and padding_idx < 0:
+        padding_idx = weight.size(0) + padding_idx
+
+    if max_norm is not None:
+        with flow.no_grad():
+            weight = flow._C.embedding_renorm_(weight, input, max_norm, norm_type)
+
+    if weight.is_local and weight.device.type != "cpu":
+        return _embedding_bag_by_segment_sum(
+            input, weight, offsets, mode, per_sample_weights, padding_idx
+        )
+    return flow._C.embedding_bag(
+        weight, input, offsets, per_sample_weights, mode, padding_idx
+    )
+
+
+def _embedding_bag_by_segment_sum(
+    input, weight, offsets, mode, per_sample_weights, padding_idx
+):
+    # The fused embedding_bag op only has CPU kernels, other devices gather the
+    # embeddings and reduce them with unsorted_segment_sum.
+    if mode == "max":
+        raise NotImplementedError(
+            "embedding_bag with mode='max' is only supported on CPU, "
+            f"but got weight on {weight.device}"
+        )
+    num_bags = offsets.shape[0]
+    positions = flow.arange(
+        input.shape[0], dtype=offsets.dtype, device=offsets.device
+    )
+    # the bag of a sample is the last one starting at or before it
+    bag_ids = flow.searchsorted(offsets, positions, right=True) - 1
+    rows = flow._C.gather(weight, input, axis=0)
+    scale = per_sample_weights
+    if padding_idx is not None:
+        not_padding = (input != padding_idx).to(weight.dtype)
+        scale = not_padding if scale is None else scale * not_padding
+    if scale is not None:
+        rows = rows * scale.unsqueeze(1)
+    out = flow._C.unsorted_segment_sum(rows, bag_ids, axis=0, num_segments=num_bags)
+    if mode == "mean":
+        if padding_idx is None:
+            not_padding = flow.ones(
+                input.shape[0], dtype=weight.dtype, device=weight.device
+            )
+        counts = flow._C.unsorted_segment_sum(
+            not_padding, bag_ids, axis=0, num_segments=num_bags
+        )
+        out = out / flow.clamp(counts, min=1).unsqueeze(1)
+    return out
+
+
 if __name__ == "__main__":
     import doctest
 
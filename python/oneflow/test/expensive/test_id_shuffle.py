@@ -25,7 +25,7 @@ import numpy as np
 import oneflow as flow
 
 
-def _test_id_shuffle(test_case, has_table_id, num_tables):
+def _test_id_shuffle(test_case, has_table_id, num_tables, device):
     batch_size = 512
     ids = np.random.randint(0, 1000, (batch_size, num_tables), dtype=np.int64)
     if has_table_id:
@@ -34,10 +34,10 @@ def _test_id_shuffle(test_case, has_table_id, num_tables):
         )  # same id must have same table id, so in this case get table_ids from ids
         table_ids_tensor = flow.tensor(
             table_ids.astype(np.int32), requires_grad=False
-        ).to("cuda")
+        ).to(device)
     else:
         table_ids_tensor = None
-    ids_tensor = flow.tensor(ids, requires_grad=False).to("cuda")
+    ids_tensor = flow.tensor(ids, requires_grad=False).to(device)
 
     class TestGraph(flow.nn.Graph):
         def __init__(self):
@@ -119,7 +119,7 @@ def embedding_shuffle_quantize(np_data, np_dtype):
     return np_data
 
 
-def _test_embedding_shuffle(test_case, dtype, enable_quantize):
+def _test_embedding_shuffle(test_case, dtype, enable_quantize, device):
     batch_size = 512
     num_tables = 26
     embedding_size = 128
@@ -140,11 +140,11 @@ def _test_embedding_shuffle(test_case, dtype, enable_quantize):
         np_dtype = np.float32
     data = np.random.rand(1000, embedding_size).astype(np_dtype)
 
-    ids_tensor = flow.tensor(ids, requires_grad=False).to("cuda")
+    ids_tensor = flow.tensor(ids, requires_grad=False).to(device)
     table_ids_tensor = flow.tensor(table_ids.astype(np.int32), requires_grad=False).to(
-        "cuda"
+        device
     )
-    data_tensor = flow.tensor(data, requires_grad=False).to("cuda")
+    data_tensor = flow.tensor(data, requires_grad=False).to(device)
 
     class TestGraph(flow.nn.Graph):
         def __init__(self):
@@ -181,7 +181,9 @@ def _test_embedding_shuffle(test_case, dtype, enable_quantize):
     )
 
 
-def _test_embedding_gradient_shuffle(test_case, enable_quantize, fp16, embedding_size):
+def _test_embedding_gradient_shuffle(
+    test_case, enable_quantize, fp16, embedding_size, device
+):
     batch_size = 512
     num_tables = 26
     ids = np.random.randint(0, 1000, (batch_size, num_tables), dtype=np.int64)
@@ -204,11 +206,11 @@ def _test_embedding_gradient_shuffle(test_case, enable_quantize, fp16, embedding
     embedding_grad = np.random.uniform(
         low=-1, high=1, size=(batch_size, num_tables, embedding_size)
     ).astype(np.float32)
-    ids_tensor = flow.tensor(ids, requires_grad=False).to("cuda")
+    ids_tensor = flow.tensor(ids, requires_grad=False).to(device)
     table_ids_tensor = flow.tensor(table_ids.astype(np.int32), requires_grad=False).to(
-        "cuda"
+        device
     )
-    embedding_grad_tensor = flow.tensor(embedding_grad, requires_grad=False).to("cuda")
+    embedding_grad_tensor = flow.tensor(embedding_grad, requires_grad=False).to(device)
 
     class TestGraph(flow.nn.Graph):
         def __init__(self):
@@ -354,6 +356,7 @@ class DataShuffleTestCase(flow.unittest.TestCase):
         arg_dict = OrderedDict()
         arg_dict["has_table_id"] = [True, False]
         arg_dict["num_tables"] = [1, 26]
+        arg_dict["device"] = ["cuda"]
         for kwargs in GenArgDict(arg_dict):
             _test_id_shuffle(test_case, **kwargs)
 
@@ -361,7 +364,7 @@ class DataShuffleTestCase(flow.unittest.TestCase):
         arg_dict = OrderedDict()
         arg_dict["dtype"] = [flow.float32, flow.float16]
         arg_dict["enable_quantize"] = [True, False]
-
+        arg_dict["device"] = ["cuda"]
         for kwargs in GenArgDict(arg_dict):
             _test_embedding_shuffle(test_case, **kwargs)
 
@@ -370,6 +373,7 @@ class DataShuffleTestCase(flow.unittest.TestCase):
         arg_dict["enable_quantize"] = [True, False]
         arg_dict["fp16"] = [True, False]
         arg_dict["embedding_size"] = [128, 17]
+        arg_dict["device"] = ["cuda"]
         for kwargs in GenArgDict(arg_dict):
             _test_embedding_gradient_shuffle(test_case, **kwargs)
 
@@ -381,5 +385,35 @@ class DataShuffleTestCase(flow.unittest.TestCase):
             _test_unique_key_value(test_case, **kwargs)
 
 
+# The cpu kernels only shuffle on a single rank, and they have no quantized
+# communication or float16 kernels.
+@flow.unittest.skip_unless_1n1d()
+class CpuDataShuffleTestCase(flow.unittest.TestCase):
+    def test_id_shuffle(test_case):
+        arg_dict = OrderedDict()
+        arg_dict["has_table_id"] = [True, False]
+        arg_dict["num_tables"] = [1, 26]
+        arg_dict["device"] = ["cpu"]
+        for kwargs in GenArgDict(arg_dict):
+            _test_id_shuffle(test_case, **kwargs)
+
+    def test_embedding_shuffle(test_case):
+        arg_dict = OrderedDict()
+        arg_dict["dtype"] = [flow.float32]
+        arg_dict["enable_quantize"] = [False]
+        arg_dict["device"] = ["cpu"]
+        for kwargs in GenArgDict(arg_dict):
+            _test_embedding_shuffle(test_case, **kwargs)
+
+    def test_embedding_gradient_shuffle(test_case):
+        arg_dict = OrderedDict()
+        arg_dict["enable_quantize"] = [False]
+        arg_dict["fp16"] = [False]
+        arg_dict["embedding_size"] = [128, 17]
+        arg_dict["device"] = ["cpu"]
+        for kwargs in GenArgDict(arg_dict):
+            _test_embedding_gradient_shuffle(test_case, **kwargs)
+
+
 if __name__ == "__main__":
     unittest.main()
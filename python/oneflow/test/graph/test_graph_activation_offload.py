@@ -0,0 +1,119 @@
+"""
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+"""
+import os
+import re
+import unittest
+
+import numpy as np
+
+import oneflow as flow
+import oneflow.unittest
+
+
+def _build_model():
+    return flow.nn.Sequential(
+        flow.nn.Linear(8, 16),
+        flow.nn.ReLU(),
+        flow.nn.Linear(16, 16),
+        flow.nn.ReLU(),
+        flow.nn.Linear(16, 1),
+    )
+
+
+def _train_graph(test_case, offload, device):
+    flow.manual_seed(0)
+    model = _build_model().to(device)
+    loss_fn = flow.nn.MSELoss(reduction="sum")
+    optimizer = flow.optim.SGD(model.parameters(), lr=1e-3)
+
+    class TrainGraph(flow.nn.Graph):
+        def __init__(self):
+            super().__init__()
+            self.model = model
+            self.loss_fn = loss_fn
+            self.add_optimizer(optimizer)
+            if offload:
+                self.config.enable_activation_offload(
+                    min_size=0, min_lifetime=0, prefetch_distance=2
+                )
+
+        def build(self, x, y):
+            loss = self.loss_fn(self.model(x), y)
+            loss.backward()
+            return loss
+
+    graph = TrainGraph()
+    np.random.seed(0)
+    losses = []
+    for _ in range(3):
+        x = flow.tensor(np.random.randn(4, 8), dtype=flow.float32, device=device)
+        y = flow.tensor(np.random.randn(4, 1), dtype=flow.float32, device=device)
+        losses.append(graph(x, y).numpy())
+    return graph, losses
+
+
+def _offload_op_names(graph, prefix):
+    return set(
+        op.name
+        for op in graph._full_graph_proto.net.op
+        if re.search(prefix, op.name) is not None
+    )
+
+
+@flow.unittest.skip_unless_1n1d()
+class TestGraphActivationOffloadCPU(flow.unittest.TestCase):
+    def test_activation_offload_on_cpu(test_case):
+        # the activations on cpu are already in the host memory, the pass keeps the job
+        graph, offload_losses = _train_graph(test_case, True, "cpu")
+        _, losses = _train_graph(test_case, False, "cpu")
+        test_case.assertTrue(np.allclose(offload_losses, losses, 1e-4, 1e-4))
+        job_conf = graph._full_graph_proto.job_conf
+        test_case.assertTrue(job_conf.activation_offload_conf.enable)
+        test_case.assertEqual(
+            len(_offload_op_names(graph, "Sys-ActivationOffload-Copy")), 0
+        )
+
+
+@unittest.skipIf(os.getenv("ONEFLOW_TEST_CPU_ONLY"), "only test cpu cases")
+@flow.unittest.skip_unless_1n1d()
+class TestGraphActivationOffload(flow.unittest.TestCase):
+    def test_activation_offload(test_case):
+        graph, offload_losses = _train_graph(test_case, True, "cuda")
+        _, losses = _train_graph(test_case, False, "cuda")
+        test_case.assertTrue(np.allclose(offload_losses, losses, 1e-4, 1e-4))
+
+        copy_out_op_names = _offload_op_names(
+            graph, "Sys-ActivationOffload-CopyOut-"
+        )
+        copy_in_op_names = _offload_op_names(graph, "Sys-ActivationOffload-CopyIn-")
+        test_case.assertTrue(len(copy_in_op_names) > 0)
+        test_case.assertEqual(len(copy_out_op_names), len(copy_in_op_names))
+        # The copy-outs are anchored after the last forward use of the activations
+        for op in graph._full_graph_proto.net.op:
+            if op.name in copy_out_op_names:
+                test_case.assertTrue(len(op.ctrl_in_op_name) > 0)
+        # The backward ops take the prefetched activations as input
+        find_bw_consumer = False
+        for op in graph._full_graph_proto.net.op:
+            for value in op.user_conf.input.values():
+                for lbn in value.s:
+                    if lbn.split("/")[0] in copy_in_op_names:
+                        find_bw_consumer = True
+        test_case.assertTrue(find_bw_consumer)
+
+
+if __name__ == "__main__":
+    unittest.main()
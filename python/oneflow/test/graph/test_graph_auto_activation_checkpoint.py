@@ -0,0 +1,100 @@
+"""
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+"""
+import os
+import re
+import unittest
+
+import numpy as np
+
+import oneflow as flow
+import oneflow.unittest
+
+
+def _train_graph(memory_budget, device):
+    # the weight of the second linear (128KB) is kept for the backward pass, and is
+    # larger than all the activations kept for the backward pass (less than 96KB)
+    flow.manual_seed(0)
+    model = flow.nn.Sequential(
+        flow.nn.Linear(8, 32), flow.nn.GELU(), flow.nn.Linear(32, 1024)
+    ).to(device)
+    loss_fn = flow.nn.MSELoss(reduction="sum")
+    optimizer = flow.optim.SGD(model.parameters(), lr=1e-3)
+
+    class TrainGraph(flow.nn.Graph):
+        def __init__(self):
+            super().__init__()
+            self.model = model
+            self.loss_fn = loss_fn
+            self.add_optimizer(optimizer)
+            if memory_budget is not None:
+                self.config.enable_auto_activation_checkpointing(
+                    memory_budget=memory_budget
+                )
+
+        def build(self, x, y):
+            loss = self.loss_fn(self.model(x), y)
+            loss.backward()
+            return loss
+
+    graph = TrainGraph()
+    np.random.seed(0)
+    losses = []
+    for _ in range(3):
+        x = flow.tensor(np.random.randn(4, 8), dtype=flow.float32, device=device)
+        y = flow.tensor(np.random.randn(4, 1024), dtype=flow.float32, device=device)
+        losses.append(graph(x, y).numpy())
+    return graph, losses
+
+
+def _recomputed_op_type_names(graph):
+    op_name2op_type_name = {}
+    fake_op_names = []
+    for op in graph._full_graph_proto.net.op:
+        op_name2op_type_name[op.name] = op.user_conf.op_type_name
+        if re.search("Sys-Checkpointing-Fake-Fw-Op_", op.name) is not None:
+            fake_op_names.append(op.name)
+    return set(
+        op_name2op_type_name[name[len("Sys-Checkpointing-Fake-Fw-Op_") :]]
+        for name in fake_op_names
+    )
+
+
+def _test_auto_activation_checkpoint(test_case, device):
+    _, losses = _train_graph(None, device)
+
+    # the cheap gelu is recomputed when nothing could be kept
+    graph, auto_losses = _train_graph(0, device)
+    test_case.assertTrue(np.allclose(auto_losses, losses, 1e-4, 1e-4))
+    test_case.assertIn("gelu", _recomputed_op_type_names(graph))
+
+    # the activations fit into the budget, the weights are not counted
+    graph, auto_losses = _train_graph(96 * 1024, device)
+    test_case.assertTrue(np.allclose(auto_losses, losses, 1e-4, 1e-4))
+    test_case.assertEqual(len(_recomputed_op_type_names(graph)), 0)
+
+
+@flow.unittest.skip_unless_1n1d()
+class TestGraphAutoActivationCheckpoint(flow.unittest.TestCase):
+    def test_auto_activation_checkpoint_cpu(test_case):
+        _test_auto_activation_checkpoint(test_case, "cpu")
+
+    @unittest.skipIf(os.getenv("ONEFLOW_TEST_CPU_ONLY"), "only test cpu cases")
+    def test_auto_activation_checkpoint_cuda(test_case):
+        _test_auto_activation_checkpoint(test_case, "cuda")
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,87 @@
+"""
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+"""
+
+# The serial vs parallel eager backward of a wide graph. It is not collected by the
+# test runners, run it with
+#   python3 autograd_parallel_backward_benchmark.py --thread-nums 1 2 4 8
+
+import argparse
+import time
+
+import numpy as np
+import oneflow as flow
+
+from test_autograd_parallel_backward import _BackwardThreadNum
+
+
+def _wide_graph_backward(x_np, weight_nps, thread_num, depth):
+    x = flow.tensor(x_np, requires_grad=True)
+    weights = [flow.tensor(w, requires_grad=True) for w in weight_nps]
+    # every weight is a independent branch, and all the branches share x
+    losses = []
+    for w in weights:
+        y = x
+        for _ in range(depth):
+            y = flow.tanh(flow.matmul(y, w))
+        losses.append(y.sum())
+    loss = flow.stack(losses).sum()
+    with _BackwardThreadNum(thread_num):
+        start = time.perf_counter()
+        loss.backward()
+        x_grad = x.grad.numpy()
+        elapsed = time.perf_counter() - start
+    return x_grad, elapsed
+
+
+def main():
+    parser = argparse.ArgumentParser()
+    parser.add_argument("--thread-nums", type=int, nargs="+", default=[1, 2, 4, 8])
+    parser.add_argument("--branch-num", type=int, default=32)
+    parser.add_argument("--depth", type=int, default=4)
+    parser.add_argument("--batch-size", type=int, default=64)
+    parser.add_argument("--hidden-size", type=int, default=256)
+    parser.add_argument("--repeat", type=int, default=3)
+    args = parser.parse_args()
+
+    x_np = np.random.randn(args.batch_size, args.hidden_size).astype(np.float32)
+    weight_nps = [
+        np.random.randn(args.hidden_size, args.hidden_size).astype(np.float32)
+        for _ in range(args.branch_num)
+    ]
+    # the first thread num is the baseline of the speedup
+    serial_x_grad = None
+    serial_elapsed = None
+    for thread_num in args.thread_nums:
+        # warmup
+        _wide_graph_backward(x_np, weight_nps, thread_num, args.depth)
+        results = [
+            _wide_graph_backward(x_np, weight_nps, thread_num, args.depth)
+            for _ in range(args.repeat)
+        ]
+        x_grad = results[0][0]
+        elapsed = min([result[1] for result in results])
+        if serial_x_grad is None:
+            serial_x_grad, serial_elapsed = x_grad, elapsed
+        assert np.allclose(serial_x_grad, x_grad, 1e-4, 1e-4)
+        print(
+            "wide graph backward with {} threads: {:.3f} ms, speedup {:.2f}x".format(
+                thread_num, elapsed * 1000, serial_elapsed / elapsed
+            )
+        )
+
+
+if __name__ == "__main__":
+    main()
@@ -59,6 +59,15 @@ def _test_tensor_argsort(test_case, data_shape, axis, descending, data_type, dev
     test_case.assertTrue(np.array_equal(of_out.numpy().flatten(), np_out.flatten()))
 
 
+def _test_argsort_large_with_ties(test_case, data_shape, descending, data_type):
+    # few distinct values, so the ties must be ordered by index
+    np_input = np.random.randint(-50, 50, size=data_shape)
+    input = flow.tensor(np_input, dtype=type_name_to_flow_type[data_type])
+    of_out = flow.argsort(input, dim=-1, descending=descending)
+    np_out = np.argsort(-np_input if descending else np_input, axis=-1, kind="stable")
+    test_case.assertTrue(np.array_equal(of_out.numpy(), np_out))
+
+
 @flow.unittest.skip_unless_1n1d()
 class TestArgsort(flow.unittest.TestCase):
     def test_argsort(test_case):
@@ -72,6 +81,15 @@ class TestArgsort(flow.unittest.TestCase):
         for arg in GenArgList(arg_dict):
             arg[0](test_case, *arg[1:])
 
+    def test_argsort_large_instance_with_ties(test_case):
+        # instances of at least 131072 elements are sorted by a parallel merge sort
+        arg_dict = OrderedDict()
+        arg_dict["data_shape"] = [(262144,), (2, 200003)]
+        arg_dict["descending"] = [True, False]
+        arg_dict["data_type"] = ["double", "float32", "int32"]
+        for arg in GenArgList(arg_dict):
+            _test_argsort_large_with_ties(test_case, *arg)
+
     @autotest(auto_backward=False, check_graph=True)
     def test_argsort_with_random_data(test_case):
         device = random_device()
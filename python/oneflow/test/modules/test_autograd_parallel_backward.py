@@ -0,0 +1,133 @@
+"""
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+"""
+
+import os
+import unittest
+
+import numpy as np
+import oneflow as flow
+import oneflow.unittest
+
+
+class _BackwardThreadNum(object):
+    def __init__(self, thread_num):
+        self.thread_num = thread_num
+
+    def __enter__(self):
+        self.prev = os.environ.get("ONEFLOW_EAGER_BACKWARD_THREAD_NUM")
+        os.environ["ONEFLOW_EAGER_BACKWARD_THREAD_NUM"] = str(self.thread_num)
+
+    def __exit__(self, *args):
+        if self.prev is None:
+            del os.environ["ONEFLOW_EAGER_BACKWARD_THREAD_NUM"]
+        else:
+            os.environ["ONEFLOW_EAGER_BACKWARD_THREAD_NUM"] = self.prev
+
+
+def _wide_graph_backward(x_np, weight_nps, thread_num, depth=4):
+    x = flow.tensor(x_np, requires_grad=True)
+    weights = [flow.tensor(w, requires_grad=True) for w in weight_nps]
+    # every weight is a independent branch, and all the branches share x
+    losses = []
+    for w in weights:
+        y = x
+        for _ in range(depth):
+            y = flow.tanh(flow.matmul(y, w))
+        losses.append(y.sum())
+    loss = flow.stack(losses).sum()
+    with _BackwardThreadNum(thread_num):
+        loss.backward()
+    return x.grad.numpy(), [w.grad.numpy() for w in weights]
+
+
+@flow.unittest.skip_unless_1n1d()
+class TestAutogradParallelBackward(flow.unittest.TestCase):
+    def test_wide_graph(test_case):
+        x_np = np.random.randn(8, 16).astype(np.float32)
+        weight_nps = [np.random.randn(16, 16).astype(np.float32) for _ in range(8)]
+        x_grad, w_grads = _wide_graph_backward(x_np, weight_nps, 1)
+        for thread_num in [2, 4]:
+            parallel_x_grad, parallel_w_grads = _wide_graph_backward(
+                x_np, weight_nps, thread_num
+            )
+            test_case.assertTrue(np.allclose(x_grad, parallel_x_grad, 1e-4, 1e-4))
+            for w_grad, parallel_w_grad in zip(w_grads, parallel_w_grads):
+                test_case.assertTrue(np.allclose(w_grad, parallel_w_grad, 1e-4, 1e-4))
+
+    def test_autograd_grad(test_case):
+        x = flow.randn(4, 5, requires_grad=True)
+        y = flow.randn(4, 5, requires_grad=True)
+        z = (x * y).sum() + (x.exp() * 2).sum() + y.sin().sum()
+        with _BackwardThreadNum(3):
+            x_grad, y_grad = flow.autograd.grad(z, [x, y])
+        test_case.assertTrue(
+            np.allclose(x_grad.numpy(), (y + x.exp() * 2).numpy(), 1e-4, 1e-4)
+        )
+        test_case.assertTrue(
+            np.allclose(y_grad.numpy(), (x + y.cos()).numpy(), 1e-4, 1e-4)
+        )
+
+    def test_python_autograd_function(test_case):
+        class MyMul(flow.autograd.Function):
+            @staticmethod
+            def forward(ctx, x, y):
+                ctx.save_for_backward(x, y)
+                return x * y
+
+            @staticmethod
+            def backward(ctx, z_grad):
+                x, y = ctx.saved_tensors
+                return z_grad * y, z_grad * x
+
+        x = flow.randn(4, 5, requires_grad=True)
+        ys = [flow.randn(4, 5, requires_grad=True) for _ in range(4)]
+        loss = sum([MyMul.apply(x, y).sum() for y in ys])
+        with _BackwardThreadNum(4):
+            loss.backward()
+        test_case.assertTrue(
+            np.allclose(x.grad.numpy(), sum([y.numpy() for y in ys]), 1e-4, 1e-4)
+        )
+        for y in ys:
+            test_case.assertTrue(np.allclose(y.grad.numpy(), x.numpy(), 1e-4, 1e-4))
+
+    def test_nested_grad_in_autograd_function(test_case):
+        # the backward of the custom Function starts another backward on the worker
+        class CubeByGrad(flow.autograd.Function):
+            @staticmethod
+            def forward(ctx, x):
+                ctx.save_for_backward(x)
+                return x * x * x
+
+            @staticmethod
+            def backward(ctx, y_grad):
+                (x,) = ctx.saved_tensors
+                with flow.enable_grad():
+                    x = x.detach().requires_grad_()
+                    (x_grad,) = flow.autograd.grad((x * x * x).sum(), [x])
+                return y_grad * x_grad
+
+        xs = [flow.randn(4, 5, requires_grad=True) for _ in range(4)]
+        loss = sum([CubeByGrad.apply(x).sum() for x in xs])
+        with _BackwardThreadNum(4):
+            loss.backward()
+        for x in xs:
+            test_case.assertTrue(
+                np.allclose(x.grad.numpy(), 3 * x.numpy() ** 2, 1e-4, 1e-4)
+            )
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -1954,6 +1954,57 @@ class TestConv2d(flow.unittest.TestCase):
         y = m(x)
         return y
 
+    @autotest(n=5, rtol=1e-3, atol=1e-3)
+    def test_conv2d_cpu_winograd_and_1x1_with_random_data(test_case):
+        channels = random(16, 33).to(int)
+        m = torch.nn.Conv2d(
+            in_channels=channels,
+            out_channels=random(16, 33).to(int),
+            kernel_size=oneof(1, 3),
+            padding=random(0, 2).to(int) | nothing(),
+            bias=random_bool(),
+        )
+        m.train(random())
+        m.to("cpu")
+        x = random_tensor(ndim=4, dim1=channels, dim2=random(3, 12), dim3=random(3, 12))
+        y = m(x.to("cpu"))
+        return y
+
+    @autotest(n=5, rtol=1e-3, atol=1e-3)
+    def test_conv2d_cpu_gemm_1x1_with_random_data(test_case):
+        # more than 64 input channels per group, so it is not computed directly
+        channels = random(65, 97).to(int)
+        m = torch.nn.Conv2d(
+            in_channels=channels,
+            out_channels=random(8, 33).to(int),
+            kernel_size=1,
+            bias=random_bool(),
+        )
+        m.train(random())
+        m.to("cpu")
+        x = random_tensor(ndim=4, dim1=channels, dim2=random(3, 12), dim3=random(3, 12))
+        y = m(x.to("cpu"))
+        return y
+
+    @autotest(n=5, rtol=1e-3, atol=1e-3)
+    def test_conv2d_cpu_depthwise_with_random_data(test_case):
+        channels = random(1, 17).to(int)
+        m = torch.nn.Conv2d(
+            in_channels=channels,
+            out_channels=channels,
+            kernel_size=random(1, 4),
+            stride=random(1, 3) | nothing(),
+            padding=random(0, 2).to(int) | nothing(),
+            dilation=random(1, 3) | nothing(),
+            groups=channels,
+            bias=random_bool(),
+        )
+        m.train(random())
+        m.to("cpu")
+        x = random_tensor(ndim=4, dim1=channels, dim2=random(5, 12), dim3=random(5, 12))
+        y = m(x.to("cpu"))
+        return y
+
     @unittest.skipIf(os.getenv("ONEFLOW_TEST_CPU_ONLY"), "only test cpu cases")
     @autotest(n=5, check_allclose=False)
     def test_conv2d_group_with_random_data(test_case):
@@ -168,6 +168,35 @@ def _test_fused_matmul_bias_add_relu(
     )
 
 
+def _test_fused_mlp_cpu_inference(
+    test_case, batchsize, in_feature, hidden_size_list, out_feature, dtype
+):
+    x = flow.randn(batchsize, in_feature, dtype=dtype)
+    weight_list = []
+    bias_list = []
+    for feature in hidden_size_list + [out_feature]:
+        weight_list.append(flow.randn(feature, in_feature, dtype=dtype))
+        bias_list.append(flow.randn(feature, dtype=dtype))
+        in_feature = feature
+
+    for skip_final_activation in [True, False]:
+        with flow.no_grad():
+            fused_out = flow._C.fused_mlp(
+                x, weight_list, bias_list, skip_final_activation=skip_final_activation
+            )
+        naive_out = x
+        for idx in range(len(weight_list)):
+            naive_out = _matmul_bias_relu(
+                naive_out,
+                weight_list[idx],
+                bias_list[idx],
+                skip_final_activation and idx == len(weight_list) - 1,
+            )
+        test_case.assertTrue(
+            np.allclose(fused_out.numpy(), naive_out.numpy(), atol=1e-4, rtol=1e-4)
+        )
+
+
 @flow.unittest.skip_unless_1n1d()
 class TestFusedMatmulBiasAddRelu(flow.unittest.TestCase):
     def test_fused_matmul_op(test_case):
@@ -184,6 +213,16 @@ class TestFusedMatmulBiasAddRelu(flow.unittest.TestCase):
         for arg in GenArgList(args_dict):
             arg[0](test_case, *arg[1:])
 
+    def test_fused_mlp_cpu_inference(test_case):
+        args_dict = OrderedDict()
+        args_dict["batchsize"] = [1, 4, 300]
+        args_dict["in_feature"] = [96, 128]
+        args_dict["hidden_size_list"] = [[256, 512], [96, 144], []]
+        args_dict["out_feature"] = [512, 1, 33]
+        args_dict["dtype"] = [flow.float32, flow.float64]
+        for arg in GenArgList(args_dict):
+            _test_fused_mlp_cpu_inference(test_case, *arg)
+
 
 if __name__ == "__main__":
     unittest.main()
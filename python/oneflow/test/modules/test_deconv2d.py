@@ -894,6 +894,27 @@ class TestDeconv2d(flow.unittest.TestCase):
         y = m(x)
         return y
 
+    @autotest(n=10, rtol=1e-3, atol=1e-3)
+    def test_deconv2d_cpu_direct_with_random_data(test_case):
+        # few channels per group, so the cpu kernels take the direct path
+        groups = oneof(1, 2).value()
+        channels = groups * random(1, 4).to(int).value()
+        m = torch.nn.ConvTranspose2d(
+            in_channels=channels,
+            out_channels=groups * random(1, 4).to(int).value(),
+            kernel_size=random(1, 4).to(int),
+            stride=random(1, 3).to(int),
+            padding=random(0, 2).to(int),
+            dilation=random(1, 3).to(int),
+            groups=groups,
+            bias=random_bool(),
+        )
+        m.train(random())
+        m.to("cpu")
+        x = random_tensor(ndim=4, dim1=channels, dim2=random(4, 9), dim3=random(4, 9))
+        y = m(x.to("cpu"))
+        return y
+
     @unittest.skipIf(
         version.parse(torch_original.__version__) <= version.parse("1.13.0"),
         "deconv module don't support unbatched input in PyTorch before '1.13.0'",
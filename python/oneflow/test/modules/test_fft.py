@@ -878,6 +878,48 @@ class TestComplex64Fft(flow.unittest.TestCase):
             arg[0](test_case, *arg[1:])
 
 
+def _test_cpu_batched_fft(test_case, shape, n):
+    # repeating a length reuses the cached pocketfft plan
+    for _ in range(3):
+        x = np.random.randn(*shape)
+        x_flow = flow.tensor(x, device="cpu")
+        test_case.assertTrue(
+            np.allclose(
+                flow.fft.fft(x_flow, n=n).numpy(), np.fft.fft(x, n=n), 1e-7, 1e-7
+            )
+        )
+        test_case.assertTrue(
+            np.allclose(
+                flow.fft.rfft(x_flow, n=n).numpy(), np.fft.rfft(x, n=n), 1e-7, 1e-7
+            )
+        )
+        y = np.fft.fft(x, n=n)
+        test_case.assertTrue(
+            np.allclose(
+                flow.fft.ifft(flow.tensor(y, device="cpu")).numpy(),
+                np.fft.ifft(y),
+                1e-7,
+                1e-7,
+            )
+        )
+
+
+@flow.unittest.skip_unless_1n1d()
+class TestCpuBatchedFft(flow.unittest.TestCase):
+    def test_cpu_batched_fft(test_case):
+        # large batches are split over the threads, small batches of long transforms
+        # are handed to pocketfft as a whole
+        arg_dict = OrderedDict()
+        arg_dict["shape_n"] = [
+            ((512, 256), None),
+            ((4, 8, 1000), 1000),
+            ((3, 20000), None),
+            ((512, 100), 128),
+        ]
+        for arg in GenArgList(arg_dict):
+            _test_cpu_batched_fft(test_case, *arg[0])
+
+
 # NOTE: skip for multi-nodes and multi-devices now, because it failed in ci randomly
 @flow.unittest.skip_unless_1n1d()
 class TestComplex128Fft(TestComplex64Fft):
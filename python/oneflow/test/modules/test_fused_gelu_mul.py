@@ -23,9 +23,9 @@ import oneflow.unittest
 from oneflow.test_utils.test_util import GenArgDict
 
 
-def _test_fused_fast_gelu_mul(test_case, shape, dtype=flow.float32):
-    x = flow.randn(*shape).to(dtype=dtype, device="cuda").requires_grad_(True)
-    multiplier = flow.randn(*shape).to(dtype=dtype, device="cuda").requires_grad_(True)
+def _test_fused_fast_gelu_mul(test_case, shape, dtype=flow.float32, device="cuda"):
+    x = flow.randn(*shape).to(dtype=dtype, device=device).requires_grad_(True)
+    multiplier = flow.randn(*shape).to(dtype=dtype, device=device).requires_grad_(True)
     y = flow.nn.functional.gelu(x, approximate="tanh") * multiplier
     y.mean().backward()
     x_grad = x.grad.detach().cpu()
@@ -68,5 +68,16 @@ class TestFusedFastGeluMul(flow.unittest.TestCase):
             _test_fused_fast_gelu_mul(test_case, **kwarg)
 
 
+@flow.unittest.skip_unless_1n1d()
+class TestFusedFastGeluMulCPU(flow.unittest.TestCase):
+    def test_fused_fast_gelu_mul(test_case):
+        args_dict = OrderedDict()
+        args_dict["shape"] = [[5], [7, 10], [4, 2, 3], [8, 3, 16, 16]]
+        args_dict["dtype"] = [flow.float32, flow.float64]
+        args_dict["device"] = ["cpu"]
+        for kwarg in GenArgDict(args_dict):
+            _test_fused_fast_gelu_mul(test_case, **kwarg)
+
+
 if __name__ == "__main__":
     unittest.main()
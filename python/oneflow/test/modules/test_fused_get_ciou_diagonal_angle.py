@@ -88,7 +88,7 @@ class TestGetCiouDiagonalAngle(flow.unittest.TestCase):
     def test_fused_get_ciou_diagonal_angle(test_case):
         arg_dict = OrderedDict()
         arg_dict["test_fun"] = [_test_fused_get_ciou_diagonal_angle_impl]
-        arg_dict["device"] = ["cuda"]
+        arg_dict["device"] = ["cuda", "cpu"]
         arg_dict["shape"] = [(583, 1), (759, 1), (1234, 1)]
         for arg in GenArgList(arg_dict):
             arg[0](test_case, *arg[1:])
@@ -82,7 +82,7 @@ class TestGetCiouResultModule(flow.unittest.TestCase):
     def test_get_ciou_result(test_case):
         arg_dict = OrderedDict()
         arg_dict["test_fun"] = [_test_get_ciou_result_impl]
-        arg_dict["device"] = ["cuda"]
+        arg_dict["device"] = ["cuda", "cpu"]
         arg_dict["shape"] = [(492), (691, 1), (1162, 1)]
         for arg in GenArgList(arg_dict):
             arg[0](test_case, *arg[1:])
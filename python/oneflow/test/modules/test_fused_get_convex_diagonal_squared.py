@@ -124,7 +124,7 @@ class TestGetCenterDistModule(flow.unittest.TestCase):
     def test_fused_get_convex_diagonal_squared(test_case):
         arg_dict = OrderedDict()
         arg_dict["test_fun"] = [_test_fused_get_convex_diagonal_squared_impl]
-        arg_dict["device"] = ["cuda"]
+        arg_dict["device"] = ["cuda", "cpu"]
         arg_dict["shape"] = [(583, 1), (759, 1), (1234, 1)]
         for arg in GenArgList(arg_dict):
             arg[0](test_case, *arg[1:])
@@ -118,7 +118,7 @@ class TestGetIntersectionAreaModule(flow.unittest.TestCase):
     def test_fused_get_inter_intersection_area(test_case):
         arg_dict = OrderedDict()
         arg_dict["test_fun"] = [_test_fused_get_intersection_area_impl]
-        arg_dict["device"] = ["cuda"]
+        arg_dict["device"] = ["cuda", "cpu"]
         arg_dict["shape"] = [(583, 1), (759, 1), (1234, 1)]
         for arg in GenArgList(arg_dict):
             arg[0](test_case, *arg[1:])
@@ -82,7 +82,7 @@ class TestGetIouModule(flow.unittest.TestCase):
     def test_get_iou(test_case):
         arg_dict = OrderedDict()
         arg_dict["test_fun"] = [_test_get_iou_impl]
-        arg_dict["device"] = ["cuda"]
+        arg_dict["device"] = ["cuda", "cpu"]
         arg_dict["shape"] = [(492), (691, 1), (1162, 1)]
         for arg in GenArgList(arg_dict):
             arg[0](test_case, *arg[1:])
@@ -83,7 +83,7 @@ class Glu(nn.Module):
             return hidden_state * flow.silu(gate)
 
 
-def tensor_builder(params: dict, dtype=flow.float32, is_split_mode=True):
+def tensor_builder(params: dict, dtype=flow.float32, is_split_mode=True, device="cuda"):
     # config test data
     m = params["m"]
     n = params["n"]
@@ -101,17 +101,17 @@ def tensor_builder(params: dict, dtype=flow.float32, is_split_mode=True):
         w = np.random.randn(n * 2, k) / 100  # transpose
         b = np.random.randn(n * 2) / 100
 
-    # transfer to gpu memory
-    tensor_x = flow.FloatTensor(x).to(dtype=dtype, device="cuda")
-    tensor_y_nor = flow.FloatTensor(y_nor).to(dtype=dtype, device="cuda")
-    tensor_w = flow.FloatTensor(w).to(dtype=dtype, device="cuda").requires_grad_(True)
-    tensor_b = flow.FloatTensor(b).to(dtype=dtype, device="cuda").requires_grad_(True)
+    # transfer to device memory
+    tensor_x = flow.FloatTensor(x).to(dtype=dtype, device=device)
+    tensor_y_nor = flow.FloatTensor(y_nor).to(dtype=dtype, device=device)
+    tensor_w = flow.FloatTensor(w).to(dtype=dtype, device=device).requires_grad_(True)
+    tensor_b = flow.FloatTensor(b).to(dtype=dtype, device=device).requires_grad_(True)
     if is_split_mode:
         tensor_v = (
-            flow.FloatTensor(v).to(dtype=dtype, device="cuda").requires_grad_(True)
+            flow.FloatTensor(v).to(dtype=dtype, device=device).requires_grad_(True)
         )
         tensor_c = (
-            flow.FloatTensor(c).to(dtype=dtype, device="cuda").requires_grad_(True)
+            flow.FloatTensor(c).to(dtype=dtype, device=device).requires_grad_(True)
         )
 
     if is_split_mode:
@@ -127,15 +127,18 @@ def compare_result(test_case, a, b, rtol=1e-5, atol=1e-8):
     )
 
 
-def _test_fused_glu(test_case, params: dict, dtype=flow.float32):
+def _test_fused_glu(test_case, params: dict, dtype=flow.float32, device="cuda"):
     print(f"========== Start Testing ==========")
     print(f"weight tensor: merged")
     print(f'tensor shape: m={params["m"]}, n={params["n"]}, k={params["k"]}')
     print(f'activation: {params["act"]}')
     print(f"dtype: {dtype}")
+    print(f"device: {device}")
 
     flow_module = Glu()
-    x, w, b, y_nor = tensor_builder(params=params, dtype=dtype, is_split_mode=False)
+    x, w, b, y_nor = tensor_builder(
+        params=params, dtype=dtype, is_split_mode=False, device=device
+    )
 
     # forward
     y = flow_module.forward(x=x, w=w, b=b, split_mode=False, activation=params["act"])
@@ -177,16 +180,21 @@ def _test_fused_glu(test_case, params: dict, dtype=flow.float32):
     print("\n")
 
 
-def _test_fused_glu_without_bias(test_case, params: dict, dtype=flow.float32):
+def _test_fused_glu_without_bias(
+    test_case, params: dict, dtype=flow.float32, device="cuda"
+):
     print(f"========== Start Testing ==========")
     print(f"weight tensor: merged")
     print(f"no bias")
     print(f'tensor shape: m={params["m"]}, n={params["n"]}, k={params["k"]}')
     print(f'activation: {params["act"]}')
     print(f"dtype: {dtype}")
+    print(f"device: {device}")
 
     flow_module = Glu()
-    x, w, b, y_nor = tensor_builder(params=params, dtype=dtype, is_split_mode=False)
+    x, w, b, y_nor = tensor_builder(
+        params=params, dtype=dtype, is_split_mode=False, device=device
+    )
 
     # forward
     y = flow_module.forward(x=x, w=w, split_mode=False, activation=params["act"])
@@ -223,16 +231,17 @@ def _test_fused_glu_without_bias(test_case, params: dict, dtype=flow.float32):
     print("\n")
 
 
-def _test_fused_glu_split(test_case, params: dict, dtype=flow.float32):
+def _test_fused_glu_split(test_case, params: dict, dtype=flow.float32, device="cuda"):
     print(f"========== Start Testing ==========")
     print(f"weight tensor: splited")
     print(f'tensor shape: m={params["m"]}, n={params["n"]}, k={params["k"]}')
     print(f'activation: {params["act"]}')
     print(f"dtype: {dtype}")
+    print(f"device: {device}")
 
     flow_module = Glu()
     x, w, b, v, c, y_nor = tensor_builder(
-        params=params, dtype=dtype, is_split_mode=True
+        params=params, dtype=dtype, is_split_mode=True, device=device
     )
 
     # forward
@@ -286,17 +295,20 @@ def _test_fused_glu_split(test_case, params: dict, dtype=flow.float32):
     print("\n")
 
 
-def _test_fused_glu_split_without_bias(test_case, params: dict, dtype=flow.float32):
+def _test_fused_glu_split_without_bias(
+    test_case, params: dict, dtype=flow.float32, device="cuda"
+):
     print(f"========== Start Testing ==========")
     print(f"weight tensor: splited")
     print(f"no bias")
     print(f'tensor shape: m={params["m"]}, n={params["n"]}, k={params["k"]}')
     print(f'activation: {params["act"]}')
     print(f"dtype: {dtype}")
+    print(f"device: {device}")
 
     flow_module = Glu()
     x, w, b, v, c, y_nor = tensor_builder(
-        params=params, dtype=dtype, is_split_mode=True
+        params=params, dtype=dtype, is_split_mode=True, device=device
     )
 
     # forward
@@ -412,5 +424,26 @@ class TestFusedGlu(flow.unittest.TestCase):
             arg[0](test_case, *arg[1:])
 
 
+@flow.unittest.skip_unless_1n1d()
+class TestFusedGluCpu(flow.unittest.TestCase):
+    def test_fused_glu(test_case):
+        arg_dict = OrderedDict()
+        # merged and split weights, with and without bias
+        arg_dict["test_fun"] = [
+            _test_fused_glu,
+            _test_fused_glu_split,
+            _test_fused_glu_without_bias,
+            _test_fused_glu_split_without_bias,
+        ]
+        arg_dict["params"] = [
+            {"m": 16, "k": 32, "n": 64, "act": act}
+            for act in ["none", "sigmoid", "relu", "gelu", "fast_gelu", "silu"]
+        ]
+        arg_dict["dtype"] = [flow.float32]
+        arg_dict["device"] = ["cpu"]
+        for arg in GenArgList(arg_dict):
+            arg[0](test_case, *arg[1:])
+
+
 if __name__ == "__main__":
     unittest.main()
@@ -0,0 +1,183 @@
+"""
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+"""
+import unittest
+from collections import OrderedDict
+
+import numpy as np
+import torch
+
+import oneflow as flow
+import oneflow.unittest
+from oneflow.test_utils.test_util import GenArgList
+
+# float and double lstm/gru run on the fused cpu cell kernels, with the input
+# projection of all the time steps precomputed in one matmul
+
+
+def _to_flow_state_dict(m_torch):
+    return OrderedDict(
+        (k, v.detach().numpy()) for k, v in m_torch.state_dict().items()
+    )
+
+
+def _assert_allclose(test_case, flow_tensor, torch_tensor, dtype):
+    tol = 1e-4 if dtype == np.float32 else 1e-8
+    test_case.assertTrue(
+        np.allclose(
+            flow_tensor.numpy(), torch_tensor.detach().numpy(), rtol=tol, atol=tol
+        )
+    )
+
+
+def _test_rnn_module(
+    test_case, mode, bidirectional, batch_first, num_layers, with_hx, dtype
+):
+    input_size, hidden_size, batch_size, seq_len = 5, 7, 3, 6
+    torch_dtype = torch.float32 if dtype == np.float32 else torch.float64
+    flow_dtype = flow.float32 if dtype == np.float32 else flow.float64
+    torch_cls = torch.nn.LSTM if mode == "lstm" else torch.nn.GRU
+    flow_cls = flow.nn.LSTM if mode == "lstm" else flow.nn.GRU
+    m_torch = torch_cls(
+        input_size,
+        hidden_size,
+        num_layers=num_layers,
+        batch_first=batch_first,
+        bidirectional=bidirectional,
+    ).to(torch_dtype)
+    m_flow = flow_cls(
+        input_size,
+        hidden_size,
+        num_layers=num_layers,
+        batch_first=batch_first,
+        bidirectional=bidirectional,
+    ).to(flow_dtype)
+    m_flow.load_state_dict(_to_flow_state_dict(m_torch))
+
+    x_shape = (
+        (batch_size, seq_len, input_size)
+        if batch_first
+        else (seq_len, batch_size, input_size)
+    )
+    x = np.random.randn(*x_shape).astype(dtype)
+    x_torch = torch.tensor(x, requires_grad=True)
+    x_flow = flow.tensor(x, requires_grad=True)
+    num_directions = 2 if bidirectional else 1
+    hx_shape = (num_layers * num_directions, batch_size, hidden_size)
+    hx_torch, hx_flow = [], []
+    if with_hx:
+        for _ in range(2 if mode == "lstm" else 1):
+            h = np.random.randn(*hx_shape).astype(dtype)
+            hx_torch.append(torch.tensor(h, requires_grad=True))
+            hx_flow.append(flow.tensor(h, requires_grad=True))
+
+    def run(m, x, hx):
+        if len(hx) == 0:
+            return m(x)
+        return m(x, tuple(hx) if mode == "lstm" else hx[0])
+
+    out_torch, state_torch = run(m_torch, x_torch, hx_torch)
+    out_flow, state_flow = run(m_flow, x_flow, hx_flow)
+    if mode == "gru":
+        state_torch, state_flow = (state_torch,), (state_flow,)
+    _assert_allclose(test_case, out_flow, out_torch, dtype)
+    for s_flow, s_torch in zip(state_flow, state_torch):
+        _assert_allclose(test_case, s_flow, s_torch, dtype)
+
+    # weight the outputs so that every element gets a different gradient
+    dy = np.random.randn(*out_torch.shape).astype(dtype)
+    loss_torch = (out_torch * torch.tensor(dy)).sum()
+    loss_flow = (out_flow * flow.tensor(dy)).sum()
+    for s_flow, s_torch in zip(state_flow, state_torch):
+        loss_torch = loss_torch + s_torch.sum()
+        loss_flow = loss_flow + s_flow.sum()
+    loss_torch.backward()
+    loss_flow.backward()
+    _assert_allclose(test_case, x_flow.grad, x_torch.grad, dtype)
+    for h_flow, h_torch in zip(hx_flow, hx_torch):
+        _assert_allclose(test_case, h_flow.grad, h_torch.grad, dtype)
+    params_torch = dict(m_torch.named_parameters())
+    for name, param_flow in m_flow.named_parameters():
+        _assert_allclose(test_case, param_flow.grad, params_torch[name].grad, dtype)
+
+
+def _test_rnn_cell_module(test_case, mode, with_hx, dtype):
+    input_size, hidden_size, batch_size = 5, 7, 4
+    torch_dtype = torch.float32 if dtype == np.float32 else torch.float64
+    flow_dtype = flow.float32 if dtype == np.float32 else flow.float64
+    torch_cls = torch.nn.LSTMCell if mode == "lstm" else torch.nn.GRUCell
+    flow_cls = flow.nn.LSTMCell if mode == "lstm" else flow.nn.GRUCell
+    m_torch = torch_cls(input_size, hidden_size).to(torch_dtype)
+    m_flow = flow_cls(input_size, hidden_size).to(flow_dtype)
+    m_flow.load_state_dict(_to_flow_state_dict(m_torch))
+
+    x = np.random.randn(batch_size, input_size).astype(dtype)
+    x_torch = torch.tensor(x, requires_grad=True)
+    x_flow = flow.tensor(x, requires_grad=True)
+    hx_torch, hx_flow = [], []
+    if with_hx:
+        for _ in range(2 if mode == "lstm" else 1):
+            h = np.random.randn(batch_size, hidden_size).astype(dtype)
+            hx_torch.append(torch.tensor(h, requires_grad=True))
+            hx_flow.append(flow.tensor(h, requires_grad=True))
+
+    def run(m, x, hx):
+        if len(hx) == 0:
+            out = m(x)
+        else:
+            out = m(x, tuple(hx) if mode == "lstm" else hx[0])
+        return out if mode == "lstm" else (out,)
+
+    outs_torch = run(m_torch, x_torch, hx_torch)
+    outs_flow = run(m_flow, x_flow, hx_flow)
+    loss_torch, loss_flow = 0, 0
+    for i, (y_flow, y_torch) in enumerate(zip(outs_flow, outs_torch)):
+        _assert_allclose(test_case, y_flow, y_torch, dtype)
+        loss_torch = loss_torch + (y_torch * (i + 1)).sum()
+        loss_flow = loss_flow + (y_flow * (i + 1)).sum()
+    loss_torch.backward()
+    loss_flow.backward()
+    _assert_allclose(test_case, x_flow.grad, x_torch.grad, dtype)
+    for h_flow, h_torch in zip(hx_flow, hx_torch):
+        _assert_allclose(test_case, h_flow.grad, h_torch.grad, dtype)
+    params_torch = dict(m_torch.named_parameters())
+    for name, param_flow in m_flow.named_parameters():
+        _assert_allclose(test_case, param_flow.grad, params_torch[name].grad, dtype)
+
+
+@flow.unittest.skip_unless_1n1d()
+class TestFusedRNNCellCPU(flow.unittest.TestCase):
+    def test_fused_rnn_module(test_case):
+        arg_dict = OrderedDict()
+        arg_dict["mode"] = ["lstm", "gru"]
+        arg_dict["bidirectional"] = [False, True]
+        arg_dict["batch_first"] = [False, True]
+        arg_dict["num_layers"] = [1, 3]
+        arg_dict["with_hx"] = [False, True]
+        arg_dict["dtype"] = [np.float32, np.float64]
+        for arg in GenArgList(arg_dict):
+            _test_rnn_module(test_case, *arg)
+
+    def test_fused_rnn_cell_module(test_case):
+        arg_dict = OrderedDict()
+        arg_dict["mode"] = ["lstm", "gru"]
+        arg_dict["with_hx"] = [False, True]
+        arg_dict["dtype"] = [np.float32, np.float64]
+        for arg in GenArgList(arg_dict):
+            _test_rnn_cell_module(test_case, *arg)
+
+
+if __name__ == "__main__":
+    unittest.main()
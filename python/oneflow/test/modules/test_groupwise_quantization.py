@@ -115,10 +115,10 @@ def _dequantize(num_bits, symmetric, x, scale, zero, group_dim, group_size):
     )
 
 
-def _test_dequantize(test_case, num_bits, shape, group_dim, group_size):
-
-    for dtype in [flow.float, flow.float16]:
-        x = flow.randn(shape, device="cuda", dtype=flow.float,).to(dtype)
+def _test_dequantize(test_case, num_bits, shape, group_dim, group_size, device="cuda"):
+    dtypes = [flow.float] if device == "cpu" else [flow.float, flow.float16]
+    for dtype in dtypes:
+        x = flow.randn(shape, device=device, dtype=flow.float,).to(dtype)
         for symmetric in [True, False]:
             for quant_type in [flow.int8, flow.uint8] if symmetric else [flow.uint8]:
                 quantized, scale, zero = _quantize(
@@ -135,11 +135,14 @@ def _test_dequantize(test_case, num_bits, shape, group_dim, group_size):
                 )
 
 
-def _test_fused_linear(test_case, num_bits, m, k, n, group_dim, group_size):
-    for dtype in [flow.float16, flow.float]:
-        x = flow.randn((m, k), device="cuda", dtype=flow.float,).to(dtype) / 10
-        w = flow.randn((n, k), device="cuda", dtype=flow.float,).to(dtype) / 10
-        b = flow.randn((n), device="cuda", dtype=flow.float,).to(dtype) / 10
+def _test_fused_linear(
+    test_case, num_bits, m, k, n, group_dim, group_size, device="cuda"
+):
+    dtypes = [flow.float] if device == "cpu" else [flow.float16, flow.float]
+    for dtype in dtypes:
+        x = flow.randn((m, k), device=device, dtype=flow.float,).to(dtype) / 10
+        w = flow.randn((n, k), device=device, dtype=flow.float,).to(dtype) / 10
+        b = flow.randn((n), device=device, dtype=flow.float,).to(dtype) / 10
 
         for symmetric in [True, False]:
             for quant_type in [flow.int8, flow.uint8] if symmetric else [flow.uint8]:
@@ -220,5 +223,24 @@ class TestGroupWiseQuantization(flow.unittest.TestCase):
         _test_fused_linear(test_case, 4, 1, 256, 512, 1, 64)
 
 
+@flow.unittest.skip_unless_1n1d()
+class TestGroupWiseQuantizationCPU(flow.unittest.TestCase):
+    def test_dequantize(test_case):
+        for num_bits in [8, 4]:
+            _test_dequantize(test_case, num_bits, (128, 256), 0, 128 // 4, "cpu")
+            _test_dequantize(test_case, num_bits, (128, 256), 1, 256 // 4, "cpu")
+            _test_dequantize(test_case, num_bits, (16, 32, 64), 0, 16, "cpu")
+            _test_dequantize(test_case, num_bits, (16, 32, 64), 1, 32 // 4, "cpu")
+            _test_dequantize(test_case, num_bits, (16, 32, 64), 2, 64, "cpu")
+
+    def test_fused_linear(test_case):
+        _test_fused_linear(test_case, 8, 1, 64, 128, 0, 128, "cpu")
+        _test_fused_linear(test_case, 8, 16, 64, 128, 1, 64, "cpu")
+        _test_fused_linear(test_case, 8, 1, 63, 127, 1, 63, "cpu")
+        _test_fused_linear(test_case, 8, 3, 1024, 512, 1, 128, "cpu")
+        _test_fused_linear(test_case, 4, 1, 256, 512, 0, 64, "cpu")
+        _test_fused_linear(test_case, 4, 7, 256, 512, 1, 64, "cpu")
+
+
 if __name__ == "__main__":
     unittest.main()
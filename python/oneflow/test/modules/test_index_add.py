@@ -59,6 +59,22 @@ def _test_index_add(test_case, device):
     )
 
 
+def _test_index_add_large_with_collisions(test_case, shape, index_size, dim):
+    # half of the rows go to index 0, the others are spread over all the indices
+    index = np.random.randint(0, shape[dim], size=(index_size,))
+    index[np.random.rand(index_size) < 0.5] = 0
+    src_shape = list(shape)
+    src_shape[dim] = index_size
+    x = np.random.randn(*shape)
+    src = np.random.randn(*src_shape)
+    y = flow.index_add(
+        flow.tensor(x), dim, flow.tensor(index), flow.tensor(src), alpha=0.5
+    )
+    np_y = x.copy()
+    np.add.at(np_y, (slice(None),) * dim + (index,), 0.5 * src)
+    test_case.assertTrue(np.allclose(y.numpy(), np_y, 1e-08, 1e-08))
+
+
 @flow.unittest.skip_unless_1n1d()
 class TestIndexAdd(flow.unittest.TestCase):
     def test_index_add(test_case):
@@ -68,6 +84,18 @@ class TestIndexAdd(flow.unittest.TestCase):
         for arg in GenArgList(arg_dict):
             arg[0](test_case, *arg[1:])
 
+    def test_index_add_large_with_collisions(test_case):
+        # few wide rows, dense and sparse scatters of narrow rows on cpu
+        arg_dict = OrderedDict()
+        arg_dict["shape_index_size_dim"] = [
+            ((8, 1024), 300, 0),
+            ((100, 4), 200000, 0),
+            ((50000, 4), 200000, 0),
+            ((3, 20000, 2), 100000, 1),
+        ]
+        for arg in GenArgList(arg_dict):
+            _test_index_add_large_with_collisions(test_case, *arg[0])
+
     @profile(torch.index_add)
     def profile_index_add(test_case):
         torch.index_add(
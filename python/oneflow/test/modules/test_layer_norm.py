@@ -211,5 +211,33 @@ class TestLayerNorm(flow.unittest.TestCase):
         )
 
 
+@flow.unittest.skip_unless_1n1d()
+class TestLayerNormCPU(flow.unittest.TestCase):
+    def test_cpu(test_case):
+        for dtype in [flow.float32, flow.double]:
+            _test_layer_norm(
+                test_case,
+                shape=[4, 16],
+                normalized_shape=[16],
+                affine=False,
+                dtype=dtype,
+                device="cpu",
+            )
+            _test_layer_norm(
+                test_case,
+                shape=[16, 511],
+                normalized_shape=[511],
+                dtype=dtype,
+                device="cpu",
+            )
+            _test_layer_norm(
+                test_case,
+                shape=[2, 3, 64],
+                normalized_shape=[3, 64],
+                dtype=dtype,
+                device="cpu",
+            )
+
+
 if __name__ == "__main__":
     unittest.main()
@@ -86,11 +86,30 @@ def _test_nms(test_case, device):
     test_case.assertTrue(np.allclose(keep.numpy(), keep_np))
 
 
+def _test_batched_nms(test_case, device):
+    iou = 0.5
+    batch_boxes = []
+    for _ in range(3):
+        boxes, scores = create_tensors_with_iou(200, iou)
+        batch_boxes.append(boxes[np.argsort(-scores)])
+    boxes = flow.tensor(
+        np.stack(batch_boxes), dtype=flow.float32, device=flow.device(device)
+    )
+    for keep_n in [-1, 10]:
+        keep = flow._C.nms(boxes, iou, keep_n)
+        test_case.assertEqual(keep.shape, flow.Size([3, 200]))
+        for i in range(3):
+            keep_i = flow._C.nms(boxes[i], iou, keep_n)
+            test_case.assertTrue(np.array_equal(keep[i].numpy(), keep_i.numpy()))
+        if keep_n > 0:
+            test_case.assertTrue((keep.numpy().sum(axis=1) <= keep_n).all())
+
+
 @flow.unittest.skip_unless_1n1d()
 class TestNMS(flow.unittest.TestCase):
     def test_nms(test_case):
         arg_dict = OrderedDict()
-        arg_dict["test_fun"] = [_test_nms]
+        arg_dict["test_fun"] = [_test_nms, _test_batched_nms]
         arg_dict["device"] = ["cuda", "cpu"]
         for arg in GenArgList(arg_dict):
             arg[0](test_case, *arg[1:])
@@ -31,7 +31,7 @@ from oneflow.nn.parameter import Parameter
 
 
 def compare_with_numpy_adagrad(
-    test_case, weight_decay, lr_decay, scale, learning_rate, train_iters,
+    test_case, weight_decay, lr_decay, scale, learning_rate, train_iters, device,
 ):
 
     num_rows = 500
@@ -92,14 +92,14 @@ def compare_with_numpy_adagrad(
 
     def adagrad_by_oneflow():
         unique_embeddings_tensor = flow.tensor(init_value, requires_grad=False).to(
-            "cuda"
+            device
         )
         lr_tensor = flow.tensor(
             np.array(learning_rate).reshape(1,).astype(np.float32)
-        ).to("cuda")
+        ).to(device)
         down_scale_by_tensor = flow.tensor(
             np.array(down_scale_by).reshape(1,).astype(np.float32)
-        ).to("cuda")
+        ).to(device)
 
         def train_one_iter(ids, unique_embeddings, embedding_grad, skip_if, train_step):
             return graph(
@@ -116,13 +116,13 @@ def compare_with_numpy_adagrad(
             np_ids = np.zeros(num_rows)
             np_ids[0 : num_valid_seq[i]] = np.arange(num_valid_seq[i])
             # add ids of num_valid unique to use id_shuffle out_put num_unique as grad input
-            ids = flow.tensor(np_ids.astype(np.int32)).to("cuda")
-            grad_tensor = flow.tensor(random_grad_seq[i]).to("cuda")
+            ids = flow.tensor(np_ids.astype(np.int32)).to(device)
+            grad_tensor = flow.tensor(random_grad_seq[i]).to(device)
             skip_if_tensor = flow.tensor(
                 np.array(skip_if_seq[i]).reshape(1,).astype(np.int64)
-            ).to("cuda")
+            ).to(device)
             step_tensor = flow.tensor(np.array(i).reshape(1,).astype(np.int64)).to(
-                "cuda"
+                device
             )
             updated_tensor = train_one_iter(
                 ids, unique_embeddings_tensor, grad_tensor, skip_if_tensor, step_tensor,
@@ -181,6 +181,21 @@ class TestOptimizers(flow.unittest.TestCase):
         arg_dict["scale"] = [1, 0.1]
         arg_dict["learning_rate"] = [0.3, 1.5]
         arg_dict["train_iters"] = [10]
+        arg_dict["device"] = ["cuda"]
+        for arg in GenArgDict(arg_dict):
+            compare_with_numpy_adagrad(test_case, **arg)
+
+
+@flow.unittest.skip_unless_1n1d()
+class TestCpuOptimizers(flow.unittest.TestCase):
+    def test_one_embedding_adagrad(test_case):
+        arg_dict = OrderedDict()
+        arg_dict["weight_decay"] = [0, 0.1]
+        arg_dict["lr_decay"] = [0, 0.1]
+        arg_dict["scale"] = [1, 0.1]
+        arg_dict["learning_rate"] = [0.3, 1.5]
+        arg_dict["train_iters"] = [10]
+        arg_dict["device"] = ["cpu"]
         for arg in GenArgDict(arg_dict):
             compare_with_numpy_adagrad(test_case, **arg)
 
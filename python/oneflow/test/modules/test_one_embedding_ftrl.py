@@ -40,6 +40,7 @@ def compare_with_numpy_ftrl(
     learning_rate,
     train_iters,
     use_optional_tensor,
+    device,
 ):
     num_rows = 500
     embedding_size = 128
@@ -107,15 +108,15 @@ def compare_with_numpy_ftrl(
 
     def ftrl_by_oneflow():
         unique_embeddings_tensor = flow.tensor(init_value, requires_grad=False).to(
-            "cuda"
+            device
         )
         if use_optional_tensor:
             lr_tensor = flow.tensor(
                 np.array(learning_rate).reshape(1,).astype(np.float32)
-            ).to("cuda")
+            ).to(device)
             down_scale_by_tensor = flow.tensor(
                 np.array(down_scale_by).reshape(1,).astype(np.float32)
-            ).to("cuda")
+            ).to(device)
         else:
             lr_tensor = None
             down_scale_by_tensor = None
@@ -134,12 +135,12 @@ def compare_with_numpy_ftrl(
             np_ids = np.zeros(num_rows)
             np_ids[0 : num_valid_seq[i]] = np.arange(num_valid_seq[i])
             # add ids of num_valid unique to use id_shuffle out_put num_unique as grad input
-            ids = flow.tensor(np_ids.astype(np.int32)).to("cuda")
-            grad_tensor = flow.tensor(random_grad_seq[i]).to("cuda")
+            ids = flow.tensor(np_ids.astype(np.int32)).to(device)
+            grad_tensor = flow.tensor(random_grad_seq[i]).to(device)
             if use_optional_tensor:
                 skip_if_tensor = flow.tensor(
                     np.array(skip_if_seq[i]).reshape(1,).astype(np.int64)
-                ).to("cuda")
+                ).to(device)
             else:
                 skip_if_tensor = None
 
@@ -224,7 +225,26 @@ class TestOptimizers(flow.unittest.TestCase):
         arg_dict["learning_rate"] = [0.3, 1.5]
         arg_dict["train_iters"] = [10]
         arg_dict["use_optional_tensor"] = [True, False]
+        arg_dict["device"] = ["cuda"]
+        for arg in GenArgDict(arg_dict):
+            compare_with_numpy_ftrl(test_case, **arg)
 
+
+@flow.unittest.skip_unless_1n1d()
+class TestCpuOptimizers(flow.unittest.TestCase):
+    def test_one_embedding_ftrl(test_case):
+        arg_dict = OrderedDict()
+        # the kernels only support weight_decay = 0.0
+        arg_dict["weight_decay"] = [0.0]
+        arg_dict["lr_power"] = [-0.2, -0.05]
+        arg_dict["lambda1"] = [0.1]
+        arg_dict["lambda2"] = [0.00]
+        arg_dict["beta"] = [1.0]
+        arg_dict["scale"] = [1, 0.1]
+        arg_dict["learning_rate"] = [0.3, 1.5]
+        arg_dict["train_iters"] = [10]
+        arg_dict["use_optional_tensor"] = [True, False]
+        arg_dict["device"] = ["cpu"]
         for arg in GenArgDict(arg_dict):
             compare_with_numpy_ftrl(test_case, **arg)
 
@@ -189,5 +189,33 @@ class TestRMSNorm(flow.unittest.TestCase):
         )
 
 
+@flow.unittest.skip_unless_1n1d()
+class TestRMSNormCPU(flow.unittest.TestCase):
+    def test_cpu(test_case):
+        for dtype in [flow.float32, flow.double]:
+            _test_rmsnorm(
+                test_case,
+                shape=[4, 16],
+                normalized_shape=[16],
+                affine=False,
+                dtype=dtype,
+                device="cpu",
+            )
+            _test_rmsnorm(
+                test_case,
+                shape=[16, 511],
+                normalized_shape=[511],
+                dtype=dtype,
+                device="cpu",
+            )
+            _test_rmsnorm(
+                test_case,
+                shape=[2, 3, 64],
+                normalized_shape=[3, 64],
+                dtype=dtype,
+                device="cpu",
+            )
+
+
 if __name__ == "__main__":
     unittest.main()
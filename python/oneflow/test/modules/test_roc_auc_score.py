@@ -13,6 +13,7 @@ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
 See the License for the specific language governing permissions and
 limitations under the License.
 """
+import os
 import unittest
 from collections import OrderedDict
 
@@ -47,11 +48,79 @@ def _compare_roc_auc_score(test_case, label_dtype, pred_dtype):
     test_case.assertTrue(np.allclose(of_score.numpy()[0], score))
 
 
+def _compare_roc_auc_histogram(test_case, label_dtype, pred_dtype):
+    n_examples = 16384
+    num_buckets = 1000
+    label = np.random.randint(0, 2, n_examples)
+    # bucket centers, so that the score is the one of the exact mode
+    pred = (np.random.randint(0, num_buckets, n_examples) + 0.5) / num_buckets
+    score = roc_auc_score(label, pred)
+
+    label = flow.tensor(label, dtype=label_dtype)
+    pred = flow.tensor(pred, dtype=pred_dtype)
+    histogram = flow.roc_auc_histogram(label, pred, num_buckets=num_buckets)
+    test_case.assertEqual(histogram.shape, flow.Size([2, num_buckets]))
+    test_case.assertEqual(histogram.sum().item(), n_examples)
+    # histograms of the shards add up to the histogram of the whole batch
+    half = n_examples // 2
+    merged = flow.roc_auc_histogram(
+        label[:half], pred[:half], num_buckets=num_buckets
+    ) + flow.roc_auc_histogram(label[half:], pred[half:], num_buckets=num_buckets)
+    test_case.assertTrue(np.array_equal(merged.numpy(), histogram.numpy()))
+    of_score = flow.roc_auc_score_from_histogram(merged)
+    test_case.assertTrue(np.allclose(of_score.numpy()[0], score))
+
+
+class _CpuNumThreads:
+    def __init__(self, num_threads):
+        self.num_threads = num_threads
+
+    def __enter__(self):
+        flow.set_num_threads(self.num_threads)
+
+    def __exit__(self, *args):
+        # the default of the cpu device
+        flow.set_num_threads(
+            int(os.getenv("OMP_NUM_THREADS", max(os.cpu_count() - 2, 1)))
+        )
+
+
+def _compare_parallel_roc_auc_score(test_case, label_dtype, pred_dtype):
+    # above the grains of the multi-threaded histogram and merge sort of the cpu kernels
+    n_examples = 262144
+    num_buckets = 1000
+    label = np.random.randint(0, 2, n_examples)
+    pred = (np.random.randint(0, num_buckets, n_examples) + 0.5) / num_buckets
+    score = roc_auc_score(label, pred)
+    buckets = np.floor(pred * num_buckets).astype(np.int64) + label * num_buckets
+    np_histogram = np.bincount(buckets, minlength=2 * num_buckets).reshape(
+        2, num_buckets
+    )
+
+    label = flow.tensor(label, dtype=label_dtype)
+    pred = flow.tensor(pred, dtype=pred_dtype)
+    results = []
+    for num_threads in [1, max(min(4, os.cpu_count() - 1), 1)]:
+        with _CpuNumThreads(num_threads):
+            histogram = flow.roc_auc_histogram(label, pred, num_buckets=num_buckets)
+            of_score = flow.roc_auc_score(label, pred)
+            results.append((histogram.numpy(), of_score.numpy()[0]))
+    (serial_histogram, serial_score), (parallel_histogram, parallel_score) = results
+    test_case.assertTrue(np.array_equal(serial_histogram, np_histogram))
+    test_case.assertTrue(np.array_equal(parallel_histogram, serial_histogram))
+    test_case.assertTrue(np.allclose(parallel_score, serial_score))
+    test_case.assertTrue(np.allclose(serial_score, score))
+
+
 @flow.unittest.skip_unless_1n1d()
 class TestNMS(flow.unittest.TestCase):
     def test_roc_auc_score(test_case):
         arg_dict = OrderedDict()
-        arg_dict["test_fun"] = [_test_roc_auc_score, _compare_roc_auc_score]
+        arg_dict["test_fun"] = [
+            _test_roc_auc_score,
+            _compare_roc_auc_score,
+            _compare_roc_auc_histogram,
+        ]
         arg_dict["label_dtype"] = [
             flow.double,
             flow.int32,
@@ -64,6 +133,14 @@ class TestNMS(flow.unittest.TestCase):
         for arg in GenArgList(arg_dict):
             arg[0](test_case, *arg[1:])
 
+    def test_parallel_roc_auc_score(test_case):
+        arg_dict = OrderedDict()
+        arg_dict["test_fun"] = [_compare_parallel_roc_auc_score]
+        arg_dict["label_dtype"] = [flow.int32, flow.float]
+        arg_dict["pred_dtype"] = [flow.float]
+        for arg in GenArgList(arg_dict):
+            arg[0](test_case, *arg[1:])
+
 
 if __name__ == "__main__":
     unittest.main()
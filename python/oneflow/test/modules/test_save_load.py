@@ -15,6 +15,8 @@ limitations under the License.
 """
 
 import os
+import subprocess
+import sys
 import warnings
 import tempfile
 import unittest
@@ -93,6 +95,101 @@ class TestSaveLoad(flow.unittest.TestCase):
         m2.load_state_dict(loaded_state_dict)
         test_case.assertTrue(np.array_equal(m1.param.numpy(), m2.param.numpy()))
 
+    @flow.unittest.skip_unless_1n1d()
+    def test_save_dir_load_with_mmap(test_case):
+        m1 = CustomModuleForSaveLoad()
+        with tempfile.TemporaryDirectory() as save_dir:
+            flow.save(m1.state_dict(), save_dir, save_as_external_data=True)
+            os.environ["ONEFLOW_LOAD_WITH_MMAP"] = "1"
+            try:
+                loaded_state_dict = flow.load(save_dir)
+            finally:
+                del os.environ["ONEFLOW_LOAD_WITH_MMAP"]
+            test_case.assertTrue(
+                np.array_equal(m1.param.numpy(), loaded_state_dict["param"].numpy())
+            )
+            # the mapping is copy-on-write, so the file is not modified
+            loaded_state_dict["param"].add_(1)
+            reloaded_state_dict = flow.load(save_dir)
+        test_case.assertTrue(
+            np.array_equal(m1.param.numpy(), reloaded_state_dict["param"].numpy())
+        )
+        test_case.assertTrue(
+            np.array_equal(m1.param.numpy() + 1, loaded_state_dict["param"].numpy())
+        )
+
+    @flow.unittest.skip_unless_1n1d()
+    def test_async_save(test_case):
+        for save_as_external_data in [True, False]:
+            m1 = CustomModuleForSaveLoad()
+            expected = m1.param.numpy().copy()
+            with tempfile.TemporaryDirectory() as tmp_dir:
+                save_path = os.path.join(tmp_dir, "checkpoint")
+                for _ in range(2):
+                    # the second save replaces the first one
+                    handle = flow.save(
+                        m1.state_dict(),
+                        save_path,
+                        save_as_external_data=save_as_external_data,
+                        async_save=True,
+                    )
+                    # the tensors could be modified once flow.save returns
+                    with flow.no_grad():
+                        m1.param.add_(1)
+                    handle.wait()
+                    test_case.assertTrue(handle.done())
+                    stats = handle.stats()
+                    if save_as_external_data:
+                        test_case.assertEqual(stats["written_files"], 1)
+                        test_case.assertEqual(stats["written_bytes"], expected.nbytes)
+                    test_case.assertIsNotNone(stats["total_seconds"])
+                    m2 = CustomModuleForSaveLoad()
+                    m2.load_state_dict(flow.load(save_path))
+                    test_case.assertTrue(np.array_equal(expected, m2.param.numpy()))
+                    expected += 1
+                test_case.assertEqual(os.listdir(tmp_dir), ["checkpoint"])
+
+    @flow.unittest.skip_unless_1n1d()
+    def test_async_save_exit_before_commit(test_case):
+        # the process exits right after flow.save returns, before the files are
+        # written
+        script = "\n".join(
+            [
+                "import sys",
+                "import oneflow as flow",
+                "state_dict = {'x': flow.arange(1 << 24, dtype=flow.float32)}",
+                "flow.save(state_dict, sys.argv[1], save_as_external_data=True,",
+                "          async_save=True)",
+            ]
+        )
+        with tempfile.TemporaryDirectory() as tmp_dir:
+            save_path = os.path.join(tmp_dir, "checkpoint")
+            p = subprocess.run([sys.executable, "-c", script, save_path])
+            test_case.assertEqual(p.returncode, 0)
+            test_case.assertEqual(os.listdir(tmp_dir), ["checkpoint"])
+            x = flow.load(save_path)["x"]
+            test_case.assertTrue(
+                np.array_equal(x.numpy(), np.arange(1 << 24, dtype=np.float32))
+            )
+
+    @flow.unittest.skip_unless_1n1d()
+    def test_async_save_recover_interrupted_commit(test_case):
+        m1 = CustomModuleForSaveLoad()
+        # glob special characters in the name are matched literally
+        for name in ["checkpoint", "checkpoint[0]*?"]:
+            with tempfile.TemporaryDirectory() as tmp_dir:
+                save_path = os.path.join(tmp_dir, name)
+                flow.save(m1.state_dict(), save_path, save_as_external_data=True)
+                # simulate a crash between renaming the old checkpoint away and
+                # renaming the new one into place
+                os.rename(save_path, os.path.join(tmp_dir, f".{name}.old-0"))
+                m2 = CustomModuleForSaveLoad()
+                m2.load_state_dict(flow.load(save_path))
+                test_case.assertTrue(
+                    np.array_equal(m1.param.numpy(), m2.param.numpy())
+                )
+                test_case.assertEqual(os.listdir(tmp_dir), [name])
+
     @flow.unittest.skip_unless_1n1d()
     def test_save_dir_fault_tolerance(test_case):
         m1 = CustomModuleForSaveLoad()
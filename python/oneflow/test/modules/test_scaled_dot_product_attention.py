@@ -24,7 +24,7 @@ import oneflow as flow
 
 
 def _scaled_dot_product_attention(
-    query, key, value,
+    query, key, value, attn_bias=None,
 ):
     # input dims will equal 3 or 4.
     if key.ndim == 4:
@@ -32,6 +32,8 @@ def _scaled_dot_product_attention(
     elif key.ndim == 3:
         key = key.permute(0, 2, 1)
     scores = flow.matmul(query, key) / math.sqrt(query.shape[-1])
+    if attn_bias is not None:
+        scores = scores + attn_bias
     attn = flow.softmax(scores, dim=-1)
     out = flow.matmul(attn, value)
     return out
@@ -128,5 +130,105 @@ class TestScaledDotProductAttention(flow.unittest.TestCase):
                         arg[0](test_case, *arg[1:])
 
 
+def _test_scaled_dot_product_attention_cpu(
+    test_case,
+    batch_size,
+    num_head_pair,
+    seq_len_pair,
+    head_size,
+    is_causal,
+    mask_type,
+):
+    num_heads, num_heads_k = num_head_pair
+    seq_len_q, seq_len_kv = seq_len_pair
+    if is_causal and seq_len_q > seq_len_kv:
+        # the leading rows attend to nothing and the reference gives nan
+        return
+    query_raw = np.random.uniform(
+        low=-1, high=1, size=(batch_size, num_heads, seq_len_q, head_size)
+    )
+    key_raw = np.random.uniform(
+        low=-1, high=1, size=(batch_size, num_heads_k, seq_len_kv, head_size)
+    )
+    value_raw = np.random.uniform(
+        low=-1, high=1, size=(batch_size, num_heads_k, seq_len_kv, head_size)
+    )
+    query_fused = flow.tensor(query_raw, dtype=flow.float32, requires_grad=True)
+    query_ref = flow.tensor(query_raw, dtype=flow.float32, requires_grad=True)
+    key_fused = flow.tensor(key_raw, dtype=flow.float32, requires_grad=True)
+    key_ref = flow.tensor(key_raw, dtype=flow.float32, requires_grad=True)
+    value_fused = flow.tensor(value_raw, dtype=flow.float32, requires_grad=True)
+    value_ref = flow.tensor(value_raw, dtype=flow.float32, requires_grad=True)
+
+    attn_mask = None
+    bias_raw = np.zeros((seq_len_q, seq_len_kv))
+    if mask_type == "bool":
+        mask_raw = np.random.uniform(size=(seq_len_q, seq_len_kv)) > 0.3
+        mask_raw[:, 0] = True
+        attn_mask = flow.tensor(mask_raw, dtype=flow.bool)
+        bias_raw = np.where(mask_raw, 0, -np.inf)
+    elif mask_type == "float":
+        mask_raw = np.random.uniform(
+            low=-1, high=1, size=(batch_size, 1, seq_len_q, seq_len_kv)
+        )
+        attn_mask = flow.tensor(mask_raw, dtype=flow.float32)
+        bias_raw = mask_raw
+    if is_causal:
+        # aligned to the bottom right corner like the cuda kernel
+        causal = np.tril(np.ones((seq_len_q, seq_len_kv)), k=seq_len_kv - seq_len_q)
+        bias_raw = bias_raw + np.where(causal > 0, 0, -np.inf)
+
+    fused_out = flow._C.scaled_dot_product_attention(
+        query=query_fused,
+        key=key_fused,
+        value=value_fused,
+        attn_mask=attn_mask,
+        is_causal=is_causal,
+    )
+    stride = num_heads // num_heads_k
+    key_expanded = flow.cat(
+        [key_ref[:, i // stride : i // stride + 1] for i in range(num_heads)], dim=1
+    )
+    value_expanded = flow.cat(
+        [value_ref[:, i // stride : i // stride + 1] for i in range(num_heads)], dim=1
+    )
+    ref_out = _scaled_dot_product_attention(
+        query_ref,
+        key_expanded,
+        value_expanded,
+        flow.tensor(bias_raw, dtype=flow.float32),
+    )
+
+    grad_out = flow.tensor(
+        np.random.uniform(low=-1, high=1, size=ref_out.shape), dtype=flow.float32
+    )
+    (ref_out * grad_out).sum().backward()
+    (fused_out * grad_out).sum().backward()
+    for fused, ref in [
+        (fused_out, ref_out),
+        (query_fused.grad, query_ref.grad),
+        (key_fused.grad, key_ref.grad),
+        (value_fused.grad, value_ref.grad),
+    ]:
+        test_case.assertTrue(
+            np.allclose(fused.numpy(), ref.numpy(), atol=1e-4, rtol=1e-4)
+        )
+
+
+@flow.unittest.skip_unless_1n1d()
+class TestScaledDotProductAttentionCPU(flow.unittest.TestCase):
+    def test_scaled_dot_product_attention_cpu(test_case):
+        args_dict = OrderedDict()
+        args_dict["test_fun"] = [_test_scaled_dot_product_attention_cpu]
+        args_dict["batchsize"] = [2]
+        args_dict["num_head_pair"] = [[4, 4], [4, 2]]
+        args_dict["seqlen_pair"] = [[100, 100], [33, 200], [200, 77]]
+        args_dict["head_size"] = [8, 40]
+        args_dict["is_causal"] = [False, True]
+        args_dict["mask_type"] = [None, "bool", "float"]
+        for arg in GenArgList(args_dict):
+            arg[0](test_case, *arg[1:])
+
+
 if __name__ == "__main__":
     unittest.main()
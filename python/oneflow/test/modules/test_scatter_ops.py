@@ -14,12 +14,14 @@ See the License for the specific language governing permissions and
 limitations under the License.
 """
 import unittest
+from collections import OrderedDict
 
 import oneflow as flow
 import oneflow.unittest
 import numpy as np
 
 from oneflow.test_utils.automated_test_util import *
+from oneflow.test_utils.test_util import GenArgList
 
 
 def _get_indexes(device):
@@ -69,6 +71,20 @@ def _test_scatter_reduce(test_case, dim: int):
     return y
 
 
+def _test_scatter_add_large_with_collisions(test_case, shape, index_shape, dim):
+    # half of the elements go to index 0 of their line
+    index = np.random.randint(0, shape[dim], size=index_shape)
+    index[np.random.rand(*index_shape) < 0.5] = 0
+    x = np.random.randn(*shape)
+    src = np.random.randn(*index_shape)
+    y = flow.scatter_add(flow.tensor(x), dim, flow.tensor(index), flow.tensor(src))
+    coords = list(np.indices(index_shape))
+    coords[dim] = index
+    np_y = x.copy()
+    np.add.at(np_y, tuple(coords), src)
+    test_case.assertTrue(np.allclose(y.numpy(), np_y, 1e-08, 1e-08))
+
+
 @flow.unittest.skip_unless_1n1d()
 class TestScatterOpsModule(flow.unittest.TestCase):
     @autotest(n=10)
@@ -79,6 +95,16 @@ class TestScatterOpsModule(flow.unittest.TestCase):
     def test_scatter_add_with_random_data(test_case):
         return _test_scatter_add(test_case, oneof(0, 1))
 
+    def test_scatter_add_large_with_collisions(test_case):
+        arg_dict = OrderedDict()
+        arg_dict["shape_index_shape_dim"] = [
+            ((64, 3000), (1000, 2000), 0),
+            ((3000, 64), (2000, 1000), 1),
+            ((4, 100000), (4, 200000), 1),
+        ]
+        for arg in GenArgList(arg_dict):
+            _test_scatter_add_large_with_collisions(test_case, *arg[0])
+
     @autotest(
         n=5, auto_backward=False
     )  # peihong: pytorch dose not support backward when reduce is add or multiply
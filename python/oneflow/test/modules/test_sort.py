@@ -64,6 +64,19 @@ def _test_tensor_sort(test_case, data_shape, axis, descending, data_type, device
     )
 
 
+def _test_sort_large_with_ties(test_case, data_shape, descending, data_type):
+    # few distinct values, so the ties must be ordered by index
+    np_input = np.random.randint(-50, 50, size=data_shape)
+    input = flow.tensor(np_input, dtype=type_name_to_flow_type[data_type])
+    (of_values, of_indices) = flow.sort(input, dim=-1, descending=descending)
+    np_indices = np.argsort(
+        -np_input if descending else np_input, axis=-1, kind="stable"
+    )
+    np_values = np.take_along_axis(np_input, np_indices, axis=-1)
+    test_case.assertTrue(np.array_equal(of_values.numpy(), np_values))
+    test_case.assertTrue(np.array_equal(of_indices.numpy(), np_indices))
+
+
 @flow.unittest.skip_unless_1n1d()
 class TestSort(flow.unittest.TestCase):
     def test_sort(test_case):
@@ -77,6 +90,15 @@ class TestSort(flow.unittest.TestCase):
         for arg in GenArgList(arg_dict):
             arg[0](test_case, *arg[1:])
 
+    def test_sort_large_instance_with_ties(test_case):
+        # instances of at least 131072 elements are sorted by a parallel merge sort
+        arg_dict = OrderedDict()
+        arg_dict["data_shape"] = [(262144,), (2, 200003)]
+        arg_dict["descending"] = [True, False]
+        arg_dict["data_type"] = ["double", "float32", "int32"]
+        for arg in GenArgList(arg_dict):
+            _test_sort_large_with_ties(test_case, *arg)
+
     @autotest(n=5, auto_backward=False, check_graph=True)
     def test_sort_with_random_data(test_case):
         device = random_device()
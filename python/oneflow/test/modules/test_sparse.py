@@ -15,6 +15,7 @@ limitations under the License.
 """
 
 from collections import OrderedDict
+import os
 import unittest
 from oneflow.test_utils.automated_test_util import *
 from oneflow.test_utils.test_util import GenArgList
@@ -135,6 +136,91 @@ def _test_embedding_scale_by_freq(test_case, device):
     )
 
 
+def _np_embedding_bag(weight, indices, offsets, mode, per_sample_weights, padding_idx):
+    out = np.zeros((len(offsets), weight.shape[1]), dtype=weight.dtype)
+    ends = list(offsets[1:]) + [len(indices)]
+    for bag, (start, stop) in enumerate(zip(offsets, ends)):
+        rows = [
+            weight[indices[i]]
+            * (1 if per_sample_weights is None else per_sample_weights[i])
+            for i in range(start, stop)
+            if indices[i] != padding_idx
+        ]
+        if len(rows) == 0:
+            continue
+        if mode == "sum":
+            out[bag] = np.sum(rows, axis=0)
+        elif mode == "mean":
+            out[bag] = np.mean(rows, axis=0)
+        else:
+            out[bag] = np.max(rows, axis=0)
+    return out
+
+
+def _test_embedding_bag(test_case, device, mode, with_per_sample_weights):
+    weight = np.random.randn(20, 7).astype(np.float32)
+    indices = np.random.randint(0, 20, size=(37,))
+    indices[::5] = 3
+    offsets = np.array([0, 0, 4, 5, 11, 30, 30])
+    per_sample_weights = (
+        np.random.randn(37).astype(np.float32) if with_per_sample_weights else None
+    )
+    padding_idx = 3
+    flow_weight = flow.tensor(weight, device=device, requires_grad=True)
+    flow_per_sample_weights = (
+        None
+        if per_sample_weights is None
+        else flow.tensor(per_sample_weights, device=device, requires_grad=True)
+    )
+    out = flow.nn.functional.embedding_bag(
+        flow.tensor(indices, device=device),
+        flow_weight,
+        flow.tensor(offsets, device=device),
+        mode=mode,
+        per_sample_weights=flow_per_sample_weights,
+        padding_idx=padding_idx,
+    )
+    np_out = _np_embedding_bag(
+        weight, indices, offsets, mode, per_sample_weights, padding_idx
+    )
+    test_case.assertTrue(np.allclose(out.numpy(), np_out, atol=1e-5, rtol=1e-5))
+
+    # the gradient of sum(out * dy) through the reference pooling
+    dy = np.random.randn(*np_out.shape).astype(np.float32)
+    (out * flow.tensor(dy, device=device)).sum().backward()
+    np_grad = np.zeros_like(weight)
+    ends = list(offsets[1:]) + [len(indices)]
+    for bag, (start, stop) in enumerate(zip(offsets, ends)):
+        positions = [i for i in range(start, stop) if indices[i] != padding_idx]
+        for i in positions:
+            if mode == "sum":
+                scale = 1 if per_sample_weights is None else per_sample_weights[i]
+                np_grad[indices[i]] += scale * dy[bag]
+            elif mode == "mean":
+                np_grad[indices[i]] += dy[bag] / len(positions)
+        if mode == "max" and len(positions) > 0:
+            rows = np.array([indices[i] for i in positions])
+            argmax = rows[np.argmax(weight[rows], axis=0)]
+            np_grad[argmax, np.arange(weight.shape[1])] += dy[bag]
+    test_case.assertTrue(
+        np.allclose(flow_weight.grad.numpy(), np_grad, atol=1e-5, rtol=1e-5)
+    )
+    if per_sample_weights is not None:
+        np_per_sample_weights_grad = np.zeros_like(per_sample_weights)
+        for bag, (start, stop) in enumerate(zip(offsets, ends)):
+            for i in range(start, stop):
+                if indices[i] != padding_idx:
+                    np_per_sample_weights_grad[i] = np.dot(dy[bag], weight[indices[i]])
+        test_case.assertTrue(
+            np.allclose(
+                flow_per_sample_weights.grad.numpy(),
+                np_per_sample_weights_grad,
+                atol=1e-5,
+                rtol=1e-5,
+            )
+        )
+
+
 @flow.unittest.skip_unless_1n1d()
 class TestEmbedding(flow.unittest.TestCase):
     def test_padding_idx(test_case):
@@ -208,5 +294,48 @@ class TestEmbedding(flow.unittest.TestCase):
         return y
 
 
+@flow.unittest.skip_unless_1n1d()
+class TestEmbeddingBag(flow.unittest.TestCase):
+    def test_embedding_bag(test_case):
+        for mode in ["sum", "mean", "max"]:
+            _test_embedding_bag(test_case, "cpu", mode, False)
+        _test_embedding_bag(test_case, "cpu", "sum", True)
+
+    @unittest.skipIf(os.getenv("ONEFLOW_TEST_CPU_ONLY"), "only test cpu cases")
+    def test_embedding_bag_cuda(test_case):
+        # reduced by unsorted_segment_sum since the fused op only has CPU kernels
+        for mode in ["sum", "mean"]:
+            _test_embedding_bag(test_case, "cuda", mode, False)
+        _test_embedding_bag(test_case, "cuda", "sum", True)
+        with test_case.assertRaises(NotImplementedError):
+            flow.nn.functional.embedding_bag(
+                flow.tensor([[0, 1]], device="cuda"),
+                flow.randn(3, 4, device="cuda"),
+                mode="max",
+            )
+
+    def test_embedding_bag_per_sample_weights_mode(test_case):
+        for mode in ["mean", "max"]:
+            with test_case.assertRaises(ValueError):
+                flow.nn.functional.embedding_bag(
+                    flow.tensor([[0, 1]]),
+                    flow.randn(3, 4),
+                    mode=mode,
+                    per_sample_weights=flow.ones(1, 2),
+                )
+
+    @autotest(n=5, check_graph=False)
+    def test_embedding_bag_functional(test_case):
+        device = cpu_device()
+        emb_size = random(low=2) * 16
+        emb_dim = random(low=2) * 16
+        weight = random_tensor(2, emb_size, emb_dim).to(device)
+        indices = random_tensor(
+            2, random(1, 6), random(1, 6), low=0, high=emb_size, dtype=int
+        ).to(device)
+        mode = oneof("sum", "mean", "max").value()
+        return torch.nn.functional.embedding_bag(indices, weight, mode=mode)
+
+
 if __name__ == "__main__":
     unittest.main()
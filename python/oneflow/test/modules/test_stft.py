@@ -51,6 +51,45 @@ def is_cufft_available():
         return False
 
 
+def _np_stft(x, n_fft, hop_length, window):
+    num_frames = (x.shape[-1] - n_fft) // hop_length + 1
+    frames = np.stack(
+        [x[..., t * hop_length : t * hop_length + n_fft] for t in range(num_frames)],
+        axis=-2,
+    )
+    return np.swapaxes(np.fft.rfft(frames * window, axis=-1), -1, -2)
+
+
+def _test_cpu_batched_stft(test_case, shape, n_fft, hop_length):
+    # repeating a length reuses the cached pocketfft plan
+    for _ in range(3):
+        x = np.random.randn(*shape)
+        window = np.random.randn(n_fft)
+        y = flow.stft(
+            flow.tensor(x, device="cpu"),
+            n_fft=n_fft,
+            hop_length=hop_length,
+            window=flow.tensor(window, device="cpu"),
+            center=False,
+            return_complex=False,
+        ).numpy()
+        np_y = _np_stft(x, n_fft, hop_length, window)
+        test_case.assertTrue(np.allclose(y[..., 0], np_y.real, 1e-7, 1e-7))
+        test_case.assertTrue(np.allclose(y[..., 1], np_y.imag, 1e-7, 1e-7))
+
+
+@flow.unittest.skip_unless_1n1d()
+class TestCpuBatchedStft(flow.unittest.TestCase):
+    def test_cpu_batched_stft(test_case):
+        # enough frames to split the batched transform over the threads
+        arg_dict = OrderedDict()
+        arg_dict["shape"] = [(8192,), (64, 8192)]
+        arg_dict["n_fft"] = [256]
+        arg_dict["hop_length"] = [64, 256]
+        for arg in GenArgList(arg_dict):
+            _test_cpu_batched_stft(test_case, *arg)
+
+
 class TestStft(flow.unittest.TestCase):
     @autotest(
         n=20, check_graph=False, check_grad_use_random_data=False, auto_backward=False,
@@ -41,6 +41,25 @@ def _test_top_k(test_case, shape, k, dim, device):
     )
 
 
+def _test_top_k_large_with_ties(test_case, shape, k, is_sorted):
+    # few distinct values, so the ties must be ordered by index
+    x_np = np.random.randint(-50, 50, size=shape).astype(np.float32)
+    of_out = flow.topk(flow.tensor(x_np), k=k, dim=-1, sorted=is_sorted)
+    np_indices = np.argsort(-x_np, axis=-1, kind="stable")[..., :k]
+    np_values = np.take_along_axis(x_np, np_indices, axis=-1)
+    of_values = of_out.values.numpy()
+    of_indices = of_out.indices.numpy()
+    if not is_sorted:
+        order = np.argsort(of_indices, axis=-1)
+        of_values = np.take_along_axis(of_values, order, axis=-1)
+        of_indices = np.take_along_axis(of_indices, order, axis=-1)
+        order = np.argsort(np_indices, axis=-1)
+        np_values = np.take_along_axis(np_values, order, axis=-1)
+        np_indices = np.take_along_axis(np_indices, order, axis=-1)
+    test_case.assertTrue(np.array_equal(of_values, np_values))
+    test_case.assertTrue(np.array_equal(of_indices, np_indices))
+
+
 @flow.unittest.skip_unless_1n1d()
 class TestTopK(flow.unittest.TestCase):
     def test_in_top_k(test_case):
@@ -52,6 +71,16 @@ class TestTopK(flow.unittest.TestCase):
         for arg in GenArgList(arg_dict):
             _test_top_k(test_case, *arg)
 
+    def test_top_k_large_instance_with_ties(test_case):
+        # instances of at least 131072 elements are split into chunks selected in
+        # parallel when k is small, and fully sorted otherwise
+        arg_dict = OrderedDict()
+        arg_dict["shape"] = [(262144,), (2, 200003)]
+        arg_dict["k"] = [1, 100, 5000, 20000]
+        arg_dict["is_sorted"] = [True, False]
+        for arg in GenArgList(arg_dict):
+            _test_top_k_large_with_ties(test_case, *arg)
+
 
 if __name__ == "__main__":
     unittest.main()
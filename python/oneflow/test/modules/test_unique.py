@@ -131,6 +131,26 @@ def _test_unique_sorted(test_case, device, return_inverse, return_counts):
         test_case.assertEqual(list(oneflow_counts.shape), list(torch_counts.shape))
 
 
+def _test_unique_large_with_duplicates(test_case, num_keys, dtype, sorted):
+    # more than 32768 elements are partitioned by hash over the threads
+    np_input = np.random.randint(0, num_keys, size=(300007,)).astype(dtype)
+    unique, inverse, counts = flow.unique(
+        flow.tensor(np_input), sorted=sorted, return_inverse=True, return_counts=True,
+    )
+    unique, inverse, counts = unique.numpy(), inverse.numpy(), counts.numpy()
+    np_unique, np_inverse, np_counts = np.unique(
+        np_input, return_inverse=True, return_counts=True
+    )
+    test_case.assertTrue(np.array_equal(unique[inverse], np_input))
+    if not sorted:
+        order = np.argsort(unique)
+        unique, counts = unique[order], counts[order]
+        inverse = np.argsort(order)[inverse]
+    test_case.assertTrue(np.array_equal(unique, np_unique))
+    test_case.assertTrue(np.array_equal(inverse, np_inverse.reshape(-1)))
+    test_case.assertTrue(np.array_equal(counts, np_counts))
+
+
 @flow.unittest.skip_unless_1n1d()
 class TestUnique(flow.unittest.TestCase):
     @autotest(n=5)
@@ -143,6 +163,14 @@ class TestUnique(flow.unittest.TestCase):
             _test_unique_unsorted(test_case, *arg)
             _test_unique_sorted(test_case, *arg)
 
+    def test_unique_large_with_duplicates(test_case):
+        arg_dict = OrderedDict()
+        arg_dict["num_keys"] = [1000, 200000]
+        arg_dict["dtype"] = [np.int32, np.int64, np.float32, np.float64]
+        arg_dict["sorted"] = [True, False]
+        for arg in GenArgList(arg_dict):
+            _test_unique_large_with_duplicates(test_case, *arg)
+
     @profile(torch.unique)
     def profile_unique(test_case):
         input = torch.randint(0, 1000, (1000,))
@@ -0,0 +1,79 @@
+"""
+Copyright 2020 The OneFlow Authors. All rights reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+"""
+import unittest
+from collections import OrderedDict
+
+import numpy as np
+
+import oneflow as flow
+import oneflow.unittest
+from oneflow.test_utils.test_util import GenArgList
+
+
+def _test_unsorted_segment_sum(
+    test_case, shape, axis, num_segments, dtype, device, collide
+):
+    segment_ids = np.random.randint(0, num_segments, size=(shape[axis],))
+    if collide:
+        # half of the rows go to segment 0
+        segment_ids[np.random.rand(shape[axis]) < 0.5] = 0
+    x = np.random.randn(*shape).astype(dtype)
+    y = flow._C.unsorted_segment_sum(
+        flow.tensor(x, device=device),
+        flow.tensor(segment_ids, device=device),
+        axis=axis,
+        num_segments=num_segments,
+    )
+    out_shape = list(shape)
+    out_shape[axis] = num_segments
+    np_y = np.zeros(out_shape, dtype=np.float64)
+    np.add.at(np_y, (slice(None),) * axis + (segment_ids,), x.astype(np.float64))
+    tol = 1e-3 if dtype == np.float32 else 1e-8
+    test_case.assertTrue(np.allclose(y.numpy(), np_y, rtol=tol, atol=tol))
+
+
+@flow.unittest.skip_unless_1n1d()
+class TestUnsortedSegmentSum(flow.unittest.TestCase):
+    def test_unsorted_segment_sum(test_case):
+        arg_dict = OrderedDict()
+        arg_dict["shape_axis_num_segments"] = [
+            ((6, 3), 0, 4),
+            ((2, 5, 3), 1, 7),
+        ]
+        arg_dict["dtype"] = [np.float32, np.float64]
+        arg_dict["device"] = ["cpu"]
+        arg_dict["collide"] = [False, True]
+        for arg in GenArgList(arg_dict):
+            _test_unsorted_segment_sum(test_case, *arg[0], *arg[1:])
+
+    def test_unsorted_segment_sum_large_with_collisions(test_case):
+        # few wide rows, dense and sparse scatters of narrow rows on cpu
+        arg_dict = OrderedDict()
+        arg_dict["shape_axis_num_segments"] = [
+            ((300, 1024), 0, 8),
+            ((200000, 4), 0, 100),
+            ((200000, 4), 0, 50000),
+            ((3, 100000, 2), 1, 20000),
+        ]
+        arg_dict["dtype"] = [np.float32, np.float64]
+        arg_dict["device"] = ["cpu"]
+        arg_dict["collide"] = [False, True]
+        for arg in GenArgList(arg_dict):
+            _test_unsorted_segment_sum(test_case, *arg[0], *arg[1:])
+
+
+if __name__ == "__main__":
+    unittest.main()